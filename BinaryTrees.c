@@ -36,681 +36,11240 @@
 
 // LIBRARIES ///////////////////////////////////////////////////////////////////
 
-#include <stdlib.h>         // malloc, free
+#if defined(RB_THREADS) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // pthread_rwlock_t (even with -std=c99)
+#endif
+
+#include <stdlib.h>         // malloc, realloc, free
 #include <assert.h>         // assert
 #include <stdio.h>          // fprintf, fflush, sprintf, stderr, stdout
-#include <string.h>         // strlen
+#include <string.h>         // strlen, memcpy
+#ifdef RB_THREADS
+    #include <pthread.h>    // pthread_create, pthread_join & locks
+    #include <sched.h>      // sched_yield
+#endif
 #include "BinaryTrees.h"    // BinaryTrees library headers
 
 ////////////////////////////////////////////////////////////////////////////////
 
 
 
-// BINARY SEARCH TREES /////////////////////////////////////////////////////////
-
-
-// CREATION & INSERTION:
+// NODE POOLS //////////////////////////////////////////////////////////////////
 
-// Returns a pointer to a newly created bs_tree.
-// You must provide a comparing function "comp" such that:
-//  * comp(A,B) = 0  if and only if  A = B
-//  * comp(A,B) > 0  if and only if  A > B
-//  * comp(A,B) < 0  if and only if  A < B
-//
-// I recommend to limit the output of the "comp" function to {-1, 0, 1} as in:
+// A node pool hands out fixed-size nodes carved from big contiguous "slabs".
 //
-//  int MyComp(const void *ptr1, const void *ptr2) {
-//      MyData *d1 = (MyData *) ptr1;
-//      MyData *d2 = (MyData *) ptr2;
-//      if      (d1->key < d2->key) { return -1; }
-//      else if (d1->key > d2->key) { return +1; }
-//      else                        { return  0; }
-//  }
+// Each slab starts with a pointer to the previous slab (so we can free all of
+// them at once) followed by "slab_size" nodes. Released nodes are stored in a
+// linked list (threaded through their first word) and recycled before carving
+// new ones. Every new slab doubles the size of the previous one until it holds
+// POOL_MAX_SLAB_SIZE nodes, so a tree of n nodes needs O(log n) calls to
+// malloc (or n / POOL_MAX_SLAB_SIZE calls for really huge trees).
 //
-// However, the code does not assume that so, if you are working with simple
-// numeric keys, you can just use something like:
+// You should not use these functions directly: create the tree with the
+// "new_xx_tree_with_pool" functions instead.
+
+#define POOL_MIN_SLAB_SIZE 16
+#define POOL_MAX_SLAB_SIZE 65536
+#define POOL_SLAB_HEADER   sizeof(void *)
+
+// Initializes an empty node pool for nodes of "node_size" bytes whose first
+// slab will have room for (at least) "capacity" nodes. The first slab is not
+// allocated until the first node is requested.
 //
-//  int MyComp(const void *ptr1, const void *ptr2) {
-//      MyData *d1 = (MyData *) ptr1;
-//      MyData *d2 = (MyData *) ptr2;
-//      return (int) ((d1->key) - (d2->key));
-//  }
+static void init_node_pool(node_pool *pool, size_t node_size, size_t capacity) {
+
+    // Sanity checks:
+    assert(pool != NULL);
+    assert(node_size >= sizeof(void *));
+
+    // Initialize the empty pool:
+    if (capacity < POOL_MIN_SLAB_SIZE) { capacity = POOL_MIN_SLAB_SIZE; }
+    pool->node_size  = node_size;
+    pool->capacity   = capacity;
+    pool->slab_size  = capacity;
+    pool->slabs      = NULL;
+    pool->free_nodes = NULL;
+    pool->next       = NULL;
+    pool->end        = NULL;
+}
+
+// Returns a pointer to an uninitialized node or NULL if there is not enough
+// memory left. Takes O(1) amortized time.
 //
-bs_tree *new_bs_tree(int (* comp) (const void *, const void *)) {
+static void *node_pool_alloc(node_pool *pool) {
+
+    void *node;
+    char *slab;
 
     // Sanity check:
-    assert(comp != NULL);
+    assert(pool != NULL);
 
-    // Allocate memory:
-    bs_tree *tree = (bs_tree *) malloc(sizeof(bs_tree));
-    if (tree == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate memory for bs_tree\n");
+    // Recycle a released node if possible:
+    if (pool->free_nodes != NULL) {
+        node             = pool->free_nodes;
+        pool->free_nodes = *((void **) node);
+        return node;
     }
 
-    // Initialize the empty tree:
-    else {
-        tree->root = NULL;
-        tree->comp = comp;
+    // Allocate a new slab if the last one is full:
+    if (pool->next == pool->end) {
+        slab = (char *) malloc(POOL_SLAB_HEADER +
+                               pool->slab_size * pool->node_size);
+        if (slab == NULL) { return NULL; }
+        *((void **) slab) = pool->slabs;
+        pool->slabs = slab;
+        pool->next  = slab + POOL_SLAB_HEADER;
+        pool->end   = pool->next + pool->slab_size * pool->node_size;
+        if (pool->slab_size < POOL_MAX_SLAB_SIZE) { pool->slab_size *= 2; }
     }
 
-    return tree;
+    // Carve a new node from the last slab:
+    node        = pool->next;
+    pool->next += pool->node_size;
+    return node;
 }
 
-// Returns a (really degenerated) binary tree containing a copy of tree.
-//
-// Since it takes O(|tree|) to build the new tree you can perform:
-//
-//      bs_tree_rebalance(new_tree);
-//
-// afterwards "for free", but I prefer to return the degenerate tree because
-// it will speed up a little bit future aplications of other "bulk functions".
-// Please, take a moment to decide if you want to post-process the tree with
-// a total rebalance operation.
+// Gives "node" back to the pool in O(1) time. The memory is not returned to
+// the system until the pool is cleared.
 //
-bs_tree *bs_tree_copy(const bs_tree *tree) {
+static void node_pool_free(node_pool *pool, void *node) {
 
-    bs_tree *new_tree = NULL;
-    bs_node *new_node = NULL;
-    bs_node *pred;
-    bs_node *node;
-    
-    // Sanity check:
-    assert(tree != NULL);
-    
-    // Create a new tree:
-    new_tree = new_bs_tree(tree->comp);
-    if (new_tree == NULL) { return NULL; }
+    // Sanity checks:
+    assert(pool != NULL);
+    assert(node != NULL);
 
-    // Go to the smallest element of tree while right-threading your path:
-    node = tree->root;
-    if (node != NULL) {
-        while (node->left != NULL) {
-            pred = node->left;
-            while (pred->right != NULL) { pred = pred->right; }
-            pred->right = node;
-            node        = node->left;
-        }
-    }
+    // Push the node on the list of released nodes:
+    *((void **) node) = pool->free_nodes;
+    pool->free_nodes  = node;
+}
 
-    // Insert all data from tree into new_tree:
-    while (node != NULL) {
+// Frees all the slabs of the pool (and therefore every node allocated from it)
+// in O(#slabs) time. The pool can be used again afterwards.
+//
+static void node_pool_clear(node_pool *pool) {
 
-        // insert node->data in new_tree ///////////////////////////////////////
-        if (new_node == NULL)  {
-            new_tree->root = (bs_node *) malloc(sizeof(bs_node));
-            new_node = new_tree->root;
-        } else {
-            new_node->right = (bs_node *) malloc(sizeof(bs_node));
-            new_node = new_node->right;
-        }
-        if (new_node == NULL) {
-            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-            return new_tree;
-        } else {
-            new_node->data  = node->data;
-            new_node->left  = NULL;
-            new_node->right = NULL;
-        }
-        ////////////////////////////////////////////////////////////////////////
+    void *slab;
 
-        // advance node ////////////////////////////////////////////////////////
-        node = node->right;
-        if (node != NULL) {
-            while (node->left != NULL) {
-                pred = node->left;
-                while (pred->right != NULL && pred->right != node) {
-                    pred = pred->right;
-                }
-                if (pred->right == NULL) {
-                    pred->right = node;
-                    node        = node->left;
-                } else {
-                    pred->right = NULL;
-                    break;
-                }
-            }
-        }
-        ////////////////////////////////////////////////////////////////////////
+    // Sanity check:
+    assert(pool != NULL);
+
+    // Free all slabs:
+    while (pool->slabs != NULL) {
+        slab        = pool->slabs;
+        pool->slabs = *((void **) slab);
+        free(slab);
     }
 
-    // Return the resulting tree:
-    return new_tree;
+    // Leave the pool as if it were new:
+    init_node_pool(pool, pool->node_size, pool->capacity);
 }
 
-// Inserts data in tree.
-//
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
-//
-void *bs_tree_insert(bs_tree *tree, void *data) {
+// END OF NODE POOLS ///////////////////////////////////////////////////////////
 
-    bs_node *node;
-    bs_node *new_node;
-    void    *old_data;
-    int      comp;
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
 
-    // Avoid the trivial case: empty tree
-    node = NULL;
-    if (tree->root != NULL) {
 
-        // Search for the correct place to insert data:
-        node = tree->root;
-        for (;;) {
 
-            // Compare data:
-            comp = (tree->comp)(data, node->data);
+// TREE STATISTICS /////////////////////////////////////////////////////////////
 
-            // Data is smaller:
-            if (comp < 0) {
-                if (node->left == NULL) { break; }
-                else { node = node->left; }
-            }
+// If TREE_STATS is defined at compile time, the following macros update the
+// counters of a tree (casting the const away, because even the "read-only"
+// functions must count their work). Otherwise they do nothing at all.
 
-            // Data is bigger:
-            else if (comp > 0) {
-                if (node->right == NULL) { break; }
-                else { node = node->right; }
-            }
+#ifdef TREE_STATS
 
-            // Data is already there: overwrite it!
-            else {
-                old_data   = node->data;
-                node->data = data;
-                return old_data;
-            }
-        }
-    }
+#define STATS(tree)                 ((tree_stats *) &((tree)->stats))
+#define STATS_ADD(tree, field, n)   (STATS(tree)->field += (n))
+#define STATS_SEARCH(tree, depth)   stats_search(STATS(tree), (depth))
+#define STATS_RESET(tree)           memset(STATS(tree), 0, sizeof(tree_stats))
 
-    // Insert the new node here:
-    new_node = (bs_node *) malloc(sizeof(bs_node));
-    if (new_node == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-    } else {
-        new_node->data  = data;
-        new_node->left  = NULL;
-        new_node->right = NULL;
-    }
+// Records a search that has reached the given depth.
+//
+static inline void stats_search(tree_stats *stats, size_t depth) {
+    stats->searches++;
+    stats->depth += depth;
+    if (depth > stats->max_depth) { stats->max_depth = depth; }
+}
 
-    if (node == NULL)  { tree->root  = new_node; }
-    else if (comp < 0) { node->left  = new_node; }
-    else               { node->right = new_node; }
+#else
 
-    // Data was not here!
-    return NULL;
-}
+#define STATS_ADD(tree, field, n)   ((void) (tree))
+#define STATS_SEARCH(tree, depth)   ((void) (depth))
+#define STATS_RESET(tree)           ((void) 0)
 
-// Inserts "data" such that "data" is smaller or equal to any other "data"
-// already in the tree. It is slightly faster than a regular insert because it
-// makes at most one comparison.
-//
-// WARNING: If you use this function to insert data that is strictly bigger than
-//          something already in the tree you will break the tree!
-//
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
-//
-void *bs_tree_insert_min(bs_tree *tree, void *data) {
+#endif
 
-    bs_node *node;
-    bs_node *new_node;
-    void    *old_data;
+// Calls the comparing function of tree (and counts it):
+#define COMPARE(tree, a, b) (STATS_ADD(tree, comparisons, 1),                \
+                             ((tree)->comp)((a), (b)))
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+// END OF TREE STATISTICS //////////////////////////////////////////////////////
 
-    // Trivial case:
-    if (tree->root == NULL) { node = NULL; }
 
-    // General case:
-    else {
-        node = tree->root;
-        while (node->left != NULL) { node = node->left; }
 
-        // If "data" is already there: overwrite it & return!
-        if ((tree->comp)(data, node->data) == 0) {
-            old_data   = node->data;
-            node->data = data;
-            return old_data;
-        }
-    }
 
-    // Finally: Insert the new node here
-    new_node = (bs_node *) malloc(sizeof(bs_node));
-    if (new_node == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-    } else {
-        new_node->data  = data;
-        new_node->left  = NULL;
-        new_node->right = NULL;
-    }
-    if (node == NULL) { tree->root = new_node; }
-    else              { node->left = new_node; }
 
-    // Data was not here!
-    return NULL;
-}
+// KEY PREFIXES ////////////////////////////////////////////////////////////////
 
-// Inserts "data" such that "data" is bigger or equal to any other "data"
-// already in the tree. It is slightly faster than a regular insert because it
-// makes at most one comparison.
-//
-// WARNING: If you use this function to insert data that is strictly smaller
-//          than something already in the tree you will break the tree!
-//
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
+// If TREE_KEY_PREFIX is defined at compile time, every node caches the prefix
+// of its data and the following macros keep those prefixes up to date and use
+// them to skip most calls to the comparing function. Otherwise they fall back
+// to plain comparisons and the prefixes do not exist at all.
 //
-void *bs_tree_insert_max(bs_tree *tree, void *data) {
+// Invariant: node->prefix == KEY_PREFIX(tree, node->data) for every node, so
+// any function that writes node->data must also update node->prefix (unless
+// the new data compares "equal" to the old one, which implies equal prefixes).
 
-    bs_node *node;
-    bs_node *new_node;
-    void    *old_data;
+#ifdef TREE_KEY_PREFIX
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+#define PREFIX_INIT(tree, f)        ((tree)->prefix = (f))
+#define KEY_PREFIX(tree, data)      (((tree)->prefix == NULL) ? 0 :          \
+                                     ((tree)->prefix)(data))
+#define COPY_PREFIX(node, from)     ((node)->prefix = (from)->prefix)
+#define SET_PREFIX(tree, node)                                               \
+    ((node)->prefix = KEY_PREFIX(tree, (node)->data))
 
-    // Trivial case:
-    if (tree->root == NULL) { node = NULL; }
+// Compares data (whose prefix is kp) with node->data:
+#define PREFIX_COMPARE(tree, kp, data, node)                                 \
+    (((kp) < (node)->prefix) ? -1 :                                          \
+     ((kp) > (node)->prefix) ? +1 : COMPARE(tree, data, (node)->data))
 
-    // General case:
-    else {
-        node = tree->root;
-        while (node->right != NULL) { node = node->right; }
+#else
 
-        // If "data" is already there: overwrite it & return!
-        if ((tree->comp)(data, node->data) == 0) {
-            old_data   = node->data;
-            node->data = data;
-            return old_data;
-        }
-    }
+#define PREFIX_INIT(tree, f)        ((void) 0)
+#define KEY_PREFIX(tree, data)      0
+#define COPY_PREFIX(node, from)     ((void) 0)
+#define SET_PREFIX(tree, node)      ((void) 0)
 
-    // Finally: Insert the new node here
-    new_node = (bs_node *) malloc(sizeof(bs_node));
-    if (new_node == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-    } else {
-        new_node->data  = data;
-        new_node->left  = NULL;
-        new_node->right = NULL;
-    }
-    if (node == NULL) { tree->root  = new_node; }
-    else              { node->right = new_node; }
+#define PREFIX_COMPARE(tree, kp, data, node)                                 \
+    ((void) (kp), COMPARE(tree, data, (node)->data))
 
-    // Data was not here!
-    return NULL;
-}
+#endif
 
+// END OF KEY PREFIXES /////////////////////////////////////////////////////////
 
 
-// SEARCH:
 
-// Returns YES if the tree is empty and NO otherwise.
-//
-int bs_tree_is_empty(const bs_tree *tree) {
 
-    // Sanity check:
-    assert(tree != NULL);
 
-    // Check if there is at least 1 node in the tree:
-    if (tree->root == NULL) { return YES; }
-    else                    { return NO;  }
-}
+// MIN & MAX NODES /////////////////////////////////////////////////////////////
 
-// Finds a node that compares "equal" to data. Returns NULL if not found.
+// If TREE_MIN_MAX is defined at compile time, the following macros keep the
+// leftmost & rightmost nodes of a tree up to date. Otherwise they do nothing.
 //
-void *bs_tree_search(const bs_tree *tree, const void *data) {
+// Rotations (and splay steps) never move data between nodes, so the extremes
+// only change when a node is linked (MINMAX_LINK) or released (MINMAX_FORGET
+// leaves the extreme as NULL, and the "xx_fix_min_max" function of each
+// variant finds it again before the operation returns). Functions that build
+// whole trees just clear both extremes (MINMAX_CLEAR) and fix them at the end.
 
-    bs_node *node;
-    int      comp;
+#ifdef TREE_MIN_MAX
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+#define MINMAX_CLEAR(tree)  ((tree)->leftmost = NULL, (tree)->rightmost = NULL)
 
-    // Search:
-    node = tree->root;
-    while (node != NULL) {
-        comp = (tree->comp)(data, node->data);      // compare data
-        if      (comp < 0) { node = node->left;  }  // data is smaller
-        else if (comp > 0) { node = node->right; }  // data is bigger
-        else               { return node->data;  }  // found!
-    }
+// A new node has just been hung from parent (on its left if "left" is YES):
+#define MINMAX_LINK(tree, parent, node, left)                                \
+    ((tree)->leftmost  = ((parent) == NULL || ((left) &&                     \
+                          (parent) == (tree)->leftmost)) ?                   \
+                         (node) : (tree)->leftmost,                          \
+     (tree)->rightmost = ((parent) == NULL || (!(left) &&                    \
+                          (parent) == (tree)->rightmost)) ?                  \
+                         (node) : (tree)->rightmost)
 
-    // Not found:
-    return NULL;
-}
+// A new node has just been hung as the biggest one (used by the functions
+// that build degenerated trees in increasing order):
+#define MINMAX_APPEND(tree, node)                                            \
+    ((tree)->leftmost  = ((tree)->leftmost == NULL) ? (node)                 \
+                                                    : (tree)->leftmost,      \
+     (tree)->rightmost = (node))
 
-// Returns a pointer to the smallest element stored in the tree.
-// Returns NULL if the tree is empty.
-//
-void *bs_tree_min(const bs_tree *tree) {
+// A new node has just become the root of the tree (used by splay trees):
+#define MINMAX_ROOT(tree)                                                    \
+    ((tree)->leftmost  = ((tree)->root->left  == NULL) ? (tree)->root        \
+                                                       : (tree)->leftmost,   \
+     (tree)->rightmost = ((tree)->root->right == NULL) ? (tree)->root        \
+                                                       : (tree)->rightmost)
 
-    bs_node *node;
+// A node is about to be released:
+#define MINMAX_FORGET(tree, node)                                            \
+    ((tree)->leftmost  = ((tree)->leftmost  == (node)) ? NULL                \
+                                                       : (tree)->leftmost,   \
+     (tree)->rightmost = ((tree)->rightmost == (node)) ? NULL                \
+                                                       : (tree)->rightmost)
 
-    // Sanity check:
-    assert(tree != NULL);
+#else
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
+#define MINMAX_CLEAR(tree)                      ((void) 0)
+#define MINMAX_LINK(tree, parent, node, left)   ((void) 0)
+#define MINMAX_APPEND(tree, node)               ((void) 0)
+#define MINMAX_ROOT(tree)                       ((void) 0)
+#define MINMAX_FORGET(tree, node)               ((void) 0)
 
-    // General case: Find the smallest node
-    node = tree->root;
-    while (node->left != NULL) { node = node->left; }
+#endif
 
-    // Return a pointer to the data:
-    return node->data;
-}
+// END OF MIN & MAX NODES //////////////////////////////////////////////////////
 
-// Returns a pointer to the biggest element stored in "tree".
-// Returns NULL if the tree is empty.
-//
-void *bs_tree_max(const bs_tree *tree) {
 
-    bs_node *node;
 
-    // Sanity check:
-    assert(tree != NULL);
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
 
-    // General case: Find the biggest node
-    node = tree->root;
-    while (node->right != NULL) { node = node->right; }
+// SPLAYING POLICIES ///////////////////////////////////////////////////////////
 
-    // Return a pointer to the data:
-    return node->data;
-}
+// If SP_SPLAY_POLICY is defined at compile time, every new bs_tree & sp_tree
+// starts splaying on every lookup (just like before) and the random state is
+// seeded with a fixed non-zero value, so runs are reproducible. Otherwise the
+// policy does not exist at all.
 
-// Find the in-order predesor of data in the tree.
-//
-// If data is not in tree returns the biggest element of tree smaller than data.
-// If data is smaller or equal to all elements of tree returns NULL.
-//
-void *bs_tree_prev(const bs_tree *tree, const void *data) {
+#ifdef SP_SPLAY_POLICY
 
-    bs_node *node;
-    bs_node *pred;
-    int      comp;
+#define SPLAY_SEED  0x9E3779B97F4A7C15ULL  // Any non-zero value will do
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+#define SPLAY_POLICY_INIT(tree)     ((tree)->splay_policy = SP_SPLAY_ALWAYS,  \
+                                     (tree)->splay_param  = 0,                \
+                                     (tree)->splay_state  = SPLAY_SEED)
 
-    // Search:
-    pred = NULL;
-    node = tree->root;
-    while (node != NULL) {
+#else
 
-        // Compare data:
-        comp = (tree->comp)(data, node->data);
+#define SPLAY_POLICY_INIT(tree)     ((void) 0)
 
-        // Data is smaller:
-        if (comp < 0) { node = node->left; }
+#endif
 
-        // Data is bigger:
-        else if (comp > 0) {
-            pred = node;
-            node = node->right;
-        }
+// END OF SPLAYING POLICIES ////////////////////////////////////////////////////
 
-        // We have found the node:
-        else if (node->left != NULL) {
-            pred = node->left;
-            while (pred->right != NULL) { pred = pred->right; }
-            break;
-        } else { break; }
-    }
 
-    // Return predecesor:
-    if (pred == NULL) { return NULL; }
-    return pred->data;
-}
 
-// Find the in-order successor of data in the tree.
+
+
+// BATCHES /////////////////////////////////////////////////////////////////////
+
+// The batch functions ("xx_tree_insert_batch" & "xx_tree_search_batch")
+// process their elements in increasing order, so consecutive elements share
+// most of their search path. This function computes that order.
+
+// Returns an array with the positions of the n elements of data sorted in
+// increasing order (according to comp), or NULL if out of memory. Elements
+// that compare "equal" keep their relative order (it is a stable sort).
 //
-// If data is not in tree returns the smallest element of tree bigger than data.
-// If data is bigger or equal to all elements of tree returns NULL.
+// It is an iterative merge sort: O(n·log(n)) time, but only n-1 comparisons
+// if data is already sorted (which is the common case).
 //
-void *bs_tree_next(const bs_tree *tree, const void *data) {
+static size_t *sort_batch(int (* comp) (const void *, const void *),
+                          const void **data, size_t n) {
 
-    bs_node *node;
-    bs_node *succ;
-    int      comp;
+    size_t *order;
+    size_t *aux;
+    size_t *swap;
+    size_t  width;
+    size_t  first, mid, last;
+    size_t  i, j, k;
 
-    // Sanity Checks:
-    assert(tree != NULL);
+    // Sanity checks:
+    assert(comp != NULL);
     assert(data != NULL);
+    assert(n > 0);
 
-    // Search:
-    succ = NULL;
-    node = tree->root;
-    while (node != NULL) {
+    // Start with the original order:
+    order = (size_t *) malloc(n * sizeof(size_t));
+    if (order == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for the batch\n");
+        return NULL;
+    }
+    for (i = 0; i < n; i++) { order[i] = i; }
 
-        // Compare data:
-        comp = (tree->comp)(data, node->data);
+    // Easy case: data is already sorted
+    for (i = 1; i < n && comp(data[i - 1], data[i]) <= 0; i++) {}
+    if (i == n) { return order; }
 
-        // Data is smaller:
-        if (comp < 0) {
-            succ = node;
-            node = node->left;
+    // General case: merge runs of 1, 2, 4... elements
+    aux = (size_t *) malloc(n * sizeof(size_t));
+    if (aux == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for the batch\n");
+        free(order);
+        return NULL;
+    }
+    for (width = 1; width < n; width *= 2) {
+        for (first = 0; first < n; first += 2 * width) {
+            mid  = (first + width     < n) ? first + width     : n;
+            last = (first + 2 * width < n) ? first + 2 * width : n;
+            i = first;
+            j = mid;
+            k = first;
+            while (i < mid && j < last) {
+                if (comp(data[order[j]], data[order[i]]) < 0) {
+                    aux[k++] = order[j++];
+                } else {
+                    aux[k++] = order[i++];
+                }
+            }
+            while (i < mid)  { aux[k++] = order[i++]; }
+            while (j < last) { aux[k++] = order[j++]; }
         }
-
-        // Data is bigger:
-        else if (comp > 0) { node = node->right; }
-
-        // We have found the node:
-        else if (node->right != NULL) {
-            succ = node->right;
-            while (succ->left != NULL) { succ = succ->left; }
-            break;
-        } else { break; }
+        swap  = order;
+        order = aux;
+        aux   = swap;
     }
+    free(aux);
 
-    // Return succesor:
-    if (succ == NULL) { return NULL; }
-    return succ->data;
+    return order;
 }
 
+// Number of searches kept in flight by "xx_tree_search_interleaved":
+#define BATCH_GROUP 16
 
+// Hint to bring p into the cache (if the compiler knows how to do it):
+#if defined(__GNUC__)
+    #define BATCH_PREFETCH(p) __builtin_prefetch(p)
+#else
+    #define BATCH_PREFETCH(p) ((void) 0)
+#endif
 
-// REMOVE:
+// END OF BATCHES //////////////////////////////////////////////////////////////
 
-// Removes a node of tree that compares "equal" to data and returns a pointer
-// to the previously stored data (so you can free it).
-// If such a node is not found, it returns a NULL pointer.
+
+
+
+
+// BINARY SEARCH TREES /////////////////////////////////////////////////////////
+
+
+// NODE ALLOCATION:
+
+// Returns a new (uninitialized) bs_node taken from the node pool of tree, or
+// from malloc if tree does not have a pool. Returns NULL if out of memory.
 //
-// Uses the trick of swapping node->data and successor->data pointers and then
-// removes successor. This is safe because the final user has no acces to any
-// tree node (only "tree" and "data" pointers are used in all interfaces) and
-// no traverser is coded either (so no "internal state" is stored in them).
+static inline bs_node *new_bs_node(bs_tree *tree) {
+    STATS_ADD(tree, allocations, 1);
+    if (tree->pool == NULL) { return (bs_node *) malloc(sizeof(bs_node)); }
+    else                    { return (bs_node *) node_pool_alloc(tree->pool); }
+}
+
+// Releases a bs_node previously obtained with "new_bs_node".
 //
-void *bs_tree_remove(bs_tree *tree, const void *data) {
+static inline void free_bs_node(bs_tree *tree, bs_node *node) {
+    STATS_ADD(tree, releases, 1);
+    MINMAX_FORGET(tree, node);
+    if (tree->pool == NULL) { free(node); }
+    else                    { node_pool_free(tree->pool, node); }
+}
+
+#ifdef TREE_MIN_MAX
+
+// Finds the leftmost & rightmost nodes of tree again if they are unknown
+// (NULL) after a node was released or the whole tree was built (see MIN & MAX
+// NODES). It takes O(height) time.
+//
+static void bs_fix_min_max(bs_tree *tree) {
 
-    bs_node *parent;
     bs_node *node;
-    bs_node *old_node;
-    void    *old_data;
-    int      comp;
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+    // Trivial case: empty tree
+    if (tree->root == NULL) {
+        MINMAX_CLEAR(tree);
+        return;
+    }
 
-    // Search the node to delete:
-    parent   = NULL;
-    node     = tree->root;
-    while (node != NULL) {
+    // Walk down the spines (only if needed):
+    if (tree->leftmost == NULL) {
+        node = tree->root;
+        while (node->left != NULL) { node = node->left; }
+        tree->leftmost = node;
+    }
+    if (tree->rightmost == NULL) {
+        node = tree->root;
+        while (node->right != NULL) { node = node->right; }
+        tree->rightmost = node;
+    }
+}
 
-        // Compare data:
-        comp = (tree->comp)(data, node->data);
+#else
 
-        // Data is smaller:
-        if (comp < 0) {
-            parent = node;
-            node   = node->left;
-        }
+#define bs_fix_min_max(tree) ((void) 0)
 
-        // Data is bigger:
-        else if (comp > 0) {
-            parent = node;
-            node   = node->right;
-        }
+#endif
 
-        // We have found the node:
-        else {
+// Returns a new empty bs_tree that uses the comparing (and prefix) function of
+// tree and has its own node pool if tree has one. Used by the copy & set
+// functions.
+//
+static bs_tree *new_bs_tree_as(const bs_tree *tree) {
+    bs_tree *new_tree;
+    if (tree->pool == NULL) { new_tree = new_bs_tree(tree->comp); }
+    else {
+        new_tree = new_bs_tree_with_pool(tree->comp, tree->pool->capacity);
+    }
+    if (new_tree != NULL) { PREFIX_INIT(new_tree, tree->prefix); }
+    return new_tree;
+}
 
-            old_data = node->data;
 
-            // If node has both subtrees we must do some extra work:
-            if (node->left != NULL && node->right != NULL) {
 
-                // Remember the place and keep going down to find the successor
-                old_node = node;                // Here we are looking for the
-                parent   = node;                // inorder successor of node
-                node     = node->right;         // but if we exchange left for
-                while (node->left != NULL) {    // right (and viceversa) on
-                    parent = node;              // thisblock of code we could
-                    node   = node->left;        // implement the equaly valid
-                }                               // predecesor version of remove
+// IN-ORDER TRAVERSALS:
 
-                // Once we find the "succesor" of "old_node"
-                // we just move the data pointer and remove
-                // the current "node":
-                old_node->data = node->data;
-            }
+// The copy & set functions traverse their (const) input trees in-order using
+// an explicit stack that stores the ancestors whose left subtree is being
+// visited. Unlike Morris traversals, this never writes into the tree, so many
+// threads can copy or combine the same tree at the same time.
+//
+// Binary search trees can be arbitrarily deep, so the stack starts in a small
+// buffer and moves to the heap only if it is needed (left-degenerated trees).
+// Note that the "really degenerated" trees returned by the copy & set
+// functions only go to the right, so they never need more than 1 slot.
+//
+// If the stack cannot grow, the walker stops and sets its "error" flag. The
+// copy & set functions check it at the end and return NULL (instead of a
+// tree that looks fine but misses some elements).
+
+#define BS_WALKER_BUFFER 64     // Length of the buffer of a bs_walker
+
+typedef struct bs_walker {
+    bs_node  *node;                     // Current node (NULL if finished)
+    bs_node **stack;                    // Pending ancestors of node
+    size_t    size;                     // Length of the stack
+    size_t    capacity;                 // Allocated length of the stack
+    int       error;                    // YES if the stack could not grow
+    bs_node  *buffer[BS_WALKER_BUFFER]; // Initial storage for the stack
+} bs_walker;
+
+// This is an auxiliary function that pushes node and all its leftmost
+// descendants in the stack of walker and then pops the last one (the smallest
+// node of the subtree) as the current node of walker.
+//
+// If out of memory, it finishes the traversal, returns NULL and sets the
+// "error" flag of walker (so the callers can tell it from the real end).
+//
+static bs_node *bs_walker_descend(bs_walker *walker, bs_node *node) {
 
-            // At this point we are sure that "node" has, at least,
-            // one empty subtree, which greatly simplifies the removal:
+    bs_node **stack;
 
-            // Easy case 1: node->left is NULL
-            if (node->left == NULL) {
-                if      (parent       == NULL) { tree->root    = node->right; }
-                else if (parent->left == node) { parent->left  = node->right; }
-                else                           { parent->right = node->right; }
-                free(node);
-                return old_data;
-            }
+    // Push node and its leftmost descendants:
+    while (node != NULL) {
 
-            // Easy case 2: node->right is NULL
-            else {
-                if      (parent       == NULL) { tree->root    = node->left; }
-                else if (parent->left == node) { parent->left  = node->left; }
-                else                           { parent->right = node->left; }
-                free(node);
-                return old_data;
+        // Grow the stack if it is full:
+        if (walker->size == walker->capacity) {
+            if (walker->stack == walker->buffer) {
+                stack = (bs_node **) malloc(2 * walker->capacity *
+                                            sizeof(bs_node *));
+                if (stack != NULL) {
+                    memcpy(stack, walker->buffer,
+                           walker->capacity * sizeof(bs_node *));
+                }
+            } else {
+                stack = (bs_node **) realloc(walker->stack, 2 *
+                                             walker->capacity *
+                                             sizeof(bs_node *));
+            }
+            if (stack == NULL) {
+                fprintf(stderr, "ERROR: Unable to grow bs_walker\n");
+                walker->size  = 0;
+                walker->node  = NULL;
+                walker->error = YES;
+                return NULL;
             }
+            walker->stack     = stack;
+            walker->capacity *= 2;
         }
+
+        walker->stack[walker->size] = node;
+        walker->size++;
+        node = node->left;
     }
-    return NULL;
+
+    // Pop the smallest one:
+    if (walker->size == 0) { walker->node = NULL; }
+    else {
+        walker->size--;
+        walker->node = walker->stack[walker->size];
+    }
+    return walker->node;
 }
 
-// Removes the smallest element from "tree" and returns a pointer to its data
-// (so you can free it). If the tree is empty returns a NULL pointer.
+// Starts an in-order traversal of the subtree rooted at root and returns its
+// smallest node (or NULL if root is NULL).
 //
-// More efficient than "tree_remove(tree, min_elem)" even if you already know
-// the value of "min_elem".
+static bs_node *bs_walker_first(bs_walker *walker, bs_node *root) {
+    walker->stack    = walker->buffer;
+    walker->size     = 0;
+    walker->capacity = BS_WALKER_BUFFER;
+    walker->error    = NO;
+    return bs_walker_descend(walker, root);
+}
+
+// Moves walker to the in-order successor of its current node and returns it
+// (or NULL if the traversal is finished).
 //
-void *bs_tree_remove_min(bs_tree *tree) {
+static bs_node *bs_walker_next(bs_walker *walker) {
+    if (walker->node == NULL) { return NULL; }
+    return bs_walker_descend(walker, walker->node->right);
+}
+
+// Releases the memory used by the stack of walker (if any).
+//
+static void bs_walker_free(bs_walker *walker) {
+    if (walker->stack != walker->buffer) { free(walker->stack); }
+    walker->stack = walker->buffer;
+}
+
+
+
+// REBUILDING:
+
+// Rebuilds the subtree hanging from link as a perfectly balanced subtree in
+// linear time, with the "blind" Day–Stout–Warren algorithm explained in
+// "bs_tree_rebalance". Only the nodes of the subtree are touched.
+//
+static void bs_rebuild(bs_node **link) {
 
     bs_node *node;
+    bs_node *left;
+    bs_node *right;
+    bs_node *child;
     bs_node *parent;
-    void    *old_data;
 
     // Sanity check:
-    assert(tree != NULL);
+    assert(link != NULL);
 
-    // Avoid trivial case: empty tree
-    old_data = NULL;
-    if (tree->root != NULL) {
+    // Avoid trivial case: empty subtree
+    if (*link != NULL) {
 
-        // General case: Find the smallest node
-        parent = NULL;
-        node   = tree->root;
-        while (node->left != NULL) {
-            parent = node;
+        // LINEARIZE THE TREE: ///////////////////////////////////
+                                                                //
+        node = *link;                                           //
+                                                                //
+        // Unravel the left side of root:                       //
+        while (node->left != NULL) {                            //
+                                                                //
+            // Rotate right:                                    //
+            left        = node->left;                           //
+            right       = left->right;                          //
+            left->right = node;                                 //
+            node->left  = right;                                //
+                                                                //
+            // Move to the new root:                            //
+            node = left;                                        //
+        }                                                       //
+                                                                //
+        // Fix the root:                                        //
+        *link  = node;                                          //
+        parent = NULL;                                          //
+                                                                //
+        // Unravel the rest of the tree:                        //
+        while (node != NULL) {                                  //
+                                                                //
+            if (node->left != NULL) {                           //
+                                                                //
+                // Rotate right:                                //
+                left          = node->left;                     //
+                right         = left->right;                    //
+                left->right   = node;                           //
+                node->left    = right;                          //
+                parent->right = left;                           //
+                                                                //
+                // Move up:                                     //
+                node = left;                                    //
+                                                                //
+            } else {                                            //
+                                                                //
+                // Move down:                                   //
+                parent = node;                                  //
+                node   = node->right;                           //
+            }                                                   //
+        }                                                       //
+        //////////////////////////////////////////////////////////
+
+
+        // RE-BALANCE THE TREE ///////////////////////////////////
+                                                                //
+        for (;;) {                                              //
+                                                                //
+            parent = NULL;                                      //
+            node   = *link;                                     //
+            child  = node->right;                               //
+                                                                //
+            if (child == NULL) { break; }                       //
+                                                                //
+            // Move along the right spine:                      //
+            while (child != NULL) {                             //
+                                                                //
+                // Rotate left:                                 //
+                if (parent == NULL) { *link         = child; }  //
+                else                { parent->right = child; }  //
+                node->right = child->left;                      //
+                child->left = node;                             //
+                                                                //
+                // Advance:                                     //
+                parent = child;                                 //
+                node   = parent->right;                         //
+                if (node == NULL) { break; }                    //
+                else { child = node->right; }                   //
+            }                                                   //
+        }                                                       //
+        //////////////////////////////////////////////////////////
+
+
+        // A FINAL IMPROVEMENT ///////////////////////////////////
+        //
+        // When you arrive here the root is the biggest element
+        // of the tree and has no right child.
+        //
+        // So, if we remove the root node and insert it as the
+        // right pointer of the second biggest element, the new
+        // root element will be way closer to be the "median"
+        // element (rather than being the biggest element) and
+        // everyone else will be 1 step closer to the root.
+        //
+        // If you do not understand what I mean, comment the
+        // following lines and use the print_bs_tree
+        // function to take a look.
+        //
+        node = *link;
+        if (node->left != NULL) {
+            *link = node->left;
+            child      = node->left;
+            while (child->right != NULL) { child = child->right; }
+            child->right = node;
+            node->left = NULL;
+        }
+        //////////////////////////////////////////////////////////
+    }
+}
+
+
+
+// SCAPEGOAT MODE:
+
+// If BS_SCAPEGOAT is defined at compile time, the following macros & functions
+// keep the node count of the trees in scapegoat mode and rebuild them when
+// they get too deep (see SCAPEGOAT MODE in the header). Otherwise they do
+// nothing at all.
+
+#ifdef BS_SCAPEGOAT
+
+#define SCAPEGOAT_INIT(tree)        ((tree)->alpha    = 0.0,                 \
+                                     (tree)->size     = 0,                   \
+                                     (tree)->max_size = 0)
+#define SCAPEGOAT_CLEAR(tree)       ((tree)->size = (tree)->max_size = 0)
+#define SCAPEGOAT_INSERT(tree, node, depth)                                  \
+    ((void) bs_scapegoat_insert((tree), (node), (depth)))
+#define SCAPEGOAT_REMOVE(tree)      bs_scapegoat_remove(tree)
+#define SCAPEGOAT_SPINE(tree, left) bs_scapegoat_spine((tree), (left))
+
+// Counts the nodes of the subtree rooted at node.
+//
+static size_t bs_subtree_size(bs_node *node) {
+    bs_walker walker;
+    size_t    size = 0;
+    node = bs_walker_first(&walker, node);
+    while (node != NULL) {
+        size++;
+        node = bs_walker_next(&walker);
+    }
+    bs_walker_free(&walker);
+    return size;
+}
+
+// Returns YES if a node at the given depth of a tree with n nodes is deeper
+// than log(n) / log(1/alpha), that is, if (1/alpha)^depth > n.
+//
+static int bs_scapegoat_too_deep(double alpha, size_t depth, size_t n) {
+    double base  = 1.0 / alpha;
+    double power = 1.0;
+    while (depth > 0) {
+        if (depth & 1) { power *= base; }
+        base  *= base;
+        depth >>= 1;
+    }
+    return (power > (double) n) ? YES : NO;
+}
+
+// Returns the number of nodes in the left (or right) spine of tree, that is,
+// the depth a new smallest (or biggest) node will get, without comparing any
+// data (or 0 if the mode is off, since it will not be needed).
+//
+static size_t bs_scapegoat_spine(const bs_tree *tree, int left) {
+    const bs_node *node;
+    size_t         depth = 0;
+    if (tree->alpha == 0.0) { return 0; }
+    for (node = tree->root; node != NULL; depth++) {
+        node = (left == YES) ? node->left : node->right;
+    }
+    return depth;
+}
+
+// Counts node, which has just been linked to tree at the given depth (or 0 if
+// unknown), and rebuilds the subtree of its scapegoat if it is too deep.
+// Returns YES if some subtree has been rebuilt (and so the shape of the tree
+// has changed) or NO otherwise.
+//
+static int bs_scapegoat_insert(bs_tree *tree, bs_node *node, size_t depth) {
+
+    bs_node **path;
+    bs_node **link;
+    bs_node  *child;
+    bs_node  *parent;
+    size_t    child_size;
+    size_t    size;
+    size_t    i;
+
+    // Nothing to do if the mode is off:
+    if (tree->alpha == 0.0) { return NO; }
+    tree->size++;
+    if (tree->size > tree->max_size) { tree->max_size = tree->size; }
+
+    // Measure the depth of node if unknown:
+    if (depth == 0) {
+        for (child = tree->root; child != node; depth++) {
+            if (COMPARE(tree, node->data, child->data) < 0) {
+                child = child->left;
+            } else {
+                child = child->right;
+            }
+        }
+    }
+
+    // Most of the insertions end here:
+    if (bs_scapegoat_too_deep(tree->alpha, depth, tree->size) == NO) {
+        return NO;
+    }
+
+    // Find the path from the root to node again:
+    path = (bs_node **) malloc(depth * sizeof(bs_node *));
+    if (path == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate scapegoat path\n");
+        return NO;
+    }
+    child = tree->root;
+    for (i = 0; i < depth; i++) {
+        path[i] = child;
+        if (COMPARE(tree, node->data, child->data) < 0) {
+            child = child->left;
+        } else {
+            child = child->right;
+        }
+    }
+    assert(child == node);
+
+    // Climb until the first ancestor that is not alpha-weight-balanced (if
+    // there were none, which is impossible, rebuild the whole tree):
+    link       = &(tree->root);
+    child_size = 1;
+    for (i = depth; i > 0; i--) {
+        parent = path[i - 1];
+        size   = child_size + 1 +
+                 bs_subtree_size((parent->left == child) ? parent->right :
+                                                           parent->left);
+        if ((double) child_size > tree->alpha * (double) size) {
+            if (i > 1) {
+                link = (path[i - 2]->left == parent) ? &(path[i - 2]->left) :
+                                                       &(path[i - 2]->right);
+            }
+            break;
+        }
+        child      = parent;
+        child_size = size;
+    }
+    free(path);
+
+    // Rebuild its subtree:
+    bs_rebuild(link);
+    if (link == &(tree->root)) { tree->max_size = tree->size; }
+    return YES;
+}
+
+// Uncounts a node that has just been removed from tree and rebuilds the whole
+// tree if it has shrunk too much since the last time.
+//
+static void bs_scapegoat_remove(bs_tree *tree) {
+    if (tree->alpha == 0.0) { return; }
+    tree->size--;
+    if ((double) tree->size < tree->alpha * (double) tree->max_size) {
+        bs_rebuild(&(tree->root));
+        tree->max_size = tree->size;
+    }
+}
+
+#else
+
+#define SCAPEGOAT_INIT(tree)                ((void) 0)
+#define SCAPEGOAT_CLEAR(tree)               ((void) 0)
+#define SCAPEGOAT_INSERT(tree, node, depth) ((void) (depth))
+#define SCAPEGOAT_REMOVE(tree)              ((void) 0)
+#define SCAPEGOAT_SPINE(tree, left)         ((size_t) 0)
+
+#endif
+
+
+
+// CREATION & INSERTION:
+
+// Returns a pointer to a newly created bs_tree.
+// You must provide a comparing function "comp" such that:
+//  * comp(A,B) = 0  if and only if  A = B
+//  * comp(A,B) > 0  if and only if  A > B
+//  * comp(A,B) < 0  if and only if  A < B
+//
+// I recommend to limit the output of the "comp" function to {-1, 0, 1} as in:
+//
+//  int MyComp(const void *ptr1, const void *ptr2) {
+//      MyData *d1 = (MyData *) ptr1;
+//      MyData *d2 = (MyData *) ptr2;
+//      if      (d1->key < d2->key) { return -1; }
+//      else if (d1->key > d2->key) { return +1; }
+//      else                        { return  0; }
+//  }
+//
+// However, the code does not assume that so, if you are working with simple
+// numeric keys, you can just use something like:
+//
+//  int MyComp(const void *ptr1, const void *ptr2) {
+//      MyData *d1 = (MyData *) ptr1;
+//      MyData *d2 = (MyData *) ptr2;
+//      return (int) ((d1->key) - (d2->key));
+//  }
+//
+bs_tree *new_bs_tree(int (* comp) (const void *, const void *)) {
+
+    // Sanity check:
+    assert(comp != NULL);
+
+    // Allocate memory:
+    bs_tree *tree = (bs_tree *) malloc(sizeof(bs_tree));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for bs_tree\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->comp = comp;
+        tree->pool = NULL;
+        PREFIX_INIT(tree, NULL);
+        SPLAY_POLICY_INIT(tree);
+        SCAPEGOAT_INIT(tree);
+        MINMAX_CLEAR(tree);
+        STATS_RESET(tree);
+    }
+
+    return tree;
+}
+
+// Returns a pointer to a newly created bs_tree whose nodes are allocated from
+// a node pool instead of calling malloc and free for every single node.
+//
+// The first slab of the pool will have room for "capacity" nodes (use your
+// best guess of the final size of the tree or 0 if you have no idea) and the
+// following slabs will be bigger and bigger. Removed nodes stay in the pool
+// and are reused by future insertions, so the memory of the pool is only
+// returned to the system by "bs_tree_remove_all", which takes O(#slabs)
+// time (plus O(|tree|) if you provide a "free_data" function).
+//
+// The pool lives in the same block of memory as the tree, so you can still
+// destroy it as usual:
+//
+//      bs_tree_remove_all(tree, free_data);
+//      free(tree);
+//
+// The comparing function must satisfy the same rules as in "new_bs_tree".
+//
+bs_tree *new_bs_tree_with_pool(int (* comp) (const void *, const void *),
+                               size_t capacity) {
+
+    // Sanity check:
+    assert(comp != NULL);
+
+    // Allocate memory for the tree and its pool:
+    bs_tree *tree = (bs_tree *) malloc(sizeof(bs_tree) + sizeof(node_pool));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for bs_tree\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->comp = comp;
+        tree->pool = (node_pool *) (tree + 1);
+        PREFIX_INIT(tree, NULL);
+        SPLAY_POLICY_INIT(tree);
+        SCAPEGOAT_INIT(tree);
+        MINMAX_CLEAR(tree);
+        STATS_RESET(tree);
+        init_node_pool(tree->pool, sizeof(bs_node), capacity);
+    }
+
+    return tree;
+}
+
+// Pending range of the sorted array (used by "bs_tree_from_sorted_array"):
+typedef struct bs_range {
+    size_t    first;    // First index of the range
+    size_t    last;     // One past the last index of the range
+    bs_node **link;     // Where to hang the subtree built from the range
+} bs_range;
+
+#define BS_RANGE_STACK 128  // More than enough for any tree that fits in RAM
+
+// Returns a pointer to a newly created (perfectly balanced) bs_tree containing
+// the n elements of the array "data", or NULL if out of memory. The elements
+// must be sorted in increasing order (according to comp) without duplicates.
+//
+// The middle element of the array becomes the root and both halves become
+// its subtrees (and so on), so all the levels of the tree but the last one
+// are full. It takes O(n) time (no comparisons at all) and all the nodes are
+// carved from a single contiguous block: the first slab of the node pool of
+// the tree. Apart from that, the tree is just like any other tree created
+// with "new_bs_tree_with_pool".
+//
+bs_tree *bs_tree_from_sorted_array(int (* comp) (const void *, const void *),
+                                   void **data, size_t n) {
+
+    bs_tree  *tree;
+    bs_node  *node;
+    bs_range  stack[BS_RANGE_STACK];
+    bs_range  range;
+    size_t    size;
+    size_t    mid;
+
+    // Sanity checks:
+    assert(comp != NULL);
+    assert(data != NULL || n == 0);
+
+    // Create a new tree whose first slab has room for all the nodes:
+    tree = new_bs_tree_with_pool(comp, n);
+    if (tree == NULL) { return NULL; }
+    if (n == 0)       { return tree; }
+
+    // Start with the whole array:
+    stack[0].first = 0;
+    stack[0].last  = n;
+    stack[0].link  = &(tree->root);
+    size = 1;
+
+    // Build the tree top-down:
+    while (size > 0) {
+
+        // Take the next pending range:
+        size--;
+        range = stack[size];
+        mid   = range.first + (range.last - range.first) / 2;
+
+        // Sanity checks:
+        assert(data[mid] != NULL);
+        assert(mid == 0 || comp(data[mid - 1], data[mid]) < 0);
+
+        // Its middle element is the root of its subtree (only the first
+        // node can fail, since the first slab has room for all of them):
+        node = new_bs_node(tree);
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            free(tree);
+            return NULL;
+        }
+        node->data    = data[mid];
+        node->left    = NULL;
+        node->right   = NULL;
+        *(range.link) = node;
+        SET_PREFIX(tree, node);
+
+        // Push both halves (the left one will be built first):
+        assert(size + 2 <= BS_RANGE_STACK);
+        if (mid + 1 < range.last) {
+            stack[size].first = mid + 1;
+            stack[size].last  = range.last;
+            stack[size].link  = &(node->right);
+            size++;
+        }
+        if (range.first < mid) {
+            stack[size].first = range.first;
+            stack[size].last  = mid;
+            stack[size].link  = &(node->left);
+            size++;
+        }
+    }
+    bs_fix_min_max(tree);
+
+    return tree;
+}
+
+// Returns a (really degenerated) binary tree containing a copy of tree.
+//
+// Since it takes O(|tree|) to build the new tree you can perform:
+//
+//      bs_tree_rebalance(new_tree);
+//
+// afterwards "for free", but I prefer to return the degenerate tree because
+// it will speed up a little bit future aplications of other "bulk functions".
+// Please, take a moment to decide if you want to post-process the tree with
+// a total rebalance operation.
+//
+bs_tree *bs_tree_copy(const bs_tree *tree) {
+
+    bs_tree   *new_tree = NULL;
+    bs_node   *new_node = NULL;
+    bs_walker  walker;
+    bs_node   *node;
+    
+    // Sanity check:
+    assert(tree != NULL);
+    
+    // Create a new tree:
+    new_tree = new_bs_tree_as(tree);
+    if (new_tree == NULL) { return NULL; }
+
+    // Go to the smallest element of tree:
+    node = bs_walker_first(&walker, tree->root);
+
+    // Insert all data from tree into new_tree:
+    while (node != NULL) {
+
+        // insert node->data in new_tree ///////////////////////////////////////
+        if (new_node == NULL)  {
+            new_tree->root = new_bs_node(new_tree);
+            new_node = new_tree->root;
+        } else {
+            new_node->right = new_bs_node(new_tree);
+            new_node = new_node->right;
+        }
+        if (new_node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            bs_walker_free(&walker);
+            return new_tree;
+        } else {
+            new_node->data  = node->data;
+            new_node->left  = NULL;
+            new_node->right = NULL;
+            COPY_PREFIX(new_node, node);
+            MINMAX_APPEND(new_tree, new_node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node ////////////////////////////////////////////////////////
+        node = bs_walker_next(&walker);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stack:
+    bs_walker_free(&walker);
+
+    // The copy is incomplete if the traversal ran out of memory:
+    if (walker.error == YES) {
+        bs_tree_remove_all(new_tree, NULL);
+        free(new_tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return new_tree;
+}
+
+// Inserts data in tree.
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *bs_tree_insert(bs_tree *tree, void *data) {
+
+    bs_node *node;
+    bs_node *new_node;
+    void    *old_data;
+    size_t   depth = 0;
+    int      comp  = 0;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Compute the prefix of data once (see KEY PREFIXES):
+    kp = KEY_PREFIX(tree, data);
+
+    // Avoid the trivial case: empty tree
+    node = NULL;
+    if (tree->root != NULL) {
+
+        // Search for the correct place to insert data:
+        node = tree->root;
+        for (;;) {
+
+            // Compare data:
+            depth++;
+            comp = PREFIX_COMPARE(tree, kp, data, node);
+
+            // Data is smaller:
+            if (comp < 0) {
+                if (node->left == NULL) { break; }
+                else { node = node->left; }
+            }
+
+            // Data is bigger:
+            else if (comp > 0) {
+                if (node->right == NULL) { break; }
+                else { node = node->right; }
+            }
+
+            // Data is already there: overwrite it!
+            else {
+                old_data   = node->data;
+                node->data = data;
+                STATS_SEARCH(tree, depth);
+                return old_data;
+            }
+        }
+    }
+    STATS_SEARCH(tree, depth);
+
+    // Insert the new node here:
+    new_node = new_bs_node(tree);
+    if (new_node == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+    } else {
+        new_node->data  = data;
+        new_node->left  = NULL;
+        new_node->right = NULL;
+        SET_PREFIX(tree, new_node);
+        MINMAX_LINK(tree, node, new_node, comp < 0);
+    }
+
+    if (node == NULL)  { tree->root  = new_node; }
+    else if (comp < 0) { node->left  = new_node; }
+    else               { node->right = new_node; }
+
+    // Count it (and rebuild the scapegoat if it is too deep):
+    if (new_node != NULL) { SCAPEGOAT_INSERT(tree, new_node, depth); }
+
+    // Data was not here!
+    return NULL;
+}
+
+// Inserts "data" such that "data" is smaller or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly bigger than
+//          something already in the tree you will break the tree!
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *bs_tree_insert_min(bs_tree *tree, void *data) {
+
+    bs_node *node;
+    bs_node *new_node;
+    void    *old_data;
+    size_t   depth;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Trivial case:
+    if (tree->root == NULL) { node = NULL; depth = 0; }
+
+    // General case (the smallest node may be cached):
+    else {
+#ifdef TREE_MIN_MAX
+        node  = tree->leftmost;
+        depth = SCAPEGOAT_SPINE(tree, YES);
+#else
+        node  = tree->root;
+        depth = 1;
+        while (node->left != NULL) { node = node->left; depth++; }
+#endif
+
+        // If "data" is already there: overwrite it & return!
+        if (COMPARE(tree, data, node->data) == 0) {
+            old_data   = node->data;
+            node->data = data;
+            return old_data;
+        }
+    }
+
+    // Finally: Insert the new node here
+    new_node = new_bs_node(tree);
+    if (new_node == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+    } else {
+        new_node->data  = data;
+        new_node->left  = NULL;
+        new_node->right = NULL;
+        SET_PREFIX(tree, new_node);
+        MINMAX_LINK(tree, node, new_node, YES);
+    }
+    if (node == NULL) { tree->root = new_node; }
+    else              { node->left = new_node; }
+
+    // Count it (and rebuild the scapegoat if it is too deep):
+    if (new_node != NULL) { SCAPEGOAT_INSERT(tree, new_node, depth); }
+
+    // Data was not here!
+    return NULL;
+}
+
+// Inserts "data" such that "data" is bigger or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly smaller
+//          than something already in the tree you will break the tree!
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *bs_tree_insert_max(bs_tree *tree, void *data) {
+
+    bs_node *node;
+    bs_node *new_node;
+    void    *old_data;
+    size_t   depth;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Trivial case:
+    if (tree->root == NULL) { node = NULL; depth = 0; }
+
+    // General case (the biggest node may be cached):
+    else {
+#ifdef TREE_MIN_MAX
+        node  = tree->rightmost;
+        depth = SCAPEGOAT_SPINE(tree, NO);
+#else
+        node  = tree->root;
+        depth = 1;
+        while (node->right != NULL) { node = node->right; depth++; }
+#endif
+
+        // If "data" is already there: overwrite it & return!
+        if (COMPARE(tree, data, node->data) == 0) {
+            old_data   = node->data;
+            node->data = data;
+            return old_data;
+        }
+    }
+
+    // Finally: Insert the new node here
+    new_node = new_bs_node(tree);
+    if (new_node == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+    } else {
+        new_node->data  = data;
+        new_node->left  = NULL;
+        new_node->right = NULL;
+        SET_PREFIX(tree, new_node);
+        MINMAX_LINK(tree, node, new_node, NO);
+    }
+    if (node == NULL) { tree->root  = new_node; }
+    else              { node->right = new_node; }
+
+    // Count it (and rebuild the scapegoat if it is too deep):
+    if (new_node != NULL) { SCAPEGOAT_INSERT(tree, new_node, depth); }
+
+    // Data was not here!
+    return NULL;
+}
+
+
+
+// SEARCH:
+
+// Returns YES if the tree is empty and NO otherwise.
+//
+int bs_tree_is_empty(const bs_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Check if there is at least 1 node in the tree:
+    if (tree->root == NULL) { return YES; }
+    else                    { return NO;  }
+}
+
+// Finds a node that compares "equal" to data. Returns NULL if not found.
+//
+void *bs_tree_search(const bs_tree *tree, const void *data) {
+
+    bs_node *node;
+    size_t   depth = 0;
+    int      comp;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Compute the prefix of data once (see KEY PREFIXES):
+    kp = KEY_PREFIX(tree, data);
+
+    // Search:
+    node = tree->root;
+    while (node != NULL) {
+        depth++;
+        comp = PREFIX_COMPARE(tree, kp, data, node);  // compare data
+        if      (comp < 0) { node = node->left;  }    // data is smaller
+        else if (comp > 0) { node = node->right; }    // data is bigger
+        else               { break;              }    // found!
+    }
+    STATS_SEARCH(tree, depth);
+
+    // Return the data (or NULL if not found):
+    return (node == NULL) ? NULL : node->data;
+}
+
+// Returns a pointer to the smallest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *bs_tree_min(const bs_tree *tree) {
+
+    bs_node *node;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Find the smallest node (unless it is cached)
+#ifdef TREE_MIN_MAX
+    node = tree->leftmost;
+#else
+    node = tree->root;
+    while (node->left != NULL) { node = node->left; }
+#endif
+
+    // Return a pointer to the data:
+    return node->data;
+}
+
+// Returns a pointer to the biggest element stored in "tree".
+// Returns NULL if the tree is empty.
+//
+void *bs_tree_max(const bs_tree *tree) {
+
+    bs_node *node;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Find the biggest node (unless it is cached)
+#ifdef TREE_MIN_MAX
+    node = tree->rightmost;
+#else
+    node = tree->root;
+    while (node->right != NULL) { node = node->right; }
+#endif
+
+    // Return a pointer to the data:
+    return node->data;
+}
+
+// Find the in-order predesor of data in the tree.
+//
+// If data is not in tree returns the biggest element of tree smaller than data.
+// If data is smaller or equal to all elements of tree returns NULL.
+//
+void *bs_tree_prev(const bs_tree *tree, const void *data) {
+
+    bs_node *node;
+    bs_node *pred;
+    int      comp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search:
+    pred = NULL;
+    node = tree->root;
+    while (node != NULL) {
+
+        // Compare data:
+        comp = COMPARE(tree, data, node->data);
+
+        // Data is smaller:
+        if (comp < 0) { node = node->left; }
+
+        // Data is bigger:
+        else if (comp > 0) {
+            pred = node;
+            node = node->right;
+        }
+
+        // We have found the node:
+        else if (node->left != NULL) {
+            pred = node->left;
+            while (pred->right != NULL) { pred = pred->right; }
+            break;
+        } else { break; }
+    }
+
+    // Return predecesor:
+    if (pred == NULL) { return NULL; }
+    return pred->data;
+}
+
+// Find the in-order successor of data in the tree.
+//
+// If data is not in tree returns the smallest element of tree bigger than data.
+// If data is bigger or equal to all elements of tree returns NULL.
+//
+void *bs_tree_next(const bs_tree *tree, const void *data) {
+
+    bs_node *node;
+    bs_node *succ;
+    int      comp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search:
+    succ = NULL;
+    node = tree->root;
+    while (node != NULL) {
+
+        // Compare data:
+        comp = COMPARE(tree, data, node->data);
+
+        // Data is smaller:
+        if (comp < 0) {
+            succ = node;
+            node = node->left;
+        }
+
+        // Data is bigger:
+        else if (comp > 0) { node = node->right; }
+
+        // We have found the node:
+        else if (node->right != NULL) {
+            succ = node->right;
+            while (succ->left != NULL) { succ = succ->left; }
+            break;
+        } else { break; }
+    }
+
+    // Return succesor:
+    if (succ == NULL) { return NULL; }
+    return succ->data;
+}
+
+
+
+// BATCHES:
+
+// A finger remembers the path from the root to the last node visited and the
+// upper bound of the subtree of every node of the path (the data of its
+// nearest ancestor whose left subtree contains it, or NULL if there is none).
+// Since the batch functions visit the elements in increasing order, the next
+// search only has to climb until the data falls inside the subtree of the
+// last node of the path and go down from there.
+
+typedef struct bs_step {
+    bs_node    *node;   // Node of the path
+    const void *bound;  // Upper bound of its subtree (NULL if none)
+} bs_step;
+
+typedef struct bs_finger {
+    bs_step *path;                      // Path from the root
+    size_t   size;                      // Length of the path (0 = restart)
+    size_t   capacity;                  // Allocated length of the path
+    int      lost;                      // YES if the path could not grow
+    bs_step  buffer[BS_WALKER_BUFFER];  // Initial storage for the path
+} bs_finger;
+
+// This is an auxiliary function that appends node to the path of finger.
+// If out of memory, the finger gets lost and the next search will start
+// from the root again.
+//
+static void bs_finger_push(bs_finger *finger, bs_node *node,
+                           const void *bound) {
+
+    bs_step *path;
+
+    // Nothing to do if the finger is lost:
+    if (finger->lost == YES) { return; }
+
+    // Grow the path if it is full:
+    if (finger->size == finger->capacity) {
+        if (finger->path == finger->buffer) {
+            path = (bs_step *) malloc(2 * finger->capacity * sizeof(bs_step));
+            if (path != NULL) {
+                memcpy(path, finger->buffer,
+                       finger->capacity * sizeof(bs_step));
+            }
+        } else {
+            path = (bs_step *) realloc(finger->path, 2 * finger->capacity *
+                                       sizeof(bs_step));
+        }
+        if (path == NULL) {
+            fprintf(stderr, "ERROR: Unable to grow bs_finger\n");
+            finger->lost = YES;
+            return;
+        }
+        finger->path      = path;
+        finger->capacity *= 2;
+    }
+
+    finger->path[finger->size].node  = node;
+    finger->path[finger->size].bound = bound;
+    finger->size++;
+}
+
+// This is an auxiliary function that searches data starting from the last
+// node of the path of finger. Data must not be smaller than any data
+// searched before with the same finger.
+//
+// Returns the node that compares "equal" to data (with 0 in "comp") or the
+// node where data should be inserted (with the side in "comp"), or NULL if
+// the tree is empty.
+//
+static bs_node *bs_finger_seek(bs_finger *finger, const bs_tree *tree,
+                               const void *data, int *comp) {
+
+    bs_node    *node;
+    const void *bound;
+
+    // Start from the root if the finger got lost:
+    if (finger->lost == YES) {
+        finger->lost = NO;
+        finger->size = 0;
+    }
+
+    // Climb until data is inside the subtree of the last node:
+    while (finger->size > 0) {
+        bound = finger->path[finger->size - 1].bound;
+        if (bound == NULL || COMPARE(tree, data, bound) < 0) { break; }
+        while (finger->size > 0 &&
+               finger->path[finger->size - 1].bound == bound) {
+            finger->size--;
+        }
+    }
+
+    // Trivial case: empty tree
+    if (finger->size == 0) {
+        if (tree->root == NULL) { return NULL; }
+        bs_finger_push(finger, tree->root, NULL);
+        node  = tree->root;
+        bound = NULL;
+    } else {
+        node  = finger->path[finger->size - 1].node;
+        bound = finger->path[finger->size - 1].bound;
+    }
+
+    // Go down from there:
+    for (;;) {
+        *comp = COMPARE(tree, data, node->data);
+        if (*comp < 0 && node->left != NULL) {
+            bound = node->data;
+            node  = node->left;
+        } else if (*comp > 0 && node->right != NULL) {
+            node  = node->right;
+        } else {
+            return node;
+        }
+        bs_finger_push(finger, node, bound);
+    }
+}
+
+// Releases the memory used by the path of finger (if any).
+//
+static void bs_finger_free(bs_finger *finger) {
+    if (finger->path != finger->buffer) { free(finger->path); }
+}
+
+// Inserts the n elements of data in tree.
+//
+// It works as if "bs_tree_insert" were called for every element of data (in
+// the same order), storing its result back in data: data[i] will be NULL or
+// a pointer to the previously stored element that data[i] has replaced (so
+// you can free it).
+//
+// The elements are inserted in increasing order, so the search of each one
+// starts where the previous one ended instead of at the root.
+//
+void bs_tree_insert_batch(bs_tree *tree, void **data, size_t n) {
+
+    bs_finger  finger;
+    bs_node   *node;
+    bs_node   *new_node;
+    size_t    *order;
+    void      *old_data;
+    size_t     i;
+    int        comp = 0;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL || n == 0);
+
+    // Trivial case: empty batch
+    if (n == 0) { return; }
+
+    // Sort the batch (or insert it as is if out of memory):
+    order = sort_batch(tree->comp, (const void **) data, n);
+    if (order == NULL) {
+        for (i = 0; i < n; i++) { data[i] = bs_tree_insert(tree, data[i]); }
+        return;
+    }
+
+    // Insert the elements in increasing order:
+    finger.path     = finger.buffer;
+    finger.size     = 0;
+    finger.capacity = BS_WALKER_BUFFER;
+    finger.lost     = NO;
+    for (i = 0; i < n; i++) {
+
+        // Sanity Check:
+        assert(data[order[i]] != NULL);
+
+        // Search for the correct place to insert data:
+        node = bs_finger_seek(&finger, tree, data[order[i]], &comp);
+
+        // Data is already there: overwrite it!
+        if (node != NULL && comp == 0) {
+            old_data       = node->data;
+            node->data     = data[order[i]];
+            data[order[i]] = old_data;
+            continue;
+        }
+
+        // Insert the new node here:
+        new_node = new_bs_node(tree);
+        if (new_node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            data[order[i]] = NULL;
+            continue;
+        }
+        new_node->data  = data[order[i]];
+        new_node->left  = NULL;
+        new_node->right = NULL;
+        data[order[i]]  = NULL;
+        SET_PREFIX(tree, new_node);
+        MINMAX_LINK(tree, node, new_node, comp < 0);
+
+        if (node == NULL) {
+            tree->root = new_node;
+            bs_finger_push(&finger, new_node, NULL);
+        } else if (comp < 0) {
+            node->left = new_node;
+            bs_finger_push(&finger, new_node, node->data);
+        } else {
+            node->right = new_node;
+            bs_finger_push(&finger, new_node,
+                           finger.path[finger.size - 1].bound);
+        }
+
+#ifdef BS_SCAPEGOAT
+        // Count it (and start from the root again if the tree is rebuilt):
+        if (bs_scapegoat_insert(tree, new_node, (finger.lost == YES) ? 0 :
+                                finger.size - 1) == YES) {
+            finger.size = 0;
+        }
+#endif
+    }
+
+    bs_finger_free(&finger);
+    free(order);
+}
+
+// Searches the n elements of keys in tree. Stores in out[i] the element that
+// compares "equal" to keys[i] (or NULL if not found).
+//
+// The keys are searched in increasing order, so the search of each one
+// starts where the previous one ended instead of at the root.
+//
+void bs_tree_search_batch(const bs_tree *tree, const void **keys, void **out,
+                          size_t n) {
+
+    bs_finger  finger;
+    bs_node   *node;
+    size_t    *order;
+    size_t     i;
+    int        comp = 0;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert((keys != NULL && out != NULL) || n == 0);
+
+    // Trivial case: empty batch
+    if (n == 0) { return; }
+
+    // Sort the batch (or search it as is if out of memory):
+    order = sort_batch(tree->comp, keys, n);
+    if (order == NULL) {
+        for (i = 0; i < n; i++) { out[i] = bs_tree_search(tree, keys[i]); }
+        return;
+    }
+
+    // Search the keys in increasing order:
+    finger.path     = finger.buffer;
+    finger.size     = 0;
+    finger.capacity = BS_WALKER_BUFFER;
+    finger.lost     = NO;
+    for (i = 0; i < n; i++) {
+        assert(keys[order[i]] != NULL);
+        node = bs_finger_seek(&finger, tree, keys[order[i]], &comp);
+        if (node != NULL && comp == 0) { out[order[i]] = node->data; }
+        else                           { out[order[i]] = NULL;       }
+    }
+
+    bs_finger_free(&finger);
+    free(order);
+}
+
+// Searches the n elements of keys in tree. Stores in out[i] the element that
+// compares "equal" to keys[i] (or NULL if not found).
+//
+// On trees much bigger than the cache every step of a search is a cache miss,
+// so this function keeps BATCH_GROUP searches in flight: each step of a search
+// prefetches the next node (or its data) and then switches to the next search
+// instead of waiting for it. Unlike "bs_tree_search_batch", the keys do not
+// need to be sorted and are not compared between them.
+//
+void bs_tree_search_interleaved(const bs_tree *tree, const void **keys,
+                                void **out, size_t n) {
+
+    const bs_node *node[BATCH_GROUP];   // Current node of each search
+    size_t         key[BATCH_GROUP];    // Position of the key of each search
+    int            ready[BATCH_GROUP];  // YES if the data of node is prefetched
+    const bs_node *child;
+    size_t         size;
+    size_t         next;
+    size_t         i;
+    int            comp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert((keys != NULL && out != NULL) || n == 0);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) {
+        for (i = 0; i < n; i++) { out[i] = NULL; }
+        return;
+    }
+
+    // Start the first searches:
+    for (size = 0; size < BATCH_GROUP && size < n; size++) {
+        node[size]  = tree->root;
+        key[size]   = size;
+        ready[size] = NO;
+    }
+    next = size;
+
+    // Advance every search one step at a time:
+    while (size > 0) {
+        for (i = 0; i < size; i++) {
+
+            // First step: prefetch the data of the node
+            if (ready[i] == NO) {
+                BATCH_PREFETCH(node[i]->data);
+                ready[i] = YES;
+                continue;
+            }
+
+            // Second step: compare it and prefetch the next node
+            comp = COMPARE(tree, keys[key[i]], node[i]->data);
+            if      (comp < 0) { child = node[i]->left;  }
+            else if (comp > 0) { child = node[i]->right; }
+            else               { child = NULL;           }
+            if (child != NULL) {
+                BATCH_PREFETCH(child);
+                node[i]  = child;
+                ready[i] = NO;
+                continue;
+            }
+
+            // The search is over:
+            if (comp == 0) { out[key[i]] = node[i]->data; }
+            else           { out[key[i]] = NULL;          }
+
+            // Start a new search (or drop the last one here):
+            if (next < n) {
+                node[i]  = tree->root;
+                key[i]   = next;
+                ready[i] = NO;
+                next++;
+            } else {
+                size--;
+                node[i]  = node[size];
+                key[i]   = key[size];
+                ready[i] = ready[size];
+            }
+        }
+    }
+}
+
+
+
+// CURSORS:
+
+// A cursor stores the whole path from the root of the tree to its current
+// node, so it can move to the in-order successor or predecessor without
+// restarting from the root and without modifying the tree. Each edge of the
+// tree is followed at most twice during a full traversal, so each call to
+// "bs_cursor_next" or "bs_cursor_prev" takes O(1) amortized time.
+//
+// Any insertion or removal in the tree invalidates all its cursors (you must
+// call "bs_cursor_first", "bs_cursor_last" or "bs_cursor_seek" again).
+
+#define BS_CURSOR_CAPACITY 64   // Initial length of the path of a cursor
+
+// Creates a new cursor over tree. The cursor does not point to any node until
+// you call "bs_cursor_first", "bs_cursor_last" or "bs_cursor_seek".
+// Returns NULL if out of memory.
+//
+bs_cursor *new_bs_cursor(const bs_tree *tree) {
+
+    bs_cursor *cursor;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Allocate the cursor and its path:
+    cursor = (bs_cursor *) malloc(sizeof(bs_cursor));
+    if (cursor == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate bs_cursor\n");
+        return NULL;
+    }
+    cursor->path = (bs_node **) malloc(BS_CURSOR_CAPACITY * sizeof(bs_node *));
+    if (cursor->path == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate bs_cursor\n");
+        free(cursor);
+        return NULL;
+    }
+
+    // Initialize it:
+    cursor->tree     = tree;
+    cursor->size     = 0;
+    cursor->capacity = BS_CURSOR_CAPACITY;
+    return cursor;
+}
+
+// Releases all the memory used by cursor (but not the tree).
+//
+void free_bs_cursor(bs_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Free the path and the cursor:
+    free(cursor->path);
+    free(cursor);
+}
+
+// This is an auxiliary function that appends node to the path of cursor,
+// doubling the capacity of the path if needed. Returns NO if out of memory.
+//
+static int bs_cursor_push(bs_cursor *cursor, bs_node *node) {
+
+    bs_node **path;
+
+    // Grow the path if it is full:
+    if (cursor->size == cursor->capacity) {
+        path = (bs_node **) realloc(cursor->path,
+                                    2 * cursor->capacity * sizeof(bs_node *));
+        if (path == NULL) {
+            fprintf(stderr, "ERROR: Unable to grow bs_cursor\n");
+            return NO;
+        }
+        cursor->path      = path;
+        cursor->capacity *= 2;
+    }
+
+    // Append node:
+    cursor->path[cursor->size] = node;
+    cursor->size++;
+    return YES;
+}
+
+// This is an auxiliary function that appends node and all its leftmost
+// descendants to the path of cursor and returns the data of the last one.
+// If out of memory, it invalidates the cursor and returns NULL.
+//
+static void *bs_cursor_push_left(bs_cursor *cursor, bs_node *node) {
+
+    while (node != NULL) {
+        if (bs_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        node = node->left;
+    }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// This is an auxiliary function that appends node and all its rightmost
+// descendants to the path of cursor and returns the data of the last one.
+// If out of memory, it invalidates the cursor and returns NULL.
+//
+static void *bs_cursor_push_right(bs_cursor *cursor, bs_node *node) {
+
+    while (node != NULL) {
+        if (bs_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        node = node->right;
+    }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Moves cursor to the smallest element of its tree and returns it.
+// Returns NULL if the tree is empty.
+//
+void *bs_cursor_first(bs_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Restart the path from the root:
+    cursor->size = 0;
+    if (cursor->tree->root == NULL) { return NULL; }
+    return bs_cursor_push_left(cursor, cursor->tree->root);
+}
+
+// Moves cursor to the biggest element of its tree and returns it.
+// Returns NULL if the tree is empty.
+//
+void *bs_cursor_last(bs_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Restart the path from the root:
+    cursor->size = 0;
+    if (cursor->tree->root == NULL) { return NULL; }
+    return bs_cursor_push_right(cursor, cursor->tree->root);
+}
+
+// Moves cursor to the smallest element of its tree that is bigger or equal
+// to data and returns it. Returns NULL if there is no such element.
+//
+// Use it to start range scans: "bs_cursor_seek(cursor, lo)" followed by calls
+// to "bs_cursor_next" until you reach an element bigger than your upper bound.
+//
+void *bs_cursor_seek(bs_cursor *cursor, const void *data) {
+
+    bs_node *node;
+    size_t   best;
+    int      comp;
+
+    // Sanity Checks:
+    assert(cursor != NULL);
+    assert(data   != NULL);
+
+    // Search for data storing the path. The answer is the last node of the
+    // path where we turned left (or the node that compares "equal" to data):
+    cursor->size = 0;
+    best         = 0;
+    node         = cursor->tree->root;
+    while (node != NULL) {
+        if (bs_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        comp = COMPARE(cursor->tree, data, node->data);
+        if      (comp < 0) { best = cursor->size; node = node->left;  }
+        else if (comp > 0) {                      node = node->right; }
+        else               { best = cursor->size; break;              }
+    }
+
+    // Cut the path just after the answer (if any):
+    cursor->size = best;
+    if (best == 0) { return NULL; }
+    return cursor->path[best - 1]->data;
+}
+
+// Moves cursor to the in-order successor of its current element and returns
+// it. Returns NULL (and invalidates the cursor) if there is no such element.
+//
+void *bs_cursor_next(bs_cursor *cursor) {
+
+    bs_node *node;
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Trivial case: invalid cursor
+    if (cursor->size == 0) { return NULL; }
+
+    // If the current node has a right subtree, go to its smallest node:
+    node = cursor->path[cursor->size - 1];
+    if (node->right != NULL) {
+        return bs_cursor_push_left(cursor, node->right);
+    }
+
+    // Otherwise, climb until we leave a left subtree:
+    do {
+        cursor->size--;
+        node = cursor->path[cursor->size];
+    } while (cursor->size > 0 && cursor->path[cursor->size - 1]->right == node);
+
+    // Return the data of the new current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Moves cursor to the in-order predecessor of its current element and returns
+// it. Returns NULL (and invalidates the cursor) if there is no such element.
+//
+void *bs_cursor_prev(bs_cursor *cursor) {
+
+    bs_node *node;
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Trivial case: invalid cursor
+    if (cursor->size == 0) { return NULL; }
+
+    // If the current node has a left subtree, go to its biggest node:
+    node = cursor->path[cursor->size - 1];
+    if (node->left != NULL) {
+        return bs_cursor_push_right(cursor, node->left);
+    }
+
+    // Otherwise, climb until we leave a right subtree:
+    do {
+        cursor->size--;
+        node = cursor->path[cursor->size];
+    } while (cursor->size > 0 && cursor->path[cursor->size - 1]->left == node);
+
+    // Return the data of the new current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Returns the current element of cursor (or NULL if the cursor is invalid).
+//
+void *bs_cursor_get(const bs_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Return the data of the current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+
+
+// REMOVE:
+
+// Removes a node of tree that compares "equal" to data and returns a pointer
+// to the previously stored data (so you can free it).
+// If such a node is not found, it returns a NULL pointer.
+//
+// Uses the trick of swapping node->data and successor->data pointers and then
+// removes successor. This is safe because the final user has no acces to any
+// tree node (only "tree" and "data" pointers are used in all interfaces) and
+// any removal invalidates all the cursors of the tree anyway.
+//
+void *bs_tree_remove(bs_tree *tree, const void *data) {
+
+    bs_node *parent;
+    bs_node *node;
+    bs_node *old_node;
+    void    *old_data;
+    size_t   depth = 0;
+    int      comp;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Compute the prefix of data once (see KEY PREFIXES):
+    kp = KEY_PREFIX(tree, data);
+
+    // Search the node to delete:
+    parent   = NULL;
+    node     = tree->root;
+    while (node != NULL) {
+
+        // Compare data:
+        depth++;
+        comp = PREFIX_COMPARE(tree, kp, data, node);
+
+        // Data is smaller:
+        if (comp < 0) {
+            parent = node;
+            node   = node->left;
+        }
+
+        // Data is bigger:
+        else if (comp > 0) {
+            parent = node;
+            node   = node->right;
+        }
+
+        // We have found the node:
+        else {
+
+            old_data = node->data;
+            STATS_SEARCH(tree, depth);
+
+            // If node has both subtrees we must do some extra work:
+            if (node->left != NULL && node->right != NULL) {
+
+                // Remember the place and keep going down to find the successor
+                old_node = node;                // Here we are looking for the
+                parent   = node;                // inorder successor of node
+                node     = node->right;         // but if we exchange left for
+                while (node->left != NULL) {    // right (and viceversa) on
+                    parent = node;              // thisblock of code we could
+                    node   = node->left;        // implement the equaly valid
+                }                               // predecesor version of remove
+
+                // Once we find the "succesor" of "old_node"
+                // we just move the data pointer and remove
+                // the current "node":
+                old_node->data = node->data;
+                COPY_PREFIX(old_node, node);
+            }
+
+            // At this point we are sure that "node" has, at least,
+            // one empty subtree, which greatly simplifies the removal:
+
+            // Easy case 1: node->left is NULL
+            if (node->left == NULL) {
+                if      (parent       == NULL) { tree->root    = node->right; }
+                else if (parent->left == node) { parent->left  = node->right; }
+                else                           { parent->right = node->right; }
+                free_bs_node(tree, node);
+                bs_fix_min_max(tree);
+                SCAPEGOAT_REMOVE(tree);
+                return old_data;
+            }
+
+            // Easy case 2: node->right is NULL
+            else {
+                if      (parent       == NULL) { tree->root    = node->left; }
+                else if (parent->left == node) { parent->left  = node->left; }
+                else                           { parent->right = node->left; }
+                free_bs_node(tree, node);
+                bs_fix_min_max(tree);
+                SCAPEGOAT_REMOVE(tree);
+                return old_data;
+            }
+        }
+    }
+    STATS_SEARCH(tree, depth);
+    return NULL;
+}
+
+// Removes the smallest element from "tree" and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+// More efficient than "tree_remove(tree, min_elem)" even if you already know
+// the value of "min_elem".
+//
+void *bs_tree_remove_min(bs_tree *tree) {
+
+    bs_node *node;
+    bs_node *parent;
+    void    *old_data;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Avoid trivial case: empty tree
+    old_data = NULL;
+    if (tree->root != NULL) {
+
+        // General case: Find the smallest node
+        parent = NULL;
+        node   = tree->root;
+        while (node->left != NULL) {
+            parent = node;
+            node   = node->left;
+        }
+        old_data = node->data;
+
+        // Remove Node:
+        if (parent != NULL) { parent->left = node->right; }
+        else                { tree->root   = node->right; }
+        free_bs_node(tree, node);
+        bs_fix_min_max(tree);
+        SCAPEGOAT_REMOVE(tree);
+    }
+    return old_data;
+}
+
+// Removes the biggest element from "tree" and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+// More efficient than "tree_remove(tree, max_data)" even if you already know
+// the value of "max_data".
+//
+void *bs_tree_remove_max(bs_tree *tree) {
+
+    bs_node *node;
+    bs_node *parent;
+    void        *old_data;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Avoid trivial case: empty tree
+    old_data = NULL;
+    if (tree->root != NULL) {
+
+        // General case: Find the biggest node
+        parent = NULL;
+        node   = tree->root;
+        while (node->right != NULL) {
+            parent = node;
+            node   = node->right;
+        }
+        old_data = node->data;
+
+        // Remove Node:
+        if (parent != NULL) { parent->right = node->left; }
+        else                { tree->root    = node->left; }
+        free_bs_node(tree, node);
+        bs_fix_min_max(tree);
+        SCAPEGOAT_REMOVE(tree);
+    }
+    return old_data;
+}
+
+// Removes all the elements from the tree in linear time. This is faster than
+// calling "tree_remove_min(tree)" until "tree_is_empty(tree)" returns "YES".
+//
+// If you provide a "free_data" function it will be used to free the "data"
+// inside each node. If "free_data" is NULL, no "data" will be freed. Use this
+// later option when "data" is shared between several data structures but be
+// aware that this may cause some memory leaks if you are not carefull.
+//
+// Most of the time, you can use just "free" as "free_data" function.
+// However if your "data" struct contains dinamically allocated data
+// you may need to provide a more complex "free_data" function like:
+//
+//  void free_data(void *ptr) {
+//      MyData *data = (MyData *) ptr;
+//      free(data->some_array);
+//      free(data->some_other_array);
+//      free(data);
+//  }
+//
+void bs_tree_remove_all(bs_tree *tree, void (* free_data) (void *)) {
+
+    bs_node *root;
+    bs_node *left;
+    bs_node *right;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Initialize:
+    root = tree->root;
+    tree->root = NULL;
+    MINMAX_CLEAR(tree);
+    SCAPEGOAT_CLEAR(tree);
+
+    // Pooled nodes are freed slab by slab, so only visit them to free data:
+    if (tree->pool != NULL && free_data == NULL) { root = NULL; }
+
+    // While the tree is not empty:
+    while (root != NULL) {
+
+        // Unravel the tree: Rotate right "root" & "left"
+        if (root->left != NULL) {
+            left        = root->left;
+            right       = left->right;
+            left->right = root;
+            root->left  = right;
+            root        = left;
+
+        // Erase the current "root" node:
+        } else {
+            right = root->right;
+            if (free_data != NULL) { free_data(root->data); }
+            if (tree->pool == NULL) { free(root); }
+            root = right;
+        }
+    }
+
+    // Release all the slabs of the pool at once:
+    if (tree->pool != NULL) { node_pool_clear(tree->pool); }
+}
+
+
+
+// SET FUNCTIONS:
+
+// Returns a (really degenerated) binary tree containing a copy of the union of
+// tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
+//
+// If a given "element" is in both trees it takes the pointer from tree_1.
+// Likewise, the new tree stores a pointer to the comparing function of tree_1.
+//
+// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
+//
+//      bs_tree_rebalance(tree);
+//
+// afterwards "for free", but I prefer to return the degenerate tree because
+// it will speed up a little bit future aplications of other "set functions".
+// Please, take a moment to decide if you want to post-process the tree with
+// a total rebalance operation.
+//
+bs_tree *bs_tree_union(const bs_tree *tree_1, const bs_tree *tree_2) {
+
+    bs_tree   *tree = NULL;
+    bs_node   *node = NULL;
+    bs_walker  walker_1;
+    bs_node   *node_1;
+    bs_walker  walker_2;
+    bs_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return bs_tree_copy(tree_1); }
+
+    // Create a new tree:
+    tree = new_bs_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_bs_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_bs_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // insert node_2->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_bs_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_bs_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_2->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_bs_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_bs_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_bs_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_bs_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_1->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = bs_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Insert all remaining data from tree_2:
+    while (node_2 != NULL) {
+
+        // insert node_2->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_bs_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_bs_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_2->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_2 //////////////////////////////////////////////////////
+        node_2 = bs_walker_next(&walker_2);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        bs_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a (really degenerated) binary tree containing a copy of the
+// intersection of tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
+//
+// The comparing function and all data pointers are taken from tree_1.
+//
+// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
+//
+//      bs_tree_rebalance(tree);
+//
+// afterwards "for free", but I prefer to return the degenerate tree because
+// it will speed up a little bit future aplications of other "set functions".
+// Please, take a moment to decide if you want to post-process the tree with
+// a total rebalance operation.
+//
+bs_tree *bs_tree_intersection(const bs_tree *tree_1, const bs_tree *tree_2) {
+
+    bs_tree   *tree = NULL;
+    bs_node   *node = NULL;
+    bs_walker  walker_1;
+    bs_node   *node_1;
+    bs_walker  walker_2;
+    bs_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return bs_tree_copy(tree_1); }
+
+    // Create a new tree:
+    tree = new_bs_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Some of them is empty
+    if (bs_tree_is_empty(tree_1) == YES) { return tree; }
+    if (bs_tree_is_empty(tree_2) == YES) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_bs_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_bs_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        bs_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a (really degenerated) binary tree containing a copy of the
+// difference: tree_1 - tree_2. It does NOT modify tree_1 or tree_2.
+//
+// The comparing function and all data pointers are taken from tree_1.
+//
+// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
+//
+//      bs_tree_rebalance(tree);
+//
+// afterwards "for free", but I prefer to return the degenerate tree because
+// it will speed up a little bit future aplications of other "set functions".
+// Please, take a moment to decide if you want to post-process the tree with
+// a total rebalance operation.
+//
+bs_tree *bs_tree_diff(const bs_tree *tree_1, const bs_tree *tree_2) {
+
+    bs_tree   *tree = NULL;
+    bs_node   *node = NULL;
+    bs_walker  walker_1;
+    bs_node   *node_1;
+    bs_walker  walker_2;
+    bs_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Create a new tree:
+    tree = new_bs_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return tree; }
+
+    // Special case: Some of them is empty
+    if (bs_tree_is_empty(tree_1) == YES) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_bs_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_bs_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_bs_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_bs_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_1->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = bs_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        bs_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a (really degenerated) binary tree containing a copy of the symmetric
+// difference of tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
+//
+// The comparing function is taken from tree_1.
+//
+// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
+//
+//      bs_tree_rebalance(tree);
+//
+// afterwards "for free", but I prefer to return the degenerate tree because
+// it will speed up a little bit future aplications of other "set functions".
+// Please, take a moment to decide if you want to post-process the tree with
+// a total rebalance operation.
+//
+bs_tree *bs_tree_sym_diff(const bs_tree *tree_1, const bs_tree *tree_2) {
+
+    bs_tree   *tree = NULL;
+    bs_node   *node = NULL;
+    bs_walker  walker_1;
+    bs_node   *node_1;
+    bs_walker  walker_2;
+    bs_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Create a new tree:
+    tree = new_bs_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_bs_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_bs_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // insert node_2->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_bs_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_bs_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_2->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_bs_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_bs_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_1->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = bs_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Insert all remaining data from tree_2:
+    while (node_2 != NULL) {
+
+        // insert node_2->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_bs_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_bs_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_2->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_2 //////////////////////////////////////////////////////
+        node_2 = bs_walker_next(&walker_2);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        bs_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+
+
+// REBALANCE OPERATIONS:
+
+// Transforms any bs_tree in a highly degenerated bs_tree where tree->root
+// points to the smallest element and all nodes have no left sub-tree.
+//
+// In general it is a really BAD idea to work with highly degenerated trees but
+// I provide this tree_to_list method because it may be useful.
+//
+void bs_tree_to_list(bs_tree *tree) {
+
+    bs_node *node;
+    bs_node *left;
+    bs_node *right;
+    bs_node *parent;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Avoid trivial case: empty tree
+    if (tree->root != NULL) {
+
+        node = tree->root;
+
+        // Unravel the left side of root:
+        while (node->left != NULL) {
+
+            // Rotate right:
+            left        = node->left;
+            right       = left->right;
+            left->right = node;
+            node->left  = right;
+
+            // Move to the new root:
+            node = left;
+        }
+
+        // Fix the root:
+        tree->root = node;
+        parent     = NULL;
+
+        // Unravel the rest of the tree:
+        while (node != NULL) {
+
+            if (node->left != NULL) {
+
+                // Rotate right:
+                left          = node->left;
+                right         = left->right;
+                left->right   = node;
+                node->left    = right;
+                parent->right = left;
+
+                // Move up:
+                node = left;
+
+            } else {
+
+                // Move down:
+                parent = node;
+                node   = node->right;
+            }
+        }
+    }
+}
+
+// Transforms any bs_tree in a highly degenerated bs_tree where tree->root
+// points to the biggest element and all nodes have no right sub-tree.
+//
+// In general it is a really BAD idea to work with highly degenerated trees but
+// I provide this tree_to_reversed_list method because it may be useful.
+//
+void bs_tree_to_reversed_list(bs_tree *tree) {
+
+    bs_node *node;
+    bs_node *left;
+    bs_node *right;
+    bs_node *parent;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Avoid trivial case: empty tree
+    if (tree->root != NULL) {
+
+        node = tree->root;
+
+        // Unravel the right side of root:
+        while (node->right != NULL) {
+
+            // Rotate left:
+            right       = node->right;
+            left        = right->left;
+            right->left = node;
+            node->right = left;
+
+            // Move to the new root:
+            node = right;
+        }
+
+        // Fix the root:
+        tree->root = node;
+        parent     = NULL;
+
+        // Unravel the rest of the tree:
+        while (node != NULL) {
+
+            if (node->right != NULL) {
+
+                // Rotate left:
+                right        = node->right;
+                left         = right->left;
+                right->left  = node;
+                node->right  = left;
+                parent->left = right;
+
+                // Move up:
+                node = right;
+
+            } else {
+
+                // Move down:
+                parent = node;
+                node   = node->left;
+            }
+        }
+    }
+}
+
+// Since classic Binary Search Trees can become quite degenerated it is useful
+// to have a "rebalancing" method to redress them. The Day–Stout–Warren
+// algorithm does exactly this but it requires to count the number of nodes
+// stored on the tree and I want to avoid this.
+//
+// Fortunatelly, applying the Day–Stout–Warren algorithm blindly works quite
+// well and you get a "perfectly" balanced tree (in the sense of ensuring that
+// the resulting tree height will be equal to ceil(log2(N)), which is optimal)
+// in linear time without explicitly counting the number of nodes.
+//
+// As far as I know, this version of Day–Stout–Warren Algorithm is new.
+// This being said, I will be surprised if nobody has implemented this before.
+//
+// You can use this operation to rebalance a binary search tree once you are
+// sure that no further insertions will take place (or that they will be rare).
+// Alternatively, if you have a counter that stores the number of elements of
+// the tree, you can use this function every time the tree doubles in size to
+// get some of the benefits of a balanced tree in O(1) amortized time.
+//
+// If BS_SCAPEGOAT is defined, "bs_tree_set_scapegoat" does exactly that for
+// you, rebuilding only the subtrees that get too deep (see SCAPEGOAT MODE).
+//
+void bs_tree_rebalance(bs_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Rebuild the whole tree:
+    bs_rebuild(&(tree->root));
+}
+
+// Rebalances only the smallest subtree of tree that holds every element
+// between lo and hi (both included), leaving the rest of the tree untouched.
+// Use it to repair a region that has degenerated (e.g. after a burst of
+// sorted insertions) in O(log(|Tree|) + |Subtree|) time instead of O(|Tree|).
+// The subtree is rooted at the first node found between lo and hi while
+// going down from the root, so it is empty if no element is in the range.
+//
+void bs_tree_rebalance_range(bs_tree *tree, const void *lo, const void *hi) {
+
+    bs_node **link;
+    bs_node  *node;
+
+    // Sanity checks:
+    assert(tree != NULL);
+    assert(lo != NULL);
+    assert(hi != NULL);
+
+    // Avoid trivial case: empty range
+    if (COMPARE(tree, lo, hi) > 0) { return; }
+
+    // Go down while the whole range is on the same side:
+    link = &(tree->root);
+    while ((node = *link) != NULL) {
+        if      (COMPARE(tree, hi, node->data) < 0) {
+            link = &(node->left);                       // range is smaller
+        }
+        else if (COMPARE(tree, lo, node->data) > 0) {
+            link = &(node->right);                      // range is bigger
+        }
+        else { break; }                                 // found the split!
+    }
+
+    // Rebuild that subtree:
+    bs_rebuild(link);
+#ifdef BS_SCAPEGOAT
+    if (link == &(tree->root)) { tree->max_size = tree->size; }
+#endif
+}
+
+// Rebalances only the subtree of tree rooted at the node that stores data in
+// O(log(|Tree|) + |Subtree|) time. Nothing happens if data is not in the tree.
+//
+void bs_tree_rebalance_below(bs_tree *tree, const void *data) {
+
+    bs_node **link;
+    bs_node  *node;
+    int       comp;
+    uint64_t  kp;
+
+    // Sanity checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Compute the prefix of data once (see KEY PREFIXES):
+    kp = KEY_PREFIX(tree, data);
+
+    // Search:
+    link = &(tree->root);
+    while ((node = *link) != NULL) {
+        comp = PREFIX_COMPARE(tree, kp, data, node);  // compare data
+        if      (comp < 0) { link = &(node->left);  } // data is smaller
+        else if (comp > 0) { link = &(node->right); } // data is bigger
+        else               { break;                 } // found!
+    }
+
+    // Rebuild that subtree:
+    bs_rebuild(link);
+#ifdef BS_SCAPEGOAT
+    if (link == &(tree->root)) { tree->max_size = tree->size; }
+#endif
+}
+
+
+// KEY PREFIXES:
+
+#ifdef TREE_KEY_PREFIX
+
+// Sets the prefix function of tree (see "KEY PREFIXES" in the header) or goes
+// back to plain comparisons if prefix is NULL. Since every node computes its
+// prefix when it is created, the tree must still be empty.
+//
+void bs_tree_set_prefix(bs_tree *tree, uint64_t (* prefix) (const void *)) {
+
+    // Sanity checks:
+    assert(tree != NULL);
+    assert(tree->root == NULL);
+
+    // The nodes already in the tree would keep their old prefixes:
+    if (tree->root != NULL) {
+        fprintf(stderr, "ERROR: bs_tree must be empty to set its prefix\n");
+        return;
+    }
+
+    tree->prefix = prefix;
+}
+
+#endif
+
+
+
+// SCAPEGOAT MODE:
+
+#ifdef BS_SCAPEGOAT
+
+// Turns the scapegoat mode of tree on (see SCAPEGOAT MODE in the header) with
+// the given alpha (0.5 < alpha < 1), or off if alpha is 0. Turning it on
+// counts the nodes and rebalances the whole tree, so it takes O(|Tree|) time.
+//
+void bs_tree_set_scapegoat(bs_tree *tree, double alpha) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Check alpha (NaN fails every comparison):
+    if (alpha != 0.0 && !(alpha > 0.5 && alpha < 1.0)) {
+        fprintf(stderr, "ERROR: Invalid alpha for bs_tree\n");
+        return;
+    }
+
+    // Turn it off:
+    tree->alpha = alpha;
+    if (alpha == 0.0) {
+        SCAPEGOAT_CLEAR(tree);
+        return;
+    }
+
+    // Turn it on (starting from a balanced tree):
+    tree->size     = bs_subtree_size(tree->root);
+    tree->max_size = tree->size;
+    bs_rebuild(&(tree->root));
+}
+
+#endif
+
+// STATISTICS:
+
+#ifdef TREE_STATS
+
+// Returns a copy of the counters of tree (see "tree_stats" in the header).
+//
+tree_stats bs_tree_get_stats(const bs_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    return tree->stats;
+}
+
+// Sets all the counters of tree to zero.
+//
+void bs_tree_reset_stats(bs_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    STATS_RESET(tree);
+}
+
+#endif
+
+
+
+// DEBUG & VISUALIZATION:
+
+// This is an auxiliary function to check the symmetric order property
+// recursively. You should not use it directly, use "is_bs_tree" instead.
+//
+// Note that, unlike other functions of this library, it is safe to use
+// recursive definitions here since they will only be used to test the
+// code while debugging this library.
+//
+static int is_bs_subtree(const bs_tree *tree, const bs_node *node,
+                         const void *min, const void *max) {
+
+    // Make sure that node is (strictly) between specified limits:
+    if (min != NULL && COMPARE(tree, min, node->data) >= 0) {
+        fprintf(stderr,"ERROR: Symmetric order not satisfied in bs_tree\n");
+        return NO;
+    }
+    if (max != NULL && COMPARE(tree, node->data, max) >= 0) {
+        fprintf(stderr,"ERROR: Symmetric order not satisfied in bs_tree\n");
+        return NO;
+    }
+
+#ifdef TREE_KEY_PREFIX
+    // Check the cached prefix of node:
+    if (node->prefix != KEY_PREFIX(tree, node->data)) {
+        fprintf(stderr,"ERROR: Wrong key prefix in bs_tree\n");
+        return NO;
+    }
+#endif
+
+    // Check recursively the left subtree of node:
+    if (node->left != NULL) {
+        if (is_bs_subtree(tree, node->left, min, node->data) == NO) {
+            return NO;
+        }
+    }
+
+    // Check recursively the right subtree of node:
+    if (node->right != NULL) {
+        if (is_bs_subtree(tree, node->right, node->data, max) == NO) {
+            return NO;
+        }
+    }
+
+    // All test are fine:
+    return YES;
+}
+
+// This is an auxiliary function to check the symmetric order property of a
+// binary tree. Returns YES if everything is correct and NO otherwise.
+//
+// This function should not be used in production code. I recommend to use:
+//
+//      assert(is_bs_tree(tree) == YES);
+//
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
+//
+int is_bs_tree(const bs_tree *tree) {
+
+#ifdef TREE_MIN_MAX
+    const bs_node *node;
+#endif
+
+    // Basic Sanity Checks:
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to bs_tree\n");
+        return NO;
+    }
+    if (tree->comp == NULL) {
+        fprintf(stderr, "ERROR: NULL comparing function in bs_tree\n");
+        return NO;
+    }
+
+#ifdef TREE_MIN_MAX
+    // Check the cached leftmost & rightmost nodes (see MIN & MAX NODES):
+    node = tree->root;
+    while (node != NULL && node->left != NULL) { node = node->left; }
+    if (tree->leftmost != node) {
+        fprintf(stderr, "ERROR: Wrong leftmost node in bs_tree\n");
+        return NO;
+    }
+    node = tree->root;
+    while (node != NULL && node->right != NULL) { node = node->right; }
+    if (tree->rightmost != node) {
+        fprintf(stderr, "ERROR: Wrong rightmost node in bs_tree\n");
+        return NO;
+    }
+#endif
+
+#ifdef BS_SCAPEGOAT
+    // Check the node count (see SCAPEGOAT MODE):
+    if (tree->alpha != 0.0 && (bs_subtree_size(tree->root) != tree->size ||
+                               tree->size > tree->max_size)) {
+        fprintf(stderr, "ERROR: Wrong node count in bs_tree\n");
+        return NO;
+    }
+#endif
+
+    // Trivial Case: empty tree
+    if (tree->root == NULL) { return YES; }
+
+    // General Case:
+    return is_bs_subtree(tree, tree->root, NULL, NULL);
+}
+
+// This is an auxiliary function to print the tree recursively.
+// You should not use it directly, use "print_bs_tree" instead.
+//
+// Note that, unlike the rest of the functions of this library, it is safe
+// to use recursive definitions here since any tree large enough to hit the
+// recursion limit will be too big to be printed anyway.
+//
+static void print_bs_subtree(const bs_node *node, const int is_right,
+                             char *indent, void (* print_node) (const void *)) {
+
+    // Allocate memory:
+    char *new_indent = (char *) malloc((6+strlen(indent)*sizeof(char)));
+    assert(new_indent != NULL);
+
+    // Print right subtree recursively:
+    if (node->right != NULL) {
+        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
+        else                 { sprintf(new_indent, "%s%s", indent, "|     "); }
+        print_bs_subtree(node->right, YES, new_indent, print_node);
+    }
+
+    // Print current node:
+    if (is_right) { fprintf(stdout, "%s,----",indent); }
+    else          { fprintf(stdout, "%s`----",indent); }
+    if (print_node == NULL)  { fprintf(stdout, "(#)"); }
+    else                     { print_node(node->data); }
+    printf("\n");
+
+    // Print left subtree recursively:
+    if (node->left != NULL) {
+        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "|     "); }
+        else                 { sprintf(new_indent, "%s%s", indent, "      "); }
+        print_bs_subtree(node->left, NO, new_indent, print_node);
+    }
+
+    // Free memory:
+    free(new_indent);
+}
+
+// This function is used to print a binary tree on the screen.
+//
+//  * If a "print_node" function is provided it will be used to print the
+//    content of each node.
+//  * Otherwise (if print_node is NULL) all nodes will be printed as (#).
+//
+// Use this latter option if you only want to take a look at the tree shape.
+//
+// A correct print_node function only prints a single line of text using
+// the "fprintf" command. It should NOT include any "\n" in that line.
+//
+// For example:
+//
+//  void MyPrintNodeFunction(const void *ptr) {
+//      MyDataStruct *d = (MyDataStruct *) ptr;     // Pointer casting
+//      fprintf(stdout, "(%d)", d->key);            // Printing integer key
+//  }
+//
+// Finally, note that this is a visualization tool for debugging purposes only.
+//
+void print_bs_tree(const bs_tree *tree, void (* print_node) (const void *)) {
+
+    // Avoid the trivial cases:
+    if (tree != NULL && tree->root != NULL) {
+
+        // Print right subtree recursively:
+        if (tree->root->right != NULL) {
+            print_bs_subtree(tree->root->right, YES, "     ", print_node);
+        }
+
+        // Print current node:
+        fprintf(stdout, "----");
+        if (print_node == NULL) { fprintf(stdout, "(#)"); }
+        else     { print_node(tree->root->data); }
+        fprintf(stdout, "\n");
+
+        // Print left subtree recursively:
+        if (tree->root->left != NULL) {
+            print_bs_subtree(tree->root->left, NO, "     ", print_node);
+        }
+    }
+
+    // Empty the "stdout" buffer:
+    fflush(stdout);
+}
+
+// END OF BINARY SEARCH TREES //////////////////////////////////////////////////
+
+
+
+
+
+// RED BLACK TREES /////////////////////////////////////////////////////////////
+
+
+// NODE ALLOCATION:
+
+// Returns a new (uninitialized) rb_node taken from the node pool of tree, or
+// from malloc if tree does not have a pool. Returns NULL if out of memory.
+//
+static inline rb_node *new_rb_node(rb_tree *tree) {
+    STATS_ADD(tree, allocations, 1);
+    if (tree->pool == NULL) { return (rb_node *) malloc(sizeof(rb_node)); }
+    else                    { return (rb_node *) node_pool_alloc(tree->pool); }
+}
+
+// Releases a rb_node previously obtained with "new_rb_node".
+//
+static inline void free_rb_node(rb_tree *tree, rb_node *node) {
+    STATS_ADD(tree, releases, 1);
+    MINMAX_FORGET(tree, node);
+    if (tree->pool == NULL) { free(node); }
+    else                    { node_pool_free(tree->pool, node); }
+}
+
+#ifdef TREE_MIN_MAX
+
+// Finds the leftmost & rightmost nodes of tree again if they are unknown
+// (NULL) after a node was released or the whole tree was built (see MIN & MAX
+// NODES). It takes O(log(|Tree|)) time.
+//
+static void rb_fix_min_max(rb_tree *tree) {
+
+    rb_node *node;
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) {
+        MINMAX_CLEAR(tree);
+        return;
+    }
+
+    // Walk down the spines (only if needed):
+    if (tree->leftmost == NULL) {
+        node = tree->root;
+        while (RB_LEFT(node) != NULL) { node = RB_LEFT(node); }
+        tree->leftmost = node;
+    }
+    if (tree->rightmost == NULL) {
+        node = tree->root;
+        while (node->right != NULL) { node = node->right; }
+        tree->rightmost = node;
+    }
+}
+
+#else
+
+#define rb_fix_min_max(tree) ((void) 0)
+
+#endif
+
+// Returns a new empty rb_tree that uses the comparing (and prefix) function of
+// tree and has its own node pool if tree has one. Used by the copy & set
+// functions.
+//
+static rb_tree *new_rb_tree_as(const rb_tree *tree) {
+    rb_tree *new_tree;
+    if (tree->pool == NULL) { new_tree = new_rb_tree(tree->comp); }
+    else {
+        new_tree = new_rb_tree_with_pool(tree->comp, tree->pool->capacity);
+    }
+    if (new_tree != NULL) { PREFIX_INIT(new_tree, tree->prefix); }
+    return new_tree;
+}
+
+
+
+// IN-ORDER TRAVERSALS:
+
+// The copy & set functions traverse their (const) input trees in-order using
+// an explicit stack that stores the ancestors whose left subtree is being
+// visited. Unlike Morris traversals, this never writes into the tree, so many
+// threads can copy or combine the same tree at the same time.
+//
+// The height of a red black tree with n nodes is at most 2·log2(n+1), so a
+// fixed buffer of RB_WALKER_HEIGHT pointers is enough for any tree that fits
+// in a 64-bit address space (and no memory is ever allocated).
+
+#define RB_WALKER_HEIGHT 128    // Maximum height of a rb_tree
+
+typedef struct rb_walker {
+    rb_node  *node;                     // Current node (NULL if finished)
+    size_t    size;                     // Length of the stack
+    rb_node  *stack[RB_WALKER_HEIGHT];  // Pending ancestors of node
+} rb_walker;
+
+// This is an auxiliary function that pushes node and all its leftmost
+// descendants in the stack of walker and then pops the last one (the smallest
+// node of the subtree) as the current node of walker.
+//
+static rb_node *rb_walker_descend(rb_walker *walker, rb_node *node) {
+
+    // Push node and its leftmost descendants:
+    while (node != NULL) {
+        assert(walker->size < RB_WALKER_HEIGHT);
+        walker->stack[walker->size] = node;
+        walker->size++;
+        node = RB_LEFT(node);
+    }
+
+    // Pop the smallest one:
+    if (walker->size == 0) { walker->node = NULL; }
+    else {
+        walker->size--;
+        walker->node = walker->stack[walker->size];
+    }
+    return walker->node;
+}
+
+// Starts an in-order traversal of the subtree rooted at root and returns its
+// smallest node (or NULL if root is NULL).
+//
+static rb_node *rb_walker_first(rb_walker *walker, rb_node *root) {
+    walker->size = 0;
+    return rb_walker_descend(walker, root);
+}
+
+// Moves walker to the in-order successor of its current node and returns it
+// (or NULL if the traversal is finished).
+//
+static rb_node *rb_walker_next(rb_walker *walker) {
+    if (walker->node == NULL) { return NULL; }
+    return rb_walker_descend(walker, walker->node->right);
+}
+
+
+
+// ORDER STATISTICS:
+
+// If RB_ORDER_STATISTICS is defined, every rb_node stores the number of nodes
+// of its subtree. Rotations recompute the sizes of the rotated nodes from
+// their children, and every insertion or removal recomputes the sizes of the
+// nodes in the path to the modified leaf with a second top-down pass.
+
+#ifdef RB_ORDER_STATISTICS
+
+#define RB_SIZE(p)        (((p) == NULL) ? 0 : (p)->size)
+#define RB_UPDATE_SIZE(p) ((p)->size = 1 + RB_SIZE(RB_LEFT(p)) +              \
+                                           RB_SIZE((p)->right))
+#define RB_UPDATE_PATH(tree, data, kp, turn, side)                            \
+    rb_tree_update_sizes((tree), (data), (kp), (turn), (side))
+
+// This is an auxiliary function that recomputes the sizes of all the nodes
+// in a path that starts at the root, after an insertion or a removal.
+//
+// The path follows the search path of data (and stops at the node that
+// compares "equal" to data) but, after "turn", it goes once to the right and
+// then always to the left (to reach the successor of "turn"). If data is NULL
+// it follows the left spine (if side < 0) or the right spine (if side > 0).
+// The caller must provide kp = KEY_PREFIX(tree, data) (see KEY PREFIXES), so
+// this second pass skips the same comparisons as the first one.
+//
+static void rb_tree_update_sizes(rb_tree *tree, const void *data,
+                                 uint64_t kp, const rb_node *turn, int side) {
+
+    rb_node *path[RB_WALKER_HEIGHT];
+    rb_node *node = tree->root;
+    size_t   size = 0;
+    int      comp = side;
+
+    // Go down storing the path:
+    while (node != NULL) {
+        assert(size < RB_WALKER_HEIGHT);
+        path[size] = node;
+        size++;
+        if (node == turn) {
+            node = node->right;
+            data = NULL;
+            comp = -1;
+        } else {
+            if (data != NULL) { comp = PREFIX_COMPARE(tree, kp, data, node); }
+            if      (comp < 0) { node = RB_LEFT(node); }
+            else if (comp > 0) { node = node->right;   }
+            else               { break;                }
+        }
+    }
+
+    // Go up recomputing the sizes:
+    while (size > 0) {
+        size--;
+        RB_UPDATE_SIZE(path[size]);
+    }
+}
+
+// Returns the number of elements stored in the tree in O(1) time.
+//
+size_t rb_tree_size(const rb_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // The size of the root is the size of the tree:
+    return RB_SIZE(tree->root);
+}
+
+// Returns the k-th smallest element stored in the tree (starting from k = 0)
+// in O(log(|tree|)) time. Returns NULL if k >= rb_tree_size(tree).
+//
+void *rb_tree_select(const rb_tree *tree, size_t k) {
+
+    rb_node *node;
+    size_t   left;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Search:
+    node = tree->root;
+    while (node != NULL) {
+        left = RB_SIZE(RB_LEFT(node));
+        if      (k < left) { node = RB_LEFT(node); }
+        else if (k > left) { node = node->right; k -= left + 1; }
+        else               { return node->data; }   // found!
+    }
+
+    // Not found:
+    return NULL;
+}
+
+// This is an auxiliary function that counts the elements of the tree that are
+// smaller than data (or smaller or equal to data if "or_equal" is YES).
+//
+static size_t rb_tree_count_smaller(const rb_tree *tree, const void *data,
+                                    int or_equal) {
+
+    rb_node *node;
+    size_t   count;
+    int      comp;
+
+    // Search for data adding the sizes of the subtrees we leave to the left:
+    count = 0;
+    node  = tree->root;
+    while (node != NULL) {
+        comp = COMPARE(tree, data, node->data);
+        if (comp < 0) { node = RB_LEFT(node); }
+        else if (comp > 0) {
+            count += RB_SIZE(RB_LEFT(node)) + 1;
+            node   = node->right;
+        } else {
+            count += RB_SIZE(RB_LEFT(node));
+            if (or_equal == YES) { count++; }
+            break;
+        }
+    }
+
+    return count;
+}
+
+// Returns the number of elements of the tree that are strictly smaller than
+// data in O(log(|tree|)) time. If data is in the tree, this is its position
+// (so "rb_tree_select(tree, rb_tree_rank(tree, data))" returns data).
+//
+size_t rb_tree_rank(const rb_tree *tree, const void *data) {
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Count:
+    return rb_tree_count_smaller(tree, data, NO);
+}
+
+// Returns the number of elements of the tree that are bigger or equal to lo
+// and smaller or equal to hi in O(log(|tree|)) time.
+//
+size_t rb_tree_count_range(const rb_tree *tree, const void *lo,
+                           const void *hi) {
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(lo   != NULL);
+    assert(hi   != NULL);
+
+    // Trivial case: empty range
+    if (COMPARE(tree, lo, hi) > 0) { return 0; }
+
+    // General case:
+    return rb_tree_count_smaller(tree, hi, YES) -
+           rb_tree_count_smaller(tree, lo, NO);
+}
+
+#else
+
+#define RB_UPDATE_SIZE(p)                      ((void) 0)
+#define RB_UPDATE_PATH(tree, data, kp, turn, side) ((void) 0)
+
+#endif
+
+
+
+// Paints p with color c (and counts it):
+#define RB_RECOLOR(tree, p, c)  (STATS_ADD(tree, recolorings, 1),            \
+                                 RB_SET_COLOR(p, c))
+
+
+
+// CREATION & INSERTION:
+
+// Returns a pointer to a newly created rb_tree.
+// You must provide a comparing function "comp" such that:
+//  * comp(A,B) = 0  if and only if  A = B
+//  * comp(A,B) > 0  if and only if  A > B
+//  * comp(A,B) < 0  if and only if  A < B
+//
+// I recommend to limit the output of the "comp" function to {-1, 0, 1} as in:
+//
+//  int MyComp(const void *ptr1, const void *ptr2) {
+//      MyData *d1 = (MyData *) ptr1;
+//      MyData *d2 = (MyData *) ptr2;
+//      if      (d1->key < d2->key) { return -1; }
+//      else if (d1->key > d2->key) { return +1; }
+//      else                        { return  0; }
+//  }
+//
+// However, the code does not assume that so, if you are working with simple
+// numeric keys, you can just use something like:
+//
+//  int MyComp(const void *ptr1, const void *ptr2) {
+//      MyData *d1 = (MyData *) ptr1;
+//      MyData *d2 = (MyData *) ptr2;
+//      return (int) ((d1->key) - (d2->key));
+//  }
+//
+rb_tree *new_rb_tree(int (* comp) (const void *, const void *)) {
+
+    // Sanity check:
+    assert(comp != NULL);
+
+    // Allocate memory:
+    rb_tree *tree = (rb_tree *) malloc(sizeof(rb_tree));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for rb_tree\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->comp = comp;
+        tree->pool = NULL;
+        PREFIX_INIT(tree, NULL);
+        MINMAX_CLEAR(tree);
+        STATS_RESET(tree);
+    }
+
+    return tree;
+}
+
+// Returns a pointer to a newly created rb_tree whose nodes are allocated from
+// a node pool instead of calling malloc and free for every single node.
+//
+// The first slab of the pool will have room for "capacity" nodes (use your
+// best guess of the final size of the tree or 0 if you have no idea) and the
+// following slabs will be bigger and bigger. Removed nodes stay in the pool
+// and are reused by future insertions, so the memory of the pool is only
+// returned to the system by "rb_tree_remove_all", which takes O(#slabs)
+// time (plus O(|tree|) if you provide a "free_data" function).
+//
+// The pool lives in the same block of memory as the tree, so you can still
+// destroy it as usual:
+//
+//      rb_tree_remove_all(tree, free_data);
+//      free(tree);
+//
+// The comparing function must satisfy the same rules as in "new_rb_tree".
+//
+rb_tree *new_rb_tree_with_pool(int (* comp) (const void *, const void *),
+                               size_t capacity) {
+
+    // Sanity check:
+    assert(comp != NULL);
+
+    // Allocate memory for the tree and its pool:
+    rb_tree *tree = (rb_tree *) malloc(sizeof(rb_tree) + sizeof(node_pool));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for rb_tree\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->comp = comp;
+        tree->pool = (node_pool *) (tree + 1);
+        PREFIX_INIT(tree, NULL);
+        MINMAX_CLEAR(tree);
+        STATS_RESET(tree);
+        init_node_pool(tree->pool, sizeof(rb_node), capacity);
+    }
+
+    return tree;
+}
+
+// Pending range of the sorted array (used by "rb_tree_from_sorted_array"):
+typedef struct rb_range {
+    size_t   first;     // First index of the range
+    size_t   last;      // One past the last index of the range
+    int      depth;     // Depth of the root of the range in the tree
+    int      side;      // Child of parent to hang it (-1 = left, +1 = right)
+    rb_node *parent;    // Parent of the root of the range (NULL if root)
+} rb_range;
+
+// Returns a pointer to a newly created (perfectly balanced) rb_tree containing
+// the n elements of the array "data", or NULL if out of memory. The elements
+// must be sorted in increasing order (according to comp) without duplicates.
+//
+// The middle element of the array becomes the root and both halves become
+// its subtrees (and so on), so all the levels of the tree but the last one
+// are full. Then all the nodes of the last level are RED and the rest are
+// BLACK, which makes it a valid red black tree with no rotations at all.
+//
+// It takes O(n) time (no comparisons at all) and all the nodes are carved
+// from a single contiguous block: the first slab of the node pool of the
+// tree. Apart from that, the tree is just like any other tree created with
+// "new_rb_tree_with_pool".
+//
+rb_tree *rb_tree_from_sorted_array(int (* comp) (const void *, const void *),
+                                   void **data, size_t n) {
+
+    rb_tree  *tree;
+    rb_node  *node;
+    rb_range  stack[RB_WALKER_HEIGHT];
+    rb_range  range;
+    size_t    size;
+    size_t    mid;
+    int       last_level;
+
+    // Sanity checks:
+    assert(comp != NULL);
+    assert(data != NULL || n == 0);
+
+    // Create a new tree whose first slab has room for all the nodes:
+    tree = new_rb_tree_with_pool(comp, n);
+    if (tree == NULL) { return NULL; }
+    if (n == 0)       { return tree; }
+
+    // Depth of the last level of the tree = floor(log2(n)):
+    last_level = 0;
+    for (size = n; size > 1; size /= 2) { last_level++; }
+
+    // Start with the whole array:
+    stack[0].first  = 0;
+    stack[0].last   = n;
+    stack[0].depth  = 0;
+    stack[0].side   = 0;
+    stack[0].parent = NULL;
+    size = 1;
+
+    // Build the tree top-down:
+    while (size > 0) {
+
+        // Take the next pending range:
+        size--;
+        range = stack[size];
+        mid   = range.first + (range.last - range.first) / 2;
+
+        // Sanity checks:
+        assert(data[mid] != NULL);
+        assert(mid == 0 || comp(data[mid - 1], data[mid]) < 0);
+
+        // Its middle element is the root of its subtree (only the first
+        // node can fail, since the first slab has room for all of them):
+        node = new_rb_node(tree);
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
+            free(tree);
+            return NULL;
+        }
+        node->data  = data[mid];
+        node->left  = NULL;
+        node->right = NULL;
+        SET_PREFIX(tree, node);
+        if (range.depth == last_level && range.depth > 0) {
+            RB_SET_COLOR(node, RED);
+        } else {
+            RB_SET_COLOR(node, BLACK);
+        }
+#ifdef RB_ORDER_STATISTICS
+        node->size  = range.last - range.first;
+#endif
+
+        // Hang it from its parent:
+        if      (range.parent == NULL) { tree->root = node;                 }
+        else if (range.side < 0)       { RB_SET_LEFT(range.parent, node);   }
+        else                           { range.parent->right = node;        }
+
+        // Push both halves (the left one will be built first):
+        assert(size + 2 <= RB_WALKER_HEIGHT);
+        if (mid + 1 < range.last) {
+            stack[size].first  = mid + 1;
+            stack[size].last   = range.last;
+            stack[size].depth  = range.depth + 1;
+            stack[size].side   = +1;
+            stack[size].parent = node;
+            size++;
+        }
+        if (range.first < mid) {
+            stack[size].first  = range.first;
+            stack[size].last   = mid;
+            stack[size].depth  = range.depth + 1;
+            stack[size].side   = -1;
+            stack[size].parent = node;
+            size++;
+        }
+    }
+
+    rb_fix_min_max(tree);
+    return tree;
+}
+
+// Returns a new rb_tree containing a copy of the tree.
+//
+// It takes O( |Tree|·Log(|Tree|) } ) time.
+//
+rb_tree *rb_tree_copy(const rb_tree *tree) {
+
+    rb_tree   *new_tree = NULL;
+    rb_walker  walker;
+    rb_node   *node;
+    void      *data;
+    
+    // Sanity check:
+    assert(tree != NULL);
+    
+    // Create a new tree:
+    new_tree = new_rb_tree_as(tree);
+    if (new_tree == NULL) { return NULL; }
+
+    // Go to the smallest element of tree:
+    node = rb_walker_first(&walker, tree->root);
+
+    // Insert all data from tree into new_tree:
+    while (node != NULL) {
+
+        // insert node->data in new_tree ///////////////////////////////////////
+        data = node->data;
+        data = rb_tree_insert_max(new_tree, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node ////////////////////////////////////////////////////////
+        node = rb_walker_next(&walker);
+        ////////////////////////////////////////////////////////////////////////
+    }
+    
+    // Return the new_tree:
+    return new_tree;
+}
+
+// Returns a new rb_tree with exactly the same shape (and colors) as tree, or
+// NULL if out of memory. Unlike "rb_tree_copy", it does not rebalance
+// anything: every node is duplicated in a single pre-order pass.
+//
+// The clone always has a node pool whose first slab has room for all the
+// nodes, so they are carved from a single contiguous block (in pre-order, so
+// a search visits increasing addresses). Apart from that, it is just like
+// any other tree created with "new_rb_tree_with_pool".
+//
+// It does NOT modify tree and takes O(|Tree|) time.
+//
+rb_tree *rb_tree_clone(const rb_tree *tree) {
+
+    rb_tree   *new_tree;
+    rb_node   *new_node;
+    rb_node   *parent;
+    rb_node   *pending = NULL;
+    rb_node   *node;
+    size_t     size = 0;
+    int        side = 0;
+#ifndef RB_ORDER_STATISTICS
+    rb_walker  walker;
+#endif
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Count the nodes:
+#ifdef RB_ORDER_STATISTICS
+    size = RB_SIZE(tree->root);
+#else
+    node = rb_walker_first(&walker, tree->root);
+    while (node != NULL) {
+        size++;
+        node = rb_walker_next(&walker);
+    }
+#endif
+
+    // Create a new tree whose first slab has room for all the nodes:
+    new_tree = new_rb_tree_with_pool(tree->comp, size);
+    if (new_tree == NULL) { return NULL; }
+    PREFIX_INIT(new_tree, tree->prefix);
+
+    // Duplicate the nodes in pre-order. Instead of a stack, the new nodes
+    // whose right subtree is still pending form a list linked through their
+    // right pointers, and their data points to the original node meanwhile:
+    parent = NULL;
+    node   = tree->root;
+    for (;;) {
+
+        // Duplicate node and its leftmost descendants:
+        while (node != NULL) {
+
+            // Only the first node can fail (the first slab has room for all):
+            new_node = new_rb_node(new_tree);
+            if (new_node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
+                assert(parent == NULL);
+                free(new_tree);
+                return NULL;
+            }
+            new_node->left  = NULL;
+            new_node->right = NULL;
+            new_node->data  = node->data;
+            RB_SET_COLOR(new_node, RB_COLOR(node));
+            COPY_PREFIX(new_node, node);
+#ifdef RB_ORDER_STATISTICS
+            new_node->size  = node->size;
+#endif
+
+            // Remember its right subtree for later:
+            if (node->right != NULL) {
+                new_node->data  = node;
+                new_node->right = pending;
+                pending         = new_node;
+            }
+
+            // Hang it from its parent:
+            if      (parent == NULL) { new_tree->root = new_node;         }
+            else if (side < 0)       { RB_SET_LEFT(parent, new_node);     }
+            else                     { parent->right = new_node;          }
+
+            parent = new_node;
+            side   = -1;
+            node   = RB_LEFT(node);
+        }
+
+        // Continue with the last pending right subtree (if any):
+        if (pending == NULL) { break; }
+        parent         = pending;
+        pending        = parent->right;
+        node           = (rb_node *) parent->data;
+        parent->data   = node->data;
+        parent->right  = NULL;
+        side           = +1;
+        node           = node->right;
+    }
+
+    rb_fix_min_max(new_tree);
+    return new_tree;
+}
+
+// Inserts data in tree.
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *rb_tree_insert(rb_tree *tree, void *data) {
+
+    rb_node *anchor   = NULL;   // We need to store the last 4 levels:
+    rb_node *granpa   = NULL;   //
+    rb_node *parent   = NULL;   //            anchor
+    rb_node *node     = NULL;   //              |    <- comp_g
+    void    *old_data = NULL;   //            granpa
+    int      comp_g   = 0;      //              |    <- comp_p
+    int      comp_p   = 0;      //            parent
+    int      comp_n   = 0;      //              |    <- comp_n
+    int      comp     = 0;      //             node
+    size_t   depth    = 0;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Compute the prefix of data once (see KEY PREFIXES):
+    kp = KEY_PREFIX(tree, data);
+
+    // Search for the correct place to insert data:
+    node = tree->root;
+    for (;;) {
+
+        // If we reach a leaf we must insert "data" here:
+        if (node == NULL) {
+
+            // Create a new node:
+            node = new_rb_node(tree);
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
+                break;
+            } else {
+                node->data  = data;
+                node->left  = NULL;
+                node->right = NULL;
+                RB_SET_COLOR(node, RED);
+                RB_UPDATE_SIZE(node);
+                comp        = 0;
+                SET_PREFIX(tree, node);
+            }
+
+            // And attach it bellow "parent":
+            if (parent == NULL)  { tree->root    = node; }
+            else if (comp_n < 0) { RB_SET_LEFT(parent, node); }
+            else                 { parent->right = node; }
+            MINMAX_LINK(tree, parent, node, comp_n < 0);
+
+        // Otherwise "node" is an interior node:
+        } else {
+
+            // Compare "data" with "node->data":
+            depth++;
+            comp = PREFIX_COMPARE(tree, kp, data, node);
+
+            // If the data is already there: Update and remember "old_data"
+            if (comp == 0) {
+                old_data   = node->data;
+                node->data = data;
+            }
+
+            // If "node" has two RED children: Make a color flip
+            if (IS_RED(RB_LEFT(node)) && IS_RED(node->right)) {
+                RB_RECOLOR(tree, node, RED);
+                RB_RECOLOR(tree, RB_LEFT(node), BLACK);
+                RB_RECOLOR(tree, node->right, BLACK);
+            }
+        }
+
+        // Repair any violation of the RED property:
+        if (IS_RED(node) && IS_RED(parent)) {
+
+            // Case 1: Single "granpa-parent" left rotation
+            if (comp_p > 0 && comp_n > 0) {
+                STATS_ADD(tree, rotations, 1);
+
+                granpa->right = RB_LEFT(parent);
+                RB_RECOLOR(tree, granpa, RED);
+                RB_SET_LEFT(parent, granpa);
+                RB_RECOLOR(tree, parent, BLACK);
+                RB_UPDATE_SIZE(granpa);
+                RB_UPDATE_SIZE(parent);
+                
+                if  (anchor == NULL) { tree->root    = parent; }
+                else if (comp_g < 0) { RB_SET_LEFT(anchor, parent); }
+                else if (comp_g > 0) { anchor->right = parent; }
+                granpa = anchor;
+                comp_p = comp_g;
+
+            // Case 2: Single "granpa-parent" right rotation
+            } else if (comp_p < 0 && comp_n < 0) {
+                STATS_ADD(tree, rotations, 1);
+
+                RB_SET_LEFT(granpa, parent->right);
+                RB_RECOLOR(tree, granpa, RED);
+                parent->right = granpa;
+                RB_RECOLOR(tree, parent, BLACK);
+                RB_UPDATE_SIZE(granpa);
+                RB_UPDATE_SIZE(parent);
+                
+                if  (anchor == NULL) { tree->root    = parent; }
+                else if (comp_g < 0) { RB_SET_LEFT(anchor, parent); }
+                else if (comp_g > 0) { anchor->right = parent; }
+                granpa = anchor;
+                comp_p = comp_g;
+
+            // Case 3: Double "granpa-parent-node" rotation
+            } else {
+                STATS_ADD(tree, rotations, 2);
+
+                // Case 3.1: Left-Right
+                if (comp_n < 0) {
+                    granpa->right = RB_LEFT(node);
+                    RB_RECOLOR(tree, granpa, RED);
+                    RB_SET_LEFT(parent, node->right);
+                    RB_SET_LEFT(node, granpa);
+                    node->right   = parent;
+                    RB_RECOLOR(tree, node, BLACK);
+                    RB_UPDATE_SIZE(granpa);
+                    RB_UPDATE_SIZE(parent);
+                    RB_UPDATE_SIZE(node);
+                    if (comp > 0) { granpa = parent; }
+                    parent = node;
+                    node   = granpa;
+                    if (comp > 0) { comp_n *= -1;      }
+                    if (comp < 0) { comp_n  = -comp_p; }
+                    
+                // Case 3.2: Right-Left
+                } else {
+                    RB_SET_LEFT(granpa, node->right);
+                    RB_RECOLOR(tree, granpa, RED);
+                    parent->right = RB_LEFT(node);
+                    node->right   = granpa;
+                    RB_SET_LEFT(node, parent);
+                    RB_RECOLOR(tree, node, BLACK);
+                    RB_UPDATE_SIZE(granpa);
+                    RB_UPDATE_SIZE(parent);
+                    RB_UPDATE_SIZE(node);
+                    if (comp < 0) { granpa = parent; }
+                    parent = node;
+                    node   = granpa;
+                    if (comp < 0) { comp_n *= -1;      }
+                    if (comp > 0) { comp_n  = -comp_p; }
+                }
+
+                if  (anchor == NULL) { tree->root    = parent; }
+                else if (comp_g < 0) { RB_SET_LEFT(anchor, parent); }
+                else if (comp_g > 0) { anchor->right = parent; }
+                granpa = anchor;
+                comp_p = comp_g;
+                comp  *= -1;
+            }
+        }
+
+        // Advance one step:
+        anchor = granpa;
+        granpa = parent;
+        parent = node;
+        if      (comp < 0) { node = RB_LEFT(node);  }  // Data is smaller
+        else if (comp > 0) { node = node->right; }  // Data is bigger
+        else               { break;              }  // We are done!
+
+        // And remember were you come from:
+        comp_g = comp_p;
+        comp_p = comp_n;
+        comp_n = comp;
+    }
+
+    // Update the sizes of the path to the new node (if any):
+    if (old_data == NULL && node != NULL) {
+        RB_UPDATE_PATH(tree, data, kp, NULL, 0);
+    }
+
+    // Count the search:
+    STATS_SEARCH(tree, depth);
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Inserts "data" such that "data" is smaller or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly bigger than
+//          something already in the tree you will break the tree!
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *rb_tree_insert_min(rb_tree *tree, void *data) {
+
+    rb_node *anchor   = NULL;
+    rb_node *granpa   = NULL;
+    rb_node *parent   = NULL;
+    rb_node *node     = NULL;
+    void    *old_data = NULL;
+    int      inserted = NO;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search for the correct place to insert data:
+    node = tree->root;
+    for (;;) {
+
+        // If we reach a leaf we must insert "data" here:
+        if (node == NULL) {
+
+            // Perhaps "parent" already contains "data":
+            if (parent != NULL && COMPARE(tree, data, parent->data) == 0) {
+                old_data     = parent->data;
+                parent->data = data;
+                break;
+
+            // Otherwise: Create a new node 
+            } else {            
+                node = new_rb_node(tree);
+                if (node == NULL) {
+                    fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
+                    break;
+                } else {
+                    node->data  = data;
+                    node->left  = NULL;
+                    node->right = NULL;
+                    RB_SET_COLOR(node, RED);
+                    RB_UPDATE_SIZE(node);
+                    inserted    = YES;
+                    SET_PREFIX(tree, node);
+                }
+                if (parent == NULL)  { tree->root   = node; }
+                else                 { RB_SET_LEFT(parent, node); }
+                MINMAX_LINK(tree, parent, node, YES);
+            }            
+            
+        // Otherwise: "node" may require a color flip
+        } else if (IS_RED(RB_LEFT(node)) && IS_RED(node->right)) {
+            RB_RECOLOR(tree, node, RED);
+            RB_RECOLOR(tree, RB_LEFT(node), BLACK);
+            RB_RECOLOR(tree, node->right, BLACK);
+        }
+
+        // Repair any violation of the RED property: Single right rotation
+        if (IS_RED(node) && IS_RED(parent)) {            
+            STATS_ADD(tree, rotations, 1);
+            RB_SET_LEFT(granpa, parent->right);
+            RB_RECOLOR(tree, granpa, RED);
+            parent->right = granpa;
+            RB_RECOLOR(tree, parent, BLACK);
+            RB_UPDATE_SIZE(granpa);
+            RB_UPDATE_SIZE(parent);
+            if  (anchor == NULL) { tree->root   = parent; }
+            else                 { RB_SET_LEFT(anchor, parent); }
+            granpa = anchor;
+        }
+
+        // Advance one step or exit:
+        if (inserted == YES) { break; }
+        anchor = granpa;
+        granpa = parent;
+        parent = node;
+        node   = RB_LEFT(node);
+    }
+
+    // Update the sizes of the left spine (if data was inserted):
+    if (inserted == YES) { RB_UPDATE_PATH(tree, NULL, 0, NULL, -1); }
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Inserts "data" such that "data" is bigger or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly smaller
+//          than something already in the tree you will break the tree!
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *rb_tree_insert_max(rb_tree *tree, void *data) {
+
+    rb_node *anchor   = NULL;
+    rb_node *granpa   = NULL;
+    rb_node *parent   = NULL;
+    rb_node *node     = NULL;
+    void    *old_data = NULL;
+    int      inserted = NO;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search for the correct place to insert data:
+    node = tree->root;
+    for (;;) {
+
+        // If we reach a leaf we must insert "data" here:
+        if (node == NULL) {
+
+            // Perhaps "parent" already contains "data":
+            if (parent != NULL && COMPARE(tree, data, parent->data) == 0) {
+                old_data     = parent->data;
+                parent->data = data;
+                break;
+
+            // Otherwise: Create a new node 
+            } else {            
+                node = new_rb_node(tree);
+                if (node == NULL) {
+                    fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
+                    break;
+                } else {
+                    node->data  = data;
+                    node->left  = NULL;
+                    node->right = NULL;
+                    RB_SET_COLOR(node, RED);
+                    RB_UPDATE_SIZE(node);
+                    inserted    = YES;
+                    SET_PREFIX(tree, node);
+                }
+                if (parent == NULL)  { tree->root    = node; }
+                else                 { parent->right = node; }
+                MINMAX_LINK(tree, parent, node, NO);
+            }            
+            
+        // Otherwise: "node" may require a color flip
+        } else if (IS_RED(RB_LEFT(node)) && IS_RED(node->right)) {
+            RB_RECOLOR(tree, node, RED);
+            RB_RECOLOR(tree, RB_LEFT(node), BLACK);
+            RB_RECOLOR(tree, node->right, BLACK);
+        }
+
+        // Repair any violation of the RED property: Single left rotation
+        if (IS_RED(node) && IS_RED(parent)) {
+            STATS_ADD(tree, rotations, 1);
+            granpa->right = RB_LEFT(parent);
+            RB_RECOLOR(tree, granpa, RED);
+            RB_SET_LEFT(parent, granpa);
+            RB_RECOLOR(tree, parent, BLACK);
+            RB_UPDATE_SIZE(granpa);
+            RB_UPDATE_SIZE(parent);
+            if  (anchor == NULL) { tree->root    = parent; }
+            else                 { anchor->right = parent; }
+            granpa = anchor;
+        }
+
+        // Advance one step or exit:
+        if (inserted == YES) { break; }
+        anchor = granpa;
+        granpa = parent;
+        parent = node;
+        node   = node->right;
+    }
+
+    // Update the sizes of the right spine (if data was inserted):
+    if (inserted == YES) { RB_UPDATE_PATH(tree, NULL, 0, NULL, +1); }
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+
+
+// SEARCH:
+
+// Returns YES if the tree is empty and NO otherwise.
+//
+int rb_tree_is_empty(const rb_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Check if there is at least 1 node in the tree:
+    if (tree->root == NULL) { return YES; }
+    else                    { return NO;  }
+}
+
+// Finds a node that compares "equal" to data. Returns NULL if not found.
+//
+void *rb_tree_search(const rb_tree *tree, const void *data) {
+
+    rb_node *node;
+    size_t   depth = 0;
+    int      comp;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Compute the prefix of data once (see KEY PREFIXES):
+    kp = KEY_PREFIX(tree, data);
+
+    // Search:
+    node = tree->root;
+    while (node != NULL) {
+        depth++;
+        comp = PREFIX_COMPARE(tree, kp, data, node);  // compare data
+        if      (comp < 0) { node = RB_LEFT(node); }  // data is smaller
+        else if (comp > 0) { node = node->right;   }  // data is bigger
+        else               { break;                }  // found!
+    }
+    STATS_SEARCH(tree, depth);
+
+    // Return the data (or NULL if not found):
+    return (node == NULL) ? NULL : node->data;
+}
+
+// Returns a pointer to the smallest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *rb_tree_min(const rb_tree *tree) {
+
+    rb_node *node;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Find the smallest node (unless it is cached)
+#ifdef TREE_MIN_MAX
+    node = tree->leftmost;
+#else
+    node = tree->root;
+    while (RB_LEFT(node) != NULL) { node = RB_LEFT(node); }
+#endif
+
+    // Return a pointer to the data:
+    return node->data;
+}
+
+// Returns a pointer to the biggest element stored in "tree".
+// Returns NULL if the tree is empty.
+//
+void *rb_tree_max(const rb_tree *tree) {
+
+    rb_node *node;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Find the biggest node (unless it is cached)
+#ifdef TREE_MIN_MAX
+    node = tree->rightmost;
+#else
+    node = tree->root;
+    while (node->right != NULL) { node = node->right; }
+#endif
+
+    // Return a pointer to the data:
+    return node->data;
+}
+
+// Find the in-order predesor of data in the tree.
+//
+// If data is not in tree returns the biggest element of tree smaller than data.
+// If data is smaller or equal to all elements of tree returns NULL.
+//
+void *rb_tree_prev(const rb_tree *tree, const void *data) {
+
+    rb_node *node;
+    rb_node *pred;
+    int      comp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search:
+    pred = NULL;
+    node = tree->root;
+    while (node != NULL) {
+
+        // Compare data:
+        comp = COMPARE(tree, data, node->data);
+
+        // Data is smaller:
+        if (comp < 0) { node = RB_LEFT(node); }
+
+        // Data is bigger:
+        else if (comp > 0) {
+            pred = node;
+            node = node->right;
+        }
+
+        // We have found the node:
+        else if (RB_LEFT(node) != NULL) {
+            pred = RB_LEFT(node);
+            while (pred->right != NULL) { pred = pred->right; }
+            break;
+        } else { break; }
+    }
+
+    // Return predecesor:
+    if (pred == NULL) { return NULL; }
+    return pred->data;
+}
+
+// Find the in-order successor of data in the tree.
+//
+// If data is not in tree returns the smallest element of tree bigger than data.
+// If data is bigger or equal to all elements of tree returns NULL.
+//
+void *rb_tree_next(const rb_tree *tree, const void *data) {
+
+    rb_node *node;
+    rb_node *succ;
+    int      comp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search:
+    succ = NULL;
+    node = tree->root;
+    while (node != NULL) {
+
+        // Compare data:
+        comp = COMPARE(tree, data, node->data);
+
+        // Data is smaller:
+        if (comp < 0) {
+            succ = node;
+            node = RB_LEFT(node);
+        }
+
+        // Data is bigger:
+        else if (comp > 0) { node = node->right; }
+
+        // We have found the node:
+        else if (node->right != NULL) {
+            succ = node->right;
+            while (RB_LEFT(succ) != NULL) { succ = RB_LEFT(succ); }
+            break;
+        } else { break; }
+    }
+
+    // Return succesor:
+    if (succ == NULL) { return NULL; }
+    return succ->data;
+}
+
+
+// BATCHES:
+
+// A finger remembers the path from the root to the last node visited and the
+// upper bound of the subtree of every node of the path (the data of its
+// nearest ancestor whose left subtree contains it, or NULL if there is none).
+// Since the batch functions visit the elements in increasing order, the next
+// search only has to climb until the data falls inside the subtree of the
+// last node of the path and go down from there.
+//
+// Red black trees are balanced, so a fixed path of RB_WALKER_HEIGHT steps is
+// enough. New nodes are inserted bottom-up (using the path to go up) because
+// a single rotation only invalidates the path below the rotated nodes.
+
+typedef struct rb_step {
+    rb_node    *node;   // Node of the path
+    const void *bound;  // Upper bound of its subtree (NULL if none)
+} rb_step;
+
+typedef struct rb_finger {
+    rb_step path[RB_WALKER_HEIGHT];     // Path from the root
+    size_t  size;                       // Length of the path (0 = restart)
+} rb_finger;
+
+// This is an auxiliary function that searches data starting from the last
+// node of the path of finger. Data must not be smaller than any data
+// searched before with the same finger.
+//
+// Returns the node that compares "equal" to data (with 0 in "comp") or the
+// node where data should be inserted (with the side in "comp"), or NULL if
+// the tree is empty. In both cases that node is the last one of the path.
+//
+static rb_node *rb_finger_seek(rb_finger *finger, const rb_tree *tree,
+                               const void *data, int *comp) {
+
+    rb_node    *node;
+    const void *bound;
+
+    // Climb until data is inside the subtree of the last node:
+    while (finger->size > 0) {
+        bound = finger->path[finger->size - 1].bound;
+        if (bound == NULL || COMPARE(tree, data, bound) < 0) { break; }
+        while (finger->size > 0 &&
+               finger->path[finger->size - 1].bound == bound) {
+            finger->size--;
+        }
+    }
+
+    // Trivial case: empty tree
+    if (finger->size == 0) {
+        if (tree->root == NULL) { return NULL; }
+        finger->path[0].node  = tree->root;
+        finger->path[0].bound = NULL;
+        finger->size = 1;
+    }
+    node  = finger->path[finger->size - 1].node;
+    bound = finger->path[finger->size - 1].bound;
+
+    // Go down from there:
+    for (;;) {
+        *comp = COMPARE(tree, data, node->data);
+        if (*comp < 0 && RB_LEFT(node) != NULL) {
+            bound = node->data;
+            node  = RB_LEFT(node);
+        } else if (*comp > 0 && node->right != NULL) {
+            node  = node->right;
+        } else {
+            return node;
+        }
+        assert(finger->size < RB_WALKER_HEIGHT);
+        finger->path[finger->size].node  = node;
+        finger->path[finger->size].bound = bound;
+        finger->size++;
+    }
+}
+
+// This is an auxiliary function that hangs new_node (a RED leaf) from parent
+// (the last node of the path of finger, or NULL if the tree is empty) on the
+// side given by "comp" and repairs the tree going up the path. Afterwards
+// the path is still valid (it may just be shorter).
+//
+static void rb_finger_insert(rb_finger *finger, rb_tree *tree,
+                             rb_node *parent, rb_node *new_node, int comp) {
+
+    rb_node *node;
+    rb_node *granpa;
+    rb_node *uncle;
+    rb_node *great;
+    size_t   i;
+
+    // Hang the new node:
+    if (parent == NULL) {
+        tree->root = new_node;
+        finger->path[0].node  = new_node;
+        finger->path[0].bound = NULL;
+        finger->size = 1;
+    } else {
+        assert(finger->size < RB_WALKER_HEIGHT);
+        if (comp < 0) {
+            RB_SET_LEFT(parent, new_node);
+            finger->path[finger->size].bound = parent->data;
+        } else {
+            parent->right = new_node;
+            finger->path[finger->size].bound =
+                finger->path[finger->size - 1].bound;
+        }
+        finger->path[finger->size].node = new_node;
+        finger->size++;
+    }
+    MINMAX_LINK(tree, parent, new_node, comp < 0);
+
+#ifdef RB_ORDER_STATISTICS
+    // All the nodes of the path have a new descendant:
+    for (i = 0; i + 1 < finger->size; i++) { finger->path[i].node->size++; }
+#endif
+
+    // Repair any violation of the RED property going up:
+    i = finger->size - 1;
+    while (i > 0 && IS_RED(finger->path[i - 1].node)) {
+
+        // Since the root is BLACK, a RED parent always has a granpa:
+        assert(i >= 2);
+        node   = finger->path[i].node;
+        parent = finger->path[i - 1].node;
+        granpa = finger->path[i - 2].node;
+        uncle  = (parent == RB_LEFT(granpa)) ? granpa->right : RB_LEFT(granpa);
+
+        // Case 1: RED uncle, make a color flip and go up
+        if (IS_RED(uncle)) {
+            RB_SET_COLOR(parent, BLACK);
+            RB_SET_COLOR(uncle,  BLACK);
+            RB_SET_COLOR(granpa, RED);
+            i -= 2;
+            continue;
+        }
+
+        // Case 2: BLACK uncle, rotate (once or twice) and stop
+        if (parent == RB_LEFT(granpa)) {
+            if (node == parent->right) {
+                parent->right = RB_LEFT(node);
+                RB_SET_LEFT(node, parent);
+                RB_UPDATE_SIZE(parent);
+                parent = node;
+            }
+            RB_SET_LEFT(granpa, parent->right);
+            parent->right = granpa;
+        } else {
+            if (node == RB_LEFT(parent)) {
+                RB_SET_LEFT(parent, node->right);
+                node->right = parent;
+                RB_UPDATE_SIZE(parent);
+                parent = node;
+            }
+            granpa->right = RB_LEFT(parent);
+            RB_SET_LEFT(parent, granpa);
+        }
+        RB_SET_COLOR(granpa, RED);
+        RB_SET_COLOR(parent, BLACK);
+        RB_UPDATE_SIZE(granpa);
+        RB_UPDATE_SIZE(parent);
+
+        // Hang the rotated subtree where granpa was:
+        if (i == 2) { tree->root = parent; }
+        else {
+            great = finger->path[i - 3].node;
+            if (RB_LEFT(great) == granpa) { RB_SET_LEFT(great, parent); }
+            else                          { great->right = parent;      }
+        }
+
+        // The path is only valid above the rotated nodes:
+        finger->size = i - 2;
+        break;
+    }
+
+    // Before leaving: Make sure that the root is BLACK!
+    RB_SET_COLOR(tree->root, BLACK);
+}
+
+// Inserts the n elements of data in tree.
+//
+// It works as if "rb_tree_insert" were called for every element of data (in
+// the same order), storing its result back in data: data[i] will be NULL or
+// a pointer to the previously stored element that data[i] has replaced (so
+// you can free it).
+//
+// The elements are inserted in increasing order, so the search of each one
+// starts where the previous one ended instead of at the root.
+//
+void rb_tree_insert_batch(rb_tree *tree, void **data, size_t n) {
+
+    rb_finger  finger;
+    rb_node   *node;
+    rb_node   *new_node;
+    size_t    *order;
+    void      *old_data;
+    size_t     i;
+    int        comp = 0;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL || n == 0);
+
+    // Trivial case: empty batch
+    if (n == 0) { return; }
+
+    // Sort the batch (or insert it as is if out of memory):
+    order = sort_batch(tree->comp, (const void **) data, n);
+    if (order == NULL) {
+        for (i = 0; i < n; i++) { data[i] = rb_tree_insert(tree, data[i]); }
+        return;
+    }
+
+    // Insert the elements in increasing order:
+    finger.size = 0;
+    for (i = 0; i < n; i++) {
+
+        // Sanity Check:
+        assert(data[order[i]] != NULL);
+
+        // Search for the correct place to insert data:
+        node = rb_finger_seek(&finger, tree, data[order[i]], &comp);
+
+        // Data is already there: overwrite it!
+        if (node != NULL && comp == 0) {
+            old_data       = node->data;
+            node->data     = data[order[i]];
+            data[order[i]] = old_data;
+            continue;
+        }
+
+        // Insert a new RED node here:
+        new_node = new_rb_node(tree);
+        if (new_node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
+            data[order[i]] = NULL;
+            continue;
+        }
+        new_node->data  = data[order[i]];
+        new_node->left  = NULL;
+        new_node->right = NULL;
+        RB_SET_COLOR(new_node, RED);
+        SET_PREFIX(tree, new_node);
+#ifdef RB_ORDER_STATISTICS
+        new_node->size  = 1;
+#endif
+        data[order[i]]  = NULL;
+        rb_finger_insert(&finger, tree, node, new_node, comp);
+    }
+
+    free(order);
+}
+
+// Searches the n elements of keys in tree. Stores in out[i] the element that
+// compares "equal" to keys[i] (or NULL if not found).
+//
+// The keys are searched in increasing order, so the search of each one
+// starts where the previous one ended instead of at the root.
+//
+void rb_tree_search_batch(const rb_tree *tree, const void **keys, void **out,
+                          size_t n) {
+
+    rb_finger  finger;
+    rb_node   *node;
+    size_t    *order;
+    size_t     i;
+    int        comp = 0;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert((keys != NULL && out != NULL) || n == 0);
+
+    // Trivial case: empty batch
+    if (n == 0) { return; }
+
+    // Sort the batch (or search it as is if out of memory):
+    order = sort_batch(tree->comp, keys, n);
+    if (order == NULL) {
+        for (i = 0; i < n; i++) { out[i] = rb_tree_search(tree, keys[i]); }
+        return;
+    }
+
+    // Search the keys in increasing order:
+    finger.size = 0;
+    for (i = 0; i < n; i++) {
+        assert(keys[order[i]] != NULL);
+        node = rb_finger_seek(&finger, tree, keys[order[i]], &comp);
+        if (node != NULL && comp == 0) { out[order[i]] = node->data; }
+        else                           { out[order[i]] = NULL;       }
+    }
+
+    free(order);
+}
+
+// Searches the n elements of keys in tree. Stores in out[i] the element that
+// compares "equal" to keys[i] (or NULL if not found).
+//
+// On trees much bigger than the cache every step of a search is a cache miss,
+// so this function keeps BATCH_GROUP searches in flight: each step of a search
+// prefetches the next node (or its data) and then switches to the next search
+// instead of waiting for it. Unlike "rb_tree_search_batch", the keys do not
+// need to be sorted and are not compared between them.
+//
+void rb_tree_search_interleaved(const rb_tree *tree, const void **keys,
+                                void **out, size_t n) {
+
+    const rb_node *node[BATCH_GROUP];   // Current node of each search
+    size_t         key[BATCH_GROUP];    // Position of the key of each search
+    int            ready[BATCH_GROUP];  // YES if the data of node is prefetched
+    const rb_node *child;
+    size_t         size;
+    size_t         next;
+    size_t         i;
+    int            comp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert((keys != NULL && out != NULL) || n == 0);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) {
+        for (i = 0; i < n; i++) { out[i] = NULL; }
+        return;
+    }
+
+    // Start the first searches:
+    for (size = 0; size < BATCH_GROUP && size < n; size++) {
+        node[size]  = tree->root;
+        key[size]   = size;
+        ready[size] = NO;
+    }
+    next = size;
+
+    // Advance every search one step at a time:
+    while (size > 0) {
+        for (i = 0; i < size; i++) {
+
+            // First step: prefetch the data of the node
+            if (ready[i] == NO) {
+                BATCH_PREFETCH(node[i]->data);
+                ready[i] = YES;
+                continue;
+            }
+
+            // Second step: compare it and prefetch the next node
+            comp = COMPARE(tree, keys[key[i]], node[i]->data);
+            if      (comp < 0) { child = RB_LEFT(node[i]); }
+            else if (comp > 0) { child = node[i]->right;   }
+            else               { child = NULL;             }
+            if (child != NULL) {
+                BATCH_PREFETCH(child);
+                node[i]  = child;
+                ready[i] = NO;
+                continue;
+            }
+
+            // The search is over:
+            if (comp == 0) { out[key[i]] = node[i]->data; }
+            else           { out[key[i]] = NULL;          }
+
+            // Start a new search (or drop the last one here):
+            if (next < n) {
+                node[i]  = tree->root;
+                key[i]   = next;
+                ready[i] = NO;
+                next++;
+            } else {
+                size--;
+                node[i]  = node[size];
+                key[i]   = key[size];
+                ready[i] = ready[size];
+            }
+        }
+    }
+}
+
+
+
+// CURSORS:
+
+// A cursor stores the whole path from the root of the tree to its current
+// node, so it can move to the in-order successor or predecessor without
+// restarting from the root and without modifying the tree. Each edge of the
+// tree is followed at most twice during a full traversal, so each call to
+// "rb_cursor_next" or "rb_cursor_prev" takes O(1) amortized time.
+//
+// Any insertion or removal in the tree invalidates all its cursors (you must
+// call "rb_cursor_first", "rb_cursor_last" or "rb_cursor_seek" again).
+
+#define RB_CURSOR_CAPACITY 64   // Initial length of the path of a cursor
+
+// Creates a new cursor over tree. The cursor does not point to any node until
+// you call "rb_cursor_first", "rb_cursor_last" or "rb_cursor_seek".
+// Returns NULL if out of memory.
+//
+rb_cursor *new_rb_cursor(const rb_tree *tree) {
+
+    rb_cursor *cursor;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Allocate the cursor and its path:
+    cursor = (rb_cursor *) malloc(sizeof(rb_cursor));
+    if (cursor == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate rb_cursor\n");
+        return NULL;
+    }
+    cursor->path = (rb_node **) malloc(RB_CURSOR_CAPACITY * sizeof(rb_node *));
+    if (cursor->path == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate rb_cursor\n");
+        free(cursor);
+        return NULL;
+    }
+
+    // Initialize it:
+    cursor->tree     = tree;
+    cursor->size     = 0;
+    cursor->capacity = RB_CURSOR_CAPACITY;
+    return cursor;
+}
+
+// Releases all the memory used by cursor (but not the tree).
+//
+void free_rb_cursor(rb_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Free the path and the cursor:
+    free(cursor->path);
+    free(cursor);
+}
+
+// This is an auxiliary function that appends node to the path of cursor,
+// doubling the capacity of the path if needed. Returns NO if out of memory.
+//
+static int rb_cursor_push(rb_cursor *cursor, rb_node *node) {
+
+    rb_node **path;
+
+    // Grow the path if it is full:
+    if (cursor->size == cursor->capacity) {
+        path = (rb_node **) realloc(cursor->path,
+                                    2 * cursor->capacity * sizeof(rb_node *));
+        if (path == NULL) {
+            fprintf(stderr, "ERROR: Unable to grow rb_cursor\n");
+            return NO;
+        }
+        cursor->path      = path;
+        cursor->capacity *= 2;
+    }
+
+    // Append node:
+    cursor->path[cursor->size] = node;
+    cursor->size++;
+    return YES;
+}
+
+// This is an auxiliary function that appends node and all its leftmost
+// descendants to the path of cursor and returns the data of the last one.
+// If out of memory, it invalidates the cursor and returns NULL.
+//
+static void *rb_cursor_push_left(rb_cursor *cursor, rb_node *node) {
+
+    while (node != NULL) {
+        if (rb_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        node = RB_LEFT(node);
+    }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// This is an auxiliary function that appends node and all its rightmost
+// descendants to the path of cursor and returns the data of the last one.
+// If out of memory, it invalidates the cursor and returns NULL.
+//
+static void *rb_cursor_push_right(rb_cursor *cursor, rb_node *node) {
+
+    while (node != NULL) {
+        if (rb_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        node = node->right;
+    }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Moves cursor to the smallest element of its tree and returns it.
+// Returns NULL if the tree is empty.
+//
+void *rb_cursor_first(rb_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Restart the path from the root:
+    cursor->size = 0;
+    if (cursor->tree->root == NULL) { return NULL; }
+    return rb_cursor_push_left(cursor, cursor->tree->root);
+}
+
+// Moves cursor to the biggest element of its tree and returns it.
+// Returns NULL if the tree is empty.
+//
+void *rb_cursor_last(rb_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Restart the path from the root:
+    cursor->size = 0;
+    if (cursor->tree->root == NULL) { return NULL; }
+    return rb_cursor_push_right(cursor, cursor->tree->root);
+}
+
+// Moves cursor to the smallest element of its tree that is bigger or equal
+// to data and returns it. Returns NULL if there is no such element.
+//
+// Use it to start range scans: "rb_cursor_seek(cursor, lo)" followed by calls
+// to "rb_cursor_next" until you reach an element bigger than your upper bound.
+//
+void *rb_cursor_seek(rb_cursor *cursor, const void *data) {
+
+    rb_node *node;
+    size_t   best;
+    int      comp;
+
+    // Sanity Checks:
+    assert(cursor != NULL);
+    assert(data   != NULL);
+
+    // Search for data storing the path. The answer is the last node of the
+    // path where we turned left (or the node that compares "equal" to data):
+    cursor->size = 0;
+    best         = 0;
+    node         = cursor->tree->root;
+    while (node != NULL) {
+        if (rb_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        comp = COMPARE(cursor->tree, data, node->data);
+        if      (comp < 0) { best = cursor->size; node = RB_LEFT(node);  }
+        else if (comp > 0) {                      node = node->right; }
+        else               { best = cursor->size; break;              }
+    }
+
+    // Cut the path just after the answer (if any):
+    cursor->size = best;
+    if (best == 0) { return NULL; }
+    return cursor->path[best - 1]->data;
+}
+
+// Moves cursor to the in-order successor of its current element and returns
+// it. Returns NULL (and invalidates the cursor) if there is no such element.
+//
+void *rb_cursor_next(rb_cursor *cursor) {
+
+    rb_node *node;
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Trivial case: invalid cursor
+    if (cursor->size == 0) { return NULL; }
+
+    // If the current node has a right subtree, go to its smallest node:
+    node = cursor->path[cursor->size - 1];
+    if (node->right != NULL) {
+        return rb_cursor_push_left(cursor, node->right);
+    }
+
+    // Otherwise, climb until we leave a left subtree:
+    do {
+        cursor->size--;
+        node = cursor->path[cursor->size];
+    } while (cursor->size > 0 && cursor->path[cursor->size - 1]->right == node);
+
+    // Return the data of the new current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Moves cursor to the in-order predecessor of its current element and returns
+// it. Returns NULL (and invalidates the cursor) if there is no such element.
+//
+void *rb_cursor_prev(rb_cursor *cursor) {
+
+    rb_node *node;
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Trivial case: invalid cursor
+    if (cursor->size == 0) { return NULL; }
+
+    // If the current node has a left subtree, go to its biggest node:
+    node = cursor->path[cursor->size - 1];
+    if (RB_LEFT(node) != NULL) {
+        return rb_cursor_push_right(cursor, RB_LEFT(node));
+    }
+
+    // Otherwise, climb until we leave a right subtree:
+    do {
+        cursor->size--;
+        node = cursor->path[cursor->size];
+    } while (cursor->size > 0 &&
+             RB_LEFT(cursor->path[cursor->size - 1]) == node);
+
+    // Return the data of the new current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Returns the current element of cursor (or NULL if the cursor is invalid).
+//
+void *rb_cursor_get(const rb_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Return the data of the current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+
+
+// REMOVE:
+
+// Removes a node of tree that compares "equal" to data and returns a pointer
+// to the previously stored data (so you can free it).
+// If such a node is not found, it returns a NULL pointer.
+//
+// Uses the trick of swapping node->data and successor->data pointers and then
+// removes successor. This is safe because the final user has no acces to any
+// tree node (only "tree" and "data" pointers are used in all interfaces) and
+// any removal invalidates all the cursors of the tree anyway.
+//
+void *rb_tree_remove(rb_tree *tree, const void *data) {
+
+    rb_node *granpa   = NULL;   // We need to store the last 3 levels //
+    rb_node *parent   = NULL;   //                                    //
+    rb_node *sister   = NULL;   //            granpa                  //
+    rb_node *node     = NULL;   //              |                     //
+    rb_node *old_node = NULL;   //            parent                  //
+    void    *old_data = NULL;   //            /    \   <- comp_n      //
+    int      comp_n   = 0;      //        sister  node                //
+    int      comp     = 0;      //                / \  <- comp        //
+    size_t   depth    = 0;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Compute the prefix of data once (see KEY PREFIXES):
+    kp = KEY_PREFIX(tree, data);
+
+    // Initialize the search at the root node:
+    node = tree->root;
+    if (node == NULL) { return NULL; }
+    
+    // Look for a leaf:
+    while (node != NULL) {
+        depth++;
+
+        // At this point node is BLACK, if sister exists is BLACK and if parent 
+        // exists is RED. We want to paint node RED and repair any violation.
+
+        // Case 1: Node has two BLACK children
+        if (IS_BLACK(RB_LEFT(node)) && IS_BLACK(node->right)) {
+
+            // Easy case: the node is the root node
+            if (parent == NULL) { RB_RECOLOR(tree, node, RED); }
+
+            // General case:
+            else {
+
+                // Case 1.0: Node has no sister
+                if (sister == NULL) {
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+                    
+                // Case 1.1: Sister has 2 BLACK children
+                } else if (IS_BLACK(RB_LEFT(sister)) && IS_BLACK(sister->right)){
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, sister, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+
+                // Case 1.2: Sister has at least 1 RED children
+                } else {
+
+                    // If sister->left is RED:
+                    if (IS_RED(RB_LEFT(sister))) {
+
+                        // If sister == parent->right: Double rotation
+                        if (comp < 0) {
+                            STATS_ADD(tree, rotations, 2);
+
+                            if  (granpa == NULL) { tree->root    = RB_LEFT(sister); }
+                            else if (comp_n < 0) { RB_SET_LEFT(granpa, RB_LEFT(sister)); }
+                            else                 { granpa->right = RB_LEFT(sister); }
+                            granpa = RB_LEFT(sister);
+                            
+                            parent->right = RB_LEFT(granpa);
+                            RB_SET_LEFT(granpa, parent);
+
+                            RB_SET_LEFT(sister, granpa->right);
+                            granpa->right = sister;
+                            sister        = parent->right;
+                            RB_UPDATE_SIZE(parent);
+                            RB_UPDATE_SIZE(granpa->right);
+                            RB_UPDATE_SIZE(granpa);
+                            
+                            RB_RECOLOR(tree, node, RED);
+                            RB_RECOLOR(tree, parent, BLACK);
+                        }
+
+                        // If sister == parent->left: Single rotation
+                        else {
+                            STATS_ADD(tree, rotations, 1);
+
+                            if  (granpa == NULL) { tree->root    = sister; }
+                            else if (comp_n < 0) { RB_SET_LEFT(granpa, sister); }
+                            else                 { granpa->right = sister; }
+                            granpa = sister;
+                            
+                            RB_SET_LEFT(parent, granpa->right);
+                            granpa->right = parent;
+                            sister        = RB_LEFT(parent);
+                            RB_UPDATE_SIZE(parent);
+                            RB_UPDATE_SIZE(granpa);
+                            
+                            RB_RECOLOR(tree, node, RED);
+                            RB_RECOLOR(tree, granpa, RED);
+                            RB_RECOLOR(tree, parent, BLACK);
+                            RB_RECOLOR(tree, RB_LEFT(granpa), BLACK);
+                        }
+                    }
+
+                    // If sister->right is RED:
+                    else {
+
+                        // If sister == parent->left: Double rotation
+                        if (comp > 0) {
+                            STATS_ADD(tree, rotations, 2);
+
+                            if  (granpa == NULL) { tree->root    = sister->right; }
+                            else if (comp_n < 0) { RB_SET_LEFT(granpa, sister->right); }
+                            else                 { granpa->right = sister->right; }
+                            granpa = sister->right;
+                            
+                            RB_SET_LEFT(parent, granpa->right);
+                            granpa->right = parent;
+
+                            sister->right = RB_LEFT(granpa);
+                            RB_SET_LEFT(granpa, sister);
+                            sister        = RB_LEFT(parent);
+                            RB_UPDATE_SIZE(parent);
+                            RB_UPDATE_SIZE(RB_LEFT(granpa));
+                            RB_UPDATE_SIZE(granpa);
+                            
+                            RB_RECOLOR(tree, node, RED);
+                            RB_RECOLOR(tree, parent, BLACK);
+                        }
+
+                        // If sister == parent->right: Single rotation
+                        else {
+                            STATS_ADD(tree, rotations, 1);
+
+                            if  (granpa == NULL) { tree->root    = sister; }
+                            else if (comp_n < 0) { RB_SET_LEFT(granpa, sister); }
+                            else                 { granpa->right = sister; }
+                            granpa = sister;
+                            
+                            parent->right = RB_LEFT(granpa);
+                            RB_SET_LEFT(granpa, parent);
+                            sister        = parent->right;
+                            RB_UPDATE_SIZE(parent);
+                            RB_UPDATE_SIZE(granpa);
+
+                            RB_RECOLOR(tree, node, RED);
+                            RB_RECOLOR(tree, granpa, RED);
+                            RB_RECOLOR(tree, parent, BLACK);
+                            RB_RECOLOR(tree, granpa->right, BLACK);
+                        }
+                    }
+                }
+            }
+        }
+
+        // We compare the data now because we need the information for "Case 2"
+
+        // Compare data unless you already know where to go:
+        comp_n = comp;
+        comp   = (old_data == NULL) ? PREFIX_COMPARE(tree, kp, data, node)
+                                    : (-1);
+
+        // If we have found the node to remove: Remember it!
+        if (comp == 0) {
+            old_data = node->data;
+            old_node = node;
+            comp     = +1;   // ...and search the successor
+        }
+        
+        // Case 2: Node has at least one RED children
+        if (IS_RED(RB_LEFT(node)) || IS_RED(node->right)) {
+
+            // Again node is BLACK, if sister exists is BLACK and if parent
+            // exists is RED. We paint node RED and repair any violation.
+
+            // Case 2.1: We are moving to the RED node
+            if ((comp < 0 && IS_RED(RB_LEFT(node) )) ||
+                (comp > 0 && IS_RED(node->right)) ){
+
+                // Move and compare again for free!
+                depth++;
+                granpa = parent;
+                parent = node;
+                if (comp < 0) {
+                    node   = RB_LEFT(parent);
+                    sister = parent->right;
+                } else if (comp > 0) {
+                    node   = parent->right;
+                    sister = RB_LEFT(parent);
+                }
+                comp_n = comp;
+                comp   = (old_data == NULL) ?
+                         PREFIX_COMPARE(tree, kp, data, node) : (-1);
+                if (comp == 0) {
+                    old_data = node->data;
+                    old_node = node;
+                    comp     = +1;
+                }
+            }
+            
+            // Case 2.2: We are moving to the BLACK node
+            else {
+                // If we are moving to the left: Single left-rotation
+                if (comp < 0) {
+                    STATS_ADD(tree, rotations, 1);
+                    if  (parent == NULL) { tree->root    = node->right; }
+                    else if (comp_n < 0) { RB_SET_LEFT(parent, node->right); }
+                    else                 { parent->right = node->right; }
+                    granpa        = parent;
+                    parent        = node->right;
+                    sister        = parent->right;
+                    node->right   = RB_LEFT(parent);
+                    RB_SET_LEFT(parent, node);
+                    RB_UPDATE_SIZE(node);
+                    RB_UPDATE_SIZE(parent);
+                                        
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+
+                    comp_n = -1;
+                }
+
+                // If we are moving to the right: Single right-rotation
+                else {
+                    STATS_ADD(tree, rotations, 1);
+                    if  (parent == NULL) { tree->root    = RB_LEFT(node); }
+                    else if (comp_n < 0) { RB_SET_LEFT(parent, RB_LEFT(node)); }
+                    else                 { parent->right = RB_LEFT(node); }
+                    granpa        = parent;
+                    parent        = RB_LEFT(node);
+                    sister        = RB_LEFT(parent);
+                    RB_SET_LEFT(node, parent->right);
+                    parent->right = node;
+                    RB_UPDATE_SIZE(node);
+                    RB_UPDATE_SIZE(parent);
+                                        
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+
+                    comp_n = 1;
+                }                
+            }
+        }
+
+        // ...and finally move!
+        granpa = parent;
+        parent = node;
+        if (comp < 0) {
+            node   = RB_LEFT(parent);
+            sister = parent->right;
+        } else if (comp > 0) {
+            node   = parent->right;
+            sister = RB_LEFT(parent);
+        }
+    }
+
+    // Erase "parent", which should be RED:
+    if (old_node != NULL) {
+        old_node->data = parent->data;
+        COPY_PREFIX(old_node, parent);
+        if      (granpa       == NULL)   { tree->root    = parent->right; }
+        else if (RB_LEFT(granpa) == parent) { RB_SET_LEFT(granpa, parent->right); }
+        else                             { granpa->right = parent->right; }
+        if (old_node == parent) { old_node = NULL; }
+        free_rb_node(tree, parent);
+        rb_fix_min_max(tree);
+
+        // Update the sizes of the path to the erased node:
+        RB_UPDATE_PATH(tree, data, kp, old_node, 0);
+    }
+    
+    // Count the search:
+    STATS_SEARCH(tree, depth);
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Removes the smallest element from "tree" and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+// More efficient than "tree_remove(tree, min_elem)" even if you already know
+// the value of "min_elem".
+//
+void *rb_tree_remove_min(rb_tree *tree) {
+
+    rb_node *granpa   = NULL;   //      granpa      //
+    rb_node *parent   = NULL;   //        |         //
+    rb_node *sister   = NULL;   //      parent      //
+    rb_node *node     = NULL;   //      /    \      // 
+    void    *old_data = NULL;   //   node  sister   //
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Initialize the search at the root node:
+    node = tree->root;
+    if (node == NULL) { return NULL; }
+    
+    // Look for a leaf:
+    while (node != NULL) {
+
+        // At this point node is BLACK, if sister exists is BLACK and if parent 
+        // exists is RED. We want to paint node RED and repair any violation.
+
+        // Case 1: Node has two BLACK children
+        if (IS_BLACK(RB_LEFT(node)) && IS_BLACK(node->right)) {
+
+            // Easy case: the node is the root node
+            if (parent == NULL) { RB_RECOLOR(tree, node, RED); }
+
+            // General case:
+            else {
+
+                // Case 1.0: Node has no sister
+                if (sister == NULL) {
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+                    
+                // Case 1.1: Sister has 2 BLACK children
+                } else if (IS_BLACK(RB_LEFT(sister)) && IS_BLACK(sister->right)){
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, sister, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+
+                // Case 1.2: Sister has at least 1 RED children
+                } else {
+
+                    // If sister->left is RED:
+                    if (IS_RED(RB_LEFT(sister))) {
+
+                        // Sister == parent->right: Double rotation
+                        STATS_ADD(tree, rotations, 2);
+                        if  (granpa == NULL) { tree->root    = RB_LEFT(sister); }
+                        else                 { RB_SET_LEFT(granpa, RB_LEFT(sister)); }
+                        granpa = RB_LEFT(sister);
+                        
+                        parent->right = RB_LEFT(granpa);
+                        RB_SET_LEFT(granpa, parent);
+
+                        RB_SET_LEFT(sister, granpa->right);
+                        granpa->right = sister;
+                        sister        = parent->right;
+                        RB_UPDATE_SIZE(parent);
+                        RB_UPDATE_SIZE(granpa->right);
+                        RB_UPDATE_SIZE(granpa);
+                        
+                        RB_RECOLOR(tree, node, RED);
+                        RB_RECOLOR(tree, parent, BLACK);
+                    }
+
+                    // If sister->right is RED:
+                    else {
+
+                        // Sister == parent->right: Single rotation
+                        STATS_ADD(tree, rotations, 1);
+                        if  (granpa == NULL) { tree->root    = sister; }
+                        else                 { RB_SET_LEFT(granpa, sister); }
+                        granpa = sister;
+
+                        parent->right = RB_LEFT(granpa);
+                        RB_SET_LEFT(granpa, parent);
+                        sister        = parent->right;
+                        RB_UPDATE_SIZE(parent);
+                        RB_UPDATE_SIZE(granpa);
+
+                        RB_RECOLOR(tree, node, RED);
+                        RB_RECOLOR(tree, granpa, RED);
+                        RB_RECOLOR(tree, parent, BLACK);
+                        RB_RECOLOR(tree, granpa->right, BLACK);
+                    }
+                }
+            }
+        }
+
+        // Case 2: Node has at least one RED children
+        if (IS_RED(RB_LEFT(node)) || IS_RED(node->right)) {
+
+            // Again node is BLACK, if sister exists is BLACK and if parent
+            // exists is RED. We paint node RED and repair any violation.
+
+            // Case 2.1: We are moving to the RED node
+            if (IS_RED(RB_LEFT(node))){
+
+                // Move and compare again for free!
+                granpa = parent;
+                parent = node;
+                node   = RB_LEFT(parent);
+                sister = parent->right;
+            }
+            
+            // Case 2.2: We are moving to the BLACK node
+            else {
+                // We are moving to the left: Single left-rotation
+                STATS_ADD(tree, rotations, 1);
+                if  (parent == NULL) { tree->root    = node->right; }
+                else                 { RB_SET_LEFT(parent, node->right); }
+                granpa        = parent;
+                parent        = node->right;
+                sister        = parent->right;
+                node->right   = RB_LEFT(parent);
+                RB_SET_LEFT(parent, node);
+                RB_UPDATE_SIZE(node);
+                RB_UPDATE_SIZE(parent);
+                                    
+                RB_RECOLOR(tree, node, RED);
+                RB_RECOLOR(tree, parent, BLACK);
+            }
+        }
+
+        // ...and finally move!
+        granpa = parent;
+        parent = node;
+        node   = RB_LEFT(parent);
+        sister = parent->right;
+    }
+
+    // Erase "parent", which should be RED (its right child, if any, or
+    // "granpa" becomes the smallest node):
+    old_data = parent->data;
+    node     = (parent->right != NULL) ? parent->right : granpa;
+    if (granpa == NULL) { tree->root   = parent->right; }
+    else                { RB_SET_LEFT(granpa, parent->right); }
+    free_rb_node(tree, parent);
+#ifdef TREE_MIN_MAX
+    tree->leftmost = node;
+#endif
+    rb_fix_min_max(tree);
+
+    // Update the sizes of the left spine:
+    RB_UPDATE_PATH(tree, NULL, 0, NULL, -1);
+    
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Removes the biggest element from "tree" and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+// More efficient than "tree_remove(tree, max_data)" even if you already know
+// the value of "max_data".
+//
+void *rb_tree_remove_max(rb_tree *tree) {
+
+    rb_node *granpa   = NULL;   //      granpa      //
+    rb_node *parent   = NULL;   //        |         //
+    rb_node *sister   = NULL;   //      parent      //
+    rb_node *node     = NULL;   //      /    \      // 
+    void    *old_data = NULL;   //   sister node    //
+
+    // Sanity Check:
+    assert(tree != NULL);
+    
+    // Initialize the search at the root node:
+    node = tree->root;
+    if (node == NULL) { return NULL; }
+    
+    // Look for a leaf:
+    while (node != NULL) {
+
+        // At this point node is BLACK, if sister exists is BLACK and if parent 
+        // exists is RED. We want to paint node RED and repair any violation.
+
+        // Case 1: Node has two BLACK children
+        if (IS_BLACK(RB_LEFT(node)) && IS_BLACK(node->right)) {
+
+            // Easy case: the node is the root node
+            if (parent == NULL) { RB_RECOLOR(tree, node, RED); }
+
+            // General case:
+            else {
+
+                // Case 1.0: Node has no sister
+                if (sister == NULL) {
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+                    
+                // Case 1.1: Sister has 2 BLACK children
+                } else if (IS_BLACK(RB_LEFT(sister)) && IS_BLACK(sister->right)){
+                    RB_RECOLOR(tree, node, RED);
+                    RB_RECOLOR(tree, sister, RED);
+                    RB_RECOLOR(tree, parent, BLACK);
+
+                // Case 1.2: Sister has at least 1 RED children
+                } else {
+
+                    // If sister->left is RED:
+                    if (IS_RED(RB_LEFT(sister))) {
+
+                        // Sister == parent->left: Single rotation
+                        STATS_ADD(tree, rotations, 1);
+                        if  (granpa == NULL) { tree->root    = sister; }
+                        else                 { granpa->right = sister; }
+                        granpa = sister;
+                        
+                        RB_SET_LEFT(parent, granpa->right);
+                        granpa->right = parent;
+                        sister        = RB_LEFT(parent);
+                        RB_UPDATE_SIZE(parent);
+                        RB_UPDATE_SIZE(granpa);
+                        
+                        RB_RECOLOR(tree, node, RED);
+                        RB_RECOLOR(tree, granpa, RED);
+                        RB_RECOLOR(tree, parent, BLACK);
+                        RB_RECOLOR(tree, RB_LEFT(granpa), BLACK);
+                    }
+
+                    // If sister->right is RED:
+                    else {
+
+                        // If sister == parent->left: Double rotation
+                        STATS_ADD(tree, rotations, 2);
+                        if  (granpa == NULL) { tree->root    = sister->right; }
+                        else                 { granpa->right = sister->right; }
+                        granpa = sister->right;
+                        
+                        RB_SET_LEFT(parent, granpa->right);
+                        granpa->right = parent;
+
+                        sister->right = RB_LEFT(granpa);
+                        RB_SET_LEFT(granpa, sister);
+                        sister        = RB_LEFT(parent);
+                        RB_UPDATE_SIZE(parent);
+                        RB_UPDATE_SIZE(RB_LEFT(granpa));
+                        RB_UPDATE_SIZE(granpa);
+                        
+                        RB_RECOLOR(tree, node, RED);
+                        RB_RECOLOR(tree, parent, BLACK);
+                    }
+                }
+            }
+        }
+
+        // Case 2: Node has at least one RED children
+        if (IS_RED(RB_LEFT(node)) || IS_RED(node->right)) {
+
+            // Again node is BLACK, if sister exists is BLACK and if parent
+            // exists is RED. We paint node RED and repair any violation.
+
+            // Case 2.1: We are moving to the RED node
+            if (IS_RED(node->right)){
+
+                // Move and compare again for free!
+                granpa = parent;
+                parent = node;
+                node   = parent->right;
+                sister = RB_LEFT(parent);
+            }
+            
+            // Case 2.2: We are moving to the BLACK node
+            else {
+                // we are moving to the right: Single right-rotation
+                STATS_ADD(tree, rotations, 1);
+                if  (parent == NULL) { tree->root    = RB_LEFT(node); }
+                else                 { parent->right = RB_LEFT(node); }
+                granpa        = parent;
+                parent        = RB_LEFT(node);
+                sister        = RB_LEFT(parent);
+                RB_SET_LEFT(node, parent->right);
+                parent->right = node;
+                RB_UPDATE_SIZE(node);
+                RB_UPDATE_SIZE(parent);
+                                    
+                RB_RECOLOR(tree, node, RED);
+                RB_RECOLOR(tree, parent, BLACK);
+            }
+        }
+
+        // ...and finally move!
+        granpa = parent;
+        parent = node;
+        node   = parent->right;
+        sister = RB_LEFT(parent);
+    }
+
+    // Erase "parent", which should be RED (its left child, if any, or
+    // "granpa" becomes the biggest node):
+    old_data = parent->data;
+    node     = (RB_LEFT(parent) != NULL) ? RB_LEFT(parent) : granpa;
+    if (granpa == NULL) { tree->root    = RB_LEFT(parent); }
+    else                { granpa->right = RB_LEFT(parent); }
+    free_rb_node(tree, parent);
+#ifdef TREE_MIN_MAX
+    tree->rightmost = node;
+#endif
+    rb_fix_min_max(tree);
+
+    // Update the sizes of the right spine:
+    RB_UPDATE_PATH(tree, NULL, 0, NULL, +1);
+    
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Removes all the elements from the tree in linear time. This is faster than
+// calling "tree_remove_min(tree)" until "tree_is_empty(tree)" returns "YES".
+//
+// If you provide a "free_data" function it will be used to free the "data"
+// inside each node. If "free_data" is NULL, no "data" will be freed. Use this
+// later option when "data" is shared between several data structures but be
+// aware that this may cause some memory leaks if you are not carefull.
+//
+// Most of the time, you can use just "free" as "free_data" function.
+// However if your "data" struct contains dinamically allocated data
+// you may need to provide a more complex "free_data" function like:
+//
+//  void free_data(void *ptr) {
+//      MyData *data = (MyData *) ptr;
+//      free(data->some_array);
+//      free(data->some_other_array);
+//      free(data);
+//  }
+//
+void rb_tree_remove_all(rb_tree *tree, void (* free_data) (void *)) {
+
+    rb_node *root;
+    rb_node *left;
+    rb_node *right;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Initialize:
+    root = tree->root;
+    tree->root = NULL;
+    MINMAX_CLEAR(tree);
+
+    // Pooled nodes are freed slab by slab, so only visit them to free data:
+    if (tree->pool != NULL && free_data == NULL) { root = NULL; }
+
+    // While the tree is not empty:
+    while (root != NULL) {
+
+        // Unravel the tree: Rotate right "root" & "left"
+        if (RB_LEFT(root) != NULL) {
+            left        = RB_LEFT(root);
+            right       = left->right;
+            left->right = root;
+            RB_SET_LEFT(root, right);
+            root        = left;
+
+        // Erase the current "root" node:
+        } else {
+            right = root->right;
+            if (free_data != NULL) { free_data(root->data); }
+            if (tree->pool == NULL) { free(root); }
+            root = right;
+        }
+    }
+
+    // Release all the slabs of the pool at once:
+    if (tree->pool != NULL) { node_pool_clear(tree->pool); }
+}
+
+
+
+// SET FUNCTIONS:
+
+// Returns a rb_tree containing a copy of the union of tree_1 and tree_2.
+// It does NOT modify tree_1 or tree_2.
+//
+// If a given "element" is in both trees it takes the pointer from tree_1.
+// Likewise, the new tree stores a pointer to the comparing function of tree_1.
+//
+// It takes O( MAX{ |tree_1|+|tree_2|, |Union|·Log(|Union|) } ) time.
+//
+rb_tree *rb_tree_union(const rb_tree *tree_1, const rb_tree *tree_2) {
+
+    rb_tree   *tree = NULL;
+    rb_walker  walker_1;
+    rb_node   *node_1;
+    rb_walker  walker_2;
+    rb_node   *node_2;
+    void      *data;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return rb_tree_copy(tree_1); }
+
+    // Create a new tree:
+    tree = new_rb_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            data = node_1->data;
+            data = rb_tree_insert_max(tree, data);
+            assert(data == NULL);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // insert node_2->data in tree /////////////////////////////////////
+            data = node_2->data;
+            data = rb_tree_insert_max(tree, data);
+            assert(data == NULL);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            data = node_1->data;
+            data = rb_tree_insert_max(tree, data);
+            assert(data == NULL);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        data = node_1->data;
+        data = rb_tree_insert_max(tree, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = rb_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Insert all remaining data from tree_2:
+    while (node_2 != NULL) {
+
+        // insert node_2->data in tree /////////////////////////////////////////
+        data = node_2->data;
+        data = rb_tree_insert_max(tree, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_2 //////////////////////////////////////////////////////
+        node_2 = rb_walker_next(&walker_2);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a rb_tree containing a copy of the intersection of tree_1 and tree_2.
+// It does NOT modify tree_1 or tree_2.
+//
+// The comparing function and all data pointers are taken from tree_1.
+//
+// It takes O( MAX{ |tree_1|+|tree_2|, |Intersec|·Log(|Intersec|) } ) time.
+//
+rb_tree *rb_tree_intersection(const rb_tree *tree_1, const rb_tree *tree_2) {
+
+    rb_tree   *tree = NULL;
+    rb_walker  walker_1;
+    rb_node   *node_1;
+    rb_walker  walker_2;
+    rb_node   *node_2;
+    void      *data;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return rb_tree_copy(tree_1); }
+
+    // Create a new tree:    
+    tree = new_rb_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Some of them is empty
+    if (rb_tree_is_empty(tree_1) == YES) { return tree; }
+    if (rb_tree_is_empty(tree_2) == YES) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            data = node_1->data;
+            data = rb_tree_insert_max(tree, data);
+            assert(data == NULL);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a rb_tree containing a copy of the difference: tree_1 - tree_2.
+// It does NOT modify tree_1 or tree_2.
+//
+// The comparing function and all data pointers are taken from tree_1.
+//
+// It takes O( MAX{ |tree_1|+|tree_2|, |Diff|·Log(|Diff|) } ) time.
+//
+rb_tree *rb_tree_diff(const rb_tree *tree_1, const rb_tree *tree_2) {
+
+    rb_tree   *tree = NULL;
+    rb_walker  walker_1;
+    rb_node   *node_1;
+    rb_walker  walker_2;
+    rb_node   *node_2;
+    void      *data;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Create a new tree:
+    tree = new_rb_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return tree; }
+
+    // Special case: tree_1 is empty
+    if (rb_tree_is_empty(tree_1) == YES) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_first(&walker_2, tree_2->root);
+    
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            data = node_1->data;
+            data = rb_tree_insert_max(tree, data);
+            assert(data == NULL);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        data = node_1->data;
+        data = rb_tree_insert_max(tree, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = rb_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a rb_tree containing a copy of the symmetric difference of tree_1
+// and tree_2. It does NOT modify tree_1 or tree_2.
+//
+// The comparing function is taken from tree_1.
+//
+// It takes O( MAX{ |tree_1|+|tree_2|, |SymDiff|·Log(|SymDiff|) } ) time.
+//
+rb_tree *rb_tree_sym_diff(const rb_tree *tree_1, const rb_tree *tree_2) {
+
+    rb_tree   *tree = NULL;
+    rb_walker  walker_1;
+    rb_node   *node_1;
+    rb_walker  walker_2;
+    rb_node   *node_2;
+    void      *data;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Create a new tree:
+    tree = new_rb_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            data = node_1->data;
+            data = rb_tree_insert_max(tree, data);
+            assert(data == NULL);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // insert node_2->data in tree /////////////////////////////////////
+            data = node_2->data;
+            data = rb_tree_insert_max(tree, data);
+            assert(data == NULL);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = rb_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = rb_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        data = node_1->data;
+        data = rb_tree_insert_max(tree, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = rb_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Insert all remaining data from tree_2:
+    while (node_2 != NULL) {
+
+        // insert node_2->data in tree /////////////////////////////////////////
+        data = node_2->data;
+        data = rb_tree_insert_max(tree, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_2 //////////////////////////////////////////////////////
+        node_2 = rb_walker_next(&walker_2);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+
+// SPLIT & JOIN:
+
+// The following functions move nodes between trees instead of copying them,
+// so they take time proportional to the height of the trees (split & join)
+// or O(m·log(n/m + 1)) time (join-based set functions, where m <= n are the
+// sizes of both trees) instead of O(n + m) time.
+//
+// Internally they work with subtrees: a BLACK root node (or NULL) and its
+// black height (the number of BLACK nodes in any path from the root to a
+// leaf, root included). Unlike the rest of the library, some of them are
+// recursive, but the depth of the recursion is bounded by O(log(n)).
+//
+// Every node must go back to the allocator it came from (its node pool or
+// free), so when a pooled tree is involved, the nodes that change trees are
+// first moved to the allocator of the tree that receives them. That takes
+// time proportional to the number of nodes moved, but nothing else changes.
+//
+// If RB_THREADS is defined at compile time (remember to link with -pthread),
+// the join-based set functions run the two halves of the biggest subproblems
+// in parallel threads. In that case the comparing function and the
+// "free_data" function must be thread-safe. Node pools are not, so the set
+// functions always run in a single thread if the first tree has a pool.
+
+#define RB_UNION            0   // Types of join-based set functions
+#define RB_INTERSECTION     1   //
+#define RB_DIFF             2   //
+#define RB_SYM_DIFF         3   //
+
+#ifdef RB_THREADS
+    #define RB_THREADS_DEPTH    3   // Use at most 2^3 threads
+    #define RB_THREADS_HEIGHT   8   // Only fork subtrees with black height >= 8
+#endif
+
+// Arguments (and result) of a join-based set function:
+typedef struct rb_set_op {
+    int      type;                              // RB_UNION, RB_DIFF...
+    rb_node *root_1;                            // First subtree (and result)
+    int      height_1;                          // Its black height
+    rb_node *root_2;                            // Second subtree
+    int      height_2;                          // Its black height
+    int (* comp) (const void *, const void *);  // Comparing function
+    void (* free_data) (void *);                // Freeing function (or NULL)
+    node_pool *pool;                            // Pool of the nodes (or NULL)
+    int      depth;                             // Number of forks left
+} rb_set_op;
+
+// Returns the black height of the subtree rooted at node.
+//
+static int rb_black_height(const rb_node *node) {
+
+    int height = 0;
+
+    while (node != NULL) {
+        if (RB_COLOR(node) == BLACK) { height++; }
+        node = RB_LEFT(node);
+    }
+    return height;
+}
+
+// This is an auxiliary function that turns child (a child of a BLACK node
+// with black height "height") into a subtree: it paints it BLACK and returns
+// its black height.
+//
+static int rb_subtree(rb_node *child, int height) {
+
+    if (IS_RED(child)) {
+        RB_SET_COLOR(child, BLACK);
+        return height;
+    }
+    return height - 1;
+}
+
+// This is an auxiliary function that releases a node of a join-based set
+// function to its node pool (or to free if "pool" is NULL).
+//
+static void rb_release_node(node_pool *pool, rb_node *node) {
+    if (pool == NULL) { free(node); }
+    else              { node_pool_free(pool, node); }
+}
+
+// This is an auxiliary function that frees all the nodes of a subtree (and
+// their data if "free_data" is not NULL) in linear time.
+//
+static void rb_free_subtree(rb_node *root, void (* free_data) (void *),
+                            node_pool *pool) {
+
+    rb_node *left;
+    rb_node *right;
+
+    // While the tree is not empty:
+    while (root != NULL) {
+
+        // Unravel the tree: Rotate right "root" & "left"
+        if (RB_LEFT(root) != NULL) {
+            left        = RB_LEFT(root);
+            right       = left->right;
+            left->right = root;
+            RB_SET_LEFT(root, right);
+            root        = left;
+
+        // Erase the current "root" node:
+        } else {
+            right = root->right;
+            if (free_data != NULL) { free_data(root->data); }
+            rb_release_node(pool, root);
+            root = right;
+        }
+    }
+}
+
+// This is an auxiliary function that moves the nodes of the subtree "*root"
+// from the allocator of tree "from" to the allocator of tree "to" (see NODE
+// ALLOCATION) and stores the new root in "*root". The shape, colors and
+// sizes of the subtree do not change. It takes O(|subtree|) time.
+//
+// All the new nodes are allocated before touching anything, so if there is
+// not enough memory it returns NO and leaves the subtree as it was.
+// Otherwise it returns YES.
+//
+static int rb_move_subtree(rb_tree *from, rb_tree *to, rb_node **root) {
+
+    rb_node   *stack[RB_WALKER_HEIGHT + 1];
+    rb_node   *spare = NULL;
+    rb_node   *node;
+    rb_node   *child;
+    rb_walker  walker;
+    int        size  = 0;
+
+    // Allocate a new node for every node of the subtree (in a list linked
+    // through their right pointers):
+    node = rb_walker_first(&walker, *root);
+    while (node != NULL) {
+        child = new_rb_node(to);
+        if (child == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
+            while (spare != NULL) {
+                child = spare;
+                spare = spare->right;
+                free_rb_node(to, child);
+            }
+            return NO;
+        }
+        child->right = spare;
+        spare        = child;
+        node = rb_walker_next(&walker);
+    }
+
+    // Trivial case: empty subtree
+    if (*root == NULL) { return YES; }
+
+    // Replace the root:
+    node  = spare;
+    spare = spare->right;
+    *node = **root;
+    free_rb_node(from, *root);
+    *root = node;
+
+    // Replace the children of every new node (in pre-order):
+    stack[size++] = node;
+    while (size > 0) {
+        node = stack[--size];
+        if (RB_LEFT(node) != NULL) {
+            child  = spare;
+            spare  = spare->right;
+            *child = *RB_LEFT(node);
+            free_rb_node(from, RB_LEFT(node));
+            RB_SET_LEFT(node, child);
+            stack[size++] = child;
+        }
+        if (node->right != NULL) {
+            child  = spare;
+            spare  = spare->right;
+            *child = *(node->right);
+            free_rb_node(from, node->right);
+            node->right = child;
+            stack[size++] = child;
+        }
+        assert(size <= RB_WALKER_HEIGHT);
+    }
+    assert(spare == NULL);
+
+    return YES;
+}
+
+// This is an auxiliary function that gets tree_2 ready to give its nodes to
+// tree_1: if any of them has a node pool, the nodes of tree_2 are moved to
+// the allocator of tree_1 (and the pool of tree_2 is emptied). Returns NO
+// (leaving both trees untouched) if there is not enough memory.
+//
+static int rb_tree_adopt(rb_tree *tree_1, rb_tree *tree_2) {
+
+    // Trivial case: both trees use free
+    if (tree_1->pool == NULL && tree_2->pool == NULL) { return YES; }
+
+    // General case: move the nodes
+    if (rb_move_subtree(tree_2, tree_1, &(tree_2->root)) == NO) { return NO; }
+    if (tree_2->pool != NULL) { node_pool_clear(tree_2->pool); }
+    MINMAX_CLEAR(tree_2);
+    return YES;
+}
+
+// Joins the subtrees "left" and "right" using "mid" as their middle node and
+// returns the root of the resulting subtree (and its black height in
+// "height"). All the elements of "left" must be smaller than "mid" and all
+// the elements of "right" must be bigger than "mid".
+//
+// It goes down the spine of the taller subtree until it finds a BLACK node
+// with the same black height as the other subtree, hangs "mid" (painted RED)
+// there and repairs any RED violation going up. It takes O(|hl - hr| + 1).
+//
+static rb_node *rb_join_subtrees(rb_node *left, int hl, rb_node *mid,
+                                 rb_node *right, int hr, int *height) {
+
+    rb_node *path[RB_WALKER_HEIGHT];
+    rb_node *root;
+    rb_node *node;
+    rb_node *parent;
+    rb_node *granpa;
+    rb_node *uncle;
+    size_t   size = 0;
+    size_t   i;
+    int      h;
+
+    // Easy case: both subtrees have the same black height
+    if (hl == hr) {
+        RB_SET_LEFT(mid, left);
+        mid->right = right;
+        RB_SET_COLOR(mid, BLACK);
+        RB_UPDATE_SIZE(mid);
+        *height = hl + 1;
+        return mid;
+    }
+
+    // Left is taller: Go down its right spine and hang "mid" there
+    if (hl > hr) {
+        root = left;
+        node = left;
+        h    = hl;
+        while (IS_RED(node) || h > hr) {
+            assert(size < RB_WALKER_HEIGHT);
+            path[size] = node;
+            size++;
+            if (RB_COLOR(node) == BLACK) { h--; }
+            node = node->right;
+        }
+        RB_SET_LEFT(mid, node);
+        mid->right = right;
+        path[size - 1]->right = mid;
+
+    // Right is taller: Go down its left spine and hang "mid" there
+    } else {
+        root = right;
+        node = right;
+        h    = hr;
+        while (IS_RED(node) || h > hl) {
+            assert(size < RB_WALKER_HEIGHT);
+            path[size] = node;
+            size++;
+            if (RB_COLOR(node) == BLACK) { h--; }
+            node = RB_LEFT(node);
+        }
+        RB_SET_LEFT(mid, left);
+        mid->right = node;
+        RB_SET_LEFT(path[size - 1], mid);
+    }
+    RB_SET_COLOR(mid, RED);
+
+    // Update the sizes of the path:
+    RB_UPDATE_SIZE(mid);
+    for (i = size; i > 0; i--) { RB_UPDATE_SIZE(path[i - 1]); }
+
+    // Repair any violation of the RED property going up:
+    while (size > 0 && IS_RED(path[size - 1])) {
+
+        // Since the root is BLACK, a RED parent always has a granpa:
+        assert(size >= 2);
+        parent = path[size - 1];
+        granpa = path[size - 2];
+        uncle  = (hl > hr) ? RB_LEFT(granpa) : granpa->right;
+
+        // Case 1: RED uncle, make a color flip and go up
+        if (IS_RED(uncle)) {
+            RB_SET_COLOR(parent, BLACK);
+            RB_SET_COLOR(uncle,  BLACK);
+            RB_SET_COLOR(granpa, RED);
+            size -= 2;
+
+        // Case 2: BLACK uncle, rotate "granpa-parent" and stop
+        } else {
+            if (hl > hr) {
+                granpa->right = RB_LEFT(parent);
+                RB_SET_LEFT(parent, granpa);
+            } else {
+                RB_SET_LEFT(granpa, parent->right);
+                parent->right = granpa;
+            }
+            RB_SET_COLOR(granpa, RED);
+            RB_SET_COLOR(parent, BLACK);
+            RB_UPDATE_SIZE(granpa);
+            RB_UPDATE_SIZE(parent);
+
+            if      (size == 2) { root = parent; }
+            else if (hl > hr)   { path[size - 3]->right = parent; }
+            else                { RB_SET_LEFT(path[size - 3], parent); }
+            break;
+        }
+    }
+
+    // Before leaving: Make sure that the root is BLACK!
+    *height = (hl > hr) ? hl : hr;
+    if (IS_RED(root)) {
+        RB_SET_COLOR(root, BLACK);
+        (*height)++;
+    }
+    return root;
+}
+
+// Splits the subtree "root" into the subtree of the elements smaller than
+// data ("left") and the subtree of the elements bigger than data ("right").
+// Returns the node that compares "equal" to data (or NULL if not found)
+// detached from both subtrees. It takes O(log(n)) time.
+//
+static rb_node *rb_split_subtree(rb_node *root, int height, const void *data,
+                                 int (* comp) (const void *, const void *),
+                                 rb_node **left,  int *hl,
+                                 rb_node **right, int *hr) {
+
+    rb_node *found;
+    rb_node *node_l;
+    rb_node *node_r;
+    int      height_l;
+    int      height_r;
+    int      comp_n;
+
+    // Trivial case: empty subtree
+    if (root == NULL) {
+        *left  = NULL;
+        *right = NULL;
+        *hl    = 0;
+        *hr    = 0;
+        return NULL;
+    }
+
+    // Turn both children of root into subtrees:
+    node_l   = RB_LEFT(root);
+    node_r   = root->right;
+    height_l = rb_subtree(node_l, height);
+    height_r = rb_subtree(node_r, height);
+
+    // Compare data with the root:
+    comp_n = comp(data, root->data);
+
+    // Data is smaller: split the left subtree and join the rest to the right
+    if (comp_n < 0) {
+        found  = rb_split_subtree(node_l, height_l, data, comp,
+                                  left, hl, right, hr);
+        *right = rb_join_subtrees(*right, *hr, root, node_r, height_r, hr);
+
+    // Data is bigger: split the right subtree and join the rest to the left
+    } else if (comp_n > 0) {
+        found  = rb_split_subtree(node_r, height_r, data, comp,
+                                  left, hl, right, hr);
+        *left  = rb_join_subtrees(node_l, height_l, root, *left, *hl, hl);
+
+    // We have found the node:
+    } else {
+        found  = root;
+        *left  = node_l;
+        *hl    = height_l;
+        *right = node_r;
+        *hr    = height_r;
+    }
+
+    return found;
+}
+
+// Detaches the biggest node of the subtree "root" (and stores it in "last").
+// Returns the root of the remaining subtree (and its black height in
+// "height_out"). It takes O(log(n)) time.
+//
+static rb_node *rb_split_last(rb_node *root, int height, rb_node **last,
+                              int *height_out) {
+
+    rb_node *node_l;
+    rb_node *node_r;
+    int      height_l;
+    int      height_r;
+
+    // Turn both children of root into subtrees:
+    node_l   = RB_LEFT(root);
+    node_r   = root->right;
+    height_l = rb_subtree(node_l, height);
+    height_r = rb_subtree(node_r, height);
+
+    // If there is no right subtree, root is the biggest node:
+    if (node_r == NULL) {
+        *last       = root;
+        *height_out = height_l;
+        return node_l;
+    }
+
+    // Otherwise, detach the biggest node of the right subtree:
+    node_r = rb_split_last(node_r, height_r, last, &height_r);
+    return rb_join_subtrees(node_l, height_l, root, node_r, height_r,
+                            height_out);
+}
+
+// Joins the subtrees "left" and "right" (without a middle node). All the
+// elements of "left" must be smaller than all the elements of "right".
+//
+static rb_node *rb_join2_subtrees(rb_node *left, int hl, rb_node *right,
+                                  int hr, int *height) {
+
+    rb_node *mid;
+
+    // Trivial cases: empty subtrees
+    if (left  == NULL) { *height = hr; return right; }
+    if (right == NULL) { *height = hl; return left;  }
+
+    // General case: use the biggest node of "left" as middle node
+    left = rb_split_last(left, hl, &mid, &hl);
+    return rb_join_subtrees(left, hl, mid, right, hr, height);
+}
+
+// This is an auxiliary function that runs a join-based set function over the
+// subtrees of "op" and stores the result in "op->root_1" & "op->height_1".
+//
+// It exposes the root of the second subtree, splits the first subtree with
+// it, solves both halves recursively (perhaps in parallel) and joins the
+// results back using (or discarding) the exposed root.
+//
+static void *rb_set_op_run(void *arg) {
+
+    rb_set_op *op = (rb_set_op *) arg;
+    rb_set_op  op_l;
+    rb_set_op  op_r;
+    rb_node   *mid;
+    rb_node   *found;
+    int        forked = NO;
+#ifdef RB_THREADS
+    pthread_t  thread;
+#endif
+
+    // Trivial case: empty second subtree
+    if (op->root_2 == NULL) {
+        if (op->type == RB_INTERSECTION) {
+            rb_free_subtree(op->root_1, op->free_data, op->pool);
+            op->root_1   = NULL;
+            op->height_1 = 0;
+        }
+        return NULL;
+    }
+
+    // Trivial case: empty first subtree
+    if (op->root_1 == NULL) {
+        if (op->type == RB_UNION || op->type == RB_SYM_DIFF) {
+            op->root_1   = op->root_2;
+            op->height_1 = op->height_2;
+        } else {
+            rb_free_subtree(op->root_2, op->free_data, op->pool);
+        }
+        op->root_2 = NULL;
+        return NULL;
+    }
+
+    // Expose the root of the second subtree:
+    mid           = op->root_2;
+    op_l          = *op;
+    op_r          = *op;
+    op_l.root_2   = RB_LEFT(mid);
+    op_r.root_2   = mid->right;
+    op_l.height_2 = rb_subtree(op_l.root_2, op->height_2);
+    op_r.height_2 = rb_subtree(op_r.root_2, op->height_2);
+    op_l.depth    = op->depth - 1;
+    op_r.depth    = op->depth - 1;
+
+    // Split the first subtree with it:
+    found = rb_split_subtree(op->root_1, op->height_1, mid->data, op->comp,
+                             &op_l.root_1, &op_l.height_1,
+                             &op_r.root_1, &op_r.height_1);
+
+    // Solve both halves (in parallel if they are big enough):
+#ifdef RB_THREADS
+    if (op->depth > 0 && op_l.height_2 >= RB_THREADS_HEIGHT) {
+        if (pthread_create(&thread, NULL, rb_set_op_run, &op_l) == 0) {
+            forked = YES;
+        }
+    }
+#endif
+    if (forked == NO) { rb_set_op_run(&op_l); }
+    rb_set_op_run(&op_r);
+#ifdef RB_THREADS
+    if (forked == YES) { pthread_join(thread, NULL); }
+#endif
+
+    // The element is in both subtrees: keep the data of the first one
+    if (found != NULL) {
+        if (op->free_data != NULL && mid->data != found->data) {
+            op->free_data(mid->data);
+        }
+        mid->data = found->data;
+        rb_release_node(op->pool, found);
+    }
+
+    // Join both halves keeping the middle element...
+    if ((op->type == RB_UNION) ||
+        (op->type == RB_INTERSECTION && found != NULL) ||
+        (op->type == RB_SYM_DIFF     && found == NULL)) {
+        op->root_1 = rb_join_subtrees(op_l.root_1, op_l.height_1, mid,
+                                      op_r.root_1, op_r.height_1,
+                                      &op->height_1);
+
+    // ...or discarding it:
+    } else {
+        if (op->free_data != NULL) { op->free_data(mid->data); }
+        rb_release_node(op->pool, mid);
+        op->root_1 = rb_join2_subtrees(op_l.root_1, op_l.height_1,
+                                       op_r.root_1, op_r.height_1,
+                                       &op->height_1);
+    }
+    op->root_2 = NULL;
+
+    return NULL;
+}
+
+// This is an auxiliary function that runs a join-based set function over
+// two trees. Use "rb_tree_join_union", "rb_tree_join_intersection"...
+//
+static void rb_tree_set_op(rb_tree *tree_1, rb_tree *tree_2,
+                           void (* free_data) (void *), int type) {
+
+    rb_set_op op;
+
+    // Sanity checks:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+#ifdef TREE_KEY_PREFIX
+    assert(tree_1->prefix == tree_2->prefix);
+#endif
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) {
+        if (type == RB_DIFF || type == RB_SYM_DIFF) {
+            rb_tree_remove_all(tree_1, free_data);
+        }
+        return;
+    }
+
+    // The nodes of tree_2 will end up in tree_1 (or be released there):
+    if (rb_tree_adopt(tree_1, tree_2) == NO) { return; }
+
+    // General case:
+    op.type      = type;
+    op.root_1    = tree_1->root;
+    op.height_1  = rb_black_height(tree_1->root);
+    op.root_2    = tree_2->root;
+    op.height_2  = rb_black_height(tree_2->root);
+    op.comp      = tree_1->comp;
+    op.free_data = free_data;
+    op.pool      = tree_1->pool;
+#ifdef RB_THREADS
+    op.depth     = (op.pool == NULL) ? RB_THREADS_DEPTH : 0;
+#else
+    op.depth     = 0;
+#endif
+    rb_set_op_run(&op);
+
+    // Store the result in tree_1 and leave tree_2 empty:
+    tree_1->root = op.root_1;
+    tree_2->root = NULL;
+    MINMAX_CLEAR(tree_1);
+    MINMAX_CLEAR(tree_2);
+    rb_fix_min_max(tree_1);
+}
+
+// Moves all the elements of tree that are bigger or equal to data to a new
+// tree and returns it (or NULL if out of memory). The elements smaller than
+// data remain in tree. It takes O(log(|tree|)) time.
+//
+// If tree has a node pool the new tree gets its own pool, and the nodes that
+// move there are copied into it, which takes O(|new tree|) more time.
+//
+rb_tree *rb_tree_split(rb_tree *tree, const void *data) {
+
+    rb_tree *new_tree;
+    rb_node *found;
+    rb_node *left;
+    rb_node *right;
+    int      hl;
+    int      hr;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Create a new tree (with its own pool if tree has one):
+    new_tree = new_rb_tree_as(tree);
+    if (new_tree == NULL) { return NULL; }
+
+    // Split the nodes:
+    found = rb_split_subtree(tree->root, rb_black_height(tree->root), data,
+                             tree->comp, &left, &hl, &right, &hr);
+
+    // The node that compares "equal" to data goes to the new tree:
+    if (found != NULL) {
+        right = rb_join_subtrees(NULL, 0, found, right, hr, &hr);
+    }
+
+    // Pooled nodes move to the pool of the new tree (or everything goes back):
+    if (tree->pool != NULL && rb_move_subtree(tree, new_tree, &right) == NO) {
+        tree->root = rb_join2_subtrees(left, hl, right, hr, &hl);
+        MINMAX_CLEAR(tree);
+        rb_fix_min_max(tree);
+        rb_tree_remove_all(new_tree, NULL);
+        free(new_tree);
+        return NULL;
+    }
+
+    tree->root     = left;
+    new_tree->root = right;
+    MINMAX_CLEAR(tree);
+    rb_fix_min_max(tree);
+    rb_fix_min_max(new_tree);
+    return new_tree;
+}
+
+// Moves all the elements of tree_2 to tree_1, leaving tree_2 empty. All the
+// elements of tree_1 must be smaller than all the elements of tree_2.
+// It takes O(log(|tree_1| + |tree_2|)) time.
+//
+// If any of them has a node pool, the nodes of tree_2 are copied into the
+// allocator of tree_1 first, which takes O(|tree_2|) more time. If there is
+// not enough memory for that, both trees are left untouched.
+//
+void rb_tree_join(rb_tree *tree_1, rb_tree *tree_2) {
+
+    int height;
+
+    // Sanity Checks:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+    assert(tree_1 != tree_2);
+#ifdef TREE_KEY_PREFIX
+    assert(tree_1->prefix == tree_2->prefix);
+#endif
+    assert(tree_1->root == NULL || tree_2->root == NULL ||
+           COMPARE(tree_1, rb_tree_max(tree_1), rb_tree_min(tree_2)) < 0);
+
+    // The nodes of tree_2 will end up in tree_1:
+    if (rb_tree_adopt(tree_1, tree_2) == NO) { return; }
+
+    // Join the nodes:
+    tree_1->root = rb_join2_subtrees(tree_1->root,
+                                     rb_black_height(tree_1->root),
+                                     tree_2->root,
+                                     rb_black_height(tree_2->root),
+                                     &height);
+    tree_2->root = NULL;
+    MINMAX_CLEAR(tree_1);
+    MINMAX_CLEAR(tree_2);
+    rb_fix_min_max(tree_1);
+}
+
+// Moves the union of tree_1 and tree_2 to tree_1, leaving tree_2 empty.
+//
+// If a given "element" is in both trees it keeps the pointer from tree_1.
+// If you provide a "free_data" function it will be used to free the data
+// pointers of tree_2 that are discarded (unless they are the same pointer
+// kept in tree_1).
+//
+void rb_tree_join_union(rb_tree *tree_1, rb_tree *tree_2,
+                        void (* free_data) (void *)) {
+    rb_tree_set_op(tree_1, tree_2, free_data, RB_UNION);
+}
+
+// Moves the intersection of tree_1 and tree_2 to tree_1, leaving tree_2
+// empty. All data pointers are taken from tree_1.
+//
+// If you provide a "free_data" function it will be used to free all the data
+// pointers that are discarded (unless they are the same pointer kept in
+// tree_1).
+//
+void rb_tree_join_intersection(rb_tree *tree_1, rb_tree *tree_2,
+                               void (* free_data) (void *)) {
+    rb_tree_set_op(tree_1, tree_2, free_data, RB_INTERSECTION);
+}
+
+// Moves the difference tree_1 - tree_2 to tree_1, leaving tree_2 empty.
+//
+// If you provide a "free_data" function it will be used to free all the data
+// pointers that are discarded (only once if both trees share a pointer).
+//
+void rb_tree_join_diff(rb_tree *tree_1, rb_tree *tree_2,
+                       void (* free_data) (void *)) {
+    rb_tree_set_op(tree_1, tree_2, free_data, RB_DIFF);
+}
+
+// Moves the symmetric difference of tree_1 and tree_2 to tree_1, leaving
+// tree_2 empty.
+//
+// If you provide a "free_data" function it will be used to free all the data
+// pointers that are discarded (only once if both trees share a pointer).
+//
+void rb_tree_join_sym_diff(rb_tree *tree_1, rb_tree *tree_2,
+                           void (* free_data) (void *)) {
+    rb_tree_set_op(tree_1, tree_2, free_data, RB_SYM_DIFF);
+}
+
+
+// KEY PREFIXES:
+
+#ifdef TREE_KEY_PREFIX
+
+// Sets the prefix function of tree (see "KEY PREFIXES" in the header) or goes
+// back to plain comparisons if prefix is NULL. Since every node computes its
+// prefix when it is created, the tree must still be empty.
+//
+void rb_tree_set_prefix(rb_tree *tree, uint64_t (* prefix) (const void *)) {
+
+    // Sanity checks:
+    assert(tree != NULL);
+    assert(tree->root == NULL);
+
+    // The nodes already in the tree would keep their old prefixes:
+    if (tree->root != NULL) {
+        fprintf(stderr, "ERROR: rb_tree must be empty to set its prefix\n");
+        return;
+    }
+
+    tree->prefix = prefix;
+}
+
+#endif
+
+// STATISTICS:
+
+#ifdef TREE_STATS
+
+// Returns a copy of the counters of tree (see "tree_stats" in the header).
+//
+tree_stats rb_tree_get_stats(const rb_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    return tree->stats;
+}
+
+// Sets all the counters of tree to zero.
+//
+void rb_tree_reset_stats(rb_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    STATS_RESET(tree);
+}
+
+#endif
+
+
+
+// DEBUG & VISUALIZATION:
+
+// This is an auxiliary function to check the symmetric order property
+// recursively. You should not use it directly, use "is_rb_tree" instead.
+//
+// Note that, unlike other functions of this library, it is safe to use
+// recursive definitions here since they will only be used to test the
+// code while debugging this library.
+//
+static int is_rb_subtree(const rb_tree *tree, const rb_node *node,
+                         const void *min, const void *max) {
+
+    int left_height  = 0;
+    int right_height = 0;
+
+    // Make sure that node is (strictly) between specified limits:
+    if (min != NULL && COMPARE(tree, min, node->data) >= 0) {
+        fprintf(stderr, "ERROR: Symmetric order not satisfied in rb_tree\n");
+        return -1;
+    }
+    if (max != NULL && COMPARE(tree, node->data, max) >= 0) {
+        fprintf(stderr, "ERROR: Symmetric order not satisfied in rb_tree\n");
+        return -1;
+    }
+
+#ifdef TREE_KEY_PREFIX
+    // Check the cached prefix of node:
+    if (node->prefix != KEY_PREFIX(tree, node->data)) {
+        fprintf(stderr, "ERROR: Wrong key prefix in rb_tree\n");
+        return -1;
+    }
+#endif
+
+    // Check for RED violations:
+    if (RB_COLOR(node) == RED) {
+        if (RB_LEFT(node)  != NULL && RB_COLOR(RB_LEFT(node))  == RED) {
+            fprintf(stderr, "ERROR: Two RED nodes in a row in rb_tree\n");
+            return -1;
+        }
+        if (node->right != NULL && RB_COLOR(node->right) == RED) {
+            fprintf(stderr, "ERROR: Two RED nodes in a row in rb_tree\n");
+            return -1;
+        }
+    }
+
+    // Check recursively the left subtree of node:
+    if (RB_LEFT(node) != NULL) {
+        left_height = is_rb_subtree(tree, RB_LEFT(node), min, node->data);
+        if (left_height == -1) { return -1; }
+    }
+
+    // Check recursively the right subtree of node:
+    if (node->right != NULL) {
+        right_height = is_rb_subtree(tree, node->right, node->data, max);
+        if (right_height == -1) { return -1; }
+    }
+
+    // Check for BLACK violations:
+    if (left_height != right_height) {
+        fprintf(stderr, "ERROR: Different BLACK height in rb_tree\n");
+        return -1;
+    }
+
+#ifdef RB_ORDER_STATISTICS
+    // Check the size of the subtree:
+    if (node->size != 1 + RB_SIZE(RB_LEFT(node)) + RB_SIZE(node->right)) {
+        fprintf(stderr, "ERROR: Wrong subtree size in rb_tree\n");
+        return -1;
+    }
+#endif
+    
+    // Return Black-Height of "node":
+    if (RB_COLOR(node) == RED){ return left_height; }
+    return left_height+1;
+}
+
+// This is an auxiliary function to check the symmetric order property, the
+// RED property and the BLACK property of a red-black tree.
+// Returns YES if everything is correct and NO otherwise.
+//
+// This function should not be used in production code. I recommend to use:
+//
+//      assert(is_rb_tree(tree) == YES);
+//
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
+//
+int is_rb_tree(const rb_tree *tree) {
+
+#ifdef TREE_MIN_MAX
+    const rb_node *node;
+#endif
+
+    // Basic Sanity Checks:
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to rb_tree\n");
+        return NO;
+    }
+    if (tree->comp == NULL) {
+        fprintf(stderr, "ERROR: NULL comparing function in rb_tree\n");
+        return NO;
+    }
+
+#ifdef TREE_MIN_MAX
+    // Check the cached leftmost & rightmost nodes (see MIN & MAX NODES):
+    node = tree->root;
+    while (node != NULL && RB_LEFT(node) != NULL) { node = RB_LEFT(node); }
+    if (tree->leftmost != node) {
+        fprintf(stderr, "ERROR: Wrong leftmost node in rb_tree\n");
+        return NO;
+    }
+    node = tree->root;
+    while (node != NULL && node->right != NULL) { node = node->right; }
+    if (tree->rightmost != node) {
+        fprintf(stderr, "ERROR: Wrong rightmost node in rb_tree\n");
+        return NO;
+    }
+#endif
+
+    // Trivial Case: empty tree
+    if (tree->root == NULL) { return YES; }
+
+    // General Case:
+    if (is_rb_subtree(tree, tree->root, NULL, NULL) == -1) { return NO;  }
+    else                                                   { return YES; }
+}
+
+// This is an auxiliary function to print the tree recursively.
+// You should not use it directly, use "print_rb_tree" instead.
+//
+// Note that, unlike the rest of the functions of this library, it is safe
+// to use recursive definitions here since any tree large enough to hit the
+// recursion limit will be too big to be printed anyway.
+//
+static void print_rb_subtree(const rb_node *node, const int is_right,
+                             char *indent, void (* print_node) (const void *)) {
+
+    // Allocate memory:
+    char *new_indent = (char *) malloc((6+strlen(indent)*sizeof(char)));
+    assert(new_indent != NULL);
+
+    // Print right subtree recursively:
+    if (node->right != NULL) {
+        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
+        else {
+            if (RB_COLOR(node) == RED) {
+                sprintf(new_indent, "%s%s", indent, "||    ");
+            } else {
+                sprintf(new_indent, "%s%s", indent, "|     ");
+            }
+        }
+        print_rb_subtree(node->right, YES, new_indent, print_node);
+    }
+
+    // Print current node:
+    if (RB_COLOR(node) == RED) {
+        if (is_right) { fprintf(stdout, "%s/====",indent); }
+        else          { fprintf(stdout, "%s\\====",indent); }
+    } else {
+        if (is_right) { fprintf(stdout, "%s,----",indent); }
+        else          { fprintf(stdout, "%s`----",indent); }
+    }
+    if (print_node == NULL)  {
+        if (RB_COLOR(node) == RED) { fprintf(stdout, "(#)"); }
+        else                    { fprintf(stdout, "( )"); }
+    } else { print_node(node->data); }
+    fprintf(stdout, "\n");
+
+    // Print left subtree recursively:
+    if (RB_LEFT(node) != NULL) {
+        if (is_right == YES) {
+            if (RB_COLOR(node) == RED) {
+                sprintf(new_indent, "%s%s", indent, "||    ");
+            } else {
+                sprintf(new_indent, "%s%s", indent, "|     ");
+            }
+        } else { sprintf(new_indent, "%s%s", indent, "      "); }
+        print_rb_subtree(RB_LEFT(node), NO, new_indent, print_node);
+    }
+
+    // Free memory:
+    free(new_indent);
+}
+
+// This function is used to print a red-black tree on the screen.
+//
+//  * If a "print_node" function is provided it will be used to print the
+//    content of each node.
+//  * Otherwise (if print_node is NULL) RED nodes will be printed as (#) and
+//    BLACK nodes will be printed as ( ).
+//
+// Use this latter option if you only want to take a look at the tree shape.
+//
+// A correct print_node function only prints a single line of text using
+// the "fprintf" command. It should NOT include any "\n" in that line.
+//
+// For example:
+//
+//  void MyPrintNodeFunction(const void *ptr) {
+//      MyDataStruct *d = (MyDataStruct *) ptr;     // Pointer casting
+//      fprintf(stdout, "(%d)", d->key);            // Printing integer key
+//  }
+//
+// Finally, note that this is a visualization tool for debugging purposes only.
+//
+void print_rb_tree(const rb_tree *tree, void (* print_node) (const void *)) {
+
+    // Avoid the trivial cases:
+    if (tree != NULL && tree->root != NULL) {
+
+        // Print right subtree recursively:
+        if (tree->root->right != NULL) {
+            print_rb_subtree(tree->root->right, YES, "     ", print_node);
+        }
+
+        // Print current node:
+        if (RB_COLOR(tree->root) == RED) { fprintf(stdout, "===="); }
+        else                          { fprintf(stdout, "----"); }
+        if (print_node == NULL) {
+            if (RB_COLOR(tree->root) == RED) { fprintf(stdout, "(#)"); }
+            else                          { fprintf(stdout, "( )"); }
+        } else { print_node(tree->root->data); }
+        fprintf(stdout, "\n");
+
+        // Print left subtree recursively:
+        if (RB_LEFT(tree->root) != NULL) {
+            print_rb_subtree(RB_LEFT(tree->root), NO, "     ", print_node);
+        }
+    }
+
+    // Empty the "stdout" buffer:
+    fflush(stdout);
+}
+
+// END OF RED BLACK TREES //////////////////////////////////////////////////////
+
+
+
+
+
+// SPLAY TREES /////////////////////////////////////////////////////////////////
+
+
+// SPLAYING FUNCTIONS:
+
+// Moves the node with "data" to the root of the splay tree.
+//
+// If data is not found moves the last node found in the search path to "data".
+// The caller must provide kp = KEY_PREFIX(tree, data) (see KEY PREFIXES).
+//
+static inline void splay(sp_tree *tree, const void *data, uint64_t kp) {
+
+    sp_node  root;
+    sp_node *left;
+    sp_node *right;
+    sp_node *node;
+    sp_node *temp;
+    size_t   depth = 0;
+    int      comp;
+
+    // Sanity checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Initialize:
+    root.right = root.left = NULL;
+    left = right = &root;
+    node = tree->root;
+    if (node == NULL) { return; }
+
+    for (;;) {
+
+        // Compare "data":
+        depth++;
+        comp = PREFIX_COMPARE(tree, kp, data, node);
+
+        // If "data" is smaller:
+        if (comp < 0) {                         
+            if (node->left == NULL) { break; }
+
+            // Rotate right if needed:
+            if (PREFIX_COMPARE(tree, kp, data, node->left) < 0) {
+                temp        = node->left;
+                node->left  = temp->right;
+                temp->right = node;
+                node        = temp;
+                depth++;
+                STATS_ADD(tree, rotations, 1);
+                if (node->left == NULL) { break; }
+            }
+
+            // Link right:
+            STATS_ADD(tree, splay_steps, 1);
+            right->left = node;
+            right       = node;
+            node        = node->left;
+
+        // If "data" is bigger:
+        } else if (comp > 0) {
+            if (node->right == NULL) { break; }
+
+            // Rotate left if needed:
+            if (PREFIX_COMPARE(tree, kp, data, node->right) > 0) {
+                temp        = node->right;
+                node->right = temp->left;
+                temp->left  = node;
+                node        = temp;
+                depth++;
+                STATS_ADD(tree, rotations, 1);
+                if (node->right == NULL) { break; }
+            }
+
+            // Link left:
+            STATS_ADD(tree, splay_steps, 1);
+            left->right = node;
+            left        = node;
+            node        = node->right;
+
+        // If we have found "data":
+        } else { break; }
+    }
+
+    // Count the search:
+    STATS_SEARCH(tree, depth);
+
+    // Assemble:
+    left->right = node->left;
+    right->left = node->right;
+    node->left  = root.right;
+    node->right = root.left;
+    tree->root  = node;
+}
+
+// Moves the node with the smallest element to the root of the splay tree.
+//
+static inline void splay_left(sp_tree *tree) {
+
+    sp_node  root;
+    sp_node *right;
+    sp_node *node;
+    sp_node *temp;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Initialize:
+    root.right = root.left = NULL;
+    right = &root;
+    node = tree->root;
+    if (node == NULL) { return; }
+
+    for (;;) {
+        
+        // Act as if splaying "data" which is always smaller
+        if (node->left == NULL) { break; }
+
+        // Rotate right:
+        STATS_ADD(tree, rotations, 1);
+        temp        = node->left;
+        node->left  = temp->right;
+        temp->right = node;
+        node        = temp;
+        if (node->left == NULL) { break; }
+
+        // Link right:
+        STATS_ADD(tree, splay_steps, 1);
+        right->left = node;
+        right       = node;
+        node        = node->left;
+    }
+
+    // Assemble:
+    right->left = node->right;
+    node->right = root.left;
+    tree->root  = node;
+}
+
+// Moves the node with the biggest element to the root of the splay tree.
+//
+static inline void splay_right(sp_tree *tree) {
+
+    sp_node  root;
+    sp_node *left;
+    sp_node *node;
+    sp_node *temp;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Initialize:
+    root.right = root.left = NULL;
+    left = &root;
+    node = tree->root;
+    if (node == NULL) { return; }
+
+    for (;;) {
+        
+        // Act as if splaying "data" which is always bigger
+        if (node->right == NULL) { break; }
+
+        // Rotate left:
+        STATS_ADD(tree, rotations, 1);
+        temp        = node->right;
+        node->right = temp->left;
+        temp->left  = node;
+        node        = temp;
+        if (node->right == NULL) { break; }
+
+        // Link left:
+        STATS_ADD(tree, splay_steps, 1);
+        left->right = node;
+        left        = node;
+        node        = node->right;
+    }
+
+    // Assemble:
+    left->right = node->left;
+    node->left  = root.right;
+    tree->root  = node;
+}
+
+
+
+// SPLAYING POLICIES:
+
+#ifdef SP_SPLAY_POLICY
+
+// Kinds of lookups (see "sp_lookup"):
+#define SP_LOOKUP_SEARCH 0
+#define SP_LOOKUP_MIN    1
+#define SP_LOOKUP_MAX    2
+#define SP_LOOKUP_PREV   3
+#define SP_LOOKUP_NEXT   4
+
+// Returns the next pseudo-random number of tree (xorshift64).
+//
+static inline uint64_t sp_random(sp_tree *tree) {
+    uint64_t x = tree->splay_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    tree->splay_state = x;
+    return x;
+}
+
+// Walks down the (non-empty) tree without modifying it and returns what the
+// given kind of lookup of data (whose prefix is kp) must return. Stores the
+// number of levels visited in depth.
+//
+static void *sp_descend(sp_tree *tree, const void *data, uint64_t kp,
+                        int lookup, size_t *depth) {
+
+    sp_node *node  = tree->root;
+    sp_node *found = NULL;
+    int      comp;
+
+    *depth = 0;
+    while (node != NULL) {
+        (*depth)++;
+
+        // The extremes just follow one of the spines:
+        if (lookup == SP_LOOKUP_MIN) {
+            found = node;
+            node  = node->left;
+            continue;
+        }
+        if (lookup == SP_LOOKUP_MAX) {
+            found = node;
+            node  = node->right;
+            continue;
+        }
+
+        // The others compare data with every node in the path:
+        comp = PREFIX_COMPARE(tree, kp, data, node);
+        if (comp == 0 && lookup == SP_LOOKUP_SEARCH) {
+            found = node;
+            break;
+        }
+
+        // Remember the last node smaller (or bigger) than data:
+        if (comp > 0 || (comp == 0 && lookup == SP_LOOKUP_NEXT)) {
+            if (comp > 0 && lookup == SP_LOOKUP_PREV) { found = node; }
+            node = node->right;
+        } else {
+            if (comp < 0 && lookup == SP_LOOKUP_NEXT) { found = node; }
+            node = node->left;
+        }
+    }
+
+    // Count the search:
+    STATS_SEARCH(tree, *depth);
+
+    return (found == NULL) ? NULL : found->data;
+}
+
+// Applies the splaying policy of tree to a lookup of data (see "sp_descend").
+//
+// Returns YES and stores the result of the lookup in found if it must not
+// splay. Returns NO if the caller must splay as usual.
+//
+static int sp_lookup(sp_tree *tree, const void *data, uint64_t kp,
+                     int lookup, void **found) {
+
+    size_t depth;
+
+    // Decide before walking down (if possible):
+    switch (tree->splay_policy) {
+        case SP_SPLAY_ALWAYS:
+            return NO;
+        case SP_SPLAY_RANDOM:
+            if ((sp_random(tree) >> 32) < tree->splay_param) { return NO; }
+            break;
+        case SP_SPLAY_EVERY:
+            if (++(tree->splay_state) >= tree->splay_param) {
+                tree->splay_state = 0;
+                return NO;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Walk down without splaying:
+    *found = sp_descend(tree, data, kp, lookup, &depth);
+
+    // Too deep, splay it after all:
+    if (tree->splay_policy == SP_SPLAY_DEPTH && depth > tree->splay_param) {
+        return NO;
+    }
+
+    return YES;
+}
+
+#endif
+
+
+
+// NODE ALLOCATION:
+
+// Returns a new (uninitialized) sp_node taken from the node pool of tree, or
+// from malloc if tree does not have a pool. Returns NULL if out of memory.
+//
+static inline sp_node *new_sp_node(sp_tree *tree) {
+    STATS_ADD(tree, allocations, 1);
+    if (tree->pool == NULL) { return (sp_node *) malloc(sizeof(sp_node)); }
+    else                    { return (sp_node *) node_pool_alloc(tree->pool); }
+}
+
+// Releases a sp_node previously obtained with "new_sp_node".
+//
+static inline void free_sp_node(sp_tree *tree, sp_node *node) {
+    STATS_ADD(tree, releases, 1);
+    MINMAX_FORGET(tree, node);
+    if (tree->pool == NULL) { free(node); }
+    else                    { node_pool_free(tree->pool, node); }
+}
+
+// Returns a new empty sp_tree that uses the comparing (and prefix) function of
+// tree and has its own node pool if tree has one. Used by the copy & set
+// functions.
+//
+static sp_tree *new_sp_tree_as(const sp_tree *tree) {
+    sp_tree *new_tree;
+    if (tree->pool == NULL) { new_tree = new_sp_tree(tree->comp); }
+    else {
+        new_tree = new_sp_tree_with_pool(tree->comp, tree->pool->capacity);
+    }
+    if (new_tree != NULL) { PREFIX_INIT(new_tree, tree->prefix); }
+    return new_tree;
+}
+
+
+
+// CREATION & INSERTION:
+
+// Returns a pointer to a newly created sp_tree.
+// You must provide a comparing function "comp" such that:
+//  * comp(A,B) = 0  if and only if  A = B
+//  * comp(A,B) > 0  if and only if  A > B
+//  * comp(A,B) < 0  if and only if  A < B
+//
+// I recommend to limit the output of the "comp" function to {-1, 0, 1} as in:
+//
+//  int MyComp(const void *ptr1, const void *ptr2) {
+//      MyData *d1 = (MyData *) ptr1;
+//      MyData *d2 = (MyData *) ptr2;
+//      if      (d1->key < d2->key) { return -1; }
+//      else if (d1->key > d2->key) { return +1; }
+//      else                        { return  0; }
+//  }
+//
+// However, the code does not assume that so, if you are working with simple
+// numeric keys, you can just use something like:
+//
+//  int MyComp(const void *ptr1, const void *ptr2) {
+//      MyData *d1 = (MyData *) ptr1;
+//      MyData *d2 = (MyData *) ptr2;
+//      return (int) ((d1->key) - (d2->key));
+//  }
+//
+sp_tree *new_sp_tree(int (* comp) (const void *, const void *)) {
+
+    // Sanity check:
+    assert(comp != NULL);
+
+    // Allocate memory:
+    sp_tree *tree = (sp_tree *) malloc(sizeof(sp_tree));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for sp_tree\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->comp = comp;
+        tree->pool = NULL;
+        PREFIX_INIT(tree, NULL);
+        SPLAY_POLICY_INIT(tree);
+        SCAPEGOAT_INIT(tree);
+        MINMAX_CLEAR(tree);
+        STATS_RESET(tree);
+    }
+
+    return tree;
+}
+
+// Returns a pointer to a newly created sp_tree whose nodes are allocated from
+// a node pool instead of calling malloc and free for every single node.
+//
+// The first slab of the pool will have room for "capacity" nodes (use your
+// best guess of the final size of the tree or 0 if you have no idea) and the
+// following slabs will be bigger and bigger. Removed nodes stay in the pool
+// and are reused by future insertions, so the memory of the pool is only
+// returned to the system by "sp_tree_remove_all", which takes O(#slabs)
+// time (plus O(|tree|) if you provide a "free_data" function).
+//
+// The pool lives in the same block of memory as the tree, so you can still
+// destroy it as usual:
+//
+//      sp_tree_remove_all(tree, free_data);
+//      free(tree);
+//
+// The comparing function must satisfy the same rules as in "new_sp_tree".
+//
+sp_tree *new_sp_tree_with_pool(int (* comp) (const void *, const void *),
+                               size_t capacity) {
+
+    // Sanity check:
+    assert(comp != NULL);
+
+    // Allocate memory for the tree and its pool:
+    sp_tree *tree = (sp_tree *) malloc(sizeof(sp_tree) + sizeof(node_pool));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for sp_tree\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->comp = comp;
+        tree->pool = (node_pool *) (tree + 1);
+        PREFIX_INIT(tree, NULL);
+        SPLAY_POLICY_INIT(tree);
+        SCAPEGOAT_INIT(tree);
+        MINMAX_CLEAR(tree);
+        STATS_RESET(tree);
+        init_node_pool(tree->pool, sizeof(sp_node), capacity);
+    }
+
+    return tree;
+}
+
+// Pending range of the sorted array (used by "sp_tree_from_sorted_array"):
+typedef struct sp_range {
+    size_t    first;    // First index of the range
+    size_t    last;     // One past the last index of the range
+    sp_node **link;     // Where to hang the subtree built from the range
+} sp_range;
+
+#define SP_RANGE_STACK 128  // More than enough for any tree that fits in RAM
+
+// Returns a pointer to a newly created (perfectly balanced) sp_tree containing
+// the n elements of the array "data", or NULL if out of memory. The elements
+// must be sorted in increasing order (according to comp) without duplicates.
+//
+// The middle element of the array becomes the root and both halves become
+// its subtrees (and so on), so all the levels of the tree but the last one
+// are full. It takes O(n) time (no comparisons at all) and all the nodes are
+// carved from a single contiguous block: the first slab of the node pool of
+// the tree. Apart from that, the tree is just like any other tree created
+// with "new_sp_tree_with_pool".
+//
+sp_tree *sp_tree_from_sorted_array(int (* comp) (const void *, const void *),
+                                   void **data, size_t n) {
+
+    sp_tree  *tree;
+    sp_node  *node;
+    sp_range  stack[SP_RANGE_STACK];
+    sp_range  range;
+    size_t    size;
+    size_t    mid;
+
+    // Sanity checks:
+    assert(comp != NULL);
+    assert(data != NULL || n == 0);
+
+    // Create a new tree whose first slab has room for all the nodes:
+    tree = new_sp_tree_with_pool(comp, n);
+    if (tree == NULL) { return NULL; }
+    if (n == 0)       { return tree; }
+
+    // Start with the whole array:
+    stack[0].first = 0;
+    stack[0].last  = n;
+    stack[0].link  = &(tree->root);
+    size = 1;
+
+    // Build the tree top-down:
+    while (size > 0) {
+
+        // Take the next pending range:
+        size--;
+        range = stack[size];
+        mid   = range.first + (range.last - range.first) / 2;
+
+        // Sanity checks:
+        assert(data[mid] != NULL);
+        assert(mid == 0 || comp(data[mid - 1], data[mid]) < 0);
+
+        // Its middle element is the root of its subtree (only the first
+        // node can fail, since the first slab has room for all of them):
+        node = new_sp_node(tree);
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+            free(tree);
+            return NULL;
+        }
+        node->data    = data[mid];
+        node->left    = NULL;
+        node->right   = NULL;
+        *(range.link) = node;
+        SET_PREFIX(tree, node);
+
+        // Push both halves (the left one will be built first):
+        assert(size + 2 <= SP_RANGE_STACK);
+        if (mid + 1 < range.last) {
+            stack[size].first = mid + 1;
+            stack[size].last  = range.last;
+            stack[size].link  = &(node->right);
+            size++;
+        }
+        if (range.first < mid) {
+            stack[size].first = range.first;
+            stack[size].last  = mid;
+            stack[size].link  = &(node->left);
+            size++;
+        }
+    }
+
+    bs_fix_min_max(tree);
+    return tree;
+}
+
+// Returns a (really degenerated) splay tree containing a copy of tree.
+// It does NOT modify tree (not even its shape): instead of splaying it, it
+// walks the nodes in-order like "bs_tree_copy", so tree keeps the access
+// pattern that it has learned.
+//
+// Takes O(|tree|) time.
+//
+sp_tree *sp_tree_copy(const sp_tree *tree) {
+
+    sp_tree   *new_tree = NULL;
+    sp_node   *new_node = NULL;
+    bs_walker  walker;
+    sp_node   *node;
+    
+    // Sanity check:
+    assert(tree != NULL);
+    
+    // Create a new tree:
+    new_tree = new_sp_tree_as(tree);
+    if (new_tree == NULL) { return NULL; }
+
+    // Go to the smallest element of tree:
+    node = bs_walker_first(&walker, tree->root);
+
+    // Insert all data from tree into new_tree:
+    while (node != NULL) {
+
+        // insert node->data in new_tree ///////////////////////////////////////
+        if (new_node == NULL)  {
+            new_tree->root = new_sp_node(new_tree);
+            new_node = new_tree->root;
+        } else {
+            new_node->right = new_sp_node(new_tree);
+            new_node = new_node->right;
+        }
+        if (new_node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+            bs_walker_free(&walker);
+            return new_tree;
+        } else {
+            new_node->data  = node->data;
+            new_node->left  = NULL;
+            new_node->right = NULL;
+            COPY_PREFIX(new_node, node);
+            MINMAX_APPEND(new_tree, new_node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node ////////////////////////////////////////////////////////
+        node = bs_walker_next(&walker);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stack:
+    bs_walker_free(&walker);
+
+    // The copy is incomplete if the traversal ran out of memory:
+    if (walker.error == YES) {
+        sp_tree_remove_all(new_tree, NULL);
+        free(new_tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return new_tree;
+}
+
+// Returns a new sp_tree with exactly the same shape as tree, or NULL if out
+// of memory. Unlike "sp_tree_copy", which returns a degenerated tree, the
+// clone keeps the access pattern that tree has learned: every node is
+// duplicated in a single pre-order pass.
+//
+// The clone always has a node pool whose first slab has room for all the
+// nodes, so they are carved from a single contiguous block. Apart from that,
+// it is just like any other tree created with "new_sp_tree_with_pool".
+//
+// It does NOT modify tree (not even its shape) and takes O(|Tree|) time.
+//
+sp_tree *sp_tree_clone(const sp_tree *tree) {
+
+    sp_tree   *new_tree;
+    sp_node   *new_node;
+    sp_node   *parent;
+    sp_node   *pending = NULL;
+    sp_node   *node;
+    size_t     size = 0;
+    int        side = 0;
+    bs_walker  walker;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Count the nodes:
+    node = bs_walker_first(&walker, tree->root);
+    while (node != NULL) {
+        size++;
+        node = bs_walker_next(&walker);
+    }
+    bs_walker_free(&walker);
+
+    // Create a new tree whose first slab has room for all the nodes:
+    new_tree = new_sp_tree_with_pool(tree->comp, size);
+    if (new_tree == NULL) { return NULL; }
+    PREFIX_INIT(new_tree, tree->prefix);
+
+    // Duplicate the nodes in pre-order. Instead of a stack (splay trees can
+    // be arbitrarily deep), the new nodes whose right subtree is still pending
+    // form a list linked through their right pointers, and their data points
+    // to the original node meanwhile:
+    parent = NULL;
+    node   = tree->root;
+    for (;;) {
+
+        // Duplicate node and its leftmost descendants:
+        while (node != NULL) {
+
+            // If out of memory, undo everything:
+            new_node = new_sp_node(new_tree);
+            if (new_node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                while (pending != NULL) {
+                    new_node        = pending;
+                    pending         = new_node->right;
+                    new_node->data  = ((sp_node *) new_node->data)->data;
+                    new_node->right = NULL;
+                }
+                sp_tree_remove_all(new_tree, NULL);
+                free(new_tree);
+                return NULL;
+            }
+            new_node->left  = NULL;
+            new_node->right = NULL;
+            new_node->data  = node->data;
+            COPY_PREFIX(new_node, node);
+
+            // Remember its right subtree for later:
+            if (node->right != NULL) {
+                new_node->data  = node;
+                new_node->right = pending;
+                pending         = new_node;
+            }
+
+            // Hang it from its parent:
+            if      (parent == NULL) { new_tree->root = new_node; }
+            else if (side < 0)       { parent->left   = new_node; }
+            else                     { parent->right  = new_node; }
+
+            parent = new_node;
+            side   = -1;
             node   = node->left;
         }
-        old_data = node->data;
 
-        // Remove Node:
-        if (parent != NULL) { parent->left = node->right; }
-        else                { tree->root   = node->right; }
-        free(node);
+        // Continue with the last pending right subtree (if any):
+        if (pending == NULL) { break; }
+        parent         = pending;
+        pending        = parent->right;
+        node           = (sp_node *) parent->data;
+        parent->data   = node->data;
+        parent->right  = NULL;
+        side           = +1;
+        node           = node->right;
+    }
+
+    bs_fix_min_max(new_tree);
+    return new_tree;
+}
+
+// Inserts data in tree.
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *sp_tree_insert(sp_tree *tree, void *data) {
+
+    sp_node *old_root;
+    void    *old_data;
+    int      comp = 1;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Trivial case: Empty tree
+    if (tree->root == NULL) {
+        tree->root = new_sp_node(tree);
+        if (tree->root == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+        } else {
+            tree->root->data  = data;
+            tree->root->left  = NULL;
+            tree->root->right = NULL;
+            SET_PREFIX(tree, tree->root);
+            MINMAX_ROOT(tree);
+        }
+        return NULL;
+    }
+
+    // General case: Splay data to the root
+    kp = KEY_PREFIX(tree, data);
+    splay(tree, data, kp);
+    old_root = tree->root;
+
+    // Compare the current root with data:
+    if (old_root != NULL) { comp = PREFIX_COMPARE(tree, kp, data, old_root); }
+
+    // If data is in the tree: overwrite it!
+    if (comp == 0) {
+        old_data = tree->root->data;
+        tree->root->data = data;
+        return old_data;
+    }
+
+    // Otherwise insert a new node as a root and link the previous root to it:
+    tree->root = new_sp_node(tree);
+    if (tree->root == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+        tree->root = old_root;
+    } else {
+        tree->root->data  = data;
+        SET_PREFIX(tree, tree->root);
+        if (comp > 0) {
+            tree->root->left  = old_root;
+            tree->root->right = old_root->right;
+            old_root->right   = NULL;
+        } else {
+            tree->root->right = old_root;
+            tree->root->left  = old_root->left;
+            old_root->left    = NULL;
+        }
+        MINMAX_ROOT(tree);
+    }
+
+    // Data was not here!
+    return NULL;
+}
+
+// Inserts "data" such that "data" is smaller or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly bigger than
+//          something already in the tree you will break the tree!
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *sp_tree_insert_min(sp_tree *tree, void *data) {
+
+    sp_node *old_root;
+    void    *old_data;
+    int      comp = 1;
+    
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // General case: Splay data to the root
+    splay_left(tree);
+    old_root = tree->root;
+
+    // Compare the current root with data:
+    if (old_root != NULL) { comp = COMPARE(tree, data, old_root->data); }
+
+    // If data is in the tree: overwrite it!
+    if (comp == 0) {
+        old_data = tree->root->data;
+        tree->root->data = data;
+        return old_data;
+    }
+
+    // Otherwise insert a new node as a root and link the previous root to it:
+    tree->root = new_sp_node(tree);
+    if (tree->root == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+        tree->root = old_root;
+    } else {
+        tree->root->data  = data;
+        tree->root->left  = NULL;
+        tree->root->right = old_root;
+        SET_PREFIX(tree, tree->root);
+        MINMAX_ROOT(tree);
+    }
+
+    // Data was not here!
+    return NULL;
+}
+
+// Inserts "data" such that "data" is bigger or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly smaller
+//          than something already in the tree you will break the tree!
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *sp_tree_insert_max(sp_tree *tree, void *data) {
+
+    sp_node *old_root;
+    void    *old_data;
+    int      comp = 1;
+    
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // General case: Splay data to the root
+    splay_right(tree);
+    old_root = tree->root;
+
+    // Compare the current root with data:
+    if (old_root != NULL) { comp = COMPARE(tree, data, old_root->data); }
+
+    // If data is in the tree: overwrite it!
+    if (comp == 0) {
+        old_data = tree->root->data;
+        tree->root->data = data;
+        return old_data;
+    }
+
+    // Otherwise insert a new node as a root and link the previous root to it:
+    tree->root = new_sp_node(tree);
+    if (tree->root == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+        tree->root = old_root;
+    } else {
+        tree->root->data  = data;
+        tree->root->left  = old_root;
+        tree->root->right = NULL;
+        SET_PREFIX(tree, tree->root);
+        MINMAX_ROOT(tree);
+    }
+
+    // Data was not here!
+    return NULL;
+}
+
+
+
+// SEARCH:
+
+// Returns YES if the tree is empty and NO otherwise.
+//
+int sp_tree_is_empty(const sp_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Check if there is at least 1 node in the tree:
+    if (tree->root == NULL) { return YES; }
+    else                    { return NO;  }
+}
+
+// Finds a node that compares "equal" to data. Returns NULL if not found.
+//
+void *sp_tree_search(sp_tree *tree, const void *data) {
+
+    uint64_t kp;
+#ifdef SP_SPLAY_POLICY
+    void    *found;
+#endif
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Splay data to the root
+    kp = KEY_PREFIX(tree, data);
+#ifdef SP_SPLAY_POLICY
+    if (sp_lookup(tree, data, kp, SP_LOOKUP_SEARCH, &found) == YES) {
+        return found;
+    }
+#endif
+    splay(tree, data, kp);
+
+    // If data is in the tree return a pointer to it:
+    if (PREFIX_COMPARE(tree, kp, data, tree->root) == 0) {
+        return tree->root->data;
+    }
+
+    // Not found:
+    return NULL;
+}
+
+// Returns a pointer to the smallest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *sp_tree_min(sp_tree *tree) {
+
+#ifdef SP_SPLAY_POLICY
+    void *found;
+#endif
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Move the smallest element to the root
+#ifdef SP_SPLAY_POLICY
+    if (sp_lookup(tree, NULL, 0, SP_LOOKUP_MIN, &found) == YES) {
+        return found;
+    }
+#endif
+    splay_left(tree);
+
+    // And return a pointer to its data:
+    return tree->root->data;
+}
+
+// Returns a pointer to the biggest element stored in "tree".
+// Returns NULL if the tree is empty.
+//
+void *sp_tree_max(sp_tree *tree) {
+
+#ifdef SP_SPLAY_POLICY
+    void *found;
+#endif
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Move the biggest element to the root
+#ifdef SP_SPLAY_POLICY
+    if (sp_lookup(tree, NULL, 0, SP_LOOKUP_MAX, &found) == YES) {
+        return found;
+    }
+#endif
+    splay_right(tree);
+
+    // And return a pointer to its data:
+    return tree->root->data;
+}
+
+// Find the in-order predesor of data in the tree.
+//
+// If data is not in tree returns the biggest element of tree smaller than data.
+// If data is smaller or equal to all elements of tree returns NULL.
+//
+void *sp_tree_prev(sp_tree *tree, const void *data) {
+
+    sp_node *old_root;
+    int      comp;
+#ifdef SP_SPLAY_POLICY
+    void    *found;
+#endif
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // Trivial case: null data == return maximum
+    if (data == NULL) {
+        splay_right(tree);
+        return tree->root->data;
+    }
+
+    // General case: Splay data to the root
+#ifdef SP_SPLAY_POLICY
+    if (sp_lookup(tree, data, KEY_PREFIX(tree, data), SP_LOOKUP_PREV,
+                  &found) == YES) {
+        return found;
+    }
+#endif
+    splay(tree, data, KEY_PREFIX(tree, data));
+
+    // Take a look at the current root:
+    comp = COMPARE(tree, tree->root->data, data);
+
+    // If its bigger or equal we must find the predecessor in the left subtree:    
+    if (comp >= 0) {
+        if (tree->root->left == NULL) { return NULL; }
+        else {
+            old_root   = tree->root;
+            tree->root = tree->root->left;
+            old_root->left = NULL;
+            splay_right(tree);
+            tree->root->right = old_root;
+        }
+    }
+
+    // Predecessor is at root now:
+    return tree->root->data;
+}
+
+// Find the in-order successor of data in the tree.
+//
+// If data is not in tree returns the smallest element of tree bigger than data.
+// If data is bigger or equal to all elements of tree returns NULL.
+//
+void *sp_tree_next(sp_tree *tree, const void *data) {
+
+    sp_node *old_root;
+    int      comp;
+#ifdef SP_SPLAY_POLICY
+    void    *found;
+#endif
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // Trivial case: null data == return minimum
+    if (data == NULL) {
+        splay_left(tree);
+        return tree->root->data;
+    }
+
+    // General case: Splay data to the root
+#ifdef SP_SPLAY_POLICY
+    if (sp_lookup(tree, data, KEY_PREFIX(tree, data), SP_LOOKUP_NEXT,
+                  &found) == YES) {
+        return found;
+    }
+#endif
+    splay(tree, data, KEY_PREFIX(tree, data));
+
+    // Take a look at the current root:
+    comp = COMPARE(tree, tree->root->data, data);
+
+    // If its smaller or equal we must find the successor in the right subtree:
+    if (comp <= 0) {
+        if (tree->root->right == NULL) { return NULL; }
+        else {
+            old_root   = tree->root;
+            tree->root = tree->root->right;
+            old_root->right = NULL;
+            splay_left(tree);
+            tree->root->left = old_root;
+        }
+    }
+
+    // Predecessor is at root now:
+    return tree->root->data;
+}
+
+
+
+// BATCHES:
+
+// Splay trees do not need a finger: after each access the element is at the
+// root, so accessing the elements in increasing order takes O(1) amortized
+// time per element (this is the "sequential access theorem" of splay trees).
+
+// Inserts the n elements of data in tree.
+//
+// It works as if "sp_tree_insert" were called for every element of data (in
+// the same order), storing its result back in data: data[i] will be NULL or
+// a pointer to the previously stored element that data[i] has replaced (so
+// you can free it).
+//
+// The elements are inserted in increasing order, so each splay operation only
+// has to go down a few levels from the previous element.
+//
+void sp_tree_insert_batch(sp_tree *tree, void **data, size_t n) {
+
+    size_t *order;
+    size_t  i;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL || n == 0);
+
+    // Trivial case: empty batch
+    if (n == 0) { return; }
+
+    // Sort the batch (or insert it as is if out of memory):
+    order = sort_batch(tree->comp, (const void **) data, n);
+    if (order == NULL) {
+        for (i = 0; i < n; i++) { data[i] = sp_tree_insert(tree, data[i]); }
+        return;
+    }
+
+    // Insert the elements in increasing order:
+    for (i = 0; i < n; i++) {
+        data[order[i]] = sp_tree_insert(tree, data[order[i]]);
+    }
+
+    free(order);
+}
+
+// Searches the n elements of keys in tree. Stores in out[i] the element that
+// compares "equal" to keys[i] (or NULL if not found).
+//
+// The keys are searched in increasing order, so each splay operation only
+// has to go down a few levels from the previous key.
+//
+void sp_tree_search_batch(sp_tree *tree, const void **keys, void **out,
+                          size_t n) {
+
+    size_t *order;
+    size_t  i;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert((keys != NULL && out != NULL) || n == 0);
+
+    // Trivial case: empty batch
+    if (n == 0) { return; }
+
+    // Sort the batch (or search it as is if out of memory):
+    order = sort_batch(tree->comp, keys, n);
+    if (order == NULL) {
+        for (i = 0; i < n; i++) { out[i] = sp_tree_search(tree, keys[i]); }
+        return;
+    }
+
+    // Search the keys in increasing order:
+    for (i = 0; i < n; i++) {
+        out[order[i]] = sp_tree_search(tree, keys[order[i]]);
+    }
+
+    free(order);
+}
+
+// Searches the n elements of keys in tree. Stores in out[i] the element that
+// compares "equal" to keys[i] (or NULL if not found).
+//
+// Every search splays the tree, so (unlike "bs_tree_search_interleaved") the
+// searches cannot be interleaved: they are done one by one, in the given
+// order. It is provided so you can switch between variants easily.
+//
+void sp_tree_search_interleaved(sp_tree *tree, const void **keys, void **out,
+                                size_t n) {
+
+    size_t i;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert((keys != NULL && out != NULL) || n == 0);
+
+    // Search the keys:
+    for (i = 0; i < n; i++) { out[i] = sp_tree_search(tree, keys[i]); }
+}
+
+
+
+// CURSORS:
+
+// A cursor stores the whole path from the root of the tree to its current
+// node, so it can move to the in-order successor or predecessor without
+// restarting from the root and without modifying the tree. Each edge of the
+// tree is followed at most twice during a full traversal, so each call to
+// "sp_cursor_next" or "sp_cursor_prev" takes O(1) amortized time.
+//
+// Cursors never splay the tree (so they can be used while other cursors are
+// traversing it) but any insertion, removal or search in the tree invalidates
+// all its cursors (you must call "sp_cursor_first", "sp_cursor_last" or
+// "sp_cursor_seek" again).
+
+#define SP_CURSOR_CAPACITY 64   // Initial length of the path of a cursor
+
+// Creates a new cursor over tree. The cursor does not point to any node until
+// you call "sp_cursor_first", "sp_cursor_last" or "sp_cursor_seek".
+// Returns NULL if out of memory.
+//
+sp_cursor *new_sp_cursor(const sp_tree *tree) {
+
+    sp_cursor *cursor;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Allocate the cursor and its path:
+    cursor = (sp_cursor *) malloc(sizeof(sp_cursor));
+    if (cursor == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate sp_cursor\n");
+        return NULL;
+    }
+    cursor->path = (sp_node **) malloc(SP_CURSOR_CAPACITY * sizeof(sp_node *));
+    if (cursor->path == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate sp_cursor\n");
+        free(cursor);
+        return NULL;
+    }
+
+    // Initialize it:
+    cursor->tree     = tree;
+    cursor->size     = 0;
+    cursor->capacity = SP_CURSOR_CAPACITY;
+    return cursor;
+}
+
+// Releases all the memory used by cursor (but not the tree).
+//
+void free_sp_cursor(sp_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Free the path and the cursor:
+    free(cursor->path);
+    free(cursor);
+}
+
+// This is an auxiliary function that appends node to the path of cursor,
+// doubling the capacity of the path if needed. Returns NO if out of memory.
+//
+static int sp_cursor_push(sp_cursor *cursor, sp_node *node) {
+
+    sp_node **path;
+
+    // Grow the path if it is full:
+    if (cursor->size == cursor->capacity) {
+        path = (sp_node **) realloc(cursor->path,
+                                    2 * cursor->capacity * sizeof(sp_node *));
+        if (path == NULL) {
+            fprintf(stderr, "ERROR: Unable to grow sp_cursor\n");
+            return NO;
+        }
+        cursor->path      = path;
+        cursor->capacity *= 2;
+    }
+
+    // Append node:
+    cursor->path[cursor->size] = node;
+    cursor->size++;
+    return YES;
+}
+
+// This is an auxiliary function that appends node and all its leftmost
+// descendants to the path of cursor and returns the data of the last one.
+// If out of memory, it invalidates the cursor and returns NULL.
+//
+static void *sp_cursor_push_left(sp_cursor *cursor, sp_node *node) {
+
+    while (node != NULL) {
+        if (sp_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        node = node->left;
+    }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// This is an auxiliary function that appends node and all its rightmost
+// descendants to the path of cursor and returns the data of the last one.
+// If out of memory, it invalidates the cursor and returns NULL.
+//
+static void *sp_cursor_push_right(sp_cursor *cursor, sp_node *node) {
+
+    while (node != NULL) {
+        if (sp_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        node = node->right;
+    }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Moves cursor to the smallest element of its tree and returns it.
+// Returns NULL if the tree is empty.
+//
+void *sp_cursor_first(sp_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Restart the path from the root:
+    cursor->size = 0;
+    if (cursor->tree->root == NULL) { return NULL; }
+    return sp_cursor_push_left(cursor, cursor->tree->root);
+}
+
+// Moves cursor to the biggest element of its tree and returns it.
+// Returns NULL if the tree is empty.
+//
+void *sp_cursor_last(sp_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Restart the path from the root:
+    cursor->size = 0;
+    if (cursor->tree->root == NULL) { return NULL; }
+    return sp_cursor_push_right(cursor, cursor->tree->root);
+}
+
+// Moves cursor to the smallest element of its tree that is bigger or equal
+// to data and returns it. Returns NULL if there is no such element.
+//
+// Use it to start range scans: "sp_cursor_seek(cursor, lo)" followed by calls
+// to "sp_cursor_next" until you reach an element bigger than your upper bound.
+//
+void *sp_cursor_seek(sp_cursor *cursor, const void *data) {
+
+    sp_node *node;
+    size_t   best;
+    int      comp;
+
+    // Sanity Checks:
+    assert(cursor != NULL);
+    assert(data   != NULL);
+
+    // Search for data storing the path. The answer is the last node of the
+    // path where we turned left (or the node that compares "equal" to data):
+    cursor->size = 0;
+    best         = 0;
+    node         = cursor->tree->root;
+    while (node != NULL) {
+        if (sp_cursor_push(cursor, node) == NO) {
+            cursor->size = 0;
+            return NULL;
+        }
+        comp = COMPARE(cursor->tree, data, node->data);
+        if      (comp < 0) { best = cursor->size; node = node->left;  }
+        else if (comp > 0) {                      node = node->right; }
+        else               { best = cursor->size; break;              }
+    }
+
+    // Cut the path just after the answer (if any):
+    cursor->size = best;
+    if (best == 0) { return NULL; }
+    return cursor->path[best - 1]->data;
+}
+
+// Moves cursor to the in-order successor of its current element and returns
+// it. Returns NULL (and invalidates the cursor) if there is no such element.
+//
+void *sp_cursor_next(sp_cursor *cursor) {
+
+    sp_node *node;
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Trivial case: invalid cursor
+    if (cursor->size == 0) { return NULL; }
+
+    // If the current node has a right subtree, go to its smallest node:
+    node = cursor->path[cursor->size - 1];
+    if (node->right != NULL) {
+        return sp_cursor_push_left(cursor, node->right);
+    }
+
+    // Otherwise, climb until we leave a left subtree:
+    do {
+        cursor->size--;
+        node = cursor->path[cursor->size];
+    } while (cursor->size > 0 && cursor->path[cursor->size - 1]->right == node);
+
+    // Return the data of the new current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Moves cursor to the in-order predecessor of its current element and returns
+// it. Returns NULL (and invalidates the cursor) if there is no such element.
+//
+void *sp_cursor_prev(sp_cursor *cursor) {
+
+    sp_node *node;
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Trivial case: invalid cursor
+    if (cursor->size == 0) { return NULL; }
+
+    // If the current node has a left subtree, go to its biggest node:
+    node = cursor->path[cursor->size - 1];
+    if (node->left != NULL) {
+        return sp_cursor_push_right(cursor, node->left);
+    }
+
+    // Otherwise, climb until we leave a right subtree:
+    do {
+        cursor->size--;
+        node = cursor->path[cursor->size];
+    } while (cursor->size > 0 && cursor->path[cursor->size - 1]->left == node);
+
+    // Return the data of the new current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+// Returns the current element of cursor (or NULL if the cursor is invalid).
+//
+void *sp_cursor_get(const sp_cursor *cursor) {
+
+    // Sanity check:
+    assert(cursor != NULL);
+
+    // Return the data of the current node (if any):
+    if (cursor->size == 0) { return NULL; }
+    return cursor->path[cursor->size - 1]->data;
+}
+
+
+
+// REMOVE:
+
+// Removes a node of tree that compares "equal" to data and returns a pointer
+// to the previously stored data (so you can free it).
+// If such a node is not found, it returns a NULL pointer.
+//
+void *sp_tree_remove(sp_tree *tree, const void *data) {
+
+    sp_node *old_root;
+    void    *old_data = NULL;
+    uint64_t kp;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Avoid trivial case: empty tree
+    if (tree->root != NULL) {
+
+        // Splay the data to the root:
+        kp = KEY_PREFIX(tree, data);
+        splay(tree, data, kp);
+
+        // If it is here: remove it!
+        if (PREFIX_COMPARE(tree, kp, data, tree->root) == 0) {
+            old_root = tree->root;
+            old_data = tree->root->data;
+            if (tree->root->right == NULL) { tree->root = tree->root->left; }
+            else {
+                tree->root = tree->root->right;
+                splay_left(tree);
+                tree->root->left = old_root->left;
+            }
+            free_sp_node(tree, old_root);
+            bs_fix_min_max(tree);
+        }
+    }
+
+    // Return
+    return old_data;
+}
+
+// Removes the smallest element from "tree" and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+void *sp_tree_remove_min(sp_tree *tree) {
+
+    sp_node *old_root;
+    void    *old_data;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Avoid trivial case: empty tree
+    old_data = NULL;
+    if (tree->root != NULL) {
+
+        // Splay the smallest node to the root:
+        splay_left(tree);
+
+        // Remove it!
+        old_root   = tree->root;
+        old_data   = tree->root->data;
+        tree->root = tree->root->right;
+        free_sp_node(tree, old_root);
+        bs_fix_min_max(tree);
+    }
+
+    // Return
+    return old_data;
+}
+
+// Removes the biggest element from "tree" and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+void *sp_tree_remove_max(sp_tree *tree) {
+
+    sp_node *old_root;
+    void    *old_data;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Avoid trivial case: empty tree
+    old_data = NULL;
+    if (tree->root != NULL) {
+
+        // Splay the biggest node to the root:
+        splay_right(tree);
+
+        // Remove it!
+        old_root   = tree->root;
+        old_data   = tree->root->data;
+        tree->root = tree->root->left;
+        free_sp_node(tree, old_root);
+        bs_fix_min_max(tree);
+    }
+
+    // Return
+    return old_data;
+}
+
+// Removes all the elements from the tree in linear time. This is faster than
+// calling "tree_remove_min(tree)" until "tree_is_empty(tree)" returns "YES".
+//
+// If you provide a "free_data" function it will be used to free the "data"
+// inside each node. If "free_data" is NULL, no "data" will be freed. Use this
+// later option when "data" is shared between several data structures but be
+// aware that this may cause some memory leaks if you are not carefull.
+//
+// Most of the time, you can use just "free" as "free_data" function.
+// However if your "data" struct contains dinamically allocated data
+// you may need to provide a more complex "free_data" function like:
+//
+//  void free_data(void *ptr) {
+//      MyData *data = (MyData *) ptr;
+//      free(data->some_array);
+//      free(data->some_other_array);
+//      free(data);
+//  }
+//
+void sp_tree_remove_all(sp_tree *tree, void (* free_data) (void *)) {
+
+    sp_node *root;
+    sp_node *left;
+    sp_node *right;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Initialize:
+    root = tree->root;
+    tree->root = NULL;
+    MINMAX_CLEAR(tree);
+
+    // Pooled nodes are freed slab by slab, so only visit them to free data:
+    if (tree->pool != NULL && free_data == NULL) { root = NULL; }
+
+    // While the tree is not empty:
+    while (root != NULL) {
+
+        // Unravel the tree: Rotate right "root" & "left"
+        if (root->left != NULL) {
+            left        = root->left;
+            right       = left->right;
+            left->right = root;
+            root->left  = right;
+            root        = left;
+
+        // Erase the current "root" node:
+        } else {
+            right = root->right;
+            if (free_data != NULL) { free_data(root->data); }
+            if (tree->pool == NULL) { free(root); }
+            root = right;
+        }
+    }
+
+    // Release all the slabs of the pool at once:
+    if (tree->pool != NULL) { node_pool_clear(tree->pool); }
+}
+
+
+
+// SET FUNCTIONS:
+
+// Like "sp_tree_copy", the set functions walk their inputs in-order (see
+// IN-ORDER TRAVERSALS) instead of splaying them, so they never change their
+// shape and the output is built in a single pass.
+
+// Returns a (really degenerated) splay tree containing a copy of the union of
+// tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
+//
+// If a given "element" is in both trees it takes the pointer from tree_1.
+// Likewise, the new tree stores a pointer to the comparing function of tree_1.
+//
+// Takes O(|tree_1| + |tree_2|) time.
+//
+sp_tree *sp_tree_union(const sp_tree *tree_1, const sp_tree *tree_2) {
+
+    sp_tree   *tree = NULL;
+    sp_node   *node = NULL;
+    bs_walker  walker_1;
+    sp_node   *node_1;
+    bs_walker  walker_2;
+    sp_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return sp_tree_copy(tree_1); }
+
+    // Create a new tree:
+    tree = new_sp_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_sp_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_sp_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // insert node_2->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_sp_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_sp_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_2->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_sp_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_sp_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_sp_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_sp_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_1->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = bs_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Insert all remaining data from tree_2:
+    while (node_2 != NULL) {
+
+        // insert node_2->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_sp_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_sp_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_2->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_2 //////////////////////////////////////////////////////
+        node_2 = bs_walker_next(&walker_2);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        sp_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a (really degenerated) splay tree containing a copy of the
+// intersection of tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
+//
+// The comparing function and all data pointers are taken from tree_1.
+//
+// Takes O(|tree_1| + |tree_2|) time.
+//
+sp_tree *sp_tree_intersection(const sp_tree *tree_1, const sp_tree *tree_2) {
+
+    sp_tree   *tree = NULL;
+    sp_node   *node = NULL;
+    bs_walker  walker_1;
+    sp_node   *node_1;
+    bs_walker  walker_2;
+    sp_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return sp_tree_copy(tree_1); }
+
+    // Create a new tree:
+    tree = new_sp_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Some of them is empty
+    if (sp_tree_is_empty(tree_1) == YES) { return tree; }
+    if (sp_tree_is_empty(tree_2) == YES) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_sp_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_sp_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        sp_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a (really degenerated) splay tree containing a copy of the
+// difference: tree_1 - tree_2. It does NOT modify tree_1 or tree_2.
+//
+// The comparing function and all data pointers are taken from tree_1.
+//
+// Takes O(|tree_1| + |tree_2|) time.
+//
+sp_tree *sp_tree_diff(const sp_tree *tree_1, const sp_tree *tree_2) {
+
+    sp_tree   *tree = NULL;
+    sp_node   *node = NULL;
+    bs_walker  walker_1;
+    sp_node   *node_1;
+    bs_walker  walker_2;
+    sp_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Create a new tree:
+    tree = new_sp_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return tree; }
+
+    // Special case: Some of them is empty
+    if (sp_tree_is_empty(tree_1) == YES) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_sp_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_sp_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_sp_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_sp_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_1->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = bs_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        sp_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+// Returns a (really degenerated) splay tree containing a copy of the symmetric
+// difference of tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
+//
+// The comparing function is taken from tree_1.
+//
+// Takes O(|tree_1| + |tree_2|) time.
+//
+sp_tree *sp_tree_sym_diff(const sp_tree *tree_1, const sp_tree *tree_2) {
+
+    sp_tree   *tree = NULL;
+    sp_node   *node = NULL;
+    bs_walker  walker_1;
+    sp_node   *node_1;
+    bs_walker  walker_2;
+    sp_node   *node_2;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Create a new tree:
+    tree = new_sp_tree_as(tree_1);
+    if (tree == NULL) { return NULL; }
+
+    // Special case: Both trees are the same
+    if (tree_1 == tree_2) { return tree; }
+
+    // Go to the smallest element of tree_1:
+    node_1 = bs_walker_first(&walker_1, tree_1->root);
+
+    // Go to the smallest element of tree_2:
+    node_2 = bs_walker_first(&walker_2, tree_2->root);
+
+    // Until we have exhausted at least one of the trees:
+    while (node_1 != NULL && node_2 != NULL) {
+
+        // compare both nodes:
+        comp = COMPARE(tree, node_1->data, node_2->data);
+
+        if (comp < 0) {
+
+            // insert node_1->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_sp_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_sp_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_1->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // insert node_2->data in tree /////////////////////////////////////
+            if (node == NULL)  {
+                tree->root = new_sp_node(tree);
+                node = tree->root;
+            } else {
+                node->right = new_sp_node(tree);
+                node = node->right;
+            }
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+                bs_walker_free(&walker_1);
+                bs_walker_free(&walker_2);
+                return tree;
+            } else {
+                node->data  = node_2->data;
+                node->left  = NULL;
+                node->right = NULL;
+                SET_PREFIX(tree, node);
+                MINMAX_APPEND(tree, node);
+            }
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+
+        } else {
+
+            // advance node_1 //////////////////////////////////////////////////
+            node_1 = bs_walker_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+            // advance node_2 //////////////////////////////////////////////////
+            node_2 = bs_walker_next(&walker_2);
+            ////////////////////////////////////////////////////////////////////
+        }
+    }
+
+    // Insert all remaining data from tree_1:
+    while (node_1 != NULL) {
+
+        // insert node_1->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_sp_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_sp_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_1->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_1 //////////////////////////////////////////////////////
+        node_1 = bs_walker_next(&walker_1);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Insert all remaining data from tree_2:
+    while (node_2 != NULL) {
+
+        // insert node_2->data in tree /////////////////////////////////////////
+        if (node == NULL)  {
+            tree->root = new_sp_node(tree);
+            node = tree->root;
+        } else {
+            node->right = new_sp_node(tree);
+            node = node->right;
+        }
+        if (node == NULL) {
+            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
+            bs_walker_free(&walker_1);
+            bs_walker_free(&walker_2);
+            return tree;
+        } else {
+            node->data  = node_2->data;
+            node->left  = NULL;
+            node->right = NULL;
+            SET_PREFIX(tree, node);
+            MINMAX_APPEND(tree, node);
+        }
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_2 //////////////////////////////////////////////////////
+        node_2 = bs_walker_next(&walker_2);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Release the traversal stacks:
+    bs_walker_free(&walker_1);
+    bs_walker_free(&walker_2);
+
+    // The result is incomplete if a traversal ran out of memory:
+    if (walker_1.error == YES || walker_2.error == YES) {
+        sp_tree_remove_all(tree, NULL);
+        free(tree);
+        return NULL;
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+
+
+// KEY PREFIXES:
+
+#ifdef TREE_KEY_PREFIX
+
+// Sets the prefix function of tree (see "KEY PREFIXES" in the header) or goes
+// back to plain comparisons if prefix is NULL. Since every node computes its
+// prefix when it is created, the tree must still be empty.
+//
+void sp_tree_set_prefix(sp_tree *tree, uint64_t (* prefix) (const void *)) {
+
+    // Sanity checks:
+    assert(tree != NULL);
+    assert(tree->root == NULL);
+
+    // The nodes already in the tree would keep their old prefixes:
+    if (tree->root != NULL) {
+        fprintf(stderr, "ERROR: sp_tree must be empty to set its prefix\n");
+        return;
+    }
+
+    tree->prefix = prefix;
+}
+
+#endif
+
+// SPLAYING POLICIES:
+
+#ifdef SP_SPLAY_POLICY
+
+// Sets the splaying policy of tree (see "SPLAYING POLICIES" in the header):
+//  * SP_SPLAY_ALWAYS: param is ignored
+//  * SP_SPLAY_RANDOM: param is the probability of splaying (from 0 to 1)
+//  * SP_SPLAY_DEPTH:  param is the deepest level that does not splay (>= 0)
+//  * SP_SPLAY_EVERY:  param is the number of lookups per splay (>= 1)
+//
+// The policy can be changed at any time, even if the tree is not empty.
+//
+void sp_tree_set_splay_policy(sp_tree *tree, int policy, double param) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Check the parameter of the policy (NaN fails every comparison):
+    if ((policy == SP_SPLAY_RANDOM && !(param >= 0.0 && param <= 1.0)) ||
+        (policy == SP_SPLAY_DEPTH  && !(param >= 0.0))                 ||
+        (policy == SP_SPLAY_EVERY  && !(param >= 1.0))                 ||
+        policy < SP_SPLAY_ALWAYS || policy > SP_SPLAY_EVERY) {
+        fprintf(stderr, "ERROR: Invalid splaying policy for sp_tree\n");
+        return;
+    }
+
+    // Store the parameter as an integer threshold:
+    if (param > 1e18) { param = 1e18; }
+    tree->splay_policy = policy;
+    switch (policy) {
+        case SP_SPLAY_RANDOM:   // It is compared with 32 random bits
+            tree->splay_param = (uint64_t) (param * 4294967296.0);
+            tree->splay_state = SPLAY_SEED;
+            break;
+        case SP_SPLAY_DEPTH:
+            tree->splay_param = (uint64_t) param;
+            break;
+        case SP_SPLAY_EVERY:
+            tree->splay_param = (uint64_t) param;
+            tree->splay_state = 0;
+            break;
+        default:
+            tree->splay_param = 0;
+            break;
+    }
+}
+
+#endif
+
+// STATISTICS:
+
+#ifdef TREE_STATS
+
+// Returns a copy of the counters of tree (see "tree_stats" in the header).
+//
+tree_stats sp_tree_get_stats(const sp_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    return tree->stats;
+}
+
+// Sets all the counters of tree to zero.
+//
+void sp_tree_reset_stats(sp_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    STATS_RESET(tree);
+}
+
+#endif
+
+
+
+// DEBUG & VISUALIZATION:
+
+// This is an auxiliary function to check the symmetric order property
+// recursively. You should not use it directly, use "is_sp_tree" instead.
+//
+// Note that, unlike other functions of this library, it is safe to use
+// recursive definitions here since they will only be used to test the
+// code while debugging.
+//
+static int is_sp_subtree(const sp_tree *tree, const sp_node *node,
+                         const void *min, const void *max) {
+
+    // Make sure that node is (strictly) between specified limits:
+    if (min != NULL && COMPARE(tree, min, node->data) >= 0) {
+        fprintf(stderr,"ERROR: Symmetric order not satisfied in sp_tree\n");
+        return NO;
+    }
+    if (max != NULL && COMPARE(tree, node->data, max) >= 0) {
+        fprintf(stderr,"ERROR: Symmetric order not satisfied in sp_tree\n");
+        return NO;
+    }
+
+#ifdef TREE_KEY_PREFIX
+    // Check the cached prefix of node:
+    if (node->prefix != KEY_PREFIX(tree, node->data)) {
+        fprintf(stderr,"ERROR: Wrong key prefix in sp_tree\n");
+        return NO;
+    }
+#endif
+
+    // Check recursively the left subtree of node:
+    if (node->left != NULL) {
+        if (is_sp_subtree(tree, node->left, min, node->data) == NO) {
+            return NO;
+        }
+    }
+
+    // Check recursively the right subtree of node:
+    if (node->right != NULL) {
+        if (is_sp_subtree(tree, node->right, node->data, max) == NO) {
+            return NO;
+        }
+    }
+
+    // All test are fine:
+    return YES;
+}
+
+// This is an auxiliary function to check the symmetric order property of a
+// splay tree. Returns YES if everything is correct and NO otherwise.
+//
+// This function should not be used in production code. I recommend to use:
+//
+//      assert(is_sp_tree(tree) == YES);
+//
+// to automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
+//
+int is_sp_tree(const sp_tree *tree) {
+
+#ifdef TREE_MIN_MAX
+    const sp_node *node;
+#endif
+
+    // Basic Sanity Checks:
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to sp_tree\n");
+        return NO;
+    }
+    if (tree->comp == NULL) {
+        fprintf(stderr, "ERROR: NULL comparing function in sp_tree\n");
+        return NO;
+    }
+
+#ifdef TREE_MIN_MAX
+    // Check the cached leftmost & rightmost nodes (see MIN & MAX NODES):
+    node = tree->root;
+    while (node != NULL && node->left != NULL) { node = node->left; }
+    if (tree->leftmost != node) {
+        fprintf(stderr, "ERROR: Wrong leftmost node in sp_tree\n");
+        return NO;
+    }
+    node = tree->root;
+    while (node != NULL && node->right != NULL) { node = node->right; }
+    if (tree->rightmost != node) {
+        fprintf(stderr, "ERROR: Wrong rightmost node in sp_tree\n");
+        return NO;
+    }
+#endif
+
+    // Trivial Case: empty tree
+    if (tree->root == NULL) { return YES; }
+
+    // General Case:
+    return is_sp_subtree(tree, tree->root, NULL, NULL);
+}
+
+// This is an auxiliary function to print the tree recursively.
+// You should not use it directly, use "print_sp_tree" instead.
+//
+// Note that, unlike the rest of the functions of this library, it is safe
+// to use recursive definitions here since any tree large enough to hit the
+// recursion limit will be too big to be printed anyway.
+//
+static void print_sp_subtree(const sp_node *node, const int is_right,
+                             char *indent, void (* print_node) (const void *)) {
+
+    // Allocate memory:
+    char *new_indent = (char *) malloc((6+strlen(indent)*sizeof(char)));
+    assert(new_indent != NULL);
+
+    // Print right subtree recursively:
+    if (node->right != NULL) {
+        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
+        else                 { sprintf(new_indent, "%s%s", indent, "|     "); }
+        print_sp_subtree(node->right, YES, new_indent, print_node);
+    }
+
+    // Print current node:
+    if (is_right) { fprintf(stdout, "%s,----",indent); }
+    else          { fprintf(stdout, "%s`----",indent); }
+    if (print_node == NULL)  { fprintf(stdout, "(#)"); }
+    else                     { print_node(node->data); }
+    printf("\n");
+
+    // Print left subtree recursively:
+    if (node->left != NULL) {
+        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "|     "); }
+        else                 { sprintf(new_indent, "%s%s", indent, "      "); }
+        print_sp_subtree(node->left, NO, new_indent, print_node);
+    }
+
+    // Free memory:
+    free(new_indent);
+}
+
+// This function is used to print a splay tree on the screen.
+//
+//  * If a "print_node" function is provided it will be used to print the
+//    content of each node.
+//  * Otherwise (if print_node is NULL) all nodes will be printed as (#).
+//
+// Use this latter option if you only want to take a look at the tree shape.
+//
+// A correct print_node function only prints a single line of text using
+// the "fprintf" command. It should NOT include any "\n" in that line.
+//
+// For example:
+//
+//  void MyPrintNodeFunction(const void *ptr) {
+//      MyDataStruct *d = (MyDataStruct *) ptr;     // Pointer casting
+//      fprintf(stdout, "(%d)", d->key);            // Printing integer key
+//  }
+//
+// Finally, note that this is a visualization tool for debugging purposes only.
+//
+void print_sp_tree(const sp_tree *tree, void (* print_node) (const void *)) {
+
+    // Avoid the trivial cases:
+    if (tree != NULL && tree->root != NULL) {
+
+        // Print right subtree recursively:
+        if (tree->root->right != NULL) {
+            print_sp_subtree(tree->root->right, YES, "     ", print_node);
+        }
+
+        // Print current node:
+        fprintf(stdout, "----");
+        if (print_node == NULL) { fprintf(stdout, "(#)"); }
+        else { print_node(tree->root->data); }
+        fprintf(stdout, "\n");
+
+        // Print left subtree recursively:
+        if (tree->root->left != NULL) {
+            print_sp_subtree(tree->root->left, NO, "     ", print_node);
+        }
+    }
+
+    // Empty the "stdout" buffer:
+    fflush(stdout);
+}
+
+// END OF SPLAY TREES //////////////////////////////////////////////////////////
+
+
+
+
+
+// RED BLACK TREES WITH INTEGER KEYS ///////////////////////////////////////////
+
+// The following trees store an unsigned 64-bit key inside every node and
+// compare it with plain "<" and ">" instead of calling a comparing function
+// on the data. That saves an indirect call and a (probably cold) load of the
+// data on every level, so they are noticeably faster than a rb_tree with a
+// MyComp function on the same keys. The algorithms are exactly those of the
+// red black trees above.
+//
+// The data pointers are stored (and returned) as usual, so they must not be
+// NULL, but they are never dereferenced by the tree.
+//
+// Signed keys are stored in the same trees (rb_tree_i64 is just a rb_tree_u64)
+// after flipping their sign bit, which maps the int64_t order onto the
+// uint64_t order. Use the rb_tree_i64 functions and you will never see the
+// flipped keys.
+
+#define KEY_COMPARE(a, b)   (((a) > (b)) - ((a) < (b)))
+#define I64_TO_U64(k)       ((uint64_t) (k) ^ ((uint64_t) 1 << 63))
+#define U64_TO_I64(k)       ((int64_t) ((k) ^ ((uint64_t) 1 << 63)))
+
+
+// NODE ALLOCATION:
+
+// Returns a new (uninitialized) rb_node_u64 taken from the node pool of tree,
+// or from malloc if tree does not have a pool. Returns NULL if out of memory.
+//
+static inline rb_node_u64 *new_rb_node_u64(rb_tree_u64 *tree) {
+    if (tree->pool == NULL) {
+        return (rb_node_u64 *) malloc(sizeof(rb_node_u64));
+    }
+    else { return (rb_node_u64 *) node_pool_alloc(tree->pool); }
+}
+
+// Releases a rb_node_u64 previously obtained with "new_rb_node_u64".
+//
+static inline void free_rb_node_u64(rb_tree_u64 *tree, rb_node_u64 *node) {
+    if (tree->pool == NULL) { free(node); }
+    else                    { node_pool_free(tree->pool, node); }
+}
+
+// Returns a new empty rb_tree_u64 that has its own node pool if tree has one.
+// Used by the copy & set functions.
+//
+static rb_tree_u64 *new_rb_tree_u64_as(const rb_tree_u64 *tree) {
+    if (tree->pool == NULL) { return new_rb_tree_u64(); }
+    else { return new_rb_tree_u64_with_pool(tree->pool->capacity); }
+}
+
+
+
+// IN-ORDER TRAVERSALS:
+
+// Same walkers as the ones of the red black trees (see above):
+
+typedef struct rb_walker_u64 {
+    rb_node_u64  *node;                     // Current node (NULL if finished)
+    size_t        size;                     // Length of the stack
+    rb_node_u64  *stack[RB_WALKER_HEIGHT];  // Pending ancestors of node
+} rb_walker_u64;
+
+// This is an auxiliary function that pushes node and all its leftmost
+// descendants in the stack of walker and then pops the last one (the smallest
+// node of the subtree) as the current node of walker.
+//
+static rb_node_u64 *rb_walker_u64_descend(rb_walker_u64 *walker,
+                                          rb_node_u64   *node) {
+
+    // Push node and its leftmost descendants:
+    while (node != NULL) {
+        assert(walker->size < RB_WALKER_HEIGHT);
+        walker->stack[walker->size] = node;
+        walker->size++;
+        node = RB64_LEFT(node);
+    }
+
+    // Pop the smallest one:
+    if (walker->size == 0) { walker->node = NULL; }
+    else {
+        walker->size--;
+        walker->node = walker->stack[walker->size];
+    }
+    return walker->node;
+}
+
+// Starts an in-order traversal of the subtree rooted at root and returns its
+// smallest node (or NULL if root is NULL).
+//
+static rb_node_u64 *rb_walker_u64_first(rb_walker_u64 *walker,
+                                        rb_node_u64   *root) {
+    walker->size = 0;
+    return rb_walker_u64_descend(walker, root);
+}
+
+// Moves walker to the in-order successor of its current node and returns it
+// (or NULL if the traversal is finished).
+//
+static rb_node_u64 *rb_walker_u64_next(rb_walker_u64 *walker) {
+    if (walker->node == NULL) { return NULL; }
+    return rb_walker_u64_descend(walker, walker->node->right);
+}
+
+
+
+// CREATION & INSERTION:
+
+// Returns a pointer to a newly created rb_tree_u64 (or rb_tree_i64).
+// There is no comparing function: keys are compared as integers.
+//
+rb_tree_u64 *new_rb_tree_u64(void) {
+
+    // Allocate memory:
+    rb_tree_u64 *tree = (rb_tree_u64 *) malloc(sizeof(rb_tree_u64));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for rb_tree_u64\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->pool = NULL;
+    }
+
+    return tree;
+}
+
+// Returns a pointer to a newly created rb_tree_u64 (or rb_tree_i64) whose
+// nodes are allocated from a node pool. See "new_rb_tree_with_pool".
+//
+rb_tree_u64 *new_rb_tree_u64_with_pool(size_t capacity) {
+
+    // Allocate memory for the tree and its pool:
+    rb_tree_u64 *tree = (rb_tree_u64 *) malloc(sizeof(rb_tree_u64) +
+                                               sizeof(node_pool));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for rb_tree_u64\n");
+    }
+
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->pool = (node_pool *) (tree + 1);
+        init_node_pool(tree->pool, sizeof(rb_node_u64), capacity);
+    }
+
+    return tree;
+}
+
+// Returns a new rb_tree_u64 containing a copy of the tree.
+//
+// It takes O( |Tree|·Log(|Tree|) } ) time.
+//
+rb_tree_u64 *rb_tree_u64_copy(const rb_tree_u64 *tree) {
+
+    rb_tree_u64   *new_tree = NULL;
+    rb_walker_u64  walker;
+    rb_node_u64   *node;
+    void          *data;
+    
+    // Sanity check:
+    assert(tree != NULL);
+    
+    // Create a new tree:
+    new_tree = new_rb_tree_u64_as(tree);
+    if (new_tree == NULL) { return NULL; }
+
+    // Go to the smallest element of tree:
+    node = rb_walker_u64_first(&walker, tree->root);
+
+    // Insert all data from tree into new_tree:
+    while (node != NULL) {
+
+        // insert node->data in new_tree ///////////////////////////////////////
+        data = node->data;
+        data = rb_tree_u64_insert_max(new_tree, node->key, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node ////////////////////////////////////////////////////////
+        node = rb_walker_u64_next(&walker);
+        ////////////////////////////////////////////////////////////////////////
+    }
+    
+    // Return the new_tree:
+    return new_tree;
+}
+
+// Inserts data in tree with the given key.
+//
+// If a node of the tree has the same key its data will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *rb_tree_u64_insert(rb_tree_u64 *tree, uint64_t key, void *data) {
+
+    rb_node_u64 *anchor   = NULL;   // We need to store the last 4 levels:
+    rb_node_u64 *granpa   = NULL;   //
+    rb_node_u64 *parent   = NULL;   //            anchor
+    rb_node_u64 *node     = NULL;   //              |    <- comp_g
+    void        *old_data = NULL;   //            granpa
+    int          comp_g   = 0;      //              |    <- comp_p
+    int          comp_p   = 0;      //            parent
+    int          comp_n   = 0;      //              |    <- comp_n
+    int          comp     = 0;      //             node
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search for the correct place to insert data:
+    node = tree->root;
+    for (;;) {
+
+        // If we reach a leaf we must insert "data" here:
+        if (node == NULL) {
+
+            // Create a new node:
+            node = new_rb_node_u64(tree);
+            if (node == NULL) {
+                fprintf(stderr, "ERROR: Unable to allocate rb_node_u64\n");
+                break;
+            } else {
+                node->key   = key;
+                node->data  = data;
+                node->left  = NULL;
+                node->right = NULL;
+                RB64_SET_COLOR(node, RED);
+                comp        = 0;
+            }
+
+            // And attach it bellow "parent":
+            if (parent == NULL)  { tree->root    = node; }
+            else if (comp_n < 0) { RB64_SET_LEFT(parent, node); }
+            else                 { parent->right = node; }
+
+        // Otherwise "node" is an interior node:
+        } else {
+
+            // Compare "key" with "node->key":
+            comp = KEY_COMPARE(key, node->key);
+
+            // If the key is already there: Update and remember "old_data"
+            if (comp == 0) {
+                old_data   = node->data;
+                node->data = data;
+            }
+
+            // If "node" has two RED children: Make a color flip
+            if (IS_RED(RB64_LEFT(node)) && IS_RED(node->right)) {
+                RB64_SET_COLOR(node, RED);
+                RB64_SET_COLOR(RB64_LEFT(node), BLACK);
+                RB64_SET_COLOR(node->right, BLACK);
+            }
+        }
+
+        // Repair any violation of the RED property:
+        if (IS_RED(node) && IS_RED(parent)) {
+
+            // Case 1: Single "granpa-parent" left rotation
+            if (comp_p > 0 && comp_n > 0) {
+
+                granpa->right = RB64_LEFT(parent);
+                RB64_SET_COLOR(granpa, RED);
+                RB64_SET_LEFT(parent, granpa);
+                RB64_SET_COLOR(parent, BLACK);
+                
+                if  (anchor == NULL) { tree->root    = parent; }
+                else if (comp_g < 0) { RB64_SET_LEFT(anchor, parent); }
+                else if (comp_g > 0) { anchor->right = parent; }
+                granpa = anchor;
+                comp_p = comp_g;
+
+            // Case 2: Single "granpa-parent" right rotation
+            } else if (comp_p < 0 && comp_n < 0) {
+
+                RB64_SET_LEFT(granpa, parent->right);
+                RB64_SET_COLOR(granpa, RED);
+                parent->right = granpa;
+                RB64_SET_COLOR(parent, BLACK);
+                
+                if  (anchor == NULL) { tree->root    = parent; }
+                else if (comp_g < 0) { RB64_SET_LEFT(anchor, parent); }
+                else if (comp_g > 0) { anchor->right = parent; }
+                granpa = anchor;
+                comp_p = comp_g;
+
+            // Case 3: Double "granpa-parent-node" rotation
+            } else {
+
+                // Case 3.1: Left-Right
+                if (comp_n < 0) {
+                    granpa->right = RB64_LEFT(node);
+                    RB64_SET_COLOR(granpa, RED);
+                    RB64_SET_LEFT(parent, node->right);
+                    RB64_SET_LEFT(node, granpa);
+                    node->right   = parent;
+                    RB64_SET_COLOR(node, BLACK);
+                    if (comp > 0) { granpa = parent; }
+                    parent = node;
+                    node   = granpa;
+                    if (comp > 0) { comp_n *= -1;      }
+                    if (comp < 0) { comp_n  = -comp_p; }
+                    
+                // Case 3.2: Right-Left
+                } else {
+                    RB64_SET_LEFT(granpa, node->right);
+                    RB64_SET_COLOR(granpa, RED);
+                    parent->right = RB64_LEFT(node);
+                    node->right   = granpa;
+                    RB64_SET_LEFT(node, parent);
+                    RB64_SET_COLOR(node, BLACK);
+                    if (comp < 0) { granpa = parent; }
+                    parent = node;
+                    node   = granpa;
+                    if (comp < 0) { comp_n *= -1;      }
+                    if (comp > 0) { comp_n  = -comp_p; }
+                }
+
+                if  (anchor == NULL) { tree->root    = parent; }
+                else if (comp_g < 0) { RB64_SET_LEFT(anchor, parent); }
+                else if (comp_g > 0) { anchor->right = parent; }
+                granpa = anchor;
+                comp_p = comp_g;
+                comp  *= -1;
+            }
+        }
+
+        // Advance one step:
+        anchor = granpa;
+        granpa = parent;
+        parent = node;
+        if      (comp < 0) { node = RB64_LEFT(node); }  // Key is smaller
+        else if (comp > 0) { node = node->right;     }  // Key is bigger
+        else               { break;                  }  // We are done!
+
+        // And remember were you come from:
+        comp_g = comp_p;
+        comp_p = comp_n;
+        comp_n = comp;
+    }
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB64_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Inserts data with a key that is smaller or equal to any other key already in
+// the tree. It is slightly faster than a regular insert because it makes at
+// most one comparison.
+//
+// WARNING: If you use this function to insert a key that is strictly bigger
+//          than some key already in the tree you will break the tree!
+//
+// If a node of the tree has the same key its data will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *rb_tree_u64_insert_min(rb_tree_u64 *tree, uint64_t key, void *data) {
+
+    rb_node_u64 *anchor   = NULL;
+    rb_node_u64 *granpa   = NULL;
+    rb_node_u64 *parent   = NULL;
+    rb_node_u64 *node     = NULL;
+    void        *old_data = NULL;
+    int          inserted = NO;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search for the correct place to insert data:
+    node = tree->root;
+    for (;;) {
+
+        // If we reach a leaf we must insert "data" here:
+        if (node == NULL) {
+
+            // Perhaps "parent" already contains "key":
+            if (parent != NULL && parent->key == key) {
+                old_data     = parent->data;
+                parent->data = data;
+                break;
+
+            // Otherwise: Create a new node 
+            } else {            
+                node = new_rb_node_u64(tree);
+                if (node == NULL) {
+                    fprintf(stderr, "ERROR: Unable to allocate rb_node_u64\n");
+                    break;
+                } else {
+                    node->key   = key;
+                    node->data  = data;
+                    node->left  = NULL;
+                    node->right = NULL;
+                    RB64_SET_COLOR(node, RED);
+                    inserted    = YES;
+                }
+                if (parent == NULL)  { tree->root = node;            }
+                else                 { RB64_SET_LEFT(parent, node); }
+            }            
+            
+        // Otherwise: "node" may require a color flip
+        } else if (IS_RED(RB64_LEFT(node)) && IS_RED(node->right)) {
+            RB64_SET_COLOR(node, RED);
+            RB64_SET_COLOR(RB64_LEFT(node), BLACK);
+            RB64_SET_COLOR(node->right, BLACK);
+        }
+
+        // Repair any violation of the RED property: Single right rotation
+        if (IS_RED(node) && IS_RED(parent)) {
+            RB64_SET_LEFT(granpa, parent->right);
+            RB64_SET_COLOR(granpa, RED);
+            parent->right = granpa;
+            RB64_SET_COLOR(parent, BLACK);
+            if  (anchor == NULL) { tree->root = parent;            }
+            else                 { RB64_SET_LEFT(anchor, parent); }
+            granpa = anchor;
+        }
+
+        // Advance one step or exit:
+        if (inserted == YES) { break; }
+        anchor = granpa;
+        granpa = parent;
+        parent = node;
+        node   = RB64_LEFT(node);
+    }
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB64_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Inserts data with a key that is bigger or equal to any other key already in
+// the tree. It is slightly faster than a regular insert because it makes at
+// most one comparison.
+//
+// WARNING: If you use this function to insert a key that is strictly smaller
+//          than some key already in the tree you will break the tree!
+//
+// If a node of the tree has the same key its data will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *rb_tree_u64_insert_max(rb_tree_u64 *tree, uint64_t key, void *data) {
+
+    rb_node_u64 *anchor   = NULL;
+    rb_node_u64 *granpa   = NULL;
+    rb_node_u64 *parent   = NULL;
+    rb_node_u64 *node     = NULL;
+    void        *old_data = NULL;
+    int          inserted = NO;
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Search for the correct place to insert data:
+    node = tree->root;
+    for (;;) {
+
+        // If we reach a leaf we must insert "data" here:
+        if (node == NULL) {
+
+            // Perhaps "parent" already contains "key":
+            if (parent != NULL && parent->key == key) {
+                old_data     = parent->data;
+                parent->data = data;
+                break;
+
+            // Otherwise: Create a new node 
+            } else {            
+                node = new_rb_node_u64(tree);
+                if (node == NULL) {
+                    fprintf(stderr, "ERROR: Unable to allocate rb_node_u64\n");
+                    break;
+                } else {
+                    node->key   = key;
+                    node->data  = data;
+                    node->left  = NULL;
+                    node->right = NULL;
+                    RB64_SET_COLOR(node, RED);
+                    inserted    = YES;
+                }
+                if (parent == NULL)  { tree->root    = node; }
+                else                 { parent->right = node; }
+            }            
+            
+        // Otherwise: "node" may require a color flip
+        } else if (IS_RED(RB64_LEFT(node)) && IS_RED(node->right)) {
+            RB64_SET_COLOR(node, RED);
+            RB64_SET_COLOR(RB64_LEFT(node), BLACK);
+            RB64_SET_COLOR(node->right, BLACK);
+        }
+
+        // Repair any violation of the RED property: Single left rotation
+        if (IS_RED(node) && IS_RED(parent)) {
+            granpa->right = RB64_LEFT(parent);
+            RB64_SET_COLOR(granpa, RED);
+            RB64_SET_LEFT(parent, granpa);
+            RB64_SET_COLOR(parent, BLACK);
+            if  (anchor == NULL) { tree->root    = parent; }
+            else                 { anchor->right = parent; }
+            granpa = anchor;
+        }
+
+        // Advance one step or exit:
+        if (inserted == YES) { break; }
+        anchor = granpa;
+        granpa = parent;
+        parent = node;
+        node   = node->right;
+    }
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB64_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+
+
+// SEARCH:
+
+// Returns YES if the tree is empty and NO otherwise.
+//
+int rb_tree_u64_is_empty(const rb_tree_u64 *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Check if there is at least 1 node in the tree:
+    if (tree->root == NULL) { return YES; }
+    else                    { return NO;  }
+}
+
+// Finds the node with the given key. Returns its data or NULL if not found.
+//
+void *rb_tree_u64_search(const rb_tree_u64 *tree, uint64_t key) {
+
+    rb_node_u64 *node;
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Search:
+    node = tree->root;
+    while (node != NULL && node->key != key) {
+        if (key < node->key) { node = RB64_LEFT(node); }    // key is smaller
+        else                 { node = node->right;     }    // key is bigger
+    }
+
+    // Return the data (or NULL if not found):
+    return (node == NULL) ? NULL : node->data;
+}
+
+// Returns a pointer to the data with the smallest key stored in the tree (and
+// stores that key in "min_key" unless it is NULL).
+// Returns NULL if the tree is empty.
+//
+void *rb_tree_u64_min(const rb_tree_u64 *tree, uint64_t *min_key) {
+
+    rb_node_u64 *node;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Find the smallest node
+    node = tree->root;
+    while (RB64_LEFT(node) != NULL) { node = RB64_LEFT(node); }
+
+    // Return a pointer to the data:
+    if (min_key != NULL) { *min_key = node->key; }
+    return node->data;
+}
+
+// Returns a pointer to the data with the biggest key stored in the tree (and
+// stores that key in "max_key" unless it is NULL).
+// Returns NULL if the tree is empty.
+//
+void *rb_tree_u64_max(const rb_tree_u64 *tree, uint64_t *max_key) {
+
+    rb_node_u64 *node;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
+
+    // General case: Find the biggest node
+    node = tree->root;
+    while (node->right != NULL) { node = node->right; }
+
+    // Return a pointer to the data:
+    if (max_key != NULL) { *max_key = node->key; }
+    return node->data;
+}
+
+// Find the in-order predecesor of key in the tree and returns its data (and
+// stores its key in "prev_key" unless it is NULL).
+//
+// If key is not in tree it finds the biggest key of tree smaller than key.
+// If key is smaller or equal to all keys of tree returns NULL.
+//
+void *rb_tree_u64_prev(const rb_tree_u64 *tree, uint64_t key,
+                       uint64_t *prev_key) {
+
+    rb_node_u64 *node;
+    rb_node_u64 *pred;
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Search:
+    pred = NULL;
+    node = tree->root;
+    while (node != NULL) {
+
+        // Key is smaller:
+        if (key < node->key) { node = RB64_LEFT(node); }
+
+        // Key is bigger:
+        else if (key > node->key) {
+            pred = node;
+            node = node->right;
+        }
+
+        // We have found the node:
+        else if (RB64_LEFT(node) != NULL) {
+            pred = RB64_LEFT(node);
+            while (pred->right != NULL) { pred = pred->right; }
+            break;
+        } else { break; }
+    }
+
+    // Return predecesor:
+    if (pred == NULL) { return NULL; }
+    if (prev_key != NULL) { *prev_key = pred->key; }
+    return pred->data;
+}
+
+// Find the in-order successor of key in the tree and returns its data (and
+// stores its key in "next_key" unless it is NULL).
+//
+// If key is not in tree it finds the smallest key of tree bigger than key.
+// If key is bigger or equal to all keys of tree returns NULL.
+//
+void *rb_tree_u64_next(const rb_tree_u64 *tree, uint64_t key,
+                       uint64_t *next_key) {
+
+    rb_node_u64 *node;
+    rb_node_u64 *succ;
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Search:
+    succ = NULL;
+    node = tree->root;
+    while (node != NULL) {
+
+        // Key is smaller:
+        if (key < node->key) {
+            succ = node;
+            node = RB64_LEFT(node);
+        }
+
+        // Key is bigger:
+        else if (key > node->key) { node = node->right; }
+
+        // We have found the node:
+        else if (node->right != NULL) {
+            succ = node->right;
+            while (RB64_LEFT(succ) != NULL) { succ = RB64_LEFT(succ); }
+            break;
+        } else { break; }
+    }
+
+    // Return succesor:
+    if (succ == NULL) { return NULL; }
+    if (next_key != NULL) { *next_key = succ->key; }
+    return succ->data;
+}
+
+
+// REMOVE:
+
+// Removes the node of tree with the given key and returns a pointer to the
+// previously stored data (so you can free it).
+// If such a node is not found, it returns a NULL pointer.
+//
+// Uses the same trick as "rb_tree_remove": the key and data of the node are
+// replaced by those of its successor and then the successor is removed.
+//
+void *rb_tree_u64_remove(rb_tree_u64 *tree, uint64_t key) {
+
+    rb_node_u64 *granpa   = NULL;   // We need to store the last 3 levels //
+    rb_node_u64 *parent   = NULL;   //                                    //
+    rb_node_u64 *sister   = NULL;   //            granpa                  //
+    rb_node_u64 *node     = NULL;   //              |                     //
+    rb_node_u64 *old_node = NULL;   //            parent                  //
+    void        *old_data = NULL;   //            /    \   <- comp_n      //
+    int          comp_n   = 0;      //        sister  node                //
+    int          comp     = 0;      //                / \  <- comp        //
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Initialize the search at the root node:
+    node = tree->root;
+    if (node == NULL) { return NULL; }
+    
+    // Look for a leaf:
+    while (node != NULL) {
+
+        // At this point node is BLACK, if sister exists is BLACK and if parent 
+        // exists is RED. We want to paint node RED and repair any violation.
+
+        // Case 1: Node has two BLACK children
+        if (IS_BLACK(RB64_LEFT(node)) && IS_BLACK(node->right)) {
+
+            // Easy case: the node is the root node
+            if (parent == NULL) { RB64_SET_COLOR(node, RED); }
+
+            // General case:
+            else {
+
+                // Case 1.0: Node has no sister
+                if (sister == NULL) {
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+                    
+                // Case 1.1: Sister has 2 BLACK children
+                } else if (IS_BLACK(RB64_LEFT(sister)) && IS_BLACK(sister->right)){
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(sister, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+
+                // Case 1.2: Sister has at least 1 RED children
+                } else {
+
+                    // If sister->left is RED:
+                    if (IS_RED(RB64_LEFT(sister))) {
+
+                        // If sister == parent->right: Double rotation
+                        if (comp < 0) {
+
+                            if  (granpa == NULL) { tree->root    = RB64_LEFT(sister); }
+                            else if (comp_n < 0) { RB64_SET_LEFT(granpa, RB64_LEFT(sister)); }
+                            else                 { granpa->right = RB64_LEFT(sister); }
+                            granpa = RB64_LEFT(sister);
+                            
+                            parent->right = RB64_LEFT(granpa);
+                            RB64_SET_LEFT(granpa, parent);
+
+                            RB64_SET_LEFT(sister, granpa->right);
+                            granpa->right = sister;
+                            sister        = parent->right;
+                            
+                            RB64_SET_COLOR(node, RED);
+                            RB64_SET_COLOR(parent, BLACK);
+                        }
+
+                        // If sister == parent->left: Single rotation
+                        else {
+
+                            if  (granpa == NULL) { tree->root    = sister; }
+                            else if (comp_n < 0) { RB64_SET_LEFT(granpa, sister); }
+                            else                 { granpa->right = sister; }
+                            granpa = sister;
+                            
+                            RB64_SET_LEFT(parent, granpa->right);
+                            granpa->right = parent;
+                            sister        = RB64_LEFT(parent);
+                            
+                            RB64_SET_COLOR(node, RED);
+                            RB64_SET_COLOR(granpa, RED);
+                            RB64_SET_COLOR(parent, BLACK);
+                            RB64_SET_COLOR(RB64_LEFT(granpa), BLACK);
+                        }
+                    }
+
+                    // If sister->right is RED:
+                    else {
+
+                        // If sister == parent->left: Double rotation
+                        if (comp > 0) {
+
+                            if  (granpa == NULL) { tree->root    = sister->right; }
+                            else if (comp_n < 0) { RB64_SET_LEFT(granpa, sister->right); }
+                            else                 { granpa->right = sister->right; }
+                            granpa = sister->right;
+                            
+                            RB64_SET_LEFT(parent, granpa->right);
+                            granpa->right = parent;
+
+                            sister->right = RB64_LEFT(granpa);
+                            RB64_SET_LEFT(granpa, sister);
+                            sister        = RB64_LEFT(parent);
+                            
+                            RB64_SET_COLOR(node, RED);
+                            RB64_SET_COLOR(parent, BLACK);
+                        }
+
+                        // If sister == parent->right: Single rotation
+                        else {
+
+                            if  (granpa == NULL) { tree->root    = sister; }
+                            else if (comp_n < 0) { RB64_SET_LEFT(granpa, sister); }
+                            else                 { granpa->right = sister; }
+                            granpa = sister;
+                            
+                            parent->right = RB64_LEFT(granpa);
+                            RB64_SET_LEFT(granpa, parent);
+                            sister        = parent->right;
+
+                            RB64_SET_COLOR(node, RED);
+                            RB64_SET_COLOR(granpa, RED);
+                            RB64_SET_COLOR(parent, BLACK);
+                            RB64_SET_COLOR(granpa->right, BLACK);
+                        }
+                    }
+                }
+            }
+        }
+
+        // We compare the keys now because we need the information for "Case 2"
+
+        // Compare keys unless you already know where to go:
+        comp_n = comp;
+        comp   = (old_data == NULL) ? KEY_COMPARE(key, node->key) : (-1);
+
+        // If we have found the node to remove: Remember it!
+        if (comp == 0) {
+            old_data = node->data;
+            old_node = node;
+            comp     = +1;   // ...and search the successor
+        }
+        
+        // Case 2: Node has at least one RED children
+        if (IS_RED(RB64_LEFT(node)) || IS_RED(node->right)) {
+
+            // Again node is BLACK, if sister exists is BLACK and if parent
+            // exists is RED. We paint node RED and repair any violation.
+
+            // Case 2.1: We are moving to the RED node
+            if ((comp < 0 && IS_RED(RB64_LEFT(node) )) ||
+                (comp > 0 && IS_RED(node->right)) ){
+
+                // Move and compare again for free!
+                granpa = parent;
+                parent = node;
+                if (comp < 0) {
+                    node   = RB64_LEFT(parent);
+                    sister = parent->right;
+                } else if (comp > 0) {
+                    node   = parent->right;
+                    sister = RB64_LEFT(parent);
+                }
+                comp_n = comp;
+                comp   = (old_data == NULL) ? KEY_COMPARE(key, node->key) : (-1);
+                if (comp == 0) {
+                    old_data = node->data;
+                    old_node = node;
+                    comp     = +1;
+                }
+            }
+            
+            // Case 2.2: We are moving to the BLACK node
+            else {
+                // If we are moving to the left: Single left-rotation
+                if (comp < 0) {
+                    if  (parent == NULL) { tree->root    = node->right; }
+                    else if (comp_n < 0) { RB64_SET_LEFT(parent, node->right); }
+                    else                 { parent->right = node->right; }
+                    granpa        = parent;
+                    parent        = node->right;
+                    sister        = parent->right;
+                    node->right   = RB64_LEFT(parent);
+                    RB64_SET_LEFT(parent, node);
+                                        
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+
+                    comp_n = -1;
+                }
+
+                // If we are moving to the right: Single right-rotation
+                else {
+                    if  (parent == NULL) { tree->root    = RB64_LEFT(node); }
+                    else if (comp_n < 0) { RB64_SET_LEFT(parent, RB64_LEFT(node)); }
+                    else                 { parent->right = RB64_LEFT(node); }
+                    granpa        = parent;
+                    parent        = RB64_LEFT(node);
+                    sister        = RB64_LEFT(parent);
+                    RB64_SET_LEFT(node, parent->right);
+                    parent->right = node;
+                                        
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+
+                    comp_n = 1;
+                }                
+            }
+        }
+
+        // ...and finally move!
+        granpa = parent;
+        parent = node;
+        if (comp < 0) {
+            node   = RB64_LEFT(parent);
+            sister = parent->right;
+        } else if (comp > 0) {
+            node   = parent->right;
+            sister = RB64_LEFT(parent);
+        }
+    }
+
+    // Erase "parent", which should be RED:
+    if (old_node != NULL) {
+        old_node->key  = parent->key;
+        old_node->data = parent->data;
+        if (granpa == NULL) { tree->root = parent->right; }
+        else if (RB64_LEFT(granpa) == parent) {
+            RB64_SET_LEFT(granpa, parent->right);
+        }
+        else { granpa->right = parent->right; }
+        free_rb_node_u64(tree, parent);
+    }
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB64_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
+    return old_data;
+}
+
+// Removes the smallest key from "tree" and returns a pointer to its data
+// (so you can free it) and stores the key in "min_key" unless it is NULL.
+// If the tree is empty returns a NULL pointer.
+//
+// More efficient than "tree_remove(tree, min_elem)" even if you already know
+// the value of "min_elem".
+//
+void *rb_tree_u64_remove_min(rb_tree_u64 *tree, uint64_t *min_key) {
+
+    rb_node_u64 *granpa   = NULL;   //      granpa      //
+    rb_node_u64 *parent   = NULL;   //        |         //
+    rb_node_u64 *sister   = NULL;   //      parent      //
+    rb_node_u64 *node     = NULL;   //      /    \      // 
+    void        *old_data = NULL;   //   node  sister   //
+
+    // Sanity Check:
+    assert(tree != NULL);
+
+    // Initialize the search at the root node:
+    node = tree->root;
+    if (node == NULL) { return NULL; }
+    
+    // Look for a leaf:
+    while (node != NULL) {
+
+        // At this point node is BLACK, if sister exists is BLACK and if parent 
+        // exists is RED. We want to paint node RED and repair any violation.
+
+        // Case 1: Node has two BLACK children
+        if (IS_BLACK(RB64_LEFT(node)) && IS_BLACK(node->right)) {
+
+            // Easy case: the node is the root node
+            if (parent == NULL) { RB64_SET_COLOR(node, RED); }
+
+            // General case:
+            else {
+
+                // Case 1.0: Node has no sister
+                if (sister == NULL) {
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+                    
+                // Case 1.1: Sister has 2 BLACK children
+                } else if (IS_BLACK(RB64_LEFT(sister)) && IS_BLACK(sister->right)){
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(sister, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+
+                // Case 1.2: Sister has at least 1 RED children
+                } else {
+
+                    // If sister->left is RED:
+                    if (IS_RED(RB64_LEFT(sister))) {
+
+                        // Sister == parent->right: Double rotation
+                        if  (granpa == NULL) { tree->root    = RB64_LEFT(sister); }
+                        else                 { RB64_SET_LEFT(granpa, RB64_LEFT(sister)); }
+                        granpa = RB64_LEFT(sister);
+                        
+                        parent->right = RB64_LEFT(granpa);
+                        RB64_SET_LEFT(granpa, parent);
+
+                        RB64_SET_LEFT(sister, granpa->right);
+                        granpa->right = sister;
+                        sister        = parent->right;
+                        
+                        RB64_SET_COLOR(node, RED);
+                        RB64_SET_COLOR(parent, BLACK);
+                    }
+
+                    // If sister->right is RED:
+                    else {
+
+                        // Sister == parent->right: Single rotation
+                        if  (granpa == NULL) { tree->root    = sister; }
+                        else                 { RB64_SET_LEFT(granpa, sister); }
+                        granpa = sister;
+
+                        parent->right = RB64_LEFT(granpa);
+                        RB64_SET_LEFT(granpa, parent);
+                        sister        = parent->right;
+
+                        RB64_SET_COLOR(node, RED);
+                        RB64_SET_COLOR(granpa, RED);
+                        RB64_SET_COLOR(parent, BLACK);
+                        RB64_SET_COLOR(granpa->right, BLACK);
+                    }
+                }
+            }
+        }
+
+        // Case 2: Node has at least one RED children
+        if (IS_RED(RB64_LEFT(node)) || IS_RED(node->right)) {
+
+            // Again node is BLACK, if sister exists is BLACK and if parent
+            // exists is RED. We paint node RED and repair any violation.
+
+            // Case 2.1: We are moving to the RED node
+            if (IS_RED(RB64_LEFT(node))){
+
+                // Move and compare again for free!
+                granpa = parent;
+                parent = node;
+                node   = RB64_LEFT(parent);
+                sister = parent->right;
+            }
+            
+            // Case 2.2: We are moving to the BLACK node
+            else {
+                // We are moving to the left: Single left-rotation
+                if  (parent == NULL) { tree->root    = node->right; }
+                else                 { RB64_SET_LEFT(parent, node->right); }
+                granpa        = parent;
+                parent        = node->right;
+                sister        = parent->right;
+                node->right   = RB64_LEFT(parent);
+                RB64_SET_LEFT(parent, node);
+                                    
+                RB64_SET_COLOR(node, RED);
+                RB64_SET_COLOR(parent, BLACK);
+            }
+        }
+
+        // ...and finally move!
+        granpa = parent;
+        parent = node;
+        node   = RB64_LEFT(parent);
+        sister = parent->right;
     }
+
+    // Erase "parent", which should be RED:
+    old_data = parent->data;
+    if (min_key != NULL) { *min_key = parent->key; }
+    if (granpa == NULL) { tree->root   = parent->right; }
+    else                { RB64_SET_LEFT(granpa, parent->right); }
+    free_rb_node_u64(tree, parent);
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB64_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
     return old_data;
 }
 
-// Removes the biggest element from "tree" and returns a pointer to its data
-// (so you can free it). If the tree is empty returns a NULL pointer.
+// Removes the biggest key from "tree" and returns a pointer to its data
+// (so you can free it) and stores the key in "max_key" unless it is NULL.
+// If the tree is empty returns a NULL pointer.
 //
 // More efficient than "tree_remove(tree, max_data)" even if you already know
 // the value of "max_data".
 //
-void *bs_tree_remove_max(bs_tree *tree) {
+void *rb_tree_u64_remove_max(rb_tree_u64 *tree, uint64_t *max_key) {
 
-    bs_node *node;
-    bs_node *parent;
-    void        *old_data;
+    rb_node_u64 *granpa   = NULL;   //      granpa      //
+    rb_node_u64 *parent   = NULL;   //        |         //
+    rb_node_u64 *sister   = NULL;   //      parent      //
+    rb_node_u64 *node     = NULL;   //      /    \      // 
+    void        *old_data = NULL;   //   sister node    //
 
-    // Sanity check:
+    // Sanity Check:
     assert(tree != NULL);
+    
+    // Initialize the search at the root node:
+    node = tree->root;
+    if (node == NULL) { return NULL; }
+    
+    // Look for a leaf:
+    while (node != NULL) {
 
-    // Avoid trivial case: empty tree
-    old_data = NULL;
-    if (tree->root != NULL) {
+        // At this point node is BLACK, if sister exists is BLACK and if parent 
+        // exists is RED. We want to paint node RED and repair any violation.
 
-        // General case: Find the biggest node
-        parent = NULL;
-        node   = tree->root;
-        while (node->right != NULL) {
-            parent = node;
-            node   = node->right;
+        // Case 1: Node has two BLACK children
+        if (IS_BLACK(RB64_LEFT(node)) && IS_BLACK(node->right)) {
+
+            // Easy case: the node is the root node
+            if (parent == NULL) { RB64_SET_COLOR(node, RED); }
+
+            // General case:
+            else {
+
+                // Case 1.0: Node has no sister
+                if (sister == NULL) {
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+                    
+                // Case 1.1: Sister has 2 BLACK children
+                } else if (IS_BLACK(RB64_LEFT(sister)) && IS_BLACK(sister->right)){
+                    RB64_SET_COLOR(node, RED);
+                    RB64_SET_COLOR(sister, RED);
+                    RB64_SET_COLOR(parent, BLACK);
+
+                // Case 1.2: Sister has at least 1 RED children
+                } else {
+
+                    // If sister->left is RED:
+                    if (IS_RED(RB64_LEFT(sister))) {
+
+                        // Sister == parent->left: Single rotation
+                        if  (granpa == NULL) { tree->root    = sister; }
+                        else                 { granpa->right = sister; }
+                        granpa = sister;
+                        
+                        RB64_SET_LEFT(parent, granpa->right);
+                        granpa->right = parent;
+                        sister        = RB64_LEFT(parent);
+                        
+                        RB64_SET_COLOR(node, RED);
+                        RB64_SET_COLOR(granpa, RED);
+                        RB64_SET_COLOR(parent, BLACK);
+                        RB64_SET_COLOR(RB64_LEFT(granpa), BLACK);
+                    }
+
+                    // If sister->right is RED:
+                    else {
+
+                        // If sister == parent->left: Double rotation
+                        if  (granpa == NULL) { tree->root    = sister->right; }
+                        else                 { granpa->right = sister->right; }
+                        granpa = sister->right;
+                        
+                        RB64_SET_LEFT(parent, granpa->right);
+                        granpa->right = parent;
+
+                        sister->right = RB64_LEFT(granpa);
+                        RB64_SET_LEFT(granpa, sister);
+                        sister        = RB64_LEFT(parent);
+                        
+                        RB64_SET_COLOR(node, RED);
+                        RB64_SET_COLOR(parent, BLACK);
+                    }
+                }
+            }
         }
-        old_data = node->data;
 
-        // Remove Node:
-        if (parent != NULL) { parent->right = node->left; }
-        else                { tree->root    = node->left; }
-        free(node);
+        // Case 2: Node has at least one RED children
+        if (IS_RED(RB64_LEFT(node)) || IS_RED(node->right)) {
+
+            // Again node is BLACK, if sister exists is BLACK and if parent
+            // exists is RED. We paint node RED and repair any violation.
+
+            // Case 2.1: We are moving to the RED node
+            if (IS_RED(node->right)){
+
+                // Move and compare again for free!
+                granpa = parent;
+                parent = node;
+                node   = parent->right;
+                sister = RB64_LEFT(parent);
+            }
+            
+            // Case 2.2: We are moving to the BLACK node
+            else {
+                // we are moving to the right: Single right-rotation
+                if  (parent == NULL) { tree->root    = RB64_LEFT(node); }
+                else                 { parent->right = RB64_LEFT(node); }
+                granpa        = parent;
+                parent        = RB64_LEFT(node);
+                sister        = RB64_LEFT(parent);
+                RB64_SET_LEFT(node, parent->right);
+                parent->right = node;
+                                    
+                RB64_SET_COLOR(node, RED);
+                RB64_SET_COLOR(parent, BLACK);
+            }
+        }
+
+        // ...and finally move!
+        granpa = parent;
+        parent = node;
+        node   = parent->right;
+        sister = RB64_LEFT(parent);
     }
+
+    // Erase "parent", which should be RED:
+    old_data = parent->data;
+    if (max_key != NULL) { *max_key = parent->key; }
+    if (granpa == NULL) { tree->root    = RB64_LEFT(parent); }
+    else                { granpa->right = RB64_LEFT(parent); }
+    free_rb_node_u64(tree, parent);
+
+    // Before leaving: Make sure that the root is BLACK!
+    if (tree->root != NULL) { RB64_SET_COLOR(tree->root, BLACK); }
+
+    // And return old_data (which will be NULL unless data was already here)
     return old_data;
 }
 
-// Removes all the elements from the tree in linear time. This is faster than
-// calling "tree_remove_min(tree)" until "tree_is_empty(tree)" returns "YES".
-//
-// If you provide a "free_data" function it will be used to free the "data"
-// inside each node. If "free_data" is NULL, no "data" will be freed. Use this
-// later option when "data" is shared between several data structures but be
-// aware that this may cause some memory leaks if you are not carefull.
-//
-// Most of the time, you can use just "free" as "free_data" function.
-// However if your "data" struct contains dinamically allocated data
-// you may need to provide a more complex "free_data" function like:
-//
-//  void free_data(void *ptr) {
-//      MyData *data = (MyData *) ptr;
-//      free(data->some_array);
-//      free(data->some_other_array);
-//      free(data);
-//  }
+// Removes all the elements from the tree in linear time. If you provide a
+// "free_data" function it will be used to free the "data" inside each node
+// (see "rb_tree_remove_all").
 //
-void bs_tree_remove_all(bs_tree *tree, void (* free_data) (void *)) {
+void rb_tree_u64_remove_all(rb_tree_u64 *tree, void (* free_data) (void *)) {
 
-    bs_node *root;
-    bs_node *left;
-    bs_node *right;
+    rb_node_u64 *root;
+    rb_node_u64 *left;
+    rb_node_u64 *right;
 
     // Sanity check:
     assert(tree != NULL);
@@ -719,229 +11278,116 @@ void bs_tree_remove_all(bs_tree *tree, void (* free_data) (void *)) {
     root = tree->root;
     tree->root = NULL;
 
+    // Pooled nodes are freed slab by slab, so only visit them to free data:
+    if (tree->pool != NULL && free_data == NULL) { root = NULL; }
+
     // While the tree is not empty:
     while (root != NULL) {
 
         // Unravel the tree: Rotate right "root" & "left"
-        if (root->left != NULL) {
-            left        = root->left;
+        if (RB64_LEFT(root) != NULL) {
+            left        = RB64_LEFT(root);
             right       = left->right;
             left->right = root;
-            root->left  = right;
+            RB64_SET_LEFT(root, right);
             root        = left;
 
         // Erase the current "root" node:
         } else {
             right = root->right;
             if (free_data != NULL) { free_data(root->data); }
-            free(root);
+            if (tree->pool == NULL) { free(root); }
             root = right;
         }
     }
+
+    // Release all the slabs of the pool at once:
+    if (tree->pool != NULL) { node_pool_clear(tree->pool); }
 }
 
 
 
 // SET FUNCTIONS:
 
-// Returns a (really degenerated) binary tree containing a copy of the union of
-// tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
-//
-// If a given "element" is in both trees it takes the pointer from tree_1.
-// Likewise, the new tree stores a pointer to the comparing function of tree_1.
-//
-// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
+// Returns a rb_tree_u64 containing a copy of the union of tree_1 and tree_2.
+// It does NOT modify tree_1 or tree_2.
 //
-//      bs_tree_rebalance(tree);
+// If a given key is in both trees it takes the data pointer from tree_1.
 //
-// afterwards "for free", but I prefer to return the degenerate tree because
-// it will speed up a little bit future aplications of other "set functions".
-// Please, take a moment to decide if you want to post-process the tree with
-// a total rebalance operation.
+// It takes O( MAX{ |tree_1|+|tree_2|, |Union|·Log(|Union|) } ) time.
 //
-bs_tree *bs_tree_union(const bs_tree *tree_1, const bs_tree *tree_2) {
+rb_tree_u64 *rb_tree_u64_union(const rb_tree_u64 *tree_1,
+                               const rb_tree_u64 *tree_2) {
 
-    bs_tree *tree = NULL;
-    bs_node *node = NULL;
-    bs_node *pred_1;
-    bs_node *node_1;
-    bs_node *pred_2;
-    bs_node *node_2;
-    int      comp;
+    rb_tree_u64   *tree = NULL;
+    rb_walker_u64  walker_1;
+    rb_node_u64   *node_1;
+    rb_walker_u64  walker_2;
+    rb_node_u64   *node_2;
+    void          *data;
+    int            comp;
 
     // Sanity check:
     assert(tree_1 != NULL);
     assert(tree_2 != NULL);
 
     // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return bs_tree_copy(tree_1); }
+    if (tree_1 == tree_2) { return rb_tree_u64_copy(tree_1); }
 
     // Create a new tree:
-    tree = new_bs_tree(tree_1->comp);
+    tree = new_rb_tree_u64_as(tree_1);
     if (tree == NULL) { return NULL; }
 
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
-    }
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_u64_first(&walker_1, tree_1->root);
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
-        }
-    }
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_u64_first(&walker_2, tree_2->root);
 
     // Until we have exhausted at least one of the trees:
     while (node_1 != NULL && node_2 != NULL) {
 
         // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
+        comp = KEY_COMPARE(node_1->key, node_2->key);
 
         if (comp < 0) {
 
             // insert node_1->data in tree /////////////////////////////////////
-            if (node == NULL)  {
-                tree->root = (bs_node *) malloc(sizeof(bs_node));
-                node = tree->root;
-            } else {
-                node->right = (bs_node *) malloc(sizeof(bs_node));
-                node = node->right;
-            }
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-                return tree;
-            } else {
-                node->data  = node_1->data;
-                node->left  = NULL;
-                node->right = NULL;
-            }
+            data = node_1->data;
+            data = rb_tree_u64_insert_max(tree, node_1->key, data);
+            assert(data == NULL);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
-
-        } else if (comp > 0) {
-
-            // insert node_2->data in tree /////////////////////////////////////
-            if (node == NULL)  {
-                tree->root = (bs_node *) malloc(sizeof(bs_node));
-                node = tree->root;
-            } else {
-                node->right = (bs_node *) malloc(sizeof(bs_node));
-                node = node->right;
-            }
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-                return tree;
-            } else {
-                node->data  = node_2->data;
-                node->left  = NULL;
-                node->right = NULL;
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
+            ////////////////////////////////////////////////////////////////////
+
+        } else if (comp > 0) {
+
+            // insert node_2->data in tree /////////////////////////////////////
+            data = node_2->data;
+            data = rb_tree_u64_insert_max(tree, node_2->key, data);
+            assert(data == NULL);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
 
         } else {
 
             // insert node_1->data in tree /////////////////////////////////////
-            if (node == NULL)  {
-                tree->root = (bs_node *) malloc(sizeof(bs_node));
-                node = tree->root;
-            } else {
-                node->right = (bs_node *) malloc(sizeof(bs_node));
-                node = node->right;
-            }
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-                return tree;
-            } else {
-                node->data  = node_1->data;
-                node->left  = NULL;
-                node->right = NULL;
-            }
+            data = node_1->data;
+            data = rb_tree_u64_insert_max(tree, node_1->key, data);
+            assert(data == NULL);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
         }
     }
@@ -950,40 +11396,13 @@ bs_tree *bs_tree_union(const bs_tree *tree_1, const bs_tree *tree_2) {
     while (node_1 != NULL) {
 
         // insert node_1->data in tree /////////////////////////////////////////
-        if (node == NULL)  {
-            tree->root = (bs_node *) malloc(sizeof(bs_node));
-            node = tree->root;
-        } else {
-            node->right = (bs_node *) malloc(sizeof(bs_node));
-            node = node->right;
-        }
-        if (node == NULL) {
-            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-            return tree;
-        } else {
-            node->data  = node_1->data;
-            node->left  = NULL;
-            node->right = NULL;
-        }
+        data = node_1->data;
+        data = rb_tree_u64_insert_max(tree, node_1->key, data);
+        assert(data == NULL);
         ////////////////////////////////////////////////////////////////////////
 
         // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
-            }
-        }
+        node_1 = rb_walker_u64_next(&walker_1);
         ////////////////////////////////////////////////////////////////////////
     }
 
@@ -991,40 +11410,13 @@ bs_tree *bs_tree_union(const bs_tree *tree_1, const bs_tree *tree_2) {
     while (node_2 != NULL) {
 
         // insert node_2->data in tree /////////////////////////////////////////
-        if (node == NULL)  {
-            tree->root = (bs_node *) malloc(sizeof(bs_node));
-            node = tree->root;
-        } else {
-            node->right = (bs_node *) malloc(sizeof(bs_node));
-            node = node->right;
-        }
-        if (node == NULL) {
-            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-            return tree;
-        } else {
-            node->data  = node_2->data;
-            node->left  = NULL;
-            node->right = NULL;
-        }
+        data = node_2->data;
+        data = rb_tree_u64_insert_max(tree, node_2->key, data);
+        assert(data == NULL);
         ////////////////////////////////////////////////////////////////////////
 
         // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
-            }
-        }
+        node_2 = rb_walker_u64_next(&walker_2);
         ////////////////////////////////////////////////////////////////////////
     }
 
@@ -1032,389 +11424,155 @@ bs_tree *bs_tree_union(const bs_tree *tree_1, const bs_tree *tree_2) {
     return tree;
 }
 
-// Returns a (really degenerated) binary tree containing a copy of the
-// intersection of tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
-//
-// The comparing function and all data pointers are taken from tree_1.
+// Returns a rb_tree_u64 containing a copy of the intersection of tree_1 and
+// tree_2. It does NOT modify tree_1 or tree_2.
 //
-// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
-//
-//      bs_tree_rebalance(tree);
+// All data pointers are taken from tree_1.
 //
-// afterwards "for free", but I prefer to return the degenerate tree because
-// it will speed up a little bit future aplications of other "set functions".
-// Please, take a moment to decide if you want to post-process the tree with
-// a total rebalance operation.
+// It takes O( MAX{ |tree_1|+|tree_2|, |Intersec|·Log(|Intersec|) } ) time.
 //
-bs_tree *bs_tree_intersection(const bs_tree *tree_1, const bs_tree *tree_2) {
+rb_tree_u64 *rb_tree_u64_intersection(const rb_tree_u64 *tree_1,
+                                      const rb_tree_u64 *tree_2) {
 
-    bs_tree *tree = NULL;
-    bs_node *node = NULL;
-    bs_node *pred_1;
-    bs_node *node_1;
-    bs_node *pred_2;
-    bs_node *node_2;
-    int      comp;
+    rb_tree_u64   *tree = NULL;
+    rb_walker_u64  walker_1;
+    rb_node_u64   *node_1;
+    rb_walker_u64  walker_2;
+    rb_node_u64   *node_2;
+    void          *data;
+    int            comp;
 
     // Sanity check:
     assert(tree_1 != NULL);
     assert(tree_2 != NULL);
 
     // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return bs_tree_copy(tree_1); }
+    if (tree_1 == tree_2) { return rb_tree_u64_copy(tree_1); }
 
-    // Create a new tree:
-    tree = new_bs_tree(tree_1->comp);
+    // Create a new tree:    
+    tree = new_rb_tree_u64_as(tree_1);
     if (tree == NULL) { return NULL; }
 
     // Special case: Some of them is empty
-    if (bs_tree_is_empty(tree_1) == YES) { return tree; }
-    if (bs_tree_is_empty(tree_2) == YES) { return tree; }
+    if (rb_tree_u64_is_empty(tree_1) == YES) { return tree; }
+    if (rb_tree_u64_is_empty(tree_2) == YES) { return tree; }
 
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
-    }
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_u64_first(&walker_1, tree_1->root);
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
-        }
-    }
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_u64_first(&walker_2, tree_2->root);
 
     // Until we have exhausted at least one of the trees:
     while (node_1 != NULL && node_2 != NULL) {
 
         // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
+        comp = KEY_COMPARE(node_1->key, node_2->key);
 
         if (comp < 0) {
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
             ////////////////////////////////////////////////////////////////////
 
         } else if (comp > 0) {
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
 
         } else {
 
             // insert node_1->data in tree /////////////////////////////////////
-            if (node == NULL)  {
-                tree->root = (bs_node *) malloc(sizeof(bs_node));
-                node = tree->root;
-            } else {
-                node->right = (bs_node *) malloc(sizeof(bs_node));
-                node = node->right;
-            }
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-                return tree;
-            } else {
-                node->data  = node_1->data;
-                node->left  = NULL;
-                node->right = NULL;
-            }
+            data = node_1->data;
+            data = rb_tree_u64_insert_max(tree, node_1->key, data);
+            assert(data == NULL);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
         }
     }
 
-    // We need to traverse tree_1 completely to restore the modified pointers:
-    while (node_1 != NULL) {
-
-        // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
-            }
-        }
-        ////////////////////////////////////////////////////////////////////////
-    }
-
-    // We need to traverse tree_2 completely to restore the modified pointers:
-    while (node_2 != NULL) {
-
-        // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
-            }
-        }
-        ////////////////////////////////////////////////////////////////////////
-    }
-
     // Return the resulting tree:
     return tree;
 }
 
-// Returns a (really degenerated) binary tree containing a copy of the
-// difference: tree_1 - tree_2. It does NOT modify tree_1 or tree_2.
-//
-// The comparing function and all data pointers are taken from tree_1.
-//
-// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
+// Returns a rb_tree_u64 containing a copy of the difference: tree_1 - tree_2.
+// It does NOT modify tree_1 or tree_2.
 //
-//      bs_tree_rebalance(tree);
+// All data pointers are taken from tree_1.
 //
-// afterwards "for free", but I prefer to return the degenerate tree because
-// it will speed up a little bit future aplications of other "set functions".
-// Please, take a moment to decide if you want to post-process the tree with
-// a total rebalance operation.
+// It takes O( MAX{ |tree_1|+|tree_2|, |Diff|·Log(|Diff|) } ) time.
 //
-bs_tree *bs_tree_diff(const bs_tree *tree_1, const bs_tree *tree_2) {
+rb_tree_u64 *rb_tree_u64_diff(const rb_tree_u64 *tree_1,
+                              const rb_tree_u64 *tree_2) {
 
-    bs_tree *tree = NULL;
-    bs_node *node = NULL;
-    bs_node *pred_1;
-    bs_node *node_1;
-    bs_node *pred_2;
-    bs_node *node_2;
-    int      comp;
+    rb_tree_u64   *tree = NULL;
+    rb_walker_u64  walker_1;
+    rb_node_u64   *node_1;
+    rb_walker_u64  walker_2;
+    rb_node_u64   *node_2;
+    void          *data;
+    int            comp;
 
     // Sanity check:
     assert(tree_1 != NULL);
     assert(tree_2 != NULL);
 
     // Create a new tree:
-    tree = new_bs_tree(tree_1->comp);
+    tree = new_rb_tree_u64_as(tree_1);
     if (tree == NULL) { return NULL; }
 
     // Special case: Both trees are the same
     if (tree_1 == tree_2) { return tree; }
 
-    // Special case: Some of them is empty
-    if (bs_tree_is_empty(tree_1) == YES) { return tree; }
-
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
-    }
+    // Special case: tree_1 is empty
+    if (rb_tree_u64_is_empty(tree_1) == YES) { return tree; }
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
-        }
-    }
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_u64_first(&walker_1, tree_1->root);
 
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_u64_first(&walker_2, tree_2->root);
+    
     // Until we have exhausted at least one of the trees:
     while (node_1 != NULL && node_2 != NULL) {
 
         // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
+        comp = KEY_COMPARE(node_1->key, node_2->key);
 
         if (comp < 0) {
 
             // insert node_1->data in tree /////////////////////////////////////
-            if (node == NULL)  {
-                tree->root = (bs_node *) malloc(sizeof(bs_node));
-                node = tree->root;
-            } else {
-                node->right = (bs_node *) malloc(sizeof(bs_node));
-                node = node->right;
-            }
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-                return tree;
-            } else {
-                node->data  = node_1->data;
-                node->left  = NULL;
-                node->right = NULL;
-            }
+            data = node_1->data;
+            data = rb_tree_u64_insert_max(tree, node_1->key, data);
+            assert(data == NULL);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
             ////////////////////////////////////////////////////////////////////
 
         } else if (comp > 0) {
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
 
         } else {
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
         }
     }
@@ -1423,249 +11581,91 @@ bs_tree *bs_tree_diff(const bs_tree *tree_1, const bs_tree *tree_2) {
     while (node_1 != NULL) {
 
         // insert node_1->data in tree /////////////////////////////////////////
-        if (node == NULL)  {
-            tree->root = (bs_node *) malloc(sizeof(bs_node));
-            node = tree->root;
-        } else {
-            node->right = (bs_node *) malloc(sizeof(bs_node));
-            node = node->right;
-        }
-        if (node == NULL) {
-            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-            return tree;
-        } else {
-            node->data  = node_1->data;
-            node->left  = NULL;
-            node->right = NULL;
-        }
+        data = node_1->data;
+        data = rb_tree_u64_insert_max(tree, node_1->key, data);
+        assert(data == NULL);
         ////////////////////////////////////////////////////////////////////////
 
         // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
-            }
-        }
-        ////////////////////////////////////////////////////////////////////////
-    }
-
-    // We need to traverse tree_2 completely to restore the modified pointers:
-    while (node_2 != NULL) {
-
-        // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
-            }
-        }
+        node_1 = rb_walker_u64_next(&walker_1);
         ////////////////////////////////////////////////////////////////////////
     }
 
     // Return the resulting tree:
     return tree;
 }
-
-// Returns a (really degenerated) binary tree containing a copy of the symmetric
-// difference of tree_1 and tree_2. It does NOT modify tree_1 or tree_2.
-//
-// The comparing function is taken from tree_1.
-//
-// Since it takes O(|tree_1| + |tree_2|) to build the new tree you can perform:
-//
-//      bs_tree_rebalance(tree);
-//
-// afterwards "for free", but I prefer to return the degenerate tree because
-// it will speed up a little bit future aplications of other "set functions".
-// Please, take a moment to decide if you want to post-process the tree with
-// a total rebalance operation.
+
+// Returns a rb_tree_u64 containing a copy of the symmetric difference of tree_1
+// and tree_2. It does NOT modify tree_1 or tree_2.
 //
-bs_tree *bs_tree_sym_diff(const bs_tree *tree_1, const bs_tree *tree_2) {
+// It takes O( MAX{ |tree_1|+|tree_2|, |SymDiff|·Log(|SymDiff|) } ) time.
+//
+rb_tree_u64 *rb_tree_u64_sym_diff(const rb_tree_u64 *tree_1,
+                                  const rb_tree_u64 *tree_2) {
 
-    bs_tree *tree = NULL;
-    bs_node *node = NULL;
-    bs_node *pred_1;
-    bs_node *node_1;
-    bs_node *pred_2;
-    bs_node *node_2;
-    int      comp;
+    rb_tree_u64   *tree = NULL;
+    rb_walker_u64  walker_1;
+    rb_node_u64   *node_1;
+    rb_walker_u64  walker_2;
+    rb_node_u64   *node_2;
+    void          *data;
+    int            comp;
 
     // Sanity check:
     assert(tree_1 != NULL);
     assert(tree_2 != NULL);
 
     // Create a new tree:
-    tree = new_bs_tree(tree_1->comp);
+    tree = new_rb_tree_u64_as(tree_1);
     if (tree == NULL) { return NULL; }
 
     // Special case: Both trees are the same
     if (tree_1 == tree_2) { return tree; }
 
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
-    }
+    // Go to the smallest element of tree_1:
+    node_1 = rb_walker_u64_first(&walker_1, tree_1->root);
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
-        }
-    }
+    // Go to the smallest element of tree_2:
+    node_2 = rb_walker_u64_first(&walker_2, tree_2->root);
 
     // Until we have exhausted at least one of the trees:
     while (node_1 != NULL && node_2 != NULL) {
 
         // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
+        comp = KEY_COMPARE(node_1->key, node_2->key);
 
         if (comp < 0) {
 
             // insert node_1->data in tree /////////////////////////////////////
-            if (node == NULL)  {
-                tree->root = (bs_node *) malloc(sizeof(bs_node));
-                node = tree->root;
-            } else {
-                node->right = (bs_node *) malloc(sizeof(bs_node));
-                node = node->right;
-            }
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-                return tree;
-            } else {
-                node->data  = node_1->data;
-                node->left  = NULL;
-                node->right = NULL;
-            }
+            data = node_1->data;
+            data = rb_tree_u64_insert_max(tree, node_1->key, data);
+            assert(data == NULL);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
             ////////////////////////////////////////////////////////////////////
 
         } else if (comp > 0) {
 
             // insert node_2->data in tree /////////////////////////////////////
-            if (node == NULL)  {
-                tree->root = (bs_node *) malloc(sizeof(bs_node));
-                node = tree->root;
-            } else {
-                node->right = (bs_node *) malloc(sizeof(bs_node));
-                node = node->right;
-            }
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-                return tree;
-            } else {
-                node->data  = node_2->data;
-                node->left  = NULL;
-                node->right = NULL;
-            }
+            data = node_2->data;
+            data = rb_tree_u64_insert_max(tree, node_2->key, data);
+            assert(data == NULL);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
 
         } else {
 
             // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_1 = rb_walker_u64_next(&walker_1);
             ////////////////////////////////////////////////////////////////////
 
             // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
+            node_2 = rb_walker_u64_next(&walker_2);
             ////////////////////////////////////////////////////////////////////
         }
     }
@@ -1674,40 +11674,13 @@ bs_tree *bs_tree_sym_diff(const bs_tree *tree_1, const bs_tree *tree_2) {
     while (node_1 != NULL) {
 
         // insert node_1->data in tree /////////////////////////////////////////
-        if (node == NULL)  {
-            tree->root = (bs_node *) malloc(sizeof(bs_node));
-            node = tree->root;
-        } else {
-            node->right = (bs_node *) malloc(sizeof(bs_node));
-            node = node->right;
-        }
-        if (node == NULL) {
-            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-            return tree;
-        } else {
-            node->data  = node_1->data;
-            node->left  = NULL;
-            node->right = NULL;
-        }
+        data = node_1->data;
+        data = rb_tree_u64_insert_max(tree, node_1->key, data);
+        assert(data == NULL);
         ////////////////////////////////////////////////////////////////////////
 
         // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
-            }
-        }
+        node_1 = rb_walker_u64_next(&walker_1);
         ////////////////////////////////////////////////////////////////////////
     }
 
@@ -1715,3304 +11688,3838 @@ bs_tree *bs_tree_sym_diff(const bs_tree *tree_1, const bs_tree *tree_2) {
     while (node_2 != NULL) {
 
         // insert node_2->data in tree /////////////////////////////////////////
-        if (node == NULL)  {
-            tree->root = (bs_node *) malloc(sizeof(bs_node));
-            node = tree->root;
-        } else {
-            node->right = (bs_node *) malloc(sizeof(bs_node));
-            node = node->right;
+        data = node_2->data;
+        data = rb_tree_u64_insert_max(tree, node_2->key, data);
+        assert(data == NULL);
+        ////////////////////////////////////////////////////////////////////////
+
+        // advance node_2 //////////////////////////////////////////////////////
+        node_2 = rb_walker_u64_next(&walker_2);
+        ////////////////////////////////////////////////////////////////////////
+    }
+
+    // Return the resulting tree:
+    return tree;
+}
+
+
+
+// SIGNED KEYS:
+
+// The rb_tree_i64 functions just flip the sign bit of the keys on their way in
+// and out of the rb_tree_u64 functions: that maps INT64_MIN..INT64_MAX onto
+// 0..UINT64_MAX keeping the order, so the very same trees work for both.
+
+// Inserts data with the given (signed) key. Returns the data it replaces (or
+// NULL). See "rb_tree_u64_insert".
+//
+void *rb_tree_i64_insert(rb_tree_i64 *tree, int64_t key, void *data) {
+    return rb_tree_u64_insert(tree, I64_TO_U64(key), data);
+}
+
+// Inserts data with a (signed) key smaller or equal to any other key already
+// in the tree. See "rb_tree_u64_insert_min" (the sign bit flip keeps the
+// order, so the warning there also applies here).
+//
+void *rb_tree_i64_insert_min(rb_tree_i64 *tree, int64_t key, void *data) {
+    return rb_tree_u64_insert_min(tree, I64_TO_U64(key), data);
+}
+
+// Inserts data with a (signed) key bigger or equal to any other key already
+// in the tree. See "rb_tree_u64_insert_max" (the sign bit flip keeps the
+// order, so the warning there also applies here).
+//
+void *rb_tree_i64_insert_max(rb_tree_i64 *tree, int64_t key, void *data) {
+    return rb_tree_u64_insert_max(tree, I64_TO_U64(key), data);
+}
+
+// Finds the node with the given (signed) key. Returns its data or NULL if
+// not found. The key gets its sign bit flipped before the search.
+//
+void *rb_tree_i64_search(const rb_tree_i64 *tree, int64_t key) {
+    return rb_tree_u64_search(tree, I64_TO_U64(key));
+}
+
+// Returns a pointer to the data with the smallest (signed) key stored in the
+// tree (and stores that key, with its sign bit restored, in "min_key" unless
+// it is NULL). Returns NULL if the tree is empty.
+//
+void *rb_tree_i64_min(const rb_tree_i64 *tree, int64_t *min_key) {
+    uint64_t  key;
+    void     *data = rb_tree_u64_min(tree, &key);
+    if (data != NULL && min_key != NULL) { *min_key = U64_TO_I64(key); }
+    return data;
+}
+
+// Returns a pointer to the data with the biggest (signed) key stored in the
+// tree (and stores that key, with its sign bit restored, in "max_key" unless
+// it is NULL). Returns NULL if the tree is empty.
+//
+void *rb_tree_i64_max(const rb_tree_i64 *tree, int64_t *max_key) {
+    uint64_t  key;
+    void     *data = rb_tree_u64_max(tree, &key);
+    if (data != NULL && max_key != NULL) { *max_key = U64_TO_I64(key); }
+    return data;
+}
+
+// Returns the data of the biggest (signed) key smaller than key (and stores
+// that key, with its sign bit restored, in "prev_key" unless it is NULL).
+// Returns NULL if there is none. See "rb_tree_u64_prev".
+//
+void *rb_tree_i64_prev(const rb_tree_i64 *tree, int64_t key,
+                       int64_t *prev_key) {
+    uint64_t  prev;
+    void     *data = rb_tree_u64_prev(tree, I64_TO_U64(key), &prev);
+    if (data != NULL && prev_key != NULL) { *prev_key = U64_TO_I64(prev); }
+    return data;
+}
+
+// Returns the data of the smallest (signed) key bigger than key (and stores
+// that key, with its sign bit restored, in "next_key" unless it is NULL).
+// Returns NULL if there is none. See "rb_tree_u64_next".
+//
+void *rb_tree_i64_next(const rb_tree_i64 *tree, int64_t key,
+                       int64_t *next_key) {
+    uint64_t  next;
+    void     *data = rb_tree_u64_next(tree, I64_TO_U64(key), &next);
+    if (data != NULL && next_key != NULL) { *next_key = U64_TO_I64(next); }
+    return data;
+}
+
+// Removes the node with the given (signed) key and returns its data (or NULL
+// if not found). The key gets its sign bit flipped before the search.
+//
+void *rb_tree_i64_remove(rb_tree_i64 *tree, int64_t key) {
+    return rb_tree_u64_remove(tree, I64_TO_U64(key));
+}
+
+// Removes the node with the smallest (signed) key and returns its data (or
+// NULL if the tree is empty). Stores that key, with its sign bit restored, in
+// "min_key" unless it is NULL.
+//
+void *rb_tree_i64_remove_min(rb_tree_i64 *tree, int64_t *min_key) {
+    uint64_t  key;
+    void     *data = rb_tree_u64_remove_min(tree, &key);
+    if (data != NULL && min_key != NULL) { *min_key = U64_TO_I64(key); }
+    return data;
+}
+
+// Removes the node with the biggest (signed) key and returns its data (or
+// NULL if the tree is empty). Stores that key, with its sign bit restored, in
+// "max_key" unless it is NULL.
+//
+void *rb_tree_i64_remove_max(rb_tree_i64 *tree, int64_t *max_key) {
+    uint64_t  key;
+    void     *data = rb_tree_u64_remove_max(tree, &key);
+    if (data != NULL && max_key != NULL) { *max_key = U64_TO_I64(key); }
+    return data;
+}
+
+
+// DEBUG & VISUALIZATION:
+
+// This is an auxiliary function to check the symmetric order property
+// recursively. You should not use it directly, use "is_rb_tree_u64" instead.
+//
+// Note that, unlike other functions of this library, it is safe to use
+// recursive definitions here since they will only be used to test the
+// code while debugging this library.
+//
+static int is_rb_subtree_u64(const rb_node_u64 *node,
+                             const uint64_t *min, const uint64_t *max) {
+
+    int left_height  = 0;
+    int right_height = 0;
+
+    // Make sure that node is (strictly) between specified limits:
+    if ((min != NULL && *min >= node->key) ||
+        (max != NULL && node->key >= *max)) {
+        fprintf(stderr, "ERROR: Symmetric order broken in rb_tree_u64\n");
+        return -1;
+    }
+    if (node->data == NULL) {
+        fprintf(stderr, "ERROR: NULL data in rb_tree_u64\n");
+        return -1;
+    }
+
+    // Check for RED violations:
+    if (RB_COLOR(node) == RED) {
+        if (RB64_LEFT(node)  != NULL && RB_COLOR(RB64_LEFT(node))  == RED) {
+            fprintf(stderr, "ERROR: Two RED nodes in a row in rb_tree_u64\n");
+            return -1;
         }
-        if (node == NULL) {
-            fprintf(stderr, "ERROR: Unable to allocate bs_node\n");
-            return tree;
-        } else {
-            node->data  = node_2->data;
-            node->left  = NULL;
-            node->right = NULL;
+        if (node->right != NULL && RB_COLOR(node->right) == RED) {
+            fprintf(stderr, "ERROR: Two RED nodes in a row in rb_tree_u64\n");
+            return -1;
+        }
+    }
+
+    // Check recursively the left subtree of node:
+    if (RB64_LEFT(node) != NULL) {
+        left_height = is_rb_subtree_u64(RB64_LEFT(node), min, &node->key);
+        if (left_height == -1) { return -1; }
+    }
+
+    // Check recursively the right subtree of node:
+    if (node->right != NULL) {
+        right_height = is_rb_subtree_u64(node->right, &node->key, max);
+        if (right_height == -1) { return -1; }
+    }
+
+    // Check for BLACK violations:
+    if (left_height != right_height) {
+        fprintf(stderr, "ERROR: Different BLACK height in rb_tree_u64\n");
+        return -1;
+    }
+
+    // Return Black-Height of "node":
+    if (RB_COLOR(node) == RED){ return left_height; }
+    return left_height+1;
+}
+
+// This is an auxiliary function to check the symmetric order property, the
+// RED property and the BLACK property of a red-black tree.
+// Returns YES if everything is correct and NO otherwise.
+//
+// This function should not be used in production code. I recommend to use:
+//
+//      assert(is_rb_tree_u64(tree) == YES);
+//
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
+//
+int is_rb_tree_u64(const rb_tree_u64 *tree) {
+
+    // Basic Sanity Checks:
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to rb_tree_u64\n");
+        return NO;
+    }
+
+    // Trivial Case: empty tree
+    if (tree->root == NULL) { return YES; }
+
+    // General Case:
+    if (is_rb_subtree_u64(tree->root, NULL, NULL) == -1) { return NO;  }
+    else                                                 { return YES; }
+}
+
+// This is an auxiliary function to print the tree recursively.
+// You should not use it directly, use "print_rb_tree_u64" instead.
+//
+// Note that, unlike the rest of the functions of this library, it is safe
+// to use recursive definitions here since any tree large enough to hit the
+// recursion limit will be too big to be printed anyway.
+//
+static void print_rb_subtree_u64(const rb_node_u64 *node, const int is_right,
+                                 char *indent,
+                                 void (* print_node) (const void *)) {
+
+    // Allocate memory:
+    char *new_indent = (char *) malloc((6+strlen(indent)*sizeof(char)));
+    assert(new_indent != NULL);
+
+    // Print right subtree recursively:
+    if (node->right != NULL) {
+        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
+        else {
+            if (RB_COLOR(node) == RED) {
+                sprintf(new_indent, "%s%s", indent, "||    ");
+            } else {
+                sprintf(new_indent, "%s%s", indent, "|     ");
+            }
+        }
+        print_rb_subtree_u64(node->right, YES, new_indent, print_node);
+    }
+
+    // Print current node:
+    if (RB_COLOR(node) == RED) {
+        if (is_right) { fprintf(stdout, "%s/====",indent); }
+        else          { fprintf(stdout, "%s\\====",indent); }
+    } else {
+        if (is_right) { fprintf(stdout, "%s,----",indent); }
+        else          { fprintf(stdout, "%s`----",indent); }
+    }
+    if (print_node == NULL)  {
+        if (RB_COLOR(node) == RED) { fprintf(stdout, "(#)"); }
+        else                    { fprintf(stdout, "( )"); }
+    } else { print_node(node->data); }
+    fprintf(stdout, "\n");
+
+    // Print left subtree recursively:
+    if (RB64_LEFT(node) != NULL) {
+        if (is_right == YES) {
+            if (RB_COLOR(node) == RED) {
+                sprintf(new_indent, "%s%s", indent, "||    ");
+            } else {
+                sprintf(new_indent, "%s%s", indent, "|     ");
+            }
+        } else { sprintf(new_indent, "%s%s", indent, "      "); }
+        print_rb_subtree_u64(RB64_LEFT(node), NO, new_indent, print_node);
+    }
+
+    // Free memory:
+    free(new_indent);
+}
+
+// This function is used to print a rb_tree_u64 (or a rb_tree_i64) on the
+// screen exactly like "print_rb_tree" does (print_node receives the data).
+//
+// Finally, note that this is a visualization tool for debugging purposes only.
+//
+void print_rb_tree_u64(const rb_tree_u64 *tree,
+                       void (* print_node) (const void *)) {
+
+    // Avoid the trivial cases:
+    if (tree != NULL && tree->root != NULL) {
+
+        // Print right subtree recursively:
+        if (tree->root->right != NULL) {
+            print_rb_subtree_u64(tree->root->right, YES, "     ", print_node);
         }
-        ////////////////////////////////////////////////////////////////////////
 
-        // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
-            }
+        // Print current node:
+        if (RB_COLOR(tree->root) == RED) { fprintf(stdout, "===="); }
+        else                          { fprintf(stdout, "----"); }
+        if (print_node == NULL) {
+            if (RB_COLOR(tree->root) == RED) { fprintf(stdout, "(#)"); }
+            else                          { fprintf(stdout, "( )"); }
+        } else { print_node(tree->root->data); }
+        fprintf(stdout, "\n");
+
+        // Print left subtree recursively:
+        if (RB64_LEFT(tree->root) != NULL) {
+            print_rb_subtree_u64(RB64_LEFT(tree->root), NO, "     ",
+                                 print_node);
         }
-        ////////////////////////////////////////////////////////////////////////
     }
 
-    // Return the resulting tree:
-    return tree;
+    // Empty the "stdout" buffer:
+    fflush(stdout);
 }
 
+// END OF RED BLACK TREES WITH INTEGER KEYS ////////////////////////////////////
 
 
-// REBALANCE OPERATIONS:
-
-// Transforms any bs_tree in a highly degenerated bs_tree where tree->root
-// points to the smallest element and all nodes have no left sub-tree.
-//
-// In general it is a really BAD idea to work with highly degenerated trees but
-// I provide this tree_to_list method because it may be useful.
-//
-void bs_tree_to_list(bs_tree *tree) {
 
-    bs_node *node;
-    bs_node *left;
-    bs_node *right;
-    bs_node *parent;
 
-    // Sanity check:
-    assert(tree != NULL);
 
-    // Avoid trivial case: empty tree
-    if (tree->root != NULL) {
+// FROZEN TREES ////////////////////////////////////////////////////////////////
 
-        node = tree->root;
+// Every frozen_tree has the same shape as the trees built by the
+// "xx_tree_from_sorted_array" functions: the middle element of each range of
+// the sorted elements is the root of the subtree built from that range. So we
+// do not need to store the rank of each node (nor the size of its subtree):
+// it can be recomputed from the range while going down the tree.
 
-        // Unravel the left side of root:
-        while (node->left != NULL) {
+#define FROZEN_MID(first, last) ((first) + ((last) - (first)) / 2)
 
-            // Rotate right:
-            left        = node->left;
-            right       = left->right;
-            left->right = node;
-            node->left  = right;
+#define FROZEN_STACK 128    // More than enough for any tree that fits in RAM
 
-            // Move to the new root:
-            node = left;
-        }
 
-        // Fix the root:
-        tree->root = node;
-        parent     = NULL;
+// VAN EMDE BOAS LAYOUT:
 
-        // Unravel the rest of the tree:
-        while (node != NULL) {
+// The layout of a tree of height h stores its top h/2 levels first (with the
+// same layout) and then each one of the trees of height h - h/2 hanging from
+// them, from left to right (with the same layout). The layout of a tree of
+// height 1 is just its root.
+//
+// These functions are recursive but the recursion only goes O(log(h)) levels
+// deep (plus h/2 levels for the enumeration of the bottom trees), so it is
+// less than 128 levels for any tree that fits in RAM. They take O(n) time.
 
-            if (node->left != NULL) {
+static void frozen_layout(size_t first, size_t last, int height,
+                          size_t *position, size_t *next);
 
-                // Rotate right:
-                left          = node->left;
-                right         = left->right;
-                left->right   = node;
-                node->left    = right;
-                parent->right = left;
+// This is an auxiliary function that lays out (with the given height) all
+// the subtrees that are "depth" levels below the subtree built from the range
+// [first, last) from left to right. Use "frozen_layout" instead.
+//
+static void frozen_layout_bottom(size_t first, size_t last, int depth,
+                                 int height, size_t *position, size_t *next) {
 
-                // Move up:
-                node = left;
+    size_t mid;
 
-            } else {
+    // Trivial case: empty subtree
+    if (first >= last) { return; }
 
-                // Move down:
-                parent = node;
-                node   = node->right;
-            }
-        }
+    // Base case: this is one of the bottom subtrees
+    if (depth == 0) {
+        frozen_layout(first, last, height, position, next);
+        return;
     }
+
+    // General case: go down both halves
+    mid = FROZEN_MID(first, last);
+    frozen_layout_bottom(first, mid, depth - 1, height, position, next);
+    frozen_layout_bottom(mid + 1, last, depth - 1, height, position, next);
 }
 
-// Transforms any bs_tree in a highly degenerated bs_tree where tree->root
-// points to the biggest element and all nodes have no right sub-tree.
-//
-// In general it is a really BAD idea to work with highly degenerated trees but
-// I provide this tree_to_reversed_list method because it may be useful.
+// This is an auxiliary function that stores in position[i] the place of the
+// i-th smallest element in the van Emde Boas layout, for all the elements of
+// the first "height" levels of the subtree built from the range [first, last).
+// The first free place of the layout is *next (and it is updated).
 //
-void bs_tree_to_reversed_list(bs_tree *tree) {
+static void frozen_layout(size_t first, size_t last, int height,
+                          size_t *position, size_t *next) {
 
-    bs_node *node;
-    bs_node *left;
-    bs_node *right;
-    bs_node *parent;
+    size_t mid;
+    int    top;
 
-    // Sanity check:
-    assert(tree != NULL);
+    // Trivial case: empty subtree
+    if (first >= last || height == 0) { return; }
 
-    // Avoid trivial case: empty tree
-    if (tree->root != NULL) {
+    // Base case: just the root
+    if (height == 1) {
+        mid           = FROZEN_MID(first, last);
+        position[mid] = *next;
+        (*next)++;
+        return;
+    }
 
-        node = tree->root;
+    // General case: the top levels first and then the bottom subtrees
+    top = height / 2;
+    frozen_layout(first, last, top, position, next);
+    frozen_layout_bottom(first, last, top, height - top, position, next);
+}
 
-        // Unravel the right side of root:
-        while (node->right != NULL) {
+// Pending range of the frozen tree (used by "frozen_tree_link"):
+typedef struct frozen_range {
+    size_t first;   // First rank of the range
+    size_t last;    // One past the last rank of the range
+} frozen_range;
 
-            // Rotate left:
-            right       = node->right;
-            left        = right->left;
-            right->left = node;
-            node->right = left;
+// This is an auxiliary function that fills the "left" & "right" indices of
+// all the nodes of tree, given the position of each rank in the layout. It
+// takes O(n) time and no comparisons at all.
+//
+static void frozen_tree_link(frozen_tree *tree, const size_t *position) {
 
-            // Move to the new root:
-            node = right;
-        }
+    frozen_range  stack[FROZEN_STACK];
+    frozen_range  range;
+    frozen_node  *node;
+    size_t        size;
+    size_t        mid;
 
-        // Fix the root:
-        tree->root = node;
-        parent     = NULL;
+    // Trivial case: empty tree
+    if (tree->size == 0) { return; }
+
+    // Start with the whole tree:
+    stack[0].first = 0;
+    stack[0].last  = tree->size;
+    size = 1;
+
+    // Link every node to the roots of both halves of its range:
+    while (size > 0) {
+        size--;
+        range = stack[size];
+        mid   = FROZEN_MID(range.first, range.last);
+        node  = &(tree->nodes[position[mid]]);
+
+        assert(size + 2 <= FROZEN_STACK);
+        if (range.first < mid) {
+            node->left = position[FROZEN_MID(range.first, mid)];
+            stack[size].first = range.first;
+            stack[size].last  = mid;
+            size++;
+        } else { node->left = FROZEN_NULL; }
+        if (mid + 1 < range.last) {
+            node->right = position[FROZEN_MID(mid + 1, range.last)];
+            stack[size].first = mid + 1;
+            stack[size].last  = range.last;
+            size++;
+        } else { node->right = FROZEN_NULL; }
+    }
+}
 
-        // Unravel the rest of the tree:
-        while (node != NULL) {
+// This is an auxiliary function that allocates an (unlinked) frozen tree of
+// n nodes and computes the position of each rank in its layout. It returns
+// NULL if out of memory. Otherwise, the caller must store the data of the
+// i-th smallest element in tree->nodes[(*position)[i]], call
+// "frozen_tree_link" and free *position.
+//
+static frozen_tree *new_frozen_tree(int (* comp) (const void *, const void *),
+                                    size_t n, size_t **position) {
+
+    frozen_tree *tree;
+    size_t       next;
+    int          height;
+
+    // Allocate the tree and its nodes in a single block:
+    tree = (frozen_tree *) malloc(sizeof(frozen_tree) +
+                                  n * sizeof(frozen_node));
+    *position = (size_t *) malloc((n > 0 ? n : 1) * sizeof(size_t));
+    if (tree == NULL || *position == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for frozen_tree\n");
+        free(tree);
+        free(*position);
+        *position = NULL;
+        return NULL;
+    }
+    tree->nodes = (frozen_node *) (tree + 1);
+    tree->size  = n;
+    tree->comp  = comp;
 
-            if (node->right != NULL) {
+    // Height of the tree (the smallest h such that 2^h - 1 >= n):
+    height = 0;
+    while (height < 64 && ((size_t) 1 << height) <= n) { height++; }
 
-                // Rotate left:
-                right        = node->right;
-                left         = right->left;
-                right->left  = node;
-                node->right  = left;
-                parent->left = right;
+    // Compute the layout:
+    next = 0;
+    frozen_layout(0, n, height, *position, &next);
+    assert(next == n);
 
-                // Move up:
-                node = right;
+    return tree;
+}
 
-            } else {
 
-                // Move down:
-                parent = node;
-                node   = node->left;
-            }
-        }
-    }
-}
+// CREATION:
 
-// Since classic Binary Search Trees can become quite degenerated it is useful
-// to have a "rebalancing" method to redress them. The Day–Stout–Warren
-// algorithm does exactly this but it requires to count the number of nodes
-// stored on the tree and I want to avoid this.
-//
-// Fortunatelly, applying the Day–Stout–Warren algorithm blindly works quite
-// well and you get a "perfectly" balanced tree (in the sense of ensuring that
-// the resulting tree height will be equal to ceil(log2(N)), which is optimal)
-// in linear time without explicitly counting the number of nodes.
-//
-// As far as I know, this version of Day–Stout–Warren Algorithm is new.
-// This being said, I will be surprised if nobody has implemented this before.
-//
-// You can use this operation to rebalance a binary search tree once you are
-// sure that no further insertions will take place (or that they will be rare).
-// Alternatively, if you have a counter that stores the number of elements of
-// the tree, you can use this function every time the tree doubles in size to
-// get some of the benefits of a balanced tree in O(1) amortized time.
+// Returns a frozen snapshot of the bs_tree (or sp_tree) "tree", or NULL if out
+// of memory. It takes O(|tree|) time and no comparisons at all.
 //
-void bs_tree_rebalance(bs_tree *tree) {
+frozen_tree *bs_tree_freeze(const bs_tree *tree) {
 
-    bs_node *node;
-    bs_node *left;
-    bs_node *right;
-    bs_node *child;
-    bs_node *parent;
+    frozen_tree *frozen;
+    size_t      *position;
+    bs_walker    walker;
+    bs_node     *node;
+    size_t       n;
 
     // Sanity check:
     assert(tree != NULL);
 
-    // Avoid trivial case: empty tree
-    if (tree->root != NULL) {
+    // Count the elements of tree:
+    n    = 0;
+    node = bs_walker_first(&walker, tree->root);
+    while (node != NULL) {
+        n++;
+        node = bs_walker_next(&walker);
+    }
+    bs_walker_free(&walker);
+
+    // Create the frozen tree:
+    frozen = new_frozen_tree(tree->comp, n, &position);
+    if (frozen == NULL) { return NULL; }
+
+    // Store the elements of tree in their places:
+    n    = 0;
+    node = bs_walker_first(&walker, tree->root);
+    while (node != NULL && n < frozen->size) {
+        frozen->nodes[position[n]].data = node->data;
+        n++;
+        node = bs_walker_next(&walker);
+    }
+    bs_walker_free(&walker);
 
-        // LINEARIZE THE TREE: ///////////////////////////////////
-                                                                //
-        node = tree->root;                                      //
-                                                                //
-        // Unravel the left side of root:                       //
-        while (node->left != NULL) {                            //
-                                                                //
-            // Rotate right:                                    //
-            left        = node->left;                           //
-            right       = left->right;                          //
-            left->right = node;                                 //
-            node->left  = right;                                //
-                                                                //
-            // Move to the new root:                            //
-            node = left;                                        //
-        }                                                       //
-                                                                //
-        // Fix the root:                                        //
-        tree->root = node;                                      //
-        parent     = NULL;                                      //
-                                                                //
-        // Unravel the rest of the tree:                        //
-        while (node != NULL) {                                  //
-                                                                //
-            if (node->left != NULL) {                           //
-                                                                //
-                // Rotate right:                                //
-                left          = node->left;                     //
-                right         = left->right;                    //
-                left->right   = node;                           //
-                node->left    = right;                          //
-                parent->right = left;                           //
-                                                                //
-                // Move up:                                     //
-                node = left;                                    //
-                                                                //
-            } else {                                            //
-                                                                //
-                // Move down:                                   //
-                parent = node;                                  //
-                node   = node->right;                           //
-            }                                                   //
-        }                                                       //
-        //////////////////////////////////////////////////////////
+    // The walker can only stop early if it is out of memory:
+    if (n < frozen->size) {
+        free(position);
+        free(frozen);
+        return NULL;
+    }
 
+    // Link the nodes:
+    frozen_tree_link(frozen, position);
+    free(position);
 
-        // RE-BALANCE THE TREE ///////////////////////////////////
-                                                                //
-        for (;;) {                                              //
-                                                                //
-            parent = NULL;                                      //
-            node   = tree->root;                                //
-            child  = node->right;                               //
-                                                                //
-            if (child == NULL) { break; }                       //
-                                                                //
-            // Move along the right spine:                      //
-            while (child != NULL) {                             //
-                                                                //
-                // Rotate left:                                 //
-                if (parent == NULL) { tree->root    = child; }  //
-                else                { parent->right = child; }  //
-                node->right = child->left;                      //
-                child->left = node;                             //
-                                                                //
-                // Advance:                                     //
-                parent = child;                                 //
-                node   = parent->right;                         //
-                if (node == NULL) { break; }                    //
-                else { child = node->right; }                   //
-            }                                                   //
-        }                                                       //
-        //////////////////////////////////////////////////////////
+    return frozen;
+}
 
+// Returns a frozen snapshot of the rb_tree "tree", or NULL if out of memory.
+// It takes O(|tree|) time and no comparisons at all.
+//
+frozen_tree *rb_tree_freeze(const rb_tree *tree) {
 
-        // A FINAL IMPROVEMENT ///////////////////////////////////
-        //
-        // When you arrive here the root is the biggest element
-        // of the tree and has no right child.
-        //
-        // So, if we remove the root node and insert it as the
-        // right pointer of the second biggest element, the new
-        // root element will be way closer to be the "median"
-        // element (rather than being the biggest element) and
-        // everyone else will be 1 step closer to the root.
-        //
-        // If you do not understand what I mean, comment the
-        // following lines and use the print_bs_tree
-        // function to take a look.
-        //
-        node = tree->root;
-        if (node->left != NULL) {
-            tree->root = node->left;
-            child      = node->left;
-            while (child->right != NULL) { child = child->right; }
-            child->right = node;
-            node->left = NULL;
-        }
-        //////////////////////////////////////////////////////////
+    frozen_tree *frozen;
+    size_t      *position;
+    rb_walker    walker;
+    rb_node     *node;
+    size_t       n;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Count the elements of tree:
+    n    = 0;
+    node = rb_walker_first(&walker, tree->root);
+    while (node != NULL) {
+        n++;
+        node = rb_walker_next(&walker);
+    }
+
+    // Create the frozen tree:
+    frozen = new_frozen_tree(tree->comp, n, &position);
+    if (frozen == NULL) { return NULL; }
+
+    // Store the elements of tree in their places:
+    n    = 0;
+    node = rb_walker_first(&walker, tree->root);
+    while (node != NULL) {
+        frozen->nodes[position[n]].data = node->data;
+        n++;
+        node = rb_walker_next(&walker);
     }
+
+    // Link the nodes:
+    frozen_tree_link(frozen, position);
+    free(position);
+
+    return frozen;
 }
 
 
-// DEBUG & VISUALIZATION:
 
-// This is an auxiliary function to check the symmetric order property
-// recursively. You should not use it directly, use "is_bs_tree" instead.
+// SEARCH:
+
+// Returns the number of elements stored in the frozen tree in O(1) time.
 //
-// Note that, unlike other functions of this library, it is safe to use
-// recursive definitions here since they will only be used to test the
-// code while debugging this library.
+size_t frozen_tree_size(const frozen_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    return tree->size;
+}
+
+// Finds a node that compares "equal" to data. Returns NULL if not found.
 //
-static int is_bs_subtree(const bs_tree *tree, const bs_node *node,
-                         const void *min, const void *max) {
+void *frozen_tree_search(const frozen_tree *tree, const void *data) {
 
-    // Make sure that node is (strictly) between specified limits:
-    if (min != NULL && (tree->comp)(min, node->data) >= 0) {
-        fprintf(stderr,"ERROR: Symmetric order not satisfied in bs_tree\n");
-        return NO;
-    }
-    if (max != NULL && (tree->comp)(node->data, max) >= 0) {
-        fprintf(stderr,"ERROR: Symmetric order not satisfied in bs_tree\n");
-        return NO;
-    }
+    const frozen_node *node;
+    size_t             i;
+    int                comp;
 
-    // Check recursively the left subtree of node:
-    if (node->left != NULL) {
-        if (is_bs_subtree(tree, node->left, min, node->data) == NO) {
-            return NO;
-        }
-    }
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-    // Check recursively the right subtree of node:
-    if (node->right != NULL) {
-        if (is_bs_subtree(tree, node->right, node->data, max) == NO) {
-            return NO;
-        }
+    // Search (the root is the first node):
+    i = (tree->size == 0) ? FROZEN_NULL : 0;
+    while (i != FROZEN_NULL) {
+        node = &(tree->nodes[i]);
+        comp = (tree->comp)(data, node->data);      // compare data
+        if      (comp < 0) { i = node->left;  }     // data is smaller
+        else if (comp > 0) { i = node->right; }     // data is bigger
+        else               { return node->data; }   // found!
     }
 
-    // All test are fine:
-    return YES;
+    // Not found:
+    return NULL;
 }
 
-// This is an auxiliary function to check the symmetric order property of a
-// binary tree. Returns YES if everything is correct and NO otherwise.
+// Returns a pointer to the smallest element stored in the frozen tree.
+// Returns NULL if the tree is empty.
 //
-// This function should not be used in production code. I recommend to use:
+void *frozen_tree_min(const frozen_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    return frozen_tree_select(tree, 0);
+}
+
+// Returns a pointer to the biggest element stored in the frozen tree.
+// Returns NULL if the tree is empty.
 //
-//      assert(is_bs_tree(tree) == YES);
+void *frozen_tree_max(const frozen_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    if (tree->size == 0) { return NULL; }
+    return frozen_tree_select(tree, tree->size - 1);
+}
+
+// This is an auxiliary function that counts the elements of the frozen tree
+// that are smaller than data (or smaller or equal to data if "or_equal" is
+// YES). The rank of each node follows from the range of its subtree.
 //
-// To automatically remove all calls to this function when the flag NDEBUG
-// is defined in the header files (deactivating all assertions).
+static size_t frozen_tree_count_smaller(const frozen_tree *tree,
+                                        const void *data, int or_equal) {
+
+    const frozen_node *node;
+    size_t             first;
+    size_t             last;
+    size_t             mid;
+    size_t             i;
+    int                comp;
+
+    // Search for data narrowing the range of ranks:
+    first = 0;
+    last  = tree->size;
+    i     = 0;
+    while (first < last) {
+        node = &(tree->nodes[i]);
+        mid  = FROZEN_MID(first, last);
+        comp = (tree->comp)(data, node->data);
+        if (comp < 0) {
+            last  = mid;
+            i     = node->left;
+        } else if (comp > 0) {
+            first = mid + 1;
+            i     = node->right;
+        } else {
+            return (or_equal == YES) ? mid + 1 : mid;
+        }
+    }
+
+    return first;
+}
+
+// Find the in-order predecessor of data in the frozen tree.
 //
-int is_bs_tree(const bs_tree *tree) {
+// If data is not in tree returns the biggest element of tree smaller than data.
+// If data is smaller or equal to all elements of tree returns NULL.
+//
+void *frozen_tree_prev(const frozen_tree *tree, const void *data) {
 
-    // Basic Sanity Checks:
-    if (tree == NULL) {
-        fprintf(stderr, "ERROR: NULL pointer to bs_tree\n");
-        return NO;
-    }
-    if (tree->comp == NULL) {
-        fprintf(stderr, "ERROR: NULL comparing function in bs_tree\n");
-        return NO;
-    }
+    size_t rank;
 
-    // Trivial Case: empty tree
-    if (tree->root == NULL) { return YES; }
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-    // General Case:
-    return is_bs_subtree(tree, tree->root, NULL, NULL);
+    // The predecessor is the element just before the rank of data:
+    rank = frozen_tree_count_smaller(tree, data, NO);
+    if (rank == 0) { return NULL; }
+    return frozen_tree_select(tree, rank - 1);
 }
 
-// This is an auxiliary function to print the tree recursively.
-// You should not use it directly, use "print_bs_tree" instead.
+// Find the in-order successor of data in the frozen tree.
 //
-// Note that, unlike the rest of the functions of this library, it is safe
-// to use recursive definitions here since any tree large enough to hit the
-// recursion limit will be too big to be printed anyway.
+// If data is not in tree returns the smallest element of tree bigger than data.
+// If data is bigger or equal to all elements of tree returns NULL.
 //
-static void print_bs_subtree(const bs_node *node, const int is_right,
-                             char *indent, void (* print_node) (const void *)) {
+void *frozen_tree_next(const frozen_tree *tree, const void *data) {
 
-    // Allocate memory:
-    char *new_indent = (char *) malloc((6+strlen(indent)*sizeof(char)));
-    assert(new_indent != NULL);
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-    // Print right subtree recursively:
-    if (node->right != NULL) {
-        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
-        else                 { sprintf(new_indent, "%s%s", indent, "|     "); }
-        print_bs_subtree(node->right, YES, new_indent, print_node);
-    }
+    // The successor is the first element bigger than data:
+    return frozen_tree_select(tree, frozen_tree_count_smaller(tree, data, YES));
+}
 
-    // Print current node:
-    if (is_right) { fprintf(stdout, "%s,----",indent); }
-    else          { fprintf(stdout, "%s`----",indent); }
-    if (print_node == NULL)  { fprintf(stdout, "(#)"); }
-    else                     { print_node(node->data); }
-    printf("\n");
 
-    // Print left subtree recursively:
-    if (node->left != NULL) {
-        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "|     "); }
-        else                 { sprintf(new_indent, "%s%s", indent, "      "); }
-        print_bs_subtree(node->left, NO, new_indent, print_node);
-    }
 
-    // Free memory:
-    free(new_indent);
+// RANGES:
+
+// Returns the k-th smallest element stored in the frozen tree (starting from
+// k = 0) in O(log(|tree|)) time and without comparisons. Returns NULL if
+// k >= frozen_tree_size(tree).
+//
+void *frozen_tree_select(const frozen_tree *tree, size_t k) {
+
+    const frozen_node *node;
+    size_t             first;
+    size_t             last;
+    size_t             mid;
+    size_t             i;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Trivial case: out of range
+    if (k >= tree->size) { return NULL; }
+
+    // Go down narrowing the range of ranks until k is the middle one:
+    first = 0;
+    last  = tree->size;
+    i     = 0;
+    for (;;) {
+        node = &(tree->nodes[i]);
+        mid  = FROZEN_MID(first, last);
+        if (k < mid) {
+            last  = mid;
+            i     = node->left;
+        } else if (k > mid) {
+            first = mid + 1;
+            i     = node->right;
+        } else { return node->data; }    // found!
+    }
 }
 
-// This function is used to print a binary tree on the screen.
+// Returns the number of elements of the frozen tree that are strictly smaller
+// than data in O(log(|tree|)) time. If data is in the tree, this is its
+// position (so "frozen_tree_select(tree, frozen_tree_rank(tree, data))"
+// returns data).
 //
-//  * If a "print_node" function is provided it will be used to print the
-//    content of each node.
-//  * Otherwise (if print_node is NULL) all nodes will be printed as (#).
+size_t frozen_tree_rank(const frozen_tree *tree, const void *data) {
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Count:
+    return frozen_tree_count_smaller(tree, data, NO);
+}
+
+// Returns the number of elements of the frozen tree that are bigger or equal
+// to lo and smaller or equal to hi in O(log(|tree|)) time. Together with
+// "frozen_tree_rank" & "frozen_tree_select" it gives access to any range:
 //
-// Use this latter option if you only want to take a look at the tree shape.
+//      for (k = rank(lo); k < rank(lo) + count_range(lo, hi); k++) {
+//          do_something(select(k));
+//      }
 //
-// A correct print_node function only prints a single line of text using
-// the "fprintf" command. It should NOT include any "\n" in that line.
+size_t frozen_tree_count_range(const frozen_tree *tree, const void *lo,
+                               const void *hi) {
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(lo   != NULL);
+    assert(hi   != NULL);
+
+    // Trivial case: empty range
+    if ((tree->comp)(lo, hi) > 0) { return 0; }
+
+    // General case:
+    return frozen_tree_count_smaller(tree, hi, YES) -
+           frozen_tree_count_smaller(tree, lo, NO);
+}
+
+
+
+// DEBUG:
+
+// This is an auxiliary function to check that a frozen tree is well built:
+// its elements are sorted, every node is reachable from the root through the
+// expected path and every search finds its element.
+// Returns YES if everything is correct and NO otherwise.
 //
-// For example:
+// This function should not be used in production code. I recommend to use:
 //
-//  void MyPrintNodeFunction(const void *ptr) {
-//      MyDataStruct *d = (MyDataStruct *) ptr;     // Pointer casting
-//      fprintf(stdout, "(%d)", d->key);            // Printing integer key
-//  }
+//      assert(is_frozen_tree(tree) == YES);
 //
-// Finally, note that this is a visualization tool for debugging purposes only.
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
 //
-void print_bs_tree(const bs_tree *tree, void (* print_node) (const void *)) {
+int is_frozen_tree(const frozen_tree *tree) {
+
+    frozen_range  stack[FROZEN_STACK];
+    size_t        index[FROZEN_STACK];
+    frozen_range  range;
+    void         *prev = NULL;
+    void         *data;
+    size_t        count;
+    size_t        size;
+    size_t        mid;
+    size_t        i;
 
-    // Avoid the trivial cases:
-    if (tree != NULL && tree->root != NULL) {
+    // Basic Sanity Checks:
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to frozen_tree\n");
+        return NO;
+    }
+    if (tree->comp == NULL) {
+        fprintf(stderr, "ERROR: NULL comparing function in frozen_tree\n");
+        return NO;
+    }
+    if (tree->nodes != (frozen_node *) (tree + 1)) {
+        fprintf(stderr, "ERROR: Wrong nodes pointer in frozen_tree\n");
+        return NO;
+    }
 
-        // Print right subtree recursively:
-        if (tree->root->right != NULL) {
-            print_bs_subtree(tree->root->right, YES, "     ", print_node);
+    // Check the shape of the tree (every range of ranks must have its own
+    // node and the empty ones must have none):
+    count = 0;
+    size  = 0;
+    if (tree->size > 0) {
+        stack[0].first = 0;
+        stack[0].last  = tree->size;
+        index[0]       = 0;
+        size = 1;
+    }
+    while (size > 0) {
+        size--;
+        range = stack[size];
+        mid   = FROZEN_MID(range.first, range.last);
+        i     = index[size];
+        count++;
+        if (i >= tree->size || count > tree->size ||
+            (tree->nodes[i].left  == FROZEN_NULL) != (range.first == mid) ||
+            (tree->nodes[i].right == FROZEN_NULL) != (mid + 1 == range.last)) {
+            fprintf(stderr, "ERROR: Wrong subtree index in frozen_tree\n");
+            return NO;
         }
+        if (range.first < mid) {
+            stack[size].first = range.first;
+            stack[size].last  = mid;
+            index[size]       = tree->nodes[i].left;
+            size++;
+        }
+        if (mid + 1 < range.last) {
+            stack[size].first = mid + 1;
+            stack[size].last  = range.last;
+            index[size]       = tree->nodes[i].right;
+            size++;
+        }
+    }
 
-        // Print current node:
-        fprintf(stdout, "----");
-        if (print_node == NULL) { fprintf(stdout, "(#)"); }
-        else     { print_node(tree->root->data); }
-        fprintf(stdout, "\n");
-
-        // Print left subtree recursively:
-        if (tree->root->left != NULL) {
-            print_bs_subtree(tree->root->left, NO, "     ", print_node);
+    // Check that the elements are sorted and that every one can be found:
+    for (i = 0; i < tree->size; i++) {
+        data = frozen_tree_select(tree, i);
+        if (data == NULL) {
+            fprintf(stderr, "ERROR: NULL data in frozen_tree\n");
+            return NO;
+        }
+        if (prev != NULL && (tree->comp)(prev, data) >= 0) {
+            fprintf(stderr, "ERROR: Symmetric order broken in frozen_tree\n");
+            return NO;
+        }
+        if (frozen_tree_search(tree, data) != data ||
+            frozen_tree_rank(tree, data) != i) {
+            fprintf(stderr, "ERROR: Unreachable element in frozen_tree\n");
+            return NO;
         }
+        prev = data;
     }
 
-    // Empty the "stdout" buffer:
-    fflush(stdout);
+    // All test are fine:
+    return YES;
 }
 
-// END OF BINARY SEARCH TREES //////////////////////////////////////////////////
+// END OF FROZEN TREES /////////////////////////////////////////////////////////
 
 
 
 
 
-// RED BLACK TREES /////////////////////////////////////////////////////////////
+// EYTZINGER INDEXES ///////////////////////////////////////////////////////////
 
+// The keys[i] of an eytzinger_u64 is the root of the subtree whose nodes are
+// i, 2i, 2i+1, 4i, 4i+1, ... so a search that goes to the right (to 2i+1) on
+// every "keys[i] < key" visits indices whose binary digits are the path taken
+// from the root. When it falls off the tree, the last time it went to the left
+// (the last 0 bit) was at the first key bigger or equal to key.
 
-// CREATION & INSERTION:
+#define EYTZINGER_AHEAD 16  // Descendants 4 levels ahead (to prefetch)
+#define EYTZINGER_ALIGN 64  // Alignment of the keys (the usual cache line)
 
-// Returns a pointer to a newly created rb_tree.
-// You must provide a comparing function "comp" such that:
-//  * comp(A,B) = 0  if and only if  A = B
-//  * comp(A,B) > 0  if and only if  A > B
-//  * comp(A,B) < 0  if and only if  A < B
-//
-// I recommend to limit the output of the "comp" function to {-1, 0, 1} as in:
-//
-//  int MyComp(const void *ptr1, const void *ptr2) {
-//      MyData *d1 = (MyData *) ptr1;
-//      MyData *d2 = (MyData *) ptr2;
-//      if      (d1->key < d2->key) { return -1; }
-//      else if (d1->key > d2->key) { return +1; }
-//      else                        { return  0; }
-//  }
-//
-// However, the code does not assume that so, if you are working with simple
-// numeric keys, you can just use something like:
+// Returns the index of the first key bigger or equal to the searched one (or
+// 0 if there is none) from the index i where an Eytzinger search ended: it
+// drops the trailing 1 bits (the last moves to the right) and the last 0 bit.
 //
-//  int MyComp(const void *ptr1, const void *ptr2) {
-//      MyData *d1 = (MyData *) ptr1;
-//      MyData *d2 = (MyData *) ptr2;
-//      return (int) ((d1->key) - (d2->key));
-//  }
-//
-rb_tree *new_rb_tree(int (* comp) (const void *, const void *)) {
-
-    // Sanity check:
-    assert(comp != NULL);
+static inline size_t eytzinger_up(size_t i) {
+#if defined(__GNUC__)
+    return i >> (__builtin_ctzll((unsigned long long) ~i) + 1);
+#else
+    while (i & 1) { i >>= 1; }
+    return i >> 1;
+#endif
+}
 
-    // Allocate memory:
-    rb_tree *tree = (rb_tree *) malloc(sizeof(rb_tree));
-    if (tree == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate memory for rb_tree\n");
-    }
+// Returns the index that follows i in an in-order traversal of an Eytzinger
+// array with n keys (or 0 if i is the last one).
+//
+static size_t eytzinger_next(size_t i, size_t n) {
 
-    // Initialize the empty tree:
-    else {
-        tree->root = NULL;
-        tree->comp = comp;
+    // Go once to the right and then always to the left:
+    if (2 * i + 1 <= n) {
+        i = 2 * i + 1;
+        while (2 * i <= n) { i = 2 * i; }
+        return i;
     }
 
-    return tree;
+    // Or go up until we come from a left subtree:
+    while (i & 1) { i >>= 1; }
+    return i >> 1;
 }
 
-// Returns a new rb_tree containing a copy of the tree.
+// Returns the index of the first key of an Eytzinger array with n keys.
 //
-// It takes O( |Tree|·Log(|Tree|) } ) time.
+static size_t eytzinger_first(size_t n) {
+    size_t i = (n == 0) ? 0 : 1;
+    while (i != 0 && 2 * i <= n) { i = 2 * i; }
+    return i;
+}
+
+
+// CREATION:
+
+// Returns an Eytzinger index with the keys & data of "tree", or NULL if out
+// of memory. It takes O(|tree|) time.
 //
-rb_tree *rb_tree_copy(const rb_tree *tree) {
+eytzinger_u64 *rb_tree_u64_to_eytzinger(const rb_tree_u64 *tree) {
+
+    eytzinger_u64 *index;
+    rb_walker_u64  walker;
+    rb_node_u64   *node;
+    uintptr_t      keys;
+    size_t         n;
+    size_t         i;
 
-    rb_tree *new_tree = NULL;
-    rb_node *pred;
-    rb_node *node;
-    void    *data;
-    
     // Sanity check:
     assert(tree != NULL);
-    
-    // Create a new tree:
-    new_tree = new_rb_tree(tree->comp);
-    if (new_tree == NULL) { return NULL; }
 
-    // Go to the smallest element of tree while right-threading your path:
-    node = tree->root;
-    if (node != NULL) {
-        while (node->left != NULL) {
-            pred = node->left;
-            while (pred->right != NULL) { pred = pred->right; }
-            pred->right = node;
-            node        = node->left;
-        }
+    // Count the elements of tree:
+    n    = 0;
+    node = rb_walker_u64_first(&walker, tree->root);
+    while (node != NULL) {
+        n++;
+        node = rb_walker_u64_next(&walker);
     }
 
-    // Insert all data from tree into new_tree:
+    // Allocate the index, its (aligned) keys and its data in a single block:
+    index = (eytzinger_u64 *) malloc(sizeof(eytzinger_u64) +
+                                     (n + 1) * sizeof(void *) +
+                                     EYTZINGER_ALIGN +
+                                     (n + 1) * sizeof(uint64_t));
+    if (index == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for eytzinger_u64\n");
+        return NULL;
+    }
+    index->data   = (void **) (index + 1);
+    keys          = (uintptr_t) (index->data + n + 1);
+    keys          = (keys + EYTZINGER_ALIGN - 1) &
+                    ~((uintptr_t) EYTZINGER_ALIGN - 1);
+    index->keys   = (uint64_t *) keys;
+    index->size   = n;
+    index->levels = 0;
+    while (((size_t) 2 << index->levels) <= n) { index->levels++; }
+
+    // The in-order traversals of the tree and of the array go together:
+    index->keys[0] = 0;
+    index->data[0] = NULL;
+    i    = eytzinger_first(n);
+    node = rb_walker_u64_first(&walker, tree->root);
     while (node != NULL) {
+        index->keys[i] = node->key;
+        index->data[i] = node->data;
+        i    = eytzinger_next(i, n);
+        node = rb_walker_u64_next(&walker);
+    }
 
-        // insert node->data in new_tree ///////////////////////////////////////
-        data = node->data;
-        data = rb_tree_insert_max(new_tree, data);
-        assert(data == NULL);
-        ////////////////////////////////////////////////////////////////////////
+    return index;
+}
 
-        // advance node ////////////////////////////////////////////////////////
-        node = node->right;
-        if (node != NULL) {
-            while (node->left != NULL) {
-                pred = node->left;
-                while (pred->right != NULL && pred->right != node) {
-                    pred = pred->right;
-                }
-                if (pred->right == NULL) {
-                    pred->right = node;
-                    node        = node->left;
-                } else {
-                    pred->right = NULL;
-                    break;
-                }
-            }
+
+// SEARCH:
+
+// Finds the data stored with key. Returns NULL if not found.
+//
+void *eytzinger_u64_search(const eytzinger_u64 *index, uint64_t key) {
+
+    const uint64_t *keys;
+    size_t          n;
+    size_t          i;
+
+    // Sanity check:
+    assert(index != NULL);
+
+    // Go down (the only branch is the loop itself):
+    keys = index->keys;
+    n    = index->size;
+    i    = 1;
+    while (i <= n) {
+        if (EYTZINGER_AHEAD * i <= n) {
+            BATCH_PREFETCH(keys + EYTZINGER_AHEAD * i);
+            BATCH_PREFETCH(keys + EYTZINGER_AHEAD * i + EYTZINGER_AHEAD / 2);
         }
-        ////////////////////////////////////////////////////////////////////////
+        i = 2 * i + (keys[i] < key);
     }
-    
-    // Return the new_tree:
-    return new_tree;
+
+    // Go back up to the first key bigger or equal to key:
+    i = eytzinger_up(i);
+    if (i != 0 && keys[i] == key) { return index->data[i]; }
+    else                          { return NULL;           }
 }
 
-// Inserts data in tree.
-//
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
+// This is an auxiliary function that searches (at most BATCH_GROUP) keys at
+// the same time: all of them go down one level before any of them goes down
+// the next one, so their cache misses overlap. Every search goes through the
+// first "levels" levels (there is no need to check the end of the array) and
+// then through the last one if it is there.
 //
-void *rb_tree_insert(rb_tree *tree, void *data) {
+static void eytzinger_search_group(const eytzinger_u64 *index,
+                                   const uint64_t *keys, void **out,
+                                   size_t m) {
+
+    size_t i[BATCH_GROUP];
+    size_t n = index->size;
+    size_t j;
+    int    level;
+
+    // Start all the searches at the root:
+    for (j = 0; j < m; j++) { i[j] = 1; }
+
+    // Go down the full levels together:
+    for (level = 0; level < index->levels; level++) {
+        for (j = 0; j < m; j++) {
+            if (EYTZINGER_AHEAD * i[j] <= n) {
+                BATCH_PREFETCH(index->keys + EYTZINGER_AHEAD * i[j]);
+            }
+            i[j] = 2 * i[j] + (index->keys[i[j]] < keys[j]);
+        }
+    }
 
-    rb_node *anchor   = NULL;   // We need to store the last 4 levels:
-    rb_node *granpa   = NULL;   //
-    rb_node *parent   = NULL;   //            anchor
-    rb_node *node     = NULL;   //              |    <- comp_g
-    void    *old_data = NULL;   //            granpa
-    int      comp_g   = 0;      //              |    <- comp_p
-    int      comp_p   = 0;      //            parent
-    int      comp_n   = 0;      //              |    <- comp_n
-    int      comp     = 0;      //             node
+    // Finish the searches:
+    for (j = 0; j < m; j++) {
+        if (i[j] <= n) { i[j] = 2 * i[j] + (index->keys[i[j]] < keys[j]); }
+        i[j]   = eytzinger_up(i[j]);
+        out[j] = (i[j] != 0 && index->keys[i[j]] == keys[j]) ?
+                 index->data[i[j]] : NULL;
+    }
+}
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+// Searches the n keys of the array "keys" and stores the data of keys[i] in
+// out[i] (or NULL if not found). It returns the same as n calls to
+// "eytzinger_u64_search", but it keeps up to BATCH_GROUP searches in flight.
+//
+void eytzinger_u64_search_batch(const eytzinger_u64 *index,
+                                const uint64_t *keys, void **out, size_t n) {
 
-    // Search for the correct place to insert data:
-    node = tree->root;
-    for (;;) {
+    size_t first;
 
-        // If we reach a leaf we must insert "data" here:
-        if (node == NULL) {
+    // Sanity checks:
+    assert(index != NULL);
+    assert(keys != NULL || n == 0);
+    assert(out  != NULL || n == 0);
+
+    // Trivial case: empty index
+    if (index->size == 0) {
+        for (first = 0; first < n; first++) { out[first] = NULL; }
+        return;
+    }
 
-            // Create a new node:
-            node = (rb_node *) malloc(sizeof(rb_node));
-            if (node == NULL) {
-                fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
-                break;
-            } else {
-                node->data  = data;
-                node->left  = NULL;
-                node->right = NULL;
-                node->color = RED;
-                comp        = 0;
-            }
+    // General case: search the keys in groups
+    for (first = 0; first < n; first += BATCH_GROUP) {
+        eytzinger_search_group(index, keys + first, out + first,
+                               (n - first < BATCH_GROUP) ? n - first
+                                                         : BATCH_GROUP);
+    }
+}
 
-            // And attach it bellow "parent":
-            if (parent == NULL)  { tree->root    = node; }
-            else if (comp_n < 0) { parent->left  = node; }
-            else                 { parent->right = node; }
 
-        // Otherwise "node" is an interior node:
-        } else {
+// SIGNED KEYS:
 
-            // Compare "data" with "node->data":
-            comp = (tree->comp)(data, node->data);
+// The eytzinger_i64 functions just flip the sign bit of the keys (see the
+// rb_tree_i64 functions):
 
-            // If the data is already there: Update and remember "old_data"
-            if (comp == 0) {
-                old_data   = node->data;
-                node->data = data;
-            }
+void *eytzinger_i64_search(const eytzinger_i64 *index, int64_t key) {
+    return eytzinger_u64_search(index, I64_TO_U64(key));
+}
 
-            // If "node" has two RED children: Make a color flip
-            if (IS_RED(node->left) && IS_RED(node->right)) {
-                node->color        = RED;
-                node->left->color  = BLACK;
-                node->right->color = BLACK;
-            }
-        }
+void eytzinger_i64_search_batch(const eytzinger_i64 *index,
+                                const int64_t *keys, void **out, size_t n) {
 
-        // Repair any violation of the RED property:
-        if (IS_RED(node) && IS_RED(parent)) {
+    uint64_t group[BATCH_GROUP];
+    size_t   first;
+    size_t   m;
+    size_t   j;
 
-            // Case 1: Single "granpa-parent" left rotation
-            if (comp_p > 0 && comp_n > 0) {
+    // Sanity checks:
+    assert(index != NULL);
+    assert(keys != NULL || n == 0);
+    assert(out  != NULL || n == 0);
+
+    // Translate and search the keys in groups:
+    for (first = 0; first < n; first += m) {
+        m = (n - first < BATCH_GROUP) ? n - first : BATCH_GROUP;
+        for (j = 0; j < m; j++) { group[j] = I64_TO_U64(keys[first + j]); }
+        eytzinger_u64_search_batch(index, group, out + first, m);
+    }
+}
 
-                granpa->right = parent->left;
-                granpa->color = RED;
-                parent->left  = granpa;
-                parent->color = BLACK;
-                
-                if  (anchor == NULL) { tree->root    = parent; }
-                else if (comp_g < 0) { anchor->left  = parent; }
-                else if (comp_g > 0) { anchor->right = parent; }
-                granpa = anchor;
-                comp_p = comp_g;
 
-            // Case 2: Single "granpa-parent" right rotation
-            } else if (comp_p < 0 && comp_n < 0) {
+// DEBUG:
 
-                granpa->left  = parent->right;
-                granpa->color = RED;
-                parent->right = granpa;
-                parent->color = BLACK;
-                
-                if  (anchor == NULL) { tree->root    = parent; }
-                else if (comp_g < 0) { anchor->left  = parent; }
-                else if (comp_g > 0) { anchor->right = parent; }
-                granpa = anchor;
-                comp_p = comp_g;
+// This is an auxiliary function to check that the keys of an Eytzinger index
+// are sorted (in-order) and that all its data pointers are not NULL.
+// Returns YES if everything is correct and NO otherwise.
+//
+// This function should not be used in production code. I recommend to use:
+//
+//      assert(is_eytzinger_u64(index) == YES);
+//
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
+//
+int is_eytzinger_u64(const eytzinger_u64 *index) {
 
-            // Case 3: Double "granpa-parent-node" rotation
-            } else {
+    size_t count;
+    size_t prev;
+    size_t i;
 
-                // Case 3.1: Left-Right
-                if (comp_n < 0) {
-                    granpa->right = node->left;
-                    granpa->color = RED;
-                    parent->left  = node->right;
-                    node->left    = granpa;
-                    node->right   = parent;
-                    node->color   = BLACK;
-                    if (comp > 0) { granpa = parent; }
-                    parent = node;
-                    node   = granpa;
-                    if (comp > 0) { comp_n *= -1;      }
-                    if (comp < 0) { comp_n  = -comp_p; }
-                    
-                // Case 3.2: Right-Left
-                } else {
-                    granpa->left  = node->right;
-                    granpa->color = RED;
-                    parent->right = node->left;
-                    node->right   = granpa;
-                    node->left    = parent;
-                    node->color   = BLACK;
-                    if (comp < 0) { granpa = parent; }
-                    parent = node;
-                    node   = granpa;
-                    if (comp < 0) { comp_n *= -1;      }
-                    if (comp > 0) { comp_n  = -comp_p; }
-                }
+    // Basic Sanity Checks:
+    if (index == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to eytzinger_u64\n");
+        return NO;
+    }
+    if (((uintptr_t) index->keys) % EYTZINGER_ALIGN != 0) {
+        fprintf(stderr, "ERROR: Misaligned keys in eytzinger_u64\n");
+        return NO;
+    }
+    if (index->levels < 0 || (index->size > 0 &&
+        (((size_t) 1 << index->levels) > index->size ||
+         ((size_t) 2 << index->levels) <= index->size))) {
+        fprintf(stderr, "ERROR: Wrong number of levels in eytzinger_u64\n");
+        return NO;
+    }
 
-                if  (anchor == NULL) { tree->root    = parent; }
-                else if (comp_g < 0) { anchor->left  = parent; }
-                else if (comp_g > 0) { anchor->right = parent; }
-                granpa = anchor;
-                comp_p = comp_g;
-                comp  *= -1;
-            }
+    // Traverse the keys in-order:
+    count = 0;
+    prev  = 0;
+    for (i = eytzinger_first(index->size); i != 0;
+         i = eytzinger_next(i, index->size)) {
+        if (prev != 0 && index->keys[prev] >= index->keys[i]) {
+            fprintf(stderr, "ERROR: Symmetric order broken in eytzinger_u64\n");
+            return NO;
         }
-
-        // Advance one step:
-        anchor = granpa;
-        granpa = parent;
-        parent = node;
-        if      (comp < 0) { node = node->left;  }  // Data is smaller
-        else if (comp > 0) { node = node->right; }  // Data is bigger
-        else               { break;              }  // We are done!
-
-        // And remember were you come from:
-        comp_g = comp_p;
-        comp_p = comp_n;
-        comp_n = comp;
+        if (index->data[i] == NULL) {
+            fprintf(stderr, "ERROR: NULL data in eytzinger_u64\n");
+            return NO;
+        }
+        prev = i;
+        count++;
+    }
+    if (count != index->size) {
+        fprintf(stderr, "ERROR: Wrong size of eytzinger_u64\n");
+        return NO;
     }
 
-    // Before leaving: Make sure that the root is BLACK!
-    if (tree->root != NULL) { tree->root->color = BLACK; }
-
-    // And return old_data (which will be NULL unless data was already here)
-    return old_data;
+    // All test are fine:
+    return YES;
 }
 
-// Inserts "data" such that "data" is smaller or equal to any other "data"
-// already in the tree. It is slightly faster than a regular insert because it
-// makes at most one comparison.
-//
-// WARNING: If you use this function to insert data that is strictly bigger than
-//          something already in the tree you will break the tree!
-//
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
-//
-void *rb_tree_insert_min(rb_tree *tree, void *data) {
+// END OF EYTZINGER INDEXES ////////////////////////////////////////////////////
 
-    rb_node *anchor   = NULL;
-    rb_node *granpa   = NULL;
-    rb_node *parent   = NULL;
-    rb_node *node     = NULL;
-    void    *old_data = NULL;
-    int      inserted = NO;
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
 
-    // Search for the correct place to insert data:
-    node = tree->root;
-    for (;;) {
 
-        // If we reach a leaf we must insert "data" here:
-        if (node == NULL) {
 
-            // Perhaps "parent" already contains "data":
-            if (parent != NULL && (tree->comp)(data, parent->data) == 0) {
-                old_data   = node->data;
-                node->data = data;
-                break;
+// B-TREES /////////////////////////////////////////////////////////////////////
 
-            // Otherwise: Create a new node 
-            } else {            
-                node = (rb_node *) malloc(sizeof(rb_node));
-                if (node == NULL) {
-                    fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
-                    break;
-                } else {
-                    node->data  = data;
-                    node->left  = NULL;
-                    node->right = NULL;
-                    node->color = RED;
-                    inserted    = YES;
-                }
-                if (parent == NULL)  { tree->root   = node; }
-                else                 { parent->left = node; }
-            }            
-            
-        // Otherwise: "node" may require a color flip
-        } else if (IS_RED(node->left) && IS_RED(node->right)) {
-            node->color        = RED;
-            node->left->color  = BLACK;
-            node->right->color = BLACK;
-        }
+// All the operations are top-down and single-pass: insertions split every
+// full node they find on their way down (so there is always room for the new
+// element below) and removals make sure that every node they enter has more
+// than the minimum number of elements (so there is always one to spare).
+// Neither parent pointers nor recursion are needed.
 
-        // Repair any violation of the RED property: Single right rotation
-        if (IS_RED(node) && IS_RED(parent)) {            
-            granpa->left  = parent->right;
-            granpa->color = RED;
-            parent->right = granpa;
-            parent->color = BLACK;            
-            if  (anchor == NULL) { tree->root   = parent; }
-            else                 { anchor->left = parent; }
-            granpa = anchor;
-        }
+#define BP_MAX      (BP_ORDER - 1)      // Maximum number of elements of a node
+#define BP_MIN      (BP_ORDER / 2 - 1)  // Minimum number (except for the root)
+#define BP_ALIGN    64                  // Alignment of the nodes (cache line)
+#define BP_HEIGHT   64                  // More than enough for any tree in RAM
+#define BP_STACK    (BP_ORDER * BP_HEIGHT)  // Pending nodes of a traversal
+
+// Targets of "bp_tree_remove_from":
+#define BP_FIND_DATA 0
+#define BP_FIND_MIN  1
+#define BP_FIND_MAX  2
 
-        // Advance one step or exit:
-        if (inserted == YES) { break; }
-        anchor = granpa;
-        granpa = parent;
-        parent = node;
-        node   = node->left;        
-    }
 
-    // Before leaving: Make sure that the root is BLACK!
-    if (tree->root != NULL) { tree->root->color = BLACK; }
+// NODE ALLOCATION:
 
-    // And return old_data (which will be NULL unless data was already here)
-    return old_data;
+// Returns a new empty bp_node (with room for its subtrees unless it is a leaf)
+// or NULL if out of memory. Nodes are aligned to BP_ALIGN bytes whenever the
+// compiler provides aligned_alloc (C11), so each node starts a cache line.
+//
+static bp_node *new_bp_node(bp_tree *tree, int leaf) {
+
+    bp_node *node;
+    size_t   size = sizeof(bp_node);
+
+    // Leaves do not need the array of subtrees:
+    if (leaf == NO) { size += BP_ORDER * sizeof(bp_node *); }
+
+    STATS_ADD(tree, allocations, 1);
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+    size = (size + BP_ALIGN - 1) & ~((size_t) BP_ALIGN - 1);
+    node = (bp_node *) aligned_alloc(BP_ALIGN, size);
+#else
+    node = (bp_node *) malloc(size);
+#endif
+    if (node == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate bp_node\n");
+    } else {
+        node->size = 0;
+        node->leaf = leaf;
+    }
+    return node;
 }
 
-// Inserts "data" such that "data" is bigger or equal to any other "data"
-// already in the tree. It is slightly faster than a regular insert because it
-// makes at most one comparison.
+// Releases a bp_node previously obtained with "new_bp_node".
 //
-// WARNING: If you use this function to insert data that is strictly smaller
-//          than something already in the tree you will break the tree!
+static inline void free_bp_node(bp_tree *tree, bp_node *node) {
+    STATS_ADD(tree, releases, 1);
+    free(node);
+}
+
+
+
+// NODE OPERATIONS:
+
+// Returns the position of the first element of node that is bigger or equal
+// to data (or node->size if there is none) and sets *found to YES if that
+// element compares "equal" to data (and to NO otherwise).
 //
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
+// Nodes are small, but a binary search still saves about half of the calls to
+// the comparing function of a linear one.
 //
-void *rb_tree_insert_max(rb_tree *tree, void *data) {
+static inline int bp_node_find(const bp_tree *tree, const bp_node *node,
+                               const void *data, int *found) {
+
+    int first = 0;
+    int last  = node->size;
+    int mid;
+    int comp;
+
+    *found = NO;
+    while (first < last) {
+        mid  = (first + last) / 2;
+        comp = COMPARE(tree, data, node->data[mid]);
+        if      (comp < 0) { last  = mid;     }
+        else if (comp > 0) { first = mid + 1; }
+        else               { *found = YES; return mid; }
+    }
+    return first;
+}
 
-    rb_node *anchor   = NULL;
-    rb_node *granpa   = NULL;
-    rb_node *parent   = NULL;
-    rb_node *node     = NULL;
-    void    *old_data = NULL;
-    int      inserted = NO;
+// Splits the full parent->child[i] in two halves (of BP_MIN elements each)
+// and moves its middle element up to parent->data[i]. The parent must not be
+// full. Returns NO (and changes nothing) if out of memory.
+//
+static int bp_split_child(bp_tree *tree, bp_node *parent, int i) {
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+    bp_node *left = parent->child[i];
+    bp_node *right;
 
-    // Search for the correct place to insert data:
-    node = tree->root;
-    for (;;) {
+    // Sanity checks:
+    assert(parent->size < BP_MAX);
+    assert(left->size == BP_MAX);
+
+    // The right half goes to a new node:
+    right = new_bp_node(tree, left->leaf);
+    if (right == NULL) { return NO; }
+    memcpy(right->data, left->data + BP_MIN + 1, BP_MIN * sizeof(void *));
+    if (left->leaf == NO) {
+        memcpy(right->child, left->child + BP_MIN + 1,
+               (BP_MIN + 1) * sizeof(bp_node *));
+    }
+    right->size = BP_MIN;
+    left->size  = BP_MIN;
+
+    // The middle element goes up:
+    memmove(parent->data + i + 1, parent->data + i,
+            (parent->size - i) * sizeof(void *));
+    memmove(parent->child + i + 2, parent->child + i + 1,
+            (parent->size - i) * sizeof(bp_node *));
+    parent->data[i]      = left->data[BP_MIN];
+    parent->child[i + 1] = right;
+    parent->size++;
 
-        // If we reach a leaf we must insert "data" here:
-        if (node == NULL) {
+    return YES;
+}
 
-            // Perhaps "parent" already contains "data":
-            if (parent != NULL && (tree->comp)(data, parent->data) == 0) {
-                old_data   = node->data;
-                node->data = data;
-                break;
+// Splits the root of tree if it is full (so the tree grows one level).
+// Returns NO (and changes nothing) if out of memory.
+//
+static int bp_split_root(bp_tree *tree) {
 
-            // Otherwise: Create a new node 
-            } else {            
-                node = (rb_node *) malloc(sizeof(rb_node));
-                if (node == NULL) {
-                    fprintf(stderr, "ERROR: Unable to allocate rb_node\n");
-                    break;
-                } else {
-                    node->data  = data;
-                    node->left  = NULL;
-                    node->right = NULL;
-                    node->color = RED;
-                    inserted    = YES;
-                }
-                if (parent == NULL)  { tree->root    = node; }
-                else                 { parent->right = node; }
-            }            
-            
-        // Otherwise: "node" may require a color flip
-        } else if (IS_RED(node->left) && IS_RED(node->right)) {
-            node->color        = RED;
-            node->left->color  = BLACK;
-            node->right->color = BLACK;
-        }
+    bp_node *root;
 
-        // Repair any violation of the RED property: Single left rotation
-        if (IS_RED(node) && IS_RED(parent)) {
-            granpa->right = parent->left;
-            granpa->color = RED;
-            parent->left  = granpa;
-            parent->color = BLACK;
-            if  (anchor == NULL) { tree->root    = parent; }
-            else                 { anchor->right = parent; }
-            granpa = anchor;
-        }
+    // Nothing to do:
+    if (tree->root == NULL || tree->root->size < BP_MAX) { return YES; }
 
-        // Advance one step or exit:
-        if (inserted == YES) { break; }
-        anchor = granpa;
-        granpa = parent;
-        parent = node;
-        node   = node->right;        
+    // The old root becomes the only subtree of the new one:
+    root = new_bp_node(tree, NO);
+    if (root == NULL) { return NO; }
+    root->child[0] = tree->root;
+    if (bp_split_child(tree, root, 0) == NO) {
+        free_bp_node(tree, root);
+        return NO;
     }
+    tree->root = root;
 
-    // Before leaving: Make sure that the root is BLACK!
-    if (tree->root != NULL) { tree->root->color = BLACK; }
-
-    // And return old_data (which will be NULL unless data was already here)
-    return old_data;
+    return YES;
 }
 
+// Merges parent->child[i], parent->data[i] and parent->child[i+1] into
+// parent->child[i]. Both subtrees must have exactly BP_MIN elements.
+//
+static void bp_merge_children(bp_tree *tree, bp_node *parent, int i) {
 
+    bp_node *left  = parent->child[i];
+    bp_node *right = parent->child[i + 1];
 
-// SEARCH:
+    // Sanity checks:
+    assert(left->size  == BP_MIN);
+    assert(right->size == BP_MIN);
+
+    // Move everything to the left node:
+    left->data[left->size] = parent->data[i];
+    memcpy(left->data + left->size + 1, right->data,
+           right->size * sizeof(void *));
+    if (left->leaf == NO) {
+        memcpy(left->child + left->size + 1, right->child,
+               (right->size + 1) * sizeof(bp_node *));
+    }
+    left->size += right->size + 1;
 
-// Returns YES if the tree is empty and NO otherwise.
+    // And close the gap in the parent:
+    memmove(parent->data + i, parent->data + i + 1,
+            (parent->size - i - 1) * sizeof(void *));
+    memmove(parent->child + i + 1, parent->child + i + 2,
+            (parent->size - i - 1) * sizeof(bp_node *));
+    parent->size--;
+
+    free_bp_node(tree, right);
+}
+
+// Makes sure that parent->child[i] has more than BP_MIN elements, so one of
+// them can be removed from its subtree: it takes one element from a sibling
+// through the parent (a "rotation") or, if both siblings are at the minimum,
+// merges it with one of them. Returns the new position of the subtree (it
+// only changes when it is merged with its left sibling).
 //
-int rb_tree_is_empty(const rb_tree *tree) {
+static int bp_fix_child(bp_tree *tree, bp_node *parent, int i) {
+
+    bp_node *node = parent->child[i];
+    bp_node *sibling;
+
+    // Nothing to do:
+    if (node->size > BP_MIN) { return i; }
+
+    // Rotate an element from the left sibling:
+    if (i > 0 && parent->child[i - 1]->size > BP_MIN) {
+        sibling = parent->child[i - 1];
+        memmove(node->data + 1, node->data, node->size * sizeof(void *));
+        node->data[0]        = parent->data[i - 1];
+        parent->data[i - 1]  = sibling->data[sibling->size - 1];
+        if (node->leaf == NO) {
+            memmove(node->child + 1, node->child,
+                    (node->size + 1) * sizeof(bp_node *));
+            node->child[0] = sibling->child[sibling->size];
+        }
+        node->size++;
+        sibling->size--;
+        STATS_ADD(tree, rotations, 1);
+        return i;
+    }
 
-    // Sanity check:
-    assert(tree != NULL);
+    // Rotate an element from the right sibling:
+    if (i < parent->size && parent->child[i + 1]->size > BP_MIN) {
+        sibling = parent->child[i + 1];
+        node->data[node->size] = parent->data[i];
+        parent->data[i]        = sibling->data[0];
+        if (node->leaf == NO) {
+            node->child[node->size + 1] = sibling->child[0];
+            memmove(sibling->child, sibling->child + 1,
+                    sibling->size * sizeof(bp_node *));
+        }
+        memmove(sibling->data, sibling->data + 1,
+                (sibling->size - 1) * sizeof(void *));
+        node->size++;
+        sibling->size--;
+        STATS_ADD(tree, rotations, 1);
+        return i;
+    }
 
-    // Check if there is at least 1 node in the tree:
-    if (tree->root == NULL) { return YES; }
-    else                    { return NO;  }
+    // Merge it with a sibling (the left one if there is one):
+    if (i > 0) { i--; }
+    bp_merge_children(tree, parent, i);
+    return i;
 }
 
-// Finds a node that compares "equal" to data. Returns NULL if not found.
+
+
+// BULK LOADING & TRAVERSALS:
+
+// Pending range of the sorted array (used by "bp_tree_build"):
+typedef struct bp_range {
+    size_t    first;    // First index of the range
+    size_t    last;     // One past the last index of the range
+    int       height;   // Height of the subtree built from the range
+    bp_node **link;     // Where to hang the subtree built from the range
+} bp_range;
+
+// Fills the empty tree with the n elements of the array "data", which must
+// be sorted in increasing order without duplicates. Returns NO if out of
+// memory (and leaves the tree empty).
 //
-void *rb_tree_search(const rb_tree *tree, const void *data) {
+// The tree gets the minimum height and the elements are spread as evenly as
+// possible among the nodes of each level. It takes O(n) time and makes no
+// comparisons at all.
+//
+static int bp_tree_build(bp_tree *tree, void **data, size_t n) {
 
-    rb_node *node;
-    int      comp;
+    size_t    capacity[BP_HEIGHT];  // Max. elements of a subtree of height h
+    bp_range  stack[BP_STACK];
+    bp_range  range;
+    bp_node  *node;
+    size_t    size;
+    size_t    count, rest, first;
+    int       height;
+    int       c, k;
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+    // Sanity checks:
+    assert(tree->root == NULL);
+    assert(data != NULL || n == 0);
+
+    // Trivial case: nothing to do
+    if (n == 0) { return YES; }
+
+    // Find the height of the tree:
+    height      = 0;
+    capacity[0] = BP_MAX;
+    while (capacity[height] < n) {
+        capacity[height + 1] = capacity[height] * BP_ORDER + BP_MAX;
+        height++;
+    }
 
-    // Search:
-    node = tree->root;
-    while (node != NULL) {
-        comp = (tree->comp)(data, node->data);      // compare data
-        if      (comp < 0) { node = node->left;  }  // data is smaller
-        else if (comp > 0) { node = node->right; }  // data is bigger
-        else               { return node->data;  }  // found!
+    // Start with the whole array:
+    stack[0].first  = 0;
+    stack[0].last   = n;
+    stack[0].height = height;
+    stack[0].link   = &(tree->root);
+    size = 1;
+
+    // Build the tree top-down:
+    while (size > 0) {
+
+        // Take the next pending range:
+        size--;
+        range = stack[size];
+        count = range.last - range.first;
+
+        // Create its node (with NULL subtrees until they are built, so an
+        // unfinished tree can still be released by "bp_tree_remove_all"):
+        node = new_bp_node(tree, (range.height == 0) ? YES : NO);
+        *(range.link) = node;
+        if (node == NULL) {
+            bp_tree_remove_all(tree, NULL);
+            return NO;
+        }
+
+        // A leaf takes the whole range:
+        if (range.height == 0) {
+            assert(count <= BP_MAX);
+            memcpy(node->data, data + range.first, count * sizeof(void *));
+            node->size = (int) count;
+            continue;
+        }
+
+        // An internal node takes as few subtrees as possible (but at least 2)
+        // and spreads the rest of the elements evenly among them:
+        c = (int) ((count + 1 + capacity[range.height - 1]) /
+                   (capacity[range.height - 1] + 1));
+        if (c < 2) { c = 2; }
+        assert(c <= BP_ORDER);
+        rest  = count - (c - 1);
+        first = range.first;
+        for (k = 0; k < c; k++) { node->child[k] = NULL; }
+        for (k = 0; k < c; k++) {
+            count = rest / c + (((size_t) k < rest % c) ? 1 : 0);
+            assert(size < BP_STACK);
+            stack[size].first  = first;
+            stack[size].last   = first + count;
+            stack[size].height = range.height - 1;
+            stack[size].link   = &(node->child[k]);
+            size++;
+            first += count;
+            if (k < c - 1) {
+                assert(data[first] != NULL);
+                node->data[k] = data[first];
+                first++;
+            }
+        }
+        node->size = c - 1;
     }
+    tree->size = n;
 
-    // Not found:
-    return NULL;
+    return YES;
 }
 
-// Returns a pointer to the smallest element stored in the tree.
-// Returns NULL if the tree is empty.
-//
-void *rb_tree_min(const rb_tree *tree) {
+// The copy & set functions traverse their (const) input trees in-order using
+// an explicit stack with the path from the root to the current element. All
+// the leaves of a bp_tree are at the same depth, so BP_HEIGHT slots are always
+// more than enough.
 
-    rb_node *node;
+typedef struct bp_walker {
+    bp_node *node[BP_HEIGHT];   // Path from the root to the current node
+    int      index[BP_HEIGHT];  // Position of the current element in each one
+    int      size;              // Length of the path (0 if finished)
+} bp_walker;
 
-    // Sanity check:
-    assert(tree != NULL);
+// This is an auxiliary function that pushes node and all its leftmost
+// descendants in the path of walker. Returns the smallest element of the
+// subtree.
+//
+static void *bp_walker_descend(bp_walker *walker, bp_node *node) {
+    for (;;) {
+        assert(walker->size < BP_HEIGHT);
+        walker->node[walker->size]  = node;
+        walker->index[walker->size] = 0;
+        walker->size++;
+        if (node->leaf == YES) { return node->data[0]; }
+        node = node->child[0];
+    }
+}
 
-    // Trivial case: empty tree
+// Starts an in-order traversal of tree and returns its smallest element (or
+// NULL if tree is empty).
+//
+static void *bp_walker_first(bp_walker *walker, const bp_tree *tree) {
+    walker->size = 0;
     if (tree->root == NULL) { return NULL; }
-
-    // General case: Find the smallest node
-    node = tree->root;
-    while (node->left != NULL) { node = node->left; }
-
-    // Return a pointer to the data:
-    return node->data;
+    return bp_walker_descend(walker, tree->root);
 }
 
-// Returns a pointer to the biggest element stored in "tree".
-// Returns NULL if the tree is empty.
+// Moves walker to the next element and returns it (or NULL if the traversal
+// is finished).
 //
-void *rb_tree_max(const rb_tree *tree) {
+static void *bp_walker_next(bp_walker *walker) {
 
-    rb_node *node;
+    bp_node *node;
+    int      top;
 
-    // Sanity check:
-    assert(tree != NULL);
+    // Trivial case: the traversal is finished
+    if (walker->size == 0) { return NULL; }
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
+    // Skip the current element:
+    top  = walker->size - 1;
+    node = walker->node[top];
+    walker->index[top]++;
 
-    // General case: Find the biggest node
-    node = tree->root;
-    while (node->right != NULL) { node = node->right; }
+    // The next one is the smallest element of the following subtree:
+    if (node->leaf == NO) {
+        return bp_walker_descend(walker, node->child[walker->index[top]]);
+    }
 
-    // Return a pointer to the data:
-    return node->data;
+    // Or the first pending element of an ancestor:
+    while (walker->index[top] == walker->node[top]->size) {
+        walker->size--;
+        if (walker->size == 0) { return NULL; }
+        top--;
+    }
+    return walker->node[top]->data[walker->index[top]];
 }
 
-// Find the in-order predesor of data in the tree.
-//
-// If data is not in tree returns the biggest element of tree smaller than data.
-// If data is smaller or equal to all elements of tree returns NULL.
-//
-void *rb_tree_prev(const rb_tree *tree, const void *data) {
-
-    rb_node *node;
-    rb_node *pred;
-    int      comp;
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
 
-    // Search:
-    pred = NULL;
-    node = tree->root;
-    while (node != NULL) {
+// CREATION & INSERTION:
 
-        // Compare data:
-        comp = (tree->comp)(data, node->data);
+// Returns a pointer to a newly created bp_tree.
+// The comparing function must satisfy the same rules as in "new_bs_tree".
+//
+bp_tree *new_bp_tree(int (* comp) (const void *, const void *)) {
 
-        // Data is smaller:
-        if (comp < 0) { node = node->left; }
+    // Sanity check:
+    assert(comp != NULL);
 
-        // Data is bigger:
-        else if (comp > 0) {
-            pred = node;
-            node = node->right;
-        }
+    // Allocate memory:
+    bp_tree *tree = (bp_tree *) malloc(sizeof(bp_tree));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for bp_tree\n");
+    }
 
-        // We have found the node:
-        else if (node->left != NULL) {
-            pred = node->left;
-            while (pred->right != NULL) { pred = pred->right; }
-            break;
-        } else { break; }
+    // Initialize the empty tree:
+    else {
+        tree->root = NULL;
+        tree->comp = comp;
+        tree->size = 0;
+        STATS_RESET(tree);
     }
 
-    // Return predecesor:
-    if (pred == NULL) { return NULL; }
-    return pred->data;
+    return tree;
 }
 
-// Find the in-order successor of data in the tree.
+// Returns a pointer to a newly created bp_tree containing the n elements of
+// the array "data", or NULL if out of memory. The elements must be sorted in
+// increasing order (according to comp) without duplicates.
 //
-// If data is not in tree returns the smallest element of tree bigger than data.
-// If data is bigger or equal to all elements of tree returns NULL.
+// It takes O(n) time (no comparisons at all) and the tree gets the minimum
+// possible height, with its elements spread evenly among its nodes.
 //
-void *rb_tree_next(const rb_tree *tree, const void *data) {
+bp_tree *bp_tree_from_sorted_array(int (* comp) (const void *, const void *),
+                                   void **data, size_t n) {
 
-    rb_node *node;
-    rb_node *succ;
-    int      comp;
+    bp_tree *tree;
+    size_t   i;
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+    // Sanity checks:
+    assert(comp != NULL);
+    assert(data != NULL || n == 0);
+    for (i = 1; i < n; i++) { assert(comp(data[i - 1], data[i]) < 0); }
 
-    // Search:
-    succ = NULL;
-    node = tree->root;
-    while (node != NULL) {
+    // Create the tree:
+    tree = new_bp_tree(comp);
+    if (tree == NULL) { return NULL; }
+    if (bp_tree_build(tree, data, n) == NO) {
+        free(tree);
+        return NULL;
+    }
 
-        // Compare data:
-        comp = (tree->comp)(data, node->data);
+    return tree;
+}
 
-        // Data is smaller:
-        if (comp < 0) {
-            succ = node;
-            node = node->left;
-        }
+// Returns a copy of tree (or NULL if out of memory). Unlike the copies of the
+// binary trees, it is already balanced. It takes O(|tree|) time.
+//
+bp_tree *bp_tree_copy(const bp_tree *tree) {
 
-        // Data is bigger:
-        else if (comp > 0) { node = node->right; }
+    bp_tree   *new_tree;
+    bp_walker  walker;
+    void     **data;
+    void      *elem;
+    size_t     n = 0;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Collect all the elements of tree in order:
+    data = (void **) malloc((tree->size + 1) * sizeof(void *));
+    if (data == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for bp_tree\n");
+        return NULL;
+    }
+    for (elem = bp_walker_first(&walker, tree); elem != NULL;
+         elem = bp_walker_next(&walker)) {
+        data[n] = elem;
+        n++;
+    }
+    assert(n == tree->size);
 
-        // We have found the node:
-        else if (node->right != NULL) {
-            succ = node->right;
-            while (succ->left != NULL) { succ = succ->left; }
-            break;
-        } else { break; }
+    // And build the new tree with them:
+    new_tree = new_bp_tree(tree->comp);
+    if (new_tree != NULL && bp_tree_build(new_tree, data, n) == NO) {
+        free(new_tree);
+        new_tree = NULL;
     }
+    free(data);
 
-    // Return succesor:
-    if (succ == NULL) { return NULL; }
-    return succ->data;
+    return new_tree;
 }
 
-
-// REMOVE:
-
-// Removes a node of tree that compares "equal" to data and returns a pointer
-// to the previously stored data (so you can free it).
-// If such a node is not found, it returns a NULL pointer.
+// Inserts data in tree.
 //
-// Uses the trick of swapping node->data and successor->data pointers and then
-// removes successor. This is safe because the final user has no acces to any
-// tree node (only "tree" and "data" pointers are used in all interfaces) and
-// no traverser is coded either (so no "internal state" is stored in them).
+// If an element of the tree compares "equal" to data it will get replaced and
+// a pointer to the previously stored data will be returned (so you can free
+// it), otherwise it will simply return a NULL pointer.
 //
-void *rb_tree_remove(rb_tree *tree, const void *data) {
+void *bp_tree_insert(bp_tree *tree, void *data) {
 
-    rb_node *granpa   = NULL;   // We need to store the last 3 levels //
-    rb_node *parent   = NULL;   //                                    //
-    rb_node *sister   = NULL;   //            granpa                  //
-    rb_node *node     = NULL;   //              |                     //
-    rb_node *old_node = NULL;   //            parent                  //
-    void    *old_data = NULL;   //            /    \   <- comp_n      //
-    int      comp_n   = 0;      //        sister  node                //
-    int      comp     = 0;      //                / \  <- comp        //
+    bp_node *node;
+    void    *old_data;
+    size_t   depth = 0;
+    int      found;
+    int      comp;
+    int      i;
 
     // Sanity Checks:
     assert(tree != NULL);
     assert(data != NULL);
 
-    // Initialize the search at the root node:
-    node = tree->root;
-    if (node == NULL) { return NULL; }
-    
-    // Look for a leaf:
-    while (node != NULL) {
-
-        // At this point node is BLACK, if sister exists is BLACK and if parent 
-        // exists is RED. We want to paint node RED and repair any violation.
+    // Trivial case: empty tree
+    if (tree->root == NULL) {
+        STATS_SEARCH(tree, depth);
+        node = new_bp_node(tree, YES);
+        if (node == NULL) { return NULL; }
+        node->data[0] = data;
+        node->size    = 1;
+        tree->root    = node;
+        tree->size    = 1;
+        return NULL;
+    }
 
-        // Case 1: Node has two BLACK children
-        if (IS_BLACK(node->left) && IS_BLACK(node->right)) {
+    // Make sure that the root has room for one more element:
+    if (bp_split_root(tree) == NO) { return NULL; }
 
-            // Easy case: the node is the root node
-            if (parent == NULL) { node->color = RED; }
+    // Search for the correct leaf splitting the full nodes on the way:
+    node = tree->root;
+    for (;;) {
 
-            // General case:
-            else {
+        // Search data in the current node:
+        depth++;
+        i = bp_node_find(tree, node, data, &found);
 
-                // Case 1.0: Node has no sister
-                if (sister == NULL) {
-                    node->color   = RED;
-                    parent->color = BLACK;
-                    
-                // Case 1.1: Sister has 2 BLACK children
-                } else if (IS_BLACK(sister->left) && IS_BLACK(sister->right)){
-                    node->color   = RED;
-                    sister->color = RED;
-                    parent->color = BLACK;
+        // Data is already there: overwrite it!
+        if (found == YES) {
+            old_data      = node->data[i];
+            node->data[i] = data;
+            STATS_SEARCH(tree, depth);
+            return old_data;
+        }
 
-                // Case 1.2: Sister has at least 1 RED children
-                } else {
+        // This is the place:
+        if (node->leaf == YES) { break; }
 
-                    // If sister->left is RED:
-                    if (IS_RED(sister->left)) {
+        // Make sure that the next node has room for one more element:
+        if (node->child[i]->size == BP_MAX) {
+            if (bp_split_child(tree, node, i) == NO) {
+                STATS_SEARCH(tree, depth);
+                return NULL;
+            }
+            comp = COMPARE(tree, data, node->data[i]);
+            if (comp == 0) {
+                old_data      = node->data[i];
+                node->data[i] = data;
+                STATS_SEARCH(tree, depth);
+                return old_data;
+            }
+            if (comp > 0) { i++; }
+        }
+        node = node->child[i];
+    }
+    STATS_SEARCH(tree, depth);
 
-                        // If sister == parent->right: Double rotation
-                        if (comp < 0) {
+    // Insert data in the leaf:
+    memmove(node->data + i + 1, node->data + i,
+            (node->size - i) * sizeof(void *));
+    node->data[i] = data;
+    node->size++;
+    tree->size++;
 
-                            if  (granpa == NULL) { tree->root    = sister->left; }
-                            else if (comp_n < 0) { granpa->left  = sister->left; }
-                            else                 { granpa->right = sister->left; }
-                            granpa = sister->left;
-                            
-                            parent->right = granpa->left;
-                            granpa->left  = parent;
+    // Data was not here!
+    return NULL;
+}
 
-                            sister->left  = granpa->right;
-                            granpa->right = sister;
-                            sister        = parent->right;
-                            
-                            node->color   = RED;
-                            parent->color = BLACK;
-                        }
+// Inserts "data" such that "data" is smaller or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly bigger than
+//          something already in the tree you will break the tree!
+//
+// If an element of the tree compares "equal" to data it will get replaced and
+// a pointer to the previously stored data will be returned (so you can free
+// it), otherwise it will simply return a NULL pointer.
+//
+void *bp_tree_insert_min(bp_tree *tree, void *data) {
 
-                        // If sister == parent->left: Single rotation
-                        else {
+    bp_node *node;
+    void    *old_data;
 
-                            if  (granpa == NULL) { tree->root    = sister; }
-                            else if (comp_n < 0) { granpa->left  = sister; }
-                            else                 { granpa->right = sister; }
-                            granpa = sister;
-                            
-                            parent->left  = granpa->right;
-                            granpa->right = parent;
-                            sister        = parent->left;
-                            
-                            node->color   = RED;
-                            granpa->color = RED;
-                            parent->color = BLACK;
-                            granpa->left->color = BLACK;
-                        }
-                    }
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-                    // If sister->right is RED:
-                    else {
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return bp_tree_insert(tree, data); }
 
-                        // If sister == parent->left: Double rotation
-                        if (comp > 0) {
+    // Go to the leftmost leaf splitting the full nodes on the way:
+    if (bp_split_root(tree) == NO) { return NULL; }
+    node = tree->root;
+    while (node->leaf == NO) {
+        if (node->child[0]->size == BP_MAX &&
+            bp_split_child(tree, node, 0) == NO) { return NULL; }
+        node = node->child[0];
+    }
 
-                            if  (granpa == NULL) { tree->root    = sister->right; }
-                            else if (comp_n < 0) { granpa->left  = sister->right; }
-                            else                 { granpa->right = sister->right; }
-                            granpa = sister->right;
-                            
-                            parent->left  = granpa->right;
-                            granpa->right = parent;
+    // If "data" is already there: overwrite it & return!
+    if (COMPARE(tree, data, node->data[0]) == 0) {
+        old_data      = node->data[0];
+        node->data[0] = data;
+        return old_data;
+    }
 
-                            sister->right = granpa->left;
-                            granpa->left  = sister;
-                            sister        = parent->left;
-                            
-                            node->color   = RED;
-                            parent->color = BLACK;
-                        }
+    // Finally: Insert data here
+    memmove(node->data + 1, node->data, node->size * sizeof(void *));
+    node->data[0] = data;
+    node->size++;
+    tree->size++;
 
-                        // If sister == parent->right: Single rotation
-                        else {
+    // Data was not here!
+    return NULL;
+}
 
-                            if  (granpa == NULL) { tree->root    = sister; }
-                            else if (comp_n < 0) { granpa->left  = sister; }
-                            else                 { granpa->right = sister; }
-                            granpa = sister;
-                            
-                            parent->right = granpa->left;
-                            granpa->left  = parent;
-                            sister        = parent->right;
+// Inserts "data" such that "data" is bigger or equal to any other "data"
+// already in the tree. It is slightly faster than a regular insert because it
+// makes at most one comparison.
+//
+// WARNING: If you use this function to insert data that is strictly smaller
+//          than something already in the tree you will break the tree!
+//
+// If an element of the tree compares "equal" to data it will get replaced and
+// a pointer to the previously stored data will be returned (so you can free
+// it), otherwise it will simply return a NULL pointer.
+//
+void *bp_tree_insert_max(bp_tree *tree, void *data) {
 
-                            node->color   = RED;
-                            granpa->color = RED;
-                            parent->color = BLACK;
-                            granpa->right->color = BLACK;
-                        }
-                    }
-                }
-            }
-        }
+    bp_node *node;
+    void    *old_data;
 
-        // We compare the data now because we need the information for "Case 2"
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-        // Compare data unless you already know where to go:
-        comp_n = comp;
-        comp   = (old_data == NULL) ? (tree->comp)(data, node->data) : (-1);
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return bp_tree_insert(tree, data); }
 
-        // If we have found the node to remove: Remember it!
-        if (comp == 0) {
-            old_data = node->data;
-            old_node = node;
-            comp     = +1;   // ...and search the successor
-        }
-        
-        // Case 2: Node has at least one RED children
-        if (IS_RED(node->left) || IS_RED(node->right)) {
+    // Go to the rightmost leaf splitting the full nodes on the way:
+    if (bp_split_root(tree) == NO) { return NULL; }
+    node = tree->root;
+    while (node->leaf == NO) {
+        if (node->child[node->size]->size == BP_MAX &&
+            bp_split_child(tree, node, node->size) == NO) { return NULL; }
+        node = node->child[node->size];
+    }
 
-            // Again node is BLACK, if sister exists is BLACK and if parent
-            // exists is RED. We paint node RED and repair any violation.
+    // If "data" is already there: overwrite it & return!
+    if (COMPARE(tree, data, node->data[node->size - 1]) == 0) {
+        old_data = node->data[node->size - 1];
+        node->data[node->size - 1] = data;
+        return old_data;
+    }
 
-            // Case 2.1: We are moving to the RED node
-            if ((comp < 0 && IS_RED(node->left )) ||
-                (comp > 0 && IS_RED(node->right)) ){
+    // Finally: Insert data here
+    node->data[node->size] = data;
+    node->size++;
+    tree->size++;
 
-                // Move and compare again for free!
-                granpa = parent;
-                parent = node;
-                if (comp < 0) {
-                    node   = parent->left;
-                    sister = parent->right;
-                } else if (comp > 0) {
-                    node   = parent->right;
-                    sister = parent->left;
-                }
-                comp_n = comp;
-                comp   = (old_data == NULL) ? (tree->comp)(data, node->data) : (-1);
-                if (comp == 0) {
-                    old_data = node->data;
-                    old_node = node;
-                    comp     = +1;
-                }
-            }
-            
-            // Case 2.2: We are moving to the BLACK node
-            else {
-                // If we are moving to the left: Single left-rotation
-                if (comp < 0) {
-                    if  (parent == NULL) { tree->root    = node->right; }
-                    else if (comp_n < 0) { parent->left  = node->right; }
-                    else                 { parent->right = node->right; }
-                    granpa        = parent;
-                    parent        = node->right;
-                    sister        = parent->right;
-                    node->right   = parent->left;
-                    parent->left  = node;
-                                        
-                    node->color   = RED;
-                    parent->color = BLACK;
+    // Data was not here!
+    return NULL;
+}
 
-                    comp_n = -1;
-                }
 
-                // If we are moving to the right: Single right-rotation
-                else {
-                    if  (parent == NULL) { tree->root    = node->left; }
-                    else if (comp_n < 0) { parent->left  = node->left; }
-                    else                 { parent->right = node->left; }
-                    granpa        = parent;
-                    parent        = node->left;
-                    sister        = parent->left;
-                    node->left    = parent->right;
-                    parent->right = node;
-                                        
-                    node->color   = RED;
-                    parent->color = BLACK;
 
-                    comp_n = 1;
-                }                
-            }
-        }
+// SEARCH:
 
-        // ...and finally move!
-        granpa = parent;
-        parent = node;
-        if (comp < 0) {
-            node   = parent->left;
-            sister = parent->right;
-        } else if (comp > 0) {
-            node   = parent->right;
-            sister = parent->left;
-        }
-    }
+// Returns YES if the tree is empty and NO otherwise.
+//
+int bp_tree_is_empty(const bp_tree *tree) {
 
-    // Erase "parent", which should be RED:
-    if (old_node != NULL) {
-        old_node->data = parent->data;
-        if      (granpa       == NULL)   { tree->root    = parent->right; }
-        else if (granpa->left == parent) { granpa->left  = parent->right; }
-        else                             { granpa->right = parent->right; }
-        free(parent);
-    }
-    
-    // Before leaving: Make sure that the root is BLACK!
-    if (tree->root != NULL) { tree->root->color = BLACK; }
+    // Sanity check:
+    assert(tree != NULL);
 
-    // And return old_data (which will be NULL unless data was already here)
-    return old_data;
+    // Check if there is at least 1 element in the tree:
+    if (tree->root == NULL) { return YES; }
+    else                    { return NO;  }
 }
 
-// Removes the smallest element from "tree" and returns a pointer to its data
-// (so you can free it). If the tree is empty returns a NULL pointer.
+// Finds an element that compares "equal" to data. Returns NULL if not found.
 //
-// More efficient than "tree_remove(tree, min_elem)" even if you already know
-// the value of "min_elem".
-//
-void *rb_tree_remove_min(rb_tree *tree) {
+void *bp_tree_search(const bp_tree *tree, const void *data) {
 
-    rb_node *granpa   = NULL;   //      granpa      //
-    rb_node *parent   = NULL;   //        |         //
-    rb_node *sister   = NULL;   //      parent      //
-    rb_node *node     = NULL;   //      /    \      // 
-    void    *old_data = NULL;   //   node  sister   //
+    bp_node *node;
+    size_t   depth = 0;
+    int      found;
+    int      i;
 
-    // Sanity Check:
+    // Sanity Checks:
     assert(tree != NULL);
+    assert(data != NULL);
 
-    // Initialize the search at the root node:
+    // Search:
     node = tree->root;
-    if (node == NULL) { return NULL; }
-    
-    // Look for a leaf:
     while (node != NULL) {
+        depth++;
+        i = bp_node_find(tree, node, data, &found);
+        if (found == YES) {
+            STATS_SEARCH(tree, depth);
+            return node->data[i];
+        }
+        node = (node->leaf == YES) ? NULL : node->child[i];
+    }
+    STATS_SEARCH(tree, depth);
 
-        // At this point node is BLACK, if sister exists is BLACK and if parent 
-        // exists is RED. We want to paint node RED and repair any violation.
-
-        // Case 1: Node has two BLACK children
-        if (IS_BLACK(node->left) && IS_BLACK(node->right)) {
+    // Not found:
+    return NULL;
+}
 
-            // Easy case: the node is the root node
-            if (parent == NULL) { node->color = RED; }
+// Returns a pointer to the smallest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *bp_tree_min(const bp_tree *tree) {
 
-            // General case:
-            else {
+    bp_node *node;
 
-                // Case 1.0: Node has no sister
-                if (sister == NULL) {
-                    node->color   = RED;
-                    parent->color = BLACK;
-                    
-                // Case 1.1: Sister has 2 BLACK children
-                } else if (IS_BLACK(sister->left) && IS_BLACK(sister->right)){
-                    node->color   = RED;
-                    sister->color = RED;
-                    parent->color = BLACK;
+    // Sanity check:
+    assert(tree != NULL);
 
-                // Case 1.2: Sister has at least 1 RED children
-                } else {
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
 
-                    // If sister->left is RED:
-                    if (IS_RED(sister->left)) {
+    // General case: Find the leftmost leaf
+    node = tree->root;
+    while (node->leaf == NO) { node = node->child[0]; }
 
-                        // Sister == parent->right: Double rotation
-                        if  (granpa == NULL) { tree->root    = sister->left; }
-                        else                 { granpa->left  = sister->left; }
-                        granpa = sister->left;
-                        
-                        parent->right = granpa->left;
-                        granpa->left  = parent;
+    // Return a pointer to the data:
+    return node->data[0];
+}
 
-                        sister->left  = granpa->right;
-                        granpa->right = sister;
-                        sister        = parent->right;
-                        
-                        node->color   = RED;
-                        parent->color = BLACK;
-                    }
+// Returns a pointer to the biggest element stored in "tree".
+// Returns NULL if the tree is empty.
+//
+void *bp_tree_max(const bp_tree *tree) {
 
-                    // If sister->right is RED:
-                    else {
+    bp_node *node;
 
-                        // Sister == parent->right: Single rotation
-                        if  (granpa == NULL) { tree->root    = sister; }
-                        else                 { granpa->left  = sister; }
-                        granpa = sister;
+    // Sanity check:
+    assert(tree != NULL);
 
-                        parent->right = granpa->left;
-                        granpa->left  = parent;
-                        sister        = parent->right;
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
 
-                        node->color   = RED;
-                        granpa->color = RED;
-                        parent->color = BLACK;
-                        granpa->right->color = BLACK;
-                    }
-                }
-            }
-        }
+    // General case: Find the rightmost leaf
+    node = tree->root;
+    while (node->leaf == NO) { node = node->child[node->size]; }
 
-        // Case 2: Node has at least one RED children
-        if (IS_RED(node->left) || IS_RED(node->right)) {
+    // Return a pointer to the data:
+    return node->data[node->size - 1];
+}
 
-            // Again node is BLACK, if sister exists is BLACK and if parent
-            // exists is RED. We paint node RED and repair any violation.
+// Find the in-order predecessor of data in the tree.
+//
+// If data is not in tree returns the biggest element of tree smaller than data.
+// If data is smaller or equal to all elements of tree returns NULL.
+//
+void *bp_tree_prev(const bp_tree *tree, const void *data) {
 
-            // Case 2.1: We are moving to the RED node
-            if (IS_RED(node->left)){
+    bp_node *node;
+    void    *pred = NULL;
+    int      found;
+    int      i;
 
-                // Move and compare again for free!
-                granpa = parent;
-                parent = node;
-                node   = parent->left;
-                sister = parent->right;
-            }
-            
-            // Case 2.2: We are moving to the BLACK node
-            else {
-                // We are moving to the left: Single left-rotation
-                if  (parent == NULL) { tree->root    = node->right; }
-                else                 { parent->left  = node->right; }
-                granpa        = parent;
-                parent        = node->right;
-                sister        = parent->right;
-                node->right   = parent->left;
-                parent->left  = node;
-                                    
-                node->color   = RED;
-                parent->color = BLACK;
-            }
-        }
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-        // ...and finally move!
-        granpa = parent;
-        parent = node;
-        node   = parent->left;
-        sister = parent->right;
+    // The last element smaller than data on the way down is the answer:
+    node = tree->root;
+    while (node != NULL) {
+        i = bp_node_find(tree, node, data, &found);
+        if (i > 0) { pred = node->data[i - 1]; }
+        node = (node->leaf == YES) ? NULL : node->child[i];
     }
 
-    // Erase "parent", which should be RED:
-    old_data = parent->data;
-    if (granpa == NULL) { tree->root   = parent->right; }
-    else                { granpa->left = parent->right; }
-    free(parent);
-    
-    // Before leaving: Make sure that the root is BLACK!
-    if (tree->root != NULL) { tree->root->color = BLACK; }
-
-    // And return old_data (which will be NULL unless data was already here)
-    return old_data;
+    return pred;
 }
 
-// Removes the biggest element from "tree" and returns a pointer to its data
-// (so you can free it). If the tree is empty returns a NULL pointer.
+// Find the in-order successor of data in the tree.
 //
-// More efficient than "tree_remove(tree, max_data)" even if you already know
-// the value of "max_data".
+// If data is not in tree returns the smallest element of tree bigger than data.
+// If data is bigger or equal to all elements of tree returns NULL.
 //
-void *rb_tree_remove_max(rb_tree *tree) {
+void *bp_tree_next(const bp_tree *tree, const void *data) {
 
-    rb_node *granpa   = NULL;   //      granpa      //
-    rb_node *parent   = NULL;   //        |         //
-    rb_node *sister   = NULL;   //      parent      //
-    rb_node *node     = NULL;   //      /    \      // 
-    void    *old_data = NULL;   //   sister node    //
+    bp_node *node;
+    void    *succ = NULL;
+    int      found;
+    int      i;
 
-    // Sanity Check:
+    // Sanity Checks:
     assert(tree != NULL);
-    
-    // Initialize the search at the root node:
+    assert(data != NULL);
+
+    // The last element bigger than data on the way down is the answer:
     node = tree->root;
-    if (node == NULL) { return NULL; }
-    
-    // Look for a leaf:
     while (node != NULL) {
+        i = bp_node_find(tree, node, data, &found);
+        if (found == YES)    { i++; }
+        if (i < node->size)  { succ = node->data[i]; }
+        node = (node->leaf == YES) ? NULL : node->child[i];
+    }
 
-        // At this point node is BLACK, if sister exists is BLACK and if parent 
-        // exists is RED. We want to paint node RED and repair any violation.
-
-        // Case 1: Node has two BLACK children
-        if (IS_BLACK(node->left) && IS_BLACK(node->right)) {
+    return succ;
+}
 
-            // Easy case: the node is the root node
-            if (parent == NULL) { node->color = RED; }
 
-            // General case:
-            else {
 
-                // Case 1.0: Node has no sister
-                if (sister == NULL) {
-                    node->color   = RED;
-                    parent->color = BLACK;
-                    
-                // Case 1.1: Sister has 2 BLACK children
-                } else if (IS_BLACK(sister->left) && IS_BLACK(sister->right)){
-                    node->color   = RED;
-                    sister->color = RED;
-                    parent->color = BLACK;
+// REMOVE:
 
-                // Case 1.2: Sister has at least 1 RED children
-                } else {
+// This is an auxiliary function that removes an element from tree: the one
+// that compares "equal" to data (BP_FIND_DATA), the smallest one (BP_FIND_MIN)
+// or the biggest one (BP_FIND_MAX). Returns the removed element, or NULL if
+// there was nothing to remove.
+//
+// An element of an internal node is replaced by its predecessor (or its
+// successor) which is then removed from the corresponding subtree with the
+// same single pass, so only leaves ever lose elements.
+//
+static void *bp_tree_remove_from(bp_tree *tree, const void *data, int target) {
 
-                    // If sister->left is RED:
-                    if (IS_RED(sister->left)) {
+    bp_node *node;
+    bp_node *aux;
+    void    *removed = NULL;
+    size_t   depth   = 0;
+    int      found;
+    int      i;
 
-                        // Sister == parent->left: Single rotation
-                        if  (granpa == NULL) { tree->root    = sister; }
-                        else                 { granpa->right = sister; }
-                        granpa = sister;
-                        
-                        parent->left  = granpa->right;
-                        granpa->right = parent;
-                        sister        = parent->left;
-                        
-                        node->color   = RED;
-                        granpa->color = RED;
-                        parent->color = BLACK;
-                        granpa->left->color = BLACK;
-                    }
+    // Trivial case: empty tree
+    if (tree->root == NULL) {
+        STATS_SEARCH(tree, depth);
+        return NULL;
+    }
 
-                    // If sister->right is RED:
-                    else {
+    // Go down making sure that every node has an element to spare:
+    node = tree->root;
+    for (;;) {
 
-                        // If sister == parent->left: Double rotation
-                        if  (granpa == NULL) { tree->root    = sister->right; }
-                        else                 { granpa->right = sister->right; }
-                        granpa = sister->right;
-                        
-                        parent->left  = granpa->right;
-                        granpa->right = parent;
+        // Find the element (or the subtree where it must be):
+        depth++;
+        if (target == BP_FIND_DATA) {
+            i = bp_node_find(tree, node, data, &found);
+        } else if (target == BP_FIND_MIN) {
+            i     = 0;
+            found = node->leaf;
+        } else {
+            i     = (node->leaf == YES) ? node->size - 1 : node->size;
+            found = node->leaf;
+        }
 
-                        sister->right = granpa->left;
-                        granpa->left  = sister;
-                        sister        = parent->left;
-                        
-                        node->color   = RED;
-                        parent->color = BLACK;
-                    }
-                }
+        // Leaves just lose the element:
+        if (node->leaf == YES) {
+            if (found == YES) {
+                if (removed == NULL) { removed = node->data[i]; }
+                memmove(node->data + i, node->data + i + 1,
+                        (node->size - i - 1) * sizeof(void *));
+                node->size--;
+                tree->size--;
             }
+            break;
         }
 
-        // Case 2: Node has at least one RED children
-        if (IS_RED(node->left) || IS_RED(node->right)) {
-
-            // Again node is BLACK, if sister exists is BLACK and if parent
-            // exists is RED. We paint node RED and repair any violation.
-
-            // Case 2.1: We are moving to the RED node
-            if (IS_RED(node->right)){
+        // Internal nodes replace it by its predecessor...
+        if (found == YES) {
+            removed = node->data[i];
+            if (node->child[i]->size > BP_MIN) {
+                aux = node->child[i];
+                while (aux->leaf == NO) { aux = aux->child[aux->size]; }
+                node->data[i] = aux->data[aux->size - 1];
+                node   = node->child[i];
+                target = BP_FIND_MAX;
+            }
 
-                // Move and compare again for free!
-                granpa = parent;
-                parent = node;
-                node   = parent->right;
-                sister = parent->left;
+            // ...or by its successor...
+            else if (node->child[i + 1]->size > BP_MIN) {
+                aux = node->child[i + 1];
+                while (aux->leaf == NO) { aux = aux->child[0]; }
+                node->data[i] = aux->data[0];
+                node   = node->child[i + 1];
+                target = BP_FIND_MIN;
             }
-            
-            // Case 2.2: We are moving to the BLACK node
+
+            // ...or push it down merging both subtrees:
             else {
-                // we are moving to the right: Single right-rotation
-                if  (parent == NULL) { tree->root    = node->left; }
-                else                 { parent->right = node->left; }
-                granpa        = parent;
-                parent        = node->left;
-                sister        = parent->left;
-                node->left    = parent->right;
-                parent->right = node;
-                                    
-                node->color   = RED;
-                parent->color = BLACK;
+                bp_merge_children(tree, node, i);
+                node = node->child[i];
             }
+            continue;
         }
 
-        // ...and finally move!
-        granpa = parent;
-        parent = node;
-        node   = parent->right;
-        sister = parent->left;
+        // Go down:
+        i    = bp_fix_child(tree, node, i);
+        node = node->child[i];
     }
+    STATS_SEARCH(tree, depth);
 
-    // Erase "parent", which should be RED:
-    old_data = parent->data;
-    if (granpa == NULL) { tree->root    = parent->left; }
-    else                { granpa->right = parent->left; }
-    free(parent);
-    
-    // Before leaving: Make sure that the root is BLACK!
-    if (tree->root != NULL) { tree->root->color = BLACK; }
+    // The tree shrinks one level if the root ends up empty:
+    node = tree->root;
+    if (node->size == 0) {
+        tree->root = (node->leaf == YES) ? NULL : node->child[0];
+        free_bp_node(tree, node);
+    }
 
-    // And return old_data (which will be NULL unless data was already here)
-    return old_data;
+    return removed;
 }
 
-// Removes all the elements from the tree in linear time. This is faster than
-// calling "tree_remove_min(tree)" until "tree_is_empty(tree)" returns "YES".
+// Removes an element of the tree that compares "equal" to data.
+// Returns a pointer to the removed data or NULL if data was not in the tree.
 //
-// If you provide a "free_data" function it will be used to free the "data"
-// inside each node. If "free_data" is NULL, no "data" will be freed. Use this
-// later option when "data" is shared between several data structures but be
-// aware that this may cause some memory leaks if you are not carefull.
+void *bp_tree_remove(bp_tree *tree, const void *data) {
+
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    return bp_tree_remove_from(tree, data, BP_FIND_DATA);
+}
+
+// Removes the smallest element of the tree.
+// Returns a pointer to the removed data or NULL if the tree was empty.
 //
-// Most of the time, you can use just "free" as "free_data" function.
-// However if your "data" struct contains dinamically allocated data
-// you may need to provide a more complex "free_data" function like:
+void *bp_tree_remove_min(bp_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    return bp_tree_remove_from(tree, NULL, BP_FIND_MIN);
+}
+
+// Removes the biggest element of the tree.
+// Returns a pointer to the removed data or NULL if the tree was empty.
 //
-//  void free_data(void *ptr) {
-//      MyData *data = (MyData *) ptr;
-//      free(data->some_array);
-//      free(data->some_other_array);
-//      free(data);
-//  }
+void *bp_tree_remove_max(bp_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    return bp_tree_remove_from(tree, NULL, BP_FIND_MAX);
+}
+
+// Removes all elements of the tree and, if a "free_data" function is
+// provided, it also frees their data (see "bs_tree_remove_all").
 //
-void rb_tree_remove_all(rb_tree *tree, void (* free_data) (void *)) {
+// It takes O(|tree|) time and its memory usage is bounded by the height of
+// the tree (which is tiny), so it never fails.
+//
+void bp_tree_remove_all(bp_tree *tree, void (* free_data) (void *)) {
 
-    rb_node *root;
-    rb_node *left;
-    rb_node *right;
+    bp_node *stack[BP_STACK];
+    bp_node *node;
+    size_t   size;
+    int      i;
 
     // Sanity check:
     assert(tree != NULL);
 
     // Initialize:
-    root = tree->root;
+    size = 0;
+    if (tree->root != NULL) { stack[size++] = tree->root; }
     tree->root = NULL;
+    tree->size = 0;
+
+    // Release every node after pushing its subtrees:
+    while (size > 0) {
+        size--;
+        node = stack[size];
+        if (free_data != NULL) {
+            for (i = 0; i < node->size; i++) { free_data(node->data[i]); }
+        }
+        if (node->leaf == NO) {
+            for (i = 0; i <= node->size; i++) {
+                if (node->child[i] != NULL) {
+                    assert(size < BP_STACK);
+                    stack[size++] = node->child[i];
+                }
+            }
+        }
+        free(node);
+    }
+}
 
-    // While the tree is not empty:
-    while (root != NULL) {
 
-        // Unravel the tree: Rotate right "root" & "left"
-        if (root->left != NULL) {
-            left        = root->left;
-            right       = left->right;
-            left->right = root;
-            root->left  = right;
-            root        = left;
 
-        // Erase the current "root" node:
+// SET FUNCTIONS:
+
+// Which elements go to the result of "bp_tree_set_op":
+#define BP_KEEP_1    1  // Elements only in tree_1
+#define BP_KEEP_2    2  // Elements only in tree_2
+#define BP_KEEP_BOTH 4  // Elements in both trees (taken from tree_1)
+
+// This is an auxiliary function that merges the elements of both trees (in
+// order) and keeps the ones selected by "keep" in a new (balanced) tree.
+// Returns NULL if out of memory. It takes O(|tree_1| + |tree_2|) time.
+//
+static bp_tree *bp_tree_set_op(const bp_tree *tree_1, const bp_tree *tree_2,
+                               int keep) {
+
+    bp_tree   *tree;
+    bp_walker  walker_1;
+    bp_walker  walker_2;
+    void      *data_1;
+    void      *data_2;
+    void     **data;
+    size_t     n = 0;
+    int        comp;
+
+    // Sanity check:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Room for the worst case:
+    data = (void **) malloc((tree_1->size + tree_2->size + 1) *
+                            sizeof(void *));
+    if (data == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate memory for bp_tree\n");
+        return NULL;
+    }
+
+    // Merge both trees:
+    data_1 = bp_walker_first(&walker_1, tree_1);
+    data_2 = bp_walker_first(&walker_2, tree_2);
+    while (data_1 != NULL || data_2 != NULL) {
+        if      (data_1 == NULL) { comp = +1; }
+        else if (data_2 == NULL) { comp = -1; }
+        else { comp = COMPARE(tree_1, data_1, data_2); }
+
+        if (comp < 0) {
+            if (keep & BP_KEEP_1)    { data[n++] = data_1; }
+            data_1 = bp_walker_next(&walker_1);
+        } else if (comp > 0) {
+            if (keep & BP_KEEP_2)    { data[n++] = data_2; }
+            data_2 = bp_walker_next(&walker_2);
         } else {
-            right = root->right;
-            if (free_data != NULL) { free_data(root->data); }
-            free(root);
-            root = right;
+            if (keep & BP_KEEP_BOTH) { data[n++] = data_1; }
+            data_1 = bp_walker_next(&walker_1);
+            data_2 = bp_walker_next(&walker_2);
         }
     }
-}
-
 
+    // Build the result:
+    tree = new_bp_tree(tree_1->comp);
+    if (tree != NULL && bp_tree_build(tree, data, n) == NO) {
+        free(tree);
+        tree = NULL;
+    }
+    free(data);
 
-// SET FUNCTIONS:
+    return tree;
+}
 
-// Returns a rb_tree containing a copy of the union of tree_1 and tree_2.
-// It does NOT modify tree_1 or tree_2.
+// Returns a new (balanced) tree containing the union of tree_1 and tree_2, or
+// NULL if out of memory. It does NOT modify tree_1 or tree_2.
 //
 // If a given "element" is in both trees it takes the pointer from tree_1.
 // Likewise, the new tree stores a pointer to the comparing function of tree_1.
 //
-// It takes O( MAX{ |tree_1|+|tree_2|, |Union|·Log(|Union|) } ) time.
-//
-rb_tree *rb_tree_union(const rb_tree *tree_1, const rb_tree *tree_2) {
+bp_tree *bp_tree_union(const bp_tree *tree_1, const bp_tree *tree_2) {
+    return bp_tree_set_op(tree_1, tree_2,
+                          BP_KEEP_1 | BP_KEEP_2 | BP_KEEP_BOTH);
+}
 
-    rb_tree *tree = NULL;
-    rb_node *pred_1;
-    rb_node *node_1;
-    rb_node *pred_2;
-    rb_node *node_2;
-    void    *data;
-    int      comp;
+// Returns a new (balanced) tree containing the intersection of tree_1 and
+// tree_2 (see "bp_tree_union").
+//
+bp_tree *bp_tree_intersection(const bp_tree *tree_1, const bp_tree *tree_2) {
+    return bp_tree_set_op(tree_1, tree_2, BP_KEEP_BOTH);
+}
 
-    // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
+// Returns a new (balanced) tree containing the elements of tree_1 that are
+// not in tree_2 (see "bp_tree_union").
+//
+bp_tree *bp_tree_diff(const bp_tree *tree_1, const bp_tree *tree_2) {
+    return bp_tree_set_op(tree_1, tree_2, BP_KEEP_1);
+}
 
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return rb_tree_copy(tree_1); }
+// Returns a new (balanced) tree containing the elements that are in exactly
+// one of both trees (see "bp_tree_union").
+//
+bp_tree *bp_tree_sym_diff(const bp_tree *tree_1, const bp_tree *tree_2) {
+    return bp_tree_set_op(tree_1, tree_2, BP_KEEP_1 | BP_KEEP_2);
+}
 
-    // Create a new tree:
-    tree = new_rb_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
 
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
-    }
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
-        }
-    }
+#ifdef TREE_STATS
 
-    // Until we have exhausted at least one of the trees:
-    while (node_1 != NULL && node_2 != NULL) {
+// STATISTICS:
 
-        // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
+// Returns a copy of the operation counters of tree (see TREE_STATS). In a
+// bp_tree "rotations" counts the elements moved between sibling nodes.
+//
+tree_stats bp_tree_get_stats(const bp_tree *tree) {
 
-        if (comp < 0) {
+    // Sanity check:
+    assert(tree != NULL);
 
-            // insert node_1->data in tree /////////////////////////////////////
-            data = node_1->data;
-            data = rb_tree_insert_max(tree, data);
-            assert(data == NULL);
-            ////////////////////////////////////////////////////////////////////
+    return tree->stats;
+}
 
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+// Sets all the counters of tree to zero.
+//
+void bp_tree_reset_stats(bp_tree *tree) {
 
-        } else if (comp > 0) {
+    // Sanity check:
+    assert(tree != NULL);
 
-            // insert node_2->data in tree /////////////////////////////////////
-            data = node_2->data;
-            data = rb_tree_insert_max(tree, data);
-            assert(data == NULL);
-            ////////////////////////////////////////////////////////////////////
+    STATS_RESET(tree);
+}
 
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+#endif
 
-        } else {
 
-            // insert node_1->data in tree /////////////////////////////////////
-            data = node_1->data;
-            data = rb_tree_insert_max(tree, data);
-            assert(data == NULL);
-            ////////////////////////////////////////////////////////////////////
 
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+// DEBUG & VISUALIZATION:
 
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
-        }
-    }
+// This is an auxiliary function to check the bp_tree properties recursively.
+// You should not use it directly, use "is_bp_tree" instead.
+//
+// It returns the depth of the leaves of the subtree (or -1 if something is
+// wrong) and adds its number of elements to *count.
+//
+static int is_bp_subtree(const bp_tree *tree, const bp_node *node,
+                         const void *min, const void *max, size_t *count) {
 
-    // Insert all remaining data from tree_1:
-    while (node_1 != NULL) {
+    int depth = -1;
+    int child_depth;
+    int i;
 
-        // insert node_1->data in tree /////////////////////////////////////////
-        data = node_1->data;
-        data = rb_tree_insert_max(tree, data);
-        assert(data == NULL);
-        ////////////////////////////////////////////////////////////////////////
+    // Check the number of elements:
+    if (node->size > BP_MAX || node->size < 1 ||
+        (node != tree->root && node->size < BP_MIN)) {
+        fprintf(stderr,"ERROR: Wrong number of elements in bp_tree node\n");
+        return -1;
+    }
+    if (node->leaf != YES && node->leaf != NO) {
+        fprintf(stderr,"ERROR: Wrong leaf flag in bp_tree node\n");
+        return -1;
+    }
+    *count += node->size;
 
-        // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
-            }
+    // Make sure that the elements are sorted and (strictly) between limits:
+    for (i = 0; i < node->size; i++) {
+        if (node->data[i] == NULL) {
+            fprintf(stderr,"ERROR: NULL data in bp_tree\n");
+            return -1;
+        }
+        if ((i == 0 && min != NULL &&
+             COMPARE(tree, min, node->data[i]) >= 0) ||
+            (i >  0 && COMPARE(tree, node->data[i - 1], node->data[i]) >= 0) ||
+            (i == node->size - 1 && max != NULL &&
+             COMPARE(tree, node->data[i], max) >= 0)) {
+            fprintf(stderr,"ERROR: Symmetric order not satisfied in bp_tree\n");
+            return -1;
         }
-        ////////////////////////////////////////////////////////////////////////
     }
 
-    // Insert all remaining data from tree_2:
-    while (node_2 != NULL) {
-
-        // insert node_2->data in tree /////////////////////////////////////////
-        data = node_2->data;
-        data = rb_tree_insert_max(tree, data);
-        assert(data == NULL);
-        ////////////////////////////////////////////////////////////////////////
+    // Leaves are done:
+    if (node->leaf == YES) { return 0; }
 
-        // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
-            }
+    // Check recursively all the subtrees (whose leaves must be at the same
+    // depth):
+    for (i = 0; i <= node->size; i++) {
+        if (node->child[i] == NULL) {
+            fprintf(stderr,"ERROR: NULL subtree in bp_tree\n");
+            return -1;
         }
-        ////////////////////////////////////////////////////////////////////////
+        child_depth = is_bp_subtree(tree, node->child[i],
+                                    (i == 0) ? min : node->data[i - 1],
+                                    (i == node->size) ? max : node->data[i],
+                                    count);
+        if (child_depth < 0) { return -1; }
+        if (depth >= 0 && child_depth != depth) {
+            fprintf(stderr,"ERROR: Leaves at different depths in bp_tree\n");
+            return -1;
+        }
+        depth = child_depth;
     }
 
-    // Return the resulting tree:
-    return tree;
+    return depth + 1;
 }
 
-// Returns a rb_tree containing a copy of the intersection of tree_1 and tree_2.
-// It does NOT modify tree_1 or tree_2.
+// This is an auxiliary function to check the properties of a bp_tree:
+//  * Every node but the root has between BP_MIN and BP_MAX elements.
+//  * All the leaves are at the same depth.
+//  * Symmetric order & the right number of elements.
+// Returns YES if everything is correct and NO otherwise.
 //
-// The comparing function and all data pointers are taken from tree_1.
+// This function should not be used in production code. I recommend to use:
 //
-// It takes O( MAX{ |tree_1|+|tree_2|, |Intersec|·Log(|Intersec|) } ) time.
+//      assert(is_bp_tree(tree) == YES);
 //
-rb_tree *rb_tree_intersection(const rb_tree *tree_1, const rb_tree *tree_2) {
-
-    rb_tree *tree = NULL;
-    rb_node *pred_1;
-    rb_node *node_1;
-    rb_node *pred_2;
-    rb_node *node_2;
-    void    *data;
-    int      comp;
-
-    // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
-
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return rb_tree_copy(tree_1); }
-
-    // Create a new tree:    
-    tree = new_rb_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
+//
+int is_bp_tree(const bp_tree *tree) {
 
-    // Special case: Some of them is empty
-    if (rb_tree_is_empty(tree_1) == YES) { return tree; }
-    if (rb_tree_is_empty(tree_2) == YES) { return tree; }
+    size_t count = 0;
 
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
+    // Basic Sanity Checks:
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to bp_tree\n");
+        return NO;
+    }
+    if (tree->comp == NULL) {
+        fprintf(stderr, "ERROR: NULL comparing function in bp_tree\n");
+        return NO;
     }
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
+    // Trivial Case: empty tree
+    if (tree->root == NULL) {
+        if (tree->size != 0) {
+            fprintf(stderr, "ERROR: Wrong size of bp_tree\n");
+            return NO;
         }
+        return YES;
     }
 
-    // Until we have exhausted at least one of the trees:
-    while (node_1 != NULL && node_2 != NULL) {
-
-        // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
-
-        if (comp < 0) {
-
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
-
-        } else if (comp > 0) {
-
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
-
-        } else {
-
-            // insert node_1->data in tree /////////////////////////////////////
-            data = node_1->data;
-            data = rb_tree_insert_max(tree, data);
-            assert(data == NULL);
-            ////////////////////////////////////////////////////////////////////
+    // General Case:
+    if (is_bp_subtree(tree, tree->root, NULL, NULL, &count) < 0) { return NO; }
+    if (count != tree->size) {
+        fprintf(stderr, "ERROR: Wrong size of bp_tree\n");
+        return NO;
+    }
 
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+    // All test are fine:
+    return YES;
+}
 
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
-        }
-    }
+// This is an auxiliary function to print the tree recursively.
+// You should not use it directly, use "print_bp_tree" instead.
+//
+static void print_bp_subtree(const bp_node *node, const int is_last,
+                             char *indent, void (* print_node) (const void *)) {
 
-    // We need to traverse tree_1 completely to restore the modified pointers:
-    while (node_1 != NULL) {
+    // Allocate memory:
+    char *new_indent = (char *) malloc((7+strlen(indent))*sizeof(char));
+    int   i;
+    assert(new_indent != NULL);
 
-        // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
-            }
-        }
-        ////////////////////////////////////////////////////////////////////////
+    // Print current node:
+    if (is_last) { fprintf(stdout, "%s`----", indent); }
+    else         { fprintf(stdout, "%s|----", indent); }
+    for (i = 0; i < node->size; i++) {
+        if (print_node == NULL) { fprintf(stdout, "(#)"); }
+        else                    { print_node(node->data[i]); }
     }
+    fprintf(stdout, "\n");
 
-    // We need to traverse tree_2 completely to restore the modified pointers:
-    while (node_2 != NULL) {
-
-        // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
-            }
+    // Print its subtrees recursively:
+    if (node->leaf == NO) {
+        if (is_last == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
+        else                { sprintf(new_indent, "%s%s", indent, "|     "); }
+        for (i = 0; i <= node->size; i++) {
+            print_bp_subtree(node->child[i], (i == node->size) ? YES : NO,
+                             new_indent, print_node);
         }
-        ////////////////////////////////////////////////////////////////////////
     }
 
-    // Return the resulting tree:
-    return tree;
+    // Free memory:
+    free(new_indent);
 }
-
-// Returns a rb_tree containing a copy of the difference: tree_1 - tree_2.
-// It does NOT modify tree_1 or tree_2.
-//
-// The comparing function and all data pointers are taken from tree_1.
+
+// This function is used to print a bp_tree on the screen, one node per line
+// (with its subtrees below it, from left to right).
 //
-// It takes O( MAX{ |tree_1|+|tree_2|, |Diff|·Log(|Diff|) } ) time.
+// The print_node function works as in "print_bs_tree" and, again, this is a
+// visualization tool for debugging purposes only.
 //
-rb_tree *rb_tree_diff(const rb_tree *tree_1, const rb_tree *tree_2) {
+void print_bp_tree(const bp_tree *tree, void (* print_node) (const void *)) {
 
-    rb_tree *tree = NULL;
-    rb_node *pred_1;
-    rb_node *node_1;
-    rb_node *pred_2;
-    rb_node *node_2;
-    void    *data;
-    int      comp;
+    // Avoid the trivial cases:
+    if (tree != NULL && tree->root != NULL) {
+        print_bp_subtree(tree->root, YES, "", print_node);
+    }
 
-    // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
+    // Empty the "stdout" buffer:
+    fflush(stdout);
+}
 
-    // Create a new tree:
-    tree = new_rb_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
+// END OF B-TREES //////////////////////////////////////////////////////////////
 
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return tree; }
 
-    // Special case: tree_1 is empty
-    if (rb_tree_is_empty(tree_1) == YES) { return tree; }
 
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
-    }
+// SHARDED TREES ///////////////////////////////////////////////////////////////
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
-        }
-    }
-    
-    // Until we have exhausted at least one of the trees:
-    while (node_1 != NULL && node_2 != NULL) {
+#ifdef RB_THREADS
 
-        // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
+// Shards never trigger a rebalance before holding twice this many elements
+// (a rebalance stops all the threads, so it must be worth it):
+#define SHARDED_MIN_SIZE    64
 
-        if (comp < 0) {
+// What the set functions keep from each tree:
+#define SHARDED_KEEP_1      1   // Elements only in tree_1
+#define SHARDED_KEEP_2      2   // Elements only in tree_2
+#define SHARDED_KEEP_BOTH   4   // Elements in both trees (from tree_1)
 
-            // insert node_1->data in tree /////////////////////////////////////
-            data = node_1->data;
-            data = rb_tree_insert_max(tree, data);
-            assert(data == NULL);
-            ////////////////////////////////////////////////////////////////////
+// Updates done by "sharded_exclusive_update":
+#define SHARDED_INSERT      0
+#define SHARDED_REMOVE      1
+#define SHARDED_REMOVE_MIN  2
+#define SHARDED_REMOVE_MAX  3
 
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+// The layout lock lives in its own block of memory, so the header does not
+// need pthread_rwlock_t (which strict C99 compilers hide):
+typedef struct sharded_layout {
+    pthread_rwlock_t lock;
+} sharded_layout;
 
-        } else if (comp > 0) {
 
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+// AUXILIARY FUNCTIONS:
 
-        } else {
+// Returns the index of the shard whose range contains data, that is, the
+// number of split points smaller or equal to data (NULL split points stand
+// for +infinity and always come last). The caller must hold the layout lock.
+//
+static size_t sharded_route(const sharded_rb_tree *tree, const void *data) {
+
+    size_t lo = 0;
+    size_t hi = tree->n - 1;
+    size_t mid;
+
+    // Binary search of the first split point bigger than data:
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (tree->splits[mid] != NULL &&
+            tree->comp(tree->splits[mid], data) <= 0) { lo = mid + 1; }
+        else                                           { hi = mid;     }
+    }
+    return lo;
+}
 
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+// Recomputes every split point from the smallest element of each shard (see
+// SHARDED TREES in the header). The caller must hold the layout lock in write
+// mode. It takes O(n·log(|tree|)) time.
+//
+static void sharded_fix_splits(sharded_rb_tree *tree) {
 
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+    void   *split = NULL;
+    size_t  i;
+
+    // Empty shards inherit the split point of the following one:
+    for (i = tree->n - 1; i > 0; i--) {
+        if (rb_tree_is_empty(tree->shards[i].tree) == NO) {
+            split = rb_tree_min(tree->shards[i].tree);
         }
+        tree->splits[i - 1] = split;
     }
+}
 
-    // Insert all remaining data from tree_1:
-    while (node_1 != NULL) {
+// Moves the split points so that every shard holds the same number of
+// elements (give or take one). The caller must hold the layout lock in write
+// mode (or be the only one that knows about the tree).
+//
+// First it joins all the shards in the first one and then it splits them back
+// from the right, so it takes O(n·log(|tree|)) time if RB_ORDER_STATISTICS
+// is defined (rb_tree_select finds every split point) and O(|tree|) time
+// otherwise (an in-order walk finds them).
+//
+static void sharded_rebalance(sharded_rb_tree *tree) {
+
+    rb_tree   *all = tree->shards[0].tree;
+    rb_tree   *part;
+    size_t     total = 0;
+    size_t     left;
+    size_t     i;
+#ifndef RB_ORDER_STATISTICS
+    rb_walker  walker;
+    rb_node   *node;
+    size_t     k;
+#endif
+
+    // Join all the shards in the first one (they are sorted by range):
+    for (i = 0; i < tree->n; i++) {
+        total += tree->shards[i].size;
+        if (i > 0) { rb_tree_join(all, tree->shards[i].tree); }
+    }
 
-        // insert node_1->data in tree /////////////////////////////////////////
-        data = node_1->data;
-        data = rb_tree_insert_max(tree, data);
-        assert(data == NULL);
-        ////////////////////////////////////////////////////////////////////////
+    // The k-th split point is the (k·total/n)-th smallest element:
+#ifdef RB_ORDER_STATISTICS
+    for (i = 1; i < tree->n; i++) {
+        tree->splits[i - 1] = rb_tree_select(all, i * total / tree->n);
+    }
+#else
+    for (i = 1; i < tree->n; i++) { tree->splits[i - 1] = NULL; }
+    i    = 1;
+    k    = 0;
+    node = rb_walker_first(&walker, all->root);
+    while (node != NULL && i < tree->n) {
+        while (i < tree->n && k == i * total / tree->n) {
+            tree->splits[i - 1] = node->data;
+            i++;
+        }
+        k++;
+        node = rb_walker_next(&walker);
+    }
+#endif
+
+    // Split the shards back from the right (if a split runs out of memory,
+    // its elements just stay in the previous shard):
+    left = total;
+    for (i = tree->n - 1; i > 0; i--) {
+        tree->shards[i].size = 0;
+        if (tree->splits[i - 1] == NULL) { continue; }
+        part = rb_tree_split(all, tree->splits[i - 1]);
+        if (part == NULL) { continue; }
+        free(tree->shards[i].tree);
+        tree->shards[i].tree = part;
+        tree->shards[i].size = left - i * total / tree->n;
+        left                 = i * total / tree->n;
+    }
+    tree->shards[0].size = left;
 
-        // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
+    // Update the split points and the next limit:
+    sharded_fix_splits(tree);
+    tree->limit = 2 * ((total / tree->n > SHARDED_MIN_SIZE) ?
+                       total / tree->n : SHARDED_MIN_SIZE);
+}
+
+// This is an auxiliary function that makes an update that may change the
+// split points (removing or replacing the smallest element of a shard) while
+// holding the layout lock in write mode.
+//
+static void *sharded_exclusive_update(sharded_rb_tree *tree, const void *data,
+                                      int update) {
+
+    rb_shard *shard    = NULL;
+    void     *old_data = NULL;
+    size_t    i;
+
+    pthread_rwlock_wrlock(&(tree->layout->lock));
+
+    // Find the shard to update:
+    if (update == SHARDED_INSERT || update == SHARDED_REMOVE) {
+        shard = &(tree->shards[sharded_route(tree, data)]);
+    } else if (update == SHARDED_REMOVE_MIN) {
+        for (i = 0; i < tree->n && shard == NULL; i++) {
+            if (rb_tree_is_empty(tree->shards[i].tree) == NO) {
+                shard = &(tree->shards[i]);
+            }
+        }
+    } else {
+        for (i = tree->n; i > 0 && shard == NULL; i--) {
+            if (rb_tree_is_empty(tree->shards[i - 1].tree) == NO) {
+                shard = &(tree->shards[i - 1]);
             }
         }
-        ////////////////////////////////////////////////////////////////////////
     }
 
-    // We need to traverse tree_2 completely to restore the modified pointers:
-    while (node_2 != NULL) {
-
-        // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
+    // Update it (unless the tree is empty):
+    if (shard != NULL) {
+        if (update == SHARDED_INSERT) {
+            old_data = rb_tree_insert(shard->tree, (void *) data);
+            if (old_data == NULL) { shard->size++; }
+        } else {
+            if      (update == SHARDED_REMOVE) {
+                old_data = rb_tree_remove(shard->tree, data);
+            }
+            else if (update == SHARDED_REMOVE_MIN) {
+                old_data = rb_tree_remove_min(shard->tree);
             }
+            else {
+                old_data = rb_tree_remove_max(shard->tree);
+            }
+            if (old_data != NULL) { shard->size--; }
         }
-        ////////////////////////////////////////////////////////////////////////
+        sharded_fix_splits(tree);
     }
 
-    // Return the resulting tree:
-    return tree;
+    pthread_rwlock_unlock(&(tree->layout->lock));
+    return old_data;
 }
 
-// Returns a rb_tree containing a copy of the symmetric difference of tree_1
-// and tree_2. It does NOT modify tree_1 or tree_2.
-//
-// The comparing function is taken from tree_1.
-//
-// It takes O( MAX{ |tree_1|+|tree_2|, |SymDiff|·Log(|SymDiff|) } ) time.
+// Locks the layout of tree (in read mode) and all its shards, in order.
 //
-rb_tree *rb_tree_sym_diff(const rb_tree *tree_1, const rb_tree *tree_2) {
+static void sharded_lock_all(sharded_rb_tree *tree) {
 
-    rb_tree *tree = NULL;
-    rb_node *pred_1;
-    rb_node *node_1;
-    rb_node *pred_2;
-    rb_node *node_2;
-    void    *data;
-    int      comp;
+    size_t i;
 
-    // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    for (i = 0; i < tree->n; i++) {
+        pthread_mutex_lock(&(tree->shards[i].lock));
+    }
+}
 
-    // Create a new tree:
-    tree = new_rb_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
+// Releases the locks taken by "sharded_lock_all".
+//
+static void sharded_unlock_all(sharded_rb_tree *tree) {
 
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return tree; }
+    size_t i;
 
-    // Go to the smallest element of tree_1 while right-threading your path:
-    node_1 = tree_1->root;
-    if (node_1 != NULL) {
-        while (node_1->left != NULL) {
-            pred_1 = node_1->left;
-            while (pred_1->right != NULL) { pred_1 = pred_1->right; }
-            pred_1->right = node_1;
-            node_1        = node_1->left;
-        }
+    for (i = tree->n; i > 0; i--) {
+        pthread_mutex_unlock(&(tree->shards[i - 1].lock));
     }
+    pthread_rwlock_unlock(&(tree->layout->lock));
+}
 
-    // Go to the smallest element of tree_2 while right-threading your path:
-    node_2 = tree_2->root;
-    if (node_2 != NULL) {
-        while (node_2->left != NULL) {
-            pred_2 = node_2->left;
-            while (pred_2->right != NULL) { pred_2 = pred_2->right; }
-            pred_2->right = node_2;
-            node_2        = node_2->left;
-        }
+// An in-order traversal of all the elements of a sharded_rb_tree (one shard
+// after the other). The caller must hold the locks of the whole tree.
+//
+typedef struct sharded_walker {
+    sharded_rb_tree *tree;      // Tree being traversed
+    size_t           shard;     // Shard being traversed
+    rb_walker        walker;    // Traversal of that shard
+} sharded_walker;
+
+// Starts an in-order traversal of tree and returns its smallest node (or
+// NULL if the tree is empty).
+//
+static rb_node *sharded_walker_first(sharded_walker *walker,
+                                     sharded_rb_tree *tree) {
+
+    rb_node *node = NULL;
+
+    walker->tree = tree;
+    for (walker->shard = 0; walker->shard < tree->n; walker->shard++) {
+        node = rb_walker_first(&(walker->walker),
+                               tree->shards[walker->shard].tree->root);
+        if (node != NULL) { break; }
     }
+    return node;
+}
 
-    // Until we have exhausted at least one of the trees:
-    while (node_1 != NULL && node_2 != NULL) {
+// Moves walker to the in-order successor of its current node and returns it
+// (or NULL if the traversal is finished).
+//
+static rb_node *sharded_walker_next(sharded_walker *walker) {
 
-        // compare both nodes:
-        comp = (tree->comp)(node_1->data, node_2->data);
+    rb_node *node = rb_walker_next(&(walker->walker));
 
-        if (comp < 0) {
+    // Go to the next non-empty shard:
+    while (node == NULL && walker->shard + 1 < walker->tree->n) {
+        walker->shard++;
+        node = rb_walker_first(&(walker->walker),
+                               walker->tree->shards[walker->shard].tree->root);
+    }
+    return node;
+}
 
-            // insert node_1->data in tree /////////////////////////////////////
-            data = node_1->data;
-            data = rb_tree_insert_max(tree, data);
-            assert(data == NULL);
-            ////////////////////////////////////////////////////////////////////
 
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
 
-        } else if (comp > 0) {
+// CREATION & DESTRUCTION:
 
-            // insert node_2->data in tree /////////////////////////////////////
-            data = node_2->data;
-            data = rb_tree_insert_max(tree, data);
-            assert(data == NULL);
-            ////////////////////////////////////////////////////////////////////
+// Returns a pointer to a new empty sharded_rb_tree with the given number of
+// shards (use at least as many shards as threads) or NULL if out of memory.
+// The comparing function must satisfy the same rules as in "new_rb_tree".
+//
+sharded_rb_tree *new_sharded_rb_tree(int (* comp) (const void *,
+                                                   const void *),
+                                     size_t shards) {
 
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+    sharded_rb_tree *tree;
+    size_t           i;
 
-        } else {
+    // Sanity checks:
+    assert(comp != NULL);
+    assert(shards > 0);
 
-            // advance node_1 //////////////////////////////////////////////////
-            node_1 = node_1->right;
-            if (node_1 != NULL) {
-                while (node_1->left != NULL) {
-                    pred_1 = node_1->left;
-                    while (pred_1->right != NULL && pred_1->right != node_1) {
-                        pred_1 = pred_1->right;
-                    }
-                    if (pred_1->right == NULL) {
-                        pred_1->right = node_1;
-                        node_1        = node_1->left;
-                    } else {
-                        pred_1->right = NULL;
-                        break;
-                    }
-                }
-            }
-            ////////////////////////////////////////////////////////////////////
+    // Allocate memory:
+    tree = (sharded_rb_tree *) malloc(sizeof(sharded_rb_tree));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate sharded_rb_tree\n");
+        return NULL;
+    }
+    tree->shards = (rb_shard *) malloc(shards * sizeof(rb_shard));
+    tree->splits = (void **) malloc(shards * sizeof(void *));
+    tree->layout = (sharded_layout *) malloc(sizeof(sharded_layout));
+    if (tree->shards == NULL || tree->splits == NULL || tree->layout == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate sharded_rb_tree\n");
+        free(tree->shards);
+        free(tree->splits);
+        free(tree->layout);
+        free(tree);
+        return NULL;
+    }
 
-            // advance node_2 //////////////////////////////////////////////////
-            node_2 = node_2->right;
-            if (node_2 != NULL) {
-                while (node_2->left != NULL) {
-                    pred_2 = node_2->left;
-                    while (pred_2->right != NULL && pred_2->right != node_2) {
-                        pred_2 = pred_2->right;
-                    }
-                    if (pred_2->right == NULL) {
-                        pred_2->right = node_2;
-                        node_2        = node_2->left;
-                    } else {
-                        pred_2->right = NULL;
-                        break;
-                    }
-                }
+    // Create the (empty) shards:
+    for (i = 0; i < shards; i++) {
+        tree->shards[i].tree = new_rb_tree(comp);
+        if (tree->shards[i].tree == NULL) {
+            while (i > 0) {
+                i--;
+                free(tree->shards[i].tree);
+                pthread_mutex_destroy(&(tree->shards[i].lock));
             }
-            ////////////////////////////////////////////////////////////////////
+            free(tree->shards);
+            free(tree->splits);
+            free(tree->layout);
+            free(tree);
+            return NULL;
         }
+        tree->shards[i].size = 0;
+        tree->splits[i]      = NULL;
+        pthread_mutex_init(&(tree->shards[i].lock), NULL);
     }
 
-    // Insert all remaining data from tree_1:
-    while (node_1 != NULL) {
+    // Initialize the rest of the tree:
+    pthread_rwlock_init(&(tree->layout->lock), NULL);
+    tree->n     = shards;
+    tree->limit = 2 * SHARDED_MIN_SIZE;
+    tree->comp  = comp;
 
-        // insert node_1->data in tree /////////////////////////////////////////
-        data = node_1->data;
-        data = rb_tree_insert_max(tree, data);
-        assert(data == NULL);
-        ////////////////////////////////////////////////////////////////////////
+    return tree;
+}
 
-        // advance node_1 //////////////////////////////////////////////////////
-        node_1 = node_1->right;
-        if (node_1 != NULL) {
-            while (node_1->left != NULL) {
-                pred_1 = node_1->left;
-                while (pred_1->right != NULL && pred_1->right != node_1) {
-                    pred_1 = pred_1->right;
-                }
-                if (pred_1->right == NULL) {
-                    pred_1->right = node_1;
-                    node_1        = node_1->left;
-                } else {
-                    pred_1->right = NULL;
-                    break;
-                }
-            }
-        }
-        ////////////////////////////////////////////////////////////////////////
+// Releases all the memory of tree (but not the data of its elements, so call
+// "sharded_rb_tree_remove_all" first if you need to free it). No other thread
+// may be using the tree.
+//
+void free_sharded_rb_tree(sharded_rb_tree *tree) {
+
+    size_t i;
+
+    // Avoid the trivial case:
+    if (tree == NULL) { return; }
+
+    for (i = 0; i < tree->n; i++) {
+        rb_tree_remove_all(tree->shards[i].tree, NULL);
+        free(tree->shards[i].tree);
+        pthread_mutex_destroy(&(tree->shards[i].lock));
     }
+    pthread_rwlock_destroy(&(tree->layout->lock));
+    free(tree->shards);
+    free(tree->splits);
+    free(tree->layout);
+    free(tree);
+}
 
-    // Insert all remaining data from tree_2:
-    while (node_2 != NULL) {
+// Inserts data in tree.
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
+//
+void *sharded_rb_tree_insert(sharded_rb_tree *tree, void *data) {
 
-        // insert node_2->data in tree /////////////////////////////////////////
-        data = node_2->data;
-        data = rb_tree_insert_max(tree, data);
-        assert(data == NULL);
-        ////////////////////////////////////////////////////////////////////////
+    rb_shard *shard;
+    void     *old_data;
+    size_t    i;
+    int       grown;
 
-        // advance node_2 //////////////////////////////////////////////////////
-        node_2 = node_2->right;
-        if (node_2 != NULL) {
-            while (node_2->left != NULL) {
-                pred_2 = node_2->left;
-                while (pred_2->right != NULL && pred_2->right != node_2) {
-                    pred_2 = pred_2->right;
-                }
-                if (pred_2->right == NULL) {
-                    pred_2->right = node_2;
-                    node_2        = node_2->left;
-                } else {
-                    pred_2->right = NULL;
-                    break;
-                }
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
+
+    // Find the shard of data:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    i = sharded_route(tree, data);
+
+    // Replacing the smallest element of a shard changes its split point:
+    if (i > 0 && tree->comp(tree->splits[i - 1], data) == 0) {
+        pthread_rwlock_unlock(&(tree->layout->lock));
+        return sharded_exclusive_update(tree, data, SHARDED_INSERT);
+    }
+
+    // Otherwise only that shard is locked:
+    shard = &(tree->shards[i]);
+    pthread_mutex_lock(&(shard->lock));
+    old_data = rb_tree_insert(shard->tree, data);
+    if (old_data == NULL) { shard->size++; }
+    grown = (shard->size > tree->limit) ? YES : NO;
+    pthread_mutex_unlock(&(shard->lock));
+    pthread_rwlock_unlock(&(tree->layout->lock));
+
+    // Rebalance the tree if the shard has grown too much (unless another
+    // thread did it in the meantime):
+    if (grown == YES) {
+        pthread_rwlock_wrlock(&(tree->layout->lock));
+        for (i = 0; i < tree->n; i++) {
+            if (tree->shards[i].size > tree->limit) {
+                sharded_rebalance(tree);
+                break;
             }
         }
-        ////////////////////////////////////////////////////////////////////////
+        pthread_rwlock_unlock(&(tree->layout->lock));
     }
 
-    // Return the resulting tree:
-    return tree;
+    return old_data;
 }
 
 
-// DEBUG & VISUALIZATION:
 
-// This is an auxiliary function to check the symmetric order property
-// recursively. You should not use it directly, use "is_rb_tree" instead.
-//
-// Note that, unlike other functions of this library, it is safe to use
-// recursive definitions here since they will only be used to test the
-// code while debugging this library.
+// SEARCH:
+
+// Returns YES if the tree is empty and NO otherwise.
 //
-static int is_rb_subtree(const rb_tree *tree, const rb_node *node,
-                         const void *min, const void *max) {
+int sharded_rb_tree_is_empty(sharded_rb_tree *tree) {
 
-    int left_height  = 0;
-    int right_height = 0;
+    int    empty = YES;
+    size_t i;
 
-    // Make sure that node is (strictly) between specified limits:
-    if (min != NULL && (tree->comp)(min, node->data) >= 0) {
-        fprintf(stderr, "ERROR: Symmetric order not satisfied in rb_tree\n");
-        return -1;
-    }
-    if (max != NULL && (tree->comp)(node->data, max) >= 0) {
-        fprintf(stderr, "ERROR: Symmetric order not satisfied in rb_tree\n");
-        return -1;
-    }
+    // Sanity check:
+    assert(tree != NULL);
 
-    // Check for RED violations:
-    if (node->color == RED) {
-        if (node->left  != NULL && node->left->color  == RED) {
-            fprintf(stderr, "ERROR: Two RED nodes in a row in rb_tree\n");
-            return -1;
-        }
-        if (node->right != NULL && node->right->color == RED) {
-            fprintf(stderr, "ERROR: Two RED nodes in a row in rb_tree\n");
-            return -1;
-        }
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    for (i = 0; i < tree->n && empty == YES; i++) {
+        pthread_mutex_lock(&(tree->shards[i].lock));
+        empty = rb_tree_is_empty(tree->shards[i].tree);
+        pthread_mutex_unlock(&(tree->shards[i].lock));
     }
+    pthread_rwlock_unlock(&(tree->layout->lock));
 
-    // Check recursively the left subtree of node:
-    if (node->left != NULL) {
-        left_height = is_rb_subtree(tree, node->left, min, node->data);
-        if (left_height == -1) { return -1; }
-    }
+    return empty;
+}
 
-    // Check recursively the right subtree of node:
-    if (node->right != NULL) {
-        right_height = is_rb_subtree(tree, node->right, node->data, max);
-        if (right_height == -1) { return -1; }
-    }
+// Returns the number of elements stored in the tree.
+//
+size_t sharded_rb_tree_size(sharded_rb_tree *tree) {
 
-    // Check for BLACK violations:
-    if (left_height != right_height) {
-        fprintf(stderr, "ERROR: Different BLACK height in rb_tree\n");
-        return -1;
+    size_t size = 0;
+    size_t i;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    for (i = 0; i < tree->n; i++) {
+        pthread_mutex_lock(&(tree->shards[i].lock));
+        size += tree->shards[i].size;
+        pthread_mutex_unlock(&(tree->shards[i].lock));
     }
-    
-    // Return Black-Height of "node":
-    if (node->color == RED){ return left_height; }
-    return left_height+1;
+    pthread_rwlock_unlock(&(tree->layout->lock));
+
+    return size;
 }
 
-// This is an auxiliary function to check the symmetric order property, the
-// RED property and the BLACK property of a red-black tree.
-// Returns YES if everything is correct and NO otherwise.
-//
-// This function should not be used in production code. I recommend to use:
-//
-//      assert(is_rb_tree(tree) == YES);
+// Searches for an element that compares "equal" to data and returns a pointer
+// to it (or NULL if there is no such element).
 //
-// To automatically remove all calls to this function when the flag NDEBUG
-// is defined in the header files (deactivating all assertions).
-//
-int is_rb_tree(const rb_tree *tree) {
+void *sharded_rb_tree_search(sharded_rb_tree *tree, const void *data) {
 
-    // Basic Sanity Checks:
-    if (tree == NULL) {
-        fprintf(stderr, "ERROR: NULL pointer to rb_tree\n");
-        return NO;
-    }
-    if (tree->comp == NULL) {
-        fprintf(stderr, "ERROR: NULL comparing function in rb_tree\n");
-        return NO;
-    }
+    rb_shard *shard;
+    void     *found;
 
-    // Trivial Case: empty tree
-    if (tree->root == NULL) { return YES; }
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-    // General Case:
-    if (is_rb_subtree(tree, tree->root, NULL, NULL) == -1) { return NO;  }
-    else                                                   { return YES; }
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    shard = &(tree->shards[sharded_route(tree, data)]);
+    pthread_mutex_lock(&(shard->lock));
+    found = rb_tree_search(shard->tree, data);
+    pthread_mutex_unlock(&(shard->lock));
+    pthread_rwlock_unlock(&(tree->layout->lock));
+
+    return found;
 }
 
-// This is an auxiliary function to print the tree recursively.
-// You should not use it directly, use "print_rb_tree" instead.
-//
-// Note that, unlike the rest of the functions of this library, it is safe
-// to use recursive definitions here since any tree large enough to hit the
-// recursion limit will be too big to be printed anyway.
+// Returns a pointer to the smallest element stored in the tree.
+// Returns NULL if the tree is empty.
 //
-static void print_rb_subtree(const rb_node *node, const int is_right,
-                             char *indent, void (* print_node) (const void *)) {
+void *sharded_rb_tree_min(sharded_rb_tree *tree) {
 
-    // Allocate memory:
-    char *new_indent = (char *) malloc((6+strlen(indent)*sizeof(char)));
-    assert(new_indent != NULL);
+    void   *found = NULL;
+    size_t  i;
 
-    // Print right subtree recursively:
-    if (node->right != NULL) {
-        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
-        else {
-            if (node->color == RED) {
-                sprintf(new_indent, "%s%s", indent, "||    ");
-            } else {
-                sprintf(new_indent, "%s%s", indent, "|     ");
-            }
-        }
-        print_rb_subtree(node->right, YES, new_indent, print_node);
-    }
+    // Sanity check:
+    assert(tree != NULL);
 
-    // Print current node:
-    if (node->color == RED) {
-        if (is_right) { fprintf(stdout, "%s/====",indent); }
-        else          { fprintf(stdout, "%s\\====",indent); }
-    } else {
-        if (is_right) { fprintf(stdout, "%s,----",indent); }
-        else          { fprintf(stdout, "%s`----",indent); }
+    // The first non-empty shard has it:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    for (i = 0; i < tree->n && found == NULL; i++) {
+        pthread_mutex_lock(&(tree->shards[i].lock));
+        found = rb_tree_min(tree->shards[i].tree);
+        pthread_mutex_unlock(&(tree->shards[i].lock));
     }
-    if (print_node == NULL)  {
-        if (node->color == RED) { fprintf(stdout, "(#)"); }
-        else                    { fprintf(stdout, "( )"); }
-    } else { print_node(node->data); }
-    fprintf(stdout, "\n");
+    pthread_rwlock_unlock(&(tree->layout->lock));
 
-    // Print left subtree recursively:
-    if (node->left != NULL) {
-        if (is_right == YES) {
-            if (node->color == RED) {
-                sprintf(new_indent, "%s%s", indent, "||    ");
-            } else {
-                sprintf(new_indent, "%s%s", indent, "|     ");
-            }
-        } else { sprintf(new_indent, "%s%s", indent, "      "); }
-        print_rb_subtree(node->left, NO, new_indent, print_node);
+    return found;
+}
+
+// Returns a pointer to the biggest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *sharded_rb_tree_max(sharded_rb_tree *tree) {
+
+    void   *found = NULL;
+    size_t  i;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    // The last non-empty shard has it:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    for (i = tree->n; i > 0 && found == NULL; i--) {
+        pthread_mutex_lock(&(tree->shards[i - 1].lock));
+        found = rb_tree_max(tree->shards[i - 1].tree);
+        pthread_mutex_unlock(&(tree->shards[i - 1].lock));
     }
+    pthread_rwlock_unlock(&(tree->layout->lock));
 
-    // Free memory:
-    free(new_indent);
+    return found;
 }
 
-// This function is used to print a red-black tree on the screen.
-//
-//  * If a "print_node" function is provided it will be used to print the
-//    content of each node.
-//  * Otherwise (if print_node is NULL) RED nodes will be printed as (#) and
-//    BLACK nodes will be printed as ( ).
-//
-// Use this latter option if you only want to take a look at the tree shape.
-//
-// A correct print_node function only prints a single line of text using
-// the "fprintf" command. It should NOT include any "\n" in that line.
-//
-// For example:
-//
-//  void MyPrintNodeFunction(const void *ptr) {
-//      MyDataStruct *d = (MyDataStruct *) ptr;     // Pointer casting
-//      fprintf(stdout, "(%d)", d->key);            // Printing integer key
-//  }
+// Find the in-order predecessor of data in the tree.
 //
-// Finally, note that this is a visualization tool for debugging purposes only.
+// If data is not in tree returns the biggest element of tree smaller than data.
+// If data is smaller or equal to all elements of tree returns NULL.
 //
-void print_rb_tree(const rb_tree *tree, void (* print_node) (const void *)) {
-
-    // Avoid the trivial cases:
-    if (tree != NULL && tree->root != NULL) {
+void *sharded_rb_tree_prev(sharded_rb_tree *tree, const void *data) {
 
-        // Print right subtree recursively:
-        if (tree->root->right != NULL) {
-            print_rb_subtree(tree->root->right, YES, "     ", print_node);
-        }
+    void   *found = NULL;
+    size_t  first;
+    size_t  i;
 
-        // Print current node:
-        if (tree->root->color == RED) { fprintf(stdout, "===="); }
-        else                          { fprintf(stdout, "----"); }
-        if (print_node == NULL) {
-            if (tree->root->color == RED) { fprintf(stdout, "(#)"); }
-            else                          { fprintf(stdout, "( )"); }
-        } else { print_node(tree->root->data); }
-        fprintf(stdout, "\n");
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-        // Print left subtree recursively:
-        if (tree->root->left != NULL) {
-            print_rb_subtree(tree->root->left, NO, "     ", print_node);
+    // Look in the shard of data and then in the previous ones:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    first = sharded_route(tree, data);
+    for (i = first + 1; i > 0 && found == NULL; i--) {
+        pthread_mutex_lock(&(tree->shards[i - 1].lock));
+        if (i - 1 == first) {
+            found = rb_tree_prev(tree->shards[i - 1].tree, data);
+        } else {
+            found = rb_tree_max(tree->shards[i - 1].tree);
         }
+        pthread_mutex_unlock(&(tree->shards[i - 1].lock));
     }
+    pthread_rwlock_unlock(&(tree->layout->lock));
 
-    // Empty the "stdout" buffer:
-    fflush(stdout);
+    return found;
 }
 
-// END OF RED BLACK TREES //////////////////////////////////////////////////////
+// Find the in-order successor of data in the tree.
+//
+// If data is not in tree returns the smallest element of tree bigger than data.
+// If data is bigger or equal to all elements of tree returns NULL.
+//
+void *sharded_rb_tree_next(sharded_rb_tree *tree, const void *data) {
 
+    void   *found = NULL;
+    size_t  first;
+    size_t  i;
 
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
+    // Look in the shard of data and then in the following ones:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    first = sharded_route(tree, data);
+    for (i = first; i < tree->n && found == NULL; i++) {
+        pthread_mutex_lock(&(tree->shards[i].lock));
+        if (i == first) { found = rb_tree_next(tree->shards[i].tree, data); }
+        else            { found = rb_tree_min(tree->shards[i].tree);        }
+        pthread_mutex_unlock(&(tree->shards[i].lock));
+    }
+    pthread_rwlock_unlock(&(tree->layout->lock));
 
+    return found;
+}
 
-// SPLAY TREES /////////////////////////////////////////////////////////////////
 
 
-// SPLAYING FUNCTIONS:
+// REMOVE:
 
-// Moves the node with "data" to the root of the splay tree.
-//
-// If data is not found moves the last node found in the search path to "data".
+// Removes a node of tree that compares "equal" to data and returns a pointer
+// to the previously stored data (so you can free it).
+// If such a node is not found, it returns a NULL pointer.
 //
-static inline void splay(sp_tree *tree, const void *data) {
+void *sharded_rb_tree_remove(sharded_rb_tree *tree, const void *data) {
 
-    sp_node  root;
-    sp_node *left;
-    sp_node *right;
-    sp_node *node;
-    sp_node *temp;
-    int      comp;
+    rb_shard *shard;
+    void     *old_data;
+    size_t    i;
 
-    // Sanity checks:
+    // Sanity Checks:
     assert(tree != NULL);
     assert(data != NULL);
 
-    // Initialize:
-    root.right = root.left = NULL;
-    left = right = &root;
-    node = tree->root;
-    if (node == NULL) { return; }
+    // Find the shard of data:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    i = sharded_route(tree, data);
 
-    for (;;) {
+    // Removing the smallest element of a shard changes its split point:
+    if (i > 0 && tree->comp(tree->splits[i - 1], data) == 0) {
+        pthread_rwlock_unlock(&(tree->layout->lock));
+        return sharded_exclusive_update(tree, data, SHARDED_REMOVE);
+    }
 
-        // Compare "data":
-        comp = (tree->comp)(data, node->data);  
+    // Otherwise only that shard is locked:
+    shard = &(tree->shards[i]);
+    pthread_mutex_lock(&(shard->lock));
+    old_data = rb_tree_remove(shard->tree, data);
+    if (old_data != NULL) { shard->size--; }
+    pthread_mutex_unlock(&(shard->lock));
+    pthread_rwlock_unlock(&(tree->layout->lock));
 
-        // If "data" is smaller:
-        if (comp < 0) {                         
-            if (node->left == NULL) { break; }
+    return old_data;
+}
 
-            // Rotate right if needed:
-            if ((tree->comp)(data, node->left->data) < 0) {
-                temp        = node->left;
-                node->left  = temp->right;
-                temp->right = node;
-                node        = temp;
-                if (node->left == NULL) { break; }
-            }
+// Removes the smallest element from tree and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+// It only locks the first shard, unless that shard is empty (then the
+// smallest element is a split point).
+//
+void *sharded_rb_tree_remove_min(sharded_rb_tree *tree) {
 
-            // Link right:
-            right->left = node;
-            right       = node;
-            node        = node->left;
+    rb_shard *shard;
+    void     *old_data = NULL;
+    int       done;
 
-        // If "data" is bigger:
-        } else if (comp > 0) {
-            if (node->right == NULL) { break; }
+    // Sanity check:
+    assert(tree != NULL);
 
-            // Rotate left if needed:
-            if ((tree->comp)(data, node->right->data) > 0) {
-                temp        = node->right;
-                node->right = temp->left;
-                temp->left  = node;
-                node        = temp;
-                if (node->right == NULL) { break; }
-            }
+    // Try the first shard:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    shard = &(tree->shards[0]);
+    pthread_mutex_lock(&(shard->lock));
+    old_data = rb_tree_remove_min(shard->tree);
+    if (old_data != NULL) { shard->size--; }
+    done = (old_data != NULL || tree->n == 1) ? YES : NO;
+    pthread_mutex_unlock(&(shard->lock));
+    pthread_rwlock_unlock(&(tree->layout->lock));
+
+    // Otherwise look for the first non-empty shard:
+    if (done == NO) {
+        old_data = sharded_exclusive_update(tree, NULL, SHARDED_REMOVE_MIN);
+    }
+    return old_data;
+}
 
-            // Link left:
-            left->right = node;
-            left        = node;
-            node        = node->right;
+// Removes the biggest element from tree and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+void *sharded_rb_tree_remove_max(sharded_rb_tree *tree) {
 
-        // If we have found "data":
-        } else { break; }
-    }
+    rb_shard *shard    = NULL;
+    void     *old_data = NULL;
+    size_t    i;
 
-    // Assemble:
-    left->right = node->left;
-    right->left = node->right;
-    node->left  = root.right;
-    node->right = root.left;
-    tree->root  = node;
+    // Sanity check:
+    assert(tree != NULL);
+
+    // Find (and lock) the last non-empty shard:
+    pthread_rwlock_rdlock(&(tree->layout->lock));
+    for (i = tree->n; i > 0 && shard == NULL; i--) {
+        pthread_mutex_lock(&(tree->shards[i - 1].lock));
+        if (rb_tree_is_empty(tree->shards[i - 1].tree) == NO) {
+            shard = &(tree->shards[i - 1]);
+        } else {
+            pthread_mutex_unlock(&(tree->shards[i - 1].lock));
+        }
+    }
+
+    // Remove its biggest element unless it is also its smallest one (which
+    // is a split point, except in the first shard):
+    if (shard != NULL) {
+        if (shard == &(tree->shards[0]) ||
+            rb_tree_min(shard->tree) != rb_tree_max(shard->tree)) {
+            old_data = rb_tree_remove_max(shard->tree);
+            shard->size--;
+        }
+        pthread_mutex_unlock(&(shard->lock));
+    }
+    pthread_rwlock_unlock(&(tree->layout->lock));
+
+    // Otherwise the split points change:
+    if (shard != NULL && old_data == NULL) {
+        old_data = sharded_exclusive_update(tree, NULL, SHARDED_REMOVE_MAX);
+    }
+    return old_data;
 }
 
-// Moves the node with the smallest element to the root of the splay tree.
+// Removes all the elements from the tree in linear time (see
+// "rb_tree_remove_all" for the meaning of free_data). The shards themselves
+// are kept, so the tree can be used again.
 //
-static inline void splay_left(sp_tree *tree) {
+void sharded_rb_tree_remove_all(sharded_rb_tree *tree,
+                                void (* free_data) (void *)) {
 
-    sp_node  root;
-    sp_node *right;
-    sp_node *node;
-    sp_node *temp;
+    size_t i;
 
     // Sanity check:
     assert(tree != NULL);
 
-    // Initialize:
-    root.right = root.left = NULL;
-    right = &root;
-    node = tree->root;
-    if (node == NULL) { return; }
+    pthread_rwlock_wrlock(&(tree->layout->lock));
+    for (i = 0; i < tree->n; i++) {
+        rb_tree_remove_all(tree->shards[i].tree, free_data);
+        tree->shards[i].size = 0;
+        tree->splits[i]      = NULL;
+    }
+    tree->limit = 2 * SHARDED_MIN_SIZE;
+    pthread_rwlock_unlock(&(tree->layout->lock));
+}
 
-    for (;;) {
-        
-        // Act as if splaying "data" which is always smaller
-        if (node->left == NULL) { break; }
 
-        // Rotate right:
-        temp        = node->left;
-        node->left  = temp->right;
-        temp->right = node;
-        node        = temp;
-        if (node->left == NULL) { break; }
 
-        // Link right:
-        right->left = node;
-        right       = node;
-        node        = node->left;
+// SET FUNCTIONS:
+
+// This is an auxiliary function that merges tree_1 and tree_2 into a new
+// sharded_rb_tree keeping the elements given by "keep" (see SHARDED_KEEP_1,
+// SHARDED_KEEP_2 and SHARDED_KEEP_BOTH). The new tree has as many shards as
+// tree_1 and takes its comparing function.
+//
+// Both trees are locked whole while they are merged (always in the same order
+// to avoid deadlocks). The new tree is built in its first shard with
+// "rb_tree_insert_max" and then rebalanced, so it takes
+// O( MAX{ |tree_1|+|tree_2|, |Result|·Log(|Result|) } ) time.
+//
+static sharded_rb_tree *sharded_set_op(sharded_rb_tree *tree_1,
+                                       sharded_rb_tree *tree_2, int keep) {
+
+    sharded_rb_tree *tree;
+    sharded_walker   walker_1;
+    sharded_walker   walker_2;
+    rb_node         *node_1;
+    rb_node         *node_2;
+    rb_tree         *out;
+    void            *data;
+    int              comp;
+
+    // Sanity checks:
+    assert(tree_1 != NULL);
+    assert(tree_2 != NULL);
+
+    // Create a new tree:
+    tree = new_sharded_rb_tree(tree_1->comp, tree_1->n);
+    if (tree == NULL) { return NULL; }
+    out = tree->shards[0].tree;
+
+    // Lock both trees:
+    if ((uintptr_t) tree_1 <= (uintptr_t) tree_2) {
+        sharded_lock_all(tree_1);
+        if (tree_2 != tree_1) { sharded_lock_all(tree_2); }
+    } else {
+        sharded_lock_all(tree_2);
+        sharded_lock_all(tree_1);
     }
 
-    // Assemble:
-    right->left = node->right;
-    node->right = root.left;
-    tree->root  = node;
+    // Merge them:
+    node_1 = sharded_walker_first(&walker_1, tree_1);
+    node_2 = sharded_walker_first(&walker_2, tree_2);
+    while (node_1 != NULL || node_2 != NULL) {
+
+        // Compare both nodes (an exhausted tree is bigger than anything):
+        if      (node_1 == NULL) { comp = +1; }
+        else if (node_2 == NULL) { comp = -1; }
+        else { comp = tree_1->comp(node_1->data, node_2->data); }
+
+        // Keep the smallest element (if needed) and advance:
+        data = NULL;
+        if (comp < 0) {
+            if (keep & SHARDED_KEEP_1)    { data = node_1->data; }
+            node_1 = sharded_walker_next(&walker_1);
+        } else if (comp > 0) {
+            if (keep & SHARDED_KEEP_2)    { data = node_2->data; }
+            node_2 = sharded_walker_next(&walker_2);
+        } else {
+            if (keep & SHARDED_KEEP_BOTH) { data = node_1->data; }
+            node_1 = sharded_walker_next(&walker_1);
+            node_2 = sharded_walker_next(&walker_2);
+        }
+        if (data != NULL) {
+            data = rb_tree_insert_max(out, data);
+            assert(data == NULL);
+            tree->shards[0].size++;
+        }
+    }
+
+    // Unlock both trees:
+    if (tree_2 != tree_1) { sharded_unlock_all(tree_2); }
+    sharded_unlock_all(tree_1);
+
+    // Spread the result among the shards (nobody else knows about it yet):
+    sharded_rebalance(tree);
+
+    return tree;
 }
 
-// Moves the node with the biggest element to the root of the splay tree.
+// Returns a new sharded_rb_tree containing the union of tree_1 and tree_2
+// (see "rb_tree_union"). It does NOT modify tree_1 or tree_2.
 //
-static inline void splay_right(sp_tree *tree) {
+sharded_rb_tree *sharded_rb_tree_union(sharded_rb_tree *tree_1,
+                                       sharded_rb_tree *tree_2) {
+    return sharded_set_op(tree_1, tree_2, SHARDED_KEEP_1 | SHARDED_KEEP_2 |
+                                          SHARDED_KEEP_BOTH);
+}
 
-    sp_node  root;
-    sp_node *left;
-    sp_node *node;
-    sp_node *temp;
+// Returns a new sharded_rb_tree containing the intersection of tree_1 and
+// tree_2 (see "rb_tree_intersection"). It does NOT modify tree_1 or tree_2.
+//
+sharded_rb_tree *sharded_rb_tree_intersection(sharded_rb_tree *tree_1,
+                                              sharded_rb_tree *tree_2) {
+    return sharded_set_op(tree_1, tree_2, SHARDED_KEEP_BOTH);
+}
 
-    // Sanity check:
-    assert(tree != NULL);
+// Returns a new sharded_rb_tree containing the difference tree_1 - tree_2
+// (see "rb_tree_diff"). It does NOT modify tree_1 or tree_2.
+//
+sharded_rb_tree *sharded_rb_tree_diff(sharded_rb_tree *tree_1,
+                                      sharded_rb_tree *tree_2) {
+    return sharded_set_op(tree_1, tree_2, SHARDED_KEEP_1);
+}
 
-    // Initialize:
-    root.right = root.left = NULL;
-    left = &root;
-    node = tree->root;
-    if (node == NULL) { return; }
+// Returns a new sharded_rb_tree containing the symmetric difference of tree_1
+// and tree_2 (see "rb_tree_sym_diff"). It does NOT modify tree_1 or tree_2.
+//
+sharded_rb_tree *sharded_rb_tree_sym_diff(sharded_rb_tree *tree_1,
+                                          sharded_rb_tree *tree_2) {
+    return sharded_set_op(tree_1, tree_2, SHARDED_KEEP_1 | SHARDED_KEEP_2);
+}
 
-    for (;;) {
-        
-        // Act as if splaying "data" which is always bigger
-        if (node->right == NULL) { break; }
 
-        // Rotate left:
-        temp        = node->right;
-        node->right = temp->left;
-        temp->left  = node;
-        node        = temp;
-        if (node->right == NULL) { break; }
 
-        // Link left:
-        left->right = node;
-        left        = node;
-        node        = node->right;
-    }
+// REBALANCE:
 
-    // Assemble:
-    left->right = node->left;
-    node->left  = root.right;
-    tree->root  = node;
+// Moves the split points of the tree so that every shard holds the same
+// number of elements. The tree does it by itself whenever a shard grows
+// beyond twice the average size, but you may want to call it after removing
+// many elements from the same range. It stops all the other threads while it
+// runs (see "sharded_rebalance" for its cost).
+//
+void sharded_rb_tree_rebalance(sharded_rb_tree *tree) {
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    pthread_rwlock_wrlock(&(tree->layout->lock));
+    sharded_rebalance(tree);
+    pthread_rwlock_unlock(&(tree->layout->lock));
 }
 
 
 
-// CREATION & INSERTION:
+// DEBUG & VISUALIZATION:
 
-// Returns a pointer to a newly created sp_tree.
-// You must provide a comparing function "comp" such that:
-//  * comp(A,B) = 0  if and only if  A = B
-//  * comp(A,B) > 0  if and only if  A > B
-//  * comp(A,B) < 0  if and only if  A < B
-//
-// I recommend to limit the output of the "comp" function to {-1, 0, 1} as in:
+// This is an auxiliary function to check that every shard is a correct rb_tree
+// that holds the right range of elements (and knows its own size), and that
+// the split points are correct. Returns YES if everything is correct and NO
+// otherwise.
 //
-//  int MyComp(const void *ptr1, const void *ptr2) {
-//      MyData *d1 = (MyData *) ptr1;
-//      MyData *d2 = (MyData *) ptr2;
-//      if      (d1->key < d2->key) { return -1; }
-//      else if (d1->key > d2->key) { return +1; }
-//      else                        { return  0; }
-//  }
+// This function should not be used in production code. I recommend to use:
 //
-// However, the code does not assume that so, if you are working with simple
-// numeric keys, you can just use something like:
+//      assert(is_sharded_rb_tree(tree) == YES);
 //
-//  int MyComp(const void *ptr1, const void *ptr2) {
-//      MyData *d1 = (MyData *) ptr1;
-//      MyData *d2 = (MyData *) ptr2;
-//      return (int) ((d1->key) - (d2->key));
-//  }
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
 //
-sp_tree *new_sp_tree(int (* comp) (const void *, const void *)) {
+int is_sharded_rb_tree(sharded_rb_tree *tree) {
 
-    // Sanity check:
-    assert(comp != NULL);
+    rb_walker  walker;
+    rb_node   *node;
+    rb_tree   *part;
+    void      *split = NULL;
+    size_t     size;
+    size_t     i;
+    int        result = YES;
 
-    // Allocate memory:
-    sp_tree *tree = (sp_tree *) malloc(sizeof(sp_tree));
+    // Basic Sanity Checks:
     if (tree == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate memory for sp_tree\n");
+        fprintf(stderr, "ERROR: NULL pointer to sharded_rb_tree\n");
+        return NO;
+    }
+    if (tree->comp == NULL || tree->n == 0) {
+        fprintf(stderr, "ERROR: Wrong parameters in sharded_rb_tree\n");
+        return NO;
     }
 
-    // Initialize the empty tree:
-    else {
-        tree->root = NULL;
-        tree->comp = comp;
+    // Check the shards from right to left (with nobody else around):
+    pthread_rwlock_wrlock(&(tree->layout->lock));
+    for (i = tree->n; i > 0 && result == YES; i--) {
+
+        // Every shard is a rb_tree with the same comparing function:
+        part = tree->shards[i - 1].tree;
+        if (part->comp != tree->comp) {
+            fprintf(stderr, "ERROR: Wrong comparing function in shard\n");
+            result = NO;
+            break;
+        }
+        if (is_rb_tree(part) == NO) { result = NO; break; }
+
+        // All its elements are smaller than the following split point:
+        size = 0;
+        node = rb_walker_first(&walker, part->root);
+        while (node != NULL && result == YES) {
+            if (split != NULL && tree->comp(node->data, split) >= 0) {
+                fprintf(stderr, "ERROR: Element out of its shard range\n");
+                result = NO;
+            }
+            size++;
+            node = rb_walker_next(&walker);
+        }
+        if (result == YES && size != tree->shards[i - 1].size) {
+            fprintf(stderr, "ERROR: Wrong number of elements in shard\n");
+            result = NO;
+        }
+
+        // The split point of the shard is its smallest element (if any):
+        if (size > 0) { split = rb_tree_min(part); }
+        if (result == YES && i > 1 && tree->splits[i - 2] != split) {
+            fprintf(stderr, "ERROR: Wrong split point in sharded_rb_tree\n");
+            result = NO;
+        }
     }
+    pthread_rwlock_unlock(&(tree->layout->lock));
 
-    return tree;
+    return result;
 }
 
-// Returns a (really degenerated) splay tree containing a copy of tree.
-// It does NOT modify the content of tree but can modify its shape.
+// This function is used to print a sharded_rb_tree on the screen, one shard
+// after the other (see "print_rb_tree").
 //
-// Takes O(|Tree|) time.
+// Again, this is a visualization tool for debugging purposes only.
 //
-sp_tree *sp_tree_copy(sp_tree *tree) {
+void print_sharded_rb_tree(sharded_rb_tree *tree,
+                           void (* print_node) (const void *)) {
 
-    sp_tree *new_tree;
-    void    *data;
-    
-    // Sanity check:
-    assert(tree != NULL);
-    
-    // Create a new tree:
-    new_tree = new_sp_tree(tree->comp);
-    if (tree == NULL) { return NULL; }
+    size_t i;
 
-    // Get the smallest element of tree:
-    data = sp_tree_min(tree);
+    // Avoid the trivial case:
+    if (tree == NULL) { return; }
 
-    // Insert all data from tree into new_tree:
-    while (data != NULL) {
+    sharded_lock_all(tree);
+    for (i = 0; i < tree->n; i++) {
+        printf("Shard %lu (%lu elements):\n", (unsigned long) i,
+               (unsigned long) tree->shards[i].size);
+        print_rb_tree(tree->shards[i].tree, print_node);
+    }
+    sharded_unlock_all(tree);
+}
 
-        // insert data in new_tree:
-        sp_tree_insert_max(new_tree, data);
+#endif
 
-        // advance data:
-        data = sp_tree_next(tree, data);
-    }
+// END OF SHARDED TREES ////////////////////////////////////////////////////////
 
-    // Return the resulting tree:
-    return new_tree;
-}
 
-// Inserts data in tree.
-//
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
-//
-void *sp_tree_insert(sp_tree *tree, void *data) {
 
-    sp_node *old_root;
-    void    *old_data;
-    int      comp = 1;
+// CONCURRENT TREES ////////////////////////////////////////////////////////////
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+#ifdef RB_THREADS
 
-    // Trivial case: Empty tree
-    if (tree->root == NULL) {
-        tree->root = (sp_node *) malloc(sizeof(sp_node));
-        if (tree->root == NULL) {
-            fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
-        } else {
-            tree->root->data  = data;
-            tree->root->left  = NULL;
-            tree->root->right = NULL;
-        }
-        return NULL;
-    }
+// Number of reader counters of each epoch (every thread picks one from the
+// address of its stack, so threads rarely share the same cache line):
+#define CONCURRENT_STRIPES      16
 
-    // General case: Splay data to the root
-    splay(tree, data);
-    old_root = tree->root;
+// Failed optimistic attempts before a reader takes the lock of the writers:
+#define CONCURRENT_MAX_RETRIES  16
 
-    // Compare the current root with data:
-    if (old_root != NULL) { comp = (tree->comp)(data, old_root->data); }
+// Queries answered by "concurrent_read":
+#define CONCURRENT_SEARCH       0
+#define CONCURRENT_MIN          1
+#define CONCURRENT_MAX          2
+#define CONCURRENT_PREV         3
+#define CONCURRENT_NEXT         4
 
-    // If data is in the tree: overwrite it!
-    if (comp == 0) {
-        old_data = tree->root->data;
-        tree->root->data = data;
-        return old_data;
-    }
+// Reads a word that a writer may be changing at the same time:
+#define CONCURRENT_LOAD(x)      __atomic_load_n(&(x), __ATOMIC_RELAXED)
 
-    // Otherwise insert a new node as a root and link the previous root to it:
-    tree->root = (sp_node *) malloc(sizeof(sp_node));
-    if (tree->root == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
-        tree->root = old_root;
-    } else {
-        tree->root->data  = data;
-        if (comp > 0) {
-            tree->root->left  = old_root;
-            tree->root->right = old_root->right;
-            old_root->right   = NULL;
-        } else {
-            tree->root->right = old_root;
-            tree->root->left  = old_root->left;
-            old_root->left    = NULL;
-        }
-    }
+// Each reader counter lives in its own cache line:
+typedef struct concurrent_counter {
+    unsigned long count;                            // Readers inside
+    char          pad[64 - sizeof(unsigned long)];  // Padding
+} concurrent_counter;
 
-    // Data was not here!
-    return NULL;
-}
+// The reader counters of both epochs (even & odd):
+typedef struct concurrent_readers {
+    concurrent_counter epochs[2][CONCURRENT_STRIPES];
+} concurrent_readers;
 
-// Inserts "data" such that "data" is smaller or equal to any other "data"
-// already in the tree. It is slightly faster than a regular insert because it
-// makes at most one comparison.
-//
-// WARNING: If you use this function to insert data that is strictly bigger than
-//          something already in the tree you will break the tree!
-//
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
+
+// AUXILIARY FUNCTIONS:
+
+// Returns the left child of node as seen by a reader (see RB_LEFT).
 //
-void *sp_tree_insert_min(sp_tree *tree, void *data) {
+static inline rb_node *concurrent_left(rb_node *node) {
+#ifdef RB_PACKED_COLOR
+    return (rb_node *) ((uintptr_t) CONCURRENT_LOAD(node->left) &
+                        ~(uintptr_t) 1);
+#else
+    return CONCURRENT_LOAD(node->left);
+#endif
+}
 
-    sp_node *old_root;
-    void    *old_data;
-    int      comp = 1;
-    
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+// Registers the calling thread as a reader of the current epoch and returns
+// the counter where it did so (to be given to "concurrent_exit").
+//
+static unsigned long *concurrent_enter(concurrent_rb_tree *tree) {
+
+    unsigned long *count;
+    unsigned long  epoch;
+    uintptr_t      stripe;
+
+    // Threads have their stacks in different pages:
+    stripe = (uintptr_t) &epoch >> 12;
+    stripe = (stripe ^ (stripe >> 7) ^ (stripe >> 11)) % CONCURRENT_STRIPES;
+
+    // Retry if a writer started a new epoch before we were counted:
+    while (1) {
+        epoch = __atomic_load_n(&(tree->epoch), __ATOMIC_SEQ_CST);
+        count = &(tree->readers->epochs[epoch & 1][stripe].count);
+        __atomic_fetch_add(count, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&(tree->epoch), __ATOMIC_SEQ_CST) == epoch) {
+            return count;
+        }
+        __atomic_fetch_sub(count, 1, __ATOMIC_SEQ_CST);
+    }
+}
 
-    // General case: Splay data to the root
-    splay_left(tree);
-    old_root = tree->root;
+// Unregisters a reader (see "concurrent_enter").
+//
+static inline void concurrent_exit(unsigned long *count) {
+    __atomic_fetch_sub(count, 1, __ATOMIC_RELEASE);
+}
 
-    // Compare the current root with data:
-    if (old_root != NULL) { comp = (tree->comp)(data, old_root->data); }
+// Starts a new epoch and waits until every reader of the previous one has
+// left, so nobody can be looking at the elements removed before the call.
+// The caller must hold the lock of the writers.
+//
+static void concurrent_synchronize(concurrent_rb_tree *tree) {
 
-    // If data is in the tree: overwrite it!
-    if (comp == 0) {
-        old_data = tree->root->data;
-        tree->root->data = data;
-        return old_data;
-    }
+    unsigned long epoch = tree->epoch;
+    size_t        i;
 
-    // Otherwise insert a new node as a root and link the previous root to it:
-    tree->root = (sp_node *) malloc(sizeof(sp_node));
-    if (tree->root == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
-        tree->root = old_root;
-    } else {
-        tree->root->data  = data;
-        tree->root->left  = NULL;
-        tree->root->right = old_root;
+    __atomic_store_n(&(tree->epoch), epoch + 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        while (__atomic_load_n(&(tree->readers->epochs[epoch & 1][i].count),
+                               __ATOMIC_ACQUIRE) != 0) {
+            sched_yield();
+        }
     }
+}
 
-    // Data was not here!
-    return NULL;
+// Marks the beginning of a change of the tree (the sequence number becomes
+// odd). The caller must hold the lock of the writers.
+//
+static inline void concurrent_write_begin(concurrent_rb_tree *tree) {
+    __atomic_store_n(&(tree->seq), tree->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
 }
 
-// Inserts "data" such that "data" is bigger or equal to any other "data"
-// already in the tree. It is slightly faster than a regular insert because it
-// makes at most one comparison.
+// Marks the end of a change of the tree (the sequence number becomes even).
 //
-// WARNING: If you use this function to insert data that is strictly smaller
-//          than something already in the tree you will break the tree!
+static inline void concurrent_write_end(concurrent_rb_tree *tree) {
+    __atomic_store_n(&(tree->seq), tree->seq + 1, __ATOMIC_RELEASE);
+}
+
+// Answers "query" (see CONCURRENT_SEARCH & co.) without taking any lock.
 //
-// If a node of the tree compares "equal" to data it will get replaced and a
-// pointer to the previously stored data will be returned (so you can free it),
-// otherwise it will simply return a NULL pointer.
+// Returns YES and leaves the answer in found if no writer changed the tree
+// while it was running, or NO if the caller must try again. Every element is
+// validated against the sequence number before it is compared, so we never
+// follow a pointer that a writer was changing.
 //
-void *sp_tree_insert_max(sp_tree *tree, void *data) {
+static int concurrent_try_read(concurrent_rb_tree *tree, const void *data,
+                               int query, void **found) {
 
-    sp_node *old_root;
-    void    *old_data;
-    int      comp = 1;
-    
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
+    rb_node       *node;
+    void          *node_data;
+    unsigned long  seq;
+    int            comp;
 
-    // General case: Splay data to the root
-    splay_right(tree);
-    old_root = tree->root;
+    // Wait for the writer (if any) to finish:
+    seq = __atomic_load_n(&(tree->seq), __ATOMIC_ACQUIRE);
+    if (seq & 1) { return NO; }
 
-    // Compare the current root with data:
-    if (old_root != NULL) { comp = (tree->comp)(data, old_root->data); }
+    *found = NULL;
+    node   = CONCURRENT_LOAD(tree->tree->root);
+    while (node != NULL) {
 
-    // If data is in the tree: overwrite it!
-    if (comp == 0) {
-        old_data = tree->root->data;
-        tree->root->data = data;
-        return old_data;
-    }
+        // Make sure that node was still in the tree when we read it:
+        node_data = CONCURRENT_LOAD(node->data);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (CONCURRENT_LOAD(tree->seq) != seq) { return NO; }
 
-    // Otherwise insert a new node as a root and link the previous root to it:
-    tree->root = (sp_node *) malloc(sizeof(sp_node));
-    if (tree->root == NULL) {
-        fprintf(stderr, "ERROR: Unable to allocate sp_node\n");
-        tree->root = old_root;
-    } else {
-        tree->root->data  = data;
-        tree->root->left  = old_root;
-        tree->root->right = NULL;
+        // Go down (keeping the best candidate so far):
+        if      (query == CONCURRENT_MIN) { comp = -1; }
+        else if (query == CONCURRENT_MAX) { comp = +1; }
+        else    { comp = tree->tree->comp(data, node_data); }
+        if (comp == 0) {
+            if (query == CONCURRENT_SEARCH) {
+                *found = node_data;
+                return YES;
+            }
+            comp = (query == CONCURRENT_PREV) ? -1 : +1;
+        }
+        if (comp < 0) {
+            if (query == CONCURRENT_MIN || query == CONCURRENT_NEXT) {
+                *found = node_data;
+            }
+            node = concurrent_left(node);
+        } else {
+            if (query == CONCURRENT_MAX || query == CONCURRENT_PREV) {
+                *found = node_data;
+            }
+            node = CONCURRENT_LOAD(node->right);
+        }
     }
 
-    // Data was not here!
-    return NULL;
+    // The last (NULL) child must also be validated:
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (CONCURRENT_LOAD(tree->seq) == seq) ? YES : NO;
 }
 
-
-
-// SEARCH:
-
-// Returns YES if the tree is empty and NO otherwise.
+// Answers "query" (see CONCURRENT_SEARCH & co.) for the public functions.
 //
-int sp_tree_is_empty(const sp_tree *tree) {
+static void *concurrent_read(concurrent_rb_tree *tree, const void *data,
+                             int query) {
+
+    unsigned long *count;
+    void          *found = NULL;
+    int            i;
 
     // Sanity check:
     assert(tree != NULL);
 
-    // Check if there is at least 1 node in the tree:
-    if (tree->root == NULL) { return YES; }
-    else                    { return NO;  }
+    // Optimistic attempts:
+    count = concurrent_enter(tree);
+    for (i = 0; i < CONCURRENT_MAX_RETRIES; i++) {
+        if (concurrent_try_read(tree, data, query, &found) == YES) {
+            concurrent_exit(count);
+            return found;
+        }
+    }
+    concurrent_exit(count);
+
+    // Too many writers around, so wait for our turn (nobody else can change
+    // the tree now, so this attempt always succeeds):
+    pthread_mutex_lock(&(tree->lock));
+    concurrent_try_read(tree, data, query, &found);
+    pthread_mutex_unlock(&(tree->lock));
+
+    return found;
 }
 
-// Finds a node that compares "equal" to data. Returns NULL if not found.
+// Updates the number of elements of tree (the caller must hold the lock of
+// the writers).
 //
-void *sp_tree_search(sp_tree *tree, const void *data) {
+static inline void concurrent_set_size(concurrent_rb_tree *tree,
+                                       size_t size) {
+    __atomic_store_n(&(tree->size), size, __ATOMIC_RELAXED);
+}
 
-    // Sanity Checks:
-    assert(tree != NULL);
-    assert(data != NULL);
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
 
-    // General case: Splay data to the root
-    splay(tree, data);
+// CREATION & INSERTION:
 
-    // If data is in the tree return a pointer to it:
-    if ((tree->comp)(data, tree->root->data) == 0) { return tree->root->data; }
+// Returns a pointer to a new empty concurrent_rb_tree (or NULL if there is not
+// enough memory). Its nodes will be taken from a node pool.
+//
+// The comparing function must satisfy the same rules as in "new_rb_tree" and
+// it must be thread-safe.
+//
+concurrent_rb_tree *new_concurrent_rb_tree(int (* comp) (const void *,
+                                                         const void *)) {
 
-    // Not found:
-    return NULL;
-}
+    concurrent_rb_tree *tree;
 
-// Returns a pointer to the smallest element stored in the tree.
-// Returns NULL if the tree is empty.
-//
-void *sp_tree_min(sp_tree *tree) {
+    // Sanity check:
+    assert(comp != NULL);
 
-    // Sanity Check:
-    assert(tree != NULL);
+    // Allocate memory:
+    tree = (concurrent_rb_tree *) malloc(sizeof(concurrent_rb_tree));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate concurrent_rb_tree\n");
+        return NULL;
+    }
+    tree->tree    = new_rb_tree_with_pool(comp, POOL_MIN_SLAB_SIZE);
+    tree->readers = (concurrent_readers *) calloc(1,
+                                                  sizeof(concurrent_readers));
+    if (tree->tree == NULL || tree->readers == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate concurrent_rb_tree\n");
+        free(tree->tree);
+        free(tree->readers);
+        free(tree);
+        return NULL;
+    }
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
+    // Initialize the rest of the tree:
+    pthread_mutex_init(&(tree->lock), NULL);
+    tree->size  = 0;
+    tree->seq   = 0;
+    tree->epoch = 0;
 
-    // General case: Move the smallest element to the root
-    splay_left(tree);
+    return tree;
+}
 
-    // And return a pointer to its data:
-    return tree->root->data;
+// Releases all the memory of tree (but not the data of its elements, so call
+// "concurrent_rb_tree_remove_all" first if you need to free it). No other
+// thread may be using the tree.
+//
+void free_concurrent_rb_tree(concurrent_rb_tree *tree) {
+
+    // Avoid the trivial case:
+    if (tree == NULL) { return; }
+
+    rb_tree_remove_all(tree->tree, NULL);
+    pthread_mutex_destroy(&(tree->lock));
+    free(tree->tree);
+    free(tree->readers);
+    free(tree);
 }
 
-// Returns a pointer to the biggest element stored in "tree".
-// Returns NULL if the tree is empty.
+// Returns a regular rb_tree with the same elements as tree (or NULL if there
+// is not enough memory). The writers wait while it runs, but the readers do
+// not (see "rb_tree_copy").
 //
-void *sp_tree_max(sp_tree *tree) {
+rb_tree *concurrent_rb_tree_copy(concurrent_rb_tree *tree) {
 
-    // Sanity Check:
-    assert(tree != NULL);
+    rb_tree *copy;
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
+    // Sanity check:
+    assert(tree != NULL);
 
-    // General case: Move the biggest element to the root
-    splay_right(tree);
+    pthread_mutex_lock(&(tree->lock));
+    copy = rb_tree_copy(tree->tree);
+    pthread_mutex_unlock(&(tree->lock));
 
-    // And return a pointer to its data:
-    return tree->root->data;
+    return copy;
 }
 
-// Find the in-order predesor of data in the tree.
+// Inserts data in tree.
 //
-// If data is not in tree returns the biggest element of tree smaller than data.
-// If data is smaller or equal to all elements of tree returns NULL.
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (so you can free it),
+// otherwise it will simply return a NULL pointer.
 //
-void *sp_tree_prev(sp_tree *tree, const void *data) {
+void *concurrent_rb_tree_insert(concurrent_rb_tree *tree, void *data) {
 
-    sp_node *old_root;
-    int      comp;
+    void *old_data;
 
     // Sanity Checks:
     assert(tree != NULL);
     assert(data != NULL);
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
+    pthread_mutex_lock(&(tree->lock));
+    concurrent_write_begin(tree);
+    old_data = rb_tree_insert(tree->tree, data);
+    concurrent_write_end(tree);
 
-    // Trivial case: null data == return maximum
-    if (data == NULL) {
-        splay_right(tree);
-        return tree->root->data;
-    }
+    // Nobody may be using the replaced element when we return it:
+    if (old_data == NULL) { concurrent_set_size(tree, tree->size + 1); }
+    else                  { concurrent_synchronize(tree); }
+    pthread_mutex_unlock(&(tree->lock));
 
-    // General case: Splay data to the root
-    splay(tree, data);
+    return old_data;
+}
 
-    // Take a look at the current root:
-    comp = (tree->comp)(tree->root->data, data);
 
-    // If its bigger or equal we must find the predecessor in the left subtree:    
-    if (comp >= 0) {
-        if (tree->root->left == NULL) { return NULL; }
-        else {
-            old_root   = tree->root;
-            tree->root = tree->root->left;
-            old_root->left = NULL;
-            splay_right(tree);
-            tree->root->right = old_root;
-        }
-    }
 
-    // Predecessor is at root now:
-    return tree->root->data;
-}
+// SEARCH:
 
-// Find the in-order successor of data in the tree.
-//
-// If data is not in tree returns the smallest element of tree bigger than data.
-// If data is bigger or equal to all elements of tree returns NULL.
+// Returns YES if the tree is empty and NO otherwise (without locks).
 //
-void *sp_tree_next(sp_tree *tree, const void *data) {
+int concurrent_rb_tree_is_empty(concurrent_rb_tree *tree) {
 
-    sp_node *old_root;
-    int      comp;
+    // Sanity check:
+    assert(tree != NULL);
 
-    // Sanity Checks:
+    return (CONCURRENT_LOAD(tree->tree->root) == NULL) ? YES : NO;
+}
+
+// Returns the number of elements stored in the tree (without locks).
+//
+size_t concurrent_rb_tree_size(concurrent_rb_tree *tree) {
+
+    // Sanity check:
     assert(tree != NULL);
+
+    return CONCURRENT_LOAD(tree->size);
+}
+
+// Searches for an element that compares "equal" to data and returns a pointer
+// to it (or NULL if there is no such element). It takes no locks unless the
+// writers keep it from finishing several times in a row.
+//
+void *concurrent_rb_tree_search(concurrent_rb_tree *tree, const void *data) {
+
+    // Sanity check:
     assert(data != NULL);
 
-    // Trivial case: empty tree
-    if (tree->root == NULL) { return NULL; }
+    return concurrent_read(tree, data, CONCURRENT_SEARCH);
+}
 
-    // Trivial case: null data == return minimum
-    if (data == NULL) {
-        splay_left(tree);
-        return tree->root->data;
-    }
+// Returns a pointer to the smallest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *concurrent_rb_tree_min(concurrent_rb_tree *tree) {
+    return concurrent_read(tree, NULL, CONCURRENT_MIN);
+}
 
-    // General case: Splay data to the root
-    splay(tree, data);
+// Returns a pointer to the biggest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *concurrent_rb_tree_max(concurrent_rb_tree *tree) {
+    return concurrent_read(tree, NULL, CONCURRENT_MAX);
+}
 
-    // Take a look at the current root:
-    comp = (tree->comp)(tree->root->data, data);
+// Returns a pointer to the biggest element of tree smaller than data (or NULL
+// if there is no such element). Data does not need to be in the tree.
+//
+void *concurrent_rb_tree_prev(concurrent_rb_tree *tree, const void *data) {
 
-    // If its smaller or equal we must find the successor in the right subtree:
-    if (comp <= 0) {
-        if (tree->root->right == NULL) { return NULL; }
-        else {
-            old_root   = tree->root;
-            tree->root = tree->root->right;
-            old_root->right = NULL;
-            splay_left(tree);
-            tree->root->left = old_root;
-        }
-    }
+    // Sanity check:
+    assert(data != NULL);
 
-    // Predecessor is at root now:
-    return tree->root->data;
+    return concurrent_read(tree, data, CONCURRENT_PREV);
+}
+
+// Returns a pointer to the smallest element of tree bigger than data (or NULL
+// if there is no such element). Data does not need to be in the tree.
+//
+void *concurrent_rb_tree_next(concurrent_rb_tree *tree, const void *data) {
+
+    // Sanity check:
+    assert(data != NULL);
+
+    return concurrent_read(tree, data, CONCURRENT_NEXT);
 }
 
 
@@ -5023,548 +15530,971 @@ void *sp_tree_next(sp_tree *tree, const void *data) {
 // to the previously stored data (so you can free it).
 // If such a node is not found, it returns a NULL pointer.
 //
-void *sp_tree_remove(sp_tree *tree, const void *data) {
+void *concurrent_rb_tree_remove(concurrent_rb_tree *tree, const void *data) {
 
-    sp_node *old_root;
-    void    *old_data = NULL;
+    void *old_data;
 
     // Sanity Checks:
     assert(tree != NULL);
     assert(data != NULL);
 
-    // Avoid trivial case: empty tree
-    if (tree->root != NULL) {
+    pthread_mutex_lock(&(tree->lock));
+    concurrent_write_begin(tree);
+    old_data = rb_tree_remove(tree->tree, data);
+    concurrent_write_end(tree);
+    if (old_data != NULL) {
+        concurrent_set_size(tree, tree->size - 1);
+        concurrent_synchronize(tree);
+    }
+    pthread_mutex_unlock(&(tree->lock));
 
-        // Splay the data to the root:
-        splay(tree, data);
+    return old_data;
+}
 
-        // If it is here: remove it!
-        if ((tree->comp)(tree->root->data, data) == 0) {
-            old_root = tree->root;
-            old_data = tree->root->data;
-            if (tree->root->right == NULL) { tree->root = tree->root->left; }
-            else {
-                tree->root = tree->root->right;
-                splay_left(tree);
-                tree->root->left = old_root->left;
-            }
-            free(old_root);
-        }
+// Removes the smallest element from tree and returns a pointer to its data
+// (so you can free it). If the tree is empty returns a NULL pointer.
+//
+void *concurrent_rb_tree_remove_min(concurrent_rb_tree *tree) {
+
+    void *old_data;
+
+    // Sanity check:
+    assert(tree != NULL);
+
+    pthread_mutex_lock(&(tree->lock));
+    concurrent_write_begin(tree);
+    old_data = rb_tree_remove_min(tree->tree);
+    concurrent_write_end(tree);
+    if (old_data != NULL) {
+        concurrent_set_size(tree, tree->size - 1);
+        concurrent_synchronize(tree);
     }
+    pthread_mutex_unlock(&(tree->lock));
 
-    // Return
     return old_data;
 }
 
-// Removes the smallest element from "tree" and returns a pointer to its data
+// Removes the biggest element from tree and returns a pointer to its data
 // (so you can free it). If the tree is empty returns a NULL pointer.
 //
-void *sp_tree_remove_min(sp_tree *tree) {
+void *concurrent_rb_tree_remove_max(concurrent_rb_tree *tree) {
 
-    sp_node *old_root;
-    void    *old_data;
+    void *old_data;
 
     // Sanity check:
     assert(tree != NULL);
 
-    // Avoid trivial case: empty tree
-    old_data = NULL;
-    if (tree->root != NULL) {
-
-        // Splay the smallest node to the root:
-        splay_left(tree);
-
-        // Remove it!
-        old_root   = tree->root;
-        old_data   = tree->root->data;
-        tree->root = tree->root->right;
-        free(old_root);
+    pthread_mutex_lock(&(tree->lock));
+    concurrent_write_begin(tree);
+    old_data = rb_tree_remove_max(tree->tree);
+    concurrent_write_end(tree);
+    if (old_data != NULL) {
+        concurrent_set_size(tree, tree->size - 1);
+        concurrent_synchronize(tree);
     }
+    pthread_mutex_unlock(&(tree->lock));
 
-    // Return
     return old_data;
 }
 
-// Removes the biggest element from "tree" and returns a pointer to its data
-// (so you can free it). If the tree is empty returns a NULL pointer.
+// Removes all the elements from the tree in linear time (see
+// "rb_tree_remove_all" for the meaning of free_data). The nodes and the data
+// are only released once no reader can reach them.
 //
-void *sp_tree_remove_max(sp_tree *tree) {
+void concurrent_rb_tree_remove_all(concurrent_rb_tree *tree,
+                                   void (* free_data) (void *)) {
 
-    sp_node *old_root;
-    void    *old_data;
+    rb_tree old_tree;
 
     // Sanity check:
     assert(tree != NULL);
 
-    // Avoid trivial case: empty tree
-    old_data = NULL;
-    if (tree->root != NULL) {
+    // Detach all the nodes at once:
+    pthread_mutex_lock(&(tree->lock));
+    concurrent_write_begin(tree);
+    old_tree         = *(tree->tree);
+    tree->tree->root = NULL;
+    concurrent_write_end(tree);
+    concurrent_set_size(tree, 0);
+
+    // Release them when the readers are gone:
+    concurrent_synchronize(tree);
+    rb_tree_remove_all(&old_tree, free_data);
+    *(tree->tree) = old_tree;
+    pthread_mutex_unlock(&(tree->lock));
+}
 
-        // Splay the biggest node to the root:
-        splay_right(tree);
 
-        // Remove it!
-        old_root   = tree->root;
-        old_data   = tree->root->data;
-        tree->root = tree->root->left;
-        free(old_root);
-    }
 
-    // Return
-    return old_data;
-}
+// DEBUG & VISUALIZATION:
 
-// Removes all the elements from the tree in linear time. This is faster than
-// calling "tree_remove_min(tree)" until "tree_is_empty(tree)" returns "YES".
+// Returns YES if tree is a valid concurrent_rb_tree (see "is_rb_tree") whose
+// size is right, or NO otherwise. Writers wait while it runs.
 //
-// If you provide a "free_data" function it will be used to free the "data"
-// inside each node. If "free_data" is NULL, no "data" will be freed. Use this
-// later option when "data" is shared between several data structures but be
-// aware that this may cause some memory leaks if you are not carefull.
+// This function should not be used in production code. I recommend to use:
 //
-// Most of the time, you can use just "free" as "free_data" function.
-// However if your "data" struct contains dinamically allocated data
-// you may need to provide a more complex "free_data" function like:
+//      assert(is_concurrent_rb_tree(tree) == YES);
 //
-//  void free_data(void *ptr) {
-//      MyData *data = (MyData *) ptr;
-//      free(data->some_array);
-//      free(data->some_other_array);
-//      free(data);
-//  }
+// To automatically remove all calls to this function when the flag NDEBUG
+// is defined in the header files (deactivating all assertions).
 //
-void sp_tree_remove_all(sp_tree *tree, void (* free_data) (void *)) {
+int is_concurrent_rb_tree(concurrent_rb_tree *tree) {
 
-    sp_node *root;
-    sp_node *left;
-    sp_node *right;
+    rb_walker  walker;
+    rb_node   *node;
+    size_t     size   = 0;
+    int        result = YES;
 
-    // Sanity check:
-    assert(tree != NULL);
+    // Basic Sanity Checks:
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: NULL pointer to concurrent_rb_tree\n");
+        return NO;
+    }
+    if (tree->tree == NULL || tree->tree->pool == NULL ||
+        tree->readers == NULL) {
+        fprintf(stderr, "ERROR: Wrong parameters in concurrent_rb_tree\n");
+        return NO;
+    }
 
-    // Initialize:
-    root = tree->root;
-    tree->root = NULL;
+    // Check the tree (with no writer around):
+    pthread_mutex_lock(&(tree->lock));
+    if (tree->seq & 1) {
+        fprintf(stderr, "ERROR: Odd sequence number without writers\n");
+        result = NO;
+    }
+    if (result == YES && is_rb_tree(tree->tree) == NO) { result = NO; }
+    if (result == YES) {
+        node = rb_walker_first(&walker, tree->tree->root);
+        while (node != NULL) {
+            size++;
+            node = rb_walker_next(&walker);
+        }
+        if (size != tree->size) {
+            fprintf(stderr, "ERROR: Wrong size of concurrent_rb_tree\n");
+            result = NO;
+        }
+    }
+    pthread_mutex_unlock(&(tree->lock));
 
-    // While the tree is not empty:
-    while (root != NULL) {
+    return result;
+}
 
-        // Unravel the tree: Rotate right "root" & "left"
-        if (root->left != NULL) {
-            left        = root->left;
-            right       = left->right;
-            left->right = root;
-            root->left  = right;
-            root        = left;
+// This function is used to print a concurrent_rb_tree on the screen (see
+// "print_rb_tree"). Writers wait while it runs.
+//
+// Again, this is a visualization tool for debugging purposes only.
+//
+void print_concurrent_rb_tree(concurrent_rb_tree *tree,
+                              void (* print_node) (const void *)) {
 
-        // Erase the current "root" node:
-        } else {
-            right = root->right;
-            if (free_data != NULL) { free_data(root->data); }
-            free(root);
-            root = right;
+    // Avoid the trivial case:
+    if (tree == NULL) { return; }
+
+    pthread_mutex_lock(&(tree->lock));
+    print_rb_tree(tree->tree, print_node);
+    pthread_mutex_unlock(&(tree->lock));
+}
+
+#endif
+
+// END OF CONCURRENT TREES /////////////////////////////////////////////////////
+
+
+
+// PERSISTENT TREES ////////////////////////////////////////////////////////////
+
+// Link counters (atomic if several threads may share the nodes):
+#ifdef RB_THREADS
+    #define PRB_LINK(p)    ((void) __atomic_fetch_add(&((p)->refs), 1,       \
+                                                      __ATOMIC_RELAXED))
+    #define PRB_UNLINK(p)  (__atomic_sub_fetch(&((p)->refs), 1,              \
+                                               __ATOMIC_ACQ_REL))
+    #define PRB_SHARED(p)  (__atomic_load_n(&((p)->refs), __ATOMIC_ACQUIRE) > 1)
+#else
+    #define PRB_LINK(p)    ((void) ((p)->refs++))
+    #define PRB_UNLINK(p)  (--((p)->refs))
+    #define PRB_SHARED(p)  ((p)->refs > 1)
+#endif
+
+#define PRB_IS_RED(p)   (((p) != NULL) && ((p)->color == RED))
+
+// What "prb_remove" removes:
+#define PRB_REMOVE      0   // The element equal to data
+#define PRB_REMOVE_MIN  1   // The smallest element
+#define PRB_REMOVE_MAX  2   // The biggest element
+
+
+// AUXILIARY FUNCTIONS:
+
+// Returns a new prb_node with a single link (the one the caller is about to
+// create) or NULL if there is not enough memory.
+//
+static prb_node *new_prb_node(void *data, prb_node *left, prb_node *right,
+                              char color) {
+
+    prb_node *node = (prb_node *) malloc(sizeof(prb_node));
+
+    if (node == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate prb_node\n");
+    } else {
+        node->data  = data;
+        node->left  = left;
+        node->right = right;
+        node->refs  = 1;
+        node->color = color;
+    }
+    return node;
+}
+
+// Drops one link to node. If it was the last one, the node is released and
+// so are its links to its children (and so on). The nodes waiting to be
+// released are stacked through their data field, so it takes no recursion
+// and no extra memory.
+//
+static void prb_release(prb_node *node) {
+
+    prb_node *pending;
+    prb_node *child;
+    int       side;
+
+    // Trivial cases: nothing to release
+    if (node == NULL || PRB_UNLINK(node) > 0) { return; }
+
+    node->data = NULL;
+    pending    = node;
+    while (pending != NULL) {
+        node    = pending;
+        pending = (prb_node *) node->data;
+        for (side = 0; side < 2; side++) {
+            child = (side == 0) ? node->left : node->right;
+            if (child != NULL && PRB_UNLINK(child) == 0) {
+                child->data = pending;
+                pending     = child;
+            }
         }
+        free(node);
     }
 }
 
+// Makes sure that *link points to a node that no other version can see (by
+// copying it if it is shared) and returns it (or NULL if there is not enough
+// memory). The node that holds *link (if any) must already be private.
+//
+static prb_node *prb_own(prb_node **link) {
 
+    prb_node *node = *link;
+    prb_node *copy;
 
-// SET FUNCTIONS:
+    // Private nodes can be changed in place:
+    if (PRB_SHARED(node) == NO) { return node; }
 
-// Returns a (really degenerated) splay tree containing a copy of the union of
-// tree_1 and tree_2. It does NOT modify the content of tree_1 or tree_2 but
-// can modify their shape.
-//
-// If a given "element" is in both trees it takes the pointer from tree_1.
-// Likewise, the new tree stores a pointer to the comparing function of tree_1.
+    // Otherwise the copy takes over our link (and links the same children):
+    copy = new_prb_node(node->data, node->left, node->right, node->color);
+    if (copy == NULL) { return NULL; }
+    if (copy->left  != NULL) { PRB_LINK(copy->left);  }
+    if (copy->right != NULL) { PRB_LINK(copy->right); }
+    *link = copy;
+    prb_release(node);
+
+    return copy;
+}
+
+// Returns the link that points to path[i] (the root link if i = 0).
 //
-sp_tree *sp_tree_union(sp_tree *tree_1, sp_tree *tree_2) {
+static prb_node **prb_link(prb_tree *tree, prb_node **path, size_t i) {
+    if (i == 0)                       { return &(tree->root);          }
+    if (path[i - 1]->left == path[i]) { return &(path[i - 1]->left);  }
+    else                              { return &(path[i - 1]->right); }
+}
 
-    sp_tree *tree;
-    void    *data_1;
-    void    *data_2;
-    int      comp;
+// Rotates *link to the left (its right child takes its place). Both nodes
+// must be private. The links just move, so no counter changes.
+//
+static void prb_rotate_left(prb_node **link) {
 
-    // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
+    prb_node *node  = *link;
+    prb_node *right = node->right;
 
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return sp_tree_copy(tree_1); }
+    node->right = right->left;
+    right->left = node;
+    *link       = right;
+}
 
-    // Create a new tree:
-    tree = new_sp_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
+// Rotates *link to the right (its left child takes its place). Both nodes
+// must be private. The links just move, so no counter changes.
+//
+static void prb_rotate_right(prb_node **link) {
 
-    // Get the smallest element of each tree:
-    data_1 = sp_tree_min(tree_1);
-    data_2 = sp_tree_min(tree_2);
+    prb_node *node = *link;
+    prb_node *left = node->left;
 
-    // Until we have exhausted at least one of the trees:
-    while (data_1 != NULL && data_2 != NULL) {
+    node->left  = left->right;
+    left->right = node;
+    *link       = left;
+}
 
-        // compare both nodes:
-        comp = (tree->comp)(data_1, data_2);
+// Removes from tree the element given by "which" (see PRB_REMOVE & co.) and
+// returns it (or NULL if there is no such element).
+//
+// The first pass walks down without copying anything, so looking for a
+// missing element costs no memory. The second one copies the shared nodes of
+// the path and the last one repairs the BLACK property bottom-up, copying
+// the siblings & nephews it recolors or rotates. If we run out of memory in
+// the middle of the repair, the tree is left unbalanced (but it remains a
+// valid search tree).
+//
+static void *prb_remove(prb_tree *tree, const void *data, int which) {
+
+    prb_node  *path[PRB_MAX_HEIGHT];
+    prb_node **link;
+    prb_node  *node;
+    prb_node  *child;
+    prb_node  *parent;
+    prb_node  *sibling;
+    prb_node  *nephew;
+    void      *old_data;
+    size_t     depth = 0;
+    size_t     found;
+    size_t     i;
+    int        comp;
+    char       color;
+
+    // Find the node to remove (without copying anything):
+    node = tree->root;
+    while (node != NULL) {
+        assert(depth < PRB_MAX_HEIGHT);
+        path[depth++] = node;
+        if      (which == PRB_REMOVE_MIN) { comp = node->left  ? -1 : 0; }
+        else if (which == PRB_REMOVE_MAX) { comp = node->right ? +1 : 0; }
+        else    { comp = tree->comp(data, node->data); }
+        if (comp == 0) { break; }
+        node = (comp < 0) ? node->left : node->right;
+    }
+    if (node == NULL) { return NULL; }
 
-        if (comp < 0) {
+    // Nodes with two children trade places with their successor:
+    found = depth - 1;
+    if (node->left != NULL && node->right != NULL) {
+        node = node->right;
+        while (node != NULL) {
+            assert(depth < PRB_MAX_HEIGHT);
+            path[depth++] = node;
+            node = node->left;
+        }
+    }
 
-            // insert data_1 in tree:
-            sp_tree_insert_max(tree, data_1);
+    // Copy the shared nodes of the path (top-down):
+    for (i = 0; i < depth; i++) {
+        path[i] = prb_own(prb_link(tree, path, i));
+        if (path[i] == NULL) { return NULL; }
+    }
+    node     = path[depth - 1];
+    old_data = path[found]->data;
+    path[found]->data = node->data;
+
+    // Unlink node (its only child, if any, takes its place):
+    child = (node->left != NULL) ? node->left : node->right;
+    link  = prb_link(tree, path, depth - 1);
+    *link = child;
+    color       = node->color;
+    node->left  = NULL;
+    node->right = NULL;
+    prb_release(node);
+    tree->size--;
+    depth--;
+
+    // Removing a RED node breaks nothing, and a RED child can take its place:
+    if (color == RED) { return old_data; }
+    if (PRB_IS_RED(child)) {
+        child = prb_own(link);
+        if (child != NULL) { child->color = BLACK; }
+        return old_data;
+    }
 
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+    // Otherwise "child" lacks one BLACK node: Repair it bottom-up
+    while (depth > 0 && PRB_IS_RED(child) == NO) {
+        parent = path[depth - 1];
+
+        // "child" is a left child:
+        if (child == parent->left) {
+            sibling = prb_own(&(parent->right));
+            if (sibling == NULL) { break; }
+
+            // Case 1: RED sibling -> Rotate it over parent
+            if (sibling->color == RED) {
+                sibling->color = BLACK;
+                parent->color  = RED;
+                prb_rotate_left(prb_link(tree, path, depth - 1));
+                assert(depth < PRB_MAX_HEIGHT);
+                path[depth - 1] = sibling;
+                path[depth++]   = parent;
+                sibling = prb_own(&(parent->right));
+                if (sibling == NULL) { break; }
+            }
 
-        } else if (comp > 0) {
+            // Case 2: BLACK nephews -> Recolor sibling and go up
+            if (!PRB_IS_RED(sibling->left) && !PRB_IS_RED(sibling->right)) {
+                sibling->color = RED;
+                child = parent;
+                depth--;
+                continue;
+            }
 
-            // insert data_2 in tree:
-            sp_tree_insert_max(tree, data_2);
+            // Case 3: Only the inner nephew is RED -> Rotate it over sibling
+            if (!PRB_IS_RED(sibling->right)) {
+                nephew = prb_own(&(sibling->left));
+                if (nephew == NULL) { break; }
+                nephew->color  = BLACK;
+                sibling->color = RED;
+                prb_rotate_right(&(parent->right));
+                sibling = nephew;
+            }
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+            // Case 4: The outer nephew is RED -> Rotate sibling over parent
+            nephew = prb_own(&(sibling->right));
+            if (nephew == NULL) { break; }
+            sibling->color = parent->color;
+            parent->color  = BLACK;
+            nephew->color  = BLACK;
+            prb_rotate_left(prb_link(tree, path, depth - 1));
+            break;
 
+        // "child" is a right child (mirror case):
         } else {
+            sibling = prb_own(&(parent->left));
+            if (sibling == NULL) { break; }
+
+            // Case 1: RED sibling -> Rotate it over parent
+            if (sibling->color == RED) {
+                sibling->color = BLACK;
+                parent->color  = RED;
+                prb_rotate_right(prb_link(tree, path, depth - 1));
+                assert(depth < PRB_MAX_HEIGHT);
+                path[depth - 1] = sibling;
+                path[depth++]   = parent;
+                sibling = prb_own(&(parent->left));
+                if (sibling == NULL) { break; }
+            }
 
-            // insert data_1 in tree:
-            sp_tree_insert_max(tree, data_1);
-
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+            // Case 2: BLACK nephews -> Recolor sibling and go up
+            if (!PRB_IS_RED(sibling->left) && !PRB_IS_RED(sibling->right)) {
+                sibling->color = RED;
+                child = parent;
+                depth--;
+                continue;
+            }
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+            // Case 3: Only the inner nephew is RED -> Rotate it over sibling
+            if (!PRB_IS_RED(sibling->left)) {
+                nephew = prb_own(&(sibling->right));
+                if (nephew == NULL) { break; }
+                nephew->color  = BLACK;
+                sibling->color = RED;
+                prb_rotate_left(&(parent->left));
+                sibling = nephew;
+            }
 
+            // Case 4: The outer nephew is RED -> Rotate sibling over parent
+            nephew = prb_own(&(sibling->left));
+            if (nephew == NULL) { break; }
+            sibling->color = parent->color;
+            parent->color  = BLACK;
+            nephew->color  = BLACK;
+            prb_rotate_right(prb_link(tree, path, depth - 1));
+            break;
         }
     }
 
-    // Insert all remaining data from tree_1:
-    while (data_1 != NULL) {
+    // A RED node that got here (always a private one from the path) absorbs
+    // the missing BLACK node:
+    if (PRB_IS_RED(child)) { child->color = BLACK; }
+
+    return old_data;
+}
 
-        // insert data_1 in tree:
-        sp_tree_insert_max(tree, data_1);
 
-        // advance data_1:
-        data_1 = sp_tree_next(tree_1, data_1);
-    }
 
-    // Insert all remaining data from tree_2:
-    while (data_2 != NULL) {
+// CREATION & INSERTION:
 
-        // insert data_2 in tree:
-        sp_tree_insert_max(tree, data_2);
+// Returns a pointer to a new empty prb_tree (or NULL if there is not enough
+// memory). The comparing function must satisfy the same rules as in
+// "new_rb_tree".
+//
+prb_tree *new_prb_tree(int (* comp) (const void *, const void *)) {
+
+    prb_tree *tree;
+
+    // Sanity check:
+    assert(comp != NULL);
 
-        // advance data_2:
-        data_2 = sp_tree_next(tree_2, data_2);
+    // Allocate memory:
+    tree = (prb_tree *) malloc(sizeof(prb_tree));
+    if (tree == NULL) {
+        fprintf(stderr, "ERROR: Unable to allocate prb_tree\n");
+    } else {
+        tree->root = NULL;
+        tree->size = 0;
+        tree->comp = comp;
     }
 
-    // Return the resulting tree:
     return tree;
 }
 
-// Returns a (really degenerated) splay tree containing a copy of the
-// intersection of tree_1 and tree_2. It does NOT modify the content of tree_1
-// or tree_2 but can modify their shape.
+// Returns a new version of tree (or NULL if there is not enough memory) in
+// O(1) time. Both versions share all their nodes (and elements) but changing
+// one of them never changes the other.
 //
-// The comparing function and all data pointers are taken from tree_1.
-//
-sp_tree *sp_tree_intersection(sp_tree *tree_1, sp_tree *tree_2) {
+prb_tree *prb_tree_snapshot(const prb_tree *tree) {
 
-    sp_tree *tree;
-    void    *data_1;
-    void    *data_2;
-    int      comp;
+    prb_tree *snapshot;
 
     // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
+    assert(tree != NULL);
 
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return sp_tree_copy(tree_1); }
+    snapshot = new_prb_tree(tree->comp);
+    if (snapshot != NULL) {
+        snapshot->root = tree->root;
+        snapshot->size = tree->size;
+        if (tree->root != NULL) { PRB_LINK(tree->root); }
+    }
 
-    // Create a new tree:
-    tree = new_sp_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
+    return snapshot;
+}
 
-    // Special case: Some of them is empty
-    if (sp_tree_is_empty(tree_1) == YES) { return tree; }
-    if (sp_tree_is_empty(tree_2) == YES) { return tree; }
-    
-    // Get the smallest element of each tree:
-    data_1 = sp_tree_min(tree_1);
-    data_2 = sp_tree_min(tree_2);
+// Releases this version of the tree and the nodes that no other version is
+// using (but not the data of its elements). Takes O(#released nodes) time.
+//
+void free_prb_tree(prb_tree *tree) {
 
-    // Until we have exhausted at least one of the trees:
-    while (data_1 != NULL && data_2 != NULL) {
+    // Avoid the trivial case:
+    if (tree == NULL) { return; }
 
-        // compare both nodes:
-        comp = (tree->comp)(data_1, data_2);
+    prb_release(tree->root);
+    free(tree);
+}
 
-        if (comp < 0) {
+// Inserts data in tree.
+//
+// If a node of the tree compares "equal" to data it will get replaced and a
+// pointer to the previously stored data will be returned (other versions
+// keep the previous element), otherwise it will simply return a NULL pointer.
+//
+// It copies the shared nodes of the path on the way down and repairs the RED
+// property bottom-up, copying the uncles it recolors.
+//
+void *prb_tree_insert(prb_tree *tree, void *data) {
+
+    prb_node  *path[PRB_MAX_HEIGHT];
+    prb_node **link;
+    prb_node  *node;
+    prb_node  *parent;
+    prb_node  *granpa;
+    prb_node  *uncle;
+    void      *old_data;
+    size_t     depth = 0;
+    int        comp;
 
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-        } else if (comp > 0) {
+    // Walk down (copying the shared nodes) until we find data or a leaf:
+    link = &(tree->root);
+    while (*link != NULL) {
+        node = prb_own(link);
+        if (node == NULL) { return NULL; }
+        comp = tree->comp(data, node->data);
+        if (comp == 0) {
+            old_data   = node->data;
+            node->data = data;
+            return old_data;
+        }
+        assert(depth < PRB_MAX_HEIGHT);
+        path[depth++] = node;
+        link = (comp < 0) ? &(node->left) : &(node->right);
+    }
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+    // Hang a new RED node there:
+    node = new_prb_node(data, NULL, NULL, RED);
+    if (node == NULL) { return NULL; }
+    *link = node;
+    tree->size++;
 
-        } else {
+    // Repair the RED property bottom-up:
+    while (depth > 0 && path[depth - 1]->color == RED) {
+
+        // A RED parent is never the root, so there is always a granpa:
+        parent = path[depth - 1];
+        granpa = path[depth - 2];
+
+        // "parent" is a left child:
+        if (parent == granpa->left) {
 
-            // insert data_1 in tree:
-            sp_tree_insert_max(tree, data_1);
+            // Case 1: RED uncle -> Color flip and go up
+            if (PRB_IS_RED(granpa->right)) {
+                uncle = prb_own(&(granpa->right));
+                if (uncle == NULL) { break; }
+                uncle->color  = BLACK;
+                parent->color = BLACK;
+                granpa->color = RED;
+                node   = granpa;
+                depth -= 2;
+                continue;
+            }
+
+            // Case 2: Inner node -> Rotate it over parent
+            if (node == parent->right) {
+                prb_rotate_left(&(granpa->left));
+                parent = node;
+            }
+
+            // Case 3: Outer node -> Rotate parent over granpa
+            parent->color = BLACK;
+            granpa->color = RED;
+            prb_rotate_right(prb_link(tree, path, depth - 2));
+            break;
+
+        // "parent" is a right child (mirror case):
+        } else {
 
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+            // Case 1: RED uncle -> Color flip and go up
+            if (PRB_IS_RED(granpa->left)) {
+                uncle = prb_own(&(granpa->left));
+                if (uncle == NULL) { break; }
+                uncle->color  = BLACK;
+                parent->color = BLACK;
+                granpa->color = RED;
+                node   = granpa;
+                depth -= 2;
+                continue;
+            }
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+            // Case 2: Inner node -> Rotate it over parent
+            if (node == parent->left) {
+                prb_rotate_right(&(granpa->right));
+                parent = node;
+            }
 
+            // Case 3: Outer node -> Rotate parent over granpa
+            parent->color = BLACK;
+            granpa->color = RED;
+            prb_rotate_left(prb_link(tree, path, depth - 2));
+            break;
         }
     }
 
-    // Return the resulting tree:
-    return tree;
+    // The root (always private here) is BLACK:
+    tree->root->color = BLACK;
+
+    return NULL;
 }
 
-// Returns a (really degenerated) splay tree containing a copy of the
-// difference: tree_1 - tree_2. It does NOT modify the content of tree_1 or
-// tree_2 but can modify their shape.
-//
-// The comparing function and all data pointers are taken from tree_1.
+
+
+// SEARCH:
+
+// Returns YES if the tree is empty and NO otherwise.
 //
-sp_tree *sp_tree_diff(sp_tree *tree_1, sp_tree *tree_2) {
-    
-    sp_tree *tree;
-    void    *data_1;
-    void    *data_2;
-    int      comp;
+int prb_tree_is_empty(const prb_tree *tree) {
 
     // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
+    assert(tree != NULL);
 
-    // Create a new tree:
-    tree = new_sp_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
+    return (tree->root == NULL) ? YES : NO;
+}
 
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return tree; }
+// Returns the number of elements stored in the tree in O(1) time.
+//
+size_t prb_tree_size(const prb_tree *tree) {
 
-    // Special case: Some of them is empty
-    if (sp_tree_is_empty(tree_1) == YES) { return tree; }
+    // Sanity check:
+    assert(tree != NULL);
 
-    // Get the smallest element of each tree:
-    data_1 = sp_tree_min(tree_1);
-    data_2 = sp_tree_min(tree_2);
+    return tree->size;
+}
 
-    // Until we have exhausted at least one of the trees:
-    while (data_1 != NULL && data_2 != NULL) {
+// Searches for an element that compares "equal" to data and returns a pointer
+// to it (or NULL if there is no such element).
+//
+void *prb_tree_search(const prb_tree *tree, const void *data) {
 
-        // compare both nodes:
-        comp = (tree->comp)(data_1, data_2);
+    const prb_node *node;
+    int             comp;
 
-        if (comp < 0) {
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-            // insert data_1 in tree:
-            sp_tree_insert_max(tree, data_1);
+    node = tree->root;
+    while (node != NULL) {
+        comp = tree->comp(data, node->data);
+        if      (comp < 0) { node = node->left;  }
+        else if (comp > 0) { node = node->right; }
+        else               { return node->data;  }
+    }
 
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+    return NULL;
+}
 
-        } else if (comp > 0) {
+// Returns a pointer to the smallest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *prb_tree_min(const prb_tree *tree) {
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+    const prb_node *node;
 
-        } else {
+    // Sanity check:
+    assert(tree != NULL);
 
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+    node = tree->root;
+    while (node->left != NULL) { node = node->left; }
+    return node->data;
+}
 
-        }
-    }
+// Returns a pointer to the biggest element stored in the tree.
+// Returns NULL if the tree is empty.
+//
+void *prb_tree_max(const prb_tree *tree) {
 
-    // Insert all remaining data from tree_1:
-    while (data_1 != NULL) {
+    const prb_node *node;
 
-        // insert data_1 in tree:
-        sp_tree_insert_max(tree, data_1);
+    // Sanity check:
+    assert(tree != NULL);
 
-        // advance data_1:
-        data_1 = sp_tree_next(tree_1, data_1);
-    }
+    // Trivial case: empty tree
+    if (tree->root == NULL) { return NULL; }
 
-    // Return the resulting tree:
-    return tree;
+    node = tree->root;
+    while (node->right != NULL) { node = node->right; }
+    return node->data;
 }
 
-// Returns a (really degenerated) splay tree containing a copy of the symmetric
-// difference of tree_1 and tree_2. It does NOT modify the content of tree_1 or
-// tree_2 but can modify their shape.
+// Find the in-order predecesor of data in the tree.
 //
-// The comparing function is taken from tree_1.
+// If data is not in tree returns the biggest element of tree smaller than data.
+// If data is smaller or equal to all elements of tree returns NULL.
 //
-sp_tree *sp_tree_sym_diff(sp_tree *tree_1, sp_tree *tree_2) {
-    sp_tree *tree;
-    void    *data_1;
-    void    *data_2;
-    int      comp;
+void *prb_tree_prev(const prb_tree *tree, const void *data) {
 
-    // Sanity check:
-    assert(tree_1 != NULL);
-    assert(tree_2 != NULL);
+    const prb_node *node;
+    void           *pred = NULL;
 
-    // Create a new tree:
-    tree = new_sp_tree(tree_1->comp);
-    if (tree == NULL) { return NULL; }
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-    // Special case: Both trees are the same
-    if (tree_1 == tree_2) { return tree; }
+    node = tree->root;
+    while (node != NULL) {
+        if (tree->comp(data, node->data) > 0) {
+            pred = node->data;
+            node = node->right;
+        } else { node = node->left; }
+    }
 
-    // Get the smallest element of each tree:
-    data_1 = sp_tree_min(tree_1);
-    data_2 = sp_tree_min(tree_2);
+    return pred;
+}
 
-    // Until we have exhausted at least one of the trees:
-    while (data_1 != NULL && data_2 != NULL) {
+// Find the in-order successor of data in the tree.
+//
+// If data is not in tree returns the smallest element of tree bigger than data.
+// If data is bigger or equal to all elements of tree returns NULL.
+//
+void *prb_tree_next(const prb_tree *tree, const void *data) {
 
-        // compare both nodes:
-        comp = (tree->comp)(data_1, data_2);
+    const prb_node *node;
+    void           *succ = NULL;
 
-        if (comp < 0) {
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-            // insert data_1 in tree:
-            sp_tree_insert_max(tree, data_1);
+    node = tree->root;
+    while (node != NULL) {
+        if (tree->comp(data, node->data) < 0) {
+            succ = node->data;
+            node = node->left;
+        } else { node = node->right; }
+    }
 
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+    return succ;
+}
 
-        } else if (comp > 0) {
 
-            // insert data_2 in tree:
-            sp_tree_insert_max(tree, data_2);
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+// REMOVE:
 
-        } else {
+// Removes a node of tree that compares "equal" to data and returns a pointer
+// to the previously stored data (other versions still hold it, so only free
+// it when nobody else does). If such a node is not found, it returns a NULL
+// pointer without copying anything.
+//
+void *prb_tree_remove(prb_tree *tree, const void *data) {
 
-            // advance data_1:
-            data_1 = sp_tree_next(tree_1, data_1);
+    // Sanity Checks:
+    assert(tree != NULL);
+    assert(data != NULL);
 
-            // advance data_2:
-            data_2 = sp_tree_next(tree_2, data_2);
+    return prb_remove(tree, data, PRB_REMOVE);
+}
 
-        }
-    }
+// Removes the smallest element from tree and returns a pointer to its data.
+// If the tree is empty returns a NULL pointer.
+//
+void *prb_tree_remove_min(prb_tree *tree) {
 
-    // Insert all remaining data from tree_1:
-    while (data_1 != NULL) {
+    // Sanity check:
+    assert(tree != NULL);
 
-        // insert data_1 in tree:
-        sp_tree_insert_max(tree, data_1);
+    return prb_remove(tree, NULL, PRB_REMOVE_MIN);
+}
 
-        // advance data_1:
-        data_1 = sp_tree_next(tree_1, data_1);
-    }
+// Removes the biggest element from tree and returns a pointer to its data.
+// If the tree is empty returns a NULL pointer.
+//
+void *prb_tree_remove_max(prb_tree *tree) {
 
-    // Insert all remaining data from tree_2:
-    while (data_2 != NULL) {
+    // Sanity check:
+    assert(tree != NULL);
 
-        // insert data_2 in tree:
-        sp_tree_insert_max(tree, data_2);
+    return prb_remove(tree, NULL, PRB_REMOVE_MAX);
+}
 
-        // advance data_2:
-        data_2 = sp_tree_next(tree_2, data_2);
-    }
+// Removes all the elements from this version of the tree, releasing the nodes
+// that no other version is using. The elements are not freed, since other
+// versions may still hold them.
+//
+void prb_tree_remove_all(prb_tree *tree) {
 
-    // Return the resulting tree:
-    return tree;
+    // Sanity check:
+    assert(tree != NULL);
+
+    prb_release(tree->root);
+    tree->root = NULL;
+    tree->size = 0;
 }
 
 
 
 // DEBUG & VISUALIZATION:
 
-// This is an auxiliary function to check the symmetric order property
-// recursively. You should not use it directly, use "is_sp_tree" instead.
+// This is an auxiliary function to check the symmetric order property, the
+// RED & BLACK properties and the link counters recursively (it adds the
+// number of nodes to *size). You should not use it directly, use
+// "is_prb_tree" instead.
 //
 // Note that, unlike other functions of this library, it is safe to use
 // recursive definitions here since they will only be used to test the
-// code while debugging.
+// code while debugging this library.
 //
-static int is_sp_subtree(const sp_tree *tree, const sp_node *node,
-                         const void *min, const void *max) {
+static int is_prb_subtree(const prb_tree *tree, const prb_node *node,
+                          const void *min, const void *max, size_t *size) {
+
+    int left_height  = 0;
+    int right_height = 0;
 
     // Make sure that node is (strictly) between specified limits:
-    if (min != NULL && (tree->comp)(min, node->data) >= 0) {
-        fprintf(stderr,"ERROR: Symmetric order not satisfied in sp_tree\n");
-        return NO;
+    if ((min != NULL && tree->comp(min, node->data) >= 0) ||
+        (max != NULL && tree->comp(node->data, max) >= 0)) {
+        fprintf(stderr, "ERROR: Symmetric order not satisfied in prb_tree\n");
+        return -1;
     }
-    if (max != NULL && (tree->comp)(node->data, max) >= 0) {
-        fprintf(stderr,"ERROR: Symmetric order not satisfied in sp_tree\n");
-        return NO;
+
+    // Someone must link to node:
+    if (node->refs == 0) {
+        fprintf(stderr, "ERROR: Unlinked node in prb_tree\n");
+        return -1;
     }
 
-    // Check recursively the left subtree of node:
-    if (node->left != NULL) {
-        if (is_sp_subtree(tree, node->left, min, node->data) == NO) {
-            return NO;
-        }
+    // Check for RED violations:
+    if (node->color == RED &&
+        (PRB_IS_RED(node->left) || PRB_IS_RED(node->right))) {
+        fprintf(stderr, "ERROR: Two RED nodes in a row in prb_tree\n");
+        return -1;
     }
 
-    // Check recursively the right subtree of node:
+    // Check recursively both subtrees of node:
+    if (node->left != NULL) {
+        left_height = is_prb_subtree(tree, node->left, min, node->data, size);
+        if (left_height == -1) { return -1; }
+    }
     if (node->right != NULL) {
-        if (is_sp_subtree(tree, node->right, node->data, max) == NO) {
-            return NO;
-        }
+        right_height = is_prb_subtree(tree, node->right, node->data, max,
+                                      size);
+        if (right_height == -1) { return -1; }
     }
 
-    // All test are fine:
-    return YES;
+    // Check for BLACK violations:
+    if (left_height != right_height) {
+        fprintf(stderr, "ERROR: Different BLACK height in prb_tree\n");
+        return -1;
+    }
+
+    // Return Black-Height of "node":
+    (*size)++;
+    if (node->color == RED) { return left_height; }
+    return left_height + 1;
 }
 
-// This is an auxiliary function to check the symmetric order property of a
-// splay tree. Returns YES if everything is correct and NO otherwise.
+// This is an auxiliary function to check the symmetric order property, the
+// RED property, the BLACK property and the size of a prb_tree.
+// Returns YES if everything is correct and NO otherwise.
 //
 // This function should not be used in production code. I recommend to use:
 //
-//      assert(is_sp_tree(tree) == YES);
+//      assert(is_prb_tree(tree) == YES);
 //
-// to automatically remove all calls to this function when the flag NDEBUG
+// To automatically remove all calls to this function when the flag NDEBUG
 // is defined in the header files (deactivating all assertions).
 //
-int is_sp_tree(const sp_tree *tree) {
+int is_prb_tree(const prb_tree *tree) {
+
+    size_t size = 0;
 
     // Basic Sanity Checks:
     if (tree == NULL) {
-        fprintf(stderr, "ERROR: NULL pointer to sp_tree\n");
+        fprintf(stderr, "ERROR: NULL pointer to prb_tree\n");
         return NO;
     }
     if (tree->comp == NULL) {
-        fprintf(stderr, "ERROR: NULL comparing function in sp_tree\n");
+        fprintf(stderr, "ERROR: NULL comparing function in prb_tree\n");
         return NO;
     }
 
     // Trivial Case: empty tree
-    if (tree->root == NULL) { return YES; }
+    if (tree->root == NULL) {
+        if (tree->size == 0) { return YES; }
+        fprintf(stderr, "ERROR: Wrong size of prb_tree\n");
+        return NO;
+    }
 
     // General Case:
-    return is_sp_subtree(tree, tree->root, NULL, NULL);
+    if (tree->root->color == RED) {
+        fprintf(stderr, "ERROR: RED root in prb_tree\n");
+        return NO;
+    }
+    if (is_prb_subtree(tree, tree->root, NULL, NULL, &size) == -1) {
+        return NO;
+    }
+    if (size != tree->size) {
+        fprintf(stderr, "ERROR: Wrong size of prb_tree\n");
+        return NO;
+    }
+    return YES;
 }
 
 // This is an auxiliary function to print the tree recursively.
-// You should not use it directly, use "print_sp_tree" instead.
+// You should not use it directly, use "print_prb_tree" instead.
 //
 // Note that, unlike the rest of the functions of this library, it is safe
 // to use recursive definitions here since any tree large enough to hit the
 // recursion limit will be too big to be printed anyway.
 //
-static void print_sp_subtree(const sp_node *node, const int is_right,
-                             char *indent, void (* print_node) (const void *)) {
+static void print_prb_subtree(const prb_node *node, const int is_right,
+                              char *indent,
+                              void (* print_node) (const void *)) {
 
     // Allocate memory:
     char *new_indent = (char *) malloc((6+strlen(indent)*sizeof(char)));
@@ -5573,67 +16503,73 @@ static void print_sp_subtree(const sp_node *node, const int is_right,
     // Print right subtree recursively:
     if (node->right != NULL) {
         if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "      "); }
-        else                 { sprintf(new_indent, "%s%s", indent, "|     "); }
-        print_sp_subtree(node->right, YES, new_indent, print_node);
+        else {
+            if (node->color == RED) {
+                sprintf(new_indent, "%s%s", indent, "||    ");
+            } else {
+                sprintf(new_indent, "%s%s", indent, "|     ");
+            }
+        }
+        print_prb_subtree(node->right, YES, new_indent, print_node);
     }
 
     // Print current node:
-    if (is_right) { fprintf(stdout, "%s,----",indent); }
-    else          { fprintf(stdout, "%s`----",indent); }
-    if (print_node == NULL)  { fprintf(stdout, "(#)"); }
-    else                     { print_node(node->data); }
-    printf("\n");
+    if (node->color == RED) {
+        if (is_right) { fprintf(stdout, "%s/====",indent); }
+        else          { fprintf(stdout, "%s\\====",indent); }
+    } else {
+        if (is_right) { fprintf(stdout, "%s,----",indent); }
+        else          { fprintf(stdout, "%s`----",indent); }
+    }
+    if (print_node == NULL)  {
+        if (node->color == RED) { fprintf(stdout, "(#)"); }
+        else                    { fprintf(stdout, "( )"); }
+    } else { print_node(node->data); }
+    fprintf(stdout, "\n");
 
     // Print left subtree recursively:
     if (node->left != NULL) {
-        if (is_right == YES) { sprintf(new_indent, "%s%s", indent, "|     "); }
-        else                 { sprintf(new_indent, "%s%s", indent, "      "); }
-        print_sp_subtree(node->left, NO, new_indent, print_node);
+        if (is_right == YES) {
+            if (node->color == RED) {
+                sprintf(new_indent, "%s%s", indent, "||    ");
+            } else {
+                sprintf(new_indent, "%s%s", indent, "|     ");
+            }
+        } else { sprintf(new_indent, "%s%s", indent, "      "); }
+        print_prb_subtree(node->left, NO, new_indent, print_node);
     }
 
     // Free memory:
     free(new_indent);
 }
 
-// This function is used to print a splay tree on the screen.
-//
-//  * If a "print_node" function is provided it will be used to print the
-//    content of each node.
-//  * Otherwise (if print_node is NULL) all nodes will be printed as (#).
-//
-// Use this latter option if you only want to take a look at the tree shape.
-//
-// A correct print_node function only prints a single line of text using
-// the "fprintf" command. It should NOT include any "\n" in that line.
-//
-// For example:
-//
-//  void MyPrintNodeFunction(const void *ptr) {
-//      MyDataStruct *d = (MyDataStruct *) ptr;     // Pointer casting
-//      fprintf(stdout, "(%d)", d->key);            // Printing integer key
-//  }
+// This function is used to print a prb_tree on the screen (see
+// "print_rb_tree"). Shared nodes are printed once per version.
 //
-// Finally, note that this is a visualization tool for debugging purposes only.
+// Again, this is a visualization tool for debugging purposes only.
 //
-void print_sp_tree(const sp_tree *tree, void (* print_node) (const void *)) {
+void print_prb_tree(const prb_tree *tree, void (* print_node) (const void *)) {
 
     // Avoid the trivial cases:
     if (tree != NULL && tree->root != NULL) {
 
         // Print right subtree recursively:
         if (tree->root->right != NULL) {
-            print_sp_subtree(tree->root->right, YES, "     ", print_node);
+            print_prb_subtree(tree->root->right, YES, "     ", print_node);
         }
 
         // Print current node:
-        fprintf(stdout, "----");
-        if (print_node == NULL) { fprintf(stdout, "(#)"); }
-        else { print_node(tree->root->data); }
+        if (tree->root->color == RED) { fprintf(stdout, "===="); }
+        else                          { fprintf(stdout, "----"); }
+        if (print_node == NULL) {
+            if (tree->root->color == RED) { fprintf(stdout, "(#)"); }
+            else                          { fprintf(stdout, "( )"); }
+        } else { print_node(tree->root->data); }
         fprintf(stdout, "\n");
 
         // Print left subtree recursively:
         if (tree->root->left != NULL) {
-            print_sp_subtree(tree->root->left, NO, "     ", print_node);
+            print_prb_subtree(tree->root->left, NO, "     ", print_node);
         }
     }
 
@@ -5641,4 +16577,4 @@ void print_sp_tree(const sp_tree *tree, void (* print_node) (const void *)) {
     fflush(stdout);
 }
 
-// END OF SPLAY TREES //////////////////////////////////////////////////////////
+// END OF PERSISTENT TREES /////////////////////////////////////////////////////
@@ -39,6 +39,8 @@
 
     #define CLM_BINARY_TREES
 
+    #include <stddef.h>     // size_t
+
     // GENERAL MACROS //////////////////////////////////////////////////////////
 
     #ifndef YES
@@ -52,6 +54,144 @@
     ////////////////////////////////////////////////////////////////////////////
 
 
+    // NODE POOLS //////////////////////////////////////////////////////////////
+
+    // STRUCTS:
+
+    typedef struct node_pool {
+        size_t  node_size;      // Size of each node (in bytes)
+        size_t  capacity;       // Number of nodes in the first slab
+        size_t  slab_size;      // Number of nodes in the next slab
+        void   *slabs;          // Linked list of slabs (NULL if empty)
+        void   *free_nodes;     // Linked list of released nodes (NULL if empty)
+        char   *next;           // First unused node of the last slab
+        char   *end;            // End of the last slab
+    } node_pool;
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // TREE STATISTICS /////////////////////////////////////////////////////////
+
+    // If TREE_STATS is defined at compile time, every tree counts the work
+    // done by its operations (see "xx_tree_get_stats" & "xx_tree_reset_stats").
+    // Otherwise the counters do not exist and they cost nothing at all.
+    //
+    // Note that, with TREE_STATS, even the functions that take a const tree
+    // update its counters, so they are no longer safe to call from several
+    // threads at the same time.
+
+    #ifdef TREE_STATS
+
+    // STRUCTS:
+
+    typedef struct tree_stats {
+        size_t comparisons;     // Calls to the comparing function
+        size_t rotations;       // Single rotations (double ones count as 2)
+        size_t recolorings;     // Colors painted (rb_tree only)
+        size_t splay_steps;     // Zig, zig-zig & zig-zag steps (sp_tree only)
+        size_t allocations;     // Nodes allocated
+        size_t releases;        // Nodes released (except by remove_all)
+        size_t searches;        // Searches made by search, insert & remove
+        size_t depth;           // Sum of the depths reached by those searches
+        size_t max_depth;       // Maximum depth reached by a single search
+    } tree_stats;
+
+    #endif
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // KEY PREFIXES ////////////////////////////////////////////////////////////
+
+    // If TREE_KEY_PREFIX is defined at compile time, every bs_node and rb_node
+    // also caches an 8-byte "prefix" of its data, so insert, search & remove
+    // can compare two prefixes (without touching the data at all) and only call
+    // the comparing function when both prefixes are equal.
+    //
+    // The prefix function is optional and it is set per tree with the
+    // "xx_tree_set_prefix" functions. It must be consistent with comp:
+    //  * prefix(A) < prefix(B)  implies  comp(A,B) < 0
+    //
+    // For instance, the first 8 bytes of a string key packed in big-endian
+    // order, or a numeric key mapped to an unsigned integer that preserves its
+    // order. Trees without a prefix function give the same prefix (zero) to
+    // every node, so they keep working exactly as before.
+
+    #ifdef TREE_KEY_PREFIX
+        #include <stdint.h>     // uint64_t
+    #endif
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // MIN & MAX NODES /////////////////////////////////////////////////////////
+
+    // If TREE_MIN_MAX is defined at compile time, every bs_tree, sp_tree and
+    // rb_tree also keeps pointers to its leftmost and rightmost nodes, which
+    // are maintained by every function that modifies the tree. This makes
+    // "xx_tree_min" & "xx_tree_max" O(1) (splay trees still splay them) and
+    // lets "bs_tree_insert_min" & "bs_tree_insert_max" hang the new node
+    // without walking down the spine, which is what a priority queue needs.
+    //
+    // Removals still walk down from the root (there are no parent pointers to
+    // relink the removed node) but they find the new extremes for free.
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // SPLAYING POLICIES ///////////////////////////////////////////////////////
+
+    // If SP_SPLAY_POLICY is defined at compile time, every sp_tree also has a
+    // splaying policy that decides which lookups ("sp_tree_search", "_min",
+    // "_max", "_prev" & "_next") splay the element they find to the root. The
+    // other lookups just walk down the tree without writing a single pointer,
+    // which saves most of the store traffic of read-heavy workloads:
+    //  * SP_SPLAY_ALWAYS: every lookup splays (the default)
+    //  * SP_SPLAY_RANDOM: every lookup splays with probability "param"
+    //  * SP_SPLAY_DEPTH:  lookups splay if they go deeper than "param" levels
+    //  * SP_SPLAY_EVERY:  only one out of every "param" lookups splays
+    //
+    // Insertions & removals always splay (they need the element at the root).
+    // Lookups that are too deep for SP_SPLAY_DEPTH walk down twice (once to
+    // find out and once more to splay), but each of them brings its element
+    // close to the root so the following ones are cheap.
+
+    #ifdef SP_SPLAY_POLICY
+        #include <stdint.h>     // uint64_t
+
+        #define SP_SPLAY_ALWAYS 0
+        #define SP_SPLAY_RANDOM 1
+        #define SP_SPLAY_DEPTH  2
+        #define SP_SPLAY_EVERY  3
+    #endif
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // SCAPEGOAT MODE //////////////////////////////////////////////////////////
+
+    // If BS_SCAPEGOAT is defined at compile time, every bs_tree can also turn
+    // itself into a scapegoat tree with "bs_tree_set_scapegoat". In this mode
+    // the tree counts its nodes and, whenever an insertion goes deeper than
+    // log(n) / log(1/alpha) levels, it climbs back to the first ancestor whose
+    // subtree is not alpha-weight-balanced (the "scapegoat") and rebuilds only
+    // that subtree with the same Day–Stout–Warren routine of
+    // "bs_tree_rebalance". Removals rebuild the whole tree once the tree has
+    // lost a (1 - alpha) fraction of its biggest size.
+    //
+    // This keeps the 24-byte nodes of the classic trees but guarantees
+    // O(log n) searches and O(log n) amortized insertions & removals, even
+    // for sorted input. Alpha must be between 0.5 (rigid, frequent rebuilds)
+    // and 1 (lazy, deeper trees); 0.7 is a good default.
+    //
+    // Only the bs_tree functions maintain the node count, so do not use the
+    // splay tree functions on a tree in scapegoat mode. The trees returned by
+    // the copy & set functions start with the mode turned off.
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
     // BINARY SEARCH TREES /////////////////////////////////////////////////////
 
     // STRUCTS:
@@ -60,17 +200,55 @@
         void           *data;   // Generic pointer to the content (never NULL)
         struct bs_node *left;   // Left subtree  (NULL if empty)
         struct bs_node *right;  // Right subtree (NULL if empty)
+    #ifdef TREE_KEY_PREFIX
+        uint64_t        prefix; // Prefix of data (see "bs_tree_set_prefix")
+    #endif
     } bs_node;
 
     typedef struct bs_tree {
         struct bs_node *root;                       // Root node of the tree
         int (* comp) (const void *, const void *);  // Comparing function
+        struct node_pool *pool;                     // Node pool (or NULL)
+    #ifdef TREE_KEY_PREFIX
+        uint64_t (* prefix) (const void *);         // Prefix function (or NULL)
+    #endif
+    #ifdef TREE_MIN_MAX
+        struct bs_node *leftmost;                   // Smallest node (or NULL)
+        struct bs_node *rightmost;                  // Biggest node (or NULL)
+    #endif
+    #ifdef SP_SPLAY_POLICY
+        int      splay_policy;                      // SP_SPLAY_ALWAYS, ...
+        uint64_t splay_param;                       // Threshold of the policy
+        uint64_t splay_state;                       // Counter or random state
+    #endif
+    #ifdef BS_SCAPEGOAT
+        double   alpha;                             // Balance (0 if mode off)
+        size_t   size;                              // Number of nodes
+        size_t   max_size;                          // Max size since rebuild
+    #endif
+    #ifdef TREE_STATS
+        struct tree_stats stats;                    // Operation counters
+    #endif
     } bs_tree;
 
+    typedef struct bs_cursor {
+        const struct bs_tree *tree;     // Tree being traversed
+        struct bs_node      **path;     // Path from the root to current node
+        size_t                size;     // Length of the path (0 if invalid)
+        size_t                capacity; // Allocated length of the path
+    } bs_cursor;
+
     // CREATION & INSERTION:
 
     bs_tree *new_bs_tree(int (* comp) (const void *, const void *));
 
+    bs_tree *new_bs_tree_with_pool(int (* comp) (const void *, const void *),
+                                   size_t capacity);
+
+    bs_tree *bs_tree_from_sorted_array(int (* comp) (const void *,
+                                                     const void *),
+                                       void **data, size_t n);
+
     bs_tree *bs_tree_copy(const bs_tree *tree);
 
     void *bs_tree_insert(bs_tree *tree, void *data);
@@ -93,6 +271,34 @@
 
     void *bs_tree_next(const bs_tree *tree, const void *data);
 
+    // BATCHES:
+
+    void bs_tree_insert_batch(bs_tree *tree, void **data, size_t n);
+
+    void bs_tree_search_batch(const bs_tree *tree, const void **keys,
+                              void **out, size_t n);
+
+    void bs_tree_search_interleaved(const bs_tree *tree, const void **keys,
+                                    void **out, size_t n);
+
+    // CURSORS:
+
+    bs_cursor *new_bs_cursor(const bs_tree *tree);
+
+    void  free_bs_cursor(bs_cursor *cursor);
+
+    void *bs_cursor_first(bs_cursor *cursor);
+
+    void *bs_cursor_last(bs_cursor *cursor);
+
+    void *bs_cursor_seek(bs_cursor *cursor, const void *data);
+
+    void *bs_cursor_next(bs_cursor *cursor);
+
+    void *bs_cursor_prev(bs_cursor *cursor);
+
+    void *bs_cursor_get(const bs_cursor *cursor);
+
     // REMOVE:
 
     void *bs_tree_remove(bs_tree *tree, const void *data);
@@ -121,6 +327,36 @@
 
     void bs_tree_rebalance(bs_tree *tree);
 
+    void bs_tree_rebalance_range(bs_tree *tree, const void *lo, const void *hi);
+
+    void bs_tree_rebalance_below(bs_tree *tree, const void *data);
+
+    #ifdef TREE_KEY_PREFIX
+
+    // KEY PREFIXES:
+
+    void bs_tree_set_prefix(bs_tree *tree, uint64_t (* prefix) (const void *));
+
+    #endif
+
+    #ifdef BS_SCAPEGOAT
+
+    // SCAPEGOAT MODE:
+
+    void bs_tree_set_scapegoat(bs_tree *tree, double alpha);
+
+    #endif
+
+    #ifdef TREE_STATS
+
+    // STATISTICS:
+
+    tree_stats bs_tree_get_stats(const bs_tree *tree);
+
+    void       bs_tree_reset_stats(bs_tree *tree);
+
+    #endif
+
     // DEBUG & VISUALIZATION:
 
     int  is_bs_tree(const bs_tree *tree);
@@ -137,29 +373,106 @@
 
     #define RED 1
     #define BLACK 0
-    #define IS_RED(p)   (((p) != NULL) && ((p)->color == RED))
-    #define IS_BLACK(p) (((p) == NULL) || ((p)->color == BLACK))
+    #define IS_RED(p)   (((p) != NULL) && (RB_COLOR(p) == RED))
+    #define IS_BLACK(p) (((p) == NULL) || (RB_COLOR(p) == BLACK))
+
+    // COLOR PACKING:
+    //
+    // If RB_PACKED_COLOR is defined at compile time, the color of each rb_node
+    // is stored in the lowest bit of its left pointer (which is always zero
+    // because nodes are at least 2-byte aligned) instead of in its own field.
+    // This shrinks every rb_node from 32 to 24 bytes on 64-bit platforms.
+    //
+    // Either way, the left child and the color of a node must only be accessed
+    // through the following macros:
+
+    #ifdef RB_PACKED_COLOR
+
+        #include <stdint.h>     // uintptr_t
+
+        #define RB_LEFT(p)  ((struct rb_node *) ((uintptr_t) (p)->left &     \
+                                                 ~(uintptr_t) 1))
+        #define RB_COLOR(p) ((int) ((uintptr_t) (p)->left & (uintptr_t) 1))
+
+        #define RB_SET_LEFT(p, l)                                            \
+            ((p)->left = (struct rb_node *) ((uintptr_t) (l) |               \
+                                             ((uintptr_t) (p)->left & 1)))
+        #define RB_SET_COLOR(p, c)                                           \
+            ((p)->left = (struct rb_node *) (((uintptr_t) (p)->left &        \
+                                              ~(uintptr_t) 1) |              \
+                                             (uintptr_t) ((c) & 1)))
+    #else
+
+        #define RB_LEFT(p)          ((p)->left)
+        #define RB_COLOR(p)         ((p)->color)
+        #define RB_SET_LEFT(p, l)   ((p)->left  = (l))
+        #define RB_SET_COLOR(p, c)  ((p)->color = (c))
+
+    #endif
+
+    // ORDER STATISTICS:
+    //
+    // If RB_ORDER_STATISTICS is defined at compile time, each rb_node also
+    // stores the number of nodes of its subtree. This costs one more word per
+    // node and a second O(log n) pass on every insertion and removal, but
+    // it provides the rb_tree_size, rb_tree_select, rb_tree_rank and
+    // rb_tree_count_range functions, all of them in O(log n) time.
 
     // STRUCTS:
 
     typedef struct rb_node {
         void           *data;   // Generic pointer to the content (never NULL)
-        struct rb_node *left;   // Left subtree  (NULL if empty)
+        struct rb_node *left;   // Left subtree  (NULL if empty) [+ color bit]
         struct rb_node *right;  // Right subtree (NULL if empty)
+    #ifndef RB_PACKED_COLOR
         char            color;  // Either RED (= 1) or BLACK (= 0)
+    #endif
+    #ifdef RB_ORDER_STATISTICS
+        size_t          size;   // Number of nodes of the subtree
+    #endif
+    #ifdef TREE_KEY_PREFIX
+        uint64_t        prefix; // Prefix of data (see "rb_tree_set_prefix")
+    #endif
     } rb_node;
 
     typedef struct rb_tree {
         struct rb_node *root;                       // Root node of the tree
         int (* comp) (const void *, const void *);  // Comparing function
+        struct node_pool *pool;                     // Node pool (or NULL)
+    #ifdef TREE_KEY_PREFIX
+        uint64_t (* prefix) (const void *);         // Prefix function (or NULL)
+    #endif
+    #ifdef TREE_MIN_MAX
+        struct rb_node *leftmost;                   // Smallest node (or NULL)
+        struct rb_node *rightmost;                  // Biggest node (or NULL)
+    #endif
+    #ifdef TREE_STATS
+        struct tree_stats stats;                    // Operation counters
+    #endif
     } rb_tree;
 
+    typedef struct rb_cursor {
+        const struct rb_tree *tree;     // Tree being traversed
+        struct rb_node      **path;     // Path from the root to current node
+        size_t                size;     // Length of the path (0 if invalid)
+        size_t                capacity; // Allocated length of the path
+    } rb_cursor;
+
     // CREATION & INSERTION:
 
     rb_tree *new_rb_tree(int (* comp) (const void *, const void *));
 
+    rb_tree *new_rb_tree_with_pool(int (* comp) (const void *, const void *),
+                                   size_t capacity);
+
+    rb_tree *rb_tree_from_sorted_array(int (* comp) (const void *,
+                                                     const void *),
+                                       void **data, size_t n);
+
     rb_tree *rb_tree_copy(const rb_tree *tree);
 
+    rb_tree *rb_tree_clone(const rb_tree *tree);
+
     void *rb_tree_insert(rb_tree *tree, void *data);
 
     void *rb_tree_insert_min(rb_tree *tree, void *data);
@@ -180,6 +493,49 @@
 
     void *rb_tree_next(const rb_tree *tree, const void *data);
 
+    // BATCHES:
+
+    void rb_tree_insert_batch(rb_tree *tree, void **data, size_t n);
+
+    void rb_tree_search_batch(const rb_tree *tree, const void **keys,
+                              void **out, size_t n);
+
+    void rb_tree_search_interleaved(const rb_tree *tree, const void **keys,
+                                    void **out, size_t n);
+
+    // CURSORS:
+
+    rb_cursor *new_rb_cursor(const rb_tree *tree);
+
+    void  free_rb_cursor(rb_cursor *cursor);
+
+    void *rb_cursor_first(rb_cursor *cursor);
+
+    void *rb_cursor_last(rb_cursor *cursor);
+
+    void *rb_cursor_seek(rb_cursor *cursor, const void *data);
+
+    void *rb_cursor_next(rb_cursor *cursor);
+
+    void *rb_cursor_prev(rb_cursor *cursor);
+
+    void *rb_cursor_get(const rb_cursor *cursor);
+
+    #ifdef RB_ORDER_STATISTICS
+
+    // ORDER STATISTICS:
+
+    size_t rb_tree_size(const rb_tree *tree);
+
+    void  *rb_tree_select(const rb_tree *tree, size_t k);
+
+    size_t rb_tree_rank(const rb_tree *tree, const void *data);
+
+    size_t rb_tree_count_range(const rb_tree *tree, const void *lo,
+                               const void *hi);
+
+    #endif
+
     // REMOVE:
 
     void *rb_tree_remove(rb_tree *tree, const void *data);
@@ -200,6 +556,42 @@
 
     rb_tree *rb_tree_sym_diff(const rb_tree *tree_1, const rb_tree *tree_2);
 
+    // SPLIT & JOIN:
+
+    rb_tree *rb_tree_split(rb_tree *tree, const void *data);
+
+    void rb_tree_join(rb_tree *tree_1, rb_tree *tree_2);
+
+    void rb_tree_join_union(rb_tree *tree_1, rb_tree *tree_2,
+                            void (* free_data) (void *));
+
+    void rb_tree_join_intersection(rb_tree *tree_1, rb_tree *tree_2,
+                                   void (* free_data) (void *));
+
+    void rb_tree_join_diff(rb_tree *tree_1, rb_tree *tree_2,
+                           void (* free_data) (void *));
+
+    void rb_tree_join_sym_diff(rb_tree *tree_1, rb_tree *tree_2,
+                               void (* free_data) (void *));
+
+    #ifdef TREE_KEY_PREFIX
+
+    // KEY PREFIXES:
+
+    void rb_tree_set_prefix(rb_tree *tree, uint64_t (* prefix) (const void *));
+
+    #endif
+
+    #ifdef TREE_STATS
+
+    // STATISTICS:
+
+    tree_stats rb_tree_get_stats(const rb_tree *tree);
+
+    void       rb_tree_reset_stats(rb_tree *tree);
+
+    #endif
+
     // DEBUG & VISUALIZATION:
 
     int  is_rb_tree(const rb_tree *tree);
@@ -214,14 +606,24 @@
 
     // STRUCTS:
 
-    typedef bs_tree sp_tree;    // Splay Trees are just Binary Search Trees
-    typedef bs_node sp_node;    // Splay Nodes are just Binary Search Nodes
+    typedef bs_tree   sp_tree;    // Splay Trees are just Binary Search Trees
+    typedef bs_node   sp_node;    // Splay Nodes are just Binary Search Nodes
+    typedef bs_cursor sp_cursor;  // And Splay Cursors are Binary Search Cursors
 
     // CREATION & INSERTION:
 
     sp_tree *new_sp_tree(int (* comp) (const void *, const void *));
 
-    sp_tree *sp_tree_copy(sp_tree *tree);
+    sp_tree *new_sp_tree_with_pool(int (* comp) (const void *, const void *),
+                                   size_t capacity);
+
+    sp_tree *sp_tree_from_sorted_array(int (* comp) (const void *,
+                                                     const void *),
+                                       void **data, size_t n);
+
+    sp_tree *sp_tree_copy(const sp_tree *tree);
+
+    sp_tree *sp_tree_clone(const sp_tree *tree);
 
     void *sp_tree_insert(sp_tree *tree, void *data);
 
@@ -243,6 +645,34 @@
 
     void *sp_tree_next(sp_tree *tree, const void *data);
 
+    // BATCHES:
+
+    void sp_tree_insert_batch(sp_tree *tree, void **data, size_t n);
+
+    void sp_tree_search_batch(sp_tree *tree, const void **keys, void **out,
+                              size_t n);
+
+    void sp_tree_search_interleaved(sp_tree *tree, const void **keys,
+                                    void **out, size_t n);
+
+    // CURSORS:
+
+    sp_cursor *new_sp_cursor(const sp_tree *tree);
+
+    void  free_sp_cursor(sp_cursor *cursor);
+
+    void *sp_cursor_first(sp_cursor *cursor);
+
+    void *sp_cursor_last(sp_cursor *cursor);
+
+    void *sp_cursor_seek(sp_cursor *cursor, const void *data);
+
+    void *sp_cursor_next(sp_cursor *cursor);
+
+    void *sp_cursor_prev(sp_cursor *cursor);
+
+    void *sp_cursor_get(const sp_cursor *cursor);
+
     // REMOVE:
 
     void *sp_tree_remove(sp_tree *tree, const void *data);
@@ -255,13 +685,39 @@
 
     // SET FUNCTIONS:
 
-    sp_tree *sp_tree_union(sp_tree *tree_1, sp_tree *tree_2);
+    sp_tree *sp_tree_union(const sp_tree *tree_1, const sp_tree *tree_2);
+
+    sp_tree *sp_tree_intersection(const sp_tree *tree_1, const sp_tree *tree_2);
+
+    sp_tree *sp_tree_diff(const sp_tree *tree_1, const sp_tree *tree_2);
+
+    sp_tree *sp_tree_sym_diff(const sp_tree *tree_1, const sp_tree *tree_2);
 
-    sp_tree *sp_tree_intersection(sp_tree *tree_1, sp_tree *tree_2);
+    #ifdef TREE_KEY_PREFIX
 
-    sp_tree *sp_tree_diff(sp_tree *tree_1, sp_tree *tree_2);
+    // KEY PREFIXES:
 
-    sp_tree *sp_tree_sym_diff(sp_tree *tree_1, sp_tree *tree_2);
+    void sp_tree_set_prefix(sp_tree *tree, uint64_t (* prefix) (const void *));
+
+    #endif
+
+    #ifdef SP_SPLAY_POLICY
+
+    // SPLAYING POLICIES:
+
+    void sp_tree_set_splay_policy(sp_tree *tree, int policy, double param);
+
+    #endif
+
+    #ifdef TREE_STATS
+
+    // STATISTICS:
+
+    tree_stats sp_tree_get_stats(const sp_tree *tree);
+
+    void       sp_tree_reset_stats(sp_tree *tree);
+
+    #endif
 
     // DEBUG & VISUALIZATION:
 
@@ -271,6 +727,703 @@
 
     ////////////////////////////////////////////////////////////////////////////
 
+
+    // RED BLACK TREES WITH INTEGER KEYS ///////////////////////////////////////
+
+    // These are red black trees that store an integer key inside each node and
+    // compare it directly, without any comparing function. Use rb_tree_u64 for
+    // uint64_t keys and rb_tree_i64 for int64_t keys (it is the same tree, but
+    // its functions translate the signed keys to unsigned ones and back).
+    //
+    // They do not support RB_ORDER_STATISTICS, TREE_STATS, cursors, batches or
+    // split & join (use a regular rb_tree for that).
+
+    #include <stdint.h>     // uint64_t, int64_t, uintptr_t
+
+    // COLOR PACKING (see the red black trees above):
+
+    #ifdef RB_PACKED_COLOR
+
+        #define RB64_LEFT(p) ((struct rb_node_u64 *) ((uintptr_t) (p)->left & \
+                                                      ~(uintptr_t) 1))
+        #define RB64_SET_LEFT(p, l)                                          \
+            ((p)->left = (struct rb_node_u64 *) ((uintptr_t) (l) |           \
+                                                 ((uintptr_t) (p)->left & 1)))
+        #define RB64_SET_COLOR(p, c)                                         \
+            ((p)->left = (struct rb_node_u64 *) (((uintptr_t) (p)->left &    \
+                                                  ~(uintptr_t) 1) |          \
+                                                 (uintptr_t) ((c) & 1)))
+    #else
+
+        #define RB64_LEFT(p)          ((p)->left)
+        #define RB64_SET_LEFT(p, l)   ((p)->left  = (l))
+        #define RB64_SET_COLOR(p, c)  ((p)->color = (c))
+
+    #endif
+
+    // STRUCTS:
+
+    typedef struct rb_node_u64 {
+        uint64_t            key;    // Key of the node
+        struct rb_node_u64 *left;   // Left subtree  (NULL if empty) [+ color]
+        struct rb_node_u64 *right;  // Right subtree (NULL if empty)
+        void               *data;   // Generic pointer to the content (not NULL)
+    #ifndef RB_PACKED_COLOR
+        char                color;  // Either RED (= 1) or BLACK (= 0)
+    #endif
+    } rb_node_u64;
+
+    typedef struct rb_tree_u64 {
+        struct rb_node_u64 *root;   // Root node of the tree
+        struct node_pool   *pool;   // Node pool (or NULL)
+    } rb_tree_u64;
+
+    typedef rb_tree_u64 rb_tree_i64;    // Signed keys live in the same trees
+
+    // CREATION & INSERTION:
+
+    rb_tree_u64 *new_rb_tree_u64(void);
+
+    rb_tree_u64 *new_rb_tree_u64_with_pool(size_t capacity);
+
+    rb_tree_u64 *rb_tree_u64_copy(const rb_tree_u64 *tree);
+
+    void *rb_tree_u64_insert(rb_tree_u64 *tree, uint64_t key, void *data);
+
+    void *rb_tree_u64_insert_min(rb_tree_u64 *tree, uint64_t key, void *data);
+
+    void *rb_tree_u64_insert_max(rb_tree_u64 *tree, uint64_t key, void *data);
+
+    // SEARCH:
+
+    int   rb_tree_u64_is_empty(const rb_tree_u64 *tree);
+
+    void *rb_tree_u64_search(const rb_tree_u64 *tree, uint64_t key);
+
+    void *rb_tree_u64_min(const rb_tree_u64 *tree, uint64_t *min_key);
+
+    void *rb_tree_u64_max(const rb_tree_u64 *tree, uint64_t *max_key);
+
+    void *rb_tree_u64_prev(const rb_tree_u64 *tree, uint64_t key,
+                           uint64_t *prev_key);
+
+    void *rb_tree_u64_next(const rb_tree_u64 *tree, uint64_t key,
+                           uint64_t *next_key);
+
+    // REMOVE:
+
+    void *rb_tree_u64_remove(rb_tree_u64 *tree, uint64_t key);
+
+    void *rb_tree_u64_remove_min(rb_tree_u64 *tree, uint64_t *min_key);
+
+    void *rb_tree_u64_remove_max(rb_tree_u64 *tree, uint64_t *max_key);
+
+    void  rb_tree_u64_remove_all(rb_tree_u64 *tree,
+                                 void (* free_data) (void *));
+
+    // SET FUNCTIONS:
+
+    rb_tree_u64 *rb_tree_u64_union(const rb_tree_u64 *tree_1,
+                                   const rb_tree_u64 *tree_2);
+
+    rb_tree_u64 *rb_tree_u64_intersection(const rb_tree_u64 *tree_1,
+                                          const rb_tree_u64 *tree_2);
+
+    rb_tree_u64 *rb_tree_u64_diff(const rb_tree_u64 *tree_1,
+                                  const rb_tree_u64 *tree_2);
+
+    rb_tree_u64 *rb_tree_u64_sym_diff(const rb_tree_u64 *tree_1,
+                                      const rb_tree_u64 *tree_2);
+
+    // SIGNED KEYS:
+
+    #define new_rb_tree_i64             new_rb_tree_u64
+    #define new_rb_tree_i64_with_pool   new_rb_tree_u64_with_pool
+    #define rb_tree_i64_copy            rb_tree_u64_copy
+    #define rb_tree_i64_is_empty        rb_tree_u64_is_empty
+    #define rb_tree_i64_remove_all      rb_tree_u64_remove_all
+    #define rb_tree_i64_union           rb_tree_u64_union
+    #define rb_tree_i64_intersection    rb_tree_u64_intersection
+    #define rb_tree_i64_diff            rb_tree_u64_diff
+    #define rb_tree_i64_sym_diff        rb_tree_u64_sym_diff
+    #define is_rb_tree_i64              is_rb_tree_u64
+    #define print_rb_tree_i64           print_rb_tree_u64
+
+    void *rb_tree_i64_insert(rb_tree_i64 *tree, int64_t key, void *data);
+
+    void *rb_tree_i64_insert_min(rb_tree_i64 *tree, int64_t key, void *data);
+
+    void *rb_tree_i64_insert_max(rb_tree_i64 *tree, int64_t key, void *data);
+
+    void *rb_tree_i64_search(const rb_tree_i64 *tree, int64_t key);
+
+    void *rb_tree_i64_min(const rb_tree_i64 *tree, int64_t *min_key);
+
+    void *rb_tree_i64_max(const rb_tree_i64 *tree, int64_t *max_key);
+
+    void *rb_tree_i64_prev(const rb_tree_i64 *tree, int64_t key,
+                           int64_t *prev_key);
+
+    void *rb_tree_i64_next(const rb_tree_i64 *tree, int64_t key,
+                           int64_t *next_key);
+
+    void *rb_tree_i64_remove(rb_tree_i64 *tree, int64_t key);
+
+    void *rb_tree_i64_remove_min(rb_tree_i64 *tree, int64_t *min_key);
+
+    void *rb_tree_i64_remove_max(rb_tree_i64 *tree, int64_t *max_key);
+
+    // DEBUG & VISUALIZATION:
+
+    int  is_rb_tree_u64(const rb_tree_u64 *tree);
+
+    void print_rb_tree_u64(const rb_tree_u64 *tree,
+                           void (* print_node) (const void *));
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // FROZEN TREES ////////////////////////////////////////////////////////////
+
+    // A frozen_tree is an immutable snapshot of a bs_tree, sp_tree or rb_tree
+    // for trees that are built once and then queried many, many times (splay
+    // trees are binary search trees, so they are frozen by "bs_tree_freeze").
+    //
+    // The snapshot is perfectly balanced and all its nodes live in a single
+    // contiguous array in van Emde Boas order: the top half of the levels is
+    // stored first (recursively in the same order) followed by each one of
+    // the subtrees hanging from it (recursively in the same order). Any path
+    // from the root crosses O(log_B(n)) blocks of B nodes, whatever B is, so
+    // the layout is close to optimal for every cache level (and for the TLB)
+    // without knowing their sizes.
+    //
+    // The data pointers are the same as in the source tree (so you must not
+    // free the data while the snapshot is alive) but the snapshot never
+    // changes: you can modify or destroy the source tree afterwards and many
+    // threads can query the same snapshot at the same time. The whole
+    // snapshot is a single block of memory, so you can destroy it with:
+    //
+    //      free(frozen);
+
+    #define FROZEN_NULL ((size_t) -1)   // Index of an empty subtree
+
+    // STRUCTS:
+
+    typedef struct frozen_node {
+        void   *data;           // Generic pointer to the content (never NULL)
+        size_t  left;           // Index of the left subtree  (or FROZEN_NULL)
+        size_t  right;          // Index of the right subtree (or FROZEN_NULL)
+    } frozen_node;
+
+    typedef struct frozen_tree {
+        struct frozen_node *nodes;                  // Nodes (root first)
+        size_t              size;                   // Number of nodes
+        int (* comp) (const void *, const void *);  // Comparing function
+    } frozen_tree;
+
+    // CREATION:
+
+    frozen_tree *bs_tree_freeze(const bs_tree *tree);
+
+    frozen_tree *rb_tree_freeze(const rb_tree *tree);
+
+    // SEARCH:
+
+    size_t frozen_tree_size(const frozen_tree *tree);
+
+    void  *frozen_tree_search(const frozen_tree *tree, const void *data);
+
+    void  *frozen_tree_min(const frozen_tree *tree);
+
+    void  *frozen_tree_max(const frozen_tree *tree);
+
+    void  *frozen_tree_prev(const frozen_tree *tree, const void *data);
+
+    void  *frozen_tree_next(const frozen_tree *tree, const void *data);
+
+    // RANGES:
+
+    void  *frozen_tree_select(const frozen_tree *tree, size_t k);
+
+    size_t frozen_tree_rank(const frozen_tree *tree, const void *data);
+
+    size_t frozen_tree_count_range(const frozen_tree *tree, const void *lo,
+                                   const void *hi);
+
+    // DEBUG:
+
+    int is_frozen_tree(const frozen_tree *tree);
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // EYTZINGER INDEXES ///////////////////////////////////////////////////////
+
+    // An eytzinger_u64 is a read-only index of the keys of a rb_tree_u64 (or
+    // rb_tree_i64) for static sets that get a lot of lookups.
+    //
+    // The keys are stored in a plain array in breadth-first order (the root
+    // in keys[1] and the children of keys[i] in keys[2i] & keys[2i+1]), so a
+    // search needs no pointers at all: it computes the next index with one
+    // comparison and no branches, and it prefetches the 16 descendants that
+    // are 4 levels ahead (they share a couple of cache lines). The data
+    // pointers live in a separate array, so they do not dilute the keys.
+    //
+    // The searches return the same data pointers as the source tree, which
+    // can be modified or destroyed afterwards. The whole index is a single
+    // block of memory, so you can destroy it with:
+    //
+    //      free(index);
+
+    // STRUCTS:
+
+    typedef struct eytzinger_u64 {
+        uint64_t  *keys;    // Keys in breadth-first order (keys[0] is unused)
+        void     **data;    // Data of each key (data[i] belongs to keys[i])
+        size_t     size;    // Number of keys
+        int        levels;  // Levels that every search goes through
+    } eytzinger_u64;
+
+    typedef eytzinger_u64 eytzinger_i64;  // The same index with signed keys
+
+    // CREATION:
+
+    eytzinger_u64 *rb_tree_u64_to_eytzinger(const rb_tree_u64 *tree);
+
+    #define rb_tree_i64_to_eytzinger    rb_tree_u64_to_eytzinger
+
+    // SEARCH:
+
+    void *eytzinger_u64_search(const eytzinger_u64 *index, uint64_t key);
+
+    void  eytzinger_u64_search_batch(const eytzinger_u64 *index,
+                                     const uint64_t *keys, void **out,
+                                     size_t n);
+
+    void *eytzinger_i64_search(const eytzinger_i64 *index, int64_t key);
+
+    void  eytzinger_i64_search_batch(const eytzinger_i64 *index,
+                                     const int64_t *keys, void **out,
+                                     size_t n);
+
+    // DEBUG:
+
+    int is_eytzinger_u64(const eytzinger_u64 *index);
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // B-TREES /////////////////////////////////////////////////////////////////
+
+    // A bp_tree is a B-tree whose nodes store up to BP_ORDER - 1 elements (and
+    // up to BP_ORDER subtrees) instead of a single one. Every node but the
+    // root is at least half full and all the leaves are at the same depth, so
+    // a search visits O(log(n) / log(BP_ORDER)) nodes instead of O(log(n)),
+    // and each one of those nodes is a single cache miss: on 64-bit platforms
+    // the elements of a node fill exactly one 64-byte cache line, and the
+    // subtrees of an internal node fill the next one (leaves do not have them,
+    // so they only take one cache line).
+    //
+    // Each element is stored exactly once (no separator copies), so you can
+    // free the data returned by "bp_tree_remove" right away. The functions
+    // follow the same contract as the bs_tree, rb_tree and sp_tree ones, so you
+    // only need to change the prefix of the functions to try this variant.
+    //
+    // BP_ORDER must be even (and at least 4).
+
+    #define BP_ORDER 8      // Maximum number of subtrees of a bp_node
+
+    // STRUCTS:
+
+    typedef struct bp_node {
+        void           *data[BP_ORDER - 1]; // Sorted content (never NULL)
+        int             size;               // Number of elements in data
+        int             leaf;               // YES if the node has no subtrees
+        struct bp_node *child[];            // size + 1 subtrees (if not leaf)
+    } bp_node;
+
+    typedef struct bp_tree {
+        struct bp_node *root;                       // Root node of the tree
+        int (* comp) (const void *, const void *);  // Comparing function
+        size_t size;                                // Number of elements
+    #ifdef TREE_STATS
+        struct tree_stats stats;                    // Operation counters
+    #endif
+    } bp_tree;
+
+    // CREATION & INSERTION:
+
+    bp_tree *new_bp_tree(int (* comp) (const void *, const void *));
+
+    bp_tree *bp_tree_from_sorted_array(int (* comp) (const void *,
+                                                     const void *),
+                                       void **data, size_t n);
+
+    bp_tree *bp_tree_copy(const bp_tree *tree);
+
+    void *bp_tree_insert(bp_tree *tree, void *data);
+
+    void *bp_tree_insert_min(bp_tree *tree, void *data);
+
+    void *bp_tree_insert_max(bp_tree *tree, void *data);
+
+    // SEARCH:
+
+    int   bp_tree_is_empty(const bp_tree *tree);
+
+    void *bp_tree_search(const bp_tree *tree, const void *data);
+
+    void *bp_tree_min(const bp_tree *tree);
+
+    void *bp_tree_max(const bp_tree *tree);
+
+    void *bp_tree_prev(const bp_tree *tree, const void *data);
+
+    void *bp_tree_next(const bp_tree *tree, const void *data);
+
+    // REMOVE:
+
+    void *bp_tree_remove(bp_tree *tree, const void *data);
+
+    void *bp_tree_remove_min(bp_tree *tree);
+
+    void *bp_tree_remove_max(bp_tree *tree);
+
+    void bp_tree_remove_all(bp_tree *tree, void (* free_data) (void *));
+
+    // SET FUNCTIONS:
+
+    bp_tree *bp_tree_union(const bp_tree *tree_1, const bp_tree *tree_2);
+
+    bp_tree *bp_tree_intersection(const bp_tree *tree_1, const bp_tree *tree_2);
+
+    bp_tree *bp_tree_diff(const bp_tree *tree_1, const bp_tree *tree_2);
+
+    bp_tree *bp_tree_sym_diff(const bp_tree *tree_1, const bp_tree *tree_2);
+
+    #ifdef TREE_STATS
+
+    // STATISTICS:
+
+    tree_stats bp_tree_get_stats(const bp_tree *tree);
+
+    void       bp_tree_reset_stats(bp_tree *tree);
+
+    #endif
+
+    // DEBUG & VISUALIZATION:
+
+    int  is_bp_tree(const bp_tree *tree);
+
+    void print_bp_tree(const bp_tree *tree, void (* print_node) (const void *));
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // SHARDED TREES ///////////////////////////////////////////////////////////
+
+    // A sharded_rb_tree splits the range of the keys among several rb_trees
+    // (its shards) and protects each one of them with its own lock, so many
+    // threads can insert, search and remove elements at the same time as long
+    // as they work on different ranges. It is only available if RB_THREADS is
+    // defined at compile time (remember to link with -pthread).
+    //
+    // Shard i holds the elements e such that splits[i-1] <= e < splits[i],
+    // where splits[i] is always the smallest element of shard i+1 (or NULL,
+    // which stands for +infinity, when shard i+1 and all the following ones
+    // are empty). A new tree keeps everything in its first shard. Whenever a
+    // shard grows beyond twice the average size, the tree moves its split
+    // points (joining and splitting the shards with "rb_tree_join" and
+    // "rb_tree_split") so that every shard holds the same number of elements.
+    //
+    // Every function is thread-safe. Searches, insertions and removals take
+    // the layout lock in read mode and then the lock of their shard (prev &
+    // next may visit a few shards, one after the other). Rebalancing, as well
+    // as removing or replacing the smallest element of a shard (which changes
+    // a split point), takes the layout lock in write mode and stops all the
+    // other threads while it runs. The set functions lock both trees whole.
+    //
+    // The returned data pointers are not protected by any lock, so you must
+    // not free an element while another thread may still be using it. Destroy
+    // the tree with:
+    //
+    //      sharded_rb_tree_remove_all(tree, free_data);
+    //      free_sharded_rb_tree(tree);
+
+    #ifdef RB_THREADS
+
+    #include <pthread.h>        // pthread_mutex_t
+
+    // STRUCTS:
+
+    typedef struct rb_shard {
+        struct rb_tree  *tree;      // Elements of the shard
+        size_t           size;      // Number of elements of the shard
+        pthread_mutex_t  lock;      // Lock of the shard
+        char             pad[64];   // Keep each lock in its own cache line
+    } rb_shard;
+
+    typedef struct sharded_rb_tree {
+        struct rb_shard       *shards;  // Shards (sorted by their ranges)
+        void                 **splits;  // Smallest element of shards 1 to n-1
+        size_t                 n;       // Number of shards
+        size_t                 limit;   // Shard size that triggers a rebalance
+        struct sharded_layout *layout;  // Lock that protects the splits
+        int (* comp) (const void *, const void *);  // Comparing function
+    } sharded_rb_tree;
+
+    // CREATION & INSERTION:
+
+    sharded_rb_tree *new_sharded_rb_tree(int (* comp) (const void *,
+                                                       const void *),
+                                         size_t shards);
+
+    void  free_sharded_rb_tree(sharded_rb_tree *tree);
+
+    void *sharded_rb_tree_insert(sharded_rb_tree *tree, void *data);
+
+    // SEARCH:
+
+    int    sharded_rb_tree_is_empty(sharded_rb_tree *tree);
+
+    size_t sharded_rb_tree_size(sharded_rb_tree *tree);
+
+    void  *sharded_rb_tree_search(sharded_rb_tree *tree, const void *data);
+
+    void  *sharded_rb_tree_min(sharded_rb_tree *tree);
+
+    void  *sharded_rb_tree_max(sharded_rb_tree *tree);
+
+    void  *sharded_rb_tree_prev(sharded_rb_tree *tree, const void *data);
+
+    void  *sharded_rb_tree_next(sharded_rb_tree *tree, const void *data);
+
+    // REMOVE:
+
+    void *sharded_rb_tree_remove(sharded_rb_tree *tree, const void *data);
+
+    void *sharded_rb_tree_remove_min(sharded_rb_tree *tree);
+
+    void *sharded_rb_tree_remove_max(sharded_rb_tree *tree);
+
+    void  sharded_rb_tree_remove_all(sharded_rb_tree *tree,
+                                     void (* free_data) (void *));
+
+    // SET FUNCTIONS:
+
+    sharded_rb_tree *sharded_rb_tree_union(sharded_rb_tree *tree_1,
+                                           sharded_rb_tree *tree_2);
+
+    sharded_rb_tree *sharded_rb_tree_intersection(sharded_rb_tree *tree_1,
+                                                  sharded_rb_tree *tree_2);
+
+    sharded_rb_tree *sharded_rb_tree_diff(sharded_rb_tree *tree_1,
+                                          sharded_rb_tree *tree_2);
+
+    sharded_rb_tree *sharded_rb_tree_sym_diff(sharded_rb_tree *tree_1,
+                                              sharded_rb_tree *tree_2);
+
+    // REBALANCE:
+
+    void sharded_rb_tree_rebalance(sharded_rb_tree *tree);
+
+    // DEBUG & VISUALIZATION:
+
+    int  is_sharded_rb_tree(sharded_rb_tree *tree);
+
+    void print_sharded_rb_tree(sharded_rb_tree *tree,
+                               void (* print_node) (const void *));
+
+    #endif
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // CONCURRENT TREES ////////////////////////////////////////////////////////
+
+    // A concurrent_rb_tree is a rb_tree for workloads made almost entirely of
+    // reads: searches, min, max, prev & next never take a lock, while writers
+    // take turns on a single mutex. It is only available if RB_THREADS is
+    // defined at compile time (remember to link with -pthread) and it relies
+    // on the __atomic builtins of GCC & Clang.
+    //
+    // Readers are optimistic: every writer makes the sequence number odd while
+    // it changes the tree and even again when it is done, and a reader only
+    // trusts what it read from a node if the sequence number did not move in
+    // the meantime (otherwise it starts over, and it takes the mutex after a
+    // few failed attempts so it cannot starve). The nodes come from a node
+    // pool, so their memory stays valid even if a writer releases them under
+    // the feet of a reader. Since writers use the plain rb_tree functions,
+    // ThreadSanitizer reports these optimistic reads as data races.
+    //
+    // The elements themselves are protected by epochs: readers announce
+    // themselves in the counter of the current epoch (one of two, spread over
+    // several cache lines) and every writer that removes or replaces an
+    // element starts a new epoch and waits until all the readers of the old
+    // one have left before returning it. Therefore, once a function hands you
+    // back an element, no reader is comparing against it anymore and you may
+    // free it (but other threads that found it before may still hold it).
+    //
+    // Destroy the tree with:
+    //
+    //      concurrent_rb_tree_remove_all(tree, free_data);
+    //      free_concurrent_rb_tree(tree);
+
+    #ifdef RB_THREADS
+
+    #include <pthread.h>        // pthread_mutex_t
+
+    // STRUCTS:
+
+    typedef struct concurrent_rb_tree {
+        struct rb_tree            *tree;    // Elements (nodes from a pool)
+        size_t                     size;    // Number of elements
+        unsigned long              seq;     // Sequence number (odd = writing)
+        unsigned long              epoch;   // Current epoch of the readers
+        struct concurrent_readers *readers; // Readers inside each epoch
+        pthread_mutex_t            lock;    // Lock of the writers
+    } concurrent_rb_tree;
+
+    // CREATION & INSERTION:
+
+    concurrent_rb_tree *new_concurrent_rb_tree(int (* comp) (const void *,
+                                                             const void *));
+
+    void     free_concurrent_rb_tree(concurrent_rb_tree *tree);
+
+    rb_tree *concurrent_rb_tree_copy(concurrent_rb_tree *tree);
+
+    void    *concurrent_rb_tree_insert(concurrent_rb_tree *tree, void *data);
+
+    // SEARCH:
+
+    int    concurrent_rb_tree_is_empty(concurrent_rb_tree *tree);
+
+    size_t concurrent_rb_tree_size(concurrent_rb_tree *tree);
+
+    void  *concurrent_rb_tree_search(concurrent_rb_tree *tree,
+                                     const void *data);
+
+    void  *concurrent_rb_tree_min(concurrent_rb_tree *tree);
+
+    void  *concurrent_rb_tree_max(concurrent_rb_tree *tree);
+
+    void  *concurrent_rb_tree_prev(concurrent_rb_tree *tree, const void *data);
+
+    void  *concurrent_rb_tree_next(concurrent_rb_tree *tree, const void *data);
+
+    // REMOVE:
+
+    void *concurrent_rb_tree_remove(concurrent_rb_tree *tree,
+                                    const void *data);
+
+    void *concurrent_rb_tree_remove_min(concurrent_rb_tree *tree);
+
+    void *concurrent_rb_tree_remove_max(concurrent_rb_tree *tree);
+
+    void  concurrent_rb_tree_remove_all(concurrent_rb_tree *tree,
+                                        void (* free_data) (void *));
+
+    // DEBUG & VISUALIZATION:
+
+    int  is_concurrent_rb_tree(concurrent_rb_tree *tree);
+
+    void print_concurrent_rb_tree(concurrent_rb_tree *tree,
+                                  void (* print_node) (const void *));
+
+    #endif
+
+    ////////////////////////////////////////////////////////////////////////////
+
+
+    // PERSISTENT TREES ////////////////////////////////////////////////////////
+
+    // A prb_tree is a persistent Red Black tree: "prb_tree_snapshot" returns
+    // a new version of the tree in O(1) time and space, and from then on both
+    // versions behave as independent trees that share all their nodes until
+    // they are changed.
+    //
+    // Every node counts how many links (from trees or from other nodes) point
+    // to it. Insertions and removals copy every shared node of the path they
+    // walk (plus the siblings they recolor or rotate) before changing it, so
+    // they never touch a node visible from another version and they take
+    // O(log n) time and extra memory. A node is released when its last link
+    // is gone. With RB_THREADS the counters are atomic, so different versions
+    // can be used (and released) by different threads at the same time, but
+    // each version must still be used by one thread at a time.
+    //
+    // The elements are shared as well: removing an element from a version
+    // does not remove it from the others, so only free it once no version
+    // holds it anymore. Destroy each version with "free_prb_tree".
+    //
+    // Unlike rb_trees, insertions and removals walk down the tree copying the
+    // path into an explicit stack (of at most PRB_MAX_HEIGHT nodes) and then
+    // repair the tree bottom-up, since the top-down algorithms would need to
+    // copy a second path for the rotations they make on the way down.
+
+    #define PRB_MAX_HEIGHT 128  // Maximum height of a prb_tree
+
+    // STRUCTS:
+
+    typedef struct prb_node {
+        void            *data;  // Generic pointer to the content (never NULL)
+        struct prb_node *left;  // Left subtree  (NULL if empty)
+        struct prb_node *right; // Right subtree (NULL if empty)
+        size_t           refs;  // Number of links to this node
+        char             color; // Either RED (= 1) or BLACK (= 0)
+    } prb_node;
+
+    typedef struct prb_tree {
+        struct prb_node *root;                      // Root node of the tree
+        size_t           size;                      // Number of elements
+        int (* comp) (const void *, const void *);  // Comparing function
+    } prb_tree;
+
+    // CREATION & INSERTION:
+
+    prb_tree *new_prb_tree(int (* comp) (const void *, const void *));
+
+    prb_tree *prb_tree_snapshot(const prb_tree *tree);
+
+    void      free_prb_tree(prb_tree *tree);
+
+    void     *prb_tree_insert(prb_tree *tree, void *data);
+
+    // SEARCH:
+
+    int    prb_tree_is_empty(const prb_tree *tree);
+
+    size_t prb_tree_size(const prb_tree *tree);
+
+    void  *prb_tree_search(const prb_tree *tree, const void *data);
+
+    void  *prb_tree_min(const prb_tree *tree);
+
+    void  *prb_tree_max(const prb_tree *tree);
+
+    void  *prb_tree_prev(const prb_tree *tree, const void *data);
+
+    void  *prb_tree_next(const prb_tree *tree, const void *data);
+
+    // REMOVE:
+
+    void *prb_tree_remove(prb_tree *tree, const void *data);
+
+    void *prb_tree_remove_min(prb_tree *tree);
+
+    void *prb_tree_remove_max(prb_tree *tree);
+
+    void  prb_tree_remove_all(prb_tree *tree);
+
+    // DEBUG & VISUALIZATION:
+
+    int  is_prb_tree(const prb_tree *tree);
+
+    void print_prb_tree(const prb_tree *tree,
+                        void (* print_node) (const void *));
+
+    ////////////////////////////////////////////////////////////////////////////
+
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
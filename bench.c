@@ -0,0 +1,778 @@
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+//      bench.c                                                               //
+//      -------                                                               //
+//                                                                            //
+// Content: A benchmark driver for the BinaryTrees library.                   //
+// Author:  Carlos Luna-Mota <el.luna@gmail.com>                              //
+// Date:    October 2026                                                      //
+//                                                                            //
+// This is free and unencumbered software released into the public domain.    //
+//                                                                            //
+// Anyone is free to copy, modify, publish, use, compile, sell, or            //
+// distribute this software, either in source code form or as a compiled      //
+// binary, for any purpose, commercial or non-commercial, and by any means.   //
+//                                                                            //
+// In jurisdictions that recognize copyright laws, the author or authors of   //
+// this software dedicate any and all copyright interest in the software to   //
+// the public domain. We make this dedication for the benefit of the public   //
+// at large and to the detriment of our heirs and successors. We intend this  //
+// dedication to be an overt act of relinquishment in perpetuity of all       //
+// present and future rights to this software under copyright law.            //
+//                                                                            //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,            //
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF         //
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.     //
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR          //
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,      //
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR      //
+// OTHER DEALINGS IN THE SOFTWARE.                                            //
+//                                                                            //
+// For more information, please refer to <http://unlicense.org>               //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// Usage: ./bench [-n size] [-o ops] [-d dists] [-m mixes] [-v variants]      //
+//                [-s seed] [-t seconds] [-p]                                 //
+//                                                                            //
+//   -n size      Elements preloaded in the tree (default 1000000, "1e8" ok)  //
+//   -o ops       Operations measured after the preload (default: size)       //
+//   -d dists     uniform, sequential, zipfian, clustered, adversarial, all   //
+//   -m mixes     read, write, scan, queue, all                               //
+//   -v variants  bs, rb, sp, u64, bp (default: all of them)                  //
+//   -s seed      Random seed (default 1, so runs are repeatable)             //
+//   -t seconds   Time budget of every run (default 60)                       //
+//   -p           Create the trees with a node pool (bp trees have none)      //
+//                                                                            //
+// Lists are comma separated (e.g. "-d uniform,zipfian -m read,write").       //
+// Every run happens in its own process, so its peak RSS is its own.          //
+//                                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// LIBRARIES ///////////////////////////////////////////////////////////////////
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>             // malloc, free, strtod, exit
+#include <stdint.h>             // uint64_t
+#include <string.h>             // strcmp, strchr, memset
+#include <stdio.h>              // printf, fprintf, stderr
+#include <math.h>               // pow
+#include <time.h>               // clock_gettime
+#include <unistd.h>             // getopt, fork
+#include <sys/wait.h>           // waitpid
+#include <sys/resource.h>       // getrusage
+#include "BinaryTrees.h"        // BinaryTrees library headers
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// DEFINITIONS: ////////////////////////////////////////////////////////////////
+
+// Dummy data holder, just contains an integer key:
+typedef struct MyData { uint64_t key; } MyData;
+
+// Comparing function:
+int MyComp(const void *ptr1, const void *ptr2) {
+    const MyData *d1 = (const MyData *) ptr1;
+    const MyData *d2 = (const MyData *) ptr2;
+    if      (d1->key < d2->key) { return -1; }
+    else if (d1->key > d2->key) { return +1; }
+    else                        { return  0; }
+}
+
+#define SCAN_LENGTH 100         // Elements visited by every scan
+
+// Key distributions:
+enum { UNIFORM, SEQUENTIAL, ZIPFIAN, CLUSTERED, ADVERSARIAL, NUM_DISTS };
+static const char *dist_names[NUM_DISTS] = {
+    "uniform", "sequential", "zipfian", "clustered", "adversarial"
+};
+
+// Operation mixes:
+enum { READ, WRITE, SCAN, QUEUE, NUM_MIXES };
+static const char *mix_names[NUM_MIXES] = {
+    "read", "write", "scan", "queue"
+};
+
+// Tree variants:
+enum { BS, RB, SP, U64, BP, NUM_VARIANTS };
+static const char *variant_names[NUM_VARIANTS] = {
+    "bs", "rb", "sp", "u64", "bp"
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// RANDOM NUMBERS: /////////////////////////////////////////////////////////////
+
+// "rand" is too short (RAND_MAX may be 32767) and too slow for 10^8 keys, so
+// we use our own SplitMix64 generator:
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform double in [0, 1):
+static double rng_double(void) {
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Uniform integer in [0, n):
+static uint64_t rng_below(uint64_t n) {
+    return rng_next() % n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// KEY GENERATORS: /////////////////////////////////////////////////////////////
+
+// The universe of keys is [0, 2*size). The tree is preloaded with the even
+// keys, so about half of the searches and removes of random keys will hit.
+
+#define ZIPF_THETA   0.99       // Skew of the Zipfian distribution (YCSB)
+#define NUM_CLUSTERS 64         // Hot spots of the clustered distribution
+
+typedef struct generator {
+    int       dist;             // Key distribution
+    uint64_t  universe;         // Keys are drawn from [0, universe)
+    uint64_t  counter;          // Next key of sequential & adversarial
+    double    zipf_zetan;       // Zipfian constants (Gray et al., 1994)
+    double    zipf_alpha;
+    double    zipf_eta;
+    double    zipf_half;        // 1 + 0.5^theta
+    uint64_t  centers[NUM_CLUSTERS];
+    uint64_t  width;            // Width of every cluster
+} generator;
+
+// Scrambles Zipfian ranks so the hot keys are spread over the universe:
+static uint64_t scramble(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void init_generator(generator *gen, int dist, uint64_t universe) {
+
+    uint64_t i;
+    double   zeta2;
+
+    memset(gen, 0, sizeof(generator));
+    gen->dist     = dist;
+    gen->universe = universe;
+
+    if (dist == ZIPFIAN) {
+        // This loop is O(universe), but it only runs once per benchmark:
+        for (i = 1; i <= universe; i++) {
+            gen->zipf_zetan += 1.0 / pow((double) i, ZIPF_THETA);
+        }
+        zeta2          = 1.0 + 1.0 / pow(2.0, ZIPF_THETA);
+        gen->zipf_alpha = 1.0 / (1.0 - ZIPF_THETA);
+        gen->zipf_eta   = (1.0 - pow(2.0 / universe, 1.0 - ZIPF_THETA)) /
+                          (1.0 - zeta2 / gen->zipf_zetan);
+        gen->zipf_half  = 1.0 + pow(0.5, ZIPF_THETA);
+    }
+
+    if (dist == CLUSTERED) {
+        gen->width = universe / (NUM_CLUSTERS * 64);
+        if (gen->width == 0) { gen->width = 1; }
+        for (i = 0; i < NUM_CLUSTERS; i++) {
+            gen->centers[i] = rng_below(universe);
+        }
+    }
+}
+
+// Returns the next key of the distribution:
+static uint64_t next_key(generator *gen) {
+
+    uint64_t key;
+    double   u, uz;
+
+    switch (gen->dist) {
+
+        // Every key is equally likely:
+        case UNIFORM:
+            return rng_below(gen->universe);
+
+        // Keys sweep the universe in increasing order (e.g. timestamps):
+        case SEQUENTIAL:
+            return (gen->counter++) % gen->universe;
+
+        // A few keys take most of the accesses (e.g. popular items):
+        case ZIPFIAN:
+            u  = rng_double();
+            uz = u * gen->zipf_zetan;
+            if      (uz < 1.0)            { key = 0; }
+            else if (uz < gen->zipf_half) { key = 1; }
+            else {
+                key = (uint64_t) (gen->universe *
+                      pow(gen->zipf_eta * u - gen->zipf_eta + 1.0,
+                          gen->zipf_alpha));
+            }
+            return scramble(key) % gen->universe;
+
+        // Keys gather around a few hot spots (e.g. per-user ranges):
+        case CLUSTERED:
+            key = gen->centers[rng_below(NUM_CLUSTERS)] +
+                  rng_below(gen->width);
+            return key % gen->universe;
+
+        // Keys alternate between both ends of the universe and move inward:
+        // every new key falls between the last two ones, so a Binary Search
+        // tree grows a zig-zag path and a Splay tree splays all the way down.
+        default:
+            key = gen->counter / 2;
+            if (gen->counter++ % 2 == 1) { key = gen->universe - 1 - key; }
+            return key % gen->universe;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// TREE WRAPPERS: //////////////////////////////////////////////////////////////
+
+// Thin wrappers so the same driver can run every variant. The cost of the
+// indirect call is the same for all of them.
+
+typedef struct tree_ops {
+    void *(* new_tree)   (int (*) (const void *, const void *), int pool);
+    void *(* insert)     (void *tree, void *data);
+    void *(* search)     (void *tree, const void *data);
+    void *(* remove)     (void *tree, const void *data);
+    void *(* remove_min) (void *tree);
+    void  (* scan)       (void *tree, void *cursor, const void *data,
+                          size_t length);
+    void *(* new_cursor) (void *tree);
+    void  (* free_cursor)(void *cursor);
+    void  (* free_tree)  (void *tree);
+} tree_ops;
+
+// Keeps the results of the scans alive, so they are not optimized away:
+static volatile uint64_t sink;
+
+// Binary Search Trees:
+static void *bs_new(int (* comp) (const void *, const void *), int pool) {
+    return pool ? new_bs_tree_with_pool(comp, 0) : new_bs_tree(comp);
+}
+static void *bs_insert(void *tree, void *data) {
+    return bs_tree_insert((bs_tree *) tree, data);
+}
+static void *bs_search(void *tree, const void *data) {
+    return bs_tree_search((bs_tree *) tree, data);
+}
+static void *bs_remove(void *tree, const void *data) {
+    return bs_tree_remove((bs_tree *) tree, data);
+}
+static void *bs_remove_min(void *tree) {
+    return bs_tree_remove_min((bs_tree *) tree);
+}
+static void *bs_new_cursor(void *tree) {
+    return new_bs_cursor((bs_tree *) tree);
+}
+static void bs_free_cursor(void *cursor) {
+    free_bs_cursor((bs_cursor *) cursor);
+}
+static void bs_scan(void *tree, void *cursor, const void *data, size_t n) {
+    void *found = bs_cursor_seek((bs_cursor *) cursor, data);
+    (void) tree;
+    while (found != NULL && n-- > 0) {
+        sink += ((MyData *) found)->key;
+        found = bs_cursor_next((bs_cursor *) cursor);
+    }
+}
+static void bs_free(void *tree) {
+    bs_tree_remove_all((bs_tree *) tree, NULL);
+    free(tree);
+}
+
+// Red Black Trees:
+static void *rb_new(int (* comp) (const void *, const void *), int pool) {
+    return pool ? new_rb_tree_with_pool(comp, 0) : new_rb_tree(comp);
+}
+static void *rb_insert(void *tree, void *data) {
+    return rb_tree_insert((rb_tree *) tree, data);
+}
+static void *rb_search(void *tree, const void *data) {
+    return rb_tree_search((rb_tree *) tree, data);
+}
+static void *rb_remove(void *tree, const void *data) {
+    return rb_tree_remove((rb_tree *) tree, data);
+}
+static void *rb_remove_min(void *tree) {
+    return rb_tree_remove_min((rb_tree *) tree);
+}
+static void *rb_new_cursor(void *tree) {
+    return new_rb_cursor((rb_tree *) tree);
+}
+static void rb_free_cursor(void *cursor) {
+    free_rb_cursor((rb_cursor *) cursor);
+}
+static void rb_scan(void *tree, void *cursor, const void *data, size_t n) {
+    void *found = rb_cursor_seek((rb_cursor *) cursor, data);
+    (void) tree;
+    while (found != NULL && n-- > 0) {
+        sink += ((MyData *) found)->key;
+        found = rb_cursor_next((rb_cursor *) cursor);
+    }
+}
+static void rb_free(void *tree) {
+    rb_tree_remove_all((rb_tree *) tree, NULL);
+    free(tree);
+}
+
+// Splay Trees (the scan splays its first element, like a search would):
+static void *sp_new(int (* comp) (const void *, const void *), int pool) {
+    return pool ? new_sp_tree_with_pool(comp, 0) : new_sp_tree(comp);
+}
+static void *sp_insert(void *tree, void *data) {
+    return sp_tree_insert((sp_tree *) tree, data);
+}
+static void *sp_search(void *tree, const void *data) {
+    return sp_tree_search((sp_tree *) tree, data);
+}
+static void *sp_remove(void *tree, const void *data) {
+    return sp_tree_remove((sp_tree *) tree, data);
+}
+static void *sp_remove_min(void *tree) {
+    return sp_tree_remove_min((sp_tree *) tree);
+}
+static void *sp_new_cursor(void *tree) {
+    return new_sp_cursor((sp_tree *) tree);
+}
+static void sp_free_cursor(void *cursor) {
+    free_sp_cursor((sp_cursor *) cursor);
+}
+static void sp_scan(void *tree, void *cursor, const void *data, size_t n) {
+    void *found;
+    sp_tree_search((sp_tree *) tree, data);
+    found = sp_cursor_seek((sp_cursor *) cursor, data);
+    while (found != NULL && n-- > 0) {
+        sink += ((MyData *) found)->key;
+        found = sp_cursor_next((sp_cursor *) cursor);
+    }
+}
+static void sp_free(void *tree) {
+    sp_tree_remove_all((sp_tree *) tree, NULL);
+    free(tree);
+}
+
+// Red Black Trees with integer keys (they have no cursors, so the scan calls
+// "next" for every element):
+static void *u64_new(int (* comp) (const void *, const void *), int pool) {
+    (void) comp;
+    return pool ? new_rb_tree_u64_with_pool(0) : new_rb_tree_u64();
+}
+static void *u64_insert(void *tree, void *data) {
+    return rb_tree_u64_insert((rb_tree_u64 *) tree, ((MyData *) data)->key,
+                              data);
+}
+static void *u64_search(void *tree, const void *data) {
+    return rb_tree_u64_search((rb_tree_u64 *) tree,
+                              ((const MyData *) data)->key);
+}
+static void *u64_remove(void *tree, const void *data) {
+    return rb_tree_u64_remove((rb_tree_u64 *) tree,
+                              ((const MyData *) data)->key);
+}
+static void *u64_remove_min(void *tree) {
+    return rb_tree_u64_remove_min((rb_tree_u64 *) tree, NULL);
+}
+static void *u64_new_cursor(void *tree) {
+    return tree;
+}
+static void u64_free_cursor(void *cursor) {
+    (void) cursor;
+}
+static void u64_scan(void *tree, void *cursor, const void *data, size_t n) {
+    uint64_t  key   = ((const MyData *) data)->key;
+    void     *found = rb_tree_u64_search((rb_tree_u64 *) tree, key);
+    (void) cursor;
+    if (found == NULL) {
+        found = rb_tree_u64_next((rb_tree_u64 *) tree, key, &key);
+    }
+    while (found != NULL && n-- > 0) {
+        sink += ((MyData *) found)->key;
+        found = rb_tree_u64_next((rb_tree_u64 *) tree, key, &key);
+    }
+}
+static void u64_free(void *tree) {
+    rb_tree_u64_remove_all((rb_tree_u64 *) tree, NULL);
+    free(tree);
+}
+
+// B-trees (they have neither pools nor cursors, so the scan calls "next" for
+// every element):
+static void *bp_new(int (* comp) (const void *, const void *), int pool) {
+    (void) pool;
+    return new_bp_tree(comp);
+}
+static void *bp_insert(void *tree, void *data) {
+    return bp_tree_insert((bp_tree *) tree, data);
+}
+static void *bp_search(void *tree, const void *data) {
+    return bp_tree_search((bp_tree *) tree, data);
+}
+static void *bp_remove(void *tree, const void *data) {
+    return bp_tree_remove((bp_tree *) tree, data);
+}
+static void *bp_remove_min(void *tree) {
+    return bp_tree_remove_min((bp_tree *) tree);
+}
+static void *bp_new_cursor(void *tree) {
+    return tree;
+}
+static void bp_free_cursor(void *cursor) {
+    (void) cursor;
+}
+static void bp_scan(void *tree, void *cursor, const void *data, size_t n) {
+    void *found = bp_tree_search((bp_tree *) tree, data);
+    (void) cursor;
+    if (found == NULL) { found = bp_tree_next((bp_tree *) tree, data); }
+    while (found != NULL && n-- > 0) {
+        sink += ((MyData *) found)->key;
+        found = bp_tree_next((bp_tree *) tree, found);
+    }
+}
+static void bp_free(void *tree) {
+    bp_tree_remove_all((bp_tree *) tree, NULL);
+    free(tree);
+}
+
+static const tree_ops variant_ops[NUM_VARIANTS] = {
+    { bs_new, bs_insert, bs_search, bs_remove, bs_remove_min, bs_scan,
+      bs_new_cursor, bs_free_cursor, bs_free },
+    { rb_new, rb_insert, rb_search, rb_remove, rb_remove_min, rb_scan,
+      rb_new_cursor, rb_free_cursor, rb_free },
+    { sp_new, sp_insert, sp_search, sp_remove, sp_remove_min, sp_scan,
+      sp_new_cursor, sp_free_cursor, sp_free },
+    { u64_new, u64_insert, u64_search, u64_remove, u64_remove_min, u64_scan,
+      u64_new_cursor, u64_free_cursor, u64_free },
+    { bp_new, bp_insert, bp_search, bp_remove, bp_remove_min, bp_scan,
+      bp_new_cursor, bp_free_cursor, bp_free }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// LATENCY HISTOGRAM: //////////////////////////////////////////////////////////
+
+// Storing 10^8 latencies would take more memory than the trees themselves, so
+// we keep a log-linear histogram instead: values below 16 ns get their own
+// bucket and every power of two above that is split in 16 buckets, so every
+// percentile is reported with an error below 1/16 (~6%).
+
+#define HIST_SUB     16
+#define HIST_BUCKETS (HIST_SUB * 62)
+
+static uint64_t histogram[HIST_BUCKETS];
+
+static int hist_bucket(uint64_t ns) {
+    int e;
+    if (ns < HIST_SUB) { return (int) ns; }
+    e = 63 - __builtin_clzll(ns);                       // floor(log2(ns)) >= 4
+    return HIST_SUB * (e - 3) + (int) ((ns >> (e - 4)) & (HIST_SUB - 1));
+}
+
+static uint64_t hist_value(int bucket) {
+    int e;
+    if (bucket < HIST_SUB) { return (uint64_t) bucket; }
+    e = bucket / HIST_SUB + 3;
+    return ((uint64_t) (HIST_SUB + bucket % HIST_SUB)) << (e - 4);
+}
+
+// Returns the latency below which a fraction "q" of the operations finished:
+static uint64_t hist_percentile(uint64_t count, double q) {
+    uint64_t seen   = 0;
+    uint64_t target = (uint64_t) (q * count);
+    int      i;
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen > target) { return hist_value(i); }
+    }
+    return hist_value(HIST_BUCKETS - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// BENCHMARK: //////////////////////////////////////////////////////////////////
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static void print_header(void) {
+    printf("%-8s %-12s %-6s %11s %11s %9s %9s %9s %9s %10s\n",
+           "variant", "dist", "mix", "size", "ops", "Mops/s",
+           "p50(ns)", "p99(ns)", "p999(ns)", "RSS(MB)");
+}
+
+// Preloads a tree, runs "ops" operations and prints one line of results.
+// It is meant to run in a child process (see main), so it just exits when
+// something goes wrong.
+static void run_benchmark(int variant, int dist, int mix, uint64_t size,
+                          uint64_t ops, uint64_t seed, double budget,
+                          int pool) {
+
+    const tree_ops *tp = &variant_ops[variant];
+    generator gen;
+    MyData   *slots;
+    MyData    key;
+    void     *tree, *cursor;
+    uint64_t  universe = 2 * size;
+    uint64_t  used, i, j, t, start, elapsed, deadline;
+    struct rusage usage;
+
+    rng_state = seed;
+    memset(histogram, 0, sizeof(histogram));
+    init_generator(&gen, dist, universe);
+
+    // Every element lives in this array (preload first, then one slot for
+    // every insertion), so the measured time does not include "malloc":
+    slots  = (MyData *) malloc((size + ops) * sizeof(MyData));
+    tree   = tp->new_tree(MyComp, pool);
+    cursor = tp->new_cursor(tree);
+    if (slots == NULL || tree == NULL || cursor == NULL) {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Preload the even keys of the universe. The order depends on the
+    // distribution: shuffled for the random ones, increasing for sequential
+    // and zig-zag (both ends moving inward) for adversarial.
+    for (i = 0; i < size; i++) {
+        if      (dist == SEQUENTIAL)  { slots[i].key = 2 * i; }
+        else if (dist == ADVERSARIAL) {
+            slots[i].key = (i % 2 == 0) ? i : 2 * size - 1 - i;
+        }
+        else {
+            slots[i].key = 2 * i;
+            j = rng_below(i + 1);
+            t = slots[i].key; slots[i].key = slots[j].key; slots[j].key = t;
+        }
+    }
+    deadline = now_ns() + (uint64_t) (budget * 1e9);
+    for (i = 0; i < size; i++) {
+        tp->insert(tree, &slots[i]);
+        if ((i & 4095) == 0 && now_ns() > deadline) {
+            printf("%-8s %-12s %-6s %11llu %11s   timeout while preloading\n",
+                   variant_names[variant], dist_names[dist], mix_names[mix],
+                   (unsigned long long) size, "-");
+            exit(EXIT_SUCCESS);
+        }
+    }
+    used = size;
+
+    // Run the operations, timing each one:
+    start = now_ns();
+    for (i = 0; i < ops; i++) {
+
+        uint64_t r = rng_below(100);
+        uint64_t op_start;
+        key.key = next_key(&gen);
+
+        op_start = now_ns();
+        switch (mix) {
+
+            // 90% search, 5% insert, 5% remove:
+            case READ:
+                if      (r < 90) { tp->search(tree, &key); }
+                else if (r < 95) {
+                    slots[used].key = key.key;
+                    tp->insert(tree, &slots[used++]);
+                }
+                else             { tp->remove(tree, &key); }
+                break;
+
+            // 10% search, 45% insert, 45% remove:
+            case WRITE:
+                if      (r < 10) { tp->search(tree, &key); }
+                else if (r < 55) {
+                    slots[used].key = key.key;
+                    tp->insert(tree, &slots[used++]);
+                }
+                else             { tp->remove(tree, &key); }
+                break;
+
+            // 80% scan, 10% insert, 10% remove:
+            case SCAN:
+                if      (r < 80) {
+                    tp->scan(tree, cursor, &key, SCAN_LENGTH);
+                }
+                else if (r < 90) {
+                    slots[used].key = key.key;
+                    tp->insert(tree, &slots[used++]);
+                }
+                else             { tp->remove(tree, &key); }
+                break;
+
+            // A priority queue: insert a key, pop the minimum, repeat:
+            default:
+                if (i % 2 == 0) {
+                    slots[used].key = key.key;
+                    tp->insert(tree, &slots[used++]);
+                }
+                else { tp->remove_min(tree); }
+                break;
+        }
+        elapsed = now_ns();
+        histogram[hist_bucket(elapsed - op_start)]++;
+
+        if ((i & 4095) == 0 && elapsed > deadline) { break; }
+    }
+    elapsed = now_ns() - start;
+
+    // Peak resident set size of this process (in KB on Linux):
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("%-8s %-12s %-6s %11llu %11llu %9.3f %9llu %9llu %9llu %10.1f%s\n",
+           variant_names[variant], dist_names[dist], mix_names[mix],
+           (unsigned long long) size, (unsigned long long) i,
+           (elapsed > 0) ? (i * 1e3) / elapsed : 0.0,
+           (unsigned long long) hist_percentile(i, 0.50),
+           (unsigned long long) hist_percentile(i, 0.99),
+           (unsigned long long) hist_percentile(i, 0.999),
+           usage.ru_maxrss / 1024.0,
+           (i < ops) ? "  (timeout)" : "");
+
+    tp->free_cursor(cursor);
+    tp->free_tree(tree);
+    free(slots);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// COMMAND LINE: ///////////////////////////////////////////////////////////////
+
+// Parses a comma separated list of names into "selected" (also accepts
+// "all"). Returns NO if some name is unknown.
+static int parse_list(char *list, const char **names, int count,
+                      int *selected) {
+
+    char *token;
+    int   i, found;
+
+    for (i = 0; i < count; i++) { selected[i] = NO; }
+    for (token = strtok(list, ","); token != NULL; token = strtok(NULL, ",")) {
+        found = NO;
+        for (i = 0; i < count; i++) {
+            if (strcmp(token, names[i]) == 0 || strcmp(token, "all") == 0) {
+                selected[i] = found = YES;
+            }
+        }
+        if (found == NO) {
+            fprintf(stderr, "ERROR: Unknown option \"%s\"\n", token);
+            return NO;
+        }
+    }
+    return YES;
+}
+
+// Parses sizes such as "1000000" or "1e8":
+static uint64_t parse_size(const char *text) {
+    double value = strtod(text, NULL);
+    return (value < 1.0) ? 1 : (uint64_t) value;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-n size] [-o ops] [-d dists] [-m mixes] "
+            "[-v variants] [-s seed] [-t seconds] [-p]\n", name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+// MAIN: ///////////////////////////////////////////////////////////////////////
+
+int main (int argc, char **argv) {
+
+    int      dists[NUM_DISTS]       = { YES, NO, NO, NO, NO };
+    int      mixes[NUM_MIXES]       = { YES, NO, NO, NO };
+    int      variants[NUM_VARIANTS] = { YES, YES, YES, YES, YES };
+    uint64_t size   = 1000000;
+    uint64_t ops    = 0;
+    uint64_t seed   = 1;
+    double   budget = 60.0;
+    int      pool   = NO;
+    int      d, m, v, opt, status;
+    pid_t    pid;
+
+    while ((opt = getopt(argc, argv, "n:o:d:m:v:s:t:ph")) != -1) {
+        switch (opt) {
+            case 'n': size   = parse_size(optarg);          break;
+            case 'o': ops    = parse_size(optarg);          break;
+            case 's': seed   = strtoull(optarg, NULL, 10);  break;
+            case 't': budget = strtod(optarg, NULL);        break;
+            case 'p': pool   = YES;                         break;
+            case 'd':
+                if (!parse_list(optarg, dist_names, NUM_DISTS, dists)) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'm':
+                if (!parse_list(optarg, mix_names, NUM_MIXES, mixes)) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'v':
+                if (!parse_list(optarg, variant_names, NUM_VARIANTS,
+                                variants)) {
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (ops == 0) { ops = size; }
+
+    // One child process per run, so every peak RSS belongs to a single tree:
+    print_header();
+    for (d = 0; d < NUM_DISTS; d++) {
+        for (m = 0; m < NUM_MIXES; m++) {
+            for (v = 0; v < NUM_VARIANTS; v++) {
+                if (!dists[d] || !mixes[m] || !variants[v]) { continue; }
+                fflush(stdout);
+                pid = fork();
+                if (pid < 0) {
+                    fprintf(stderr, "ERROR: Unable to fork\n");
+                    return EXIT_FAILURE;
+                }
+                if (pid == 0) {
+                    run_benchmark(v, d, m, size, ops, seed, budget, pool);
+                    fflush(stdout);
+                    _exit(EXIT_SUCCESS);
+                }
+                waitpid(pid, &status, 0);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    printf("%-8s %-12s %-6s   run failed\n",
+                           variant_names[v], dist_names[d], mix_names[m]);
+                }
+            }
+        }
+        if (dists[d]) { printf("\n"); }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -39,6 +39,9 @@
 #include <time.h>               // time, clock
 #include <stdio.h>              // printf, fprintf, stderr
 #include <assert.h>             // assert
+#ifdef RB_THREADS
+    #include <pthread.h>        // pthread_create, pthread_join
+#endif
 #include "BinaryTrees.h"        // BinaryTrees library headers
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -61,6 +64,24 @@ int MyComp(const void *ptr1, const void *ptr2) {
     else                        { return  0; }
 }
 
+#ifdef TREE_KEY_PREFIX
+
+// Prefix function: A coarse (but order-preserving) summary of the key, so every
+// prefix is shared by 4 consecutive keys and the trees must break the ties:
+uint64_t MyPrefix(const void *ptr) {
+    MyData *d = (MyData *) ptr;
+    return ((uint64_t) (d->key / 4)) ^ ((uint64_t) 1 << 63);
+}
+
+// Comparing function that counts its calls:
+size_t count_comparisons = 0;
+int CountComp(const void *ptr1, const void *ptr2) {
+    count_comparisons++;
+    return MyComp(ptr1, ptr2);
+}
+
+#endif
+
 // Printing function: This is, indeed, optional.
 void MyPrint(const void *ptr) {
     MyData *d = (MyData *) ptr;
@@ -1599,258 +1620,989 @@ int bs_tree_set_test(int max_size) {
     return PASS;
 }
 
+// Node pools:
+int bs_tree_pool_test(int max_size) {
 
-// Sequential insertions & complete deletion:
-int rb_tree_sequential_test(int max_size) {
-
-    int i;
-    rb_tree *tree  = new_rb_tree(MyComp);
+    int i, round;
+    bs_tree *tree  = new_bs_tree_with_pool(MyComp, 0);
+    bs_tree *aux   = NULL;
     MyData  *data  = NULL;
     MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
 
-    // It is a rb_tree:
-    if (is_rb_tree(tree) == NO) { return FAIL; }
-
-    // It is empty:
-    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
-
-    // Insert elements sequentially in the tree:
-    for (i=0; i<max_size; i++) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = rb_tree_insert(tree, data);
-
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
-
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO)        { return FAIL; }
+    // It is a bs_tree:
+    if (tree == NULL)           { return FAIL; }
+    if (tree->pool == NULL)     { return FAIL; }
+    if (is_bs_tree(tree) == NO) { return FAIL; }
 
-        // It is not empty:
-        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
+    // Fill it twice, so the second time all nodes are recycled:
+    for (round=0; round<2; round++) {
 
-    }
+        // Insert elements randomly in the tree:
+        for (i=0; i<max_size*10; i++) {
+            data = (MyData *) malloc(sizeof(MyData));
+            data->key = rand() % max_size;
+            found = bs_tree_insert(tree, data);
+            if (found != NULL) { free(found); }
+            if (is_bs_tree(tree) == NO) { return FAIL; }
+        }
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=0; i<max_size; i++) {
-        data->key = i;
-        found = rb_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+        // Remove elements randomly from the tree:
+        data = (MyData *) malloc(sizeof(MyData));
+        for (i=0; i<max_size*5; i++) {
+            data->key = rand() % max_size;
+            found = bs_tree_remove(tree, data);
+            if (found != NULL) { free(found); }
+            if (is_bs_tree(tree) == NO) { return FAIL; }
+        }
+        free(data);
     }
-    free(data);
 
-    // Check if everything is correctly sorted forward...
-    found = rb_tree_min(tree);
-    if (found == NULL)   { return FAIL; }
-    if (found->key != 0) { return FAIL; }
+    // Check if everything is correctly sorted:
+    found = bs_tree_min(tree);
     while (found != NULL) {
         data  = found;
-        found = rb_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = rb_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+        found = bs_tree_next(tree, data);
+        if (found != NULL && MyComp(data, found) >= 0) { return FAIL; }
     }
 
-    // ...and backwards.
-    found = rb_tree_max(tree);
-    if (found == NULL)            { return FAIL; }
-    if (found->key != max_size-1) { return FAIL; }
+    // The copy & set functions use a node pool too:
+    aux = bs_tree_union(tree, tree);
+    if (aux->pool == NULL)     { return FAIL; }
+    if (is_bs_tree(aux) == NO) { return FAIL; }
+    found = bs_tree_min(aux);
     while (found != NULL) {
-        data  = found;
-        found = rb_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = rb_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
-        }
+        if (bs_tree_search(tree, found) != found) { return FAIL; }
+        found = bs_tree_next(aux, found);
     }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
 
-    // Now, clean everything!
-    rb_tree_remove_all(tree, free);
+    // Remove everything freeing the data:
+    bs_tree_remove_all(tree, free);
+    if (is_bs_tree(tree) == NO)        { return FAIL; }
+    if (bs_tree_is_empty(tree) == NO)  { return FAIL; }
 
-    // It is a rb_tree:
-    if (is_rb_tree(tree) == NO) { return FAIL; }
+    // The tree can be used again after a complete deletion:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        found = bs_tree_insert(tree, &keys[i]);
+        if (found != NULL)          { return FAIL; }
+        if (is_bs_tree(tree) == NO) { return FAIL; }
+    }
+    for (i=0; i<max_size; i++) {
+        if (bs_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+    }
 
-    // It is empty:
-    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+    // Remove everything without freeing the data:
+    bs_tree_remove_all(tree, NULL);
+    if (bs_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Insert elements sequentially in the tree:
-    for (i=max_size; i>0; i--) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = rb_tree_insert(tree, data);
+    free(keys);
+    free(tree);
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+    return PASS;
+}
 
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO)        { return FAIL; }
+// Cursors:
+int bs_tree_cursor_test(int max_size) {
 
-        // It is not empty:
-        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
+    int i, j;
+    bs_tree   *tree   = new_bs_tree(MyComp);
+    bs_cursor *cursor = new_bs_cursor(tree);
+    MyData    *data   = (MyData *) malloc(sizeof(MyData));
+    MyData    *found  = NULL;
+    MyData    *keys   = (MyData *) malloc(max_size*sizeof(MyData));
 
-    }
+    // It is a bs_tree with a cursor:
+    if (tree == NULL)           { return FAIL; }
+    if (cursor == NULL)         { return FAIL; }
+    if (is_bs_tree(tree) == NO) { return FAIL; }
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=max_size; i>0; i--) {
-        data->key = i;
-        found = rb_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+    // Cursors over an empty tree are always invalid:
+    if (bs_cursor_first(cursor) != NULL) { return FAIL; }
+    if (bs_cursor_last(cursor)  != NULL) { return FAIL; }
+    if (bs_cursor_next(cursor)  != NULL) { return FAIL; }
+    if (bs_cursor_prev(cursor)  != NULL) { return FAIL; }
+    if (bs_cursor_get(cursor)   != NULL) { return FAIL; }
+
+    // Insert all the even keys in random order:
+    for (i=0; i<max_size; i++) { keys[i].key = 2*i; }
+    for (i=0; i<max_size*2; i++) {
+        bs_tree_insert(tree, &keys[rand() % max_size]);
     }
-    free(data);
+    for (i=0; i<max_size; i++) { bs_tree_insert(tree, &keys[i]); }
+    if (is_bs_tree(tree) == NO) { return FAIL; }
 
-    // Check if everything is correctly sorted forward...
-    found = rb_tree_min(tree);
-    if (found == NULL)   { return FAIL; }
-    if (found->key != 1) { return FAIL; }
+    // Traverse the tree forwards:
+    i = 0;
+    found = bs_cursor_first(cursor);
     while (found != NULL) {
-        data  = found;
-        found = rb_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = rb_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+        if (found != &keys[i])                { return FAIL; }
+        if (bs_cursor_get(cursor) != found)   { return FAIL; }
+        found = bs_cursor_next(cursor);
+        i++;
     }
+    if (i != max_size)                        { return FAIL; }
+    if (bs_cursor_get(cursor) != NULL)        { return FAIL; }
 
-    // ...and backwards.
-    found = rb_tree_max(tree);
-    if (found == NULL)          { return FAIL; }
-    if (found->key != max_size) { return FAIL; }
+    // Traverse the tree backwards:
+    i = max_size;
+    found = bs_cursor_last(cursor);
     while (found != NULL) {
-        data  = found;
-        found = rb_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = rb_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
-        }
+        i--;
+        if (found != &keys[i])                { return FAIL; }
+        found = bs_cursor_prev(cursor);
     }
+    if (i != 0)                               { return FAIL; }
 
-    // Now, clean everything!
-    rb_tree_remove_all(tree, free);
-
-    // It is a rb_tree:
-    if (is_rb_tree(tree) == NO) { return FAIL; }
+    // Seek every key (odd keys are not in the tree) and move around it:
+    for (i=-1; i<max_size*2; i++) {
+        data->key = i;
+        j = (i + 1) / 2;
+        found = bs_cursor_seek(cursor, data);
+        if (j == max_size) {
+            if (found != NULL)                { return FAIL; }
+            continue;
+        }
+        if (found != &keys[j])                { return FAIL; }
+        found = bs_cursor_next(cursor);
+        if (j + 1 == max_size) {
+            if (found != NULL)                { return FAIL; }
+            continue;
+        }
+        if (found != &keys[j+1])              { return FAIL; }
+        if (bs_cursor_prev(cursor) != &keys[j]) { return FAIL; }
+    }
 
-    // It is empty:
-    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+    // Cursors do not modify the tree:
+    if (is_bs_tree(tree) == NO) { return FAIL; }
 
-    // Insert elements sequentially in the tree:
-    for (i=1; i<=max_size; i++) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = rb_tree_insert(tree, data);
+    free_bs_cursor(cursor);
+    bs_tree_remove_all(tree, NULL);
+    free(data);
+    free(keys);
+    free(tree);
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+    return PASS;
+}
 
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO)        { return FAIL; }
+// Read-only traversals:
+const bs_tree *bs_watched_tree = NULL;
+int            bs_watched_tree_modified = NO;
 
-        // It is not empty:
-        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
+// Comparing function that also checks that the watched tree is not threaded:
+int bs_WatchComp(const void *ptr1, const void *ptr2) {
+    const bs_node *node = bs_watched_tree->root;
+    if (node != NULL && node->left != NULL) {
+        node = node->left;
+        while (node->right != NULL && node->right != bs_watched_tree->root) {
+            node = node->right;
+        }
+        if (node->right != NULL) { bs_watched_tree_modified = YES; }
+    }
+    return MyComp(ptr1, ptr2);
+}
 
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = -i;
-        found = rb_tree_insert(tree, data);
+// Counts the elements of tree (and checks that they are sorted):
+int bs_tree_count(const bs_tree *tree) {
+    int count = 0;
+    bs_cursor *cursor = new_bs_cursor(tree);
+    MyData    *prev   = NULL;
+    MyData    *data   = bs_cursor_first(cursor);
+    while (data != NULL) {
+        if (prev != NULL && MyComp(prev, data) >= 0) { count = -1; break; }
+        prev = data;
+        data = bs_cursor_next(cursor);
+        count++;
+    }
+    free_bs_cursor(cursor);
+    return count;
+}
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+int bs_tree_const_test(int max_size) {
 
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO)        { return FAIL; }
+    int i;
+    bs_tree *tree  = new_bs_tree(bs_WatchComp);
+    bs_tree *even  = new_bs_tree(bs_WatchComp);
+    bs_tree *aux   = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
 
-        // It is not empty:
-        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
+    // They are bs_trees:
+    if (tree == NULL || even == NULL) { return FAIL; }
+    bs_watched_tree = tree;
 
+    // Insert the keys in decreasing order (and the even ones in another tree):
+    for (i=max_size-1; i>=0; i--) {
+        keys[i].key = i;
+        bs_tree_insert(tree, &keys[i]);
+        if (i % 2 == 0) { bs_tree_insert(even, &keys[i]); }
     }
+    if (is_bs_tree(tree) == NO)    { return FAIL; }
+    if (bs_tree_count(tree) != max_size) { return FAIL; }
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=1; i<=max_size; i++) {
-        data->key = i;
-        found = rb_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
-        data->key = -i;
-        found = rb_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
-    }
-    free(data);
+    // Copy & set functions never modify their arguments, not even temporarily:
 
-    // Check if everything is correctly sorted forward...
-    found = rb_tree_min(tree);
-    if (found == NULL)           { return FAIL; }
-    if (found->key != -max_size) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = rb_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = rb_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
-    }
+    aux = bs_tree_copy(tree);
+    if (bs_tree_count(aux) != max_size)             { return FAIL; }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
 
-    // ...and backwards.
-    found = rb_tree_max(tree);
-    if (found == NULL)          { return FAIL; }
-    if (found->key != max_size) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = rb_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = rb_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
-        }
-    }
+    aux = bs_tree_union(even, tree);
+    if (bs_tree_count(aux) != max_size)             { return FAIL; }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
 
-    // Now, clean everything!
-    rb_tree_remove_all(tree, free);
+    aux = bs_tree_intersection(tree, even);
+    if (bs_tree_count(aux) != (max_size + 1) / 2)   { return FAIL; }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
 
-    // It is a rb_tree:
-    if (is_rb_tree(tree) == NO) { return FAIL; }
+    aux = bs_tree_diff(tree, even);
+    if (bs_tree_count(aux) != max_size / 2)         { return FAIL; }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
 
-    // It is empty:
-    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+    aux = bs_tree_sym_diff(even, tree);
+    if (bs_tree_count(aux) != max_size / 2)         { return FAIL; }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
+
+    if (bs_watched_tree_modified == YES) { return FAIL; }
+    if (is_bs_tree(tree) == NO)          { return FAIL; }
 
+    bs_tree_remove_all(tree, NULL);
+    bs_tree_remove_all(even, NULL);
     free(tree);
-    
+    free(even);
+    free(keys);
+
     return PASS;
 }
 
-// Fast Sequential insertions & deletions:
-int rb_tree_fast_sequential_test(int max_size) {
+// Bulk build from a sorted array:
+int bs_tree_sorted_test(int max_size) {
+
+    int i, j, n;
+    bs_tree *tree  = NULL;
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+
+    // Sorted array of different keys:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = 2*i;
+        data[i]     = &keys[i];
+    }
+
+    // Build trees of every size (and the biggest one):
+    for (n=0; n<=max_size; n += (n < 300) ? 1 : 97) {
+
+        // It is a pooled bs_tree with all the elements in order:
+        tree = bs_tree_from_sorted_array(MyComp, data, n);
+        if (tree == NULL)                       { return FAIL; }
+        if (tree->pool == NULL)                 { return FAIL; }
+        if (is_bs_tree(tree) == NO)             { return FAIL; }
+        if (bs_tree_is_empty(tree) != (n == 0)) { return FAIL; }
+        found = bs_tree_min(tree);
+        for (i=0; i<n; i++) {
+            if (found != &keys[i])              { return FAIL; }
+            found = bs_tree_next(tree, found);
+        }
+        if (found != NULL)                      { return FAIL; }
+
+        // All the nodes are in the same slab:
+        if (n > 0 && *((void **) tree->pool->slabs) != NULL) { return FAIL; }
+
+        // It can be modified as usual afterwards:
+        for (j=0; j<n; j += 3) {
+            if (bs_tree_remove(tree, &keys[j]) != &keys[j]) { return FAIL; }
+            if (is_bs_tree(tree) == NO)         { return FAIL; }
+        }
+        for (j=0; j<n; j += 3) {
+            if (bs_tree_insert(tree, &keys[j]) != NULL)     { return FAIL; }
+            if (is_bs_tree(tree) == NO)         { return FAIL; }
+        }
+        for (i=0; i<n; i++) {
+            if (bs_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+        }
+
+        bs_tree_remove_all(tree, NULL);
+        free(tree);
+    }
+
+    free(keys);
+    free(data);
+
+    return PASS;
+}
+
+// Batch insertions & searches:
+int bs_tree_batch_test(int max_size) {
+
+    int i, j, n;
+    bs_tree *tree  = new_bs_tree(MyComp);
+    bs_tree *ref   = new_bs_tree(MyComp);
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(9*max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+    void   **out   = (void **)  malloc(max_size*sizeof(void *));
+    void   **old   = (void **)  malloc(max_size*sizeof(void *));
+
+    // They are bs_trees:
+    if (tree == NULL || ref == NULL) { return FAIL; }
+
+    // Empty batches do nothing:
+    bs_tree_insert_batch(tree, data, 0);
+    bs_tree_search_batch(tree, (const void **) data, out, 0);
+    if (bs_tree_is_empty(tree) == NO) { return FAIL; }
+
+    // Insert random, sorted & reversed batches (with repeated keys):
+    for (j=0; j<8; j++) {
+        n = (j == 0) ? 1 : max_size / (8 - j);
+        for (i=0; i<n; i++) {
+            keys[j*max_size + i].key = (j % 3 == 0) ? rand() % (2*max_size)
+                                     : (j % 3 == 1) ? 2*i : 2*(n - i);
+            data[i] = &keys[j*max_size + i];
+        }
+        data[n-1] = data[0];
+        for (i=0; i<n; i++) { old[i] = bs_tree_insert(ref, data[i]); }
+
+        // Returns the same values as inserting them one by one:
+        bs_tree_insert_batch(tree, data, n);
+        if (is_bs_tree(tree) == NO)             { return FAIL; }
+        for (i=0; i<n; i++) {
+            if (data[i] != old[i])              { return FAIL; }
+        }
+
+        // And the trees store the same pointers:
+        found = bs_tree_min(ref);
+        while (found != NULL) {
+            if (bs_tree_search(tree, found) != found) { return FAIL; }
+            found = bs_tree_next(ref, found);
+        }
+        found = bs_tree_min(tree);
+        while (found != NULL) {
+            if (bs_tree_search(ref, found) != found)  { return FAIL; }
+            found = bs_tree_next(tree, found);
+        }
+    }
+
+    // Search random keys (half of them are not in the tree):
+    for (i=0; i<max_size; i++) {
+        keys[8*max_size + i].key = rand() % (4*max_size);
+        data[i] = &keys[8*max_size + i];
+    }
+    bs_tree_search_batch(tree, (const void **) data, out, max_size);
+    for (i=0; i<max_size; i++) {
+        if (out[i] != bs_tree_search(ref, data[i])) { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)                 { return FAIL; }
+
+    bs_tree_remove_all(tree, NULL);
+    bs_tree_remove_all(ref, NULL);
+    free(tree);
+    free(ref);
+    free(keys);
+    free(data);
+    free(out);
+    free(old);
+
+    return PASS;
+}
+
+// Interleaved searches:
+int bs_tree_interleaved_test(int max_size) {
+
+    int i, n;
+    bs_tree *tree  = new_bs_tree(MyComp);
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *query = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+    void   **out   = (void **)  malloc(max_size*sizeof(void *));
+
+    // It is a bs_tree:
+    if (tree == NULL) { return FAIL; }
+
+    // Random keys (only half of them will be in the tree):
+    for (i=0; i<max_size; i++) {
+        query[i].key = rand() % (2*max_size);
+        data[i]      = &query[i];
+    }
+
+    // Searching an empty tree:
+    bs_tree_search_interleaved(tree, (const void **) data, out, max_size);
+    for (i=0; i<max_size; i++) {
+        if (out[i] != NULL) { return FAIL; }
+    }
+
+    // Insert the even keys:
+    for (i=0; i<max_size; i++) { keys[i].key = 2*i; }
+    for (i=0; i<max_size; i++) {
+        bs_tree_insert(tree, &keys[(i * 7) % max_size]);
+    }
+
+    // Batches of every size give the same result as searching one by one:
+    for (n=0; n<=max_size; n += (n < 40) ? 1 : 97) {
+        for (i=0; i<n; i++) { out[i] = &keys[0]; }
+        bs_tree_search_interleaved(tree, (const void **) data, out, n);
+        for (i=0; i<n; i++) {
+            if (out[i] != bs_tree_search(tree, data[i])) { return FAIL; }
+        }
+    }
+    if (is_bs_tree(tree) == NO) { return FAIL; }
+
+    bs_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+    free(query);
+    free(data);
+    free(out);
+
+    return PASS;
+}
+
+#ifdef TREE_STATS
+
+// Operation counters:
+int bs_tree_stats_test(int max_size) {
+
+    int i;
+    bs_tree    *tree  = new_bs_tree(MyComp);
+    MyData     *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    tree_stats  stats;
+
+    // A new tree has not done anything yet:
+    if (tree == NULL) { return FAIL; }
+    stats = bs_tree_get_stats(tree);
+    if (stats.comparisons != 0 || stats.allocations != 0 ||
+        stats.searches    != 0 || stats.max_depth   != 0) { return FAIL; }
+
+    // Insert the keys in increasing order:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        bs_tree_insert(tree, &keys[i]);
+    }
+    stats = bs_tree_get_stats(tree);
+    if ((int) stats.allocations != max_size)       { return FAIL; }
+    if ((int) stats.searches    != max_size)       { return FAIL; }
+    if (stats.comparisons < stats.depth)           { return FAIL; }
+    if (stats.max_depth == 0 || stats.releases != 0) { return FAIL; }
+    if (stats.rotations != 0 || stats.recolorings != 0) { return FAIL; }
+
+    // A single search counts its depth:
+    bs_tree_reset_stats(tree);
+    bs_tree_search(tree, &keys[max_size / 3]);
+    stats = bs_tree_get_stats(tree);
+    if (stats.searches != 1 || stats.depth == 0)   { return FAIL; }
+    if (stats.depth != stats.max_depth)            { return FAIL; }
+    if (stats.allocations != 0)                    { return FAIL; }
+
+    // Removing elements releases their nodes:
+    bs_tree_reset_stats(tree);
+    for (i=0; i<max_size; i += 2) { bs_tree_remove(tree, &keys[i]); }
+    stats = bs_tree_get_stats(tree);
+    if ((int) stats.releases != (max_size + 1) / 2) { return FAIL; }
+    if ((int) stats.searches != (max_size + 1) / 2) { return FAIL; }
+    if (is_bs_tree(tree) == NO)                    { return FAIL; }
+
+    bs_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+
+    return PASS;
+}
+
+#endif
+
+#ifdef TREE_KEY_PREFIX
+
+// Key prefixes:
+int bs_tree_prefix_test(int max_size) {
+
+    int i, j;
+    size_t   with_prefix, without_prefix;
+    bs_tree *tree  = new_bs_tree(CountComp);
+    bs_tree *plain = new_bs_tree(CountComp);
+    bs_tree *aux   = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *data  = NULL;
+    MyData   key;
+
+    // Only one of them uses prefixes:
+    if (tree == NULL || plain == NULL) { return FAIL; }
+    bs_tree_set_prefix(tree, MyPrefix);
+
+    // Shuffle the keys (most of them share their prefix with 3 more keys):
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=max_size-1; i>0; i--) {
+        j       = rand() % (i + 1);
+        key     = keys[i];
+        keys[i] = keys[j];
+        keys[j] = key;
+    }
+
+    // Insert them in both trees:
+    for (i=0; i<max_size; i++) {
+        if (bs_tree_insert(tree,  &keys[i]) != NULL) { return FAIL; }
+        if (bs_tree_insert(plain, &keys[i]) != NULL) { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)  { return FAIL; }
+    if (is_bs_tree(plain) == NO) { return FAIL; }
+
+    // Search them in both trees counting the calls to the comparing function:
+    count_comparisons = 0;
+    for (i=0; i<max_size; i++) {
+        data = bs_tree_search(tree, &keys[i]);
+        if (data == NULL || data->key != keys[i].key) { return FAIL; }
+    }
+    with_prefix = count_comparisons;
+    count_comparisons = 0;
+    for (i=0; i<max_size; i++) {
+        data = bs_tree_search(plain, &keys[i]);
+        if (data == NULL || data->key != keys[i].key) { return FAIL; }
+    }
+    without_prefix = count_comparisons;
+
+    // The prefixes avoid most of them:
+    if (with_prefix >= without_prefix) { return FAIL; }
+
+    // Remove the odd keys:
+    for (i=0; i<max_size; i++) {
+        if (keys[i].key % 2 == 0) { continue; }
+        key.key = keys[i].key;
+        if (bs_tree_remove(tree, &key) != &keys[i]) { return FAIL; }
+        if (bs_tree_remove(tree, &key) != NULL)     { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO) { return FAIL; }
+
+    // Only the even keys are still there:
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        data = bs_tree_search(tree, &key);
+        if (i % 2 == 1 && data != NULL)                    { return FAIL; }
+        if (i % 2 == 0 && (data == NULL || data->key != i)) { return FAIL; }
+    }
+
+    // Copies & set functions keep the prefixes (even from plain trees):
+    aux = bs_tree_copy(tree);
+    if (aux == NULL || aux->prefix != MyPrefix) { return FAIL; }
+    if (is_bs_tree(aux) == NO)                  { return FAIL; }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = bs_tree_union(tree, plain);
+    if (aux == NULL || aux->prefix != MyPrefix) { return FAIL; }
+    if (is_bs_tree(aux) == NO)                  { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        data = bs_tree_search(aux, &key);
+        if (data == NULL || data->key != i)     { return FAIL; }
+    }
+    bs_tree_remove_all(aux, NULL);
+    free(aux);
+
+    bs_tree_remove_all(tree, NULL);
+    bs_tree_remove_all(plain, NULL);
+    free(tree);
+    free(plain);
+    free(keys);
+
+    return PASS;
+}
+
+#endif
+
+// Frozen snapshots:
+int bs_tree_freeze_test(int max_size) {
+
+    int i, n;
+    bs_tree     *tree   = new_bs_tree(MyComp);
+    frozen_tree *frozen = NULL;
+    MyData      *keys   = (MyData *) malloc(2*max_size*sizeof(MyData));
+    MyData      *data   = NULL;
+    MyData       lo, hi;
+
+    // An empty tree gives an empty snapshot:
+    if (tree == NULL) { return FAIL; }
+    frozen = bs_tree_freeze(tree);
+    if (frozen == NULL || is_frozen_tree(frozen) == NO) { return FAIL; }
+    if (frozen_tree_size(frozen) != 0)                  { return FAIL; }
+    if (frozen_tree_min(frozen) != NULL)                { return FAIL; }
+    if (frozen_tree_max(frozen) != NULL)                { return FAIL; }
+    if (frozen_tree_select(frozen, 0) != NULL)          { return FAIL; }
+    free(frozen);
+
+    // Snapshots of every size (the layout changes with the height):
+    for (n=1; n<=max_size; n += 1 + n / 8) {
+
+        // Insert the even keys 0, 2, ..., 2n-2 in random order:
+        for (i=0; i<2*n; i++) { keys[i].key = i; }
+        for (i=0; i<n; i++) { bs_tree_insert(tree, &keys[2 * (rand() % n)]); }
+        for (i=0; i<n; i++) { bs_tree_insert(tree, &keys[2 * i]); }
+
+        // Freeze it:
+        frozen = bs_tree_freeze(tree);
+        if (frozen == NULL || is_frozen_tree(frozen) == NO) { return FAIL; }
+        if ((int) frozen_tree_size(frozen) != n)            { return FAIL; }
+
+        // The snapshot does not depend on the tree any more:
+        bs_tree_remove_all(tree, NULL);
+
+        // Search every key (the odd ones are not there):
+        for (i=0; i<2*n; i++) {
+            data = frozen_tree_search(frozen, &keys[i]);
+            if (i % 2 == 0 && data != &keys[i]) { return FAIL; }
+            if (i % 2 == 1 && data != NULL)     { return FAIL; }
+        }
+
+        // Min, max, prev & next:
+        if (frozen_tree_min(frozen) != &keys[0])         { return FAIL; }
+        if (frozen_tree_max(frozen) != &keys[2 * n - 2]) { return FAIL; }
+        for (i=0; i<2*n; i++) {
+            data = frozen_tree_prev(frozen, &keys[i]);
+            if (i == 0 && data != NULL)                  { return FAIL; }
+            if (i > 0 && data != &keys[(i - 1) & ~1])    { return FAIL; }
+            data = frozen_tree_next(frozen, &keys[i]);
+            if (i >= 2 * n - 2 && data != NULL)          { return FAIL; }
+            if (i < 2 * n - 2 && data != &keys[(i + 2) & ~1]) { return FAIL; }
+        }
+
+        // Ranks, selections & ranges:
+        for (i=0; i<2*n; i++) {
+            if ((int) frozen_tree_rank(frozen, &keys[i]) != (i + 1) / 2) {
+                return FAIL;
+            }
+            if (i < n && frozen_tree_select(frozen, i) != &keys[2 * i]) {
+                return FAIL;
+            }
+        }
+        if (frozen_tree_select(frozen, n) != NULL) { return FAIL; }
+        for (i=0; i<n; i++) {
+            lo.key = i;
+            hi.key = i + n;
+            if ((int) frozen_tree_count_range(frozen, &lo, &hi) !=
+                (i + n) / 2 - (i + 1) / 2 + 1) { return FAIL; }
+            if (frozen_tree_count_range(frozen, &hi, &lo) != 0) { return FAIL; }
+        }
+
+        free(frozen);
+    }
+
+    free(tree);
+    free(keys);
+
+    return PASS;
+}
+
+// Priority queue usage (insertions & removals at both ends):
+int bs_tree_min_max_test(int max_size) {
+
+    int i, j, lo, hi;
+    bs_tree *tree  = new_bs_tree(MyComp);
+    bs_tree *copy  = NULL;
+    bs_tree *ends  = new_bs_tree(MyComp);
+    bs_tree *other = NULL;
+    MyData  *min   = NULL;
+    MyData  *max   = NULL;
+    MyData  *keys  = (MyData *) malloc(3*max_size*sizeof(MyData));
+
+    // Keys from -max_size to 2*max_size - 1:
+    for (i=0; i<3*max_size; i++) { keys[i].key = i - max_size; }
+
+    // An empty tree has no extremes:
+    if (tree == NULL || ends == NULL)                { return FAIL; }
+    if (bs_tree_min(tree) != NULL)                   { return FAIL; }
+    if (bs_tree_max(tree) != NULL)                   { return FAIL; }
+
+    // Random insertions in the middle third:
+    lo = 3*max_size;
+    hi = -1;
+    for (i=0; i<max_size; i++) {
+        j = max_size + rand() % max_size;
+        bs_tree_insert(tree, &keys[j]);
+        if (j < lo) { lo = j; }
+        if (j > hi) { hi = j; }
+        if (bs_tree_min(tree) != &keys[lo])          { return FAIL; }
+        if (bs_tree_max(tree) != &keys[hi])          { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)                      { return FAIL; }
+
+    // Grow it at both ends:
+    for (i=0; i<max_size; i++) {
+        if (i % 2 == 0) { bs_tree_insert_min(tree, &keys[--lo]); }
+        else            { bs_tree_insert_max(tree, &keys[++hi]); }
+        if (bs_tree_min(tree) != &keys[lo])          { return FAIL; }
+        if (bs_tree_max(tree) != &keys[hi])          { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)                      { return FAIL; }
+
+    // Copies & set operations keep their own extremes:
+    copy = bs_tree_copy(tree);
+    if (copy == NULL || is_bs_tree(copy) == NO)      { return FAIL; }
+    if (bs_tree_min(copy) != &keys[lo])              { return FAIL; }
+    if (bs_tree_max(copy) != &keys[hi])              { return FAIL; }
+    bs_tree_insert(ends, &keys[0]);
+    bs_tree_insert(ends, &keys[3*max_size - 1]);
+    other = bs_tree_union(copy, ends);
+    if (other == NULL || is_bs_tree(other) == NO)    { return FAIL; }
+    if (bs_tree_min(other) != &keys[0])              { return FAIL; }
+    if (bs_tree_max(other) != &keys[3*max_size - 1]) { return FAIL; }
+    bs_tree_remove_all(other, NULL);
+    free(other);
+    other = bs_tree_diff(copy, ends);
+    if (other == NULL || is_bs_tree(other) == NO)    { return FAIL; }
+    if (bs_tree_min(other) != bs_tree_min(copy))     { return FAIL; }
+    if (bs_tree_max(other) != bs_tree_max(copy))     { return FAIL; }
+    bs_tree_remove_all(other, NULL);
+    free(other);
+
+    // Remove everything from both ends (and through regular removals):
+    for (i=0; bs_tree_is_empty(tree) == NO; i++) {
+        min = bs_tree_min(tree);
+        max = bs_tree_max(tree);
+        switch (rand() % 4) {
+            case 0:  if (bs_tree_remove_min(tree) != min)     { return FAIL; }
+                     break;
+            case 1:  if (bs_tree_remove_max(tree) != max)     { return FAIL; }
+                     break;
+            case 2:  if (bs_tree_remove(tree, min) != min)    { return FAIL; }
+                     break;
+            default: if (bs_tree_remove(tree, max) != max)    { return FAIL; }
+                     break;
+        }
+        if (i % 17 == 0 && is_bs_tree(tree) == NO)   { return FAIL; }
+        if (bs_tree_is_empty(tree) == NO) {
+            if (((MyData *) bs_tree_min(tree))->key < min->key) { return FAIL; }
+            if (((MyData *) bs_tree_max(tree))->key > max->key) { return FAIL; }
+        }
+    }
+    if (bs_tree_min(tree) != NULL)                   { return FAIL; }
+    if (bs_tree_max(tree) != NULL)                   { return FAIL; }
+    if (is_bs_tree(tree) == NO)                      { return FAIL; }
+
+    // The tree is still usable after being emptied:
+    bs_tree_insert(tree, &keys[max_size]);
+    if (bs_tree_min(tree) != &keys[max_size])        { return FAIL; }
+    if (bs_tree_max(tree) != &keys[max_size])        { return FAIL; }
+    bs_tree_remove_all(copy, NULL);
+    if (is_bs_tree(copy) == NO)                      { return FAIL; }
+    if (bs_tree_min(copy) != NULL)                   { return FAIL; }
+
+    bs_tree_remove_all(tree, NULL);
+    bs_tree_remove_all(ends, NULL);
+    free(tree);
+    free(copy);
+    free(ends);
+    free(keys);
+
+    return PASS;
+}
+
+
+
+
+
+
+
+
+
+
+
+
+// Height of a subtree (0 if empty):
+int bs_subtree_height(const bs_node *node) {
+    int left, right;
+    if (node == NULL) { return 0; }
+    left  = bs_subtree_height(node->left);
+    right = bs_subtree_height(node->right);
+    return 1 + ((left > right) ? left : right);
+}
+
+// Height of a perfectly balanced tree with n nodes: ceil(log2(n + 1))
+int bs_balanced_height(int n) {
+    int height = 0;
+    while (n > 0) { n /= 2; height++; }
+    return height;
+}
+
+// Partial rebalances (after bursts of insertions at the end):
+int bs_tree_partial_rebalance_test(int max_size) {
+
+    int i;
+    bs_tree *tree = new_bs_tree(MyComp);
+    bs_node *root = NULL;
+    bs_node *left = NULL;
+    MyData  *keys = (MyData *) malloc(4*max_size*sizeof(MyData));
+    MyData   none;
+
+    for (i=0; i<4*max_size; i++) { keys[i].key = 2*i; }
+    none.key = 1;
+
+    // Nothing to do on an empty tree:
+    if (tree == NULL)                                    { return FAIL; }
+    bs_tree_rebalance_range(tree, &keys[0], &keys[max_size]);
+    bs_tree_rebalance_below(tree, &keys[0]);
+    if (tree->root != NULL || is_bs_tree(tree) == NO)    { return FAIL; }
+
+    // A balanced tree followed by a burst of sorted insertions:
+    for (i=0; i<max_size; i++) { bs_tree_insert_max(tree, &keys[i]); }
+    bs_tree_rebalance(tree);
+    if (bs_subtree_height(tree->root) !=
+        bs_balanced_height(max_size))                    { return FAIL; }
+    root = tree->root;
+    left = root->left;
+    for (i=max_size; i<2*max_size; i++) { bs_tree_insert(tree, &keys[i]); }
+    if (bs_subtree_height(tree->root) < max_size)        { return FAIL; }
+
+    // Ranges without elements (or backwards) change nothing:
+    bs_tree_rebalance_range(tree, &none, &none);
+    bs_tree_rebalance_range(tree, &keys[2*max_size-1], &keys[max_size]);
+    bs_tree_rebalance_below(tree, &none);
+    if (bs_subtree_height(tree->root) < max_size)        { return FAIL; }
+
+    // Repair the burst only:
+    bs_tree_rebalance_range(tree, &keys[max_size], &keys[2*max_size-1]);
+    if (is_bs_tree(tree) == NO)                          { return FAIL; }
+    if (tree->root != root || root->left != left)        { return FAIL; }
+    if (bs_subtree_height(tree->root) >
+        2*bs_balanced_height(max_size))                  { return FAIL; }
+    for (i=0; i<2*max_size; i++) {
+        if (bs_tree_search(tree, &keys[i]) != &keys[i])  { return FAIL; }
+    }
+
+    // A second burst, repaired from its first node:
+    for (i=2*max_size; i<3*max_size; i++) { bs_tree_insert_max(tree, &keys[i]); }
+    bs_tree_rebalance_below(tree, &keys[2*max_size]);
+    if (is_bs_tree(tree) == NO)                          { return FAIL; }
+    if (tree->root != root || root->left != left)        { return FAIL; }
+    if (bs_subtree_height(tree->root) >
+        3*bs_balanced_height(max_size))                  { return FAIL; }
+    for (i=0; i<3*max_size; i++) {
+        if (bs_tree_search(tree, &keys[i]) != &keys[i])  { return FAIL; }
+    }
+
+    // A range that covers the root rebuilds the whole tree:
+    for (i=3*max_size; i<4*max_size; i++) { bs_tree_insert_max(tree, &keys[i]); }
+    bs_tree_rebalance_range(tree, &keys[max_size/2], &keys[3*max_size]);
+    if (is_bs_tree(tree) == NO)                          { return FAIL; }
+    if (bs_subtree_height(tree->root) !=
+        bs_balanced_height(4*max_size))                  { return FAIL; }
+    for (i=0; i<4*max_size; i++) {
+        if (bs_tree_search(tree, &keys[i]) != &keys[i])  { return FAIL; }
+    }
+
+    bs_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+
+    return PASS;
+}
+
+#ifdef BS_SCAPEGOAT
+
+// Biggest height allowed in scapegoat mode: 2 + log(n) / log(1/alpha)
+int bs_scapegoat_limit(double alpha, int n) {
+    int    height = 2;
+    double power  = 1.0;
+    while (power / alpha <= (double) n) {
+        power /= alpha;
+        height++;
+    }
+    return height;
+}
+
+// Scapegoat mode:
+int bs_tree_scapegoat_test(int max_size) {
+
+    int i, j;
+    bs_tree *tree  = new_bs_tree(MyComp);
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **batch = (void **)  malloc(max_size*sizeof(void *));
+
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+
+    // Sorted insertions in the middle third stay balanced:
+    if (tree == NULL) { return FAIL; }
+    bs_tree_set_scapegoat(tree, 0.7);
+    for (i=max_size/3; i<2*max_size/3; i++) {
+        if (bs_tree_insert(tree, &keys[i]) != NULL)     { return FAIL; }
+        if (bs_subtree_height(tree->root) >
+            bs_scapegoat_limit(0.7, i - max_size/3 + 1)) { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)                         { return FAIL; }
+    if ((int) tree->size != 2*max_size/3 - max_size/3)  { return FAIL; }
+
+    // And so do the insertions at both ends:
+    for (i=max_size/3-1; i>=0; i--) {
+        if (bs_tree_insert_min(tree, &keys[i]) != NULL) { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)                         { return FAIL; }
+    if (bs_subtree_height(tree->root) >
+        bs_scapegoat_limit(0.7, (int) tree->size))      { return FAIL; }
+    for (i=2*max_size/3; i<max_size; i += 2) {
+        if (bs_tree_insert_max(tree, &keys[i]) != NULL) { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)                         { return FAIL; }
+    if (bs_subtree_height(tree->root) >
+        bs_scapegoat_limit(0.7, (int) tree->size))      { return FAIL; }
+
+    // And the batches:
+    j = 0;
+    for (i=2*max_size/3+1; i<max_size; i += 2) { batch[j++] = &keys[i]; }
+    bs_tree_insert_batch(tree, batch, j);
+    for (i=0; i<j; i++) { if (batch[i] != NULL)         { return FAIL; } }
+    if (is_bs_tree(tree) == NO)                         { return FAIL; }
+    if ((int) tree->size != max_size)                   { return FAIL; }
+    if (bs_subtree_height(tree->root) >
+        bs_scapegoat_limit(0.7, max_size))              { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        if (bs_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+    }
+
+    // Removals keep it balanced too:
+    for (i=0; i<max_size; i++) {
+        switch (i % 3) {
+            case 0:  bs_tree_remove_min(tree);           break;
+            case 1:  bs_tree_remove_max(tree);           break;
+            default: bs_tree_remove(tree, &keys[rand() % max_size]);
+        }
+        if (i % 97 == 0) {
+            if (is_bs_tree(tree) == NO)                 { return FAIL; }
+            if (bs_subtree_height(tree->root) >
+                bs_scapegoat_limit(0.7, (int) tree->size)) { return FAIL; }
+        }
+    }
+    if (is_bs_tree(tree) == NO)                         { return FAIL; }
+
+    // Turning it off stops the rebalancing (and turning it on rebalances):
+    bs_tree_remove_all(tree, NULL);
+    if (tree->size != 0 || is_bs_tree(tree) == NO)      { return FAIL; }
+    bs_tree_set_scapegoat(tree, 0.0);
+    for (i=0; i<max_size; i++) { bs_tree_insert_max(tree, &keys[i]); }
+    if (bs_subtree_height(tree->root) != max_size)      { return FAIL; }
+    bs_tree_set_scapegoat(tree, 0.55);
+    if (is_bs_tree(tree) == NO)                         { return FAIL; }
+    if (bs_subtree_height(tree->root) >
+        bs_scapegoat_limit(0.55, max_size))             { return FAIL; }
+    for (i=0; i<max_size; i += 2) {
+        if (bs_tree_remove(tree, &keys[i]) != &keys[i]) { return FAIL; }
+    }
+    if (is_bs_tree(tree) == NO)                         { return FAIL; }
+    if ((int) tree->size != max_size / 2)               { return FAIL; }
+
+    bs_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+    free(batch);
+
+    return PASS;
+}
+
+#endif
+
+// Sequential insertions & complete deletion:
+int rb_tree_sequential_test(int max_size) {
 
     int i;
     rb_tree *tree  = new_rb_tree(MyComp);
@@ -1868,7 +2620,7 @@ int rb_tree_fast_sequential_test(int max_size) {
         
         data = (MyData *) malloc(sizeof(MyData));
         data->key = i;
-        found = rb_tree_insert_max(tree, data);
+        found = rb_tree_insert(tree, data);
 
         // It was not already there:
         if (found != NULL) { return FAIL; }
@@ -1926,18 +2678,8 @@ int rb_tree_fast_sequential_test(int max_size) {
     }
 
     // Now, clean everything!
-    for (i=max_size; i>0; i--) {
-        
-        found = rb_tree_remove_max(tree);
-
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
+    rb_tree_remove_all(tree, free);
 
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO) { return FAIL; }
-    }
-    
     // It is a rb_tree:
     if (is_rb_tree(tree) == NO) { return FAIL; }
 
@@ -1949,7 +2691,7 @@ int rb_tree_fast_sequential_test(int max_size) {
         
         data = (MyData *) malloc(sizeof(MyData));
         data->key = i;
-        found = rb_tree_insert_min(tree, data);
+        found = rb_tree_insert(tree, data);
 
         // It was not already there:
         if (found != NULL) { return FAIL; }
@@ -2007,18 +2749,8 @@ int rb_tree_fast_sequential_test(int max_size) {
     }
 
     // Now, clean everything!
-    for (i=max_size; i>0; i--) {
-        
-        found = rb_tree_remove_min(tree);
-
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
+    rb_tree_remove_all(tree, free);
 
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO) { return FAIL; }
-    }
-    
     // It is a rb_tree:
     if (is_rb_tree(tree) == NO) { return FAIL; }
 
@@ -2030,7 +2762,7 @@ int rb_tree_fast_sequential_test(int max_size) {
         
         data = (MyData *) malloc(sizeof(MyData));
         data->key = i;
-        found = rb_tree_insert_max(tree, data);
+        found = rb_tree_insert(tree, data);
 
         // It was not already there:
         if (found != NULL) { return FAIL; }
@@ -2043,7 +2775,7 @@ int rb_tree_fast_sequential_test(int max_size) {
 
         data = (MyData *) malloc(sizeof(MyData));
         data->key = -i;
-        found = rb_tree_insert_min(tree, data);
+        found = rb_tree_insert(tree, data);
 
         // It was not already there:
         if (found != NULL) { return FAIL; }
@@ -2105,27 +2837,8 @@ int rb_tree_fast_sequential_test(int max_size) {
     }
 
     // Now, clean everything!
-    for (i=1; i<=max_size; i++) {
-        
-        found = rb_tree_remove_max(tree);
-
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
-
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO) { return FAIL; }
-
-        found = rb_tree_remove_min(tree);
-
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
+    rb_tree_remove_all(tree, free);
 
-        // It is a rb_tree:
-        if (is_rb_tree(tree) == NO) { return FAIL; }
-    }
-    
     // It is a rb_tree:
     if (is_rb_tree(tree) == NO) { return FAIL; }
 
@@ -2137,8 +2850,8 @@ int rb_tree_fast_sequential_test(int max_size) {
     return PASS;
 }
 
-// Random insertions & deletions:
-int rb_tree_random_test(int max_size) {
+// Fast Sequential insertions & deletions:
+int rb_tree_fast_sequential_test(int max_size) {
 
     int i;
     rb_tree *tree  = new_rb_tree(MyComp);
@@ -2151,32 +2864,42 @@ int rb_tree_random_test(int max_size) {
     // It is empty:
     if (rb_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Insert elements randomly in the tree:
-    for (i=0; i<max_size*10; i++) {
+    // Insert elements sequentially in the tree:
+    for (i=0; i<max_size; i++) {
         
         data = (MyData *) malloc(sizeof(MyData));
-        data->key = rand() % max_size;
-
-        // Insert it:
-        found = rb_tree_insert(tree, data);
+        data->key = i;
+        found = rb_tree_insert_max(tree, data);
 
-        // If it was already there:
-        if (found != NULL) { free(found); }
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
 
         // It is a rb_tree:
         if (is_rb_tree(tree) == NO)        { return FAIL; }
 
         // It is not empty:
         if (rb_tree_is_empty(tree) == YES) { return FAIL; }
+
     }
 
-    // Check if everything is correctly sorted forward...
-    found = rb_tree_min(tree);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = rb_tree_next(tree, data);
-        if (found != NULL) {
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=0; i<max_size; i++) {
+        data->key = i;
+        found = rb_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
+
+    // Check if everything is correctly sorted forward...
+    found = rb_tree_min(tree);
+    if (found == NULL)   { return FAIL; }
+    if (found->key != 0) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = rb_tree_next(tree, data);
+        if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
             found = rb_tree_max(tree);
@@ -2188,7 +2911,8 @@ int rb_tree_random_test(int max_size) {
 
     // ...and backwards.
     found = rb_tree_max(tree);
-    if (found == NULL) { return FAIL; }
+    if (found == NULL)            { return FAIL; }
+    if (found->key != max_size-1) { return FAIL; }
     while (found != NULL) {
         data  = found;
         found = rb_tree_prev(tree, data);
@@ -2202,24 +2926,57 @@ int rb_tree_random_test(int max_size) {
         }
     }
 
-    // Remove elements randomly from the tree:
-    for (i=0; i<max_size*5; i++) {
+    // Now, clean everything!
+    for (i=max_size; i>0; i--) {
         
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = rand() % max_size;
-
-        // Remove element
-        found = rb_tree_remove(tree, data);
+        found = rb_tree_remove_max(tree);
 
-        // If it was there:
-        if (found != NULL) { free(found); }
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
         // It is a rb_tree:
         if (is_rb_tree(tree) == NO) { return FAIL; }
     }
+    
+    // It is a rb_tree:
+    if (is_rb_tree(tree) == NO) { return FAIL; }
+
+    // It is empty:
+    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+
+    // Insert elements sequentially in the tree:
+    for (i=max_size; i>0; i--) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+        found = rb_tree_insert_min(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a rb_tree:
+        if (is_rb_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
+
+    }
+
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=max_size; i>0; i--) {
+        data->key = i;
+        found = rb_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
 
     // Check if everything is correctly sorted forward...
     found = rb_tree_min(tree);
+    if (found == NULL)   { return FAIL; }
+    if (found->key != 1) { return FAIL; }
     while (found != NULL) {
         data  = found;
         found = rb_tree_next(tree, data);
@@ -2235,6 +2992,8 @@ int rb_tree_random_test(int max_size) {
 
     // ...and backwards.
     found = rb_tree_max(tree);
+    if (found == NULL)          { return FAIL; }
+    if (found->key != max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
         found = rb_tree_prev(tree, data);
@@ -2249,218 +3008,362 @@ int rb_tree_random_test(int max_size) {
     }
 
     // Now, clean everything!
-    rb_tree_remove_all(tree, free);
+    for (i=max_size; i>0; i--) {
+        
+        found = rb_tree_remove_min(tree);
+
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
+        // It is a rb_tree:
+        if (is_rb_tree(tree) == NO) { return FAIL; }
+    }
+    
     // It is a rb_tree:
     if (is_rb_tree(tree) == NO) { return FAIL; }
 
     // It is empty:
     if (rb_tree_is_empty(tree) == NO) { return FAIL; }
 
-    free(tree);
-    
-    return PASS;
-}
-
-// Set functions:
-int rb_tree_set_test(int max_size) {
-
-    int i;
-    MyData  *data  = NULL;
-    MyData  *found = NULL;
-
-    // Define some sets:
-    rb_tree *empty = new_rb_tree(MyComp);
-    rb_tree *odd   = new_rb_tree(MyComp);
-    rb_tree *even  = new_rb_tree(MyComp);
-    rb_tree *high  = new_rb_tree(MyComp);
-    rb_tree *low   = new_rb_tree(MyComp);
-    rb_tree *all   = new_rb_tree(MyComp);
-    rb_tree *aux   = new_rb_tree(MyComp);
-    rb_tree *aux_2 = new_rb_tree(MyComp);
-
-    // Define the threshold between low & high:
-    int half = max_size/2;
-
-    // Insert elements in the sets:
-    for (i=0; i<max_size; i++) {
+    // Insert elements sequentially in the tree:
+    for (i=1; i<=max_size; i++) {
         
         data = (MyData *) malloc(sizeof(MyData));
         data->key = i;
-
-        // Put them all in "all":
-        found = rb_tree_insert(all, data);
+        found = rb_tree_insert_max(tree, data);
 
         // It was not already there:
         if (found != NULL) { return FAIL; }
 
         // It is a rb_tree:
-        if (is_rb_tree(all) == NO)        { return FAIL; }
+        if (is_rb_tree(tree) == NO)        { return FAIL; }
 
         // It is not empty:
-        if (rb_tree_is_empty(all) == YES) { return FAIL; }
-
-        // Split them between even & odd:
-        if (i%2 == 0) { 
-            
-            found = rb_tree_insert(even, data);
-
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
-
-            // It is a rb_tree:
-            if (is_rb_tree(even) == NO)        { return FAIL; }
-
-            // It is not empty:
-            if (rb_tree_is_empty(even) == YES) { return FAIL; }
-
-        } else {
-            
-            found = rb_tree_insert(odd, data);
-
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
-
-            // It is a rb_tree:
-            if (is_rb_tree(odd) == NO)        { return FAIL; }
-
-            // It is not empty:
-            if (rb_tree_is_empty(odd) == YES) { return FAIL; }
-
-        }
-            
-        // Split them between low & high:
-        if (i <= half) { 
-            
-            found = rb_tree_insert(low, data);
-
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
-
-            // It is a rb_tree:
-            if (is_rb_tree(low) == NO)        { return FAIL; }
-
-            // It is not empty:
-            if (rb_tree_is_empty(low) == YES) { return FAIL; }
+        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
 
-        } else {
-            
-            found = rb_tree_insert(high, data);
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = -i;
+        found = rb_tree_insert_min(tree, data);
 
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
 
-            // It is a rb_tree:
-            if (is_rb_tree(high) == NO)        { return FAIL; }
+        // It is a rb_tree:
+        if (is_rb_tree(tree) == NO)        { return FAIL; }
 
-            // It is not empty:
-            if (rb_tree_is_empty(high) == YES) { return FAIL; }
+        // It is not empty:
+        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
 
-        }
     }
 
-    // TEST COPY: //////////////////////////////////////////////////////////////
-
-    // AUX == ALL
-    aux = rb_tree_copy(all);
-
-    // It is a rb_tree:
-    if (is_rb_tree(aux) == NO)        { return FAIL; }
-
-    // It is not empty:
-    if (rb_tree_is_empty(aux) == YES) { return FAIL; }
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=1; i<=max_size; i++) {
+        data->key = i;
+        found = rb_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+        data->key = -i;
+        found = rb_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
 
-    // Check if all data in "aux" is also in "all"...
-    found = rb_tree_min(aux);
-    if (found == NULL) { return FAIL; }
+    // Check if everything is correctly sorted forward...
+    found = rb_tree_min(tree);
+    if (found == NULL)           { return FAIL; }
+    if (found->key != -max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = rb_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = rb_tree_next(aux, data);
+        found = rb_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = rb_tree_max(aux);
+            found = rb_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = rb_tree_min(all);
-    if (found == NULL) { return FAIL; }
+
+    // ...and backwards.
+    found = rb_tree_max(tree);
+    if (found == NULL)          { return FAIL; }
+    if (found->key != max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = rb_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = rb_tree_next(all, data);
+        found = rb_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = rb_tree_max(all);
+            found = rb_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    rb_tree_remove_all(aux, NULL);
+    // Now, clean everything!
+    for (i=1; i<=max_size; i++) {
+        
+        found = rb_tree_remove_max(tree);
 
-    // TEST UNION: /////////////////////////////////////////////////////////////
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
-    // AUX == UNION(low, high) == ALL
-    aux = rb_tree_union(low, high);
+        // It is a rb_tree:
+        if (is_rb_tree(tree) == NO) { return FAIL; }
 
-    // It is a rb_tree:
-    if (is_rb_tree(aux) == NO)        { return FAIL; }
+        found = rb_tree_remove_min(tree);
 
-    // It is not empty:
-    if (rb_tree_is_empty(aux) == YES) { return FAIL; }
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
-    // Check if all data in "aux" is also in "all"...
-    found = rb_tree_min(aux);
+        // It is a rb_tree:
+        if (is_rb_tree(tree) == NO) { return FAIL; }
+    }
+    
+    // It is a rb_tree:
+    if (is_rb_tree(tree) == NO) { return FAIL; }
+
+    // It is empty:
+    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+
+    free(tree);
+    
+    return PASS;
+}
+
+// Random insertions & deletions:
+int rb_tree_random_test(int max_size) {
+
+    int i;
+    rb_tree *tree  = new_rb_tree(MyComp);
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
+
+    // It is a rb_tree:
+    if (is_rb_tree(tree) == NO) { return FAIL; }
+
+    // It is empty:
+    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+
+    // Insert elements randomly in the tree:
+    for (i=0; i<max_size*10; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = rand() % max_size;
+
+        // Insert it:
+        found = rb_tree_insert(tree, data);
+
+        // If it was already there:
+        if (found != NULL) { free(found); }
+
+        // It is a rb_tree:
+        if (is_rb_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (rb_tree_is_empty(tree) == YES) { return FAIL; }
+    }
+
+    // Check if everything is correctly sorted forward...
+    found = rb_tree_min(tree);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = rb_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = rb_tree_next(aux, data);
+        found = rb_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = rb_tree_max(aux);
+            found = rb_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = rb_tree_min(all);
+
+    // ...and backwards.
+    found = rb_tree_max(tree);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = rb_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = rb_tree_next(all, data);
+        found = rb_tree_prev(tree, data);
+        if (found != NULL) {
+            if (MyComp(data, found) <= 0) { return FAIL; }
+        } else { 
+            found = rb_tree_min(tree);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break; 
+        }
+    }
+
+    // Remove elements randomly from the tree:
+    for (i=0; i<max_size*5; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = rand() % max_size;
+
+        // Remove element
+        found = rb_tree_remove(tree, data);
+
+        // If it was there:
+        if (found != NULL) { free(found); }
+
+        // It is a rb_tree:
+        if (is_rb_tree(tree) == NO) { return FAIL; }
+    }
+
+    // Check if everything is correctly sorted forward...
+    found = rb_tree_min(tree);
+    while (found != NULL) {
+        data  = found;
+        found = rb_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = rb_tree_max(all);
+            found = rb_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
 
-    // Clean:
-    rb_tree_remove_all(aux, NULL);
+    // ...and backwards.
+    found = rb_tree_max(tree);
+    while (found != NULL) {
+        data  = found;
+        found = rb_tree_prev(tree, data);
+        if (found != NULL) {
+            if (MyComp(data, found) <= 0) { return FAIL; }
+        } else { 
+            found = rb_tree_min(tree);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break; 
+        }
+    }
 
-    // AUX == UNION(odd, all) == ALL
-    aux = rb_tree_union(odd, all);
+    // Now, clean everything!
+    rb_tree_remove_all(tree, free);
+
+    // It is a rb_tree:
+    if (is_rb_tree(tree) == NO) { return FAIL; }
+
+    // It is empty:
+    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+
+    free(tree);
+    
+    return PASS;
+}
+
+// Set functions:
+int rb_tree_set_test(int max_size) {
+
+    int i;
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
+
+    // Define some sets:
+    rb_tree *empty = new_rb_tree(MyComp);
+    rb_tree *odd   = new_rb_tree(MyComp);
+    rb_tree *even  = new_rb_tree(MyComp);
+    rb_tree *high  = new_rb_tree(MyComp);
+    rb_tree *low   = new_rb_tree(MyComp);
+    rb_tree *all   = new_rb_tree(MyComp);
+    rb_tree *aux   = new_rb_tree(MyComp);
+    rb_tree *aux_2 = new_rb_tree(MyComp);
+
+    // Define the threshold between low & high:
+    int half = max_size/2;
+
+    // Insert elements in the sets:
+    for (i=0; i<max_size; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+
+        // Put them all in "all":
+        found = rb_tree_insert(all, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a rb_tree:
+        if (is_rb_tree(all) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (rb_tree_is_empty(all) == YES) { return FAIL; }
+
+        // Split them between even & odd:
+        if (i%2 == 0) { 
+            
+            found = rb_tree_insert(even, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a rb_tree:
+            if (is_rb_tree(even) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (rb_tree_is_empty(even) == YES) { return FAIL; }
+
+        } else {
+            
+            found = rb_tree_insert(odd, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a rb_tree:
+            if (is_rb_tree(odd) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (rb_tree_is_empty(odd) == YES) { return FAIL; }
+
+        }
+            
+        // Split them between low & high:
+        if (i <= half) { 
+            
+            found = rb_tree_insert(low, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a rb_tree:
+            if (is_rb_tree(low) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (rb_tree_is_empty(low) == YES) { return FAIL; }
+
+        } else {
+            
+            found = rb_tree_insert(high, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a rb_tree:
+            if (is_rb_tree(high) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (rb_tree_is_empty(high) == YES) { return FAIL; }
+
+        }
+    }
+
+    // TEST COPY: //////////////////////////////////////////////////////////////
+
+    // AUX == ALL
+    aux = rb_tree_copy(all);
 
     // It is a rb_tree:
     if (is_rb_tree(aux) == NO)        { return FAIL; }
@@ -2507,8 +3410,10 @@ int rb_tree_set_test(int max_size) {
     // Clean:
     rb_tree_remove_all(aux, NULL);
 
-    // AUX == UNION(odd, even) == ALL
-    aux = rb_tree_union(odd, even);
+    // TEST UNION: /////////////////////////////////////////////////////////////
+
+    // AUX == UNION(low, high) == ALL
+    aux = rb_tree_union(low, high);
 
     // It is a rb_tree:
     if (is_rb_tree(aux) == NO)        { return FAIL; }
@@ -2555,8 +3460,8 @@ int rb_tree_set_test(int max_size) {
     // Clean:
     rb_tree_remove_all(aux, NULL);
 
-    // AUX == UNION(odd, empty) == ODD
-    aux = rb_tree_union(odd, empty);
+    // AUX == UNION(odd, all) == ALL
+    aux = rb_tree_union(odd, all);
 
     // It is a rb_tree:
     if (is_rb_tree(aux) == NO)        { return FAIL; }
@@ -2564,12 +3469,12 @@ int rb_tree_set_test(int max_size) {
     // It is not empty:
     if (rb_tree_is_empty(aux) == YES) { return FAIL; }
 
-    // Check if all data in "aux" is also in "odd"...
+    // Check if all data in "aux" is also in "all"...
     found = rb_tree_min(aux);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = rb_tree_search(odd, data);
+        found = rb_tree_search(all, data);
         if (found == NULL) { return FAIL; }
         found = rb_tree_next(aux, data);
         if (found != NULL) {
@@ -2582,8 +3487,104 @@ int rb_tree_set_test(int max_size) {
         }
     }
     
-    // ...and all data in "odd" is also in "aux".
-    found = rb_tree_min(odd);
+    // ...and all data in "all" is also in "aux".
+    found = rb_tree_min(all);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = rb_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = rb_tree_next(all, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = rb_tree_max(all);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    rb_tree_remove_all(aux, NULL);
+
+    // AUX == UNION(odd, even) == ALL
+    aux = rb_tree_union(odd, even);
+
+    // It is a rb_tree:
+    if (is_rb_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (rb_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "all"...
+    found = rb_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = rb_tree_search(all, data);
+        if (found == NULL) { return FAIL; }
+        found = rb_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = rb_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "all" is also in "aux".
+    found = rb_tree_min(all);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = rb_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = rb_tree_next(all, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = rb_tree_max(all);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    rb_tree_remove_all(aux, NULL);
+
+    // AUX == UNION(odd, empty) == ODD
+    aux = rb_tree_union(odd, empty);
+
+    // It is a rb_tree:
+    if (is_rb_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (rb_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "odd"...
+    found = rb_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = rb_tree_search(odd, data);
+        if (found == NULL) { return FAIL; }
+        found = rb_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = rb_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "odd" is also in "aux".
+    found = rb_tree_min(odd);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
@@ -3126,1125 +4127,2631 @@ int rb_tree_set_test(int max_size) {
     return PASS;
 }
 
+// Node pools:
+int rb_tree_pool_test(int max_size) {
 
-// Sequential insertions & complete deletion:
-int sp_tree_sequential_test(int max_size) {
-
-    int i;
-    sp_tree *tree  = new_sp_tree(MyComp);
+    int i, round;
+    rb_tree *tree  = new_rb_tree_with_pool(MyComp, 0);
+    rb_tree *aux   = NULL;
     MyData  *data  = NULL;
     MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
 
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
-
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
-
-    // Insert elements sequentially in the tree:
-    for (i=0; i<max_size; i++) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = sp_tree_insert(tree, data);
-
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
-
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+    // It is a rb_tree:
+    if (tree == NULL)           { return FAIL; }
+    if (tree->pool == NULL)     { return FAIL; }
+    if (is_rb_tree(tree) == NO) { return FAIL; }
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    // Fill it twice, so the second time all nodes are recycled:
+    for (round=0; round<2; round++) {
 
-    }
+        // Insert elements randomly in the tree:
+        for (i=0; i<max_size*10; i++) {
+            data = (MyData *) malloc(sizeof(MyData));
+            data->key = rand() % max_size;
+            found = rb_tree_insert(tree, data);
+            if (found != NULL) { free(found); }
+            if (is_rb_tree(tree) == NO) { return FAIL; }
+        }
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=0; i<max_size; i++) {
-        data->key = i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+        // Remove elements randomly from the tree:
+        data = (MyData *) malloc(sizeof(MyData));
+        for (i=0; i<max_size*5; i++) {
+            data->key = rand() % max_size;
+            found = rb_tree_remove(tree, data);
+            if (found != NULL) { free(found); }
+            if (is_rb_tree(tree) == NO) { return FAIL; }
+        }
+        free(data);
     }
-    free(data);
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    if (found == NULL)   { return FAIL; }
-    if (found->key != 0) { return FAIL; }
+    // Check if everything is correctly sorted:
+    found = rb_tree_min(tree);
     while (found != NULL) {
         data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+        found = rb_tree_next(tree, data);
+        if (found != NULL && MyComp(data, found) >= 0) { return FAIL; }
     }
 
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    if (found == NULL)            { return FAIL; }
-    if (found->key != max_size-1) { return FAIL; }    
+    // The copy & set functions use a node pool too:
+    aux = rb_tree_union(tree, tree);
+    if (aux->pool == NULL)     { return FAIL; }
+    if (is_rb_tree(aux) == NO) { return FAIL; }
+    found = rb_tree_min(aux);
     while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
-        }
+        if (rb_tree_search(tree, found) != found) { return FAIL; }
+        found = rb_tree_next(aux, found);
     }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
 
-    // Now, clean everything!
-    sp_tree_remove_all(tree, free);
+    // Remove everything freeing the data:
+    rb_tree_remove_all(tree, free);
+    if (is_rb_tree(tree) == NO)        { return FAIL; }
+    if (rb_tree_is_empty(tree) == NO)  { return FAIL; }
 
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+    // The tree can be used again after a complete deletion:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        found = rb_tree_insert(tree, &keys[i]);
+        if (found != NULL)          { return FAIL; }
+        if (is_rb_tree(tree) == NO) { return FAIL; }
+    }
+    for (i=0; i<max_size; i++) {
+        if (rb_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+    }
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+    // Remove everything without freeing the data:
+    rb_tree_remove_all(tree, NULL);
+    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Insert elements sequentially in the tree:
-    for (i=max_size; i>0; i--) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = sp_tree_insert(tree, data);
+    free(keys);
+    free(tree);
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+    return PASS;
+}
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+// Cursors:
+int rb_tree_cursor_test(int max_size) {
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    int i, j;
+    rb_tree   *tree   = new_rb_tree(MyComp);
+    rb_cursor *cursor = new_rb_cursor(tree);
+    MyData    *data   = (MyData *) malloc(sizeof(MyData));
+    MyData    *found  = NULL;
+    MyData    *keys   = (MyData *) malloc(max_size*sizeof(MyData));
 
-    }
+    // It is a rb_tree with a cursor:
+    if (tree == NULL)           { return FAIL; }
+    if (cursor == NULL)         { return FAIL; }
+    if (is_rb_tree(tree) == NO) { return FAIL; }
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=max_size; i>0; i--) {
-        data->key = i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+    // Cursors over an empty tree are always invalid:
+    if (rb_cursor_first(cursor) != NULL) { return FAIL; }
+    if (rb_cursor_last(cursor)  != NULL) { return FAIL; }
+    if (rb_cursor_next(cursor)  != NULL) { return FAIL; }
+    if (rb_cursor_prev(cursor)  != NULL) { return FAIL; }
+    if (rb_cursor_get(cursor)   != NULL) { return FAIL; }
+
+    // Insert all the even keys in random order:
+    for (i=0; i<max_size; i++) { keys[i].key = 2*i; }
+    for (i=0; i<max_size*2; i++) {
+        rb_tree_insert(tree, &keys[rand() % max_size]);
     }
-    free(data);
+    for (i=0; i<max_size; i++) { rb_tree_insert(tree, &keys[i]); }
+    if (is_rb_tree(tree) == NO) { return FAIL; }
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    if (found == NULL)   { return FAIL; }
-    if (found->key != 1) { return FAIL; }
+    // Traverse the tree forwards:
+    i = 0;
+    found = rb_cursor_first(cursor);
     while (found != NULL) {
-        data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+        if (found != &keys[i])                { return FAIL; }
+        if (rb_cursor_get(cursor) != found)   { return FAIL; }
+        found = rb_cursor_next(cursor);
+        i++;
     }
+    if (i != max_size)                        { return FAIL; }
+    if (rb_cursor_get(cursor) != NULL)        { return FAIL; }
 
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    if (found == NULL)          { return FAIL; }
-    if (found->key != max_size) { return FAIL; }
+    // Traverse the tree backwards:
+    i = max_size;
+    found = rb_cursor_last(cursor);
     while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
+        i--;
+        if (found != &keys[i])                { return FAIL; }
+        found = rb_cursor_prev(cursor);
+    }
+    if (i != 0)                               { return FAIL; }
+
+    // Seek every key (odd keys are not in the tree) and move around it:
+    for (i=-1; i<max_size*2; i++) {
+        data->key = i;
+        j = (i + 1) / 2;
+        found = rb_cursor_seek(cursor, data);
+        if (j == max_size) {
+            if (found != NULL)                { return FAIL; }
+            continue;
+        }
+        if (found != &keys[j])                { return FAIL; }
+        found = rb_cursor_next(cursor);
+        if (j + 1 == max_size) {
+            if (found != NULL)                { return FAIL; }
+            continue;
         }
+        if (found != &keys[j+1])              { return FAIL; }
+        if (rb_cursor_prev(cursor) != &keys[j]) { return FAIL; }
     }
 
-    // Now, clean everything!
-    sp_tree_remove_all(tree, free);
+    // Cursors do not modify the tree:
+    if (is_rb_tree(tree) == NO) { return FAIL; }
 
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+    free_rb_cursor(cursor);
+    rb_tree_remove_all(tree, NULL);
+    free(data);
+    free(keys);
+    free(tree);
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+    return PASS;
+}
 
-    // Insert elements sequentially in the tree:
-    for (i=1; i<=max_size; i++) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = sp_tree_insert(tree, data);
+// Read-only traversals:
+const rb_tree *rb_watched_tree = NULL;
+int            rb_watched_tree_modified = NO;
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+// Comparing function that also checks that the watched tree is not threaded:
+int rb_WatchComp(const void *ptr1, const void *ptr2) {
+    const rb_node *node = rb_watched_tree->root;
+    if (node != NULL && RB_LEFT(node) != NULL) {
+        node = RB_LEFT(node);
+        while (node->right != NULL && node->right != rb_watched_tree->root) {
+            node = node->right;
+        }
+        if (node->right != NULL) { rb_watched_tree_modified = YES; }
+    }
+    return MyComp(ptr1, ptr2);
+}
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+// Counts the elements of tree (and checks that they are sorted):
+int rb_tree_count(const rb_tree *tree) {
+    int count = 0;
+    rb_cursor *cursor = new_rb_cursor(tree);
+    MyData    *prev   = NULL;
+    MyData    *data   = rb_cursor_first(cursor);
+    while (data != NULL) {
+        if (prev != NULL && MyComp(prev, data) >= 0) { count = -1; break; }
+        prev = data;
+        data = rb_cursor_next(cursor);
+        count++;
+    }
+    free_rb_cursor(cursor);
+    return count;
+}
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+int rb_tree_const_test(int max_size) {
 
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = -i;
-        found = sp_tree_insert(tree, data);
+    int i;
+    rb_tree *tree  = new_rb_tree(rb_WatchComp);
+    rb_tree *even  = new_rb_tree(rb_WatchComp);
+    rb_tree *aux   = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+    // They are rb_trees:
+    if (tree == NULL || even == NULL) { return FAIL; }
+    rb_watched_tree = tree;
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+    // Insert the keys in decreasing order (and the even ones in another tree):
+    for (i=max_size-1; i>=0; i--) {
+        keys[i].key = i;
+        rb_tree_insert(tree, &keys[i]);
+        if (i % 2 == 0) { rb_tree_insert(even, &keys[i]); }
+    }
+    if (is_rb_tree(tree) == NO)    { return FAIL; }
+    if (rb_tree_count(tree) != max_size) { return FAIL; }
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    // Copy & set functions never modify their arguments, not even temporarily:
 
-    }
+    aux = rb_tree_copy(tree);
+    if (rb_tree_count(aux) != max_size)             { return FAIL; }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=1; i<=max_size; i++) {
-        data->key = i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
-        data->key = -i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+    aux = rb_tree_union(even, tree);
+    if (rb_tree_count(aux) != max_size)             { return FAIL; }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = rb_tree_intersection(tree, even);
+    if (rb_tree_count(aux) != (max_size + 1) / 2)   { return FAIL; }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = rb_tree_diff(tree, even);
+    if (rb_tree_count(aux) != max_size / 2)         { return FAIL; }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = rb_tree_sym_diff(even, tree);
+    if (rb_tree_count(aux) != max_size / 2)         { return FAIL; }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
+
+    if (rb_watched_tree_modified == YES) { return FAIL; }
+    if (is_rb_tree(tree) == NO)          { return FAIL; }
+
+    rb_tree_remove_all(tree, NULL);
+    rb_tree_remove_all(even, NULL);
+    free(tree);
+    free(even);
+    free(keys);
+
+    return PASS;
+}
+
+#ifdef RB_ORDER_STATISTICS
+
+// Order statistics:
+int rb_tree_order_test(int max_size) {
+
+    int i, j, count, size;
+    rb_tree *tree  = new_rb_tree(MyComp);
+    MyData  *lo    = (MyData *) malloc(sizeof(MyData));
+    MyData  *hi    = (MyData *) malloc(sizeof(MyData));
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+
+    // It is a rb_tree:
+    if (tree == NULL)                 { return FAIL; }
+    if (rb_tree_size(tree) != 0)      { return FAIL; }
+    if (rb_tree_select(tree, 0) != NULL) { return FAIL; }
+
+    // Insert all the even keys in random order:
+    for (i=0; i<max_size; i++) { keys[i].key = 2*i; }
+    size = 0;
+    for (i=0; i<max_size*2; i++) {
+        if (rb_tree_insert(tree, &keys[rand() % max_size]) == NULL) { size++; }
+        if ((int) rb_tree_size(tree) != size) { return FAIL; }
+    }
+    for (i=0; i<max_size; i++) { rb_tree_insert(tree, &keys[i]); }
+    if (is_rb_tree(tree) == NO)                { return FAIL; }
+    if ((int) rb_tree_size(tree) != max_size)  { return FAIL; }
+    size = max_size;
+
+    // Select & rank:
+    for (i=0; i<max_size; i++) {
+        if (rb_tree_select(tree, i) != &keys[i])     { return FAIL; }
+        if ((int) rb_tree_rank(tree, &keys[i]) != i) { return FAIL; }
+    }
+    if (rb_tree_select(tree, max_size) != NULL)      { return FAIL; }
+    for (j=-1; j<=max_size*2; j++) {
+        lo->key = j;
+        if ((int) rb_tree_rank(tree, lo) != (j + 1) / 2) { return FAIL; }
     }
-    free(data);
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    if (found == NULL)           { return FAIL; }
-    if (found->key != -max_size) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+    // Count ranges:
+    for (j=-10; j<=max_size*2; j++) {
+        lo->key = j;
+        hi->key = j + rand() % 20 - 5;
+        count = 0;
+        for (i=0; i<max_size; i++) {
+            if (lo->key <= keys[i].key && keys[i].key <= hi->key) { count++; }
         }
+        if ((int) rb_tree_count_range(tree, lo, hi) != count) { return FAIL; }
     }
 
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    if (found == NULL)          { return FAIL; }
-    if (found->key != max_size) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
+    // Remove elements randomly (sizes are checked by is_rb_tree):
+    for (i=0; i<max_size; i++) {
+        if      (i % 7 == 0) { found = rb_tree_remove_min(tree); }
+        else if (i % 7 == 1) { found = rb_tree_remove_max(tree); }
+        else {
+            found = rb_tree_remove(tree, &keys[rand() % max_size]);
         }
+        if (found != NULL) { size--; }
+        if ((int) rb_tree_size(tree) != size) { return FAIL; }
+        if (is_rb_tree(tree) == NO)           { return FAIL; }
     }
 
-    // Now, clean everything!
-    sp_tree_remove_all(tree, free);
-
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+    // The remaining elements are still correctly ranked:
+    for (i=0; i<size; i++) {
+        found = rb_tree_select(tree, i);
+        if ((int) rb_tree_rank(tree, found) != i) { return FAIL; }
+    }
+    rb_tree_remove_all(tree, NULL);
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+    // Sizes are also updated by insert_min & insert_max:
+    for (i=max_size/2; i<max_size; i++) { rb_tree_insert_max(tree, &keys[i]); }
+    for (i=max_size/2-1; i>=0; i--)     { rb_tree_insert_min(tree, &keys[i]); }
+    if (is_rb_tree(tree) == NO)               { return FAIL; }
+    if ((int) rb_tree_size(tree) != max_size) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        if (rb_tree_select(tree, i) != &keys[i]) { return FAIL; }
+    }
 
+    rb_tree_remove_all(tree, NULL);
+    free(keys);
+    free(lo);
+    free(hi);
     free(tree);
-    
+
     return PASS;
 }
 
-// Fast Sequential insertions & deletions:
-int sp_tree_fast_sequential_test(int max_size) {
+#endif
+
+// Marks data as discarded (without freeing it):
+void rb_Discard(void *ptr) { ((MyData *) ptr)->key = -1; }
+
+// Checks that both trees store exactly the same pointers in the same order:
+int rb_tree_same(const rb_tree *tree_1, const rb_tree *tree_2) {
+    int same = NO;
+    rb_cursor *cursor_1 = new_rb_cursor(tree_1);
+    rb_cursor *cursor_2 = new_rb_cursor(tree_2);
+    void      *data_1   = rb_cursor_first(cursor_1);
+    void      *data_2   = rb_cursor_first(cursor_2);
+    while (data_1 != NULL && data_1 == data_2) {
+        data_1 = rb_cursor_next(cursor_1);
+        data_2 = rb_cursor_next(cursor_2);
+    }
+    if (data_1 == NULL && data_2 == NULL) { same = YES; }
+    free_rb_cursor(cursor_1);
+    free_rb_cursor(cursor_2);
+    return same;
+}
 
-    int i;
-    sp_tree *tree  = new_sp_tree(MyComp);
-    MyData  *data  = NULL;
+// Split, join & join-based set functions:
+int rb_tree_join_test(int max_size) {
+
+    int i, j, type, size, discarded;
+    int n = max_size * 4;
+    rb_tree *tree  = new_rb_tree(MyComp);
+    rb_tree *aux   = NULL;
+    rb_tree *other = NULL;
+    rb_tree *check = NULL;
+    MyData  *data  = (MyData *) malloc(sizeof(MyData));
     MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(n*sizeof(MyData));
+    MyData  *keys1 = (MyData *) malloc(n*sizeof(MyData));
+    MyData  *keys2 = (MyData *) malloc(n*sizeof(MyData));
 
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+    // It is a rb_tree:
+    if (tree == NULL) { return FAIL; }
+
+    // Split & join an empty tree:
+    data->key = 0;
+    aux = rb_tree_split(tree, data);
+    if (aux == NULL)                                     { return FAIL; }
+    if (rb_tree_is_empty(tree) == NO)                    { return FAIL; }
+    if (rb_tree_is_empty(aux) == NO)                     { return FAIL; }
+    rb_tree_join(tree, aux);
+    if (rb_tree_is_empty(tree) == NO)                    { return FAIL; }
+    free(aux);
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+    // Insert all the even keys:
+    for (i=0; i<n; i++) {
+        keys[i].key = 2*i;
+        rb_tree_insert(tree, &keys[i]);
+    }
+
+    // Split at random keys and join the pieces back:
+    for (j=0; j<max_size; j++) {
+        data->key = rand() % (2*n + 2) - 1;
+        aux = rb_tree_split(tree, data);
+        if (aux == NULL)                                 { return FAIL; }
+        if (is_rb_tree(tree) == NO || is_rb_tree(aux) == NO) { return FAIL; }
+        size = (data->key <= 0) ? 0 : (data->key + 1) / 2;
+        if (size > n) { size = n; }
+        if (rb_tree_count(tree) != size)                 { return FAIL; }
+        if (rb_tree_count(aux)  != n - size)             { return FAIL; }
+        if (size > 0 && rb_tree_max(tree) != &keys[size-1]) { return FAIL; }
+        if (size < n && rb_tree_min(aux)  != &keys[size])    { return FAIL; }
+        rb_tree_join(tree, aux);
+        if (is_rb_tree(tree) == NO)                      { return FAIL; }
+        if (rb_tree_is_empty(aux) == NO)                 { return FAIL; }
+        if (rb_tree_count(tree) != n)                    { return FAIL; }
+        free(aux);
+    }
+
+    // Cut the tree in four pieces and join them back:
+    aux   = rb_tree_split(tree, &keys[n/2]);
+    other = rb_tree_split(aux,  &keys[3*n/4]);
+    check = rb_tree_split(tree, &keys[n/4]);
+    rb_tree_join(check, aux);
+    rb_tree_join(check, other);
+    rb_tree_join(tree, check);
+    if (is_rb_tree(tree) == NO)                          { return FAIL; }
+    found = rb_tree_min(tree);
+    for (i=0; i<n; i++) {
+        if (found != &keys[i])                           { return FAIL; }
+        found = rb_tree_next(tree, found);
+    }
+    rb_tree_remove_all(tree, NULL);
+    free(aux);
+    free(other);
+    free(check);
+
+    // Join-based set functions give the same result as the regular ones
+    // (with and without node pools):
+    aux = new_rb_tree_with_pool(MyComp, 0);
+    for (type=0; type<4*5; type++) {
+
+        // Fill both trees with random keys (and different pointers):
+        size = (type % 5 == 0) ? 0 : n >> (type % 5);
+        for (i=0; i<n; i++) {
+            keys1[i].key = i;
+            keys2[i].key = i;
+        }
+        for (i=0; i<size*2; i++) { rb_tree_insert(tree, &keys1[rand() % n]); }
+        for (i=0; i<n/2; i++)    { rb_tree_insert(aux,  &keys2[rand() % n]); }
+        if (type % 2 == 1) {
+            other = tree; tree = aux; aux = other;
+        }
+        size = rb_tree_count(tree) + rb_tree_count(aux);
+
+        // Compare with the regular set functions:
+        switch (type / 5) {
+        case 0:
+            check = rb_tree_union(tree, aux);
+            rb_tree_join_union(tree, aux, rb_Discard);
+            break;
+        case 1:
+            check = rb_tree_intersection(tree, aux);
+            rb_tree_join_intersection(tree, aux, rb_Discard);
+            break;
+        case 2:
+            check = rb_tree_diff(tree, aux);
+            rb_tree_join_diff(tree, aux, rb_Discard);
+            break;
+        default:
+            check = rb_tree_sym_diff(tree, aux);
+            rb_tree_join_sym_diff(tree, aux, rb_Discard);
+            break;
+        }
+        if (is_rb_tree(tree) == NO)                      { return FAIL; }
+        if (rb_tree_is_empty(aux) == NO)                 { return FAIL; }
+        if (rb_tree_same(tree, check) == NO)             { return FAIL; }
 
-    // Insert elements sequentially in the tree:
-    for (i=0; i<max_size; i++) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = sp_tree_insert_max(tree, data);
+        // Every element is either kept or discarded exactly once:
+        discarded = 0;
+        for (i=0; i<n; i++) {
+            if (keys1[i].key == -1) { discarded++; }
+            if (keys2[i].key == -1) { discarded++; }
+        }
+        if (discarded + rb_tree_count(tree) != size)     { return FAIL; }
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+        rb_tree_remove_all(check, NULL);
+        rb_tree_remove_all(tree, NULL);
+        free(check);
+    }
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+    // Special case: Both trees are the same
+    for (i=0; i<n; i++) { rb_tree_insert(tree, &keys[i]); }
+    rb_tree_join_union(tree, tree, NULL);
+    rb_tree_join_intersection(tree, tree, NULL);
+    if (rb_tree_count(tree) != n)                        { return FAIL; }
+    rb_tree_join_sym_diff(tree, tree, NULL);
+    if (rb_tree_is_empty(tree) == NO)                    { return FAIL; }
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    free(keys);
+    free(keys1);
+    free(keys2);
+    free(data);
+    free(aux);
+    free(tree);
 
-    }
+    return PASS;
+}
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
+// Bulk build from a sorted array:
+int rb_tree_sorted_test(int max_size) {
+
+    int i, j, n;
+    rb_tree *tree  = NULL;
+    rb_tree *right = NULL;
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+
+    // Sorted array of different keys:
     for (i=0; i<max_size; i++) {
-        data->key = i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+        keys[i].key = 2*i;
+        data[i]     = &keys[i];
     }
-    free(data);
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    if (found == NULL)   { return FAIL; }
-    if (found->key != 0) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+    // Build trees of every size (and the biggest one):
+    for (n=0; n<=max_size; n += (n < 300) ? 1 : 97) {
+
+        // It is a pooled rb_tree with all the elements in order:
+        tree = rb_tree_from_sorted_array(MyComp, data, n);
+        if (tree == NULL)                       { return FAIL; }
+        if (tree->pool == NULL)                 { return FAIL; }
+        if (is_rb_tree(tree) == NO)             { return FAIL; }
+        if (rb_tree_is_empty(tree) != (n == 0)) { return FAIL; }
+        found = rb_tree_min(tree);
+        for (i=0; i<n; i++) {
+            if (found != &keys[i])              { return FAIL; }
+            found = rb_tree_next(tree, found);
+        }
+        if (found != NULL)                      { return FAIL; }
+
+        // All the nodes are in the same slab:
+        if (n > 0 && *((void **) tree->pool->slabs) != NULL) { return FAIL; }
+
+        // It can be modified as usual afterwards:
+        for (j=0; j<n; j += 3) {
+            if (rb_tree_remove(tree, &keys[j]) != &keys[j]) { return FAIL; }
+            if (is_rb_tree(tree) == NO)         { return FAIL; }
         }
+        for (j=0; j<n; j += 3) {
+            if (rb_tree_insert(tree, &keys[j]) != NULL)     { return FAIL; }
+            if (is_rb_tree(tree) == NO)         { return FAIL; }
+        }
+        for (i=0; i<n; i++) {
+            if (rb_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+        }
+
+        rb_tree_remove_all(tree, NULL);
+        free(tree);
     }
 
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    if (found == NULL)            { return FAIL; }
-    if (found->key != max_size-1) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
+    // It can be split & joined (the nodes of the right half get a new pool):
+    n    = max_size;
+    tree = rb_tree_from_sorted_array(MyComp, data, n);
+    if (tree == NULL || is_rb_tree(tree) == NO)     { return FAIL; }
+    right = rb_tree_split(tree, &keys[n/2]);
+    if (right == NULL || right->pool == NULL)       { return FAIL; }
+    if (right->pool == tree->pool)                  { return FAIL; }
+    if (is_rb_tree(tree) == NO || is_rb_tree(right) == NO) { return FAIL; }
+    if (rb_tree_min(right) != &keys[n/2])           { return FAIL; }
+    for (j=n/2; j<n; j += 3) {
+        if (rb_tree_remove(right, &keys[j]) != &keys[j]) { return FAIL; }
+    }
+    rb_tree_join(tree, right);
+    if (is_rb_tree(tree) == NO || right->root != NULL) { return FAIL; }
+    for (i=0; i<n; i++) {
+        found = rb_tree_search(tree, &keys[i]);
+        if ((found == NULL) != (i >= n/2 && (i - n/2) % 3 == 0)) {
+            return FAIL;
         }
     }
+    rb_tree_remove_all(tree, NULL);
+    rb_tree_remove_all(right, NULL);
+    free(tree);
+    free(right);
 
-    // Now, clean everything!
-    for (i=max_size; i>0; i--) {
-        
-        found = sp_tree_remove_max(tree);
+    free(keys);
+    free(data);
 
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
+    return PASS;
+}
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO) { return FAIL; }
-    }
-    
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+// Checks that two subtrees have the same shape, colors & data:
+int rb_same_subtree(const rb_node *node_1, const rb_node *node_2) {
+    if (node_1 == NULL || node_2 == NULL) { return node_1 == node_2; }
+    if (node_1 == node_2)                 { return NO; }
+    if (node_1->data != node_2->data)     { return NO; }
+    if (RB_COLOR(node_1) != RB_COLOR(node_2)) { return NO; }
+    return rb_same_subtree(RB_LEFT(node_1), RB_LEFT(node_2)) &&
+           rb_same_subtree(node_1->right, node_2->right);
+}
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+// Shape-preserving clones:
+int rb_tree_clone_test(int max_size) {
 
-    // Insert elements sequentially in the tree:
-    for (i=max_size; i>0; i--) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = sp_tree_insert_min(tree, data);
+    int i, n;
+    rb_tree *tree  = NULL;
+    rb_tree *clone = NULL;
+    rb_tree *right = NULL;
+    rb_tree *other = NULL;
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+
+    // Clone trees of many sizes (and the biggest one):
+    for (n=0; n<=max_size; n += (n < 300) ? 1 : 97) {
+
+        // A randomly built tree (with some removals):
+        tree = new_rb_tree(MyComp);
+        for (i=0; i<n; i++) { rb_tree_insert(tree, &keys[rand() % n]); }
+        for (i=0; i<n; i += 5) { rb_tree_remove(tree, &keys[i]); }
+
+        // Its clone is a pooled rb_tree with the same shape & colors:
+        clone = rb_tree_clone(tree);
+        if (clone == NULL || clone->pool == NULL)           { return FAIL; }
+        if (is_rb_tree(clone) == NO)                        { return FAIL; }
+        if (rb_same_subtree(tree->root, clone->root) == NO) { return FAIL; }
+
+        // All the nodes are in the same slab:
+        if (clone->root != NULL &&
+            *((void **) clone->pool->slabs) != NULL)        { return FAIL; }
+
+        // They are independent trees:
+        for (i=0; i<n; i += 2) { rb_tree_remove(clone, &keys[i]); }
+        if (is_rb_tree(clone) == NO || is_rb_tree(tree) == NO) { return FAIL; }
+        for (i=0; i<n; i++) {
+            if (rb_tree_search(clone, &keys[i]) != NULL &&
+                rb_tree_search(tree,  &keys[i]) == NULL)    { return FAIL; }
+            if (i % 2 == 0 && rb_tree_search(clone, &keys[i]) != NULL) {
+                return FAIL;
+            }
+        }
+
+        rb_tree_remove_all(clone, NULL);
+        free(clone);
+
+        // A clone can be split & joined (the right half gets its own pool):
+        clone = rb_tree_clone(tree);
+        right = rb_tree_split(clone, &keys[n/2]);
+        if (clone == NULL || right == NULL)                 { return FAIL; }
+        if (right->pool == NULL || right->pool == clone->pool) { return FAIL; }
+        if (is_rb_tree(clone) == NO || is_rb_tree(right) == NO) { return FAIL; }
+        for (i=n/2; i<n; i += 2) {
+            found = rb_tree_remove(tree, &keys[i]);
+            if (rb_tree_remove(right, &keys[i]) != found)   { return FAIL; }
+        }
+        rb_tree_join(clone, right);
+        if (is_rb_tree(clone) == NO || right->root != NULL) { return FAIL; }
+        if (rb_tree_same(clone, tree) == NO)                { return FAIL; }
+        free(right);
+
+        // Even with trees without a pool (both ways):
+        right = rb_tree_split(clone, &keys[n/3]);
+        other = rb_tree_split(tree,  &keys[n/3]);
+        if (right == NULL || other == NULL)                 { return FAIL; }
+        if (other->pool != NULL)                            { return FAIL; }
+        rb_tree_join(clone, other);
+        rb_tree_join(tree,  right);
+        if (is_rb_tree(clone) == NO || is_rb_tree(tree) == NO) { return FAIL; }
+        if (right->root != NULL || other->root != NULL)     { return FAIL; }
+        if (rb_tree_same(clone, tree) == NO)                { return FAIL; }
+        free(other);
+
+        rb_tree_remove_all(tree, NULL);
+        rb_tree_remove_all(clone, NULL);
+        free(tree);
+        free(clone);
+        free(right);
+    }
+
+    free(keys);
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+    return PASS;
+}
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+// Batch insertions & searches:
+int rb_tree_batch_test(int max_size) {
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    int i, j, n;
+    rb_tree *tree  = new_rb_tree(MyComp);
+    rb_tree *ref   = new_rb_tree(MyComp);
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(9*max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+    void   **out   = (void **)  malloc(max_size*sizeof(void *));
+    void   **old   = (void **)  malloc(max_size*sizeof(void *));
+
+    // They are rb_trees:
+    if (tree == NULL || ref == NULL) { return FAIL; }
 
+    // Empty batches do nothing:
+    rb_tree_insert_batch(tree, data, 0);
+    rb_tree_search_batch(tree, (const void **) data, out, 0);
+    if (rb_tree_is_empty(tree) == NO) { return FAIL; }
+
+    // Insert random, sorted & reversed batches (with repeated keys):
+    for (j=0; j<8; j++) {
+        n = (j == 0) ? 1 : max_size / (8 - j);
+        for (i=0; i<n; i++) {
+            keys[j*max_size + i].key = (j % 3 == 0) ? rand() % (2*max_size)
+                                     : (j % 3 == 1) ? 2*i : 2*(n - i);
+            data[i] = &keys[j*max_size + i];
+        }
+        data[n-1] = data[0];
+        for (i=0; i<n; i++) { old[i] = rb_tree_insert(ref, data[i]); }
+
+        // Returns the same values as inserting them one by one:
+        rb_tree_insert_batch(tree, data, n);
+        if (is_rb_tree(tree) == NO)             { return FAIL; }
+        for (i=0; i<n; i++) {
+            if (data[i] != old[i])              { return FAIL; }
+        }
+
+        // And the trees store the same pointers:
+        found = rb_tree_min(ref);
+        while (found != NULL) {
+            if (rb_tree_search(tree, found) != found) { return FAIL; }
+            found = rb_tree_next(ref, found);
+        }
+        found = rb_tree_min(tree);
+        while (found != NULL) {
+            if (rb_tree_search(ref, found) != found)  { return FAIL; }
+            found = rb_tree_next(tree, found);
+        }
     }
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=max_size; i>0; i--) {
-        data->key = i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+    // Search random keys (half of them are not in the tree):
+    for (i=0; i<max_size; i++) {
+        keys[8*max_size + i].key = rand() % (4*max_size);
+        data[i] = &keys[8*max_size + i];
     }
+    rb_tree_search_batch(tree, (const void **) data, out, max_size);
+    for (i=0; i<max_size; i++) {
+        if (out[i] != rb_tree_search(ref, data[i])) { return FAIL; }
+    }
+    if (is_rb_tree(tree) == NO)                 { return FAIL; }
+
+    rb_tree_remove_all(tree, NULL);
+    rb_tree_remove_all(ref, NULL);
+    free(tree);
+    free(ref);
+    free(keys);
     free(data);
+    free(out);
+    free(old);
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    if (found == NULL)   { return FAIL; }
-    if (found->key != 1) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+    return PASS;
+}
+
+// Interleaved searches:
+int rb_tree_interleaved_test(int max_size) {
+
+    int i, n;
+    rb_tree *tree  = new_rb_tree(MyComp);
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *query = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+    void   **out   = (void **)  malloc(max_size*sizeof(void *));
+
+    // It is a rb_tree:
+    if (tree == NULL) { return FAIL; }
+
+    // Random keys (only half of them will be in the tree):
+    for (i=0; i<max_size; i++) {
+        query[i].key = rand() % (2*max_size);
+        data[i]      = &query[i];
     }
 
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    if (found == NULL)          { return FAIL; }
-    if (found->key != max_size) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
+    // Searching an empty tree:
+    rb_tree_search_interleaved(tree, (const void **) data, out, max_size);
+    for (i=0; i<max_size; i++) {
+        if (out[i] != NULL) { return FAIL; }
+    }
+
+    // Insert the even keys:
+    for (i=0; i<max_size; i++) { keys[i].key = 2*i; }
+    for (i=0; i<max_size; i++) {
+        rb_tree_insert(tree, &keys[(i * 7) % max_size]);
+    }
+
+    // Batches of every size give the same result as searching one by one:
+    for (n=0; n<=max_size; n += (n < 40) ? 1 : 97) {
+        for (i=0; i<n; i++) { out[i] = &keys[0]; }
+        rb_tree_search_interleaved(tree, (const void **) data, out, n);
+        for (i=0; i<n; i++) {
+            if (out[i] != rb_tree_search(tree, data[i])) { return FAIL; }
         }
     }
+    if (is_rb_tree(tree) == NO) { return FAIL; }
 
-    // Now, clean everything!
-    for (i=max_size; i>0; i--) {
-        
-        found = sp_tree_remove_min(tree);
+    rb_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+    free(query);
+    free(data);
+    free(out);
 
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
+    return PASS;
+}
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO) { return FAIL; }
-    }
-    
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+#ifdef TREE_STATS
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+// Operation counters:
+int rb_tree_stats_test(int max_size) {
 
-    // Insert elements sequentially in the tree:
-    for (i=1; i<=max_size; i++) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
-        found = sp_tree_insert_max(tree, data);
+    int i;
+    rb_tree    *tree  = new_rb_tree(MyComp);
+    MyData     *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    tree_stats  stats;
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+    // A new tree has not done anything yet:
+    if (tree == NULL) { return FAIL; }
+    stats = rb_tree_get_stats(tree);
+    if (stats.comparisons != 0 || stats.allocations != 0 ||
+        stats.searches    != 0 || stats.max_depth   != 0) { return FAIL; }
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+    // Insert the keys in increasing order:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        rb_tree_insert(tree, &keys[i]);
+    }
+    stats = rb_tree_get_stats(tree);
+    if ((int) stats.allocations != max_size)       { return FAIL; }
+    if ((int) stats.searches    != max_size)       { return FAIL; }
+    if (stats.comparisons < stats.depth)           { return FAIL; }
+    if (stats.max_depth == 0 || stats.releases != 0) { return FAIL; }
+    if (stats.rotations == 0 || stats.recolorings == 0) { return FAIL; }
+    if (stats.splay_steps != 0)                    { return FAIL; }
+
+    // A single search counts its depth:
+    rb_tree_reset_stats(tree);
+    rb_tree_search(tree, &keys[max_size / 3]);
+    stats = rb_tree_get_stats(tree);
+    if (stats.searches != 1 || stats.depth == 0)   { return FAIL; }
+    if (stats.depth != stats.max_depth)            { return FAIL; }
+    if (stats.allocations != 0)                    { return FAIL; }
+
+    // Removing elements releases their nodes:
+    rb_tree_reset_stats(tree);
+    for (i=0; i<max_size; i += 2) { rb_tree_remove(tree, &keys[i]); }
+    stats = rb_tree_get_stats(tree);
+    if ((int) stats.releases != (max_size + 1) / 2) { return FAIL; }
+    if ((int) stats.searches != (max_size + 1) / 2) { return FAIL; }
+    if (is_rb_tree(tree) == NO)                    { return FAIL; }
+
+    rb_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    return PASS;
+}
 
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = -i;
-        found = sp_tree_insert_min(tree, data);
+#endif
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+#ifdef TREE_KEY_PREFIX
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+// Key prefixes:
+int rb_tree_prefix_test(int max_size) {
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    int i, j;
+    size_t   with_prefix, without_prefix;
+    rb_tree *tree  = new_rb_tree(CountComp);
+    rb_tree *plain = new_rb_tree(CountComp);
+    rb_tree *aux   = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *data  = NULL;
+    MyData   key;
+
+    // Only one of them uses prefixes:
+    if (tree == NULL || plain == NULL) { return FAIL; }
+    rb_tree_set_prefix(tree, MyPrefix);
 
+    // Shuffle the keys (most of them share their prefix with 3 more keys):
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=max_size-1; i>0; i--) {
+        j       = rand() % (i + 1);
+        key     = keys[i];
+        keys[i] = keys[j];
+        keys[j] = key;
     }
 
-    // Check if all elements are there:
-    data = (MyData *) malloc(sizeof(MyData));
-    for (i=1; i<=max_size; i++) {
-        data->key = i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
-        data->key = -i;
-        found = sp_tree_search(tree, data);
-        if (found == NULL)            { return FAIL; }
-        if (MyComp(data, found) != 0) { return FAIL; }
+    // Insert them in both trees:
+    for (i=0; i<max_size; i++) {
+        if (rb_tree_insert(tree,  &keys[i]) != NULL) { return FAIL; }
+        if (rb_tree_insert(plain, &keys[i]) != NULL) { return FAIL; }
     }
-    free(data);
+    if (is_rb_tree(tree) == NO)  { return FAIL; }
+    if (is_rb_tree(plain) == NO) { return FAIL; }
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    if (found == NULL)           { return FAIL; }
-    if (found->key != -max_size) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+    // Search them in both trees counting the calls to the comparing function:
+    count_comparisons = 0;
+    for (i=0; i<max_size; i++) {
+        data = rb_tree_search(tree, &keys[i]);
+        if (data == NULL || data->key != keys[i].key) { return FAIL; }
+    }
+    with_prefix = count_comparisons;
+    count_comparisons = 0;
+    for (i=0; i<max_size; i++) {
+        data = rb_tree_search(plain, &keys[i]);
+        if (data == NULL || data->key != keys[i].key) { return FAIL; }
     }
+    without_prefix = count_comparisons;
 
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    if (found == NULL)          { return FAIL; }
-    if (found->key != max_size) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
-        }
+    // The prefixes avoid most of them:
+    if (with_prefix >= without_prefix) { return FAIL; }
+
+    // Remove the odd keys:
+    for (i=0; i<max_size; i++) {
+        if (keys[i].key % 2 == 0) { continue; }
+        key.key = keys[i].key;
+        if (rb_tree_remove(tree, &key) != &keys[i]) { return FAIL; }
+        if (rb_tree_remove(tree, &key) != NULL)     { return FAIL; }
     }
+    if (is_rb_tree(tree) == NO) { return FAIL; }
 
-    // Now, clean everything!
-    for (i=1; i<=max_size; i++) {
-        
-        found = sp_tree_remove_max(tree);
+    // Only the even keys are still there:
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        data = rb_tree_search(tree, &key);
+        if (i % 2 == 1 && data != NULL)                    { return FAIL; }
+        if (i % 2 == 0 && (data == NULL || data->key != i)) { return FAIL; }
+    }
 
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
+    // Copies & set functions keep the prefixes (even from plain trees):
+    aux = rb_tree_copy(tree);
+    if (aux == NULL || aux->prefix != MyPrefix) { return FAIL; }
+    if (is_rb_tree(aux) == NO)                  { return FAIL; }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO) { return FAIL; }
+    aux = rb_tree_union(tree, plain);
+    if (aux == NULL || aux->prefix != MyPrefix) { return FAIL; }
+    if (is_rb_tree(aux) == NO)                  { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        data = rb_tree_search(aux, &key);
+        if (data == NULL || data->key != i)     { return FAIL; }
+    }
+    rb_tree_remove_all(aux, NULL);
+    free(aux);
 
-        found = sp_tree_remove_min(tree);
+    rb_tree_remove_all(tree, NULL);
+    rb_tree_remove_all(plain, NULL);
+    free(tree);
+    free(plain);
+    free(keys);
 
-        // Not enought elements:
-        if (found == NULL) { return FAIL; }
-        else               { free(found); }
+    return PASS;
+}
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO) { return FAIL; }
+#endif
+
+// Frozen snapshots:
+int rb_tree_freeze_test(int max_size) {
+
+    int i, n;
+    rb_tree     *tree   = new_rb_tree(MyComp);
+    frozen_tree *frozen = NULL;
+    MyData      *keys   = (MyData *) malloc(2*max_size*sizeof(MyData));
+    MyData      *data   = NULL;
+    MyData       lo, hi;
+
+    // An empty tree gives an empty snapshot:
+    if (tree == NULL) { return FAIL; }
+    frozen = rb_tree_freeze(tree);
+    if (frozen == NULL || is_frozen_tree(frozen) == NO) { return FAIL; }
+    if (frozen_tree_size(frozen) != 0)                  { return FAIL; }
+    if (frozen_tree_min(frozen) != NULL)                { return FAIL; }
+    if (frozen_tree_max(frozen) != NULL)                { return FAIL; }
+    if (frozen_tree_select(frozen, 0) != NULL)          { return FAIL; }
+    free(frozen);
+
+    // Snapshots of every size (the layout changes with the height):
+    for (n=1; n<=max_size; n += 1 + n / 8) {
+
+        // Insert the even keys 0, 2, ..., 2n-2 in random order:
+        for (i=0; i<2*n; i++) { keys[i].key = i; }
+        for (i=0; i<n; i++) { rb_tree_insert(tree, &keys[2 * (rand() % n)]); }
+        for (i=0; i<n; i++) { rb_tree_insert(tree, &keys[2 * i]); }
+
+        // Freeze it:
+        frozen = rb_tree_freeze(tree);
+        if (frozen == NULL || is_frozen_tree(frozen) == NO) { return FAIL; }
+        if ((int) frozen_tree_size(frozen) != n)            { return FAIL; }
+
+        // The snapshot does not depend on the tree any more:
+        rb_tree_remove_all(tree, NULL);
+
+        // Search every key (the odd ones are not there):
+        for (i=0; i<2*n; i++) {
+            data = frozen_tree_search(frozen, &keys[i]);
+            if (i % 2 == 0 && data != &keys[i]) { return FAIL; }
+            if (i % 2 == 1 && data != NULL)     { return FAIL; }
+        }
+
+        // Min, max, prev & next:
+        if (frozen_tree_min(frozen) != &keys[0])         { return FAIL; }
+        if (frozen_tree_max(frozen) != &keys[2 * n - 2]) { return FAIL; }
+        for (i=0; i<2*n; i++) {
+            data = frozen_tree_prev(frozen, &keys[i]);
+            if (i == 0 && data != NULL)                  { return FAIL; }
+            if (i > 0 && data != &keys[(i - 1) & ~1])    { return FAIL; }
+            data = frozen_tree_next(frozen, &keys[i]);
+            if (i >= 2 * n - 2 && data != NULL)          { return FAIL; }
+            if (i < 2 * n - 2 && data != &keys[(i + 2) & ~1]) { return FAIL; }
+        }
+
+        // Ranks, selections & ranges:
+        for (i=0; i<2*n; i++) {
+            if ((int) frozen_tree_rank(frozen, &keys[i]) != (i + 1) / 2) {
+                return FAIL;
+            }
+            if (i < n && frozen_tree_select(frozen, i) != &keys[2 * i]) {
+                return FAIL;
+            }
+        }
+        if (frozen_tree_select(frozen, n) != NULL) { return FAIL; }
+        for (i=0; i<n; i++) {
+            lo.key = i;
+            hi.key = i + n;
+            if ((int) frozen_tree_count_range(frozen, &lo, &hi) !=
+                (i + n) / 2 - (i + 1) / 2 + 1) { return FAIL; }
+            if (frozen_tree_count_range(frozen, &hi, &lo) != 0) { return FAIL; }
+        }
+
+        free(frozen);
     }
-    
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
-
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
     free(tree);
-    
+    free(keys);
+
     return PASS;
 }
 
-// Random insertions & deletions:
-int sp_tree_random_test(int max_size) {
-
-    int i;
-    sp_tree *tree  = new_sp_tree(MyComp);
-    MyData  *data  = NULL;
-    MyData  *found = NULL;
+// Priority queue usage (insertions & removals at both ends):
+int rb_tree_min_max_test(int max_size) {
 
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+    int i, j, lo, hi;
+    rb_tree *tree  = new_rb_tree(MyComp);
+    rb_tree *copy  = NULL;
+    rb_tree *ends  = new_rb_tree(MyComp);
+    rb_tree *other = NULL;
+    MyData  *min   = NULL;
+    MyData  *max   = NULL;
+    MyData  *keys  = (MyData *) malloc(3*max_size*sizeof(MyData));
+
+    // Keys from -max_size to 2*max_size - 1:
+    for (i=0; i<3*max_size; i++) { keys[i].key = i - max_size; }
+
+    // An empty tree has no extremes:
+    if (tree == NULL || ends == NULL)                { return FAIL; }
+    if (rb_tree_min(tree) != NULL)                   { return FAIL; }
+    if (rb_tree_max(tree) != NULL)                   { return FAIL; }
+
+    // Random insertions in the middle third:
+    lo = 3*max_size;
+    hi = -1;
+    for (i=0; i<max_size; i++) {
+        j = max_size + rand() % max_size;
+        rb_tree_insert(tree, &keys[j]);
+        if (j < lo) { lo = j; }
+        if (j > hi) { hi = j; }
+        if (rb_tree_min(tree) != &keys[lo])          { return FAIL; }
+        if (rb_tree_max(tree) != &keys[hi])          { return FAIL; }
+    }
+    if (is_rb_tree(tree) == NO)                      { return FAIL; }
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+    // Grow it at both ends:
+    for (i=0; i<max_size; i++) {
+        if (i % 2 == 0) { rb_tree_insert_min(tree, &keys[--lo]); }
+        else            { rb_tree_insert_max(tree, &keys[++hi]); }
+        if (rb_tree_min(tree) != &keys[lo])          { return FAIL; }
+        if (rb_tree_max(tree) != &keys[hi])          { return FAIL; }
+    }
+    if (is_rb_tree(tree) == NO)                      { return FAIL; }
+
+    // Copies & set operations keep their own extremes:
+    copy = rb_tree_copy(tree);
+    if (copy == NULL || is_rb_tree(copy) == NO)      { return FAIL; }
+    if (rb_tree_min(copy) != &keys[lo])              { return FAIL; }
+    if (rb_tree_max(copy) != &keys[hi])              { return FAIL; }
+    rb_tree_insert(ends, &keys[0]);
+    rb_tree_insert(ends, &keys[3*max_size - 1]);
+    other = rb_tree_union(copy, ends);
+    if (other == NULL || is_rb_tree(other) == NO)    { return FAIL; }
+    if (rb_tree_min(other) != &keys[0])              { return FAIL; }
+    if (rb_tree_max(other) != &keys[3*max_size - 1]) { return FAIL; }
+    rb_tree_remove_all(other, NULL);
+    free(other);
+    other = rb_tree_diff(copy, ends);
+    if (other == NULL || is_rb_tree(other) == NO)    { return FAIL; }
+    if (rb_tree_min(other) != rb_tree_min(copy))     { return FAIL; }
+    if (rb_tree_max(other) != rb_tree_max(copy))     { return FAIL; }
+    rb_tree_remove_all(other, NULL);
+    free(other);
+
+    // Splitting & joining move the extremes along:
+    other = rb_tree_split(copy, &keys[(lo + hi) / 2]);
+    if (other == NULL || is_rb_tree(other) == NO)    { return FAIL; }
+    if (is_rb_tree(copy) == NO)                      { return FAIL; }
+    if (rb_tree_min(copy) != &keys[lo])              { return FAIL; }
+    if (rb_tree_max(other) != &keys[hi])             { return FAIL; }
+    if (((MyData *) rb_tree_max(copy))->key >= keys[(lo + hi) / 2].key)  {
+        return FAIL;
+    }
+    if (((MyData *) rb_tree_min(other))->key < keys[(lo + hi) / 2].key) {
+        return FAIL;
+    }
+    rb_tree_join(copy, other);
+    if (is_rb_tree(copy) == NO || is_rb_tree(other) == NO) { return FAIL; }
+    if (rb_tree_min(copy) != &keys[lo])              { return FAIL; }
+    if (rb_tree_max(copy) != &keys[hi])              { return FAIL; }
+    if (rb_tree_min(other) != NULL)                  { return FAIL; }
+    free(other);
+
+    // Remove everything from both ends (and through regular removals):
+    for (i=0; rb_tree_is_empty(tree) == NO; i++) {
+        min = rb_tree_min(tree);
+        max = rb_tree_max(tree);
+        switch (rand() % 4) {
+            case 0:  if (rb_tree_remove_min(tree) != min)     { return FAIL; }
+                     break;
+            case 1:  if (rb_tree_remove_max(tree) != max)     { return FAIL; }
+                     break;
+            case 2:  if (rb_tree_remove(tree, min) != min)    { return FAIL; }
+                     break;
+            default: if (rb_tree_remove(tree, max) != max)    { return FAIL; }
+                     break;
+        }
+        if (i % 17 == 0 && is_rb_tree(tree) == NO)   { return FAIL; }
+        if (rb_tree_is_empty(tree) == NO) {
+            if (((MyData *) rb_tree_min(tree))->key < min->key) { return FAIL; }
+            if (((MyData *) rb_tree_max(tree))->key > max->key) { return FAIL; }
+        }
+    }
+    if (rb_tree_min(tree) != NULL)                   { return FAIL; }
+    if (rb_tree_max(tree) != NULL)                   { return FAIL; }
+    if (is_rb_tree(tree) == NO)                      { return FAIL; }
+
+    // The tree is still usable after being emptied:
+    rb_tree_insert(tree, &keys[max_size]);
+    if (rb_tree_min(tree) != &keys[max_size])        { return FAIL; }
+    if (rb_tree_max(tree) != &keys[max_size])        { return FAIL; }
+    rb_tree_remove_all(copy, NULL);
+    if (is_rb_tree(copy) == NO)                      { return FAIL; }
+    if (rb_tree_min(copy) != NULL)                   { return FAIL; }
+
+    rb_tree_remove_all(tree, NULL);
+    rb_tree_remove_all(ends, NULL);
+    free(tree);
+    free(copy);
+    free(ends);
+    free(keys);
 
-    // Insert elements randomly in the tree:
-    for (i=0; i<max_size*10; i++) {
-        
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = rand() % max_size;
+    return PASS;
+}
 
-        // Insert it:
-        found = sp_tree_insert(tree, data);
-        
-        // If it was already there:
-        if (found != NULL) { free(found); }
+#ifdef RB_THREADS
+
+// Sharded trees (from a single thread):
+int sharded_rb_tree_test(int max_size) {
+
+    int i, j, size, in_1, in_2;
+    sharded_rb_tree *tree   = new_sharded_rb_tree(MyComp, 8);
+    sharded_rb_tree *evens  = new_sharded_rb_tree(MyComp, 3);
+    sharded_rb_tree *result = NULL;
+    MyData          *found  = NULL;
+    MyData          *keys   = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData          *copy   = (MyData *) malloc(sizeof(MyData));
+
+    // It is an empty sharded_rb_tree:
+    if (tree == NULL || evens == NULL)                  { return FAIL; }
+    if (sharded_rb_tree_is_empty(tree) == NO)           { return FAIL; }
+    if (sharded_rb_tree_min(tree) != NULL)              { return FAIL; }
+    if (sharded_rb_tree_max(tree) != NULL)              { return FAIL; }
+    if (sharded_rb_tree_remove_min(tree) != NULL)       { return FAIL; }
+    if (sharded_rb_tree_remove_max(tree) != NULL)       { return FAIL; }
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+
+    // Insert all the keys in random order (twice):
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=0; i<max_size; i++) {
+        j = rand() % max_size;
+        sharded_rb_tree_insert(tree, &keys[j]);
+    }
+    for (i=0; i<max_size; i++) { sharded_rb_tree_insert(tree, &keys[i]); }
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+    if ((int) sharded_rb_tree_size(tree) != max_size)   { return FAIL; }
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO)        { return FAIL; }
+    // The shards have been rebalanced on the way:
+    if (max_size > 1000 && tree->splits[0] == NULL)     { return FAIL; }
+    for (i=0; i<(int) tree->n; i++) {
+        if (tree->shards[i].size > tree->limit)         { return FAIL; }
+    }
 
-        // It is not empty:
-        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    // Search everything in order (across the shards):
+    if (sharded_rb_tree_min(tree) != &keys[0])          { return FAIL; }
+    if (sharded_rb_tree_max(tree) != &keys[max_size-1]) { return FAIL; }
+    found = sharded_rb_tree_min(tree);
+    for (i=0; i<max_size; i++) {
+        if (found != &keys[i])                          { return FAIL; }
+        if (sharded_rb_tree_search(tree, &keys[i]) != &keys[i]) {
+            return FAIL;
+        }
+        found = sharded_rb_tree_next(tree, found);
     }
+    if (found != NULL)                                  { return FAIL; }
+    found = sharded_rb_tree_max(tree);
+    for (i=max_size-1; i>=0; i--) {
+        if (found != &keys[i])                          { return FAIL; }
+        found = sharded_rb_tree_prev(tree, found);
+    }
+    if (found != NULL)                                  { return FAIL; }
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+    // Replacing a split point updates it:
+    found     = (MyData *) tree->splits[0];
+    copy->key = found->key;
+    if (sharded_rb_tree_insert(tree, copy) != found)    { return FAIL; }
+    if (tree->splits[0] != copy)                        { return FAIL; }
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+    if (sharded_rb_tree_insert(tree, found) != copy)    { return FAIL; }
+
+    // Remove some elements from both ends (and the middle):
+    for (i=0; i<max_size/4; i++) {
+        if (sharded_rb_tree_remove_min(tree) != &keys[i]) { return FAIL; }
+        if (sharded_rb_tree_remove_max(tree) != &keys[max_size-1-i]) {
+            return FAIL;
         }
     }
-    
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+    size = max_size - 2*(max_size/4);
+    for (i=max_size/4; i<max_size-max_size/4; i += 3) {
+        if (sharded_rb_tree_remove(tree, &keys[i]) != &keys[i]) {
+            return FAIL;
         }
+        if (sharded_rb_tree_remove(tree, &keys[i]) != NULL) { return FAIL; }
+        size--;
     }
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+    if ((int) sharded_rb_tree_size(tree) != size)       { return FAIL; }
 
-    // Remove elements randomly from the tree:
-    for (i=0; i<max_size*5; i++) {
+    // A manual rebalance moves the split points:
+    sharded_rb_tree_rebalance(tree);
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+    for (i=0; i<(int) tree->n; i++) {
+        if (tree->shards[i].size > (size_t) size / tree->n + 1) {
+            return FAIL;
+        }
+    }
 
-        data = (MyData *) malloc(sizeof(MyData));
-        data->key = rand() % max_size;
+    // Set functions against the even keys:
+    for (i=0; i<max_size; i += 2) { sharded_rb_tree_insert(evens, &keys[i]); }
+    result = sharded_rb_tree_union(tree, evens);
+    if (result == NULL || is_sharded_rb_tree(result) == NO) { return FAIL; }
+    if (result->n != tree->n)                           { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        in_1  = (sharded_rb_tree_search(tree,  &keys[i]) != NULL);
+        in_2  = (sharded_rb_tree_search(evens, &keys[i]) != NULL);
+        found = sharded_rb_tree_search(result, &keys[i]);
+        if ((found != NULL) != (in_1 || in_2))          { return FAIL; }
+    }
+    free_sharded_rb_tree(result);
+    result = sharded_rb_tree_intersection(tree, evens);
+    if (result == NULL || is_sharded_rb_tree(result) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        in_1  = (sharded_rb_tree_search(tree,  &keys[i]) != NULL);
+        in_2  = (sharded_rb_tree_search(evens, &keys[i]) != NULL);
+        found = sharded_rb_tree_search(result, &keys[i]);
+        if ((found != NULL) != (in_1 && in_2))          { return FAIL; }
+    }
+    free_sharded_rb_tree(result);
+    result = sharded_rb_tree_diff(tree, evens);
+    if (result == NULL || is_sharded_rb_tree(result) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        in_1  = (sharded_rb_tree_search(tree,  &keys[i]) != NULL);
+        in_2  = (sharded_rb_tree_search(evens, &keys[i]) != NULL);
+        found = sharded_rb_tree_search(result, &keys[i]);
+        if ((found != NULL) != (in_1 && !in_2))         { return FAIL; }
+    }
+    free_sharded_rb_tree(result);
+    result = sharded_rb_tree_sym_diff(tree, evens);
+    if (result == NULL || is_sharded_rb_tree(result) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        in_1  = (sharded_rb_tree_search(tree,  &keys[i]) != NULL);
+        in_2  = (sharded_rb_tree_search(evens, &keys[i]) != NULL);
+        found = sharded_rb_tree_search(result, &keys[i]);
+        if ((found != NULL) != (in_1 != in_2))          { return FAIL; }
+    }
+    free_sharded_rb_tree(result);
+    result = sharded_rb_tree_diff(tree, tree);
+    if (result == NULL || is_sharded_rb_tree(result) == NO) { return FAIL; }
+    if (sharded_rb_tree_is_empty(result) == NO)         { return FAIL; }
+    free_sharded_rb_tree(result);
+
+    // Empty it:
+    sharded_rb_tree_remove_all(tree, NULL);
+    if (sharded_rb_tree_is_empty(tree) == NO)           { return FAIL; }
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+    if (sharded_rb_tree_insert(tree, &keys[0]) != NULL) { return FAIL; }
+    if (sharded_rb_tree_min(tree) != &keys[0])          { return FAIL; }
+
+    free_sharded_rb_tree(tree);
+    free_sharded_rb_tree(evens);
+    free(keys);
+    free(copy);
 
-        // Remove element
-        found = sp_tree_remove(tree, data);
+    return PASS;
+}
 
-        // If it was there:
-        if (found != NULL) { free(found); }
-        else               { free(data); data = NULL; }
+// Arguments of every thread of "sharded_rb_tree_threads_test":
+typedef struct ShardedJob {
+    sharded_rb_tree *tree;      // Shared tree
+    MyData          *keys;      // Shared keys
+    int              size;      // Number of keys
+    int              first;     // First key of this thread
+    int              step;      // Distance between the keys of this thread
+    int              result;    // PASS or FAIL
+} ShardedJob;
 
-        // It is a sp_tree:
-        if (is_sp_tree(tree) == NO) { return FAIL; }
+// Inserts, searches, traverses and removes the keys of one thread:
+void *sharded_rb_tree_job(void *ptr) {
 
+    int i;
+    ShardedJob *job   = (ShardedJob *) ptr;
+    MyData     *found = NULL;
+
+    // Insert the keys (in increasing order, so the last shard keeps growing):
+    job->result = PASS;
+    for (i=job->first; i<job->size; i += job->step) {
+        if (sharded_rb_tree_insert(job->tree, &job->keys[i]) != NULL) {
+            job->result = FAIL;
+        }
     }
 
-    // Check if everything is correctly sorted forward...
-    found = sp_tree_min(tree);
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_next(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+    // Nobody else touches them:
+    for (i=job->first; i<job->size; i += job->step) {
+        if (sharded_rb_tree_search(job->tree, &job->keys[i]) != &job->keys[i]) {
+            job->result = FAIL;
         }
+        found = sharded_rb_tree_next(job->tree, &job->keys[i]);
+        if (found != NULL && found->key <= i)           { job->result = FAIL; }
+        found = sharded_rb_tree_prev(job->tree, &job->keys[i]);
+        if (found != NULL && found->key >= i)           { job->result = FAIL; }
     }
 
-    // ...and backwards.
-    found = sp_tree_max(tree);
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_prev(tree, data);
-        if (found != NULL) {
-            if (MyComp(data, found) <= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_min(tree);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break; 
+    // Remove every other key:
+    for (i=job->first; i<job->size; i += 2*job->step) {
+        if (sharded_rb_tree_remove(job->tree, &job->keys[i]) != &job->keys[i]) {
+            job->result = FAIL;
         }
     }
 
-    // Now, clean everything!
-    sp_tree_remove_all(tree, free);
+    return NULL;
+}
 
-    // It is a sp_tree:
-    if (is_sp_tree(tree) == NO) { return FAIL; }
+// Sharded trees (from many threads at the same time):
+int sharded_rb_tree_threads_test(int max_size) {
+
+    int i, count;
+    sharded_rb_tree *tree    = new_sharded_rb_tree(MyComp, 4);
+    MyData          *keys    = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData          *found   = NULL;
+    ShardedJob       jobs[8];
+    pthread_t        threads[8];
+
+    // Launch the threads:
+    if (tree == NULL)                                   { return FAIL; }
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=0; i<8; i++) {
+        jobs[i].tree  = tree;
+        jobs[i].keys  = keys;
+        jobs[i].size  = max_size;
+        jobs[i].first = i;
+        jobs[i].step  = 8;
+        if (pthread_create(&threads[i], NULL, sharded_rb_tree_job,
+                           &jobs[i]) != 0)              { return FAIL; }
+    }
+
+    // Meanwhile, traverse the tree (while it keeps changing):
+    for (i=0; i<10; i++) {
+        count = -1;
+        found = sharded_rb_tree_min(tree);
+        while (found != NULL) {
+            if (found->key <= count)                    { return FAIL; }
+            count = found->key;
+            found = sharded_rb_tree_next(tree, found);
+        }
+    }
+
+    // Wait for them:
+    for (i=0; i<8; i++) {
+        if (pthread_join(threads[i], NULL) != 0)        { return FAIL; }
+        if (jobs[i].result == FAIL)                     { return FAIL; }
+    }
+
+    // Exactly the keys that were not removed are still there:
+    if (is_sharded_rb_tree(tree) == NO)                 { return FAIL; }
+    count = 0;
+    for (i=0; i<max_size; i++) {
+        found = sharded_rb_tree_search(tree, &keys[i]);
+        if ((found == NULL) != (i % 16 < 8))            { return FAIL; }
+        if (found != NULL) { count++; }
+    }
+    if ((int) sharded_rb_tree_size(tree) != count)      { return FAIL; }
 
-    // It is empty:
-    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+    sharded_rb_tree_remove_all(tree, NULL);
+    free_sharded_rb_tree(tree);
+    free(keys);
 
-    free(tree);
-    
     return PASS;
 }
 
-// Set functions:
-int sp_tree_set_test(int max_size) {
+#endif
+
+#ifdef RB_THREADS
+
+// Concurrent trees (from a single thread):
+int concurrent_rb_tree_test(int max_size) {
+
+    int i, j, size = 0;
+    concurrent_rb_tree *tree  = new_concurrent_rb_tree(MyComp);
+    rb_tree            *check = new_rb_tree(MyComp);
+    rb_tree            *copy  = NULL;
+    MyData             *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData             *copies = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData              probe;
+
+    // It is an empty concurrent_rb_tree:
+    if (tree == NULL || check == NULL)                  { return FAIL; }
+    if (concurrent_rb_tree_is_empty(tree) == NO)        { return FAIL; }
+    if (concurrent_rb_tree_size(tree) != 0)             { return FAIL; }
+    if (concurrent_rb_tree_min(tree) != NULL)           { return FAIL; }
+    if (concurrent_rb_tree_max(tree) != NULL)           { return FAIL; }
+    if (concurrent_rb_tree_remove_min(tree) != NULL)    { return FAIL; }
+    if (concurrent_rb_tree_remove_max(tree) != NULL)    { return FAIL; }
+    if (is_concurrent_rb_tree(tree) == NO)              { return FAIL; }
+
+    // Insert the even keys in random order (same as a regular rb_tree):
+    for (i=0; i<max_size; i++) { keys[i].key = copies[i].key = 2*i; }
+    for (i=0; i<max_size; i++) {
+        j = rand() % max_size;
+        if (concurrent_rb_tree_insert(tree, &keys[j]) == NULL) { size++; }
+        rb_tree_insert(check, &keys[j]);
+    }
+    if (is_concurrent_rb_tree(tree) == NO)              { return FAIL; }
+    if ((int) concurrent_rb_tree_size(tree) != size)    { return FAIL; }
+
+    // Every query agrees with the regular rb_tree (also for absent keys):
+    if (concurrent_rb_tree_min(tree) != rb_tree_min(check)) { return FAIL; }
+    if (concurrent_rb_tree_max(tree) != rb_tree_max(check)) { return FAIL; }
+    for (i=-1; i<=2*max_size; i++) {
+        probe.key = i;
+        if (concurrent_rb_tree_search(tree, &probe) !=
+            rb_tree_search(check, &probe))              { return FAIL; }
+        if (concurrent_rb_tree_prev(tree, &probe) !=
+            rb_tree_prev(check, &probe))                { return FAIL; }
+        if (concurrent_rb_tree_next(tree, &probe) !=
+            rb_tree_next(check, &probe))                { return FAIL; }
+    }
+
+    // Replacements return the previous element:
+    for (i=0; i<max_size; i++) {
+        if (concurrent_rb_tree_insert(tree, &copies[i]) !=
+            rb_tree_search(check, &keys[i]))            { return FAIL; }
+    }
+    if ((int) concurrent_rb_tree_size(tree) != max_size) { return FAIL; }
+    if (concurrent_rb_tree_search(tree, &keys[0]) != &copies[0]) {
+        return FAIL;
+    }
+
+    // A copy is a regular rb_tree:
+    copy = concurrent_rb_tree_copy(tree);
+    if (copy == NULL || is_rb_tree(copy) == NO)         { return FAIL; }
+    if (rb_tree_min(copy) != &copies[0])                { return FAIL; }
+    if (rb_tree_max(copy) != &copies[max_size-1])       { return FAIL; }
+
+    // Remove the elements from both ends and from the middle:
+    size = max_size;
+    for (i=0; i<max_size/4; i++) {
+        if (concurrent_rb_tree_remove_min(tree) != &copies[i]) { return FAIL; }
+        if (concurrent_rb_tree_remove_max(tree) != &copies[max_size-1-i]) {
+            return FAIL;
+        }
+        size -= 2;
+    }
+    for (i=max_size/4; i<max_size-max_size/4; i += 3) {
+        if (concurrent_rb_tree_remove(tree, &keys[i]) != &copies[i]) {
+            return FAIL;
+        }
+        if (concurrent_rb_tree_remove(tree, &keys[i]) != NULL) { return FAIL; }
+        size--;
+    }
+    if (is_concurrent_rb_tree(tree) == NO)              { return FAIL; }
+    if ((int) concurrent_rb_tree_size(tree) != size)    { return FAIL; }
+
+    // Empty it (it can be used again):
+    concurrent_rb_tree_remove_all(tree, NULL);
+    if (concurrent_rb_tree_is_empty(tree) == NO)        { return FAIL; }
+    if (concurrent_rb_tree_size(tree) != 0)             { return FAIL; }
+    if (is_concurrent_rb_tree(tree) == NO)              { return FAIL; }
+    if (concurrent_rb_tree_insert(tree, &keys[0]) != NULL) { return FAIL; }
+    if (concurrent_rb_tree_min(tree) != &keys[0])       { return FAIL; }
+
+    concurrent_rb_tree_remove_all(tree, NULL);
+    free_concurrent_rb_tree(tree);
+    rb_tree_remove_all(check, NULL);
+    rb_tree_remove_all(copy, NULL);
+    free(check);
+    free(copy);
+    free(keys);
+    free(copies);
 
-    int i;
-    MyData  *data  = NULL;
-    MyData  *found = NULL;
+    return PASS;
+}
 
-    // Define some sets:
-    sp_tree *empty = new_sp_tree(MyComp);
-    sp_tree *odd   = new_sp_tree(MyComp);
-    sp_tree *even  = new_sp_tree(MyComp);
-    sp_tree *high  = new_sp_tree(MyComp);
-    sp_tree *low   = new_sp_tree(MyComp);
-    sp_tree *all   = new_sp_tree(MyComp);
-    sp_tree *aux   = new_sp_tree(MyComp);
-    sp_tree *aux_2 = new_sp_tree(MyComp);
+// Arguments of every reader of "concurrent_rb_tree_threads_test":
+typedef struct ConcurrentJob {
+    concurrent_rb_tree *tree;       // Shared tree
+    int                 size;       // Keys go from 0 to 2*size
+    int                 rounds;     // Number of queries
+    int                 result;     // PASS or FAIL
+} ConcurrentJob;
+
+// Searches the tree while the writer inserts and removes the odd keys. The
+// even keys are always there, so they must always be found:
+void *concurrent_rb_tree_job(void *ptr) {
+
+    int i, k;
+    ConcurrentJob *job   = (ConcurrentJob *) ptr;
+    MyData        *found = NULL;
+    MyData         probe;
+
+    job->result = PASS;
+    for (i=0; i<job->rounds; i++) {
+        k = (int) (((long) i * 7919) % job->size);
+        probe.key = 2*k;
+        found = (MyData *) concurrent_rb_tree_search(job->tree, &probe);
+        if (found == NULL || found->key != 2*k)         { job->result = FAIL; }
+        probe.key = 2*k + 1;
+        found = (MyData *) concurrent_rb_tree_search(job->tree, &probe);
+        if (found != NULL && found->key != 2*k + 1)     { job->result = FAIL; }
+        found = (MyData *) concurrent_rb_tree_next(job->tree, &probe);
+        if (k < job->size - 1 &&
+            (found == NULL || found->key != 2*k + 2))   { job->result = FAIL; }
+        probe.key = 2*k;
+        found = (MyData *) concurrent_rb_tree_next(job->tree, &probe);
+        if (k < job->size - 1 && (found == NULL ||
+            found->key < 2*k + 1 || found->key > 2*k + 2)) {
+            job->result = FAIL;
+        }
+        found = (MyData *) concurrent_rb_tree_prev(job->tree, &probe);
+        if (k > 0 && (found == NULL ||
+            found->key < 2*k - 2 || found->key > 2*k - 1)) {
+            job->result = FAIL;
+        }
+        found = (MyData *) concurrent_rb_tree_min(job->tree);
+        if (found == NULL || found->key != 0)           { job->result = FAIL; }
+    }
+
+    return NULL;
+}
 
-    // Define the threshold between low & high:
-    int half = max_size/2;
+// Concurrent trees (one writer & many readers at the same time):
+int concurrent_rb_tree_threads_test(int max_size) {
 
-    // Insert elements in the sets:
+    int i, j;
+    concurrent_rb_tree *tree  = new_concurrent_rb_tree(MyComp);
+    MyData             *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData             *data  = NULL;
+    MyData              probe;
+    ConcurrentJob       jobs[4];
+    pthread_t           threads[4];
+
+    // Insert the even keys:
+    if (tree == NULL)                                   { return FAIL; }
     for (i=0; i<max_size; i++) {
-        
+        keys[i].key = 2*i;
+        concurrent_rb_tree_insert(tree, &keys[i]);
+    }
+
+    // Launch the readers:
+    for (i=0; i<4; i++) {
+        jobs[i].tree   = tree;
+        jobs[i].size   = max_size;
+        jobs[i].rounds = 20*max_size;
+        if (pthread_create(&threads[i], NULL, concurrent_rb_tree_job,
+                           &jobs[i]) != 0)              { return FAIL; }
+    }
+
+    // Meanwhile, insert & remove (and free) the odd keys (the readers must
+    // never compare against a released element):
+    for (i=0; i<20*max_size; i++) {
+        j = rand() % max_size;
         data = (MyData *) malloc(sizeof(MyData));
-        data->key = i;
+        data->key = 2*j + 1;
+        free(concurrent_rb_tree_insert(tree, data));
+        probe.key = 2*(rand() % max_size) + 1;
+        free(concurrent_rb_tree_remove(tree, &probe));
+    }
 
-        // Put them all in "all":
-        found = sp_tree_insert(all, data);
+    // Wait for them:
+    for (i=0; i<4; i++) {
+        if (pthread_join(threads[i], NULL) != 0)        { return FAIL; }
+        if (jobs[i].result == FAIL)                     { return FAIL; }
+    }
+    if (is_concurrent_rb_tree(tree) == NO)              { return FAIL; }
 
-        // It was not already there:
-        if (found != NULL) { return FAIL; }
+    // Remove (and free) the odd keys that are left:
+    for (i=0; i<max_size; i++) {
+        probe.key = 2*i + 1;
+        free(concurrent_rb_tree_remove(tree, &probe));
+    }
+    if ((int) concurrent_rb_tree_size(tree) != max_size) { return FAIL; }
 
-        // It is a sp_tree:
-        if (is_sp_tree(all) == NO)        { return FAIL; }
+    concurrent_rb_tree_remove_all(tree, NULL);
+    free_concurrent_rb_tree(tree);
+    free(keys);
 
-        // It is not empty:
-        if (sp_tree_is_empty(all) == YES) { return FAIL; }
+    return PASS;
+}
 
-        // Split them between even & odd:
-        if (i%2 == 0) { 
-            
-            found = sp_tree_insert(even, data);
+#endif
+
+// Persistent trees (snapshots must never change):
+int prb_tree_test(int max_size) {
+
+    int i, j, k, v, size = 0;
+    prb_tree *tree     = new_prb_tree(MyComp);
+    prb_tree *versions[8];
+    MyData   *keys     = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData   *found    = NULL;
+    char     *in       = (char *) calloc(max_size, sizeof(char));
+    char     *saved    = (char *) malloc(8*max_size*sizeof(char));
+    int       sizes[8];
+
+    // It is an empty prb_tree:
+    if (tree == NULL)                                   { return FAIL; }
+    if (prb_tree_is_empty(tree) == NO)                  { return FAIL; }
+    if (prb_tree_min(tree) != NULL)                     { return FAIL; }
+    if (prb_tree_max(tree) != NULL)                     { return FAIL; }
+    if (prb_tree_remove_min(tree) != NULL)              { return FAIL; }
+    if (prb_tree_remove_max(tree) != NULL)              { return FAIL; }
+    if (is_prb_tree(tree) == NO)                        { return FAIL; }
+
+    // Random insertions & removals, taking a snapshot every now and then:
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=0, v=0; i<8*max_size; i++) {
+        j = rand() % max_size;
+        if (rand() % 3 > 0) {
+            found = (MyData *) prb_tree_insert(tree, &keys[j]);
+            if ((found != NULL) != in[j])               { return FAIL; }
+            if (in[j] == NO) { size++; }
+            in[j] = YES;
+        } else {
+            found = (MyData *) prb_tree_remove(tree, &keys[j]);
+            if ((found != NULL) != in[j])               { return FAIL; }
+            if (in[j] == YES) { size--; }
+            in[j] = NO;
+        }
+        if (i % max_size == 0) {
+            versions[v] = prb_tree_snapshot(tree);
+            if (versions[v] == NULL)                    { return FAIL; }
+            for (k=0; k<max_size; k++) { saved[v*max_size + k] = in[k]; }
+            sizes[v] = size;
+            v++;
+        }
+        if (i % 97 == 0 && is_prb_tree(tree) == NO)     { return FAIL; }
+    }
+    if (is_prb_tree(tree) == NO)                        { return FAIL; }
+    if ((int) prb_tree_size(tree) != size)              { return FAIL; }
+
+    // Empty the tree from both ends:
+    for (k=0; prb_tree_is_empty(tree) == NO; k++) {
+        found = (MyData *) ((k % 2 == 0) ? prb_tree_remove_min(tree) :
+                                           prb_tree_remove_max(tree));
+        if (found == NULL || in[found->key] == NO)      { return FAIL; }
+        if (k % 2 == 0 && prb_tree_prev(tree, found) != NULL) { return FAIL; }
+        if (k % 2 == 1 && prb_tree_next(tree, found) != NULL) { return FAIL; }
+        in[found->key] = NO;
+        size--;
+    }
+    if (size != 0 || is_prb_tree(tree) == NO)           { return FAIL; }
+
+    // Every snapshot still holds what it had (and in order):
+    for (v=0; v<8; v++) {
+        if (is_prb_tree(versions[v]) == NO)             { return FAIL; }
+        if ((int) prb_tree_size(versions[v]) != sizes[v]) { return FAIL; }
+        k = 0;
+        found = (MyData *) prb_tree_min(versions[v]);
+        for (i=0; i<max_size; i++) {
+            if (saved[v*max_size + i] == NO) {
+                if (prb_tree_search(versions[v], &keys[i]) != NULL) {
+                    return FAIL;
+                }
+                continue;
+            }
+            if (found != &keys[i])                      { return FAIL; }
+            if (prb_tree_search(versions[v], &keys[i]) != &keys[i]) {
+                return FAIL;
+            }
+            found = (MyData *) prb_tree_next(versions[v], found);
+            k++;
+        }
+        if (found != NULL || k != sizes[v])             { return FAIL; }
+    }
+
+    // Changing a snapshot does not change the others:
+    for (i=0; i<max_size; i += 2) {
+        found = (MyData *) prb_tree_remove(versions[3], &keys[i]);
+        if ((found != NULL) != saved[3*max_size + i])   { return FAIL; }
+        if (found != NULL) { sizes[3]--; }
+        if (prb_tree_insert(versions[4], &keys[i]) == NULL) { sizes[4]++; }
+    }
+    if (is_prb_tree(versions[3]) == NO)                 { return FAIL; }
+    if (is_prb_tree(versions[4]) == NO)                 { return FAIL; }
+    if ((int) prb_tree_size(versions[3]) != sizes[3])   { return FAIL; }
+    if ((int) prb_tree_size(versions[4]) != sizes[4])   { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = (MyData *) prb_tree_search(versions[2], &keys[i]);
+        if ((found != NULL) != saved[2*max_size + i])   { return FAIL; }
+        found = (MyData *) prb_tree_search(versions[5], &keys[i]);
+        if ((found != NULL) != saved[5*max_size + i])   { return FAIL; }
+    }
 
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
+    // Release the versions in any order:
+    for (v=0; v<8; v += 2) { free_prb_tree(versions[v]); }
+    for (v=1; v<8; v += 2) {
+        if (is_prb_tree(versions[v]) == NO)             { return FAIL; }
+        prb_tree_remove_all(versions[v]);
+        if (prb_tree_is_empty(versions[v]) == NO)       { return FAIL; }
+        free_prb_tree(versions[v]);
+    }
 
-            // It is a sp_tree:
-            if (is_sp_tree(even) == NO)        { return FAIL; }
+    free_prb_tree(tree);
+    free(keys);
+    free(in);
+    free(saved);
 
-            // It is not empty:
-            if (sp_tree_is_empty(even) == YES) { return FAIL; }
+    return PASS;
+}
 
-        } else {
-            
-            found = sp_tree_insert(odd, data);
+#ifdef RB_THREADS
 
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
+// Scans its own snapshot while the main thread keeps changing the tree:
+void *prb_tree_job(void *ptr) {
 
-            // It is a sp_tree:
-            if (is_sp_tree(odd) == NO)        { return FAIL; }
+    int i, count;
+    prb_tree *snapshot = (prb_tree *) ptr;
+    MyData   *found    = NULL;
+    MyData   *last     = NULL;
 
-            // It is not empty:
-            if (sp_tree_is_empty(odd) == YES) { return FAIL; }
+    for (i=0; i<10; i++) {
+        count = 0;
+        last  = NULL;
+        found = (MyData *) prb_tree_min(snapshot);
+        while (found != NULL) {
+            if (last != NULL && found->key != last->key + 1) { return ptr; }
+            count++;
+            last  = found;
+            found = (MyData *) prb_tree_next(snapshot, found);
+        }
+        if (count != (int) prb_tree_size(snapshot))     { return ptr; }
+    }
+    free_prb_tree(snapshot);
+
+    return NULL;
+}
+
+// Persistent trees (snapshots used & released by other threads):
+int prb_tree_threads_test(int max_size) {
+
+    int i, j;
+    prb_tree *tree  = new_prb_tree(MyComp);
+    prb_tree *other = NULL;
+    MyData   *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    void     *result;
+    pthread_t threads[4];
 
+    // Insert all the keys and give a snapshot to every thread:
+    if (tree == NULL)                                   { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        prb_tree_insert(tree, &keys[i]);
+    }
+    for (i=0; i<4; i++) {
+        if (pthread_create(&threads[i], NULL, prb_tree_job,
+                           prb_tree_snapshot(tree)) != 0) { return FAIL; }
+    }
+
+    // Meanwhile, keep changing the tree (and its own snapshots):
+    for (i=0; i<4*max_size; i++) {
+        j = rand() % max_size;
+        if (prb_tree_remove(tree, &keys[j]) != &keys[j]) { return FAIL; }
+        if (i % 16 == 0) {
+            free_prb_tree(other);
+            other = prb_tree_snapshot(tree);
         }
-            
-        // Split them between low & high:
-        if (i <= half) { 
-            
-            found = sp_tree_insert(low, data);
+        if (prb_tree_insert(tree, &keys[j]) != NULL)    { return FAIL; }
+    }
 
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
+    // Wait for them:
+    for (i=0; i<4; i++) {
+        if (pthread_join(threads[i], &result) != 0)     { return FAIL; }
+        if (result != NULL)                             { return FAIL; }
+    }
+    if (is_prb_tree(tree) == NO)                        { return FAIL; }
+    if (is_prb_tree(other) == NO)                       { return FAIL; }
+    if ((int) prb_tree_size(tree) != max_size)          { return FAIL; }
 
-            // It is a sp_tree:
-            if (is_sp_tree(low) == NO)        { return FAIL; }
+    free_prb_tree(tree);
+    free_prb_tree(other);
+    free(keys);
 
-            // It is not empty:
-            if (sp_tree_is_empty(low) == YES) { return FAIL; }
+    return PASS;
+}
 
-        } else {
-            
-            found = sp_tree_insert(high, data);
+#endif
 
-            // It was not already there:
-            if (found != NULL) { return FAIL; }
 
-            // It is a sp_tree:
-            if (is_sp_tree(high) == NO)        { return FAIL; }
 
-            // It is not empty:
-            if (sp_tree_is_empty(high) == YES) { return FAIL; }
 
-        }
-    }
 
-    // TEST COPY: //////////////////////////////////////////////////////////////
 
-    // AUX == ALL
-    aux = sp_tree_copy(all);
+
+
+
+
+
+
+
+
+
+// Sequential insertions & complete deletion:
+int sp_tree_sequential_test(int max_size) {
+
+    int i;
+    sp_tree *tree  = new_sp_tree(MyComp);
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
 
     // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Check if all data in "aux" is also in "all"...
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
+    // Insert elements sequentially in the tree:
+    for (i=0; i<max_size; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+        found = sp_tree_insert(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+    }
+
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=0; i<max_size; i++) {
+        data->key = i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
+    if (found == NULL)   { return FAIL; }
+    if (found->key != 0) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
+        found = sp_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux);
+            found = sp_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = sp_tree_min(all);
-    if (found == NULL) { return FAIL; }
+
+    // ...and backwards.
+    found = sp_tree_max(tree);
+    if (found == NULL)            { return FAIL; }
+    if (found->key != max_size-1) { return FAIL; }    
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(all, data);
+        found = sp_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(all);
+            found = sp_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Now, clean everything!
+    sp_tree_remove_all(tree, free);
 
-    // TEST UNION: /////////////////////////////////////////////////////////////
+    // It is a sp_tree:
+    if (is_sp_tree(tree) == NO) { return FAIL; }
 
-    // AUX == UNION(low, high) == ALL
-    aux = sp_tree_union(low, high);
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    // Insert elements sequentially in the tree:
+    for (i=max_size; i>0; i--) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+        found = sp_tree_insert(tree, data);
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
 
-    // Check if all data in "aux" is also in "all"...
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+    }
+
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=max_size; i>0; i--) {
+        data->key = i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
+    if (found == NULL)   { return FAIL; }
+    if (found->key != 1) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux);
+            found = sp_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = sp_tree_min(all);
-    if (found == NULL) { return FAIL; }
+
+    // ...and backwards.
+    found = sp_tree_max(tree);
+    if (found == NULL)          { return FAIL; }
+    if (found->key != max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(all, data);
+        found = sp_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(all);
+            found = sp_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
-
-    // AUX == UNION(odd, all) == ALL
-    aux = sp_tree_union(odd, all);
+    // Now, clean everything!
+    sp_tree_remove_all(tree, free);
 
     // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Check if all data in "aux" is also in "all"...
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
+    // Insert elements sequentially in the tree:
+    for (i=1; i<=max_size; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+        found = sp_tree_insert(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = -i;
+        found = sp_tree_insert(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+    }
+
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=1; i<=max_size; i++) {
+        data->key = i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+        data->key = -i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
+    if (found == NULL)           { return FAIL; }
+    if (found->key != -max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
+        found = sp_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux);
+            found = sp_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = sp_tree_min(all);
-    if (found == NULL) { return FAIL; }
+
+    // ...and backwards.
+    found = sp_tree_max(tree);
+    if (found == NULL)          { return FAIL; }
+    if (found->key != max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(all, data);
+        found = sp_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(all);
+            found = sp_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Now, clean everything!
+    sp_tree_remove_all(tree, free);
 
-    // AUX == UNION(odd, even) == ALL
-    aux = sp_tree_union(odd, even);
+    // It is a sp_tree:
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+
+    free(tree);
+    
+    return PASS;
+}
+
+// Fast Sequential insertions & deletions:
+int sp_tree_fast_sequential_test(int max_size) {
+
+    int i;
+    sp_tree *tree  = new_sp_tree(MyComp);
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
 
     // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Check if all data in "aux" is also in "all"...
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
+    // Insert elements sequentially in the tree:
+    for (i=0; i<max_size; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+        found = sp_tree_insert_max(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+    }
+
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=0; i<max_size; i++) {
+        data->key = i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
+    if (found == NULL)   { return FAIL; }
+    if (found->key != 0) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
+        found = sp_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux);
+            found = sp_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = sp_tree_min(all);
-    if (found == NULL) { return FAIL; }
+
+    // ...and backwards.
+    found = sp_tree_max(tree);
+    if (found == NULL)            { return FAIL; }
+    if (found->key != max_size-1) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(all, data);
+        found = sp_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(all);
+            found = sp_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Now, clean everything!
+    for (i=max_size; i>0; i--) {
+        
+        found = sp_tree_remove_max(tree);
 
-    // AUX == UNION(odd, empty) == ODD
-    aux = sp_tree_union(odd, empty);
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO) { return FAIL; }
+    }
+    
     // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Check if all data in "aux" is also in "odd"...
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_search(odd, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
+    // Insert elements sequentially in the tree:
+    for (i=max_size; i>0; i--) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+        found = sp_tree_insert_min(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+    }
+
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=max_size; i>0; i--) {
+        data->key = i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
+    if (found == NULL)   { return FAIL; }
+    if (found->key != 1) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux);
+            found = sp_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "odd" is also in "aux".
-    found = sp_tree_min(odd);
-    if (found == NULL) { return FAIL; }
+
+    // ...and backwards.
+    found = sp_tree_max(tree);
+    if (found == NULL)          { return FAIL; }
+    if (found->key != max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(odd, data);
+        found = sp_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(odd);
+            found = sp_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Now, clean everything!
+    for (i=max_size; i>0; i--) {
+        
+        found = sp_tree_remove_min(tree);
 
-    // AUX == UNION(odd, low)
-    aux = sp_tree_union(odd, low);
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO) { return FAIL; }
+    }
+    
     // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Check if all data in "odd" is also in "aux"...
-    found = sp_tree_min(odd);
-    if (found == NULL) { return FAIL; }
+    // Insert elements sequentially in the tree:
+    for (i=1; i<=max_size; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+        found = sp_tree_insert_max(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = -i;
+        found = sp_tree_insert_min(tree, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+
+    }
+
+    // Check if all elements are there:
+    data = (MyData *) malloc(sizeof(MyData));
+    for (i=1; i<=max_size; i++) {
+        data->key = i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+        data->key = -i;
+        found = sp_tree_search(tree, data);
+        if (found == NULL)            { return FAIL; }
+        if (MyComp(data, found) != 0) { return FAIL; }
+    }
+    free(data);
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
+    if (found == NULL)           { return FAIL; }
+    if (found->key != -max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(odd, data);
+        found = sp_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(odd);
+            found = sp_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
-    
-    // ...and all data in "low" is also in "aux".
-    found = sp_tree_min(low);
-    if (found == NULL) { return FAIL; }
+
+    // ...and backwards.
+    found = sp_tree_max(tree);
+    if (found == NULL)          { return FAIL; }
+    if (found->key != max_size) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(low, data);
+        found = sp_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(low);
+            found = sp_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Now, clean everything!
+    for (i=1; i<=max_size; i++) {
+        
+        found = sp_tree_remove_max(tree);
 
-    // TEST INTERSECTION: //////////////////////////////////////////////////////
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
-    // AUX == INTERSECTION(odd, all) == ODD
-    aux = sp_tree_intersection(odd, all);
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO) { return FAIL; }
+
+        found = sp_tree_remove_min(tree);
+
+        // Not enought elements:
+        if (found == NULL) { return FAIL; }
+        else               { free(found); }
 
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO) { return FAIL; }
+    }
+    
     // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Check if all data in "aux" is also in "odd"...
-    found = sp_tree_min(aux);
+    free(tree);
+    
+    return PASS;
+}
+
+// Random insertions & deletions:
+int sp_tree_random_test(int max_size) {
+
+    int i;
+    sp_tree *tree  = new_sp_tree(MyComp);
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
+
+    // It is a sp_tree:
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+
+    // Insert elements randomly in the tree:
+    for (i=0; i<max_size*10; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = rand() % max_size;
+
+        // Insert it:
+        found = sp_tree_insert(tree, data);
+        
+        // If it was already there:
+        if (found != NULL) { free(found); }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(tree) == YES) { return FAIL; }
+    }
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(odd, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
+        found = sp_tree_next(tree, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux);
+            found = sp_tree_max(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
         }
     }
     
-    // ...and all data in "odd" is also in "aux".
-    found = sp_tree_min(odd);
+    // ...and backwards.
+    found = sp_tree_max(tree);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(odd, data);
+        found = sp_tree_prev(tree, data);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
+            if (MyComp(data, found) <= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(odd);
+            found = sp_tree_min(tree);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            break; 
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Remove elements randomly from the tree:
+    for (i=0; i<max_size*5; i++) {
 
-    // AUX == INTERSECTION(odd, high)
-    aux = sp_tree_intersection(odd, high);
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = rand() % max_size;
 
-    // It is a sp_tree:
+        // Remove element
+        found = sp_tree_remove(tree, data);
+
+        // If it was there:
+        if (found != NULL) { free(found); }
+        else               { free(data); data = NULL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    }
+
+    // Check if everything is correctly sorted forward...
+    found = sp_tree_min(tree);
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_next(tree, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(tree);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // ...and backwards.
+    found = sp_tree_max(tree);
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_prev(tree, data);
+        if (found != NULL) {
+            if (MyComp(data, found) <= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_min(tree);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break; 
+        }
+    }
+
+    // Now, clean everything!
+    sp_tree_remove_all(tree, free);
+
+    // It is a sp_tree:
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+
+    free(tree);
+    
+    return PASS;
+}
+
+// Set functions:
+int sp_tree_set_test(int max_size) {
+
+    int i;
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
+
+    // Define some sets:
+    sp_tree *empty = new_sp_tree(MyComp);
+    sp_tree *odd   = new_sp_tree(MyComp);
+    sp_tree *even  = new_sp_tree(MyComp);
+    sp_tree *high  = new_sp_tree(MyComp);
+    sp_tree *low   = new_sp_tree(MyComp);
+    sp_tree *all   = new_sp_tree(MyComp);
+    sp_tree *aux   = new_sp_tree(MyComp);
+    sp_tree *aux_2 = new_sp_tree(MyComp);
+
+    // Define the threshold between low & high:
+    int half = max_size/2;
+
+    // Insert elements in the sets:
+    for (i=0; i<max_size; i++) {
+        
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = i;
+
+        // Put them all in "all":
+        found = sp_tree_insert(all, data);
+
+        // It was not already there:
+        if (found != NULL) { return FAIL; }
+
+        // It is a sp_tree:
+        if (is_sp_tree(all) == NO)        { return FAIL; }
+
+        // It is not empty:
+        if (sp_tree_is_empty(all) == YES) { return FAIL; }
+
+        // Split them between even & odd:
+        if (i%2 == 0) { 
+            
+            found = sp_tree_insert(even, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a sp_tree:
+            if (is_sp_tree(even) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (sp_tree_is_empty(even) == YES) { return FAIL; }
+
+        } else {
+            
+            found = sp_tree_insert(odd, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a sp_tree:
+            if (is_sp_tree(odd) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (sp_tree_is_empty(odd) == YES) { return FAIL; }
+
+        }
+            
+        // Split them between low & high:
+        if (i <= half) { 
+            
+            found = sp_tree_insert(low, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a sp_tree:
+            if (is_sp_tree(low) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (sp_tree_is_empty(low) == YES) { return FAIL; }
+
+        } else {
+            
+            found = sp_tree_insert(high, data);
+
+            // It was not already there:
+            if (found != NULL) { return FAIL; }
+
+            // It is a sp_tree:
+            if (is_sp_tree(high) == NO)        { return FAIL; }
+
+            // It is not empty:
+            if (sp_tree_is_empty(high) == YES) { return FAIL; }
+
+        }
+    }
+
+    // TEST COPY: //////////////////////////////////////////////////////////////
+
+    // AUX == ALL
+    aux = sp_tree_copy(all);
+
+    // It is a sp_tree:
     if (is_sp_tree(aux) == NO)        { return FAIL; }
 
     // It is not empty:
     if (sp_tree_is_empty(aux) == YES) { return FAIL; }
 
-    // Check if all data in "aux" is also in "odd"...
+    // Check if all data in "aux" is also in "all"...
     found = sp_tree_min(aux);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(odd, data);
+        found = sp_tree_search(all, data);
         if (found == NULL) { return FAIL; }
         found = sp_tree_next(aux, data);
         if (found != NULL) {
@@ -4257,18 +6764,18 @@ int sp_tree_set_test(int max_size) {
         }
     }
     
-    // ...and all data in "aux" is also in "high"...
-    found = sp_tree_min(aux);
+    // ...and all data in "all" is also in "aux".
+    found = sp_tree_min(all);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(high, data);
+        found = sp_tree_search(aux, data);
         if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
+        found = sp_tree_next(all, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux);
+            found = sp_tree_max(all);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
@@ -4278,28 +6785,10 @@ int sp_tree_set_test(int max_size) {
     // Clean:
     sp_tree_remove_all(aux, NULL);
 
-    // AUX == INTERSECTION(empty, all) == EMPTY
-    aux = sp_tree_intersection(empty, all);
-
-    // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)       { return FAIL; }
-
-    // It is empty:
-    if (sp_tree_is_empty(aux) == NO) { return FAIL; }
-
-    // AUX == INTERSECTION(odd, even) == EMPTY
-    aux = sp_tree_intersection(odd, even);
-
-    // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)       { return FAIL; }
-
-    // It is empty:
-    if (sp_tree_is_empty(aux) == NO) { return FAIL; }
-
-    // TEST DIFFERENCE: ////////////////////////////////////////////////////////
+    // TEST UNION: /////////////////////////////////////////////////////////////
 
-    // AUX == DIFFERENCE(all, odd) == EVEN
-    aux = sp_tree_diff(all, odd);
+    // AUX == UNION(low, high) == ALL
+    aux = sp_tree_union(low, high);
 
     // It is a sp_tree:
     if (is_sp_tree(aux) == NO)        { return FAIL; }
@@ -4307,12 +6796,12 @@ int sp_tree_set_test(int max_size) {
     // It is not empty:
     if (sp_tree_is_empty(aux) == YES) { return FAIL; }
 
-    // Check if all data in "aux" is also in "even"...
+    // Check if all data in "aux" is also in "all"...
     found = sp_tree_min(aux);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(even, data);
+        found = sp_tree_search(all, data);
         if (found == NULL) { return FAIL; }
         found = sp_tree_next(aux, data);
         if (found != NULL) {
@@ -4325,18 +6814,18 @@ int sp_tree_set_test(int max_size) {
         }
     }
     
-    // ...and all data in "even" is also in "aux".
-    found = sp_tree_min(even);
+    // ...and all data in "all" is also in "aux".
+    found = sp_tree_min(all);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
         found = sp_tree_search(aux, data);
         if (found == NULL) { return FAIL; }
-        found = sp_tree_next(even, data);
+        found = sp_tree_next(all, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(even);
+            found = sp_tree_max(all);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
@@ -4346,9 +6835,8 @@ int sp_tree_set_test(int max_size) {
     // Clean:
     sp_tree_remove_all(aux, NULL);
 
-    // AUX == DIFFERENCE(odd, high) == INTERSECTION(odd, low) == AUX_2
-    aux   = sp_tree_diff(odd, high);
-    aux_2 = sp_tree_intersection(odd, low);
+    // AUX == UNION(odd, all) == ALL
+    aux = sp_tree_union(odd, all);
 
     // It is a sp_tree:
     if (is_sp_tree(aux) == NO)        { return FAIL; }
@@ -4356,18 +6844,12 @@ int sp_tree_set_test(int max_size) {
     // It is not empty:
     if (sp_tree_is_empty(aux) == YES) { return FAIL; }
 
-    // It is a sp_tree:
-    if (is_sp_tree(aux_2) == NO)        { return FAIL; }
-
-    // It is not empty:
-    if (sp_tree_is_empty(aux_2) == YES) { return FAIL; }
-
-    // Check if all data in "aux" is also in "aux_2"...
+    // Check if all data in "aux" is also in "all"...
     found = sp_tree_min(aux);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
-        found = sp_tree_search(aux_2, data);
+        found = sp_tree_search(all, data);
         if (found == NULL) { return FAIL; }
         found = sp_tree_next(aux, data);
         if (found != NULL) {
@@ -4380,18 +6862,18 @@ int sp_tree_set_test(int max_size) {
         }
     }
     
-    // ...and all data in "aux_2" is also in "aux"...
-    found = sp_tree_min(aux_2);
+    // ...and all data in "all" is also in "aux".
+    found = sp_tree_min(all);
     if (found == NULL) { return FAIL; }
     while (found != NULL) {
         data  = found;
         found = sp_tree_search(aux, data);
         if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux_2, data);
+        found = sp_tree_next(all, data);
         if (found != NULL) {
             if (MyComp(data, found) >= 0) { return FAIL; }
         } else { 
-            found = sp_tree_max(aux_2);
+            found = sp_tree_max(all);
             if (found == NULL)            { return FAIL; }
             if (MyComp(data, found) != 0) { return FAIL; }
             break;
@@ -4399,16 +6881,15 @@ int sp_tree_set_test(int max_size) {
     }
 
     // Clean:
-    sp_tree_remove_all(aux,   NULL);
-    sp_tree_remove_all(aux_2, NULL);
+    sp_tree_remove_all(aux, NULL);
 
-    // AUX == DIFFERENCE(all, empty) == ALL
-    aux = sp_tree_diff(all, empty);
+    // AUX == UNION(odd, even) == ALL
+    aux = sp_tree_union(odd, even);
 
     // It is a sp_tree:
     if (is_sp_tree(aux) == NO)        { return FAIL; }
 
-    // It is empty:
+    // It is not empty:
     if (sp_tree_is_empty(aux) == YES) { return FAIL; }
 
     // Check if all data in "aux" is also in "all"...
@@ -4447,214 +6928,2106 @@ int sp_tree_set_test(int max_size) {
         }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == UNION(odd, empty) == ODD
+    aux = sp_tree_union(odd, empty);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "odd"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(odd, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "odd" is also in "aux".
+    found = sp_tree_min(odd);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(odd, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(odd);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == UNION(odd, low)
+    aux = sp_tree_union(odd, low);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "odd" is also in "aux"...
+    found = sp_tree_min(odd);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(odd, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(odd);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "low" is also in "aux".
+    found = sp_tree_min(low);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(low, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(low);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // TEST INTERSECTION: //////////////////////////////////////////////////////
+
+    // AUX == INTERSECTION(odd, all) == ODD
+    aux = sp_tree_intersection(odd, all);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "odd"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(odd, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "odd" is also in "aux".
+    found = sp_tree_min(odd);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(odd, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(odd);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == INTERSECTION(odd, high)
+    aux = sp_tree_intersection(odd, high);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "odd"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(odd, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "aux" is also in "high"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(high, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == INTERSECTION(empty, all) == EMPTY
+    aux = sp_tree_intersection(empty, all);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)       { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(aux) == NO) { return FAIL; }
+
+    // AUX == INTERSECTION(odd, even) == EMPTY
+    aux = sp_tree_intersection(odd, even);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)       { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(aux) == NO) { return FAIL; }
+
+    // TEST DIFFERENCE: ////////////////////////////////////////////////////////
+
+    // AUX == DIFFERENCE(all, odd) == EVEN
+    aux = sp_tree_diff(all, odd);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "even"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(even, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "even" is also in "aux".
+    found = sp_tree_min(even);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(even, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(even);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == DIFFERENCE(odd, high) == INTERSECTION(odd, low) == AUX_2
+    aux   = sp_tree_diff(odd, high);
+    aux_2 = sp_tree_intersection(odd, low);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux_2) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux_2) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "aux_2"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux_2, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "aux_2" is also in "aux"...
+    found = sp_tree_min(aux_2);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux_2, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux_2);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux,   NULL);
+    sp_tree_remove_all(aux_2, NULL);
+
+    // AUX == DIFFERENCE(all, empty) == ALL
+    aux = sp_tree_diff(all, empty);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "all"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(all, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "all" is also in "aux".
+    found = sp_tree_min(all);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(all, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(all);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == DIFFERENCE(empty, all) == EMPTY
+    aux = sp_tree_diff(empty, all);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)       { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(aux) == NO) { return FAIL; }
+
+    // TEST SYMMETRIC DIFFERENCE: //////////////////////////////////////////////
+
+    // AUX == SYMMETRIC_DIFFERENCE(all, odd) == EVEN
+    aux = sp_tree_sym_diff(all, odd);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "even"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(even, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "even" is also in "aux".
+    found = sp_tree_min(even);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(even, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(even);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == SYMMETRIC_DIFFERENCE(odd, high)
+    aux = sp_tree_sym_diff(odd, high);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "odd" or "high" but not in both.
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(odd, data);
+        if (found == NULL) {
+            found = sp_tree_search(high, data);
+            if (found == NULL) { return FAIL; }
+        } else {
+            found = sp_tree_search(high, data);
+            if (found != NULL) { return FAIL; }
+        }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == SYMMETRIC_DIFFERENCE(all, empty) == ALL
+    aux = sp_tree_sym_diff(all, empty);
+
+    // It is a sp_tree:
+    if (is_sp_tree(aux) == NO)        { return FAIL; }
+
+    // It is empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "all"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(all, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "all" is also in "aux".
+    found = sp_tree_min(all);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(all, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(all);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // AUX == SYMMETRIC_DIFFERENCE(empty, all) == ALL
+    aux = sp_tree_sym_diff(empty, all);
+
+    // It is not empty:
+    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+
+    // Check if all data in "aux" is also in "all"...
+    found = sp_tree_min(aux);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(all, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(aux, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(aux);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+    
+    // ...and all data in "all" is also in "aux".
+    found = sp_tree_min(all);
+    if (found == NULL) { return FAIL; }
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_search(aux, data);
+        if (found == NULL) { return FAIL; }
+        found = sp_tree_next(all, data);
+        if (found != NULL) {
+            if (MyComp(data, found) >= 0) { return FAIL; }
+        } else { 
+            found = sp_tree_max(all);
+            if (found == NULL)            { return FAIL; }
+            if (MyComp(data, found) != 0) { return FAIL; }
+            break;
+        }
+    }
+
+    // Clean:
+    sp_tree_remove_all(aux, NULL);
+
+    // FINAL CLEAN UP:
+    sp_tree_remove_all(aux, NULL);
+    sp_tree_remove_all(odd, NULL);
+    sp_tree_remove_all(low, NULL);
+    sp_tree_remove_all(even, NULL);
+    sp_tree_remove_all(high, NULL);
+    sp_tree_remove_all(all, free);
+    free(aux);
+    free(odd);
+    free(low);
+    free(even);
+    free(high);
+    free(all);
+
+    return PASS;
+}
+
+// Node pools:
+int sp_tree_pool_test(int max_size) {
+
+    int i, round;
+    sp_tree *tree  = new_sp_tree_with_pool(MyComp, 0);
+    sp_tree *aux   = NULL;
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+
+    // It is a sp_tree:
+    if (tree == NULL)           { return FAIL; }
+    if (tree->pool == NULL)     { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    // Fill it twice, so the second time all nodes are recycled:
+    for (round=0; round<2; round++) {
+
+        // Insert elements randomly in the tree:
+        for (i=0; i<max_size*10; i++) {
+            data = (MyData *) malloc(sizeof(MyData));
+            data->key = rand() % max_size;
+            found = sp_tree_insert(tree, data);
+            if (found != NULL) { free(found); }
+            if (is_sp_tree(tree) == NO) { return FAIL; }
+        }
+
+        // Remove elements randomly from the tree:
+        data = (MyData *) malloc(sizeof(MyData));
+        for (i=0; i<max_size*5; i++) {
+            data->key = rand() % max_size;
+            found = sp_tree_remove(tree, data);
+            if (found != NULL) { free(found); }
+            if (is_sp_tree(tree) == NO) { return FAIL; }
+        }
+        free(data);
+    }
+
+    // Check if everything is correctly sorted:
+    found = sp_tree_min(tree);
+    while (found != NULL) {
+        data  = found;
+        found = sp_tree_next(tree, data);
+        if (found != NULL && MyComp(data, found) >= 0) { return FAIL; }
+    }
+
+    // The copy & set functions use a node pool too:
+    aux = sp_tree_union(tree, tree);
+    if (aux->pool == NULL)     { return FAIL; }
+    if (is_sp_tree(aux) == NO) { return FAIL; }
+    found = sp_tree_min(aux);
+    while (found != NULL) {
+        if (sp_tree_search(tree, found) != found) { return FAIL; }
+        found = sp_tree_next(aux, found);
+    }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    // Remove everything freeing the data:
+    sp_tree_remove_all(tree, free);
+    if (is_sp_tree(tree) == NO)        { return FAIL; }
+    if (sp_tree_is_empty(tree) == NO)  { return FAIL; }
+
+    // The tree can be used again after a complete deletion:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        found = sp_tree_insert(tree, &keys[i]);
+        if (found != NULL)          { return FAIL; }
+        if (is_sp_tree(tree) == NO) { return FAIL; }
+    }
+    for (i=0; i<max_size; i++) {
+        if (sp_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+    }
+
+    // Remove everything without freeing the data:
+    sp_tree_remove_all(tree, NULL);
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+
+    free(keys);
+    free(tree);
+
+    return PASS;
+}
+
+// Cursors:
+int sp_tree_cursor_test(int max_size) {
+
+    int i, j;
+    sp_tree   *tree   = new_sp_tree(MyComp);
+    sp_cursor *cursor = new_sp_cursor(tree);
+    MyData    *data   = (MyData *) malloc(sizeof(MyData));
+    MyData    *found  = NULL;
+    MyData    *keys   = (MyData *) malloc(max_size*sizeof(MyData));
+
+    // It is a sp_tree with a cursor:
+    if (tree == NULL)           { return FAIL; }
+    if (cursor == NULL)         { return FAIL; }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    // Cursors over an empty tree are always invalid:
+    if (sp_cursor_first(cursor) != NULL) { return FAIL; }
+    if (sp_cursor_last(cursor)  != NULL) { return FAIL; }
+    if (sp_cursor_next(cursor)  != NULL) { return FAIL; }
+    if (sp_cursor_prev(cursor)  != NULL) { return FAIL; }
+    if (sp_cursor_get(cursor)   != NULL) { return FAIL; }
+
+    // Insert all the even keys in random order:
+    for (i=0; i<max_size; i++) { keys[i].key = 2*i; }
+    for (i=0; i<max_size*2; i++) {
+        sp_tree_insert(tree, &keys[rand() % max_size]);
+    }
+    for (i=0; i<max_size; i++) { sp_tree_insert(tree, &keys[i]); }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    // Traverse the tree forwards:
+    i = 0;
+    found = sp_cursor_first(cursor);
+    while (found != NULL) {
+        if (found != &keys[i])                { return FAIL; }
+        if (sp_cursor_get(cursor) != found)   { return FAIL; }
+        found = sp_cursor_next(cursor);
+        i++;
+    }
+    if (i != max_size)                        { return FAIL; }
+    if (sp_cursor_get(cursor) != NULL)        { return FAIL; }
+
+    // Traverse the tree backwards:
+    i = max_size;
+    found = sp_cursor_last(cursor);
+    while (found != NULL) {
+        i--;
+        if (found != &keys[i])                { return FAIL; }
+        found = sp_cursor_prev(cursor);
+    }
+    if (i != 0)                               { return FAIL; }
+
+    // Seek every key (odd keys are not in the tree) and move around it:
+    for (i=-1; i<max_size*2; i++) {
+        data->key = i;
+        j = (i + 1) / 2;
+        found = sp_cursor_seek(cursor, data);
+        if (j == max_size) {
+            if (found != NULL)                { return FAIL; }
+            continue;
+        }
+        if (found != &keys[j])                { return FAIL; }
+        found = sp_cursor_next(cursor);
+        if (j + 1 == max_size) {
+            if (found != NULL)                { return FAIL; }
+            continue;
+        }
+        if (found != &keys[j+1])              { return FAIL; }
+        if (sp_cursor_prev(cursor) != &keys[j]) { return FAIL; }
+    }
+
+    // Cursors do not modify the tree:
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    free_sp_cursor(cursor);
+    sp_tree_remove_all(tree, NULL);
+    free(data);
+    free(keys);
+    free(tree);
+
+    return PASS;
+}
+
+// Returns the sum of depth * (key + 1) over the nodes of a subtree, which
+// changes with any rotation:
+long sp_tree_shape(const sp_node *node, long depth) {
+    if (node == NULL) { return 0; }
+    return depth * (((MyData *) node->data)->key + 1) +
+           sp_tree_shape(node->left,  depth + 1) +
+           sp_tree_shape(node->right, depth + 1);
+}
+
+// Copy & set functions do not splay their arguments:
+int sp_tree_const_test(int max_size) {
+
+    int i;
+    long     shape_1, shape_2;
+    sp_tree *tree  = new_sp_tree(MyComp);
+    sp_tree *even  = new_sp_tree(MyComp);
+    sp_tree *aux   = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+
+    // They are sp_trees:
+    if (tree == NULL || even == NULL) { return FAIL; }
+
+    // Insert the keys in random order (and the even ones in another tree):
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=0; i<max_size; i++) {
+        sp_tree_insert(tree, &keys[rand() % max_size]);
+        sp_tree_insert(even, &keys[2*(rand() % ((max_size + 1) / 2))]);
+    }
+    for (i=0; i<max_size; i++) {
+        sp_tree_insert(tree, &keys[i]);
+        if (i % 2 == 0) { sp_tree_insert(even, &keys[i]); }
+    }
+
+    // Give them some shape:
+    for (i=0; i<max_size; i++) {
+        sp_tree_search(tree, &keys[rand() % max_size]);
+        sp_tree_search(even, &keys[rand() % max_size]);
+    }
+    if (is_sp_tree(tree) == NO || is_sp_tree(even) == NO) { return FAIL; }
+    shape_1 = sp_tree_shape(tree->root, 0);
+    shape_2 = sp_tree_shape(even->root, 0);
+
+    // Copy & set functions keep the shape of their arguments:
+
+    aux = sp_tree_copy(tree);
+    if (aux == NULL || is_sp_tree(aux) == NO)           { return FAIL; }
+    if (sp_tree_min(aux) != &keys[0])                   { return FAIL; }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = sp_tree_union(even, tree);
+    if (aux == NULL || is_sp_tree(aux) == NO)           { return FAIL; }
+    if (sp_tree_max(aux) != &keys[max_size-1])          { return FAIL; }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = sp_tree_intersection(tree, even);
+    if (aux == NULL || is_sp_tree(aux) == NO)           { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        if ((sp_tree_search(aux, &keys[i]) != NULL) != (i % 2 == 0)) {
+            return FAIL;
+        }
+    }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = sp_tree_diff(tree, even);
+    if (aux == NULL || is_sp_tree(aux) == NO)           { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        if ((sp_tree_search(aux, &keys[i]) != NULL) != (i % 2 == 1)) {
+            return FAIL;
+        }
+    }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = sp_tree_sym_diff(even, tree);
+    if (aux == NULL || is_sp_tree(aux) == NO)           { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        if ((sp_tree_search(aux, &keys[i]) != NULL) != (i % 2 == 1)) {
+            return FAIL;
+        }
+    }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    if (sp_tree_shape(tree->root, 0) != shape_1)        { return FAIL; }
+    if (sp_tree_shape(even->root, 0) != shape_2)        { return FAIL; }
+
+    sp_tree_remove_all(tree, NULL);
+    sp_tree_remove_all(even, NULL);
+    free(tree);
+    free(even);
+    free(keys);
+
+    return PASS;
+}
+
+// Bulk build from a sorted array:
+int sp_tree_sorted_test(int max_size) {
+
+    int i, j, n;
+    sp_tree *tree  = NULL;
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+
+    // Sorted array of different keys:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = 2*i;
+        data[i]     = &keys[i];
+    }
+
+    // Build trees of every size (and the biggest one):
+    for (n=0; n<=max_size; n += (n < 300) ? 1 : 97) {
+
+        // It is a pooled sp_tree with all the elements in order:
+        tree = sp_tree_from_sorted_array(MyComp, data, n);
+        if (tree == NULL)                       { return FAIL; }
+        if (tree->pool == NULL)                 { return FAIL; }
+        if (is_sp_tree(tree) == NO)             { return FAIL; }
+        if (sp_tree_is_empty(tree) != (n == 0)) { return FAIL; }
+        found = sp_tree_min(tree);
+        for (i=0; i<n; i++) {
+            if (found != &keys[i])              { return FAIL; }
+            found = sp_tree_next(tree, found);
+        }
+        if (found != NULL)                      { return FAIL; }
+
+        // All the nodes are in the same slab:
+        if (n > 0 && *((void **) tree->pool->slabs) != NULL) { return FAIL; }
+
+        // It can be modified as usual afterwards:
+        for (j=0; j<n; j += 3) {
+            if (sp_tree_remove(tree, &keys[j]) != &keys[j]) { return FAIL; }
+            if (is_sp_tree(tree) == NO)         { return FAIL; }
+        }
+        for (j=0; j<n; j += 3) {
+            if (sp_tree_insert(tree, &keys[j]) != NULL)     { return FAIL; }
+            if (is_sp_tree(tree) == NO)         { return FAIL; }
+        }
+        for (i=0; i<n; i++) {
+            if (sp_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+        }
+
+        sp_tree_remove_all(tree, NULL);
+        free(tree);
+    }
+
+    free(keys);
+    free(data);
+
+    return PASS;
+}
+
+// Checks that two subtrees have the same shape & data:
+int sp_same_subtree(const sp_node *node_1, const sp_node *node_2) {
+    if (node_1 == NULL || node_2 == NULL) { return node_1 == node_2; }
+    if (node_1 == node_2)                 { return NO; }
+    if (node_1->data != node_2->data)     { return NO; }
+    return sp_same_subtree(node_1->left,  node_2->left) &&
+           sp_same_subtree(node_1->right, node_2->right);
+}
+
+// Shape-preserving clones:
+int sp_tree_clone_test(int max_size) {
+
+    int i, n;
+    sp_tree *tree  = NULL;
+    sp_tree *clone = NULL;
+    sp_node *root  = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+
+    // Clone trees of many sizes (and the biggest one):
+    for (n=0; n<=max_size; n += (n < 300) ? 1 : 97) {
+
+        // A randomly built tree (with a degenerated left spine):
+        tree = new_sp_tree(MyComp);
+        for (i=0; i<n; i++) { sp_tree_insert(tree, &keys[rand() % n]); }
+        for (i=0; i<n; i++) { sp_tree_insert(tree, &keys[i]); }
+        for (i=0; i<n; i += 7) { sp_tree_search(tree, &keys[i]); }
+
+        // Its clone is a pooled sp_tree with the same shape:
+        root  = tree->root;
+        clone = sp_tree_clone(tree);
+        if (clone == NULL || clone->pool == NULL)           { return FAIL; }
+        if (tree->root != root)                             { return FAIL; }
+        if (is_sp_tree(clone) == NO)                        { return FAIL; }
+        if (sp_same_subtree(tree->root, clone->root) == NO) { return FAIL; }
+
+        // All the nodes are in the same slab:
+        if (clone->root != NULL &&
+            *((void **) clone->pool->slabs) != NULL)        { return FAIL; }
+
+        // They are independent trees:
+        for (i=0; i<n; i += 2) { sp_tree_remove(clone, &keys[i]); }
+        if (is_sp_tree(clone) == NO || is_sp_tree(tree) == NO) { return FAIL; }
+        for (i=0; i<n; i++) {
+            if (sp_tree_search(tree, &keys[i]) != &keys[i]) { return FAIL; }
+            if (sp_tree_search(clone, &keys[i]) != ((i % 2 == 0) ? NULL :
+                                                    &keys[i])) {
+                return FAIL;
+            }
+        }
+
+        sp_tree_remove_all(tree, NULL);
+        sp_tree_remove_all(clone, NULL);
+        free(tree);
+        free(clone);
+    }
+
+    free(keys);
+
+    return PASS;
+}
+
+// Batch insertions & searches:
+int sp_tree_batch_test(int max_size) {
+
+    int i, j, n;
+    sp_tree *tree  = new_sp_tree(MyComp);
+    sp_tree *ref   = new_sp_tree(MyComp);
+    MyData  *found = NULL;
+    MyData  *keys  = (MyData *) malloc(9*max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+    void   **out   = (void **)  malloc(max_size*sizeof(void *));
+    void   **old   = (void **)  malloc(max_size*sizeof(void *));
+
+    // They are sp_trees:
+    if (tree == NULL || ref == NULL) { return FAIL; }
+
+    // Empty batches do nothing:
+    sp_tree_insert_batch(tree, data, 0);
+    sp_tree_search_batch(tree, (const void **) data, out, 0);
+    if (sp_tree_is_empty(tree) == NO) { return FAIL; }
+
+    // Insert random, sorted & reversed batches (with repeated keys):
+    for (j=0; j<8; j++) {
+        n = (j == 0) ? 1 : max_size / (8 - j);
+        for (i=0; i<n; i++) {
+            keys[j*max_size + i].key = (j % 3 == 0) ? rand() % (2*max_size)
+                                     : (j % 3 == 1) ? 2*i : 2*(n - i);
+            data[i] = &keys[j*max_size + i];
+        }
+        data[n-1] = data[0];
+        for (i=0; i<n; i++) { old[i] = sp_tree_insert(ref, data[i]); }
+
+        // Returns the same values as inserting them one by one:
+        sp_tree_insert_batch(tree, data, n);
+        if (is_sp_tree(tree) == NO)             { return FAIL; }
+        for (i=0; i<n; i++) {
+            if (data[i] != old[i])              { return FAIL; }
+        }
+
+        // And the trees store the same pointers:
+        found = sp_tree_min(ref);
+        while (found != NULL) {
+            if (sp_tree_search(tree, found) != found) { return FAIL; }
+            found = sp_tree_next(ref, found);
+        }
+        found = sp_tree_min(tree);
+        while (found != NULL) {
+            if (sp_tree_search(ref, found) != found)  { return FAIL; }
+            found = sp_tree_next(tree, found);
+        }
+    }
+
+    // Search random keys (half of them are not in the tree):
+    for (i=0; i<max_size; i++) {
+        keys[8*max_size + i].key = rand() % (4*max_size);
+        data[i] = &keys[8*max_size + i];
+    }
+    sp_tree_search_batch(tree, (const void **) data, out, max_size);
+    for (i=0; i<max_size; i++) {
+        if (out[i] != sp_tree_search(ref, data[i])) { return FAIL; }
+    }
+    if (is_sp_tree(tree) == NO)                 { return FAIL; }
+
+    sp_tree_remove_all(tree, NULL);
+    sp_tree_remove_all(ref, NULL);
+    free(tree);
+    free(ref);
+    free(keys);
+    free(data);
+    free(out);
+    free(old);
+
+    return PASS;
+}
+
+// Interleaved searches:
+int sp_tree_interleaved_test(int max_size) {
+
+    int i, n;
+    sp_tree *tree  = new_sp_tree(MyComp);
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *query = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **data  = (void **)  malloc(max_size*sizeof(void *));
+    void   **out   = (void **)  malloc(max_size*sizeof(void *));
+
+    // It is a sp_tree:
+    if (tree == NULL) { return FAIL; }
+
+    // Random keys (only half of them will be in the tree):
+    for (i=0; i<max_size; i++) {
+        query[i].key = rand() % (2*max_size);
+        data[i]      = &query[i];
+    }
+
+    // Searching an empty tree:
+    sp_tree_search_interleaved(tree, (const void **) data, out, max_size);
+    for (i=0; i<max_size; i++) {
+        if (out[i] != NULL) { return FAIL; }
+    }
+
+    // Insert the even keys:
+    for (i=0; i<max_size; i++) { keys[i].key = 2*i; }
+    for (i=0; i<max_size; i++) {
+        sp_tree_insert(tree, &keys[(i * 7) % max_size]);
+    }
+
+    // Batches of every size give the same result as searching one by one:
+    for (n=0; n<=max_size; n += (n < 40) ? 1 : 97) {
+        for (i=0; i<n; i++) { out[i] = &keys[0]; }
+        sp_tree_search_interleaved(tree, (const void **) data, out, n);
+        for (i=0; i<n; i++) {
+            if (out[i] != sp_tree_search(tree, data[i])) { return FAIL; }
+        }
+    }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    sp_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+    free(query);
+    free(data);
+    free(out);
+
+    return PASS;
+}
+
+#ifdef TREE_STATS
+
+// Operation counters:
+int sp_tree_stats_test(int max_size) {
+
+    int i;
+    sp_tree    *tree  = new_sp_tree(MyComp);
+    MyData     *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    tree_stats  stats;
+
+    // A new tree has not done anything yet:
+    if (tree == NULL) { return FAIL; }
+    stats = sp_tree_get_stats(tree);
+    if (stats.comparisons != 0 || stats.allocations != 0 ||
+        stats.searches    != 0 || stats.max_depth   != 0) { return FAIL; }
+
+    // Insert the keys in increasing order (the first one needs no search):
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        sp_tree_insert(tree, &keys[i]);
+    }
+    stats = sp_tree_get_stats(tree);
+    if ((int) stats.allocations != max_size)       { return FAIL; }
+    if ((int) stats.searches    != max_size - 1)   { return FAIL; }
+    if (stats.comparisons < stats.depth)           { return FAIL; }
+    if (stats.max_depth == 0 || stats.releases != 0) { return FAIL; }
+    if (stats.recolorings != 0)                    { return FAIL; }
+
+    // A single search counts its depth:
+    sp_tree_reset_stats(tree);
+    sp_tree_search(tree, &keys[max_size / 3]);
+    stats = sp_tree_get_stats(tree);
+    if (stats.searches != 1 || stats.depth == 0)   { return FAIL; }
+    if (stats.depth != stats.max_depth)            { return FAIL; }
+    if (stats.allocations != 0)                    { return FAIL; }
+    if (stats.splay_steps == 0)                    { return FAIL; }
+
+    // Removing elements releases their nodes:
+    sp_tree_reset_stats(tree);
+    for (i=0; i<max_size; i += 2) { sp_tree_remove(tree, &keys[i]); }
+    stats = sp_tree_get_stats(tree);
+    if ((int) stats.releases != (max_size + 1) / 2) { return FAIL; }
+    if ((int) stats.searches != (max_size + 1) / 2) { return FAIL; }
+    if (is_sp_tree(tree) == NO)                    { return FAIL; }
+
+    sp_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+
+    return PASS;
+}
+
+#endif
+
+#ifdef TREE_KEY_PREFIX
+
+// Key prefixes:
+int sp_tree_prefix_test(int max_size) {
+
+    int i, j;
+    size_t   with_prefix, without_prefix;
+    sp_tree *tree  = new_sp_tree(CountComp);
+    sp_tree *plain = new_sp_tree(CountComp);
+    sp_tree *aux   = NULL;
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *data  = NULL;
+    MyData   key;
+
+    // Only one of them uses prefixes:
+    if (tree == NULL || plain == NULL) { return FAIL; }
+    sp_tree_set_prefix(tree, MyPrefix);
+
+    // Shuffle the keys (most of them share their prefix with 3 more keys):
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=max_size-1; i>0; i--) {
+        j       = rand() % (i + 1);
+        key     = keys[i];
+        keys[i] = keys[j];
+        keys[j] = key;
+    }
+
+    // Insert them in both trees:
+    for (i=0; i<max_size; i++) {
+        if (sp_tree_insert(tree,  &keys[i]) != NULL) { return FAIL; }
+        if (sp_tree_insert(plain, &keys[i]) != NULL) { return FAIL; }
+    }
+    if (is_sp_tree(tree) == NO)  { return FAIL; }
+    if (is_sp_tree(plain) == NO) { return FAIL; }
+
+    // Search them in both trees counting the calls to the comparing function:
+    count_comparisons = 0;
+    for (i=0; i<max_size; i++) {
+        data = sp_tree_search(tree, &keys[i]);
+        if (data == NULL || data->key != keys[i].key) { return FAIL; }
+    }
+    with_prefix = count_comparisons;
+    count_comparisons = 0;
+    for (i=0; i<max_size; i++) {
+        data = sp_tree_search(plain, &keys[i]);
+        if (data == NULL || data->key != keys[i].key) { return FAIL; }
+    }
+    without_prefix = count_comparisons;
+
+    // The prefixes avoid most of them:
+    if (with_prefix >= without_prefix) { return FAIL; }
+
+    // Remove the odd keys:
+    for (i=0; i<max_size; i++) {
+        if (keys[i].key % 2 == 0) { continue; }
+        key.key = keys[i].key;
+        if (sp_tree_remove(tree, &key) != &keys[i]) { return FAIL; }
+        if (sp_tree_remove(tree, &key) != NULL)     { return FAIL; }
+    }
+    if (is_sp_tree(tree) == NO) { return FAIL; }
+
+    // Only the even keys are still there:
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        data = sp_tree_search(tree, &key);
+        if (i % 2 == 1 && data != NULL)                    { return FAIL; }
+        if (i % 2 == 0 && (data == NULL || data->key != i)) { return FAIL; }
+    }
+
+    // Copies & set functions keep the prefixes (even from plain trees):
+    aux = sp_tree_copy(tree);
+    if (aux == NULL || aux->prefix != MyPrefix) { return FAIL; }
+    if (is_sp_tree(aux) == NO)                  { return FAIL; }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    aux = sp_tree_union(tree, plain);
+    if (aux == NULL || aux->prefix != MyPrefix) { return FAIL; }
+    if (is_sp_tree(aux) == NO)                  { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        data = sp_tree_search(aux, &key);
+        if (data == NULL || data->key != i)     { return FAIL; }
+    }
+    sp_tree_remove_all(aux, NULL);
+    free(aux);
+
+    sp_tree_remove_all(tree, NULL);
+    sp_tree_remove_all(plain, NULL);
+    free(tree);
+    free(plain);
+    free(keys);
+
+    return PASS;
+}
+
+#endif
+
+// Priority queue usage (insertions & removals at both ends):
+int sp_tree_min_max_test(int max_size) {
+
+    int i, j, lo, hi;
+    sp_tree *tree  = new_sp_tree(MyComp);
+    sp_tree *copy  = NULL;
+    sp_tree *ends  = new_sp_tree(MyComp);
+    sp_tree *other = NULL;
+    MyData  *min   = NULL;
+    MyData  *max   = NULL;
+    MyData  *keys  = (MyData *) malloc(3*max_size*sizeof(MyData));
+
+    // Keys from -max_size to 2*max_size - 1:
+    for (i=0; i<3*max_size; i++) { keys[i].key = i - max_size; }
+
+    // An empty tree has no extremes:
+    if (tree == NULL || ends == NULL)                { return FAIL; }
+    if (sp_tree_min(tree) != NULL)                   { return FAIL; }
+    if (sp_tree_max(tree) != NULL)                   { return FAIL; }
+
+    // Random insertions in the middle third:
+    lo = 3*max_size;
+    hi = -1;
+    for (i=0; i<max_size; i++) {
+        j = max_size + rand() % max_size;
+        sp_tree_insert(tree, &keys[j]);
+        if (j < lo) { lo = j; }
+        if (j > hi) { hi = j; }
+        if (sp_tree_min(tree) != &keys[lo])          { return FAIL; }
+        if (sp_tree_max(tree) != &keys[hi])          { return FAIL; }
+    }
+    if (is_sp_tree(tree) == NO)                      { return FAIL; }
+
+    // Grow it at both ends:
+    for (i=0; i<max_size; i++) {
+        if (i % 2 == 0) { sp_tree_insert_min(tree, &keys[--lo]); }
+        else            { sp_tree_insert_max(tree, &keys[++hi]); }
+        if (sp_tree_min(tree) != &keys[lo])          { return FAIL; }
+        if (sp_tree_max(tree) != &keys[hi])          { return FAIL; }
+    }
+    if (is_sp_tree(tree) == NO)                      { return FAIL; }
+
+    // Copies & set operations keep their own extremes:
+    copy = sp_tree_copy(tree);
+    if (copy == NULL || is_sp_tree(copy) == NO)      { return FAIL; }
+    if (sp_tree_min(copy) != &keys[lo])              { return FAIL; }
+    if (sp_tree_max(copy) != &keys[hi])              { return FAIL; }
+    sp_tree_insert(ends, &keys[0]);
+    sp_tree_insert(ends, &keys[3*max_size - 1]);
+    other = sp_tree_union(copy, ends);
+    if (other == NULL || is_sp_tree(other) == NO)    { return FAIL; }
+    if (sp_tree_min(other) != &keys[0])              { return FAIL; }
+    if (sp_tree_max(other) != &keys[3*max_size - 1]) { return FAIL; }
+    sp_tree_remove_all(other, NULL);
+    free(other);
+    other = sp_tree_diff(copy, ends);
+    if (other == NULL || is_sp_tree(other) == NO)    { return FAIL; }
+    if (sp_tree_min(other) != sp_tree_min(copy))     { return FAIL; }
+    if (sp_tree_max(other) != sp_tree_max(copy))     { return FAIL; }
+    sp_tree_remove_all(other, NULL);
+    free(other);
+
+    // Remove everything from both ends (and through regular removals):
+    for (i=0; sp_tree_is_empty(tree) == NO; i++) {
+        min = sp_tree_min(tree);
+        max = sp_tree_max(tree);
+        switch (rand() % 4) {
+            case 0:  if (sp_tree_remove_min(tree) != min)     { return FAIL; }
+                     break;
+            case 1:  if (sp_tree_remove_max(tree) != max)     { return FAIL; }
+                     break;
+            case 2:  if (sp_tree_remove(tree, min) != min)    { return FAIL; }
+                     break;
+            default: if (sp_tree_remove(tree, max) != max)    { return FAIL; }
+                     break;
+        }
+        if (i % 17 == 0 && is_sp_tree(tree) == NO)   { return FAIL; }
+        if (sp_tree_is_empty(tree) == NO) {
+            if (((MyData *) sp_tree_min(tree))->key < min->key) { return FAIL; }
+            if (((MyData *) sp_tree_max(tree))->key > max->key) { return FAIL; }
+        }
+    }
+    if (sp_tree_min(tree) != NULL)                   { return FAIL; }
+    if (sp_tree_max(tree) != NULL)                   { return FAIL; }
+    if (is_sp_tree(tree) == NO)                      { return FAIL; }
+
+    // The tree is still usable after being emptied:
+    sp_tree_insert(tree, &keys[max_size]);
+    if (sp_tree_min(tree) != &keys[max_size])        { return FAIL; }
+    if (sp_tree_max(tree) != &keys[max_size])        { return FAIL; }
+    sp_tree_remove_all(copy, NULL);
+    if (is_sp_tree(copy) == NO)                      { return FAIL; }
+    if (sp_tree_min(copy) != NULL)                   { return FAIL; }
+
+    sp_tree_remove_all(tree, NULL);
+    sp_tree_remove_all(ends, NULL);
+    free(tree);
+    free(copy);
+    free(ends);
+    free(keys);
+
+    return PASS;
+}
+
+#ifdef SP_SPLAY_POLICY
+
+// Splaying policies:
+int sp_tree_policy_test(int max_size) {
+
+    int i, j, p;
+    sp_tree *tree = new_sp_tree(MyComp);
+    sp_node *root = NULL;
+    MyData  *keys = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *data = NULL;
+    int      policies[8] = { SP_SPLAY_ALWAYS, SP_SPLAY_RANDOM, SP_SPLAY_RANDOM,
+                             SP_SPLAY_RANDOM, SP_SPLAY_DEPTH,  SP_SPLAY_DEPTH,
+                             SP_SPLAY_EVERY,  SP_SPLAY_EVERY };
+    double   params[8]   = { 0.0, 0.0, 0.25, 1.0, 3.0, 1e30, 1.0, 7.0 };
+
+    // Insert the even keys (in random order):
+    if (tree == NULL) { return FAIL; }
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=0; i<max_size; i++) {
+        j = 2*(rand() % ((max_size + 1) / 2));
+        sp_tree_insert(tree, &keys[j]);
+    }
+    for (i=0; i<max_size; i += 2) { sp_tree_insert(tree, &keys[i]); }
+
+    // Every policy gives the same answers:
+    for (p=0; p<8; p++) {
+        sp_tree_set_splay_policy(tree, policies[p], params[p]);
+        for (i=0; i<max_size; i++) {
+            j = rand() % max_size;
+            data = sp_tree_search(tree, &keys[j]);
+            if (data != ((j % 2 == 0) ? &keys[j] : NULL))   { return FAIL; }
+            data = sp_tree_prev(tree, &keys[j]);
+            j    = (j % 2 == 0) ? j - 2 : j - 1;
+            if (data != ((j >= 0) ? &keys[j] : NULL))       { return FAIL; }
+            j    = rand() % max_size;
+            data = sp_tree_next(tree, &keys[j]);
+            j    = (j % 2 == 0) ? j + 2 : j + 1;
+            if (data != ((j < max_size) ? &keys[j] : NULL)) { return FAIL; }
+            if (i % 16 == 0) {
+                if (sp_tree_min(tree) != &keys[0])          { return FAIL; }
+                if (sp_tree_max(tree) != &keys[(max_size - 1) & ~1]) {
+                    return FAIL;
+                }
+            }
+        }
+        if (is_sp_tree(tree) == NO)                         { return FAIL; }
+    }
+
+    // Lookups that never splay do not touch the tree:
+    for (p=0; p<2; p++) {
+        if (p == 0) { sp_tree_set_splay_policy(tree, SP_SPLAY_RANDOM, 0.0); }
+        else        { sp_tree_set_splay_policy(tree, SP_SPLAY_DEPTH, 1e30); }
+        root = tree->root;
+        for (i=0; i<max_size; i++) {
+            j = rand() % max_size;
+            sp_tree_search(tree, &keys[j]);
+            sp_tree_prev(tree, &keys[j]);
+            sp_tree_next(tree, &keys[j]);
+            if (tree->root != root)                         { return FAIL; }
+        }
+        if (sp_tree_min(tree) != &keys[0] || tree->root != root) {
+            return FAIL;
+        }
+    }
+
+    // Lookups deeper than the threshold always splay:
+    sp_tree_set_splay_policy(tree, SP_SPLAY_DEPTH, 0.0);
+    for (i=0; i<max_size; i += 2) {
+        if (sp_tree_search(tree, &keys[i]) != &keys[i])     { return FAIL; }
+        if (tree->root->data != &keys[i])                   { return FAIL; }
+    }
+
+    // Only one out of every 5 lookups splays:
+    sp_tree_set_splay_policy(tree, SP_SPLAY_EVERY, 5.0);
+    for (i=1; i<=100 && max_size > 2; i++) {
+        root = tree->root;
+        data = (i % 2 == 0) ? sp_tree_min(tree) : sp_tree_max(tree);
+        if (i % 5 == 0 && tree->root->data != data)         { return FAIL; }
+        if (i % 5 != 0 && tree->root != root)               { return FAIL; }
+    }
+
+    // Back to the default policy:
+    sp_tree_set_splay_policy(tree, SP_SPLAY_ALWAYS, 0.0);
+    if (sp_tree_max(tree) != tree->root->data)              { return FAIL; }
+    if (is_sp_tree(tree) == NO)                             { return FAIL; }
+
+    sp_tree_remove_all(tree, NULL);
+    free(tree);
+    free(keys);
+
+    return PASS;
+}
+
+#endif
+
+
+
+
+
+
+
+// Random insertions & deletions with integer keys:
+int rb_tree_u64_random_test(int max_size) {
+
+    int          i;
+    uint64_t     key;
+    uint64_t     prev_key;
+    rb_tree_u64 *tree  = new_rb_tree_u64();
+    MyData      *data  = NULL;
+    MyData      *found = NULL;
+
+    // It is an empty rb_tree_u64:
+    if (tree == NULL)                      { return FAIL; }
+    if (is_rb_tree_u64(tree) == NO)        { return FAIL; }
+    if (rb_tree_u64_is_empty(tree) == NO)  { return FAIL; }
+    if (rb_tree_u64_min(tree, &key) != NULL) { return FAIL; }
+
+    // Insert elements randomly in the tree:
+    for (i=0; i<max_size*10; i++) {
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = rand() % max_size;
+        found = rb_tree_u64_insert(tree, (uint64_t) data->key, data);
+        if (found != NULL) {
+            if (found->key != data->key) { return FAIL; }
+            free(found);
+        }
+        if (is_rb_tree_u64(tree) == NO)       { return FAIL; }
+        if (rb_tree_u64_is_empty(tree) == YES) { return FAIL; }
+    }
+
+    // Every key finds its own data:
+    for (i=0; i<max_size; i++) {
+        found = rb_tree_u64_search(tree, (uint64_t) i);
+        if (found != NULL && found->key != i) { return FAIL; }
+    }
+    if (rb_tree_u64_search(tree, (uint64_t) max_size) != NULL) { return FAIL; }
+
+    // Check if everything is correctly sorted forward...
+    found = rb_tree_u64_min(tree, &key);
+    if (found == NULL || (uint64_t) found->key != key) { return FAIL; }
+    while (found != NULL) {
+        prev_key = key;
+        found = rb_tree_u64_next(tree, prev_key, &key);
+        if (found == NULL) { break; }
+        if ((uint64_t) found->key != key || key <= prev_key) { return FAIL; }
+    }
+    rb_tree_u64_max(tree, &key);
+    if (key != prev_key) { return FAIL; }
+
+    // ...and backwards.
+    found = rb_tree_u64_max(tree, &key);
+    while (found != NULL) {
+        prev_key = key;
+        found = rb_tree_u64_prev(tree, prev_key, &key);
+        if (found == NULL) { break; }
+        if ((uint64_t) found->key != key || key >= prev_key) { return FAIL; }
+    }
+    rb_tree_u64_min(tree, &key);
+    if (key != prev_key) { return FAIL; }
+
+    // Remove elements randomly from the tree:
+    for (i=0; i<max_size*5; i++) {
+        key   = (uint64_t) (rand() % max_size);
+        found = rb_tree_u64_remove(tree, key);
+        if (found != NULL) {
+            if ((uint64_t) found->key != key) { return FAIL; }
+            free(found);
+        }
+        if (rb_tree_u64_search(tree, key) != NULL) { return FAIL; }
+        if (is_rb_tree_u64(tree) == NO)            { return FAIL; }
+    }
+
+    // Remove the extremes until the tree is empty:
+    prev_key = 0;
+    for (i=0; rb_tree_u64_is_empty(tree) == NO; i++) {
+        if (i % 2 == 0) {
+            found = rb_tree_u64_remove_min(tree, &key);
+            if (found == NULL || (uint64_t) found->key != key) { return FAIL; }
+            if (key < prev_key) { return FAIL; }
+            prev_key = key;
+        } else {
+            found = rb_tree_u64_remove_max(tree, &key);
+            if (found == NULL || (uint64_t) found->key != key) { return FAIL; }
+        }
+        free(found);
+        if (is_rb_tree_u64(tree) == NO) { return FAIL; }
+    }
+    if (rb_tree_u64_remove_min(tree, &key) != NULL) { return FAIL; }
+
+    // Grow it at both ends (starting from the middle):
+    data = (MyData *) malloc(2*max_size*sizeof(MyData));
+    for (i=0; i<2*max_size; i++) { data[i].key = i; }
+    for (i=0; i<max_size; i++) {
+        key = (uint64_t) (max_size + i);
+        if (rb_tree_u64_insert_max(tree, key, &data[key]) != NULL) {
+            return FAIL;
+        }
+        key = (uint64_t) (max_size - 1 - i);
+        if (rb_tree_u64_insert_min(tree, key, &data[key]) != NULL) {
+            return FAIL;
+        }
+        if (rb_tree_u64_min(tree, &key) != &data[max_size-1-i]) { return FAIL; }
+        if (rb_tree_u64_max(tree, &key) != &data[max_size+i])   { return FAIL; }
+    }
+    if (is_rb_tree_u64(tree) == NO)                 { return FAIL; }
+
+    // Inserting the extremes again replaces their data:
+    found = &data[0];
+    if (rb_tree_u64_insert_min(tree, 0, found) != found) { return FAIL; }
+    found = &data[2*max_size-1];
+    key   = (uint64_t) (2*max_size-1);
+    if (rb_tree_u64_insert_max(tree, key, found) != found) { return FAIL; }
+    for (i=0; i<2*max_size; i++) {
+        if (rb_tree_u64_search(tree, (uint64_t) i) != &data[i]) { return FAIL; }
+    }
+    rb_tree_u64_remove_all(tree, NULL);
+
+    free(tree);
+    free(data);
+
+    return PASS;
+}
+
+// Set functions & copies with integer keys:
+int rb_tree_u64_set_test(int max_size) {
+
+    int          i;
+    rb_tree_u64 *tree_1 = new_rb_tree_u64();
+    rb_tree_u64 *tree_2 = new_rb_tree_u64_with_pool(0);
+    rb_tree_u64 *tree   = NULL;
+    MyData      *keys   = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData      *found  = NULL;
+
+    // tree_1 holds the multiples of 2 and tree_2 the multiples of 3:
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (i=0; i<max_size; i++) {
+        if (i % 2 == 0) { rb_tree_u64_insert(tree_1, (uint64_t) i, &keys[i]); }
+        if (i % 3 == 0) { rb_tree_u64_insert(tree_2, (uint64_t) i, &keys[i]); }
+    }
+
+    // Copy:
+    tree = rb_tree_u64_copy(tree_2);
+    if (tree == NULL || tree->pool == NULL) { return FAIL; }
+    if (is_rb_tree_u64(tree) == NO)         { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = rb_tree_u64_search(tree, (uint64_t) i);
+        if ((i % 3 == 0) != (found == &keys[i])) { return FAIL; }
+    }
+    rb_tree_u64_remove_all(tree, NULL);
+    free(tree);
+
+    // Union:
+    tree = rb_tree_u64_union(tree_1, tree_2);
+    if (is_rb_tree_u64(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = rb_tree_u64_search(tree, (uint64_t) i);
+        if ((i % 2 == 0 || i % 3 == 0) != (found == &keys[i])) { return FAIL; }
+    }
+    rb_tree_u64_remove_all(tree, NULL);
+    free(tree);
+
+    // Intersection:
+    tree = rb_tree_u64_intersection(tree_1, tree_2);
+    if (is_rb_tree_u64(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = rb_tree_u64_search(tree, (uint64_t) i);
+        if ((i % 2 == 0 && i % 3 == 0) != (found == &keys[i])) { return FAIL; }
+    }
+    rb_tree_u64_remove_all(tree, NULL);
+    free(tree);
+
+    // Difference:
+    tree = rb_tree_u64_diff(tree_1, tree_2);
+    if (is_rb_tree_u64(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = rb_tree_u64_search(tree, (uint64_t) i);
+        if ((i % 2 == 0 && i % 3 != 0) != (found == &keys[i])) { return FAIL; }
+    }
+    rb_tree_u64_remove_all(tree, NULL);
+    free(tree);
+
+    // Symmetric difference:
+    tree = rb_tree_u64_sym_diff(tree_1, tree_2);
+    if (is_rb_tree_u64(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = rb_tree_u64_search(tree, (uint64_t) i);
+        if (((i % 2 == 0) != (i % 3 == 0)) != (found == &keys[i])) {
+            return FAIL;
+        }
+    }
+    rb_tree_u64_remove_all(tree, NULL);
+    free(tree);
+
+    rb_tree_u64_remove_all(tree_1, NULL);
+    rb_tree_u64_remove_all(tree_2, NULL);
+    free(tree_1);
+    free(tree_2);
+    free(keys);
+
+    return PASS;
+}
+
+// Signed integer keys:
+int rb_tree_i64_test(int max_size) {
+
+    int          i;
+    int64_t      key;
+    int64_t      prev_key;
+    rb_tree_i64 *tree = new_rb_tree_i64();
+    MyData      *keys = (MyData *) malloc((2*max_size+2)*sizeof(MyData));
+    MyData      *found;
+
+    // Insert the keys [-max_size, max_size) in random order plus both limits:
+    for (i=0; i<2*max_size; i++) { keys[i].key = i - max_size; }
+    for (i=0; i<2*max_size; i++) {
+        key = rand() % (2*max_size);
+        rb_tree_i64_insert(tree, (int64_t) keys[key].key, &keys[key]);
+    }
+    for (i=0; i<2*max_size; i++) {
+        rb_tree_i64_insert(tree, (int64_t) keys[i].key, &keys[i]);
+    }
+    rb_tree_i64_insert(tree, INT64_MIN, &keys[2*max_size]);
+    rb_tree_i64_insert(tree, INT64_MAX, &keys[2*max_size+1]);
+    if (is_rb_tree_i64(tree) == NO) { return FAIL; }
+
+    // Negative keys come before positive ones:
+    if (rb_tree_i64_min(tree, &key) != &keys[2*max_size])   { return FAIL; }
+    if (key != INT64_MIN)                                   { return FAIL; }
+    if (rb_tree_i64_max(tree, &key) != &keys[2*max_size+1]) { return FAIL; }
+    if (key != INT64_MAX)                                   { return FAIL; }
+    found = rb_tree_i64_next(tree, INT64_MIN, &key);
+    for (i=0; i<2*max_size; i++) {
+        if (found != &keys[i] || key != keys[i].key) { return FAIL; }
+        found = rb_tree_i64_next(tree, key, &key);
+    }
+    if (found != &keys[2*max_size+1]) { return FAIL; }
+    if (rb_tree_i64_prev(tree, 0, &key) != &keys[max_size-1]) { return FAIL; }
+    if (key != -1)                                          { return FAIL; }
+
+    // Search & remove:
+    for (i=0; i<2*max_size; i++) {
+        key = keys[i].key;
+        if (rb_tree_i64_search(tree, key) != &keys[i]) { return FAIL; }
+        if (i % 2 == 0) {
+            if (rb_tree_i64_remove(tree, key) != &keys[i]) { return FAIL; }
+            if (rb_tree_i64_search(tree, key) != NULL)     { return FAIL; }
+        }
+    }
+    if (is_rb_tree_i64(tree) == NO) { return FAIL; }
+
+    // Pop the rest in increasing order:
+    rb_tree_i64_remove_min(tree, &prev_key);
+    if (prev_key != INT64_MIN) { return FAIL; }
+    while (rb_tree_i64_remove_min(tree, &key) != NULL) {
+        if (key <= prev_key) { return FAIL; }
+        prev_key = key;
+    }
+    if (prev_key != INT64_MAX)         { return FAIL; }
+    if (rb_tree_i64_is_empty(tree) == NO) { return FAIL; }
+
+    // Grow it at both ends of zero (and up to both limits):
+    for (i=0; i<max_size; i++) {
+        key = keys[max_size+i].key;
+        if (rb_tree_i64_insert_max(tree, key, &keys[max_size+i]) != NULL) {
+            return FAIL;
+        }
+        key = keys[max_size-1-i].key;
+        if (rb_tree_i64_insert_min(tree, key, &keys[max_size-1-i]) != NULL) {
+            return FAIL;
+        }
+    }
+    rb_tree_i64_insert_min(tree, INT64_MIN, &keys[2*max_size]);
+    rb_tree_i64_insert_max(tree, INT64_MAX, &keys[2*max_size+1]);
+    if (is_rb_tree_i64(tree) == NO) { return FAIL; }
+    if (rb_tree_i64_min(tree, &key) != &keys[2*max_size])   { return FAIL; }
+    if (key != INT64_MIN)                                   { return FAIL; }
+    found = rb_tree_i64_next(tree, INT64_MIN, &key);
+    for (i=0; i<2*max_size; i++) {
+        if (found != &keys[i] || key != keys[i].key) { return FAIL; }
+        found = rb_tree_i64_next(tree, key, &key);
+    }
+    if (found != &keys[2*max_size+1] || key != INT64_MAX)   { return FAIL; }
+    rb_tree_i64_remove_all(tree, NULL);
+
+    free(tree);
+    free(keys);
+
+    return PASS;
+}
+
+// Eytzinger indexes:
+int rb_tree_u64_eytzinger_test(int max_size) {
+
+    int            i, n;
+    rb_tree_u64   *tree     = new_rb_tree_u64();
+    rb_tree_i64   *tree_i64 = new_rb_tree_i64();
+    eytzinger_u64 *index    = NULL;
+    MyData        *keys     = (MyData *) malloc(max_size*sizeof(MyData));
+    uint64_t      *queries  = (uint64_t *) malloc(2*max_size*sizeof(uint64_t));
+    int64_t       *queries_i64;
+    void         **out      = (void **) malloc(2*max_size*sizeof(void *));
+
+    // An empty tree gives an empty index:
+    index = rb_tree_u64_to_eytzinger(tree);
+    if (index == NULL || index->size != 0)            { return FAIL; }
+    if (is_eytzinger_u64(index) == NO)                { return FAIL; }
+    if (eytzinger_u64_search(index, 0) != NULL)       { return FAIL; }
+    queries[0] = 0;
+    out[0]     = &keys[0];
+    eytzinger_u64_search_batch(index, queries, out, 1);
+    if (out[0] != NULL)                               { return FAIL; }
+    free(index);
+
+    // Indexes of every size up to max_size (of the even keys), so that both
+    // complete and incomplete last levels get tested:
+    for (i=0; i<max_size; i++) { keys[i].key = i; }
+    for (n=1; n<=max_size; n = (n < 64) ? n + 1 : 2*n + 1) {
+        rb_tree_u64_remove_all(tree, NULL);
+        for (i=0; i<n; i++) {
+            rb_tree_u64_insert(tree, (uint64_t) (2*i), &keys[i]);
+        }
+        index = rb_tree_u64_to_eytzinger(tree);
+        if (index == NULL || index->size != (size_t) n) { return FAIL; }
+        if (is_eytzinger_u64(index) == NO)              { return FAIL; }
+
+        // The index returns the same data as the tree (and nothing between):
+        for (i=0; i<2*n+1; i++) {
+            if (eytzinger_u64_search(index, (uint64_t) i) !=
+                rb_tree_u64_search(tree, (uint64_t) i)) { return FAIL; }
+        }
+        if (eytzinger_u64_search(index, UINT64_MAX) != NULL) { return FAIL; }
+
+        // The same in batches (in random order):
+        for (i=0; i<2*n && i<2*max_size; i++) {
+            queries[i] = (uint64_t) (rand() % (2*n+1));
+        }
+        eytzinger_u64_search_batch(index, queries, out, (size_t) i);
+        while (i-- > 0) {
+            if (out[i] != rb_tree_u64_search(tree, queries[i])) { return FAIL; }
+        }
+        free(index);
+    }
+
+    // Signed keys (around 0 and both limits):
+    for (i=0; i<max_size; i++) {
+        rb_tree_i64_insert(tree_i64, (int64_t) (i - max_size/2), &keys[i]);
+    }
+    rb_tree_i64_insert(tree_i64, INT64_MIN, &keys[0]);
+    rb_tree_i64_insert(tree_i64, INT64_MAX, &keys[1]);
+    index = rb_tree_i64_to_eytzinger(tree_i64);
+    if (index == NULL || is_eytzinger_u64(index) == NO) { return FAIL; }
+    if (eytzinger_i64_search(index, INT64_MIN) != &keys[0]) { return FAIL; }
+    if (eytzinger_i64_search(index, INT64_MAX) != &keys[1]) { return FAIL; }
+    queries_i64 = (int64_t *) queries;
+    for (i=0; i<2*max_size; i++) {
+        queries_i64[i] = (int64_t) (i - max_size);
+    }
+    eytzinger_i64_search_batch(index, queries_i64, out, 2*max_size);
+    for (i=0; i<2*max_size; i++) {
+        if (out[i] != rb_tree_i64_search(tree_i64, queries_i64[i]) ||
+            out[i] != eytzinger_i64_search(index, queries_i64[i])) {
+            return FAIL;
+        }
+    }
+    free(index);
+
+    rb_tree_u64_remove_all(tree, NULL);
+    rb_tree_i64_remove_all(tree_i64, NULL);
+    free(tree);
+    free(tree_i64);
+    free(queries);
+    free(out);
+    free(keys);
 
-    // AUX == DIFFERENCE(empty, all) == EMPTY
-    aux = sp_tree_diff(empty, all);
+    return PASS;
+}
 
-    // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)       { return FAIL; }
 
-    // It is empty:
-    if (sp_tree_is_empty(aux) == NO) { return FAIL; }
 
-    // TEST SYMMETRIC DIFFERENCE: //////////////////////////////////////////////
 
-    // AUX == SYMMETRIC_DIFFERENCE(all, odd) == EVEN
-    aux = sp_tree_sym_diff(all, odd);
 
-    // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
 
-    // Check if all data in "aux" is also in "even"...
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_search(even, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(aux);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
-    }
-    
-    // ...and all data in "even" is also in "aux".
-    found = sp_tree_min(even);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(even, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(even);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+
+// Sequential insertions & removals (at both ends):
+int bp_tree_sequential_test(int max_size) {
+
+    int i;
+    bp_tree *tree  = new_bp_tree(MyComp);
+    MyData  *keys  = (MyData *) malloc(max_size*sizeof(MyData));
+    MyData  *found = NULL;
+    MyData   key;
+
+    // It is an empty bp_tree:
+    if (is_bp_tree(tree) == NO)        { return FAIL; }
+    if (bp_tree_is_empty(tree) == NO)  { return FAIL; }
+    if (bp_tree_min(tree) != NULL)     { return FAIL; }
+    if (bp_tree_remove_max(tree) != NULL) { return FAIL; }
+
+    // Insert elements sequentially in the tree:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        if (bp_tree_insert(tree, &keys[i]) != NULL) { return FAIL; }
+        if (is_bp_tree(tree) == NO)                 { return FAIL; }
+        if (tree->size != (size_t) i+1)             { return FAIL; }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Insert them again (they get replaced):
+    for (i=max_size-1; i>=0; i--) {
+        key.key = i;
+        if (bp_tree_insert(tree, &keys[i]) != &keys[i]) { return FAIL; }
+    }
+    if (tree->size != (size_t) max_size) { return FAIL; }
 
-    // AUX == SYMMETRIC_DIFFERENCE(odd, high)
-    aux = sp_tree_sym_diff(odd, high);
+    // Check if all elements are there (and nothing else):
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        if (bp_tree_search(tree, &key) != &keys[i]) { return FAIL; }
+    }
+    key.key = -1;
+    if (bp_tree_search(tree, &key) != NULL)         { return FAIL; }
+    if (bp_tree_next(tree, &key) != &keys[0])       { return FAIL; }
+    key.key = max_size;
+    if (bp_tree_search(tree, &key) != NULL)         { return FAIL; }
+    if (bp_tree_prev(tree, &key) != &keys[max_size-1]) { return FAIL; }
 
-    // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+    // Check if everything is correctly sorted forward...
+    found = bp_tree_min(tree);
+    for (i=0; i<max_size; i++) {
+        if (found != &keys[i]) { return FAIL; }
+        found = bp_tree_next(tree, found);
+    }
+    if (found != NULL) { return FAIL; }
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    // ...and backwards.
+    found = bp_tree_max(tree);
+    for (i=max_size-1; i>=0; i--) {
+        if (found != &keys[i]) { return FAIL; }
+        found = bp_tree_prev(tree, found);
+    }
+    if (found != NULL) { return FAIL; }
+
+    // Remove them from both ends:
+    for (i=0; i<max_size/2; i++) {
+        if (bp_tree_remove_min(tree) != &keys[i])            { return FAIL; }
+        if (bp_tree_remove_max(tree) != &keys[max_size-1-i]) { return FAIL; }
+        if (is_bp_tree(tree) == NO)                         { return FAIL; }
+    }
+    bp_tree_remove_all(tree, NULL);
+    if (is_bp_tree(tree) == NO)       { return FAIL; }
+    if (bp_tree_is_empty(tree) == NO) { return FAIL; }
+
+    // Insert them at both ends:
+    for (i=max_size/2; i<max_size; i++) {
+        if (bp_tree_insert_max(tree, &keys[i]) != NULL)  { return FAIL; }
+        if (bp_tree_insert_max(tree, &keys[i]) != &keys[i]) { return FAIL; }
+        if (is_bp_tree(tree) == NO)                      { return FAIL; }
+    }
+    for (i=max_size/2-1; i>=0; i--) {
+        if (bp_tree_insert_min(tree, &keys[i]) != NULL)  { return FAIL; }
+        if (bp_tree_insert_min(tree, &keys[i]) != &keys[i]) { return FAIL; }
+        if (is_bp_tree(tree) == NO)                      { return FAIL; }
+    }
+    found = bp_tree_min(tree);
+    for (i=0; i<max_size; i++) {
+        if (found != &keys[i]) { return FAIL; }
+        found = bp_tree_next(tree, found);
+    }
 
-    // Check if all data in "aux" is also in "odd" or "high" but not in both.
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_search(odd, data);
-        if (found == NULL) {
-            found = sp_tree_search(high, data);
-            if (found == NULL) { return FAIL; }
-        } else {
-            found = sp_tree_search(high, data);
-            if (found != NULL) { return FAIL; }
-        }
-        found = sp_tree_next(aux, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(aux);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+    // Remove them in order:
+    for (i=0; i<max_size; i++) {
+        key.key = i;
+        if (bp_tree_remove(tree, &key) != &keys[i]) { return FAIL; }
+        if (bp_tree_remove(tree, &key) != NULL)     { return FAIL; }
+        if (is_bp_tree(tree) == NO)                 { return FAIL; }
     }
+    if (bp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    free(tree);
+    free(keys);
 
-    // AUX == SYMMETRIC_DIFFERENCE(all, empty) == ALL
-    aux = sp_tree_sym_diff(all, empty);
+    return PASS;
+}
 
-    // It is a sp_tree:
-    if (is_sp_tree(aux) == NO)        { return FAIL; }
+// Random insertions & removals:
+int bp_tree_random_test(int max_size) {
 
-    // It is empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    int i;
+    bp_tree *tree  = new_bp_tree(MyComp);
+    MyData  *data  = NULL;
+    MyData  *found = NULL;
+    MyData   key;
 
-    // Check if all data in "aux" is also in "all"...
-    found = sp_tree_min(aux);
+    // Insert elements randomly in the tree:
+    for (i=0; i<max_size*10; i++) {
+        data = (MyData *) malloc(sizeof(MyData));
+        data->key = rand() % max_size;
+        found = bp_tree_insert(tree, data);
+        if (found != NULL) { free(found); }
+        if (is_bp_tree(tree) == NO)        { return FAIL; }
+        if (bp_tree_is_empty(tree) == YES) { return FAIL; }
+    }
+
+    // Check if everything is correctly sorted forward...
+    found = bp_tree_min(tree);
     if (found == NULL) { return FAIL; }
-    while (found != NULL) {
+    for (i=1; i<(int) tree->size; i++) {
         data  = found;
-        found = sp_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(aux);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+        found = bp_tree_next(tree, data);
+        if (found == NULL || MyComp(data, found) >= 0) { return FAIL; }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = sp_tree_min(all);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
+    if (found != bp_tree_max(tree))     { return FAIL; }
+    if (bp_tree_next(tree, found) != NULL) { return FAIL; }
+
+    // ...and backwards.
+    for (i=1; i<(int) tree->size; i++) {
         data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(all, data);
+        found = bp_tree_prev(tree, data);
+        if (found == NULL || MyComp(data, found) <= 0) { return FAIL; }
+    }
+    if (found != bp_tree_min(tree))     { return FAIL; }
+    if (bp_tree_prev(tree, found) != NULL) { return FAIL; }
+
+    // Remove elements randomly from the tree:
+    for (i=0; i<max_size*5; i++) {
+        key.key = rand() % max_size;
+        found = bp_tree_remove(tree, &key);
         if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(all);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+            if (MyComp(&key, found) != 0)       { return FAIL; }
+            free(found);
         }
+        if (bp_tree_search(tree, &key) != NULL) { return FAIL; }
+        if (is_bp_tree(tree) == NO)             { return FAIL; }
     }
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Now, clean everything!
+    bp_tree_remove_all(tree, free);
+    if (is_bp_tree(tree) == NO)       { return FAIL; }
+    if (bp_tree_is_empty(tree) == NO) { return FAIL; }
 
-    // AUX == SYMMETRIC_DIFFERENCE(empty, all) == ALL
-    aux = sp_tree_sym_diff(empty, all);
+    free(tree);
 
-    // It is not empty:
-    if (sp_tree_is_empty(aux) == YES) { return FAIL; }
+    return PASS;
+}
 
-    // Check if all data in "aux" is also in "all"...
-    found = sp_tree_min(aux);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_search(all, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(aux, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(aux);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
-        }
+// Set functions, copies & trees built from sorted arrays:
+int bp_tree_set_test(int max_size) {
+
+    int      i, n;
+    bp_tree *tree_1 = new_bp_tree(MyComp);
+    bp_tree *tree_2 = new_bp_tree(MyComp);
+    bp_tree *tree   = NULL;
+    MyData  *keys   = (MyData *) malloc(max_size*sizeof(MyData));
+    void   **data   = (void **)  malloc(max_size*sizeof(void *));
+    MyData  *found  = NULL;
+
+    // tree_1 holds the multiples of 2 and tree_2 the multiples of 3:
+    for (i=0; i<max_size; i++) {
+        keys[i].key = i;
+        data[i]     = &keys[i];
+        if (i % 2 == 0) { bp_tree_insert(tree_1, &keys[i]); }
+        if (i % 3 == 0) { bp_tree_insert(tree_2, &keys[i]); }
     }
-    
-    // ...and all data in "all" is also in "aux".
-    found = sp_tree_min(all);
-    if (found == NULL) { return FAIL; }
-    while (found != NULL) {
-        data  = found;
-        found = sp_tree_search(aux, data);
-        if (found == NULL) { return FAIL; }
-        found = sp_tree_next(all, data);
-        if (found != NULL) {
-            if (MyComp(data, found) >= 0) { return FAIL; }
-        } else { 
-            found = sp_tree_max(all);
-            if (found == NULL)            { return FAIL; }
-            if (MyComp(data, found) != 0) { return FAIL; }
-            break;
+
+    // Copy:
+    tree = bp_tree_copy(tree_2);
+    if (tree == NULL || is_bp_tree(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = bp_tree_search(tree, &keys[i]);
+        if ((i % 3 == 0) != (found == &keys[i])) { return FAIL; }
+    }
+    bp_tree_remove_all(tree, NULL);
+    free(tree);
+
+    // Union:
+    tree = bp_tree_union(tree_1, tree_2);
+    if (tree == NULL || is_bp_tree(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = bp_tree_search(tree, &keys[i]);
+        if ((i % 2 == 0 || i % 3 == 0) != (found == &keys[i])) { return FAIL; }
+    }
+    bp_tree_remove_all(tree, NULL);
+    free(tree);
+
+    // Intersection:
+    tree = bp_tree_intersection(tree_1, tree_2);
+    if (tree == NULL || is_bp_tree(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = bp_tree_search(tree, &keys[i]);
+        if ((i % 2 == 0 && i % 3 == 0) != (found == &keys[i])) { return FAIL; }
+    }
+    bp_tree_remove_all(tree, NULL);
+    free(tree);
+
+    // Difference:
+    tree = bp_tree_diff(tree_1, tree_2);
+    if (tree == NULL || is_bp_tree(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = bp_tree_search(tree, &keys[i]);
+        if ((i % 2 == 0 && i % 3 != 0) != (found == &keys[i])) { return FAIL; }
+    }
+    bp_tree_remove_all(tree, NULL);
+    free(tree);
+
+    // Symmetric difference:
+    tree = bp_tree_sym_diff(tree_1, tree_2);
+    if (tree == NULL || is_bp_tree(tree) == NO) { return FAIL; }
+    for (i=0; i<max_size; i++) {
+        found = bp_tree_search(tree, &keys[i]);
+        if (((i % 2 == 0) != (i % 3 == 0)) != (found == &keys[i])) {
+            return FAIL;
         }
     }
+    bp_tree_remove_all(tree, NULL);
+    free(tree);
 
-    // Clean:
-    sp_tree_remove_all(aux, NULL);
+    // Trees built from sorted arrays of every size (and the biggest one):
+    for (n=0; n<=max_size; n += (n < 600) ? 1 : 97) {
+        tree = bp_tree_from_sorted_array(MyComp, data, n);
+        if (tree == NULL || is_bp_tree(tree) == NO) { return FAIL; }
+        if (tree->size != (size_t) n)               { return FAIL; }
+        found = bp_tree_min(tree);
+        for (i=0; i<n; i++) {
+            if (found != &keys[i])                  { return FAIL; }
+            found = bp_tree_next(tree, found);
+        }
+        if (found != NULL)                          { return FAIL; }
 
-    // FINAL CLEAN UP:
-    sp_tree_remove_all(aux, NULL);
-    sp_tree_remove_all(odd, NULL);
-    sp_tree_remove_all(low, NULL);
-    sp_tree_remove_all(even, NULL);
-    sp_tree_remove_all(high, NULL);
-    sp_tree_remove_all(all, free);
-    free(aux);
-    free(odd);
-    free(low);
-    free(even);
-    free(high);
-    free(all);
+        // It can be modified as usual afterwards:
+        for (i=0; i<n; i += 3) {
+            if (bp_tree_remove(tree, &keys[i]) != &keys[i]) { return FAIL; }
+            if (is_bp_tree(tree) == NO)             { return FAIL; }
+        }
+        for (i=0; i<n; i += 3) {
+            if (bp_tree_insert(tree, &keys[i]) != NULL)     { return FAIL; }
+            if (is_bp_tree(tree) == NO)             { return FAIL; }
+        }
+        bp_tree_remove_all(tree, NULL);
+        free(tree);
+    }
+
+    bp_tree_remove_all(tree_1, NULL);
+    bp_tree_remove_all(tree_2, NULL);
+    free(tree_1);
+    free(tree_2);
+    free(keys);
+    free(data);
 
     return PASS;
 }
 
+
+
+
+
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 
 
@@ -4680,6 +9053,24 @@ int main () {
     else if (bs_tree_fast_sequential_test(max_size) == FAIL) { printf("bs_tree_fast_sequential_test FAILS\n\n"); }
     else if (bs_tree_random_test(max_size) == FAIL)          { printf("bs_tree_random_test FAILS\n\n"); }
     else if (bs_tree_set_test(max_size) == FAIL)             { printf("bs_tree_set_test FAILS\n\n"); }
+    else if (bs_tree_pool_test(max_size) == FAIL)            { printf("bs_tree_pool_test FAILS\n\n"); }
+    else if (bs_tree_cursor_test(max_size) == FAIL)          { printf("bs_tree_cursor_test FAILS\n\n"); }
+    else if (bs_tree_const_test(max_size) == FAIL)           { printf("bs_tree_const_test FAILS\n\n"); }
+    else if (bs_tree_sorted_test(max_size) == FAIL)          { printf("bs_tree_sorted_test FAILS\n\n"); }
+    else if (bs_tree_batch_test(max_size) == FAIL)           { printf("bs_tree_batch_test FAILS\n\n"); }
+    else if (bs_tree_interleaved_test(max_size) == FAIL)     { printf("bs_tree_interleaved_test FAILS\n\n"); }
+#ifdef TREE_STATS
+    else if (bs_tree_stats_test(max_size) == FAIL)           { printf("bs_tree_stats_test FAILS\n\n"); }
+#endif
+#ifdef TREE_KEY_PREFIX
+    else if (bs_tree_prefix_test(max_size) == FAIL)          { printf("bs_tree_prefix_test FAILS\n\n"); }
+#endif
+    else if (bs_tree_freeze_test(max_size) == FAIL)          { printf("bs_tree_freeze_test FAILS\n\n"); }
+    else if (bs_tree_min_max_test(max_size) == FAIL)         { printf("bs_tree_min_max_test FAILS\n\n"); }
+    else if (bs_tree_partial_rebalance_test(max_size) == FAIL) { printf("bs_tree_partial_rebalance_test FAILS\n\n"); }
+#ifdef BS_SCAPEGOAT
+    else if (bs_tree_scapegoat_test(max_size) == FAIL)       { printf("bs_tree_scapegoat_test FAILS\n\n"); }
+#endif
     else { printf("\nALL BS_TESTS PASSING in %.2f sec\n\n", ((double) (clock() - timer)) / CLOCKS_PER_SEC); }
 
     // RB_Testing:
@@ -4688,6 +9079,35 @@ int main () {
     else if (rb_tree_fast_sequential_test(max_size) == FAIL) { printf("rb_tree_fast_sequential_test FAILS\n\n"); }
     else if (rb_tree_random_test(max_size) == FAIL)          { printf("rb_tree_random_test FAILS\n\n"); }
     else if (rb_tree_set_test(max_size) == FAIL)             { printf("rb_tree_set_test FAILS\n\n"); }
+    else if (rb_tree_pool_test(max_size) == FAIL)            { printf("rb_tree_pool_test FAILS\n\n"); }
+    else if (rb_tree_cursor_test(max_size) == FAIL)          { printf("rb_tree_cursor_test FAILS\n\n"); }
+    else if (rb_tree_const_test(max_size) == FAIL)           { printf("rb_tree_const_test FAILS\n\n"); }
+#ifdef RB_ORDER_STATISTICS
+    else if (rb_tree_order_test(max_size) == FAIL)           { printf("rb_tree_order_test FAILS\n\n"); }
+#endif
+    else if (rb_tree_join_test(max_size) == FAIL)            { printf("rb_tree_join_test FAILS\n\n"); }
+    else if (rb_tree_sorted_test(max_size) == FAIL)          { printf("rb_tree_sorted_test FAILS\n\n"); }
+    else if (rb_tree_clone_test(max_size) == FAIL)           { printf("rb_tree_clone_test FAILS\n\n"); }
+    else if (rb_tree_batch_test(max_size) == FAIL)           { printf("rb_tree_batch_test FAILS\n\n"); }
+    else if (rb_tree_interleaved_test(max_size) == FAIL)     { printf("rb_tree_interleaved_test FAILS\n\n"); }
+#ifdef TREE_STATS
+    else if (rb_tree_stats_test(max_size) == FAIL)           { printf("rb_tree_stats_test FAILS\n\n"); }
+#endif
+#ifdef TREE_KEY_PREFIX
+    else if (rb_tree_prefix_test(max_size) == FAIL)          { printf("rb_tree_prefix_test FAILS\n\n"); }
+#endif
+    else if (rb_tree_freeze_test(max_size) == FAIL)          { printf("rb_tree_freeze_test FAILS\n\n"); }
+    else if (rb_tree_min_max_test(max_size) == FAIL)         { printf("rb_tree_min_max_test FAILS\n\n"); }
+#ifdef RB_THREADS
+    else if (sharded_rb_tree_test(max_size) == FAIL)         { printf("sharded_rb_tree_test FAILS\n\n"); }
+    else if (sharded_rb_tree_threads_test(max_size) == FAIL) { printf("sharded_rb_tree_threads_test FAILS\n\n"); }
+    else if (concurrent_rb_tree_test(max_size) == FAIL)      { printf("concurrent_rb_tree_test FAILS\n\n"); }
+    else if (concurrent_rb_tree_threads_test(max_size) == FAIL) { printf("concurrent_rb_tree_threads_test FAILS\n\n"); }
+#endif
+    else if (prb_tree_test(max_size) == FAIL)                { printf("prb_tree_test FAILS\n\n"); }
+#ifdef RB_THREADS
+    else if (prb_tree_threads_test(max_size) == FAIL)        { printf("prb_tree_threads_test FAILS\n\n"); }
+#endif
     else { printf("\nALL RB_TESTS PASSING in %.2f sec\n\n", ((double) (clock() - timer)) / CLOCKS_PER_SEC); }
 
     // SP_Testing:
@@ -4696,8 +9116,40 @@ int main () {
     else if (sp_tree_fast_sequential_test(max_size) == FAIL) { printf("sp_tree_fast_sequential_test FAILS\n\n"); }
     else if (sp_tree_random_test(max_size) == FAIL)          { printf("sp_tree_random_test FAILS\n\n"); }
     else if (sp_tree_set_test(max_size) == FAIL)             { printf("sp_tree_set_test FAILS\n\n"); }
+    else if (sp_tree_pool_test(max_size) == FAIL)            { printf("sp_tree_pool_test FAILS\n\n"); }
+    else if (sp_tree_cursor_test(max_size) == FAIL)          { printf("sp_tree_cursor_test FAILS\n\n"); }
+    else if (sp_tree_const_test(max_size) == FAIL)           { printf("sp_tree_const_test FAILS\n\n"); }
+    else if (sp_tree_sorted_test(max_size) == FAIL)          { printf("sp_tree_sorted_test FAILS\n\n"); }
+    else if (sp_tree_clone_test(max_size) == FAIL)           { printf("sp_tree_clone_test FAILS\n\n"); }
+    else if (sp_tree_batch_test(max_size) == FAIL)           { printf("sp_tree_batch_test FAILS\n\n"); }
+    else if (sp_tree_interleaved_test(max_size) == FAIL)     { printf("sp_tree_interleaved_test FAILS\n\n"); }
+#ifdef TREE_STATS
+    else if (sp_tree_stats_test(max_size) == FAIL)           { printf("sp_tree_stats_test FAILS\n\n"); }
+#endif
+#ifdef TREE_KEY_PREFIX
+    else if (sp_tree_prefix_test(max_size) == FAIL)          { printf("sp_tree_prefix_test FAILS\n\n"); }
+#endif
+    else if (sp_tree_min_max_test(max_size) == FAIL)         { printf("sp_tree_min_max_test FAILS\n\n"); }
+#ifdef SP_SPLAY_POLICY
+    else if (sp_tree_policy_test(max_size) == FAIL)          { printf("sp_tree_policy_test FAILS\n\n"); }
+#endif
     else { printf("\nALL SP_TESTS PASSING in %.2f sec\n\n", ((double) (clock() - timer)) / CLOCKS_PER_SEC); }
 
+    // RB_U64_Testing:
+    timer = clock();
+    if      (rb_tree_u64_random_test(max_size) == FAIL)      { printf("rb_tree_u64_random_test FAILS\n\n"); }
+    else if (rb_tree_u64_set_test(max_size) == FAIL)         { printf("rb_tree_u64_set_test FAILS\n\n"); }
+    else if (rb_tree_i64_test(max_size) == FAIL)             { printf("rb_tree_i64_test FAILS\n\n"); }
+    else if (rb_tree_u64_eytzinger_test(max_size) == FAIL)   { printf("rb_tree_u64_eytzinger_test FAILS\n\n"); }
+    else { printf("\nALL RB_U64_TESTS PASSING in %.2f sec\n\n", ((double) (clock() - timer)) / CLOCKS_PER_SEC); }
+
+    // BP_Testing:
+    timer = clock();
+    if      (bp_tree_sequential_test(max_size) == FAIL)      { printf("bp_tree_sequential_test FAILS\n\n"); }
+    else if (bp_tree_random_test(max_size) == FAIL)          { printf("bp_tree_random_test FAILS\n\n"); }
+    else if (bp_tree_set_test(max_size) == FAIL)             { printf("bp_tree_set_test FAILS\n\n"); }
+    else { printf("\nALL BP_TESTS PASSING in %.2f sec\n\n", ((double) (clock() - timer)) / CLOCKS_PER_SEC); }
+
     return 0;
 }
 